@@ -507,6 +507,63 @@ if(BUILD_TESTING)
     endif()
   endif()
 
+  # a microbenchmark of the eager dispatch path, run as a test with its default small iterations
+  oneflow_add_test(
+    oneflow_eager_dispatch_benchmark
+    SRCS
+    ${PROJECT_SOURCE_DIR}/oneflow/benchmark/eager_dispatch_benchmark.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env_impl.cpp
+    TEST_NAME
+    oneflow_eager_dispatch_benchmark)
+  target_link_libraries(oneflow_eager_dispatch_benchmark ${of_libs} ${oneflow_third_party_libs}
+                        glog::glog)
+
+  # the thread scaling of the CPU unique, run as a test over small inputs by default
+  oneflow_add_test(
+    oneflow_unique_benchmark
+    SRCS
+    ${PROJECT_SOURCE_DIR}/oneflow/benchmark/unique_benchmark.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env_impl.cpp
+    TEST_NAME
+    oneflow_unique_benchmark)
+  target_link_libraries(oneflow_unique_benchmark ${of_libs} ${oneflow_third_party_libs} glog::glog)
+
+  # the CPU matmul in bfloat16 against float32, run as a test over small matrices by default
+  oneflow_add_test(
+    oneflow_bfloat16_matmul_benchmark
+    SRCS
+    ${PROJECT_SOURCE_DIR}/oneflow/benchmark/bfloat16_matmul_benchmark.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env_impl.cpp
+    TEST_NAME
+    oneflow_bfloat16_matmul_benchmark)
+  target_link_libraries(oneflow_bfloat16_matmul_benchmark ${of_libs} ${oneflow_third_party_libs}
+                        glog::glog)
+
+  # the raw batch readers against pread, run as a test on a small file by default
+  oneflow_add_test(
+    oneflow_raw_batch_reader_benchmark
+    SRCS
+    ${PROJECT_SOURCE_DIR}/oneflow/benchmark/raw_batch_reader_benchmark.cpp
+    TEST_NAME
+    oneflow_raw_batch_reader_benchmark)
+  target_link_libraries(oneflow_raw_batch_reader_benchmark ${of_libs} ${oneflow_third_party_libs}
+                        glog::glog)
+
+  # the fused CPU linear with groupwise quantized weights against dequantize and matmul
+  oneflow_add_test(
+    oneflow_groupwise_quantized_linear_benchmark
+    SRCS
+    ${PROJECT_SOURCE_DIR}/oneflow/benchmark/groupwise_quantized_linear_benchmark.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env.cpp
+    ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/env_impl.cpp
+    TEST_NAME
+    oneflow_groupwise_quantized_linear_benchmark)
+  target_link_libraries(oneflow_groupwise_quantized_linear_benchmark ${of_libs}
+                        ${oneflow_third_party_libs} glog::glog)
+
   if(BUILD_CPP_API)
     file(GLOB_RECURSE cpp_api_test_files ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/tests/*.cpp)
     oneflow_add_test(
@@ -520,6 +577,16 @@ if(BUILD_TESTING)
     find_package(Threads REQUIRED)
     target_link_libraries(oneflow_cpp_api_testexe oneflow_cpp ${oneflow_third_party_libs}
                           ${oneflow_test_libs} Threads::Threads)
+
+    # the checkpoint load time of the C++ API, run as a test on a small model by default
+    oneflow_add_test(
+      oneflow_graph_load_benchmark
+      SRCS
+      ${PROJECT_SOURCE_DIR}/oneflow/benchmark/graph_load_benchmark.cpp
+      TEST_NAME
+      oneflow_graph_load_benchmark)
+    target_link_libraries(oneflow_graph_load_benchmark oneflow_cpp ${oneflow_third_party_libs}
+                          Threads::Threads)
   endif()
 endif()
 
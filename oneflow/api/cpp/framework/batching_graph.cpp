@@ -0,0 +1,298 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "oneflow/api/cpp/framework/batching_graph.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow_api {
+
+namespace of = oneflow;
+namespace functional = of::one::functional;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<Tensor> IValueToTensors(const IValue& value) {
+  if (value.IsNone()) { return {}; }
+  if (value.IsTensor()) { return {value.ToTensor()}; }
+  CHECK(value.IsTensorVector())
+      << "BatchingGraph currently only support types: Tensor/vector(Tensor)/None";
+  return value.ToTensorVector();
+}
+
+IValue TensorsToIValue(std::vector<Tensor>&& tensors) {
+  if (tensors.empty()) { return IValue{}; }
+  if (tensors.size() == 1) { return IValue(std::move(tensors.at(0))); }
+  return IValue(std::move(tensors));
+}
+
+// Copy the rows [start, start + length) of tensor, so that the result is still valid after the
+// output buffers of the graph are overwritten by the next run.
+of::Maybe<of::one::Tensor> CopyRows(const std::shared_ptr<of::one::Tensor>& tensor,
+                                    int64_t start, int64_t length) {
+  const auto& shape = tensor->shape();
+  std::vector<int64_t> starts(shape->NumAxes(), 0);
+  std::vector<int64_t> stops(shape->dim_vec().begin(), shape->dim_vec().end());
+  std::vector<int64_t> steps(shape->NumAxes(), 1);
+  starts[0] = start;
+  stops[0] = start + length;
+  return functional::Slice(tensor, starts, stops, steps, /*enable_view_slice=*/false);
+}
+
+double MicrosecondsBetween(const Clock::time_point& start, const Clock::time_point& end) {
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+}  // namespace
+
+class BatchingGraph::BatchingGraphImpl final {
+ public:
+  BatchingGraphImpl(const std::string& model_path, const Device& device,
+                    const BatchingOptions& options);
+  ~BatchingGraphImpl();
+
+  std::vector<Tensor> Forward(std::vector<Tensor>&& inputs);
+  std::vector<BucketStatistics> GetBucketStatistics() const;
+
+ private:
+  struct Request {
+    std::vector<Tensor> inputs;
+    int64_t batch_size;
+    Clock::time_point enqueue_time;
+    std::promise<std::vector<Tensor>> outputs;
+  };
+
+  void DispatchLoop();
+  void RunBatch(const std::vector<std::shared_ptr<Request>>& requests);
+  std::vector<std::vector<Tensor>> RunBucket(
+      size_t bucket_id, const std::vector<std::shared_ptr<Request>>& requests,
+      int64_t total_batch_size);
+
+  Device device_;
+  std::vector<int> batch_sizes_;
+  std::vector<Graph> graphs_;
+  std::chrono::microseconds max_delay_;
+  InputOutputInfos input_infos_;
+
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  std::deque<std::shared_ptr<Request>> queue_;
+  int64_t queued_batch_size_ = 0;
+  bool shutdown_ = false;
+
+  mutable std::mutex statistics_mutex_;
+  std::vector<BucketStatistics> statistics_;
+
+  std::thread dispatch_thread_;
+};
+
+BatchingGraph::BatchingGraphImpl::BatchingGraphImpl(const std::string& model_path,
+                                                    const Device& device,
+                                                    const BatchingOptions& options)
+    : device_(device), batch_sizes_(options.batch_sizes), max_delay_(options.max_delay_us) {
+  CHECK(!batch_sizes_.empty()) << "BatchingOptions.batch_sizes should not be empty";
+  std::sort(batch_sizes_.begin(), batch_sizes_.end());
+  batch_sizes_.erase(std::unique(batch_sizes_.begin(), batch_sizes_.end()), batch_sizes_.end());
+  CHECK_GT(batch_sizes_.front(), 0) << "Batch sizes should be positive";
+  for (size_t i = 0; i < batch_sizes_.size(); ++i) {
+    if (i == 0) {
+      graphs_.emplace_back(Graph::Load(model_path, device));
+      input_infos_ = graphs_.back().GetInputInfos();
+    } else {
+      graphs_.emplace_back(Graph(model_path, device, graphs_.front()));
+    }
+    graphs_.back().set_batch_size(batch_sizes_[i]);
+    // Compile ahead with zeros, the later buckets reuse the variables of the first one
+    std::vector<Tensor> inputs(input_infos_.size());
+    for (const auto& pair : input_infos_) {
+      const Shape& shape = pair.second.input_output_shape_;
+      CHECK_GT(shape.NumAxes(), 0) << "Input " << pair.first << " should have the batch dimension";
+      std::vector<int64_t> dims(shape.NumAxes());
+      for (int64_t axis = 0; axis < shape.NumAxes(); ++axis) { dims[axis] = shape.At(axis); }
+      dims[0] = batch_sizes_[i];
+      Tensor input(Shape(dims), device, pair.second.datatype_);
+      input.zeros_();
+      inputs[pair.second.input_output_index_] = std::move(input);
+    }
+    graphs_.back().Forward(inputs);
+    BucketStatistics statistics;
+    statistics.batch_size = batch_sizes_[i];
+    statistics_.emplace_back(statistics);
+  }
+  dispatch_thread_ = std::thread(&BatchingGraphImpl::DispatchLoop, this);
+}
+
+BatchingGraph::BatchingGraphImpl::~BatchingGraphImpl() {
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    shutdown_ = true;
+  }
+  queue_cond_.notify_all();
+  dispatch_thread_.join();
+}
+
+std::vector<Tensor> BatchingGraph::BatchingGraphImpl::Forward(std::vector<Tensor>&& inputs) {
+  CHECK_EQ(inputs.size(), input_infos_.size()) << "The number of inputs is not matched";
+  auto request = std::make_shared<Request>();
+  request->batch_size = inputs.empty() ? 0 : inputs.front().shape().At(0);
+  for (const auto& input : inputs) {
+    CHECK_EQ(input.shape().At(0), request->batch_size)
+        << "All inputs should have the same batch size";
+  }
+  CHECK_GT(request->batch_size, 0) << "Requests should have at least one sample";
+  CHECK_LE(request->batch_size, batch_sizes_.back())
+      << "The batch size of the request exceeds the largest bucket " << batch_sizes_.back();
+  request->inputs = std::move(inputs);
+  auto outputs = request->outputs.get_future();
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    CHECK(!shutdown_) << "BatchingGraph has been destructed";
+    request->enqueue_time = Clock::now();
+    queued_batch_size_ += request->batch_size;
+    queue_.emplace_back(std::move(request));
+  }
+  queue_cond_.notify_all();
+  return outputs.get();
+}
+
+void BatchingGraph::BatchingGraphImpl::DispatchLoop() {
+  const int64_t max_batch_size = batch_sizes_.back();
+  while (true) {
+    std::vector<std::shared_ptr<Request>> requests;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cond_.wait(lock, [&]() { return shutdown_ || !queue_.empty(); });
+      if (queue_.empty()) { return; }
+      // Wait for more requests until the largest bucket is full or the oldest request is due
+      const Clock::time_point deadline = queue_.front()->enqueue_time + max_delay_;
+      queue_cond_.wait_until(lock, deadline,
+                             [&]() { return shutdown_ || queued_batch_size_ >= max_batch_size; });
+      int64_t total_batch_size = 0;
+      while (!queue_.empty()
+             && total_batch_size + queue_.front()->batch_size <= max_batch_size) {
+        total_batch_size += queue_.front()->batch_size;
+        requests.emplace_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+      queued_batch_size_ -= total_batch_size;
+    }
+    RunBatch(requests);
+  }
+}
+
+void BatchingGraph::BatchingGraphImpl::RunBatch(
+    const std::vector<std::shared_ptr<Request>>& requests) {
+  int64_t total_batch_size = 0;
+  for (const auto& request : requests) { total_batch_size += request->batch_size; }
+  const size_t bucket_id =
+      std::lower_bound(batch_sizes_.begin(), batch_sizes_.end(), total_batch_size)
+      - batch_sizes_.begin();
+  const Clock::time_point start = Clock::now();
+  std::vector<std::vector<Tensor>> outputs;
+  try {
+    outputs = RunBucket(bucket_id, requests, total_batch_size);
+  } catch (...) {
+    // Rethrow in the threads calling Forward instead of terminating the dispatcher
+    const std::exception_ptr error = std::current_exception();
+    for (const auto& request : requests) { request->outputs.set_exception(error); }
+    return;
+  }
+  const Clock::time_point end = Clock::now();
+  {
+    std::unique_lock<std::mutex> lock(statistics_mutex_);
+    BucketStatistics& statistics = statistics_[bucket_id];
+    statistics.run_count += 1;
+    statistics.request_count += requests.size();
+    statistics.sample_count += total_batch_size;
+    statistics.total_run_time_us += MicrosecondsBetween(start, end);
+    for (const auto& request : requests) {
+      const double latency_us = MicrosecondsBetween(request->enqueue_time, end);
+      statistics.total_latency_us += latency_us;
+      statistics.max_latency_us = std::max(statistics.max_latency_us, latency_us);
+    }
+  }
+  for (size_t i = 0; i < requests.size(); ++i) {
+    requests[i]->outputs.set_value(std::move(outputs[i]));
+  }
+}
+
+std::vector<std::vector<Tensor>> BatchingGraph::BatchingGraphImpl::RunBucket(
+    size_t bucket_id, const std::vector<std::shared_ptr<Request>>& requests,
+    int64_t total_batch_size) {
+  const int64_t padding_size = batch_sizes_[bucket_id] - total_batch_size;
+  std::vector<Tensor> inputs;
+  for (size_t i = 0; i < input_infos_.size(); ++i) {
+    of::one::TensorTuple tensors;
+    for (const auto& request : requests) {
+      tensors.emplace_back(request->inputs[i].__internal_tensor());
+    }
+    if (padding_size > 0) {
+      of::Shape padding_shape(*tensors.front()->shape());
+      padding_shape.Set(0, padding_size);
+      tensors.emplace_back(CHECK_JUST(functional::Constant(padding_shape, of::Scalar(0),
+                                                           tensors.front()->dtype(),
+                                                           CHECK_JUST(tensors.front()->device()))));
+    }
+    if (tensors.size() == 1) {
+      inputs.emplace_back(Tensor(tensors.front()));
+    } else {
+      inputs.emplace_back(Tensor(CHECK_JUST(functional::Concat(tensors, /*dim=*/0))));
+    }
+  }
+  const std::vector<Tensor> bucket_outputs = IValueToTensors(graphs_[bucket_id].Forward(inputs));
+  std::vector<std::vector<Tensor>> outputs(requests.size());
+  for (const auto& bucket_output : bucket_outputs) {
+    int64_t offset = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      std::shared_ptr<of::one::Tensor> rows =
+          CHECK_JUST(CopyRows(bucket_output.__internal_tensor(), offset, requests[i]->batch_size));
+      outputs[i].emplace_back(Tensor(rows));
+      offset += requests[i]->batch_size;
+    }
+  }
+  return outputs;
+}
+
+std::vector<BucketStatistics> BatchingGraph::BatchingGraphImpl::GetBucketStatistics() const {
+  std::unique_lock<std::mutex> lock(statistics_mutex_);
+  return statistics_;
+}
+
+BatchingGraph::BatchingGraph(const std::string& model_path, const Device& device,
+                             const BatchingOptions& options)
+    : graph_(std::make_unique<BatchingGraphImpl>(model_path, device, options)) {}
+
+BatchingGraph::~BatchingGraph() = default;
+
+IValue BatchingGraph::Forward(const IValue& inputs) {
+  return TensorsToIValue(graph_->Forward(IValueToTensors(inputs)));
+}
+
+std::vector<BucketStatistics> BatchingGraph::GetBucketStatistics() const {
+  return graph_->GetBucketStatistics();
+}
+
+}  // namespace oneflow_api
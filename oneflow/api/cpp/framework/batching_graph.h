@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef ONEFLOW_API_CPP_BATCHING_GRAPH_H_
+#define ONEFLOW_API_CPP_BATCHING_GRAPH_H_
+
+#include "graph.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace oneflow_api {
+
+struct BatchingOptions {
+  // One graph is compiled for each batch size. They share the same variable tensors.
+  std::vector<int> batch_sizes;
+  // The longest time a request waits for other requests to be coalesced with.
+  int64_t max_delay_us = 1000;
+};
+
+struct BucketStatistics {
+  int batch_size = 0;
+  int64_t run_count = 0;
+  int64_t request_count = 0;
+  // Samples from requests, excluding the padded ones
+  int64_t sample_count = 0;
+  // Latency of a request is the time between entering the queue and getting its outputs
+  double total_latency_us = 0;
+  double max_latency_us = 0;
+  double total_run_time_us = 0;
+
+  [[nodiscard]] double average_latency_us() const {
+    return request_count == 0 ? 0 : total_latency_us / request_count;
+  }
+  // Samples per second while the graph of this bucket is running
+  [[nodiscard]] double throughput() const {
+    return total_run_time_us == 0 ? 0 : sample_count * 1e6 / total_run_time_us;
+  }
+};
+
+// Serve a model with variable batch sizes.
+// Forward can be called from multiple threads. Concurrent requests are concatenated along the
+// first dimension and run by the graph of the smallest batch size that fits them, padded with
+// zeros if needed. Every input and output of the model must have the batch in its first dimension.
+class BatchingGraph {
+ public:
+  BatchingGraph(const std::string& model_path, const Device& device,
+                const BatchingOptions& options);
+  ~BatchingGraph();
+
+  BatchingGraph(const BatchingGraph& graph) = delete;
+  BatchingGraph& operator=(const BatchingGraph& graph) = delete;
+
+  IValue Forward(const IValue& inputs);
+
+  [[nodiscard]] std::vector<BucketStatistics> GetBucketStatistics() const;
+
+ private:
+  class BatchingGraphImpl;
+  std::unique_ptr<BatchingGraphImpl> graph_;
+};
+
+}  // namespace oneflow_api
+
+#endif  // ONEFLOW_API_CPP_BATCHING_GRAPH_H_
@@ -25,6 +25,7 @@ limitations under the License.
 #include "oneflow/api/cpp/embedding/embedding.h"
 #include "oneflow/api/common/job_build_and_infer_ctx.h"
 #include "oneflow/api/python/job_build/job_build_and_infer.h"
+#include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/data_type.pb.h"
 #include "oneflow/core/common/singleton.h"
 #include "oneflow/core/common/hash_container.h"
@@ -34,11 +35,14 @@ limitations under the License.
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/embedding/posix_file.h"
 #include "oneflow/core/eager/eager_blob_object.h"
+#include "oneflow/core/eager/local_dep_object.h"
+#include "oneflow/core/eager/tensor_storage.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/dtype.h"
 #include "oneflow/core/framework/multi_client_session_context.h"
 #include "oneflow/core/framework/nn_graph.h"
 #include "oneflow/core/framework/scope_util.h"
+#include "oneflow/core/framework/stream.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_tuple.h"
 #include "oneflow/core/framework/tensor_util.h"
@@ -59,6 +63,7 @@ limitations under the License.
 #include "oneflow/core/operator/interface_blob_conf.pb.h"
 #include "oneflow/core/operator/op_conf.pb.h"
 #include "oneflow/core/register/logical_blob_id.pb.h"
+#include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/vm/vm_util.h"
 
 namespace oneflow_api {
@@ -134,6 +139,81 @@ void LoadOneEmbedding(const std::string& model_path, const Device& device) {
   }
 }
 
+// Variable files are faulted in by chunks of this size, so that a huge variable is read by
+// multiple threads.
+constexpr size_t kVariablePrefetchChunkSize = 64 * 1024 * 1024;
+
+// A private mapping of a variable file. Pages are shared with the page cache until written.
+class MappedVariableFile final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MappedVariableFile);
+  MappedVariableFile(void* ptr, size_t size) : ptr_(ptr), size_(size) {}
+  ~MappedVariableFile() { PCHECK(munmap(ptr_, size_) == 0); }
+
+  void* ptr() const { return ptr_; }
+
+ private:
+  void* ptr_;
+  size_t size_;
+};
+
+// Maps the variable file, or returns why it can not be used. Runs on the threads of
+// MultiThreadLoop, so a missing or truncated file is reported instead of aborting the process.
+std::string MapVariableFile(const std::string& filename, size_t byte_size,
+                            std::shared_ptr<MappedVariableFile>* mapped_file) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) { return "Can not open variable file " + filename + ": " + strerror(errno); }
+  std::string error;
+  struct stat sb {};
+  if (fstat(fd, &sb) != 0) {
+    error = "Can not stat variable file " + filename + ": " + strerror(errno);
+  } else if (static_cast<size_t>(sb.st_size) < byte_size) {
+    error = "Variable file " + filename + " is too small, " + std::to_string(sb.st_size)
+            + " bytes for " + std::to_string(byte_size) + " bytes of data";
+  } else if (byte_size > 0) {
+    void* ptr = mmap(nullptr, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+      error = "Can not map variable file " + filename + ": " + strerror(errno);
+    } else {
+      *mapped_file = std::make_shared<MappedVariableFile>(ptr, sb.st_size);
+    }
+  }
+  // the mapping stays valid after the file is closed
+  close(fd);
+  return error;
+}
+
+void PrefetchMappedFile(MappedVariableFile* mapped_file, size_t begin, size_t end) {
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  const volatile char* ptr = static_cast<const volatile char*>(mapped_file->ptr());
+  // Read faults do not break the sharing of private mappings
+  for (size_t offset = begin; offset < end; offset += page_size) { (void)ptr[offset]; }
+}
+
+// Make a cpu tensor which uses the mapped file as its storage without copying
+of::Maybe<of::one::Tensor> MakeTensorFromMappedFile(
+    const std::shared_ptr<MappedVariableFile>& mapped_file, const of::Shape& shape,
+    of::DataType data_type, of::Symbol<of::Device> device) {
+  const auto tensor_meta = of::SymbolOf(of::LocalTensorMeta(
+      shape, of::Stride(shape), data_type, of::MemoryFormat::kContiguous, device));
+  // The mapping is released together with the tensor storage
+  const auto& Free = [mapped_file](char*) {};
+  auto tensor_data = std::make_shared<of::vm::TensorStorage>(false, device);
+  tensor_data->set_blob_dptr(std::unique_ptr<char, std::function<void(char*)>>(
+                                 static_cast<char*>(mapped_file->ptr()), Free),
+                             shape.elem_cnt() * of::GetSizeOfDataType(data_type));
+  auto tensor_storage = std::make_shared<of::one::TensorStorage>(tensor_data);
+  auto tensor_impl = std::make_shared<of::one::EagerLocalTensorImpl>(tensor_storage,
+                                                                     /*requires_grad=*/false,
+                                                                     /*is_leaf=*/true);
+  JUST(tensor_impl->InitEagerBlobObject(tensor_meta, of::NewLocalDepObject()));
+  const auto& stream = JUST(of::GetDefaultStreamByDevice(device));
+  const auto& eager_blob_object = JUST(tensor_impl->eager_blob_object());
+  JUST(eager_blob_object->init_producer_stream(stream));
+  eager_blob_object->set_last_used_stream(stream);
+  return std::shared_ptr<of::one::Tensor>(new of::one::LocalTensor(tensor_impl));
+}
+
 #endif  // __linux__
 
 }  // namespace
@@ -154,6 +234,9 @@ class Graph::GraphImpl final {
   InputOutputInfos GetOutputInfos();
   std::vector<Tensor> Forward(const std::vector<Tensor>& inputs);
   void set_batch_size(int batch_size) { batch_size_ = batch_size; }
+  void set_variable_provider(const GraphImpl* variable_provider) {
+    variable_provider_ = variable_provider;
+  }
 
   of::Maybe<void> RegisterJobPass(
       const std::function<std::string(const std::string& job)>& pass_fn);
@@ -164,7 +247,7 @@ class Graph::GraphImpl final {
   of::Maybe<std::vector<Tensor>> Run(const std::vector<Tensor>& inputs) const;
   of::Maybe<void> AddOp(of::OperatorConf op_conf);
   of::Maybe<void> BuildGraph();
-  of::Maybe<void> LoadCheckpoint();
+  of::Maybe<void> LoadCheckpoint(const std::vector<of::OperatorConf>& variable_op_confs);
   of::Maybe<void> RegisterTensors(const std::vector<Tensor>& inputs);
   of::Maybe<of::Job> ApplyJobPasses(const of::Job& job);
 
@@ -182,11 +265,17 @@ class Graph::GraphImpl final {
   std::shared_ptr<of::one::TensorTuple> output_tensor_tuple_;
   std::shared_ptr<of::one::TensorTuple> parameter_tensor_tuple_;
   std::vector<std::function<std::string(const std::string&)>> registered_job_passes_;
+  const GraphImpl* variable_provider_ = nullptr;
 };
 
 Graph::Graph(const std::string& model_path, const Device& device)
     : graph_(std::make_unique<GraphImpl>(model_path, device)) {}
 
+Graph::Graph(const std::string& model_path, const Device& device, const Graph& variable_provider)
+    : Graph(model_path, device) {
+  graph_->set_variable_provider(variable_provider.graph_.get());
+}
+
 Graph::~Graph() = default;
 
 Graph::Graph(Graph&& graph) noexcept : graph_(std::move(graph.graph_)) {}
@@ -342,23 +431,17 @@ of::Maybe<void> Graph::GraphImpl::AddOp(of::OperatorConf op_conf) {
 
 of::Maybe<void> Graph::GraphImpl::BuildGraph() {
   CompileScope build_graph_scope(job_.job_conf(), *device_.device_->shared_from_symbol());
+  std::vector<of::OperatorConf> variable_op_confs;
   {
     const of::OpGraph op_graph(job_);
     op_graph.TopoForEachNode([&](const of::OpNode* node) -> of::Maybe<void> {
       const of::OperatorConf& op_conf = node->op().op_conf();
       JUST(AddOp(op_conf));
-      if (op_conf.has_variable_conf()) {
-        const of::LazyMode::Guard lazy_mode_disabled_guard{false};
-        const of::VariableOpConf& variable_conf = op_conf.variable_conf();
-        variable_op_name_to_tensor_[op_conf.name()] = JUST(of::one::functional::Empty(
-            of::Shape(variable_conf.shape()),
-            JUST(of::DType::Get(static_cast<of::DataType>(variable_conf.data_type()))),
-            *device_.device_, /*requires_grad=*/false, /*pin_memory=*/false));
-      }
+      if (op_conf.has_variable_conf()) { variable_op_confs.emplace_back(op_conf); }
       return of::Maybe<void>::Ok();
     });
   }
-  JUST(LoadCheckpoint());
+  JUST(LoadCheckpoint(variable_op_confs));
   JUST(of::CurJobBuildAndInferCtx_Complete());
   std::shared_ptr<of::Job> complete_job = JUST(of::GetCurrentJob());
   int64_t job_id = JUST(of::JobBuildAndInferCtx_GetCurrentJobId());
@@ -392,26 +475,97 @@ of::Maybe<void> Graph::GraphImpl::BuildGraph() {
   return of::Maybe<void>::Ok();
 }
 
-of::Maybe<void> Graph::GraphImpl::LoadCheckpoint() {
-  for (const auto& variable_op_name_and_tensor : variable_op_name_to_tensor_) {
-    const auto& variable_op_name = variable_op_name_and_tensor.first;
-    const auto& variable_tensor = variable_op_name_and_tensor.second;
-    const std::string variable_filename = model_path_ + "/" + variable_op_name + "/out";
-    const std::string buffer = [&]() {
-      std::ifstream variable_file(variable_filename, std::ios::binary);
+of::Maybe<void> Graph::GraphImpl::LoadCheckpoint(
+    const std::vector<of::OperatorConf>& variable_op_confs) {
+  if (variable_provider_ != nullptr) {
+    CHECK_OR_RETURN(variable_provider_->is_compiled_)
+        << "The graph providing variables should be compiled first";
+    for (const auto& variable_op_conf : variable_op_confs) {
+      variable_op_name_to_tensor_[variable_op_conf.name()] =
+          JUST(of::MapAt(variable_provider_->variable_op_name_to_tensor_, variable_op_conf.name()));
+    }
+    const auto& pair = Unzip(variable_op_name_to_tensor_);
+    JUST(of::FillVariableTensorMgr(pair.first, pair.second));
+    return of::Maybe<void>::Ok();
+  }
+  const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+  const size_t variable_num = variable_op_confs.size();
+  std::vector<size_t> variable_byte_sizes(variable_num);
+  for (size_t i = 0; i < variable_num; ++i) {
+    const of::VariableOpConf& variable_conf = variable_op_confs[i].variable_conf();
+    variable_byte_sizes[i] = of::Shape(variable_conf.shape()).elem_cnt()
+                             * of::GetSizeOfDataType(variable_conf.data_type());
+  }
+  const auto& VariableFilename = [&](size_t i) {
+    return model_path_ + "/" + variable_op_confs[i].name() + "/out";
+  };
+#ifdef __linux__
+  // Map all the variable files and fault their pages in with multiple threads, so that the copy
+  // below, or the first access of an aliasing tensor, reads from the page cache.
+  std::vector<std::shared_ptr<MappedVariableFile>> mapped_files(variable_num);
+  std::vector<std::string> map_errors(variable_num);
+  of::MultiThreadLoop(variable_num, [&](size_t i) {
+    map_errors[i] = MapVariableFile(VariableFilename(i), variable_byte_sizes[i], &mapped_files[i]);
+  });
+  for (const std::string& map_error : map_errors) {
+    CHECK_OR_RETURN(map_error.empty()) << map_error;
+  }
+  std::vector<std::pair<size_t, size_t>> variable_index_and_offsets;
+  for (size_t i = 0; i < variable_num; ++i) {
+    for (size_t offset = 0; offset < variable_byte_sizes[i]; offset += kVariablePrefetchChunkSize) {
+      variable_index_and_offsets.emplace_back(i, offset);
+    }
+  }
+  of::MultiThreadLoop(variable_index_and_offsets.size(), [&](size_t i) {
+    const size_t variable_index = variable_index_and_offsets[i].first;
+    const size_t offset = variable_index_and_offsets[i].second;
+    PrefetchMappedFile(mapped_files[variable_index].get(), offset,
+                       std::min(offset + kVariablePrefetchChunkSize,
+                                variable_byte_sizes[variable_index]));
+  });
+  const bool alias_mapped_files = GetDeviceTag(device_) == "cpu";
+#endif  // __linux__
+  for (size_t i = 0; i < variable_num; ++i) {
+    const of::VariableOpConf& variable_conf = variable_op_confs[i].variable_conf();
+    const of::Shape shape(variable_conf.shape());
+    const of::DataType data_type = static_cast<of::DataType>(variable_conf.data_type());
+#ifdef __linux__
+    if (alias_mapped_files && mapped_files[i] != nullptr) {
+      variable_op_name_to_tensor_[variable_op_confs[i].name()] =
+          JUST(MakeTensorFromMappedFile(mapped_files[i], shape, data_type, *device_.device_));
+      mapped_files[i].reset();
+      continue;
+    }
+    const char* buffer =
+        mapped_files[i] == nullptr ? nullptr : static_cast<const char*>(mapped_files[i]->ptr());
+#else
+    const std::string buffer_str = [&]() {
+      std::ifstream variable_file(VariableFilename(i), std::ios::binary);
       CHECK(variable_file.is_open());
       std::stringstream ss;
       ss << variable_file.rdbuf();
       return ss.str();
     }();
-    const auto& callback = [&](of::ep::Stream* stream,
-                               const std::shared_ptr<of::vm::EagerBlobObject>& eager_blob_object) {
-      of::AutoMemcpy(stream, eager_blob_object->mut_dptr(), buffer.data(),
-                     variable_tensor->shape()->elem_cnt()
-                         * of::GetSizeOfDataType(variable_tensor->dtype()->data_type()),
-                     eager_blob_object->mem_case(), of::memory::MakeHostMemCase());
-    };
-    JUST(of::one::SyncAccessTensorWithTimeOut(variable_tensor, callback, "mut"));
+    CHECK_GE_OR_RETURN(buffer_str.size(), variable_byte_sizes[i])
+        << "Variable file " << VariableFilename(i) << " is too small";
+    const char* buffer = buffer_str.data();
+#endif  // __linux__
+    const auto& variable_tensor =
+        JUST(of::one::functional::Empty(shape, JUST(of::DType::Get(data_type)), *device_.device_,
+                                        /*requires_grad=*/false, /*pin_memory=*/false));
+    if (variable_byte_sizes[i] > 0) {
+      const auto& callback =
+          [&](of::ep::Stream* stream,
+              const std::shared_ptr<of::vm::EagerBlobObject>& eager_blob_object) {
+        of::AutoMemcpy(stream, eager_blob_object->mut_dptr(), buffer, variable_byte_sizes[i],
+                       eager_blob_object->mem_case(), of::memory::MakeHostMemCase());
+      };
+      JUST(of::one::SyncAccessTensorWithTimeOut(variable_tensor, callback, "mut"));
+    }
+    variable_op_name_to_tensor_[variable_op_confs[i].name()] = variable_tensor;
+#ifdef __linux__
+    mapped_files[i].reset();
+#endif  // __linux__
   }
   const auto& pair = Unzip(variable_op_name_to_tensor_);
   JUST(of::FillVariableTensorMgr(pair.first, pair.second));
@@ -70,6 +70,10 @@ class Graph {
   static Graph Load(const std::string& model_path, const Device& device = Device("cpu"));
 
  private:
+  friend class BatchingGraph;
+  // Reuse the variable tensors of variable_provider, which must have been compiled
+  Graph(const std::string& model_path, const Device& device, const Graph& variable_provider);
+
   class GraphImpl;
   std::unique_ptr<GraphImpl> graph_;
 };
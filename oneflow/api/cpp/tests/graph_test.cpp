@@ -19,14 +19,22 @@ limitations under the License.
 #include <array>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <sstream>
 #include <thread>
 #include <vector>
 #include "oneflow/api/cpp/framework.h"
 #include "oneflow/api/cpp/framework/dtype.h"
 #include "oneflow/api/cpp/framework/shape.h"
 #include "oneflow/api/cpp/tests/api_test.h"
+#ifdef __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // __linux__
 
 namespace oneflow_api {
 
@@ -55,6 +63,84 @@ inline void Forward(Graph& graph, const Device& device, int expected_batch_dim =
   for (const float& element : buf) { ASSERT_EQ(element, 4); }
 }
 
+#ifdef __linux__
+
+float AffineWeight(int64_t i, int64_t j) { return static_cast<float>((i + j) % 5); }
+float AffineBias(int64_t j) { return static_cast<float>(j % 3); }
+
+// Generate y = x * a + b with a [in_features, out_features] weight, a[i][j] = AffineWeight(i, j)
+// and b[j] = AffineBias(j)
+std::string GenerateAffineModel(const std::string& dirname, int64_t in_features,
+                                int64_t out_features) {
+  const std::string in_str = std::to_string(in_features);
+  const std::string out_str = std::to_string(out_features);
+  const std::string device_attrs =
+      R"(device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], )";
+  std::stringstream mlir;
+  mlir << "module  {\n"
+       << "  oneflow.job @MyGraph_0(%arg0: tensor<1x" << in_str << "xf32>) -> tensor<1x" << out_str
+       << "xf32> {\n"
+       << "    %output = \"oneflow.input\"(%arg0) {data_type = 2 : i32, " << device_attrs
+       << R"(is_dynamic = false, nd_sbp = ["B"], op_name = "_MyGraph_0-input_0", )"
+       << R"(output_lbns = ["_MyGraph_0-input_0/out"], scope_symbol_id = 4611686018427469823 : )"
+       << "i64, shape = [1 : si64, " << in_str << " : si64]} : (tensor<1x" << in_str
+       << "xf32>) -> tensor<1x" << in_str << "xf32>\n"
+       << "    %output_0 = \"oneflow.variable\"() {data_type = 2 : i32, " << device_attrs
+       << R"(parallel = #sbp.parallel<[] -> [#sbp.B]>, op_name = "model.a", )"
+       << R"(output_lbns = ["model.a/out"], scope_symbol_id = 4611686018427482111 : i64, )"
+       << "shape = [" << in_str << " : si64, " << out_str << " : si64]} : () -> tensor<" << in_str
+       << "x" << out_str << "xf32>\n"
+       << "    %output_1 = \"oneflow.variable\"() {data_type = 2 : i32, " << device_attrs
+       << R"(parallel = #sbp.parallel<[] -> [#sbp.B]>, op_name = "model.b", )"
+       << R"(output_lbns = ["model.b/out"], scope_symbol_id = 4611686018427494399 : i64, )"
+       << "shape = [" << out_str << " : si64]} : () -> tensor<" << out_str << "xf32>\n"
+       << "    %0 = \"oneflow.matmul\"(%output, %output_0) {alpha = 1.000000e+00 : f64, "
+       << device_attrs
+       << R"(op_name = "model-matmul_0", output_lbns = ["model-matmul_0/out_0"], )"
+       << "scope_symbol_id = 4611686018427486207 : i64, transpose_a = false, transpose_b = false} "
+       << ": (tensor<1x" << in_str << "xf32>, tensor<" << in_str << "x" << out_str
+       << "xf32>) -> tensor<1x" << out_str << "xf32>\n"
+       << "    %1 = \"oneflow.broadcast_add\"(%0, %output_1) {" << device_attrs
+       << R"(op_name = "model-broadcast_add_1", output_lbns = ["model-broadcast_add_1/z_0"], )"
+       << "scope_symbol_id = 4611686018427486207 : i64} : (tensor<1x" << out_str
+       << "xf32>, tensor<" << out_str << "xf32>) -> tensor<1x" << out_str << "xf32>\n"
+       << "    %output_2 = \"oneflow.output\"(%1) {data_type = 2 : i32, " << device_attrs
+       << R"(is_dynamic = false, nd_sbp = ["B"], op_name = "_MyGraph_0-output_0", )"
+       << R"(output_lbns = ["_MyGraph_0-output_0/out"], scope_symbol_id = 4611686018427469823 : )"
+       << "i64, shape = [1 : si64, " << out_str << " : si64]} : (tensor<1x" << out_str
+       << "xf32>) -> tensor<1x" << out_str << "xf32>\n"
+       << "    oneflow.return %output_2 : tensor<1x" << out_str << "xf32>\n"
+       << "  }\n"
+       << "}\n";
+  const auto& WriteVariable = [&](const std::string& name, const std::vector<float>& data) {
+    const std::string variable_dir = dirname + "/" + name;
+    mkdir(variable_dir.c_str(), 0755);
+    std::ofstream out(variable_dir + "/out", std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+  };
+  std::vector<float> a(in_features * out_features);
+  for (int64_t i = 0; i < in_features; ++i) {
+    for (int64_t j = 0; j < out_features; ++j) { a[i * out_features + j] = AffineWeight(i, j); }
+  }
+  std::vector<float> b(out_features);
+  for (int64_t j = 0; j < out_features; ++j) { b[j] = AffineBias(j); }
+  std::ofstream(dirname + "/model.mlir") << mlir.str();
+  WriteVariable("model.a", a);
+  WriteVariable("model.b", b);
+  return dirname;
+}
+
+void RemoveAffineModel(const std::string& dirname) {
+  for (const std::string name : {"model.a", "model.b"}) {
+    std::remove((dirname + "/" + name + "/out").c_str());
+    rmdir((dirname + "/" + name).c_str());
+  }
+  std::remove((dirname + "/model.mlir").c_str());
+  rmdir(dirname.c_str());
+}
+
+#endif  // __linux__
+
 }  // namespace
 
 TEST(Api, graph_cpu_test) {
@@ -92,6 +178,85 @@ TEST(Api, graph_cpu_batching_test) {
   Forward(graph, device, 10);
 }
 
+TEST(Api, graph_cpu_dynamic_batching_test) {
+  EnvScope scope;
+  Device device("cpu");
+  BatchingOptions options;
+  options.batch_sizes = {1, 4, 8};
+  options.max_delay_us = 2000;
+  BatchingGraph graph("./oneflow/api/cpp/tests/graph_test_model/affine_with_parameter", device,
+                      options);
+
+  const int requests_per_thread = 20;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&graph, &device, i]() {
+      for (int j = 0; j < requests_per_thread; j++) {
+        const int batch_size = (i + j) % 3 + 1;
+        std::vector<float> data(batch_size * 3, 1);
+        const auto& value = graph.Forward(
+            Tensor::from_buffer(data.data(), Shape({batch_size, 3}), device, DType::kFloat));
+        ASSERT_TRUE(value.IsTensor());
+        Tensor output = value.ToTensor();
+        ASSERT_EQ(output.shape().At(0), batch_size);
+        ASSERT_EQ(output.shape().At(1), 4);
+        std::vector<float> buf(batch_size * 4);
+        output.copy_to(buf.data());
+        for (const float& element : buf) { ASSERT_EQ(element, 4); }
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+
+  int64_t request_count = 0;
+  for (const auto& statistics : graph.GetBucketStatistics()) {
+    request_count += statistics.request_count;
+    ASSERT_LE(statistics.sample_count, statistics.run_count * statistics.batch_size);
+  }
+  ASSERT_EQ(request_count, 4 * requests_per_thread);
+}
+
+TEST(Api, graph_cpu_dynamic_batching_coalesce_test) {
+  EnvScope scope;
+  Device device("cpu");
+  BatchingOptions options;
+  options.batch_sizes = {1, 4, 8};
+  // long enough that the dispatcher only runs once the largest bucket is full
+  options.max_delay_us = 60 * 1000 * 1000;
+  BatchingGraph graph("./oneflow/api/cpp/tests/graph_test_model/affine_with_parameter", device,
+                      options);
+
+  const int num_requests = 8;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_requests; i++) {
+    threads.emplace_back([&graph, &device]() {
+      std::vector<float> data(3, 1);
+      const auto& value =
+          graph.Forward(Tensor::from_buffer(data.data(), Shape({1, 3}), device, DType::kFloat));
+      ASSERT_TRUE(value.IsTensor());
+      Tensor output = value.ToTensor();
+      ASSERT_EQ(output.shape().At(0), 1);
+      std::vector<float> buf(4);
+      output.copy_to(buf.data());
+      for (const float& element : buf) { ASSERT_EQ(element, 4); }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+
+  // the 8 requests are merged into a single run of the largest bucket
+  const auto statistics = graph.GetBucketStatistics();
+  ASSERT_EQ(statistics.size(), 3U);
+  for (const auto& bucket : statistics) {
+    if (bucket.batch_size == 8) {
+      ASSERT_EQ(bucket.run_count, 1);
+      ASSERT_EQ(bucket.request_count, num_requests);
+      ASSERT_EQ(bucket.sample_count, num_requests);
+    } else {
+      ASSERT_EQ(bucket.run_count, 0);
+    }
+  }
+}
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 TEST(Api, graph_gpu_batching_test) {
   EnvScope scope;
@@ -159,6 +324,58 @@ TEST(Api, graph_thread_test) {
   for (auto& thread : threads) { thread.join(); }
 }
 
+#ifdef __linux__
+TEST(Api, graph_cpu_load_mmap_test) {
+  EnvScope scope;
+  Device device("cpu");
+  const int64_t in_features = 64;
+  const int64_t out_features = 128;
+  char dirname[] = "/tmp/graph_load_mmap_test_XXXXXX";
+  ASSERT_NE(mkdtemp(dirname), nullptr);
+  const std::string model_path = GenerateAffineModel(dirname, in_features, out_features);
+  std::vector<float> x(in_features);
+  for (int64_t i = 0; i < in_features; ++i) { x[i] = static_cast<float>(i % 4) - 1; }
+  std::vector<float> expected(out_features);
+  for (int64_t j = 0; j < out_features; ++j) {
+    expected[j] = AffineBias(j);
+    for (int64_t i = 0; i < in_features; ++i) { expected[j] += x[i] * AffineWeight(i, j); }
+  }
+  // the second load checks that the first one left the mapped files untouched
+  for (int iter = 0; iter < 2; ++iter) {
+    Graph graph = Graph::Load(model_path, device);
+    std::vector<Tensor> inputs;
+    inputs.emplace_back(
+        Tensor::from_buffer(x.data(), Shape({1, in_features}), device, DType::kFloat));
+    Tensor output = graph.Forward(inputs).ToTensor();
+    ASSERT_EQ(output.shape().At(0), 1);
+    ASSERT_EQ(output.shape().At(1), out_features);
+    std::vector<float> buf(out_features);
+    output.copy_to(buf.data());
+    for (int64_t j = 0; j < out_features; ++j) { ASSERT_FLOAT_EQ(buf[j], expected[j]); }
+  }
+  RemoveAffineModel(model_path);
+}
+
+TEST(Api, graph_cpu_load_truncated_variable_test) {
+  EnvScope scope;
+  Device device("cpu");
+  const int64_t in_features = 64;
+  const int64_t out_features = 128;
+  char dirname[] = "/tmp/graph_load_truncated_test_XXXXXX";
+  ASSERT_NE(mkdtemp(dirname), nullptr);
+  const std::string model_path = GenerateAffineModel(dirname, in_features, out_features);
+  ASSERT_EQ(truncate((model_path + "/model.a/out").c_str(), in_features * sizeof(float)), 0);
+  Graph graph = Graph::Load(model_path, device);
+  std::vector<float> x(in_features, 1);
+  std::vector<Tensor> inputs;
+  inputs.emplace_back(
+      Tensor::from_buffer(x.data(), Shape({1, in_features}), device, DType::kFloat));
+  // the loader reports the bad file instead of aborting the process
+  ASSERT_ANY_THROW(graph.Forward(inputs));
+  RemoveAffineModel(model_path);
+}
+#endif  // __linux__
+
 TEST(Api, graph_input_order_test) {
   EnvScope scope;
 
@@ -0,0 +1,38 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/autograd/ddp_reducer.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+
+ONEFLOW_API_PYBIND11_MODULE("", m) {
+  py::class_<one::DDPReducer, std::shared_ptr<one::DDPReducer>>(m, "DDPReducer")
+      .def(py::init([](const one::TensorTuple& params, int64_t bucket_cap_bytes,
+                       const Optional<Symbol<DType>>& comm_dtype) {
+        return one::DDPReducer::New(params, bucket_cap_bytes, comm_dtype).GetPtrOrThrow();
+      }))
+      .def("prepare_for_backward",
+           [](one::DDPReducer& reducer) { reducer.PrepareForBackward().GetOrThrow(); })
+      .def_property_readonly("bucket_param_indices", &one::DDPReducer::bucket_param_indices)
+      .def_property_readonly("has_rebuilt_buckets", &one::DDPReducer::has_rebuilt_buckets);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,34 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/framework/eager_op_trace.h"
+
+namespace py = pybind11;
+
+ONEFLOW_API_PYBIND11_MODULE("", m) {
+  using namespace oneflow;
+  py::class_<one::EagerOpTrace, std::shared_ptr<one::EagerOpTrace>>(m, "EagerOpTrace")
+      .def(py::init([]() { return std::make_shared<one::EagerOpTrace>(); }))
+      .def("begin_capture", [](one::EagerOpTrace& trace) { trace.BeginCapture().GetOrThrow(); })
+      .def("end_capture", [](one::EagerOpTrace& trace) { trace.EndCapture().GetOrThrow(); })
+      .def("replay", [](one::EagerOpTrace& trace) { trace.Replay().GetOrThrow(); })
+      .def("reset", &one::EagerOpTrace::Reset)
+      .def_property_readonly("num_ops", &one::EagerOpTrace::num_ops)
+      .def_property_readonly("is_capturing", &one::EagerOpTrace::is_capturing)
+      .def_property_readonly("is_valid", &one::EagerOpTrace::is_valid)
+      .def_property_readonly("invalid_reason", &one::EagerOpTrace::invalid_reason);
+}
@@ -14,10 +14,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include "oneflow/api/python/functional/common.h"
 #include "oneflow/api/python/of_api_registry.h"
 #include "oneflow/core/framework/random_generator.h"
 #include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/ep/cpu/cpu_random_generator.h"
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 #include "oneflow/core/device/cuda_util.h"
 #endif  // WITH_CUDA
@@ -82,6 +84,16 @@ ONEFLOW_API_PYBIND11_MODULE("", m) {
     return one::ManualSeedAllCudaGenerator(seed_val);
   });
   m.def("default_generators", &GetCudaDefaultGenerators);
+  m.def("philox4x32",
+        [](int64_t n, const py::object& seed, uint64_t offset,
+           uint64_t subsequence) -> py::array_t<uint32_t> {
+          CHECK_GE_OR_THROW(n, 0) << "n should be non-negative, but got " << n;
+          const int64_t seed_val = one::functional::PyUnpackLong(seed.ptr()).GetOrThrow();
+          py::array_t<uint32_t> numbers(n);
+          ep::Philox4x32Engine(static_cast<uint64_t>(seed_val), subsequence)
+              .Fill(offset, n, numbers.mutable_data());
+          return numbers;
+        });
 }
 
 }  // namespace oneflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include <tuple>
 #include "oneflow/api/common/variable_tensor_mgr.h"
 #include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/framework/variable_tensor_mgr.h"
 
 namespace py = pybind11;
 
@@ -27,6 +28,7 @@ ONEFLOW_API_PYBIND11_MODULE("", m) {
   m.def("FillVariableTensorMgr", &FillVariableTensorMgr);
   m.def("DumpVariableTensorMgr", &DumpVariableTensorMgr);
   m.def("ResetVariableTensorMgr", &ResetVariableTensorMgr);
+  m.def("IncreaseVariableGeneration", &IncreaseVariableGeneration);
 }
 
 }  // namespace oneflow
@@ -178,14 +178,20 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
                    int64_t target_width, int64_t target_height, int64_t seed, int64_t num_workers,
                    int64_t max_num_pixels, float random_area_min, float random_area_max,
                    float random_aspect_ratio_min, float random_aspect_ratio_max,
-                   int64_t warmup_size, int64_t num_attempts) -> Maybe<Tensor> {
+                   int64_t warmup_size, int64_t num_attempts,
+                   const Symbol<DType>& output_dtype, const std::string& output_layout,
+                   const std::vector<float>& mean, const std::vector<float>& std,
+                   float mirror_probability) -> Maybe<Tensor> {
                   auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP(
                       "target_width", "target_height", "seed", "num_workers", "max_num_pixels",
                       "random_area_min", "random_area_max", "random_aspect_ratio_min",
-                      "random_aspect_ratio_max", "warmup_size", "num_attempts");
+                      "random_aspect_ratio_max", "warmup_size", "num_attempts",
+                      "output_data_type", "output_layout", "mean", "std", "mirror_probability");
                   attrs.SetAllAttrs(target_width, target_height, seed, num_workers, max_num_pixels,
                                     random_area_min, random_area_max, random_aspect_ratio_min,
-                                    random_aspect_ratio_max, warmup_size, num_attempts);
+                                    random_aspect_ratio_max, warmup_size, num_attempts,
+                                    output_dtype->data_type(), output_layout, mean, std,
+                                    mirror_probability);
                   return OpInterpUtil::Dispatch<Tensor>(*op, {input}, attrs);
                 });
   m.add_functor(
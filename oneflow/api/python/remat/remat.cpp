@@ -21,6 +21,9 @@ limitations under the License.
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/eager/tensor_storage.h"
+#include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/common/blocking_then_busy.h"
+#include "oneflow/core/vm/virtual_machine.h"
 
 namespace py = pybind11;
 
@@ -62,6 +65,25 @@ ONEFLOW_API_PYBIND11_MODULE("remat", m) {
     JUST(rematable_storage(t))->Evict(false);
     return Maybe<void>::Ok();
   });
+  // spills on the stream of the tensor after the instructions writing it, and waits for it
+  m.def("spill", [](const std::shared_ptr<one::Tensor>& t) -> Maybe<void> {
+    auto storage = JUST(rematable_storage(t));
+    auto local_tensor = JUST(t->AsLocalTensor());
+    auto result = std::make_shared<Maybe<void>>(Maybe<void>::Ok());
+    const auto& Callback = [storage, result](ep::Stream*,
+                                             const std::shared_ptr<vm::EagerBlobObject>&) {
+      *result = storage->Spill();
+    };
+    auto btb = std::make_shared<BlockingThenBusy>();
+    JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+      return builder->SyncAccessBlobByCallback(local_tensor, btb, Callback, "const");
+    }));
+    JUST(btb->WaitUntilCntEqualZero(VirtualMachine::GetPredicatorNoMoreInstructionsFinished()));
+    return *result;
+  });
+  m.def("is_spilled", [](const std::shared_ptr<one::Tensor>& t) -> Maybe<bool> {
+    return JUST(rematable_storage(t))->is_spilled();
+  });
   m.def("is_evictable", [](const std::shared_ptr<one::Tensor>& t) -> Maybe<bool> {
     return JUST(rematable_storage(t))->is_evictable();
   });
@@ -78,6 +100,19 @@ ONEFLOW_API_PYBIND11_MODULE("remat", m) {
         []() { return Singleton<remat::Env>::Get()->forced_eviction_num(); });
   m.def("eager_eviction_num", []() { return Singleton<remat::Env>::Get()->eager_eviction_num(); });
   m.def("recomputation_num", []() { return Singleton<remat::Env>::Get()->recomputation_num(); });
+  m.def("spill_num", []() { return Singleton<remat::Env>::Get()->spill_num(); });
+  m.def("restore_num", []() { return Singleton<remat::Env>::Get()->restore_num(); });
+  m.def("set_spill_enabled",
+        [](bool enabled) { Singleton<remat::Env>::Get()->set_spill_enabled(enabled); });
+  m.def("is_spill_enabled", []() { return Singleton<remat::Env>::Get()->is_spill_enabled(); });
+  m.def("set_spill_compression",
+        [](bool enabled) { Singleton<remat::Env>::Get()->set_spill_compression(enabled); });
+  m.def("set_spill_dir",
+        [](const std::string& dir) { Singleton<remat::Env>::Get()->set_spill_dir(dir); });
+  m.def("set_spill_bandwidth", [](double bytes_per_second) {
+    Singleton<remat::Env>::Get()->set_spill_bandwidth(bytes_per_second);
+  });
+  m.def("spill_bandwidth", []() { return Singleton<remat::Env>::Get()->spill_bandwidth(); });
   m.def("set_budget_in_bytes", [](size_t budget_in_bytes) {
     Singleton<remat::Env>::Get()->set_budget_in_bytes(budget_in_bytes);
   });
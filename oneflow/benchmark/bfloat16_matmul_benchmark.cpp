@@ -0,0 +1,136 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Compares the throughput of the CPU matmul in bfloat16, as run by the auto mixed precision, with
+// the one in float32, over the square matmuls of training and the few rows of inference. Every
+// result is printed as a line of json, with the speedup of bfloat16 over float32. Set
+// ONEFLOW_ENABLE_ONEDNN_OPTS to compare the onednn path instead of the cblas one.
+//
+// Usage: oneflow_bfloat16_matmul_benchmark [--iters=N] [--warmup=N] [--max_size=N]
+//                                          [--output=PATH]
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include "oneflow/api/cpp/env.h"
+#include "oneflow/core/common/bfloat16.h"
+#include "oneflow/core/common/singleton.h"
+#include "oneflow/core/ep/common/onednn.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/include/primitive/broadcast_matmul.h"
+
+namespace oneflow {
+
+namespace {
+
+struct BenchmarkOptions {
+  int64_t iters = 3;
+  int64_t warmup = 1;
+  int64_t max_size = 256;
+  std::string output;
+};
+
+template<typename T>
+double TimeMatmul(const BenchmarkOptions& options, ep::Stream* stream, DataType data_type,
+                  int64_t m, int64_t n, int64_t k) {
+  std::unique_ptr<ep::primitive::BroadcastMatmul> matmul =
+      ep::primitive::NewPrimitive<ep::primitive::BroadcastMatmulFactory>(
+          DeviceType::kCPU, data_type, ep::primitive::BlasTransposeType::N,
+          ep::primitive::BlasTransposeType::N, 2);
+  CHECK(matmul) << "no cpu matmul for " << DataType_Name(data_type);
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-1, 1);
+  std::vector<T> a(m * k);
+  std::vector<T> b(k * n);
+  std::vector<T> c(m * n);
+  for (auto& value : a) { value = static_cast<T>(dist(gen)); }
+  for (auto& value : b) { value = static_cast<T>(dist(gen)); }
+  const int64_t a_dims[] = {m, k};
+  const int64_t b_dims[] = {k, n};
+  const int64_t c_dims[] = {m, n};
+  auto Run = [&]() {
+    matmul->Launch(stream, 1, 2, a_dims, a.data(), 2, b_dims, b.data(), 0, 2, c_dims, c.data());
+  };
+  for (int64_t i = 0; i < options.warmup; ++i) { Run(); }
+  CHECK_JUST(stream->Sync());
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < options.iters; ++i) { Run(); }
+  CHECK_JUST(stream->Sync());
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / options.iters;
+}
+
+void RunBenchmarks(const BenchmarkOptions& options, std::ostream* out) {
+  auto device = Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
+  ep::Stream* stream = device->CreateStream();
+  for (int64_t size = 64; size <= options.max_size; size *= 2) {
+    for (int64_t m : {size, int64_t{16}}) {
+      const int64_t n = size;
+      const int64_t k = size;
+      const double float_ms = TimeMatmul<float>(options, stream, DataType::kFloat, m, n, k);
+      const double bfloat16_ms =
+          TimeMatmul<bfloat16>(options, stream, DataType::kBFloat16, m, n, k);
+      const double gflop = 2.0 * m * n * k / 1e9;
+      *out << "{\"m\": " << m << ", \"n\": " << n << ", \"k\": " << k
+           << ", \"onednn\": " << (ep::primitive::OneDnnIsEnabled() ? "true" : "false")
+           << ", \"float_ms\": " << float_ms << ", \"bfloat16_ms\": " << bfloat16_ms
+           << ", \"float_gflops\": " << gflop / (float_ms / 1e3)
+           << ", \"bfloat16_gflops\": " << gflop / (bfloat16_ms / 1e3)
+           << ", \"speedup\": " << float_ms / bfloat16_ms << "}" << std::endl;
+    }
+  }
+  device->DestroyStream(stream);
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--iters=", 0) == 0) {
+      options.iters = std::stoll(arg.substr(std::strlen("--iters=")));
+    } else if (arg.rfind("--warmup=", 0) == 0) {
+      options.warmup = std::stoll(arg.substr(std::strlen("--warmup=")));
+    } else if (arg.rfind("--max_size=", 0) == 0) {
+      options.max_size = std::stoll(arg.substr(std::strlen("--max_size=")));
+    } else if (arg.rfind("--output=", 0) == 0) {
+      options.output = arg.substr(std::strlen("--output="));
+    } else {
+      LOG(FATAL) << "unknown argument " << arg;
+    }
+  }
+  CHECK_GT(options.iters, 0);
+  CHECK_GE(options.warmup, 0);
+  CHECK_GE(options.max_size, 64);
+  return options;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main(int argc, char** argv) {
+  const oneflow::BenchmarkOptions options = oneflow::ParseOptions(argc, argv);
+  oneflow_api::initialize();
+  if (options.output.empty()) {
+    oneflow::RunBenchmarks(options, &std::cout);
+  } else {
+    std::ofstream out(options.output);
+    CHECK(out.is_open()) << "can not open " << options.output;
+    oneflow::RunBenchmarks(options, &out);
+  }
+  oneflow_api::release();
+  return 0;
+}
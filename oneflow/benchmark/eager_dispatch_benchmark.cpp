@@ -0,0 +1,254 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Measures the per-op overhead of the eager path layer by layer on trivial CPU ops: the
+// functional api, OpInterpUtil::Dispatch, the eager local interpreter, the instructions builder,
+// the vm scheduling and the bare kernel. Every result is printed as a line of json.
+//
+// Usage: oneflow_eager_dispatch_benchmark [--iters=N] [--warmup=N] [--output=PATH]
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "oneflow/api/cpp/env.h"
+#include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/singleton.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/include/primitive/add.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/dtype.h"
+#include "oneflow/core/framework/eager_op_trace.h"
+#include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/op_builder.h"
+#include "oneflow/core/framework/op_interpreter.h"
+#include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
+#include "oneflow/core/framework/stream.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/vm/vm_util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct BenchmarkOptions {
+  int64_t iters = 1000;
+  int64_t warmup = 100;
+  std::string output;
+};
+
+struct BenchmarkCase {
+  std::string layer;
+  bool is_global;
+  bool inplace;
+  bool autograd;
+};
+
+class BenchmarkReporter final {
+ public:
+  BenchmarkReporter(const BenchmarkOptions& options, std::ostream* out)
+      : options_(options), out_(out) {}
+
+  void Report(const BenchmarkCase& benchmark_case, double ns_per_op) {
+    *out_ << "{\"layer\": \"" << benchmark_case.layer << "\", \"tensor\": \""
+          << (benchmark_case.is_global ? "global" : "local")
+          << "\", \"inplace\": " << (benchmark_case.inplace ? "true" : "false")
+          << ", \"autograd\": " << (benchmark_case.autograd ? "true" : "false")
+          << ", \"iters\": " << options_.iters << ", \"ns_per_op\": " << ns_per_op << "}"
+          << std::endl;
+  }
+
+ private:
+  const BenchmarkOptions& options_;
+  std::ostream* out_;
+};
+
+// Runs Op for the warmup and then the timed iterations, and waits for all the work they issued
+// before taking the time, so the asynchronous layers are charged for their whole cost
+Maybe<double> TimeOp(const BenchmarkOptions& options, const std::function<Maybe<void>()>& Op,
+                     const std::function<Maybe<void>()>& Sync) {
+  for (int64_t i = 0; i < options.warmup; ++i) { JUST(Op()); }
+  JUST(Sync());
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < options.iters; ++i) { JUST(Op()); }
+  JUST(Sync());
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / options.iters;
+}
+
+Maybe<double> TimeOp(const BenchmarkOptions& options, const std::function<Maybe<void>()>& Op) {
+  return TimeOp(options, Op, []() { return vm::CurrentRankSync(); });
+}
+
+Maybe<one::Tensor> MakeTensor(Symbol<Device> device, bool is_global, bool requires_grad) {
+  const Shape shape({1});
+  std::shared_ptr<one::Tensor> tensor;
+  if (is_global) {
+    const auto& placement = JUST(Placement4Device(device));
+    tensor = JUST(functional::GlobalConstant(shape, 1, DType::Float(), placement,
+                                             {JUST(MakeBroadcastSbpParallel())}));
+  } else {
+    tensor = JUST(functional::Constant(shape, 1, DType::Float(), device));
+  }
+  JUST(tensor->set_requires_grad(requires_grad));
+  return tensor;
+}
+
+// The layers above the interpreter, which also cover global tensors and autograd
+Maybe<void> BenchmarkFrontend(const BenchmarkOptions& options, BenchmarkReporter* reporter,
+                              Symbol<Device> device, const one::UserOpExpr& add_n) {
+  for (bool is_global : {false, true}) {
+    for (bool inplace : {false, true}) {
+      for (bool autograd : {false, true}) {
+        // An in-place op on tensors requiring grad extends one autograd chain through all the
+        // iterations, which measures the graph instead of the dispatch
+        if (inplace && autograd) { continue; }
+        autograd::AutoGradMode mode(autograd);
+        const auto& x = JUST(MakeTensor(device, is_global, autograd));
+        const auto& y = JUST(MakeTensor(device, is_global, autograd));
+        const double functional_ns = JUST(TimeOp(options, [&]() -> Maybe<void> {
+          JUST(functional::Add(x, y, /*alpha=*/1, inplace));
+          return Maybe<void>::Ok();
+        }));
+        reporter->Report(BenchmarkCase{"functional", is_global, inplace, autograd}, functional_ns);
+        const one::TensorTuple inputs{x, y};
+        const double dispatch_ns = JUST(TimeOp(options, [&]() -> Maybe<void> {
+          one::TensorTuple outputs(1);
+          if (inplace) { outputs.at(0) = x; }
+          return one::OpInterpUtil::Dispatch(add_n, inputs, &outputs, AttrMap{});
+        }));
+        reporter->Report(BenchmarkCase{"dispatch", is_global, inplace, autograd}, dispatch_ns);
+      }
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+// The layers below autograd, on local tensors only
+Maybe<void> BenchmarkBackend(const BenchmarkOptions& options, BenchmarkReporter* reporter,
+                             Symbol<Device> device, const one::UserOpExpr& add_n) {
+  autograd::NoGradGuard no_grad;
+  const auto& x = JUST(MakeTensor(device, /*is_global=*/false, /*requires_grad=*/false));
+  const auto& y = JUST(MakeTensor(device, /*is_global=*/false, /*requires_grad=*/false));
+  const auto& out = JUST(MakeTensor(device, /*is_global=*/false, /*requires_grad=*/false));
+  const one::TensorTuple inputs{x, y};
+  const one::OpExprInterpContext ctx{AttrMap{}};
+  const one::EagerLocalInterpreter interpreter;
+  const auto& stream = JUST(GetDefaultStreamByDevice(device));
+  const auto& kernel = JUST(add_n.MutKernel4Stream(stream));
+  for (bool inplace : {false, true}) {
+    const double interpreter_ns = JUST(TimeOp(options, [&]() -> Maybe<void> {
+      one::TensorTuple outputs(1);
+      if (inplace) { outputs.at(0) = x; }
+      return interpreter.Apply(add_n, inputs, &outputs, ctx);
+    }));
+    reporter->Report(BenchmarkCase{"interpreter", false, inplace, false}, interpreter_ns);
+
+    // The kernel is chosen once, so only the instruction is built and scheduled per op
+    const auto& out_eager_blob_object = JUST((inplace ? x : out)->eager_blob_object());
+    const auto& x_eager_blob_object = JUST(x->eager_blob_object());
+    const auto& y_eager_blob_object = JUST(y->eager_blob_object());
+    const double instructions_builder_ns = JUST(TimeOp(options, [&]() -> Maybe<void> {
+      return PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+        return builder->Call(kernel,
+                             vm::EagerBlobObjectList{x_eager_blob_object, y_eager_blob_object},
+                             vm::EagerBlobObjectList{out_eager_blob_object}, ctx, stream);
+      });
+    }));
+    reporter->Report(BenchmarkCase{"instructions_builder", false, inplace, false},
+                     instructions_builder_ns);
+
+    // A replayed trace issues the instruction built at capture, which leaves the vm scheduling
+    one::EagerOpTrace trace;
+    JUST(trace.BeginCapture());
+    JUST(functional::Add(x, y, /*alpha=*/1, inplace));
+    JUST(trace.EndCapture());
+    const double vm_ns = JUST(TimeOp(options, [&]() { return trace.Replay(); }));
+    reporter->Report(BenchmarkCase{"vm", false, inplace, false}, vm_ns);
+  }
+
+  // The bare kernel on a stream of its own, as the floor of all the layers above
+  auto ep_device = Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
+  ep::Stream* ep_stream = ep_device->CreateStream();
+  std::unique_ptr<ep::primitive::Add> primitive =
+      ep::primitive::NewPrimitive<ep::primitive::AddFactory>(DeviceType::kCPU, DataType::kFloat);
+  CHECK_OR_RETURN(primitive) << "no cpu add primitive for float";
+  float x_value = 1;
+  float y_value = 1;
+  float out_value = 0;
+  for (bool inplace : {false, true}) {
+    float* dst = inplace ? &x_value : &out_value;
+    const double kernel_ns = JUST(TimeOp(
+        options,
+        [&]() -> Maybe<void> {
+          primitive->Launch(ep_stream, &x_value, &y_value, dst, 1);
+          return Maybe<void>::Ok();
+        },
+        [&]() { return ep_stream->Sync(); }));
+    reporter->Report(BenchmarkCase{"kernel", false, inplace, false}, kernel_ns);
+  }
+  ep_device->DestroyStream(ep_stream);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> RunBenchmarks(const BenchmarkOptions& options, std::ostream* out) {
+  BenchmarkReporter reporter(options, out);
+  const auto& device = JUST(Device::New("cpu"));
+  const auto& add_n = JUST(one::OpBuilder("add_n").Input("in", 2).Output("out").Build());
+  JUST(BenchmarkFrontend(options, &reporter, device, *add_n));
+  JUST(BenchmarkBackend(options, &reporter, device, *add_n));
+  return vm::CurrentRankSync();
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--iters=", 0) == 0) {
+      options.iters = std::stoll(arg.substr(std::strlen("--iters=")));
+    } else if (arg.rfind("--warmup=", 0) == 0) {
+      options.warmup = std::stoll(arg.substr(std::strlen("--warmup=")));
+    } else if (arg.rfind("--output=", 0) == 0) {
+      options.output = arg.substr(std::strlen("--output="));
+    } else {
+      LOG(FATAL) << "unknown argument " << arg;
+    }
+  }
+  CHECK_GT(options.iters, 0);
+  CHECK_GE(options.warmup, 0);
+  return options;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main(int argc, char** argv) {
+  const oneflow::BenchmarkOptions options = oneflow::ParseOptions(argc, argv);
+  oneflow_api::initialize();
+  if (options.output.empty()) {
+    CHECK_JUST(oneflow::RunBenchmarks(options, &std::cout));
+  } else {
+    std::ofstream out(options.output);
+    CHECK(out.is_open()) << "can not open " << options.output;
+    CHECK_JUST(oneflow::RunBenchmarks(options, &out));
+  }
+  oneflow_api::release();
+  return 0;
+}
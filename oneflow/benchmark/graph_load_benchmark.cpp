@@ -0,0 +1,194 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Measures the time the C++ API takes to load a graph with an affine model and run its first
+// forward, which is when the variables are read. With --cold, the pages of the variable files
+// are dropped from the page cache before every load. Every result is printed as a line of json.
+//
+// Usage: oneflow_graph_load_benchmark [--iters=N] [--in_features=N] [--out_features=N] [--cold]
+//                                     [--output=PATH]
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <glog/logging.h>
+#include "oneflow/api/cpp/api.h"
+
+namespace oneflow_api {
+
+namespace {
+
+struct BenchmarkOptions {
+  int64_t iters = 3;
+  int64_t in_features = 1024;
+  int64_t out_features = 4096;
+  bool cold = false;
+  std::string output;
+};
+
+std::string VariableFilename(const std::string& dirname, const std::string& name) {
+  return dirname + "/" + name + "/out";
+}
+
+// Writes y = x * a + b, a [in_features, out_features] weight a and a bias b filled by ones
+void GenerateAffineModel(const std::string& dirname, int64_t in_features, int64_t out_features) {
+  const std::string in_str = std::to_string(in_features);
+  const std::string out_str = std::to_string(out_features);
+  const std::string device_attrs =
+      R"(device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], )";
+  std::stringstream mlir;
+  mlir << "module  {\n"
+       << "  oneflow.job @LoadBenchmark_0(%arg0: tensor<1x" << in_str << "xf32>) -> tensor<1x"
+       << out_str << "xf32> {\n"
+       << "    %output = \"oneflow.input\"(%arg0) {data_type = 2 : i32, " << device_attrs
+       << R"(is_dynamic = false, nd_sbp = ["B"], op_name = "_LoadBenchmark_0-input_0", )"
+       << R"(output_lbns = ["_LoadBenchmark_0-input_0/out"], )"
+       << "scope_symbol_id = 4611686018427469823 : i64, shape = [1 : si64, " << in_str
+       << " : si64]} : (tensor<1x" << in_str << "xf32>) -> tensor<1x" << in_str << "xf32>\n"
+       << "    %output_0 = \"oneflow.variable\"() {data_type = 2 : i32, " << device_attrs
+       << R"(parallel = #sbp.parallel<[] -> [#sbp.B]>, op_name = "model.a", )"
+       << R"(output_lbns = ["model.a/out"], scope_symbol_id = 4611686018427482111 : i64, )"
+       << "shape = [" << in_str << " : si64, " << out_str << " : si64]} : () -> tensor<" << in_str
+       << "x" << out_str << "xf32>\n"
+       << "    %output_1 = \"oneflow.variable\"() {data_type = 2 : i32, " << device_attrs
+       << R"(parallel = #sbp.parallel<[] -> [#sbp.B]>, op_name = "model.b", )"
+       << R"(output_lbns = ["model.b/out"], scope_symbol_id = 4611686018427494399 : i64, )"
+       << "shape = [" << out_str << " : si64]} : () -> tensor<" << out_str << "xf32>\n"
+       << "    %0 = \"oneflow.matmul\"(%output, %output_0) {alpha = 1.000000e+00 : f64, "
+       << device_attrs
+       << R"(op_name = "model-matmul_0", output_lbns = ["model-matmul_0/out_0"], )"
+       << "scope_symbol_id = 4611686018427486207 : i64, transpose_a = false, transpose_b = false} "
+       << ": (tensor<1x" << in_str << "xf32>, tensor<" << in_str << "x" << out_str
+       << "xf32>) -> tensor<1x" << out_str << "xf32>\n"
+       << "    %1 = \"oneflow.broadcast_add\"(%0, %output_1) {" << device_attrs
+       << R"(op_name = "model-broadcast_add_1", output_lbns = ["model-broadcast_add_1/z_0"], )"
+       << "scope_symbol_id = 4611686018427486207 : i64} : (tensor<1x" << out_str
+       << "xf32>, tensor<" << out_str << "xf32>) -> tensor<1x" << out_str << "xf32>\n"
+       << "    %output_2 = \"oneflow.output\"(%1) {data_type = 2 : i32, " << device_attrs
+       << R"(is_dynamic = false, nd_sbp = ["B"], op_name = "_LoadBenchmark_0-output_0", )"
+       << R"(output_lbns = ["_LoadBenchmark_0-output_0/out"], )"
+       << "scope_symbol_id = 4611686018427469823 : i64, shape = [1 : si64, " << out_str
+       << " : si64]} : (tensor<1x" << out_str << "xf32>) -> tensor<1x" << out_str << "xf32>\n"
+       << "    oneflow.return %output_2 : tensor<1x" << out_str << "xf32>\n"
+       << "  }\n"
+       << "}\n";
+  std::ofstream(dirname + "/model.mlir") << mlir.str();
+  const auto& WriteVariable = [&](const std::string& name, int64_t elem_cnt) {
+    mkdir((dirname + "/" + name).c_str(), 0755);
+    const std::vector<float> data(elem_cnt, 1);
+    std::ofstream out(VariableFilename(dirname, name), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), elem_cnt * sizeof(float));
+  };
+  WriteVariable("model.a", in_features * out_features);
+  WriteVariable("model.b", out_features);
+}
+
+void RemoveAffineModel(const std::string& dirname) {
+  for (const std::string name : {"model.a", "model.b"}) {
+    std::remove(VariableFilename(dirname, name).c_str());
+    rmdir((dirname + "/" + name).c_str());
+  }
+  std::remove((dirname + "/model.mlir").c_str());
+  rmdir(dirname.c_str());
+}
+
+// Asks the kernel to drop the clean pages of the file, which the load then reads from disk
+void DropPageCache(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  PCHECK(fd != -1) << filename;
+  PCHECK(fdatasync(fd) == 0) << filename;
+  CHECK_EQ(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED), 0) << filename;
+  PCHECK(close(fd) == 0) << filename;
+}
+
+void RunBenchmarks(const BenchmarkOptions& options, std::ostream* out) {
+  char dirname[] = "/tmp/graph_load_benchmark_XXXXXX";
+  PCHECK(mkdtemp(dirname) != nullptr);
+  GenerateAffineModel(dirname, options.in_features, options.out_features);
+  const double variable_mb = (options.in_features + 1) * options.out_features * sizeof(float)
+                             / (1024.0 * 1024.0);
+  Device device("cpu");
+  std::vector<float> x(options.in_features, 1);
+  for (int64_t iter = 0; iter < options.iters; ++iter) {
+    if (options.cold) {
+      for (const std::string name : {"model.a", "model.b"}) {
+        DropPageCache(VariableFilename(dirname, name));
+      }
+    }
+    const auto start = std::chrono::steady_clock::now();
+    Graph graph = Graph::Load(dirname, device);
+    std::vector<Tensor> inputs;
+    inputs.emplace_back(
+        Tensor::from_buffer(x.data(), Shape({1, options.in_features}), device, DType::kFloat));
+    Tensor output = graph.Forward(inputs).ToTensor();
+    std::vector<float> y(options.out_features);
+    output.copy_to(y.data());
+    const auto end = std::chrono::steady_clock::now();
+    for (const float value : y) { CHECK_EQ(value, options.in_features + 1); }
+    *out << "{\"variable_mb\": " << variable_mb << ", \"cold\": "
+         << (options.cold ? "true" : "false") << ", \"iter\": " << iter
+         << ", \"load_and_first_forward_ms\": "
+         << std::chrono::duration<double, std::milli>(end - start).count() << "}" << std::endl;
+  }
+  RemoveAffineModel(dirname);
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--iters=", 0) == 0) {
+      options.iters = std::stoll(arg.substr(std::strlen("--iters=")));
+    } else if (arg.rfind("--in_features=", 0) == 0) {
+      options.in_features = std::stoll(arg.substr(std::strlen("--in_features=")));
+    } else if (arg.rfind("--out_features=", 0) == 0) {
+      options.out_features = std::stoll(arg.substr(std::strlen("--out_features=")));
+    } else if (arg == "--cold") {
+      options.cold = true;
+    } else if (arg.rfind("--output=", 0) == 0) {
+      options.output = arg.substr(std::strlen("--output="));
+    } else {
+      LOG(FATAL) << "unknown argument " << arg;
+    }
+  }
+  CHECK_GT(options.iters, 0);
+  CHECK_GT(options.in_features, 0);
+  CHECK_GT(options.out_features, 0);
+  return options;
+}
+
+}  // namespace
+
+}  // namespace oneflow_api
+
+int main(int argc, char** argv) {
+  const oneflow_api::BenchmarkOptions options = oneflow_api::ParseOptions(argc, argv);
+  oneflow_api::initialize();
+  if (options.output.empty()) {
+    oneflow_api::RunBenchmarks(options, &std::cout);
+  } else {
+    std::ofstream out(options.output);
+    CHECK(out.is_open()) << "can not open " << options.output;
+    oneflow_api::RunBenchmarks(options, &out);
+  }
+  oneflow_api::release();
+  return 0;
+}
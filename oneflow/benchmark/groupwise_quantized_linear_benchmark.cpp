@@ -0,0 +1,137 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Compares the CPU linear with groupwise quantized weights, fused in one kernel, with the
+// dequantization of the weights followed by a float matmul, over int8 and int4 weights grouped
+// along k or n. Every result is printed as a line of json, with the speedup of the fused kernel.
+//
+// Usage: oneflow_groupwise_quantized_linear_benchmark [--iters=N] [--warmup=N] [--size=N]
+//                                                     [--group_size=N] [--output=PATH]
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "oneflow/api/cpp/env.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/dtype.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/vm/vm_util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct BenchmarkOptions {
+  int64_t iters = 3;
+  int64_t warmup = 1;
+  // n and k of the weights
+  int64_t size = 1024;
+  int64_t group_size = 128;
+  std::string output;
+};
+
+Maybe<double> TimeOp(const BenchmarkOptions& options, const std::function<Maybe<void>()>& Op) {
+  for (int64_t i = 0; i < options.warmup; ++i) { JUST(Op()); }
+  JUST(vm::CurrentRankSync());
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < options.iters; ++i) { JUST(Op()); }
+  JUST(vm::CurrentRankSync());
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / options.iters;
+}
+
+Maybe<void> RunBenchmarks(const BenchmarkOptions& options, std::ostream* out) {
+  const auto& device = JUST(Device::New("cpu"));
+  const int64_t n = options.size;
+  const int64_t k = options.size;
+  for (int32_t num_bits : {8, 4}) {
+    for (int64_t group_dim : {1, 0}) {
+      const auto& w = JUST(functional::Constant(Shape({n, k * num_bits / 8}), 3, DType::Int8(),
+                                                device));
+      const Shape scale_shape = group_dim == 1 ? Shape({n, k / options.group_size})
+                                               : Shape({n / options.group_size, k});
+      const auto& w_scale = JUST(functional::Constant(scale_shape, 0.01, DType::Float(), device));
+      for (int64_t m : {1, 4, 32}) {
+        const auto& x = JUST(functional::Constant(Shape({m, k}), 0.5, DType::Float(), device));
+        const double fused_ms = JUST(TimeOp(options, [&]() -> Maybe<void> {
+          JUST(functional::FusedLinearWithGroupwiseQuantizedWeight(
+              x, w, w_scale, NullOpt, NullOpt, num_bits, /*symmetric=*/true, group_dim,
+              options.group_size));
+          return Maybe<void>::Ok();
+        }));
+        const double unfused_ms = JUST(TimeOp(options, [&]() -> Maybe<void> {
+          const auto& dequantized =
+              JUST(functional::GroupwiseDequantize(w, w_scale, NullOpt, num_bits,
+                                                   /*symmetric=*/true, group_dim,
+                                                   options.group_size));
+          JUST(functional::MatMul(x, dequantized, /*transpose_a=*/false, /*transpose_b=*/true,
+                                  1.0));
+          return Maybe<void>::Ok();
+        }));
+        *out << "{\"num_bits\": " << num_bits << ", \"group_dim\": " << group_dim
+             << ", \"group_size\": " << options.group_size << ", \"m\": " << m << ", \"n\": " << n
+             << ", \"k\": " << k << ", \"fused_ms\": " << fused_ms
+             << ", \"dequantize_matmul_ms\": " << unfused_ms
+             << ", \"speedup\": " << unfused_ms / fused_ms << "}" << std::endl;
+      }
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--iters=", 0) == 0) {
+      options.iters = std::stoll(arg.substr(std::strlen("--iters=")));
+    } else if (arg.rfind("--warmup=", 0) == 0) {
+      options.warmup = std::stoll(arg.substr(std::strlen("--warmup=")));
+    } else if (arg.rfind("--size=", 0) == 0) {
+      options.size = std::stoll(arg.substr(std::strlen("--size=")));
+    } else if (arg.rfind("--group_size=", 0) == 0) {
+      options.group_size = std::stoll(arg.substr(std::strlen("--group_size=")));
+    } else if (arg.rfind("--output=", 0) == 0) {
+      options.output = arg.substr(std::strlen("--output="));
+    } else {
+      LOG(FATAL) << "unknown argument " << arg;
+    }
+  }
+  CHECK_GT(options.iters, 0);
+  CHECK_GE(options.warmup, 0);
+  CHECK_GT(options.group_size, 0);
+  CHECK_EQ(options.size % options.group_size, 0);
+  return options;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main(int argc, char** argv) {
+  const oneflow::BenchmarkOptions options = oneflow::ParseOptions(argc, argv);
+  oneflow_api::initialize();
+  if (options.output.empty()) {
+    CHECK_JUST(oneflow::RunBenchmarks(options, &std::cout));
+  } else {
+    std::ofstream out(options.output);
+    CHECK(out.is_open()) << "can not open " << options.output;
+    CHECK_JUST(oneflow::RunBenchmarks(options, &out));
+  }
+  oneflow_api::release();
+  return 0;
+}
@@ -0,0 +1,198 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Compares the throughput of the raw batch readers on a file read in a random order of blocks:
+// pread with one and several workers, io_uring, and io_uring with O_DIRECT. The file is dropped
+// from the page cache before every run. Every result is printed as a line of json, with its
+// speedup over pread with one worker.
+//
+// Usage: oneflow_raw_batch_reader_benchmark [--total_mb=N] [--block_kb=N] [--blocks_per_request=N]
+//                                           [--queue_depth=N] [--dir=PATH] [--output=PATH]
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include "oneflow/user/data/raw_batch_reader.h"
+
+namespace oneflow {
+
+namespace {
+
+struct BenchmarkOptions {
+  int64_t total_mb = 32;
+  int64_t block_kb = 64;
+  int64_t blocks_per_request = 16;
+  int64_t queue_depth = 8;
+  std::string dir;
+  std::string output;
+};
+
+using ReaderFactory = std::function<std::unique_ptr<data::RawBatchReader>(
+    std::vector<std::unique_ptr<embedding::PosixFile>>&&, std::vector<data::RawBlock>&&)>;
+
+std::string CreateFile(const BenchmarkOptions& options) {
+  std::string dir = options.dir;
+  if (dir.empty()) {
+    const char* tmpdir = std::getenv("TMPDIR");
+    dir = tmpdir == nullptr ? "/tmp" : tmpdir;
+  }
+  std::string filename = dir + "/oneflow_raw_batch_reader_benchmark_XXXXXX";
+  const int fd = mkstemp(&filename[0]);
+  PCHECK(fd != -1) << filename;
+  std::vector<char> chunk(1024 * 1024);
+  std::mt19937 gen(0);
+  for (auto& c : chunk) { c = static_cast<char>(gen()); }
+  for (int64_t i = 0; i < options.total_mb; ++i) {
+    PCHECK(write(fd, chunk.data(), chunk.size()) == static_cast<ssize_t>(chunk.size()));
+  }
+  PCHECK(fsync(fd) == 0);
+  PCHECK(close(fd) == 0);
+  return filename;
+}
+
+// Return 0 if the file system does not support the flags
+double TimeRead(const BenchmarkOptions& options, const std::string& filename, int flags,
+                const ReaderFactory& factory) {
+  const int fd = open(filename.c_str(), flags);
+  if (fd == -1) { return 0; }
+  PCHECK(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+  PCHECK(close(fd) == 0);
+  std::vector<std::unique_ptr<embedding::PosixFile>> files;
+  files.emplace_back(new embedding::PosixFile(filename, flags, 0644));
+  const size_t block_size_bytes = options.block_kb * 1024;
+  const size_t num_blocks = options.total_mb * 1024 / options.block_kb;
+  auto blocks = data::MakeRawBlocks(files, num_blocks, block_size_bytes);
+  std::vector<size_t> order(num_blocks);
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937_64 generator(0);
+  std::shuffle(order.begin(), order.end(), generator);
+  auto reader = factory(std::move(files), std::move(blocks));
+  const size_t num_requests = num_blocks / options.blocks_per_request;
+  const size_t request_bytes = RoundUp(block_size_bytes * options.blocks_per_request, 4096);
+  const auto start = std::chrono::steady_clock::now();
+  size_t next_request = 0;
+  const auto& Submit = [&](data::RawBatchRequest&& request) {
+    auto begin = order.begin() + next_request * options.blocks_per_request;
+    request.blocks->assign(begin, begin + options.blocks_per_request);
+    next_request += 1;
+    reader->SubmitRequest(std::move(request));
+  };
+  for (size_t i = 0; i < std::min<size_t>(options.queue_depth, num_requests); ++i) {
+    data::RawBatchRequest request;
+    request.blocks = std::make_shared<std::vector<size_t>>();
+    request.buffer = aligned_alloc(4096, request_bytes);  // NOLINT
+    Submit(std::move(request));
+  }
+  for (size_t i = 0; i < num_requests; ++i) {
+    data::RawBatchRequest request;
+    reader->WaitCompleted(&request);
+    if (next_request < num_requests) {
+      Submit(std::move(request));
+    } else {
+      free(request.buffer);  // NOLINT
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const double bytes = num_requests * options.blocks_per_request * block_size_bytes;
+  return bytes / (1024 * 1024) / std::chrono::duration<double>(end - start).count();
+}
+
+void RunBenchmarks(const BenchmarkOptions& options, std::ostream* out) {
+  const std::string filename = CreateFile(options);
+  const size_t block_size_bytes = options.block_kb * 1024;
+  double one_worker_mb_per_s = 0;
+  const auto& Report = [&](const std::string& reader, double mb_per_s) {
+    if (mb_per_s == 0) { return; }
+    *out << "{\"reader\": \"" << reader << "\", \"total_mb\": " << options.total_mb
+         << ", \"block_kb\": " << options.block_kb
+         << ", \"blocks_per_request\": " << options.blocks_per_request
+         << ", \"queue_depth\": " << options.queue_depth << ", \"mb_per_s\": " << mb_per_s
+         << ", \"speedup\": " << mb_per_s / one_worker_mb_per_s << "}" << std::endl;
+  };
+  for (size_t num_workers : {1, 4}) {
+    const double mb_per_s = TimeRead(
+        options, filename, O_RDONLY,
+        [&](std::vector<std::unique_ptr<embedding::PosixFile>>&& files,
+            std::vector<data::RawBlock>&& blocks) {
+          return data::NewPreadRawBatchReader(std::move(files), std::move(blocks),
+                                              block_size_bytes, num_workers);
+        });
+    if (num_workers == 1) { one_worker_mb_per_s = mb_per_s; }
+    Report("pread_" + std::to_string(num_workers) + "_workers", mb_per_s);
+  }
+  if (data::IsIoUringAvailable()) {
+    for (bool direct_io : {false, true}) {
+      const double mb_per_s = TimeRead(
+          options, filename, direct_io ? O_RDONLY | O_DIRECT : O_RDONLY,
+          [&](std::vector<std::unique_ptr<embedding::PosixFile>>&& files,
+              std::vector<data::RawBlock>&& blocks) {
+            return data::NewIoUringRawBatchReader(std::move(files), std::move(blocks),
+                                                  block_size_bytes, 64, direct_io);
+          });
+      Report(direct_io ? "io_uring_direct" : "io_uring", mb_per_s);
+    }
+  }
+  std::remove(filename.c_str());
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--total_mb=", 0) == 0) {
+      options.total_mb = std::stoll(arg.substr(std::strlen("--total_mb=")));
+    } else if (arg.rfind("--block_kb=", 0) == 0) {
+      options.block_kb = std::stoll(arg.substr(std::strlen("--block_kb=")));
+    } else if (arg.rfind("--blocks_per_request=", 0) == 0) {
+      options.blocks_per_request = std::stoll(arg.substr(std::strlen("--blocks_per_request=")));
+    } else if (arg.rfind("--queue_depth=", 0) == 0) {
+      options.queue_depth = std::stoll(arg.substr(std::strlen("--queue_depth=")));
+    } else if (arg.rfind("--dir=", 0) == 0) {
+      options.dir = arg.substr(std::strlen("--dir="));
+    } else if (arg.rfind("--output=", 0) == 0) {
+      options.output = arg.substr(std::strlen("--output="));
+    } else {
+      LOG(FATAL) << "unknown argument " << arg;
+    }
+  }
+  CHECK_GT(options.total_mb, 0);
+  CHECK_GT(options.block_kb, 0);
+  CHECK_EQ(options.total_mb * 1024 % options.block_kb, 0);
+  CHECK_GT(options.blocks_per_request, 0);
+  CHECK_GT(options.queue_depth, 0);
+  return options;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main(int argc, char** argv) {
+  const oneflow::BenchmarkOptions options = oneflow::ParseOptions(argc, argv);
+  if (options.output.empty()) {
+    oneflow::RunBenchmarks(options, &std::cout);
+  } else {
+    std::ofstream out(options.output);
+    CHECK(out.is_open()) << "can not open " << options.output;
+    oneflow::RunBenchmarks(options, &out);
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Measures how the CPU unique scales with the number of threads, over inputs of different sizes
+// and duplicate ratios, sorted or not and with or without counts. Every result is printed as a
+// line of json, with its speedup over the run with one thread.
+//
+// Usage: oneflow_unique_benchmark [--iters=N] [--warmup=N] [--max_threads=N] [--max_elements=N]
+//                                 [--output=PATH]
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include "oneflow/api/cpp/env.h"
+#include "oneflow/core/common/singleton.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/user/kernels/unique_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct BenchmarkOptions {
+  int64_t iters = 3;
+  int64_t warmup = 1;
+  int64_t max_threads = std::thread::hardware_concurrency();
+  int64_t max_elements = 1 << 18;
+  std::string output;
+};
+
+struct BenchmarkCase {
+  int64_t num_elements;
+  // The number of distinct keys the input is drawn from, as a fraction of its size
+  double distinct_ratio;
+  bool sorted;
+  bool with_counts;
+};
+
+double TimeUnique(const BenchmarkOptions& options, const BenchmarkCase& benchmark_case,
+                  ep::Stream* stream, const std::vector<int64_t>& in) {
+  const int64_t n = in.size();
+  std::vector<int64_t> unique_out(n);
+  std::vector<int32_t> idx_out(n);
+  std::vector<int32_t> count(n);
+  int32_t num_unique = 0;
+  auto Run = [&]() {
+    UniqueKernelUtil<DeviceType::kCPU, int64_t, int32_t>::UniqueWithCounts(
+        stream, n, in.data(), &num_unique, unique_out.data(), idx_out.data(),
+        benchmark_case.with_counts ? count.data() : nullptr, nullptr, 0, benchmark_case.sorted);
+  };
+  for (int64_t i = 0; i < options.warmup; ++i) { Run(); }
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < options.iters; ++i) { Run(); }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / options.iters;
+}
+
+void RunBenchmarks(const BenchmarkOptions& options, std::ostream* out) {
+  auto device = std::static_pointer_cast<ep::CpuDevice>(
+      Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0));
+  const size_t saved_num_threads = device->GetNumThreads();
+  ep::Stream* stream = device->CreateStream();
+  std::mt19937_64 gen(0);
+  for (int64_t num_elements = 1 << 16; num_elements <= options.max_elements; num_elements *= 4) {
+    for (double distinct_ratio : {0.01, 0.25, 1.0}) {
+      const int64_t num_distinct = std::max<int64_t>(1, num_elements * distinct_ratio);
+      std::uniform_int_distribution<int64_t> dist(0, num_distinct - 1);
+      std::vector<int64_t> in(num_elements);
+      // Spread the keys over the whole range, as the hashed ids of an embedding would be
+      for (auto& key : in) { key = static_cast<int64_t>(dist(gen) * 0x9E3779B97F4A7C15ULL); }
+      for (bool sorted : {false, true}) {
+        for (bool with_counts : {false, true}) {
+          const BenchmarkCase benchmark_case{num_elements, distinct_ratio, sorted, with_counts};
+          double one_thread_ms = 0;
+          for (int64_t num_threads = 1; num_threads <= options.max_threads; num_threads *= 2) {
+            device->SetNumThreads(num_threads);
+            const double ms = TimeUnique(options, benchmark_case, stream, in);
+            if (num_threads == 1) { one_thread_ms = ms; }
+            *out << "{\"num_elements\": " << num_elements
+                 << ", \"distinct_ratio\": " << distinct_ratio
+                 << ", \"sorted\": " << (sorted ? "true" : "false")
+                 << ", \"with_counts\": " << (with_counts ? "true" : "false")
+                 << ", \"num_threads\": " << num_threads << ", \"ms\": " << ms
+                 << ", \"speedup\": " << one_thread_ms / ms << "}" << std::endl;
+          }
+        }
+      }
+    }
+  }
+  device->DestroyStream(stream);
+  device->SetNumThreads(saved_num_threads);
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--iters=", 0) == 0) {
+      options.iters = std::stoll(arg.substr(std::strlen("--iters=")));
+    } else if (arg.rfind("--warmup=", 0) == 0) {
+      options.warmup = std::stoll(arg.substr(std::strlen("--warmup=")));
+    } else if (arg.rfind("--max_threads=", 0) == 0) {
+      options.max_threads = std::stoll(arg.substr(std::strlen("--max_threads=")));
+    } else if (arg.rfind("--max_elements=", 0) == 0) {
+      options.max_elements = std::stoll(arg.substr(std::strlen("--max_elements=")));
+    } else if (arg.rfind("--output=", 0) == 0) {
+      options.output = arg.substr(std::strlen("--output="));
+    } else {
+      LOG(FATAL) << "unknown argument " << arg;
+    }
+  }
+  CHECK_GT(options.iters, 0);
+  CHECK_GE(options.warmup, 0);
+  CHECK_GT(options.max_threads, 0);
+  return options;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main(int argc, char** argv) {
+  const oneflow::BenchmarkOptions options = oneflow::ParseOptions(argc, argv);
+  oneflow_api::initialize();
+  if (options.output.empty()) {
+    oneflow::RunBenchmarks(options, &std::cout);
+  } else {
+    std::ofstream out(options.output);
+    CHECK(out.is_open()) << "can not open " << options.output;
+    oneflow::RunBenchmarks(options, &out);
+  }
+  oneflow_api::release();
+  return 0;
+}
@@ -0,0 +1,193 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include "oneflow/core/auto_parallel/cost_database.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/kernel/kernel.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+namespace auto_parallel {
+
+namespace {
+
+// Each line of the database file is
+//   compute <tab> key <tab> total_time_us <tab> count
+// or
+//   transfer <tab> device_type <tab> total_time_us <tab> total_bytes <tab> count
+constexpr const char* kComputeRecord = "compute";
+constexpr const char* kTransferRecord = "transfer";
+
+void AppendBlobToKey(DataType data_type, const std::string& shape_str, std::string* key) {
+  key->append("/");
+  key->append(DataType_Name(data_type));
+  key->append(shape_str);
+}
+
+}  // namespace
+
+void CostDatabase::AddComputeTime(const std::string& key, double time_us) {
+  if (key.empty()) { return; }
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& record = key2compute_record_[key];
+  record.total_time_us += time_us;
+  record.count++;
+}
+
+void CostDatabase::AddTransfer(DeviceType device_type, int64_t bytes, double time_us) {
+  if (bytes <= 0) { return; }
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& record = device_type2transfer_record_[static_cast<int32_t>(device_type)];
+  record.total_time_us += time_us;
+  record.total_bytes += bytes;
+  record.count++;
+}
+
+bool CostDatabase::GetComputeTime(const std::string& key, double* time_us) const {
+  if (key.empty()) { return false; }
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto& it = key2compute_record_.find(key);
+  if (it == key2compute_record_.end() || it->second.count == 0) { return false; }
+  *time_us = it->second.total_time_us / it->second.count;
+  return true;
+}
+
+bool CostDatabase::GetTransferBytesPerUs(DeviceType device_type, double* bytes_per_us) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto& it = device_type2transfer_record_.find(static_cast<int32_t>(device_type));
+  if (it == device_type2transfer_record_.end() || it->second.total_time_us <= 0) { return false; }
+  *bytes_per_us = it->second.total_bytes / it->second.total_time_us;
+  return true;
+}
+
+size_t CostDatabase::size() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return key2compute_record_.size();
+}
+
+Maybe<void> CostDatabase::Load(const std::string& path) {
+  std::ifstream in_stream(path.c_str(), std::ifstream::in);
+  CHECK_OR_RETURN(in_stream.is_open()) << "Can not open cost database " << path;
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::string line;
+  int64_t line_num = 0;
+  while (std::getline(in_stream, line)) {
+    line_num++;
+    if (line.empty()) { continue; }
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, '\t')) { fields.emplace_back(field); }
+    if (fields.at(0) == kComputeRecord) {
+      CHECK_EQ_OR_RETURN(fields.size(), 4) << "Broken record at " << path << ":" << line_num;
+      auto& record = key2compute_record_[fields.at(1)];
+      record.total_time_us += std::stod(fields.at(2));
+      record.count += std::stoll(fields.at(3));
+    } else if (fields.at(0) == kTransferRecord) {
+      CHECK_EQ_OR_RETURN(fields.size(), 5) << "Broken record at " << path << ":" << line_num;
+      auto& record = device_type2transfer_record_[std::stoi(fields.at(1))];
+      record.total_time_us += std::stod(fields.at(2));
+      record.total_bytes += std::stoll(fields.at(3));
+      record.count += std::stoll(fields.at(4));
+    } else {
+      return Error::RuntimeError() << "Unknown record type " << fields.at(0) << " at " << path
+                                   << ":" << line_num;
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CostDatabase::Save(const std::string& path) const {
+  std::ofstream out_stream(path.c_str(), std::ofstream::out | std::ofstream::trunc);
+  CHECK_OR_RETURN(out_stream.is_open()) << "Can not open cost database " << path;
+  out_stream.precision(std::numeric_limits<double>::max_digits10);
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Keep the file stable across saves so that it can be diffed and reviewed
+  std::map<std::string, Record> sorted_compute_records(key2compute_record_.begin(),
+                                                       key2compute_record_.end());
+  for (const auto& pair : sorted_compute_records) {
+    out_stream << kComputeRecord << "\t" << pair.first << "\t" << pair.second.total_time_us << "\t"
+               << pair.second.count << "\n";
+  }
+  for (const auto& pair : device_type2transfer_record_) {
+    out_stream << kTransferRecord << "\t" << pair.first << "\t" << pair.second.total_time_us
+               << "\t" << pair.second.total_bytes << "\t" << pair.second.count << "\n";
+  }
+  CHECK_OR_RETURN(out_stream.good()) << "Failed to write cost database " << path;
+  return Maybe<void>::Ok();
+}
+
+Maybe<std::string> ComputeCostKey4Op(
+    const Operator& op, const NdSbpSignature& nd_sbp_signature,
+    const std::function<const BlobDesc&(const std::string&)>& LogicalBlobDesc4Bn,
+    const ParallelDesc& parallel_desc) {
+  if (!op.op_conf().has_user_conf()) { return std::string(); }
+  std::string key = op.op_conf().device_tag() + "/" + op.op_conf().user_conf().op_type_name();
+  const auto& bn2nd_sbp = nd_sbp_signature.bn_in_op2nd_sbp();
+  for (const auto& bn : op.input_output_bns()) {
+    const BlobDesc& logical_blob_desc = LogicalBlobDesc4Bn(bn);
+    const auto& it = bn2nd_sbp.find(bn);
+    CHECK_OR_RETURN(it != bn2nd_sbp.end()) << "Sbp of " << bn << " not found in " << op.op_name();
+    const Shape& physical_shape = *JUST(
+        GetPhysicalShape(logical_blob_desc.shape(), it->second, parallel_desc, /*parallel_id=*/0));
+    AppendBlobToKey(logical_blob_desc.data_type(), physical_shape.ToString(), &key);
+  }
+  return key;
+}
+
+std::string ComputeCostKey4Kernel(KernelContext* kernel_ctx, const Kernel* kernel) {
+  const OperatorConf& op_conf = kernel->op_conf();
+  if (!op_conf.has_user_conf()) { return std::string(); }
+  std::string key = op_conf.device_tag() + "/" + op_conf.user_conf().op_type_name();
+  const auto& AppendBns = [&](const PbRpf<std::string>& bns) {
+    for (const auto& bn : bns) {
+      const Blob* blob = kernel_ctx->BnInOp2Blob(bn);
+      if (blob == nullptr) { return false; }
+      AppendBlobToKey(blob->data_type(), blob->shape().ToString(), &key);
+    }
+    return true;
+  };
+  // The same order with Operator::input_output_bns()
+  if (!AppendBns(kernel->op_attribute().input_bns())) { return std::string(); }
+  if (!AppendBns(kernel->op_attribute().output_bns())) { return std::string(); }
+  return key;
+}
+
+bool IsTransferKernel(const Kernel* kernel) {
+  switch (kernel->op_conf().op_type_case()) {
+    case OperatorConf::kBoxingConf:
+    case OperatorConf::kSliceBoxingCopyConf:
+    case OperatorConf::kSliceBoxingAddConf:
+    case OperatorConf::kCollectiveBoxingGenericConf:
+    case OperatorConf::kNcclSendRecvBoxingConf:
+    case OperatorConf::kCopyConf: return true;
+    default: return false;
+  }
+}
+
+const std::string& CostDatabasePath() {
+  static const std::string path = GetStringFromEnv("ONEFLOW_AUTO_PARALLEL_COST_DATABASE", "");
+  return path;
+}
+
+}  // namespace auto_parallel
+}  // namespace oneflow
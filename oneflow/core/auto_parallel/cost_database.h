@@ -0,0 +1,94 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef ONEFLOW_CORE_AUTO_PARALLEL_COST_DATABASE_H_
+#define ONEFLOW_CORE_AUTO_PARALLEL_COST_DATABASE_H_
+
+#include <mutex>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/device_type.pb.h"
+#include "oneflow/core/register/blob_desc.h"
+
+namespace oneflow {
+
+class Operator;
+class ParallelDesc;
+class NdSbpSignature;
+class Kernel;
+class KernelContext;
+
+namespace auto_parallel {
+
+// A database of measured costs on the target hardware.
+// Computation costs are the kernel time of an op, keyed by the device, the op type and the
+// physical shapes and data types of all its inputs and outputs. Transfer costs are aggregated to
+// a bandwidth for each device type, which converts the measured time into the unit of copy cost
+// (bytes) used by the sbp search.
+// The database is filled by the CostCalibrationKernelObserver during a calibration run, persisted
+// into a text file and consumed by the sbp search and the straighten algorithm of later runs.
+class CostDatabase final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CostDatabase);
+  CostDatabase() = default;
+  ~CostDatabase() = default;
+
+  void AddComputeTime(const std::string& key, double time_us);
+  void AddTransfer(DeviceType device_type, int64_t bytes, double time_us);
+
+  // Return false if the key has never been measured
+  bool GetComputeTime(const std::string& key, double* time_us) const;
+  bool GetTransferBytesPerUs(DeviceType device_type, double* bytes_per_us) const;
+
+  size_t size() const;
+
+  // Merge the records in the file into this database
+  Maybe<void> Load(const std::string& path);
+  Maybe<void> Save(const std::string& path) const;
+
+ private:
+  struct Record {
+    double total_time_us = 0;
+    int64_t total_bytes = 0;
+    int64_t count = 0;
+  };
+
+  mutable std::mutex mutex_;
+  HashMap<std::string, Record> key2compute_record_;
+  HashMap<int32_t, Record> device_type2transfer_record_;
+};
+
+// The key of the computation cost for an op with the given sbp signature.
+// Return an empty string if the op is not a user op.
+// Physical shapes on the first device are used since they are the largest ones after splitting.
+Maybe<std::string> ComputeCostKey4Op(
+    const Operator& op, const NdSbpSignature& nd_sbp_signature,
+    const std::function<const BlobDesc&(const std::string&)>& LogicalBlobDesc4Bn,
+    const ParallelDesc& parallel_desc);
+
+// The key of the computation cost for a running kernel, which matches ComputeCostKey4Op.
+std::string ComputeCostKey4Kernel(KernelContext* kernel_ctx, const Kernel* kernel);
+
+// Whether the kernel moves data between devices or ranks
+bool IsTransferKernel(const Kernel* kernel);
+
+// The path of the cost database, empty if not configured.
+const std::string& CostDatabasePath();
+
+}  // namespace auto_parallel
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTO_PARALLEL_COST_DATABASE_H_
@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include "gtest/gtest.h"
+#include "oneflow/core/auto_parallel/cost_database.h"
+
+namespace oneflow {
+namespace auto_parallel {
+
+namespace {
+
+std::string CreateTempDirectory() {
+  const char* tmp_env = getenv("TMPDIR");
+  const char* tmp_dir = tmp_env == nullptr ? "/tmp" : tmp_env;
+  std::string tpl = std::string(tmp_dir) + "/test_cost_database_XXXXXX";
+  char* path = mkdtemp(const_cast<char*>(tpl.c_str()));
+  PCHECK(path != nullptr);
+  return std::string(path);
+}
+
+}  // namespace
+
+TEST(CostDatabase, average_compute_time) {
+  CostDatabase cost_database;
+  double time_us = 0.0;
+  ASSERT_FALSE(cost_database.GetComputeTime("cpu/relu/kFloat(4,8)/kFloat(4,8)", &time_us));
+  cost_database.AddComputeTime("cpu/relu/kFloat(4,8)/kFloat(4,8)", 2.0);
+  cost_database.AddComputeTime("cpu/relu/kFloat(4,8)/kFloat(4,8)", 4.0);
+  ASSERT_TRUE(cost_database.GetComputeTime("cpu/relu/kFloat(4,8)/kFloat(4,8)", &time_us));
+  ASSERT_DOUBLE_EQ(time_us, 3.0);
+  // Empty keys come from non-user ops and are never recorded
+  cost_database.AddComputeTime("", 1.0);
+  ASSERT_EQ(cost_database.size(), 1);
+}
+
+TEST(CostDatabase, save_and_load) {
+  const std::string dir = CreateTempDirectory();
+  const std::string path = dir + "/cost_database.txt";
+  {
+    CostDatabase cost_database;
+    cost_database.AddComputeTime("cpu/matmul/kFloat(64,64)/kFloat(64,64)/kFloat(64,64)", 10.0);
+    cost_database.AddTransfer(DeviceType::kCPU, 1000, 2.0);
+    cost_database.AddTransfer(DeviceType::kCPU, 3000, 2.0);
+    ASSERT_TRUE(cost_database.Save(path).IsOk());
+  }
+  CostDatabase cost_database;
+  ASSERT_TRUE(cost_database.Load(path).IsOk());
+  double time_us = 0.0;
+  ASSERT_TRUE(cost_database.GetComputeTime(
+      "cpu/matmul/kFloat(64,64)/kFloat(64,64)/kFloat(64,64)", &time_us));
+  ASSERT_DOUBLE_EQ(time_us, 10.0);
+  double bytes_per_us = 0.0;
+  ASSERT_TRUE(cost_database.GetTransferBytesPerUs(DeviceType::kCPU, &bytes_per_us));
+  ASSERT_DOUBLE_EQ(bytes_per_us, 1000.0);
+  ASSERT_FALSE(cost_database.GetTransferBytesPerUs(DeviceType::kCUDA, &bytes_per_us));
+  std::remove(path.c_str());
+  rmdir(dir.c_str());
+}
+
+}  // namespace auto_parallel
+}  // namespace oneflow
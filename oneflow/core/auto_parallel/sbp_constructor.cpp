@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "oneflow/core/auto_parallel/sbp_constructor.h"
 #include "oneflow/core/auto_parallel/auto_memory.h"
+#include "oneflow/core/auto_parallel/cost_database.h"
 #include "oneflow/core/auto_parallel/sbp_node.h"
 #include "oneflow/core/auto_parallel/sbp_util.h"
 #include "oneflow/core/common/singleton.h"
@@ -285,6 +286,14 @@ Maybe<void> SbpConstructor::StealSbpSignatureFromOpNode(const OpGraph& op_graph,
 }
 
 Maybe<void> SbpConstructor::InitComputationCost(const OpGraph& op_graph) {
+  const CostDatabase* cost_database = Singleton<CostDatabase>::Get();
+  // The costs which are measured or unsupported for each sbp signature, negative if they are
+  // the analytic costs scaled by the calibrated ratio
+  HashMap<SbpNode*, std::vector<double>> sbp_node2fixed_cost;
+  // Accumulated analytic and measured costs of the signatures which have been measured.
+  // Their ratio calibrates the analytic cost of the signatures which have not been measured.
+  double total_analytic_cost = 0.0;
+  double total_measured_cost = 0.0;
   // Compute computation cost for sbp nodes
   JUST(op_graph.TopoForEachNodeWithErrorCaptured([&](OpNode* op_node) -> Maybe<void> {
     // get corresponding sbp node producer
@@ -297,19 +306,64 @@ Maybe<void> SbpConstructor::InitComputationCost(const OpGraph& op_graph) {
       const LogicalBlobId& lbi = op_node->op().BnInOp2Lbi(bn);
       return op_node->LogicalBlobDesc4Lbi(lbi);
     };
+    const int64_t time_shape_elem_cnt =
+        JUST(op_node->op().GetInputOutputFastestTimeShape())->elem_cnt();
+    // Measured time is converted into the unit of copy cost by the measured bandwidth
+    double bytes_per_us = 0.0;
+    const bool use_measured_cost =
+        cost_database != nullptr
+        && cost_database->GetTransferBytesPerUs(parallel_desc.device_type(), &bytes_per_us);
+    auto& fixed_cost = sbp_node2fixed_cost[sbp_node];
+    fixed_cost.resize(sbp_node->sbp_sig_list_.size(), -1.0);
+    std::vector<double> measured_cost(sbp_node->sbp_sig_list_.size(), -1.0);
+    bool all_measured = use_measured_cost;
     for (int32_t sbp_id = 0; sbp_id < sbp_node->sbp_sig_list_.size(); sbp_id++) {
       double comp_cost = JUST(op_node->op().GetComputeComplexity(
           &sbp_node->sbp_sig_list_[sbp_id], LogicalBlobDesc4Bn, parallel_desc));
       if (comp_cost > GetValidMaxCopyCost()) {
-        sbp_node->cost_[sbp_id] = comp_cost;
+        fixed_cost[sbp_id] = comp_cost;
+        continue;
+      }
+      sbp_node->cost_[sbp_id] = comp_cost * time_shape_elem_cnt;
+      double time_us = 0.0;
+      if (use_measured_cost
+          && cost_database->GetComputeTime(
+              JUST(ComputeCostKey4Op(op_node->op(), sbp_node->sbp_sig_list_[sbp_id],
+                                     LogicalBlobDesc4Bn, parallel_desc)),
+              &time_us)) {
+        measured_cost[sbp_id] = time_us * bytes_per_us * time_shape_elem_cnt;
+        total_analytic_cost += sbp_node->cost_[sbp_id];
+        total_measured_cost += measured_cost[sbp_id];
       } else {
-        sbp_node->cost_[sbp_id] =
-            cost_ratio_ * comp_cost
-            * JUST(op_node->op().GetInputOutputFastestTimeShape())->elem_cnt();
+        all_measured = false;
+      }
+    }
+    // A calibration run only measures the chosen signature of each op. Mixing its time with the
+    // analytic costs of the other signatures would bias the choice towards or against it, so the
+    // measured costs are used only when all the signatures of the op have one. Otherwise all of
+    // them take the calibrated analytic cost.
+    if (all_measured) {
+      for (int32_t sbp_id = 0; sbp_id < sbp_node->sbp_sig_list_.size(); sbp_id++) {
+        if (measured_cost[sbp_id] >= 0.0) { fixed_cost[sbp_id] = measured_cost[sbp_id]; }
       }
     }
     return Maybe<void>::Ok();
   }));
+  double cost_ratio = cost_ratio_;
+  if (total_analytic_cost > 0.0 && total_measured_cost > 0.0) {
+    cost_ratio = total_measured_cost / total_analytic_cost;
+    LOG(INFO) << "Computation cost ratio calibrated by the cost database: " << cost_ratio;
+  }
+  for (auto& pair : sbp_node2fixed_cost) {
+    SbpNode* sbp_node = pair.first;
+    for (int32_t sbp_id = 0; sbp_id < sbp_node->cost_.size(); sbp_id++) {
+      if (pair.second[sbp_id] >= 0.0) {
+        sbp_node->cost_[sbp_id] = pair.second[sbp_id];
+      } else {
+        sbp_node->cost_[sbp_id] *= cost_ratio;
+      }
+    }
+  }
   return Maybe<void>::Ok();
 }
 
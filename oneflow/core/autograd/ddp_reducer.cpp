@@ -0,0 +1,235 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+#include "oneflow/core/autograd/ddp_reducer.h"
+#include "oneflow/core/autograd/autograd_engine.h"
+#include "oneflow/core/autograd/autograd_meta.h"
+#include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/ccl/ccl.h"
+#include "oneflow/core/ep/include/device.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_methods.h"
+#include "oneflow/core/framework/transport_token.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/job/rank_group_scope.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+Maybe<void> CopyInto(const std::shared_ptr<Tensor>& dst, const std::shared_ptr<Tensor>& src) {
+  const auto& dims = dst->shape()->dim_vec();
+  std::vector<int64_t> start(dims.size(), 0);
+  std::vector<int64_t> stop(dims.begin(), dims.end());
+  std::vector<int64_t> step(dims.size(), 1);
+  JUST(functional::SliceUpdate(dst, src, start, stop, step, /*inplace=*/true));
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+DDPReducer::DDPReducer(const TensorTuple& params, int64_t bucket_cap_bytes,
+                       const Optional<Symbol<DType>>& comm_dtype, Symbol<RankGroup> rank_group)
+    : params_(params),
+      bucket_cap_bytes_(bucket_cap_bytes),
+      comm_dtype_(comm_dtype),
+      rank_group_(rank_group),
+      grad_ready_(params.size(), false) {}
+
+Maybe<DDPReducer> DDPReducer::New(const TensorTuple& params, int64_t bucket_cap_bytes,
+                                  const Optional<Symbol<DType>>& comm_dtype) {
+  CHECK_GE_OR_RETURN(bucket_cap_bytes, 0) << Error::RuntimeError() << "bucket_cap_bytes "
+                                          << bucket_cap_bytes << " is negative";
+  for (const auto& param : params) {
+    CHECK_OR_RETURN(param->is_local() && param->requires_grad())
+        << Error::RuntimeError() << "DDPReducer only reduces local parameters requiring grad";
+  }
+  if (comm_dtype.has_value()) {
+    CHECK_OR_RETURN(JUST(comm_dtype)->is_floating_point())
+        << Error::RuntimeError() << "The gradients can only be compressed to floating types, but "
+        << JUST(comm_dtype)->name() << " is given";
+  }
+  std::shared_ptr<DDPReducer> reducer(new DDPReducer(
+      params, bucket_cap_bytes, comm_dtype, JUST(RankGroupScope::CurrentRankGroup())));
+  std::vector<int64_t> order(params.size());
+  std::iota(order.begin(), order.end(), 0);
+  JUST(reducer->InitBuckets(order));
+  JUST(reducer->RegisterHooks());
+  return reducer;
+}
+
+Maybe<void> DDPReducer::RegisterHooks() {
+  std::weak_ptr<DDPReducer> weak_reducer = shared_from_this();
+  for (int64_t i = 0; i < params_.size(); ++i) {
+    const auto& param = params_.at(i);
+    if (!param->grad_fn_node()) { JUST(AddAccumulateFunctionNode(param)); }
+    param->mut_autograd_meta()->add_post_grad_accumulation_hook(
+        [weak_reducer, i](const std::shared_ptr<const Tensor>&) -> std::shared_ptr<Tensor> {
+          if (const auto& reducer = weak_reducer.lock()) { CHECK_JUST(reducer->MarkGradReady(i)); }
+          return nullptr;
+        });
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> DDPReducer::InitBuckets(const std::vector<int64_t>& order) {
+  CHECK_EQ_OR_RETURN(order.size(), params_.size());  // NOLINT(maybe-need-error-msg)
+  // The gradients can only be viewed in a flat buffer with the view mechanism
+  const bool flat = bucket_cap_bytes_ > 0 && !view::IsEnvViewDisabled();
+  buckets_.clear();
+  param_locations_.assign(params_.size(), std::make_pair(-1, -1));
+  int64_t bucket_bytes = 0;
+  for (int64_t param_index : order) {
+    const auto& param = params_.at(param_index);
+    const int64_t elem_cnt = param->shape()->elem_cnt();
+    const int64_t elem_size = GetSizeOfDataType(param->dtype()->data_type());
+    bool new_bucket = buckets_.empty() || !flat;
+    if (!new_bucket) {
+      const auto& first_param = params_.at(buckets_.back().param_indices.front());
+      new_bucket = bucket_bytes + elem_cnt * elem_size > bucket_cap_bytes_
+                   || first_param->dtype() != param->dtype()
+                   || JUST(first_param->device()) != JUST(param->device());
+    }
+    if (new_bucket) {
+      buckets_.emplace_back();
+      bucket_bytes = 0;
+    }
+    Bucket& bucket = buckets_.back();
+    param_locations_.at(param_index) = std::make_pair(buckets_.size() - 1,
+                                                      bucket.param_indices.size());
+    bucket.param_indices.emplace_back(param_index);
+    bucket.offsets.emplace_back(bucket.elem_cnt);
+    // Align every gradient in the buffer as the allocator does
+    bucket.elem_cnt += RoundUp(elem_cnt, ep::kMaxAlignmentRequirement / elem_size);
+    bucket_bytes += elem_cnt * elem_size;
+  }
+  bucket_param_indices_.clear();
+  for (const auto& bucket : buckets_) { bucket_param_indices_.emplace_back(bucket.param_indices); }
+  if (flat) {
+    autograd::NoGradGuard no_grad;
+    for (auto& bucket : buckets_) {
+      const auto& first_param = params_.at(bucket.param_indices.front());
+      bucket.buffer =
+          JUST(functional::Empty(Shape({bucket.elem_cnt}), first_param->dtype(),
+                                 JUST(first_param->device()), /*requires_grad=*/false,
+                                 /*pin_memory=*/false));
+      JUST(functional::Fill(bucket.buffer, Scalar(0)));
+      for (int64_t i = 0; i < bucket.param_indices.size(); ++i) {
+        const auto& shape = params_.at(bucket.param_indices.at(i))->shape();
+        bucket.grads.emplace_back(
+            JUST(view::BasicView(bucket.buffer, *shape, bucket.offsets.at(i))));
+      }
+    }
+    for (int64_t i = 0; i < params_.size(); ++i) { JUST(AttachGrad(i)); }
+  }
+  ResetBuckets();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> DDPReducer::RebuildBuckets() {
+  std::vector<int64_t> order = grad_ready_order_;
+  // The order may differ between ranks, while the buckets must be the same on all of them
+  if (rank_group_->size() > 1) {
+    int64_t root = -1;
+    JUST(rank_group_->ForEachRank([&](int64_t rank) -> Maybe<void> {
+      if (root < 0) { root = rank; }
+      return Maybe<void>::Ok();
+    }));
+    const auto& parallel_desc =
+        JUST(RankGroup::GetDefaultParallelDesc(DeviceType::kCPU, rank_group_));
+    const auto& transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+    JUST(ccl::CpuBroadcast(order.data(), order.data(), order.size() * sizeof(int64_t), root,
+                           parallel_desc, transport_token));
+  }
+  JUST(InitBuckets(order));
+  has_rebuilt_buckets_ = true;
+  grad_ready_order_.clear();
+  grad_ready_order_.shrink_to_fit();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> DDPReducer::AttachGrad(int64_t param_index) {
+  const auto& location = param_locations_.at(param_index);
+  const Bucket& bucket = buckets_.at(location.first);
+  if (!bucket.buffer) { return Maybe<void>::Ok(); }
+  const auto& grad = bucket.grads.at(location.second);
+  const auto& param = params_.at(param_index);
+  const auto& acc_grad = JUST(param->acc_grad());
+  if (acc_grad == grad) { return Maybe<void>::Ok(); }
+  // The gradient has been set to None or replaced, keep its value in the bucket
+  autograd::NoGradGuard no_grad;
+  if (acc_grad) {
+    JUST(CopyInto(grad, acc_grad));
+  } else {
+    JUST(functional::Fill(grad, Scalar(0)));
+  }
+  JUST(param->set_acc_grad(grad));
+  return Maybe<void>::Ok();
+}
+
+void DDPReducer::ResetBuckets() {
+  for (auto& bucket : buckets_) { bucket.num_pending = bucket.param_indices.size(); }
+  std::fill(grad_ready_.begin(), grad_ready_.end(), false);
+  next_bucket_ = 0;
+}
+
+Maybe<void> DDPReducer::PrepareForBackward() {
+  if (!has_rebuilt_buckets_ && grad_ready_order_.size() == params_.size()) {
+    JUST(RebuildBuckets());
+  } else {
+    for (int64_t i = 0; i < params_.size(); ++i) { JUST(AttachGrad(i)); }
+    ResetBuckets();
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> DDPReducer::MarkGradReady(int64_t param_index) {
+  if (grad_ready_.at(param_index)) { return Maybe<void>::Ok(); }
+  grad_ready_.at(param_index) = true;
+  if (!has_rebuilt_buckets_) { grad_ready_order_.emplace_back(param_index); }
+  JUST(AttachGrad(param_index));
+  Bucket& bucket = buckets_.at(param_locations_.at(param_index).first);
+  CHECK_GT_OR_RETURN(bucket.num_pending, 0);  // NOLINT(maybe-need-error-msg)
+  bucket.num_pending -= 1;
+  while (next_bucket_ < buckets_.size() && buckets_.at(next_bucket_).num_pending == 0) {
+    JUST(AllReduceBucket(buckets_.at(next_bucket_)));
+    next_bucket_ += 1;
+  }
+  // Ready for another backward without forward
+  if (next_bucket_ == buckets_.size()) { ResetBuckets(); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> DDPReducer::AllReduceBucket(const Bucket& bucket) {
+  autograd::NoGradGuard no_grad;
+  std::shared_ptr<Tensor> grad = bucket.buffer;
+  if (!grad) { grad = JUST(params_.at(bucket.param_indices.front())->acc_grad()); }
+  CHECK_OR_RETURN(grad) << Error::RuntimeError() << "The gradient to all-reduce is None";
+  // Average before the all-reduce, which also keeps the compressed gradients from overflowing
+  JUST(functional::ScalarMul(grad, Scalar(1.0 / rank_group_->size()), /*inplace=*/true));
+  if (comm_dtype_.has_value() && JUST(comm_dtype_) != grad->dtype()) {
+    const auto& compressed = JUST(functional::Cast(grad, JUST(comm_dtype_), /*pin_memory=*/false));
+    JUST(functional::LocalAllReduce(compressed, /*inplace=*/true));
+    JUST(CopyInto(grad, JUST(functional::Cast(compressed, grad->dtype(), /*pin_memory=*/false))));
+  } else {
+    JUST(functional::LocalAllReduce(grad, /*inplace=*/true));
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_AUTOGRAD_DDP_REDUCER_H_
+#define ONEFLOW_CORE_AUTOGRAD_DDP_REDUCER_H_
+
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/optional.h"
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/framework/dtype.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/job/rank_group.h"
+
+namespace oneflow {
+namespace one {
+
+// All-reduces the gradients of the parameters of an eager data parallel module. The gradients are
+// kept in flat buckets of at most bucket_cap_bytes, and a bucket is all-reduced as soon as all of
+// its gradients are accumulated, which overlaps the communication with the rest of the backward.
+// The buckets are first filled in the order of params, which is usually the reversed order of
+// the module parameters, and are rebuilt once in the order the gradients got ready in the first
+// backward of the first rank.
+class DDPReducer final : public std::enable_shared_from_this<DDPReducer> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(DDPReducer);
+  ~DDPReducer() = default;
+
+  // bucket_cap_bytes 0 all-reduces the gradients one by one. The gradients are cast to
+  // comm_dtype for the all-reduce if it is given.
+  static Maybe<DDPReducer> New(const TensorTuple& params, int64_t bucket_cap_bytes,
+                               const Optional<Symbol<DType>>& comm_dtype);
+
+  // Called after every forward
+  Maybe<void> PrepareForBackward();
+
+  const std::vector<std::vector<int64_t>>& bucket_param_indices() const {
+    return bucket_param_indices_;
+  }
+  bool has_rebuilt_buckets() const { return has_rebuilt_buckets_; }
+
+ private:
+  struct Bucket {
+    std::vector<int64_t> param_indices;
+    std::vector<int64_t> offsets;
+    int64_t elem_cnt = 0;
+    // The gradients of the parameters are views of it, or nullptr if the bucket is not flat
+    std::shared_ptr<Tensor> buffer;
+    std::vector<std::shared_ptr<Tensor>> grads;
+    size_t num_pending = 0;
+  };
+
+  DDPReducer(const TensorTuple& params, int64_t bucket_cap_bytes,
+             const Optional<Symbol<DType>>& comm_dtype, Symbol<RankGroup> rank_group);
+
+  Maybe<void> RegisterHooks();
+  Maybe<void> InitBuckets(const std::vector<int64_t>& order);
+  Maybe<void> RebuildBuckets();
+  Maybe<void> AttachGrad(int64_t param_index);
+  void ResetBuckets();
+  Maybe<void> MarkGradReady(int64_t param_index);
+  Maybe<void> AllReduceBucket(const Bucket& bucket);
+
+  TensorTuple params_;
+  int64_t bucket_cap_bytes_;
+  Optional<Symbol<DType>> comm_dtype_;
+  Symbol<RankGroup> rank_group_;
+  std::vector<Bucket> buckets_;
+  std::vector<std::vector<int64_t>> bucket_param_indices_;
+  // The bucket index and the index in the bucket of every parameter
+  std::vector<std::pair<int64_t, int64_t>> param_locations_;
+  std::vector<bool> grad_ready_;
+  // The next bucket to all-reduce, the buckets are all-reduced in order to match on all ranks
+  int64_t next_bucket_ = 0;
+  std::vector<int64_t> grad_ready_order_;
+  bool has_rebuilt_buckets_ = false;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTOGRAD_DDP_REDUCER_H_
@@ -24,6 +24,12 @@ DEFINE_ENV_INTEGER(ONEFLOW_RPC_BOOTSTRAP_SERVER_SLEEP_SECONDS, 20);
 DEFINE_ENV_INTEGER(ONEFLOW_RPC_BOOTSTRAP_SERVER_MAX_RETRY_TIMES, 3);
 DEFINE_ENV_INTEGER(ONEFLOW_RPC_CLIENT_SLEEP_SECONDS, 5);
 DEFINE_ENV_INTEGER(ONEFLOW_RPC_CLIENT_MAX_RETRY_TIMES, 6);
+// Barriers gathered and released along a tree of ranks and master kv values relayed down the
+// same tree, instead of everything going through the server of rank 0
+DEFINE_ENV_BOOL(ONEFLOW_CTRL_HIERARCHICAL_MODE, false);
+DEFINE_ENV_INTEGER(ONEFLOW_CTRL_BROADCAST_TREE_FANOUT, 8);
+// Batched kv requests and responses are split to stay well below the 2GB protobuf limit
+DEFINE_ENV_INTEGER(ONEFLOW_CTRL_BATCH_KV_MAX_BYTES, 256 << 20);
 
 }  // namespace oneflow
 #endif  // ONEFLOW_CORE_COMMON_ENV_VAR_BOOTSTRAP_H_
@@ -26,5 +26,10 @@ DEFINE_ENV_BOOL(ONEFLOW_REMAT_NEIGHBOR, true);
 DEFINE_ENV_BOOL(ONEFLOW_REMAT_HEURISTIC_DTE, false);
 DEFINE_ENV_BOOL(ONEFLOW_REMAT_HEURISTIC_DTR, false);
 DEFINE_ENV_BOOL(ONEFLOW_REMAT_LOG, false);
+// Spill the evicted tensors which are cheaper to copy back than to recompute
+DEFINE_ENV_BOOL(ONEFLOW_REMAT_SPILL, false);
+DEFINE_ENV_BOOL(ONEFLOW_REMAT_SPILL_COMPRESSION, false);
+// The spill bandwidth assumed before any spill is measured
+DEFINE_ENV_INTEGER(ONEFLOW_REMAT_SPILL_BANDWIDTH_MB, 4096);
 
 }  // namespace oneflow
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/common/env_var/bootstrap.h"
 
 namespace oneflow {
 
@@ -33,6 +34,10 @@ GrpcCtrlClient::GrpcCtrlClient(const ProcessCtx& process_ctx) : process_ctx_(pro
     rpc_client_.AddStub(std::move(new_stub));
     rpc_client_.LoadServer(address.host(), rpc_client_.GetStubAt(i));
   }
+  if (EnvBool<ONEFLOW_CTRL_HIERARCHICAL_MODE>()) {
+    rpc_client_.EnableHierarchicalMode(process_ctx.rank(),
+                                       EnvInteger<ONEFLOW_CTRL_BROADCAST_TREE_FANOUT>());
+  }
   need_heartbeat_thread_stop_ = false;
   heartbeat_thread_ = std::thread([this]() {
     std::mt19937 gen(NewRandomSeed());
@@ -102,6 +107,15 @@ void GrpcCtrlClient::PullMasterKV(const std::string& k, PbMessage* msg) {
   rpc_client_.PullMasterKV(k, msg);
 }
 
+void GrpcCtrlClient::BatchPushKV(const std::vector<std::pair<std::string, std::string>>& kvs) {
+  rpc_client_.BatchPushKV(kvs);
+}
+
+void GrpcCtrlClient::BatchPullKV(const std::vector<std::string>& keys,
+                                 std::vector<std::string>* vals) {
+  rpc_client_.BatchPullKV(keys, vals);
+}
+
 void GrpcCtrlClient::Clear() { rpc_client_.Clear(); }
 
 int32_t GrpcCtrlClient::IncreaseCount(const std::string& k, int32_t v) {
@@ -13,6 +13,10 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include "gtest/gtest.h"
 #include "oneflow/core/job/env.pb.h"
 #include "oneflow/core/control/ctrl_client.h"
@@ -22,6 +26,7 @@ limitations under the License.
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/env_desc.h"
 
 #ifdef OF_PLATFORM_POSIX
 
@@ -30,6 +35,10 @@ limitations under the License.
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace oneflow {
 
@@ -80,6 +89,257 @@ TEST(CtrlServer, new_delete) {
   Singleton<CtrlServer>::Delete();
   Singleton<EnvDesc>::Delete();
 }
+
+namespace {
+
+// Every rank runs on a thread of its own with a server of its own, and talks to the others through
+// localhost grpc like the processes of a real world do
+class LocalhostCtrlWorld final {
+ public:
+  LocalhostCtrlWorld(int64_t world_size, int64_t tree_fanout) {
+    EnvProto env_proto;
+    for (int64_t i = 0; i < world_size; ++i) {
+      auto* machine = env_proto.add_machine();
+      machine->set_id(i);
+      machine->set_addr("127.0.0.1");
+    }
+    Singleton<EnvDesc>::New(env_proto);
+    for (int64_t i = 0; i < world_size; ++i) { servers_.emplace_back(new CtrlServer()); }
+    for (int64_t rank = 0; rank < world_size; ++rank) {
+      clients_.emplace_back(new RpcClient());
+      for (const auto& server : servers_) {
+        const std::string addr = "127.0.0.1:" + std::to_string(server->port());
+        clients_.back()->AddStub(CtrlService::NewStub(addr));
+      }
+      clients_.back()->EnableHierarchicalMode(rank, tree_fanout);
+    }
+  }
+  ~LocalhostCtrlWorld() {
+    clients_.clear();
+    servers_.clear();
+    Singleton<EnvDesc>::Delete();
+  }
+
+  int64_t world_size() const { return clients_.size(); }
+
+  void Run(const std::function<void(int64_t rank, RpcClient* client)>& Handler) {
+    std::vector<std::thread> threads;
+    for (int64_t rank = 0; rank < world_size(); ++rank) {
+      threads.emplace_back([&, rank]() { Handler(rank, clients_.at(rank).get()); });
+    }
+    for (auto& thread : threads) { thread.join(); }
+  }
+
+ private:
+  std::vector<std::unique_ptr<CtrlServer>> servers_;
+  std::vector<std::unique_ptr<RpcClient>> clients_;
+};
+
+}  // namespace
+
+TEST(RpcClient, tree_barrier) {
+  LocalhostCtrlWorld world(7, 2);
+  constexpr int kNumIters = 3;
+  std::vector<std::atomic<int64_t>> arrived(kNumIters);
+  for (auto& count : arrived) { count = 0; }
+  world.Run([&](int64_t rank, RpcClient* client) {
+    for (int i = 0; i < kNumIters; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds((rank * 7 + i * 3) % 5));
+      arrived.at(i) += 1;
+      client->Barrier("tree_barrier", world.world_size());
+      ASSERT_EQ(arrived.at(i).load(), world.world_size());
+    }
+  });
+}
+
+TEST(RpcClient, relayed_master_kv) {
+  LocalhostCtrlWorld world(7, 2);
+  const std::string value(1 << 20, 'x');
+  world.Run([&](int64_t rank, RpcClient* client) {
+    if (rank == 0) {
+      client->PushMasterKV("plan", [&](std::string* v) { *v = value; });
+    } else {
+      client->PullMasterKV("plan", [&](const std::string& v) { ASSERT_EQ(v, value); });
+    }
+    client->Barrier("relayed_master_kv", world.world_size());
+    if (rank == 0) { client->ClearMasterKV("plan"); }
+  });
+}
+
+TEST(RpcClient, batch_kv) {
+  LocalhostCtrlWorld world(4, 2);
+  constexpr int kNumKeysPerRank = 16;
+  const auto& Key = [](int64_t rank, int i) {
+    return "batch_kv/" + std::to_string(rank) + "/" + std::to_string(i);
+  };
+  world.Run([&](int64_t rank, RpcClient* client) {
+    std::vector<std::pair<std::string, std::string>> kvs;
+    for (int i = 0; i < kNumKeysPerRank; ++i) {
+      kvs.emplace_back(Key(rank, i), std::to_string(rank * kNumKeysPerRank + i));
+    }
+    client->BatchPushKV(kvs);
+    // The keys of the other ranks may not be there yet, which the servers wait for
+    const int64_t peer = (rank + 1) % world.world_size();
+    std::vector<std::string> keys;
+    for (int i = 0; i < kNumKeysPerRank; ++i) { keys.emplace_back(Key(peer, i)); }
+    std::vector<std::string> vals;
+    client->BatchPullKV(keys, &vals);
+    ASSERT_EQ(vals.size(), static_cast<size_t>(kNumKeysPerRank));
+    for (int i = 0; i < kNumKeysPerRank; ++i) {
+      ASSERT_EQ(vals.at(i), std::to_string(peer * kNumKeysPerRank + i));
+    }
+  });
+}
+
+namespace {
+
+constexpr char kRankEnv[] = "ONEFLOW_CTRL_TEST_RANK";
+constexpr char kRendezvousDirEnv[] = "ONEFLOW_CTRL_TEST_RENDEZVOUS_DIR";
+
+// Returns the rank if the current process was spawned by SpawnRanks, or -1
+int64_t SpawnedRank() {
+  const char* rank = getenv(kRankEnv);
+  return rank == nullptr ? -1 : std::stoll(rank);
+}
+
+// Runs every rank in a process of its own, which executes the test binary again with only the
+// current test and the rank in the environment. A failed rank leaves the others waiting for it,
+// so they are killed.
+void SpawnRanks(int64_t world_size, const std::vector<std::pair<std::string, std::string>>& envs) {
+  const auto* test_info = ::testing::UnitTest::GetInstance()->current_test_info();
+  const std::string filter = std::string("--gtest_filter=") + test_info->test_suite_name() + "."
+                             + test_info->name();
+  const char* tmp_dir = getenv("TMPDIR");
+  std::string dir = std::string(tmp_dir != nullptr ? tmp_dir : "/tmp") + "/oneflow_ctrl_XXXXXX";
+  ASSERT_NE(mkdtemp(&dir[0]), nullptr);
+  std::string exe = "/proc/self/exe";
+  std::vector<char*> argv{&exe[0], const_cast<char*>(filter.c_str()), nullptr};
+  HashSet<pid_t> running;
+  for (int64_t rank = 0; rank < world_size; ++rank) {
+    // the environment is prepared before fork, the child only calls execve
+    std::vector<std::string> env_strs;
+    for (char** env = environ; *env != nullptr; ++env) {
+      if (strncmp(*env, "GTEST_OUTPUT=", strlen("GTEST_OUTPUT=")) != 0) {
+        env_strs.emplace_back(*env);
+      }
+    }
+    env_strs.emplace_back(std::string(kRankEnv) + "=" + std::to_string(rank));
+    env_strs.emplace_back(std::string(kRendezvousDirEnv) + "=" + dir);
+    for (const auto& env : envs) { env_strs.emplace_back(env.first + "=" + env.second); }
+    std::vector<char*> envp;
+    for (std::string& env : env_strs) { envp.emplace_back(&env[0]); }
+    envp.emplace_back(nullptr);
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      execve(argv.at(0), argv.data(), envp.data());
+      _exit(127);
+    }
+    running.insert(pid);
+  }
+  bool succeeded = true;
+  while (!running.empty()) {
+    int status = 0;
+    const pid_t pid = waitpid(-1, &status, 0);
+    if (running.erase(pid) == 0) { continue; }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      succeeded = false;
+      for (pid_t other : running) { kill(other, SIGKILL); }
+    }
+  }
+  for (int64_t rank = 0; rank < world_size; ++rank) {
+    unlink((dir + "/port_" + std::to_string(rank)).c_str());
+    unlink((dir + "/done_" + std::to_string(rank)).c_str());
+  }
+  rmdir(dir.c_str());
+  ASSERT_TRUE(succeeded);
+}
+
+// The spawned ranks meet by files in a shared directory, as no rank knows the ports of the others
+void WriteRendezvousFile(const std::string& name, const std::string& content) {
+  const std::string path = std::string(getenv(kRendezvousDirEnv)) + "/" + name;
+  std::ofstream(path + ".tmp") << content;
+  CHECK_EQ(rename((path + ".tmp").c_str(), path.c_str()), 0);
+}
+
+std::string WaitForRendezvousFile(const std::string& name) {
+  const std::string path = std::string(getenv(kRendezvousDirEnv)) + "/" + name;
+  for (int i = 0; i < 6000; ++i) {
+    std::ifstream file(path);
+    if (file) {
+      std::stringstream content;
+      content << file.rdbuf();
+      return content.str();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  LOG(FATAL) << "timed out waiting for " << path;
+  return "";
+}
+
+}  // namespace
+
+TEST(RpcClient, multi_process) {
+  constexpr int64_t kWorldSize = 5;
+  const int64_t rank = SpawnedRank();
+  if (rank < 0) {
+    // a small limit splits the batched kvs into several requests and responses
+    SpawnRanks(kWorldSize, {{"ONEFLOW_CTRL_BATCH_KV_MAX_BYTES", "64"}});
+    return;
+  }
+  EnvProto env_proto;
+  for (int64_t i = 0; i < kWorldSize; ++i) {
+    auto* machine = env_proto.add_machine();
+    machine->set_id(i);
+    machine->set_addr("127.0.0.1");
+  }
+  Singleton<EnvDesc>::New(env_proto);
+  {
+    CtrlServer server;
+    WriteRendezvousFile("port_" + std::to_string(rank), std::to_string(server.port()));
+    RpcClient client;
+    for (int64_t i = 0; i < kWorldSize; ++i) {
+      const std::string addr =
+          "127.0.0.1:" + WaitForRendezvousFile("port_" + std::to_string(i));
+      client.AddStub(CtrlService::NewStub(addr));
+      client.LoadServer(addr, client.GetStubAt(i));
+    }
+    client.EnableHierarchicalMode(rank, 2);
+    client.Barrier("multi_process/start", kWorldSize);
+
+    const std::string plan(1 << 20, 'p');
+    if (rank == 0) {
+      client.PushMasterKV("plan", [&](std::string* v) { *v = plan; });
+    } else {
+      client.PullMasterKV("plan", [&](const std::string& v) { EXPECT_EQ(v, plan); });
+    }
+    client.Barrier("multi_process/plan", kWorldSize);
+    if (rank == 0) { client.ClearMasterKV("plan"); }
+
+    constexpr int kNumKeysPerRank = 8;
+    const auto& Kv = [](int64_t owner, int i) {
+      return std::make_pair("multi_process/" + std::to_string(owner) + "/" + std::to_string(i),
+                            std::string(16 * (i + 1), static_cast<char>('a' + owner)));
+    };
+    std::vector<std::pair<std::string, std::string>> kvs;
+    for (int i = 0; i < kNumKeysPerRank; ++i) { kvs.emplace_back(Kv(rank, i)); }
+    client.BatchPushKV(kvs);
+    const int64_t peer = (rank + 1) % kWorldSize;
+    std::vector<std::string> keys;
+    for (int i = 0; i < kNumKeysPerRank; ++i) { keys.emplace_back(Kv(peer, i).first); }
+    std::vector<std::string> vals;
+    client.BatchPullKV(keys, &vals);
+    ASSERT_EQ(vals.size(), static_cast<size_t>(kNumKeysPerRank));
+    for (int i = 0; i < kNumKeysPerRank; ++i) { EXPECT_EQ(vals.at(i), Kv(peer, i).second); }
+    client.Barrier("multi_process/end", kWorldSize);
+
+    // the servers must outlive the responses to the last barrier
+    WriteRendezvousFile("done_" + std::to_string(rank), "");
+    for (int64_t i = 0; i < kWorldSize; ++i) { WaitForRendezvousFile("done_" + std::to_string(i)); }
+  }
+  Singleton<EnvDesc>::Delete();
+}
+
 #endif  // RPC_BACKEND_GRPC
 
 }  // namespace oneflow
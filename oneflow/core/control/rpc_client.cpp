@@ -35,6 +35,8 @@ int64_t rpc_client_sleep_seconds() {
 
 #define GRPC_CHECK(x) CHECK_EQ(x.error_code(), grpc::StatusCode::OK)
 
+std::string RelayedMasterKey(const std::string& k) { return "RelayedMasterKV/" + k; }
+
 template<CtrlMethod ctrl_method>
 class ClientCall final {
  public:
@@ -61,12 +63,50 @@ void RpcClient::Barrier(const std::string& barrier_name) {
 }
 
 void RpcClient::Barrier(const std::string& barrier_name, int32_t barrier_num) {
+  if (is_hierarchical_mode_ && barrier_num == static_cast<int64_t>(GetStubSize())) {
+    TreeBarrier(barrier_name);
+    return;
+  }
   ClientCall<CtrlMethod::kBarrier> call;
   call.mut_request()->set_name(barrier_name);
   call.mut_request()->set_num(barrier_num);
   call(GetMasterStub());
 }
 
+// Every rank first waits for its children to arrive at the barrier on its own server and then
+// arrives at the one of its parent, so rank 0 is the last to arrive. The ranks are released in
+// the reverse order by the same pairs of barriers, which keeps every server serving only its
+// children.
+void RpcClient::TreeBarrier(const std::string& barrier_name) {
+  const auto& BarrierAt = [&](const std::string& phase, int64_t rank) {
+    ClientCall<CtrlMethod::kBarrier> call;
+    call.mut_request()->set_name("TreeBarrier/" + barrier_name + "/" + phase);
+    call.mut_request()->set_num(NumTreeChildren(rank) + 1);
+    call(GetStubAt(rank));
+  };
+  const int64_t num_children = NumTreeChildren(rank_);
+  if (num_children > 0) { BarrierAt("arrive", rank_); }
+  if (rank_ != 0) {
+    const int64_t parent = (rank_ - 1) / tree_fanout_;
+    BarrierAt("arrive", parent);
+    BarrierAt("release", parent);
+  }
+  if (num_children > 0) { BarrierAt("release", rank_); }
+}
+
+int64_t RpcClient::NumTreeChildren(int64_t rank) {
+  const int64_t world_size = static_cast<int64_t>(GetStubSize());
+  const int64_t first_child = rank * tree_fanout_ + 1;
+  return std::max<int64_t>(std::min(first_child + tree_fanout_, world_size) - first_child, 0);
+}
+
+void RpcClient::EnableHierarchicalMode(int64_t rank, int64_t tree_fanout) {
+  CHECK_GT(tree_fanout, 0);
+  is_hierarchical_mode_ = true;
+  rank_ = rank;
+  tree_fanout_ = tree_fanout;
+}
+
 TryLockResult RpcClient::TryLock(const std::string& name) {
   {
     std::unique_lock<std::mutex> lck(done_names_mtx_);
@@ -101,6 +141,31 @@ void RpcClient::PushKV(const std::string& k, std::function<void(std::string*)> V
   call(GetResponsibleStub(k));
 }
 
+// Every server gets its kvs in requests of at most ONEFLOW_CTRL_BATCH_KV_MAX_BYTES, a larger kv
+// is sent alone.
+void RpcClient::BatchPushKV(const std::vector<std::pair<std::string, std::string>>& kvs) {
+  const int64_t max_bytes = EnvInteger<ONEFLOW_CTRL_BATCH_KV_MAX_BYTES>();
+  HashMap<CtrlService::Stub*, std::vector<const std::pair<std::string, std::string>*>> stub2kvs;
+  for (const auto& kv : kvs) { stub2kvs[GetResponsibleStub(kv.first)].emplace_back(&kv); }
+  for (const auto& pair : stub2kvs) {
+    auto call = std::make_unique<ClientCall<CtrlMethod::kBatchPushKV>>();
+    int64_t bytes = 0;
+    for (const auto* kv : pair.second) {
+      const int64_t kv_bytes = kv->first.size() + kv->second.size();
+      if (bytes > 0 && bytes + kv_bytes > max_bytes) {
+        (*call)(pair.first);
+        call = std::make_unique<ClientCall<CtrlMethod::kBatchPushKV>>();
+        bytes = 0;
+      }
+      PushKVRequest* request = call->mut_request()->add_kv();
+      request->set_key(kv->first);
+      request->set_val(kv->second);
+      bytes += kv_bytes;
+    }
+    (*call)(pair.first);
+  }
+}
+
 void RpcClient::PushMasterKV(const std::string& k, std::function<void(std::string*)> VSetter) {
   ClientCall<CtrlMethod::kPushKV> call;
   call.mut_request()->set_key(k);
@@ -130,6 +195,14 @@ void RpcClient::ClearMasterKV(const std::string& k) {
   ClientCall<CtrlMethod::kClearKV> call;
   call.mut_request()->set_key(k);
   call(GetMasterStub());
+  if (is_hierarchical_mode_) {
+    for (int64_t rank = 1; rank < static_cast<int64_t>(GetStubSize()); ++rank) {
+      if (NumTreeChildren(rank) == 0) { continue; }
+      ClientCall<CtrlMethod::kClearKV> relay_call;
+      relay_call.mut_request()->set_key(RelayedMasterKey(k));
+      relay_call(GetStubAt(rank));
+    }
+  }
 }
 
 void RpcClient::PullKV(const std::string& k, std::function<void(const std::string&)> VGetter) {
@@ -139,11 +212,51 @@ void RpcClient::PullKV(const std::string& k, std::function<void(const std::strin
   VGetter(call.response().val());
 }
 
+// A server answers with the values of a prefix of the requested keys that fits in
+// ONEFLOW_CTRL_BATCH_KV_MAX_BYTES, the rest is pulled by further requests.
+void RpcClient::BatchPullKV(const std::vector<std::string>& keys, std::vector<std::string>* vals) {
+  HashMap<CtrlService::Stub*, std::vector<size_t>> stub2indices;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    stub2indices[GetResponsibleStub(keys.at(i))].emplace_back(i);
+  }
+  vals->resize(keys.size());
+  for (const auto& pair : stub2indices) {
+    const std::vector<size_t>& indices = pair.second;
+    size_t num_pulled = 0;
+    while (num_pulled < indices.size()) {
+      ClientCall<CtrlMethod::kBatchPullKV> call;
+      for (size_t i = num_pulled; i < indices.size(); ++i) {
+        call.mut_request()->add_key(keys.at(indices.at(i)));
+      }
+      call(pair.first);
+      CHECK_GT(call.response().val_size(), 0);
+      for (const std::string& val : call.response().val()) {
+        vals->at(indices.at(num_pulled++)) = val;
+      }
+    }
+  }
+}
+
+// In hierarchical mode the ranks below rank 0 pull the value from their parents in the tree and
+// republish it on their own servers for their children, so rank 0 only serves its children.
 void RpcClient::PullMasterKV(const std::string& k,
                              std::function<void(const std::string&)> VGetter) {
   ClientCall<CtrlMethod::kPullKV> call;
-  call.mut_request()->set_key(k);
-  call(GetMasterStub());
+  if (!is_hierarchical_mode_ || rank_ == 0) {
+    call.mut_request()->set_key(k);
+    call(GetMasterStub());
+    VGetter(call.response().val());
+    return;
+  }
+  const int64_t parent = (rank_ - 1) / tree_fanout_;
+  call.mut_request()->set_key(parent == 0 ? k : RelayedMasterKey(k));
+  call(GetStubAt(parent));
+  if (NumTreeChildren(rank_) > 0) {
+    ClientCall<CtrlMethod::kPushKV> relay_call;
+    relay_call.mut_request()->set_key(RelayedMasterKey(k));
+    relay_call.mut_request()->set_val(call.response().val());
+    relay_call(GetStubAt(rank_));
+  }
   VGetter(call.response().val());
 }
 
@@ -59,6 +59,9 @@ class RpcClient {
     *v = oneflow_cast<T>(v_str);
   }
 
+  void BatchPushKV(const std::vector<std::pair<std::string, std::string>>& kvs);
+  void BatchPullKV(const std::vector<std::string>& keys, std::vector<std::string>* vals);
+
   void Clear();
 
   int32_t IncreaseCount(const std::string& k, int32_t v);
@@ -75,10 +78,20 @@ class RpcClient {
   size_t GetStubSize() { return stubs_.size(); };
   void ReserveStubsOfSize(int64_t n) { stubs_.reserve(n); };
   void AddStub(std::unique_ptr<CtrlService::Stub> s) { stubs_.emplace_back(std::move(s)); };
+  // Barriers and master kv values then go along a tree of ranks rooted at rank 0
+  void EnableHierarchicalMode(int64_t rank, int64_t tree_fanout);
 
   std::vector<std::unique_ptr<CtrlService::Stub>> stubs_;
   std::mutex done_names_mtx_;
   HashSet<std::string> done_names_;
+
+ private:
+  void TreeBarrier(const std::string& barrier_name);
+  int64_t NumTreeChildren(int64_t rank);
+
+  bool is_hierarchical_mode_ = false;
+  int64_t rank_ = 0;
+  int64_t tree_fanout_ = 0;
 };
 
 }  // namespace oneflow
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/control/rpc_server.h"
 #include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/common/env_var/bootstrap.h"
 #include "grpc/grpc_posix.h"
 
 namespace oneflow {
@@ -62,6 +63,45 @@ void RpcServer::HandleRpcs() {
   }
 }
 
+void RpcServer::PushKV(const std::string& k, const std::string& v) {
+  CHECK(kv_.emplace(k, v).second);
+
+  auto pending_kv_calls_it = pending_kv_calls_.find(k);
+  if (pending_kv_calls_it != pending_kv_calls_.end()) {
+    for (auto pending_call : pending_kv_calls_it->second) {
+      pending_call->mut_response()->set_val(v);
+      pending_call->SendResponse();
+    }
+    pending_kv_calls_.erase(pending_kv_calls_it);
+  }
+  auto pending_batch_kv_calls_it = pending_batch_kv_calls_.find(k);
+  if (pending_batch_kv_calls_it != pending_batch_kv_calls_.end()) {
+    std::list<CtrlCall<CtrlMethod::kBatchPullKV>*> pending_calls;
+    pending_calls.swap(pending_batch_kv_calls_it->second);
+    pending_batch_kv_calls_.erase(pending_batch_kv_calls_it);
+    for (auto pending_call : pending_calls) { TryRespondBatchPullKV(pending_call); }
+  }
+}
+
+void RpcServer::TryRespondBatchPullKV(CtrlCall<CtrlMethod::kBatchPullKV>* call) {
+  for (const std::string& k : call->request().key()) {
+    if (kv_.find(k) == kv_.end()) {
+      pending_batch_kv_calls_[k].emplace_back(call);
+      return;
+    }
+  }
+  // the client pulls the keys that do not fit again
+  const int64_t max_bytes = EnvInteger<ONEFLOW_CTRL_BATCH_KV_MAX_BYTES>();
+  int64_t bytes = 0;
+  for (const std::string& k : call->request().key()) {
+    const std::string& v = kv_.at(k);
+    if (bytes > 0 && bytes + static_cast<int64_t>(v.size()) > max_bytes) { break; }
+    *call->mut_response()->add_val() = v;
+    bytes += v.size();
+  }
+  call->SendResponse();
+}
+
 void RpcServer::Init() {
   Add([this](CtrlCall<CtrlMethod::kLoadServer>* call) { OnLoadServer(call); });
 
@@ -129,18 +169,7 @@ void RpcServer::Init() {
   });
 
   Add([this](CtrlCall<CtrlMethod::kPushKV>* call) {
-    const std::string& k = call->request().key();
-    const std::string& v = call->request().val();
-    CHECK(kv_.emplace(k, v).second);
-
-    auto pending_kv_calls_it = pending_kv_calls_.find(k);
-    if (pending_kv_calls_it != pending_kv_calls_.end()) {
-      for (auto pending_call : pending_kv_calls_it->second) {
-        pending_call->mut_response()->set_val(v);
-        pending_call->SendResponse();
-      }
-      pending_kv_calls_.erase(pending_kv_calls_it);
-    }
+    PushKV(call->request().key(), call->request().val());
     call->SendResponse();
     EnqueueRequest<CtrlMethod::kPushKV>();
   });
@@ -149,6 +178,7 @@ void RpcServer::Init() {
     const std::string& k = call->request().key();
     CHECK_EQ(kv_.erase(k), 1);
     CHECK(pending_kv_calls_.find(k) == pending_kv_calls_.end());
+    CHECK(pending_batch_kv_calls_.find(k) == pending_batch_kv_calls_.end());
     call->SendResponse();
     EnqueueRequest<CtrlMethod::kClearKV>();
   });
@@ -170,6 +200,9 @@ void RpcServer::Init() {
     kv_.clear();
     CHECK(pending_kv_calls_.empty()) << "size(): " << pending_kv_calls_.size()
                                      << ", begin()->key: " << pending_kv_calls_.begin()->first;
+    CHECK(pending_batch_kv_calls_.empty())
+        << "size(): " << pending_batch_kv_calls_.size()
+        << ", begin()->key: " << pending_batch_kv_calls_.begin()->first;
     call->SendResponse();
     EnqueueRequest<CtrlMethod::kClear>();
   });
@@ -187,6 +220,17 @@ void RpcServer::Init() {
     call->SendResponse();
     EnqueueRequest<CtrlMethod::kEraseCount>();
   });
+
+  Add([this](CtrlCall<CtrlMethod::kBatchPushKV>* call) {
+    for (const PushKVRequest& kv : call->request().kv()) { PushKV(kv.key(), kv.val()); }
+    call->SendResponse();
+    EnqueueRequest<CtrlMethod::kBatchPushKV>();
+  });
+
+  Add([this](CtrlCall<CtrlMethod::kBatchPullKV>* call) {
+    TryRespondBatchPullKV(call);
+    EnqueueRequest<CtrlMethod::kBatchPullKV>();
+  });
 }
 
 }  // namespace oneflow
@@ -67,6 +67,10 @@ class RpcServer {
 
   virtual void OnLoadServer(CtrlCall<CtrlMethod::kLoadServer>* call) = 0;
 
+  void PushKV(const std::string& k, const std::string& v);
+  // Responds if all the keys are there, or waits for the first missing one
+  void TryRespondBatchPullKV(CtrlCall<CtrlMethod::kBatchPullKV>* call);
+
   struct helper {
     helper(RpcServer* s) : s_(s) {}
     template<typename T, typename V>
@@ -91,6 +95,8 @@ class RpcServer {
   // PushKV, ClearKV, PullKV
   HashMap<std::string, std::string> kv_;
   HashMap<std::string, std::list<CtrlCall<CtrlMethod::kPullKV>*>> pending_kv_calls_;
+  // BatchPushKV, BatchPullKV
+  HashMap<std::string, std::list<CtrlCall<CtrlMethod::kBatchPullKV>*>> pending_batch_kv_calls_;
   // IncreaseCount, EraseCount
   HashMap<std::string, int32_t> count_;
 };
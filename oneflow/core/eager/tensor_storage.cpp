@@ -15,10 +15,15 @@ limitations under the License.
 */
 #include "oneflow/core/eager/tensor_storage.h"
 #include "oneflow/core/common/env_var/remat.h"
+#include "oneflow/core/framework/shut_down_util.h"
+#include "oneflow/core/profiler/util.h"
 #include "oneflow/core/vm/op_call_instruction_policy.h"
+#include "oneflow/core/vm/remat/allocator.h"
 #include "oneflow/core/vm/remat/disjoint_set.h"
 #include "oneflow/core/vm/remat/env.h"
+#include "oneflow/core/vm/remat/spill.h"
 #include "oneflow/core/vm/remat/util.h"
+#include "oneflow/core/vm/stream.h"
 #include "oneflow/core/vm/virtual_machine.h"
 
 namespace oneflow {
@@ -89,6 +94,7 @@ void RematableTensorStorage::Remat() {
   if (is_in_memory()) { return; }
   auto stream = CHECK_JUST(GetDefaultStreamByDevice(device_));
   auto* vm_stream = CHECK_JUST(Singleton<VirtualMachine>::Get()->GetVmStream(stream));
+  if (is_spilled()) { return CHECK_JUST(Restore(vm_stream)); }
   auto op = compute_op();
   CHECK_JUST(Recompute(&op, vm_stream));
 }
@@ -96,9 +102,72 @@ void RematableTensorStorage::Remat() {
 void RematableTensorStorage::Evict(bool eager_eviction) {
   CHECK(!is_eviction_disabled());
   LogEviction(eager_eviction);
+  // The eagerly evicted tensors are not used by the user any more, so they are not spilled
+  if (!eager_eviction && ShouldSpill()) { return CHECK_JUST(Spill()); }
   return _Release();
 }
 
+Maybe<void> RematableTensorStorage::Spill() {
+  CHECK_OR_RETURN(is_in_memory() && blob_bytes_ > 0) << "storage " << id_ << " is not in memory";
+  const auto started_at = profiler::GetTimeNow();
+  auto stream = JUST(GetDefaultStreamByDevice(device_));
+  auto* vm_stream = JUST(Singleton<VirtualMachine>::Get()->GetVmStream(stream));
+  spilled_blob_ = JUST(remat::SpilledBlob::New(vm_stream->mut_stream_policy()->stream(),
+                                               blob_dptr_.get(), blob_bytes_, id_));
+  _Release();
+  Singleton<remat::Env>::Get()->add_spill(blob_bytes_,
+                                          (profiler::GetTimeNow() - started_at) / 1e9);
+  VLOG(1) << "spill storage " << id_ << ", compute op type: " << compute_op_type_name()
+          << ", bytes: " << blob_bytes_ << ", host bytes: " << spilled_blob_->host_bytes();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> RematableTensorStorage::Restore(vm::Stream* vm_stream) {
+  CHECK_OR_RETURN(is_spilled()) << "storage " << id_ << " is not spilled";
+  const auto started_at = profiler::GetTimeNow();
+  Allocator* allocator = vm_stream->mut_stream_policy()->mut_allocator();
+  const size_t bytes = blob_bytes_;
+  char* dptr = nullptr;
+  JUST(allocator->Allocate(&dptr, bytes));
+  const auto& Free = [allocator, bytes](char* dptr) {
+    if (IsShuttingDown()) { return; }
+    allocator->Deallocate(dptr, bytes);
+  };
+  set_blob_dptr(std::unique_ptr<char, std::function<void(char*)>>(dptr, Free), bytes);
+  if (auto* dtr_allocator = dynamic_cast<DtrEpAllocatorProxy*>(allocator)) {
+    dtr_allocator->allocator->LinkStorageAndPtr(this, dptr);
+  }
+  JUST(spilled_blob_->Restore(vm_stream->mut_stream_policy()->stream(), dptr));
+  spilled_blob_.reset();
+  Access();
+  Singleton<remat::Env>::Get()->add_restore(bytes, (profiler::GetTimeNow() - started_at) / 1e9);
+  VLOG(1) << "restore storage " << id_ << ", bytes: " << bytes;
+  return Maybe<void>::Ok();
+}
+
+void RematableTensorStorage::clear_spilled_blob() { spilled_blob_.reset(); }
+
+bool RematableTensorStorage::ShouldSpill() const {
+  const auto* env = Singleton<remat::Env>::Get();
+  if (!env->is_spill_enabled() || blob_bytes_ == 0 || !is_in_memory()) { return false; }
+  // A spilled tensor is copied out now and copied back when it is used
+  const double transfer_time = 2. * blob_bytes_ / env->spill_bandwidth();
+  return transfer_time < measured_recompute_time();
+}
+
+double RematableTensorStorage::measured_recompute_time() const {
+  if (compute_op_ == nullptr) { return 0; }
+  double time = measured_compute_time_;
+  // The evicted inputs of compute_op have to be recomputed first
+  for (const auto& input : compute_op_->mut_inputs()) {
+    if (auto storage = std::dynamic_pointer_cast<RematableTensorStorage>(input->tensor_storage());
+        storage && !storage->is_in_memory() && !storage->is_spilled()) {
+      time += storage->measured_compute_time();
+    }
+  }
+  return time;
+}
+
 void RematableTensorStorage::Release() {
   CHECK(device_->rematable());
   if (is_eviction_disabled()) { return; }
@@ -179,7 +248,7 @@ double RematableTensorStorage::approx_neighbor_cost() const {
     for (int i = 0; i < eager_blob_objects.size(); ++i) {
       const auto& tmp = eager_blob_objects[i];
       if (auto storage = std::dynamic_pointer_cast<RematableTensorStorage>(tmp->tensor_storage());
-          !storage->is_in_memory()) {
+          !storage->is_in_memory() && !storage->is_spilled()) {
         double tmp_cost = remat::DisjointSet::find_father(storage->node)->compute_time();
         if (tmp_cost < storage->compute_time()) { tmp_cost = storage->compute_time(); }
         all_cost += tmp_cost;
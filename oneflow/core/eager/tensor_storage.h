@@ -24,12 +24,14 @@ limitations under the License.
 namespace oneflow {
 namespace remat {
 class DisjNode;
-}
+class SpilledBlob;
+}  // namespace remat
 
 namespace vm {
 
 class OpCallInstructionPolicy;
 class DtrOpCallInstructionPolicy;
+class Stream;
 
 class TensorStorage {
  public:
@@ -95,7 +97,14 @@ class RematableTensorStorage final : public TensorStorage {
   std::shared_ptr<DtrOpCallInstructionPolicy> dtr_compute_op() const;
   void Release() override;
   void Remat();
+  // Spills the tensor instead of releasing it if copying it back is measured to be cheaper than
+  // recomputing it, and the spill tier is enabled
   void Evict(bool eager_eviction);
+  Maybe<void> Spill();
+  // Copies the spilled tensor back into the memory allocated on vm_stream
+  Maybe<void> Restore(vm::Stream* vm_stream);
+  bool is_spilled() const { return spilled_blob_ != nullptr && !is_in_memory(); }
+  void clear_spilled_blob();
   void Pin();
   void Unpin();
   void Access();
@@ -114,6 +123,10 @@ class RematableTensorStorage final : public TensorStorage {
   bool is_needed_by_backward() const { return is_needed_by_backward_; }
   void set_needed_by_backward() { is_needed_by_backward_ = true; }
   double compute_time() const { return compute_time_; }
+  // The wall time in seconds of the last run of compute_op, measured only if the spill tier is
+  // enabled
+  double measured_compute_time() const { return measured_compute_time_; }
+  void set_measured_compute_time(double seconds) { measured_compute_time_ = seconds; }
   std::shared_ptr<remat::DisjNode> node;
 
  private:
@@ -124,8 +137,12 @@ class RematableTensorStorage final : public TensorStorage {
   double compute_time_{};
   std::shared_ptr<DtrOpCallInstructionPolicy> compute_op_;
   bool is_needed_by_backward_ = false;
+  double measured_compute_time_{};
+  std::shared_ptr<remat::SpilledBlob> spilled_blob_;
 
   void LogEviction(bool eager_eviction) const;
+  bool ShouldSpill() const;
+  double measured_recompute_time() const;
 };
 
 }  // namespace vm
@@ -112,8 +112,6 @@ inline bool UseEmbeddingGradientShuffleP2PKernel(DataType embedding_dtype, DataT
 #endif
 }
 
-#if defined(WITH_CUDA) || defined(WITH_ROCM)
-
 class TmpBufferAllocator {
  public:
   TmpBufferAllocator() = default;
@@ -182,11 +180,10 @@ class EmbeddingManager final {
  private:
   HashMap<std::pair<std::string, int64_t>, std::unique_ptr<KeyValueStore>> key_value_store_map_;
   HashMap<std::pair<std::string, int64_t>, std::unique_ptr<EmbeddingState>> embedding_state_map_;
+  HashMap<std::pair<std::string, int64_t>, DeviceType> device_type_map_;
   std::mutex mutex_;
 };
 
-#endif  // WITH_CUDA
-
 }  // namespace embedding
 }  // namespace oneflow
 
@@ -103,6 +103,23 @@ class KeyValueStoreOptions final {
     CHECK(json_object.contains("kv_store"));
     auto kv_store = json_object["kv_store"];
 
+#if defined(WITH_CUDA) || defined(WITH_ROCM)
+    device_type_ = DeviceType::kCUDA;
+#else
+    device_type_ = DeviceType::kCPU;
+#endif
+    if (kv_store.contains("device_type")) {
+      CHECK(kv_store["device_type"].is_string());
+      const std::string device_type = kv_store["device_type"].get<std::string>();
+      if (device_type == "cpu") {
+        device_type_ = DeviceType::kCPU;
+      } else if (device_type == "cuda") {
+        device_type_ = DeviceType::kCUDA;
+      } else {
+        UNIMPLEMENTED() << "Unsupported kv_store device_type " << device_type;
+      }
+    }
+
     auto caches = kv_store["caches"];
     if (caches != nlohmann::detail::value_t::null && caches.size() > 0) {
       CHECK(caches.is_array());
@@ -153,6 +170,7 @@ class KeyValueStoreOptions final {
   int64_t ValueTypeSize() const { return value_type_size_; }
   DataType ValueType() const { return value_type_; }
   const std::string& Name() const { return name_; }
+  DeviceType GetDeviceType() const { return device_type_; }
   int64_t LineSize() const { return line_size_; }
   const std::vector<CacheOptions>& GetCachesOptions() const { return cache_options_; }
   const std::vector<std::string>& PersistentTablePaths() const { return persistent_table_paths_; }
@@ -170,6 +188,7 @@ class KeyValueStoreOptions final {
   int64_t value_type_size_;
   DataType value_type_;
   std::string name_;
+  DeviceType device_type_;
   int64_t line_size_;
   std::vector<std::string> persistent_table_paths_;
   int64_t persistent_table_physical_block_size_;
@@ -23,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/embedding/posix_file.h"
 #include "oneflow/core/common/blocking_counter.h"
 #include <robin_hood.h>
+#include <condition_variable>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <dirent.h>
@@ -47,6 +48,7 @@ constexpr uint32_t kAioQueueDepth = 128;
 constexpr uint32_t kChunkNameSuffixLength = 12;
 constexpr char const* kKeyFileNamePrefix = "key-";
 constexpr char const* kIndexFileNamePrefix = "index-";
+constexpr char const* kIndexShardsFileNamePrefix = "index_shards-";
 constexpr char const* kValueFileNamePrefix = "value-";
 constexpr char const* kLockFileName = "LOCK";
 constexpr char const* kKeySizeFileName = "KEY_SIZE";
@@ -57,7 +59,10 @@ constexpr char const* kKeysDirName = "keys";
 constexpr char const* kValuesDirName = "values";
 constexpr char const* kSnapshotsDirName = "snapshots";
 constexpr char const* kSnapshotListFileName = "LIST";
+constexpr char const* kSnapshotBaseFileName = "BASE";
+constexpr char const* kSnapshotTableSizeFileName = "TABLE_SIZE";
 constexpr size_t kParallelForStride = 256;
+constexpr uint32_t kNumIndexShards = 64;
 
 template<typename T>
 T* BytesOffset(T* ptr, size_t bytes) {
@@ -117,6 +122,36 @@ void ListChunkFiles(const std::string& base, const std::string& prefix,
   PCHECK(closedir(dir) == 0);
 }
 
+std::vector<std::string> ReadLines(const std::string& pathname) {
+  std::vector<std::string> lines;
+  std::ifstream ifs(pathname);
+  std::string line;
+  while (std::getline(ifs, line)) { lines.push_back(line); }
+  return lines;
+}
+
+void WriteFileContent(const std::string& pathname, const void* data, size_t size) {
+  PosixFile file(pathname, O_CREAT | O_RDWR | O_TRUNC, 0644);
+  size_t written = 0;
+  while (written < size) {
+    const ssize_t n = pwrite(file.fd(), BytesOffset(data, written), size - written, written);
+    PCHECK(n > 0);
+    written += n;
+  }
+}
+
+void RemoveFileIfExists(const std::string& pathname) {
+  if (PosixFile::FileExists(pathname)) { PCHECK(unlink(pathname.c_str()) == 0); }
+}
+
+// Runs fn(0) to fn(num_threads - 1) each in its own thread
+void RunInThreads(size_t num_threads, const std::function<void(size_t)>& fn) {
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) { threads.emplace_back(fn, i); }
+  fn(0);
+  for (auto& thread : threads) { thread.join(); }
+}
+
 uint32_t GetLogicalBlockSize(uint32_t physical_block_size, uint32_t value_size) {
   return physical_block_size >= value_size ? physical_block_size
                                            : RoundUp(value_size, physical_block_size);
@@ -147,9 +182,11 @@ template<typename Key>
 class ChunkIteratorImpl : public PersistentTable::Iterator {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ChunkIteratorImpl);
+  // Only the entries accepted by Filter are returned when it is given
   ChunkIteratorImpl(uint32_t value_size, uint32_t logical_block_size, uint32_t num_values_per_block,
                     uint64_t num_values_per_chunk, uint64_t chunk_id, uint64_t n,
-                    const Key* chunk_keys, const uint64_t* chunk_indices, const void* chunk_values)
+                    const Key* chunk_keys, const uint64_t* chunk_indices, const void* chunk_values,
+                    const std::function<bool(Key key, uint64_t row)>& Filter = nullptr)
       : pos_(0),
         value_size_(value_size),
         logical_block_size_(logical_block_size),
@@ -159,14 +196,19 @@ class ChunkIteratorImpl : public PersistentTable::Iterator {
         chunk_keys_(chunk_keys),
         chunk_indices_(chunk_indices),
         chunk_values_(chunk_values),
-        chunk_index_offset_(chunk_id * num_values_per_chunk_) {}
+        chunk_index_offset_(chunk_id * num_values_per_chunk_),
+        filter_(Filter) {}
   ~ChunkIteratorImpl() override = default;
 
   void Next(uint32_t num_keys, uint32_t* return_keys, void* keys, void* values) override {
     uint32_t count = 0;
     while (count < num_keys && pos_ != n_) {
-      const uint64_t index_in_chunk = chunk_indices_[pos_] - chunk_index_offset_;
-      static_cast<Key*>(keys)[count] = chunk_keys_[index_in_chunk];
+      const uint64_t row = chunk_indices_[pos_];
+      const uint64_t index_in_chunk = row - chunk_index_offset_;
+      const Key key = chunk_keys_[index_in_chunk];
+      pos_++;
+      if (filter_ && !filter_(key, row)) { continue; }
+      static_cast<Key*>(keys)[count] = key;
       const uint64_t block_in_chunk = index_in_chunk / num_values_per_block_;
       const uint32_t index_in_block = index_in_chunk - block_in_chunk * num_values_per_block_;
       const uint32_t value_offset =
@@ -174,7 +216,6 @@ class ChunkIteratorImpl : public PersistentTable::Iterator {
       std::memcpy(static_cast<char*>(values) + count * value_size_,
                   static_cast<const char*>(chunk_values_) + value_offset, value_size_);
       count++;
-      pos_++;
     }
     *return_keys = count;
   }
@@ -192,6 +233,7 @@ class ChunkIteratorImpl : public PersistentTable::Iterator {
   const uint64_t* chunk_indices_;
   const void* chunk_values_;
   uint64_t chunk_index_offset_;
+  std::function<bool(Key key, uint64_t row)> filter_;
 };
 
 class AioEngine final {
@@ -280,6 +322,32 @@ class Worker final {
 template<typename Key, typename Engine>
 class SnapshotIteratorImpl;
 
+template<typename Key>
+struct IndexShard {
+  robin_hood::unordered_flat_map<Key, uint64_t> row_id_mapping;
+  // The rows held when the snapshot being saved was taken, by the keys put since then
+  robin_hood::unordered_flat_map<Key, uint64_t> snapshot_rows;
+  bool snapshot_pending = false;
+};
+
+// The index and key files of a chunk of a snapshot, with the rows grouped by index shard
+template<typename Key>
+struct SnapshotChunk {
+  uint64_t chunk_id = 0;
+  std::unique_ptr<PosixMappedFile> index_file;
+  std::unique_ptr<PosixMappedFile> key_file;
+  const uint64_t* rows = nullptr;
+  const Key* keys = nullptr;
+  // Only used by the snapshots saved without the offsets of the shards
+  std::vector<uint64_t> grouped_rows;
+  std::vector<uint64_t> shard_offsets;
+};
+
+// The row id mapping is split into shards by key hash. A snapshot save copies the shards one at
+// a time while puts go on, and a put into a shard not copied yet keeps the row the key had when
+// the snapshot was taken. With ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_MAX_SNAPSHOT_DELTAS > 0 a
+// snapshot only holds the rows written since the snapshot last saved or loaded, which it names
+// as its base. As the rows are append only, loading the bases and then the delta gives the table.
 template<typename Key, typename Engine>
 class PersistentTableImpl : public PersistentTable {
  public:
@@ -309,10 +377,28 @@ class PersistentTableImpl : public PersistentTable {
   std::string KeyFilePath(uint64_t chunk_id) const;
   std::string ValueFilePath(uint64_t chunk_id) const;
   std::string IndexFilePath(const std::string& name, uint64_t chunk_id) const;
+  std::string IndexShardsFilePath(const std::string& name, uint64_t chunk_id) const;
   std::string SnapshotDirPath(const std::string& name) const;
   std::string SnapshotListFilePath(const std::string& name) const;
   void LoadSnapshotImpl(const std::string& name);
   void SaveSnapshotImpl(const std::string& name);
+  void WriteSnapshot(const std::string& name, const std::string& base, uint64_t base_table_size,
+                     uint64_t table_size);
+  // The snapshot after all of the snapshots it is based on
+  std::vector<std::string> GetSnapshotChain(const std::string& name) const;
+  void SetSnapshotChain(const std::vector<std::string>& chain);
+  void OpenSnapshotChunk(const std::string& name, const std::string& index_filename,
+                         int mmap_flags, SnapshotChunk<Key>* chunk) const;
+  void ForEachSnapshotEntry(const std::string& name, const std::string& index_filename,
+                            const std::function<void(Key key, uint64_t row)>& Handler) const;
+  void ResetIndex();
+  void RebuildIndex(const std::vector<std::string>& chain);
+  void SetIndexShardReady(uint32_t shard_id);
+  void WaitIndexShards(uint32_t num_keys, const Key* keys);
+  void WaitBackgroundTask();
+  static uint32_t IndexShardId(Key key) {
+    return PersistentTableIndexHash()(static_cast<uint64_t>(key)) % kNumIndexShards;
+  }
   void ParallelFor(size_t total, const ForRange<Engine>& for_range);
 
   std::string root_dir_;
@@ -334,12 +420,27 @@ class PersistentTableImpl : public PersistentTable {
 
   std::recursive_mutex mutex_;
   uint64_t physical_table_size_;
-  robin_hood::unordered_flat_map<Key, uint64_t> row_id_mapping_;
+  std::vector<IndexShard<Key>> index_shards_;
   std::vector<PosixFile> value_files_;
   PosixFile writable_key_file_;
   uint64_t writable_key_file_chunk_id_;
   PosixFileLockGuard lock_;
   bool read_only_;
+
+  uint64_t max_snapshot_deltas_;
+  bool async_snapshot_save_;
+  bool lazy_snapshot_load_;
+  // The snapshot last saved or loaded after its bases, and the size of the table it covers
+  std::vector<std::string> snapshot_chain_;
+  uint64_t snapshot_chain_table_size_;
+  // The size of the table when the snapshot being saved was taken
+  uint64_t snapshot_table_size_;
+  // Saves a snapshot or rebuilds the index in the background
+  std::thread background_task_;
+  std::mutex index_mutex_;
+  std::condition_variable index_cond_;
+  std::vector<bool> index_shard_ready_;
+  std::atomic<bool> index_ready_;
 };
 
 template<typename Key, typename Engine>
@@ -350,11 +451,26 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
       physical_block_size_(options.physical_block_size),
       logical_block_size_(GetLogicalBlockSize(options.physical_block_size, value_size_)),
       blocks_buffer_(options.physical_block_size),
+      index_shards_(kNumIndexShards),
       writable_key_file_chunk_id_(-1),
-      read_only_(options.read_only) {
+      read_only_(options.read_only),
+      snapshot_chain_table_size_(0),
+      snapshot_table_size_(0),
+      index_shard_ready_(kNumIndexShards, true),
+      index_ready_(true) {
   const uint64_t capacity_hint = ParseIntegerFromEnv(
       "ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_CAPACITY_HINT", options.capacity_hint);
-  if (capacity_hint > 0) { row_id_mapping_.reserve(capacity_hint); }
+  if (capacity_hint > 0) {
+    for (auto& shard : index_shards_) {
+      shard.row_id_mapping.reserve(RoundUp(capacity_hint, kNumIndexShards) / kNumIndexShards);
+    }
+  }
+  max_snapshot_deltas_ =
+      ParseIntegerFromEnv("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_MAX_SNAPSHOT_DELTAS", 0);
+  async_snapshot_save_ =
+      ParseBooleanFromEnv("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_ASYNC_SNAPSHOT_SAVE", false);
+  lazy_snapshot_load_ =
+      ParseBooleanFromEnv("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_LAZY_SNAPSHOT_LOAD", false);
   PosixFile::RecursiveCreateDirectory(options.path, 0755);
   const std::string lock_filename = PosixFile::JoinPath(options.path, kLockFileName);
   const bool init = !PosixFile::FileExists(lock_filename);
@@ -407,6 +523,7 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
 
 template<typename Key, typename Engine>
 PersistentTableImpl<Key, Engine>::~PersistentTableImpl() {
+  WaitBackgroundTask();
   for (uint32_t tid = 0; tid < workers_.size(); ++tid) { workers_.at(tid)->Shutdown(); }
 }
 
@@ -419,11 +536,13 @@ template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::GetBlocks(uint32_t num_keys, const void* keys, void* blocks,
                                                  uint32_t* offsets) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
+  WaitIndexShards(num_keys, static_cast<const Key*>(keys));
   ParallelFor(num_keys, [&](Engine* engine, size_t start, size_t end) {
     for (uint64_t i = start; i < end; ++i) {
       const Key key = static_cast<const Key*>(keys)[i];
-      auto it = row_id_mapping_.find(key);
-      if (it == row_id_mapping_.end()) {
+      const auto& row_id_mapping = index_shards_[IndexShardId(key)].row_id_mapping;
+      auto it = row_id_mapping.find(key);
+      if (it == row_id_mapping.end()) {
         offsets[i] = logical_block_size_;
       } else {
         const uint64_t id = it->second;
@@ -522,8 +641,17 @@ void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void*
     }
     bc.Decrease();
   });
+  WaitIndexShards(num_keys, static_cast<const Key*>(keys));
   for (uint64_t i = 0; i < num_keys; ++i) {
-    row_id_mapping_[static_cast<const Key*>(keys)[i]] = start_index + i;
+    const Key key = static_cast<const Key*>(keys)[i];
+    IndexShard<Key>& shard = index_shards_[IndexShardId(key)];
+    if (shard.snapshot_pending) {
+      auto it = shard.row_id_mapping.find(key);
+      if (it != shard.row_id_mapping.end() && it->second < snapshot_table_size_) {
+        shard.snapshot_rows.emplace(key, it->second);
+      }
+    }
+    shard.row_id_mapping[key] = start_index + i;
   }
   bc.WaitForeverUntilCntEqualZero();
 }
@@ -579,72 +707,310 @@ std::string PersistentTableImpl<Key, Engine>::SnapshotListFilePath(const std::st
   return PosixFile::JoinPath(SnapshotDirPath(name), kSnapshotListFileName);
 }
 
+template<typename Key, typename Engine>
+std::string PersistentTableImpl<Key, Engine>::IndexShardsFilePath(const std::string& name,
+                                                                  uint64_t chunk_id) const {
+  return PosixFile::JoinPath(SnapshotDirPath(name),
+                             kIndexShardsFileNamePrefix + GetChunkName(chunk_id));
+}
+
+template<typename Key, typename Engine>
+std::vector<std::string> PersistentTableImpl<Key, Engine>::GetSnapshotChain(
+    const std::string& name) const {
+  std::vector<std::string> chain{name};
+  while (true) {
+    const std::string base_file =
+        PosixFile::JoinPath(SnapshotDirPath(chain.back()), kSnapshotBaseFileName);
+    if (!PosixFile::FileExists(base_file)) { break; }
+    const std::vector<std::string> lines = ReadLines(base_file);
+    CHECK_EQ(lines.size(), 1) << base_file;
+    const std::string& base = lines.front();
+    CHECK(PosixFile::FileExists(SnapshotListFilePath(base)))
+        << "The snapshot " << base << " which the snapshot " << chain.back()
+        << " is based on does not exist";
+    CHECK(std::find(chain.begin(), chain.end(), base) == chain.end())
+        << "The snapshot " << base << " is based on itself";
+    chain.push_back(base);
+  }
+  std::reverse(chain.begin(), chain.end());
+  return chain;
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::SetSnapshotChain(const std::vector<std::string>& chain) {
+  // The snapshots saved without the size of the table can not be the base of a delta
+  const std::string table_size_file =
+      PosixFile::JoinPath(SnapshotDirPath(chain.back()), kSnapshotTableSizeFileName);
+  if (PosixFile::FileExists(table_size_file)) {
+    std::ifstream ifs(table_size_file);
+    ifs >> snapshot_chain_table_size_;
+    snapshot_chain_ = chain;
+  } else {
+    snapshot_chain_table_size_ = 0;
+    snapshot_chain_.clear();
+  }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::OpenSnapshotChunk(const std::string& name,
+                                                         const std::string& index_filename,
+                                                         int mmap_flags,
+                                                         SnapshotChunk<Key>* chunk) const {
+  chunk->chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
+  PosixFile index_file(PosixFile::JoinPath(SnapshotDirPath(name), index_filename), O_RDONLY, 0644);
+  const size_t index_file_size = index_file.Size();
+  CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
+  const size_t n_entries = index_file_size / sizeof(uint64_t);
+  chunk->shard_offsets.assign(kNumIndexShards + 1, 0);
+  if (n_entries == 0) { return; }
+  chunk->index_file.reset(
+      new PosixMappedFile(std::move(index_file), index_file_size, PROT_READ, mmap_flags));
+  PosixFile key_file(KeyFilePath(chunk->chunk_id), O_RDONLY, 0644);
+  const size_t key_file_size = key_file.Size();
+  chunk->key_file.reset(
+      new PosixMappedFile(std::move(key_file), key_file_size, PROT_READ, mmap_flags));
+  chunk->rows = static_cast<const uint64_t*>(chunk->index_file->ptr());
+  chunk->keys = static_cast<const Key*>(chunk->key_file->ptr());
+  const std::string shards_file = IndexShardsFilePath(name, chunk->chunk_id);
+  if (PosixFile::FileExists(shards_file)) {
+    std::ifstream ifs(shards_file, std::ios::binary);
+    ifs.read(reinterpret_cast<char*>(chunk->shard_offsets.data()),
+             chunk->shard_offsets.size() * sizeof(uint64_t));
+    CHECK(ifs.good()) << shards_file;
+    CHECK_EQ(chunk->shard_offsets.back(), n_entries) << shards_file;
+    return;
+  }
+  // Group the rows by shard here for the snapshots saved without the offsets
+  const uint64_t chunk_start_index = chunk->chunk_id * num_values_per_chunk_;
+  std::vector<uint32_t> shard_ids(n_entries);
+  for (size_t i = 0; i < n_entries; ++i) {
+    shard_ids[i] = IndexShardId(chunk->keys[chunk->rows[i] - chunk_start_index]);
+    chunk->shard_offsets[shard_ids[i] + 1] += 1;
+  }
+  for (uint32_t s = 0; s < kNumIndexShards; ++s) {
+    chunk->shard_offsets[s + 1] += chunk->shard_offsets[s];
+  }
+  std::vector<uint64_t> cursors(chunk->shard_offsets.begin(), chunk->shard_offsets.end() - 1);
+  chunk->grouped_rows.resize(n_entries);
+  for (size_t i = 0; i < n_entries; ++i) {
+    chunk->grouped_rows[cursors[shard_ids[i]]++] = chunk->rows[i];
+  }
+  chunk->rows = chunk->grouped_rows.data();
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ForEachSnapshotEntry(
+    const std::string& name, const std::string& index_filename,
+    const std::function<void(Key key, uint64_t row)>& Handler) const {
+  SnapshotChunk<Key> chunk;
+  OpenSnapshotChunk(name, index_filename, MAP_SHARED, &chunk);
+  const uint64_t chunk_start_index = chunk.chunk_id * num_values_per_chunk_;
+  for (uint64_t i = 0; i < chunk.shard_offsets.back(); ++i) {
+    Handler(chunk.keys[chunk.rows[i] - chunk_start_index], chunk.rows[i]);
+  }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ResetIndex() {
+  for (auto& shard : index_shards_) {
+    shard.row_id_mapping.clear();
+    shard.snapshot_rows.clear();
+    shard.snapshot_pending = false;
+  }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::RebuildIndex(const std::vector<std::string>& chain) {
+  int mmap_flags = MAP_SHARED;
+  if (ParseBooleanFromEnv("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_SNAPSHOT_LOAD_MAP_POPULATE",
+                          true)) {
+    mmap_flags |= MAP_POPULATE;
+  }
+  const size_t num_threads = std::max<size_t>(
+      std::min<size_t>(kNumIndexShards, std::thread::hardware_concurrency()), 1);
+  std::vector<std::pair<size_t, std::string>> index_files;
+  for (size_t level = 0; level < chain.size(); ++level) {
+    for (const auto& index_filename : ReadLines(SnapshotListFilePath(chain[level]))) {
+      index_files.emplace_back(level, index_filename);
+    }
+  }
+  std::vector<SnapshotChunk<Key>> chunks(index_files.size());
+  RunInThreads(num_threads, [&](size_t t) {
+    for (size_t i = t; i < index_files.size(); i += num_threads) {
+      OpenSnapshotChunk(chain[index_files[i].first], index_files[i].second, mmap_flags,
+                        &chunks[i]);
+    }
+  });
+  // Every shard is built by one thread from all of the chunks, and can be used once it is done
+  RunInThreads(num_threads, [&](size_t t) {
+    for (uint32_t s = t; s < kNumIndexShards; s += num_threads) {
+      auto& row_id_mapping = index_shards_[s].row_id_mapping;
+      size_t n_entries = 0;
+      for (const auto& chunk : chunks) {
+        n_entries += chunk.shard_offsets[s + 1] - chunk.shard_offsets[s];
+      }
+      row_id_mapping.reserve(row_id_mapping.size() + n_entries);
+      for (size_t c = 0; c < chunks.size(); ++c) {
+        const SnapshotChunk<Key>& chunk = chunks[c];
+        const uint64_t chunk_start_index = chunk.chunk_id * num_values_per_chunk_;
+        for (uint64_t i = chunk.shard_offsets[s]; i < chunk.shard_offsets[s + 1]; ++i) {
+          const uint64_t row = chunk.rows[i];
+          const Key key = chunk.keys[row - chunk_start_index];
+          if (index_files[c].first == 0) {
+            CHECK(row_id_mapping.emplace(key, row).second);
+          } else {
+            // The deltas overwrite the rows of the keys put since their base
+            row_id_mapping[key] = row;
+          }
+        }
+      }
+      SetIndexShardReady(s);
+    }
+  });
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::SetIndexShardReady(uint32_t shard_id) {
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  index_shard_ready_[shard_id] = true;
+  if (std::all_of(index_shard_ready_.begin(), index_shard_ready_.end(),
+                  [](bool ready) { return ready; })) {
+    index_ready_.store(true, std::memory_order_release);
+  }
+  index_cond_.notify_all();
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::WaitIndexShards(uint32_t num_keys, const Key* keys) {
+  if (index_ready_.load(std::memory_order_acquire)) { return; }
+  std::unique_lock<std::mutex> lock(index_mutex_);
+  for (uint32_t i = 0; i < num_keys; ++i) {
+    const uint32_t shard_id = IndexShardId(keys[i]);
+    index_cond_.wait(lock, [&]() { return index_shard_ready_[shard_id]; });
+  }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::WaitBackgroundTask() {
+  if (background_task_.joinable()) { background_task_.join(); }
+}
+
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::LoadSnapshotImpl(const std::string& name) {
+  WaitBackgroundTask();
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
-  row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
-  std::string index_filename;
-  while (std::getline(list_if, index_filename)) {
-    const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
-    PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
-    const size_t index_file_size = index_file.Size();
-    CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
-    const size_t n_entries = index_file_size / sizeof(uint64_t);
-    PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ);
-    PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
-    PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ);
-    const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
-    const Key* keys = static_cast<const Key*>(mapped_key.ptr());
-    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
-    row_id_mapping_.reserve(row_id_mapping_.size() + n_entries);
-    for (size_t i = 0; i < n_entries; ++i) {
-      CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
+  const std::vector<std::string> chain = GetSnapshotChain(name);
+  ResetIndex();
+  SetSnapshotChain(chain);
+  if (lazy_snapshot_load_) {
+    // Lookups and puts wait for the shards of their keys only
+    {
+      std::lock_guard<std::mutex> index_lock(index_mutex_);
+      std::fill(index_shard_ready_.begin(), index_shard_ready_.end(), false);
+      index_ready_.store(false, std::memory_order_release);
     }
+    background_task_ = std::thread([this, chain]() { RebuildIndex(chain); });
+  } else {
+    RebuildIndex(chain);
   }
 }
 
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::SaveSnapshotImpl(const std::string& name) {
   CHECK(!read_only_);
+  WaitBackgroundTask();
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  PosixFile::RecursiveCreateDirectory(SnapshotDirPath(name), 0755);
-  std::ofstream list_ofs(SnapshotListFilePath(name));
-  if (row_id_mapping_.empty()) { return; }
-  std::vector<PosixMappedFile> index_files(value_files_.size());
-  std::vector<uint64_t> counters(value_files_.size());
-  const uint64_t max_index_file_size = num_values_per_chunk_ * sizeof(uint64_t);
-  for (const auto& pair : row_id_mapping_) {
-    const uint64_t chunk_id = pair.second / num_values_per_chunk_;
-    CHECK(chunk_id < value_files_.size());
-    if (index_files[chunk_id].ptr() == nullptr) {
-      PosixFile snapshot_file(IndexFilePath(name, chunk_id), O_CREAT | O_RDWR, 0644);
-      snapshot_file.Truncate(max_index_file_size);
-      index_files[chunk_id] =
-          PosixMappedFile(std::move(snapshot_file), max_index_file_size, PROT_READ | PROT_WRITE);
+  const std::string snapshot_dir = SnapshotDirPath(name);
+  PosixFile::RecursiveCreateDirectory(snapshot_dir, 0755);
+  // The list is written last, so a snapshot does not exist until it is complete
+  RemoveFileIfExists(SnapshotListFilePath(name));
+  RemoveFileIfExists(PosixFile::JoinPath(snapshot_dir, kSnapshotBaseFileName));
+  const bool is_delta =
+      max_snapshot_deltas_ > 0 && !snapshot_chain_.empty()
+      && snapshot_chain_.size() <= max_snapshot_deltas_
+      && std::find(snapshot_chain_.begin(), snapshot_chain_.end(), name) == snapshot_chain_.end();
+  const std::string base = is_delta ? snapshot_chain_.back() : "";
+  const uint64_t base_table_size = is_delta ? snapshot_chain_table_size_ : 0;
+  if (!is_delta) { snapshot_chain_.clear(); }
+  snapshot_chain_.push_back(name);
+  snapshot_chain_table_size_ = physical_table_size_;
+  snapshot_table_size_ = physical_table_size_;
+  for (auto& shard : index_shards_) {
+    shard.snapshot_pending = true;
+    shard.snapshot_rows.clear();
+  }
+  const uint64_t table_size = snapshot_table_size_;
+  if (async_snapshot_save_) {
+    background_task_ = std::thread([this, name, base, base_table_size, table_size]() {
+      WriteSnapshot(name, base, base_table_size, table_size);
+    });
+  } else {
+    WriteSnapshot(name, base, base_table_size, table_size);
+  }
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::WriteSnapshot(const std::string& name,
+                                                     const std::string& base,
+                                                     uint64_t base_table_size,
+                                                     uint64_t table_size) {
+  const uint64_t num_chunks = RoundUp(table_size, num_values_per_chunk_) / num_values_per_chunk_;
+  std::vector<std::vector<uint64_t>> chunk_rows(num_chunks);
+  std::vector<std::vector<uint64_t>> chunk_shard_offsets(
+      num_chunks, std::vector<uint64_t>(kNumIndexShards + 1, 0));
+  for (uint32_t s = 0; s < kNumIndexShards; ++s) {
+    {
+      // Puts only wait for the copy of one shard
+      std::lock_guard<std::recursive_mutex> lock(mutex_);
+      IndexShard<Key>& shard = index_shards_[s];
+      for (const auto& pair : shard.row_id_mapping) {
+        uint64_t row = pair.second;
+        if (row >= table_size) {
+          // Put after the snapshot was taken
+          auto it = shard.snapshot_rows.find(pair.first);
+          if (it == shard.snapshot_rows.end()) { continue; }
+          row = it->second;
+        }
+        if (row < base_table_size) { continue; }
+        chunk_rows[row / num_values_per_chunk_].push_back(row);
+      }
+      shard.snapshot_pending = false;
+      shard.snapshot_rows.clear();
     }
-    uint64_t* indices = static_cast<uint64_t*>(index_files[chunk_id].ptr());
-    uint64_t& count = counters[chunk_id];
-    CHECK_LT(count, num_values_per_chunk_);
-    indices[count] = pair.second;
-    count += 1;
-  }
-  for (size_t i = 0; i < value_files_.size(); ++i) {
-    const uint64_t count = counters[i];
-    if (count > 0) {
-      index_files[i].file().Truncate(count * sizeof(uint64_t));
-      list_ofs << kIndexFileNamePrefix + GetChunkName(i) << std::endl;
-    } else {
-      CHECK(index_files[i].ptr() == nullptr);
+    for (uint64_t c = 0; c < num_chunks; ++c) {
+      chunk_shard_offsets[c][s + 1] = chunk_rows[c].size();
     }
   }
+  const std::string snapshot_dir = SnapshotDirPath(name);
+  std::ostringstream list;
+  for (uint64_t c = 0; c < num_chunks; ++c) {
+    if (chunk_rows[c].empty()) { continue; }
+    WriteFileContent(IndexFilePath(name, c), chunk_rows[c].data(),
+                     chunk_rows[c].size() * sizeof(uint64_t));
+    WriteFileContent(IndexShardsFilePath(name, c), chunk_shard_offsets[c].data(),
+                     chunk_shard_offsets[c].size() * sizeof(uint64_t));
+    list << kIndexFileNamePrefix + GetChunkName(c) << std::endl;
+  }
+  {
+    std::ofstream ofs(PosixFile::JoinPath(snapshot_dir, kSnapshotTableSizeFileName));
+    ofs << table_size << std::endl;
+  }
+  if (!base.empty()) {
+    std::ofstream ofs(PosixFile::JoinPath(snapshot_dir, kSnapshotBaseFileName));
+    ofs << base << std::endl;
+  }
+  const std::string list_file = SnapshotListFilePath(name);
+  const std::string tmp_list_file = list_file + ".tmp";
+  {
+    std::ofstream ofs(tmp_list_file);
+    ofs << list.str();
+  }
+  PCHECK(rename(tmp_list_file.c_str(), list_file.c_str()) == 0);
 }
 
 template<typename Key, typename Engine>
 bool PersistentTableImpl<Key, Engine>::SnapshotExists(const std::string& name) {
+  WaitBackgroundTask();
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   return PosixFile::FileExists(SnapshotListFilePath(name));
 }
@@ -657,40 +1023,45 @@ void PersistentTableImpl<Key, Engine>::LoadSnapshot(const std::string& name) {
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::LoadSnapshot(
     const std::string& name, const std::function<void(Iterator* iter)>& Hook) {
+  WaitBackgroundTask();
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   int mmap_flags = MAP_SHARED;
   if (ParseBooleanFromEnv("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_SNAPSHOT_LOAD_MAP_POPULATE",
                           true)) {
     mmap_flags |= MAP_POPULATE;
   }
-  const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
-  row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
-  std::string index_filename;
-  while (std::getline(list_if, index_filename)) {
-    const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
-    PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
-    const size_t index_file_size = index_file.Size();
-    CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
-    const size_t n_entries = index_file_size / sizeof(uint64_t);
-    PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ, mmap_flags);
-    PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
-    PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ, mmap_flags);
-    const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
-    const Key* keys = static_cast<const Key*>(mapped_key.ptr());
-    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
-    row_id_mapping_.reserve(row_id_mapping_.size() + n_entries);
-    for (size_t i = 0; i < n_entries; ++i) {
-      CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
-    }
-    if (Hook) {
+  const std::vector<std::string> chain = GetSnapshotChain(name);
+  ResetIndex();
+  SetSnapshotChain(chain);
+  RebuildIndex(chain);
+  if (!Hook) { return; }
+  // Skip the entries of the bases which a later delta has overwritten
+  std::function<bool(Key key, uint64_t row)> Filter;
+  if (chain.size() > 1) {
+    Filter = [&](Key key, uint64_t row) {
+      return index_shards_[IndexShardId(key)].row_id_mapping.at(key) == row;
+    };
+  }
+  for (const auto& snapshot_name : chain) {
+    const std::string snapshot_base = SnapshotDirPath(snapshot_name);
+    for (const auto& index_filename : ReadLines(SnapshotListFilePath(snapshot_name))) {
+      const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
+      PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
+      const size_t index_file_size = index_file.Size();
+      CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
+      if (index_file_size == 0) { continue; }
+      const size_t n_entries = index_file_size / sizeof(uint64_t);
+      PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ, mmap_flags);
+      PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
+      const size_t key_file_size = key_file.Size();
+      PosixMappedFile mapped_key(std::move(key_file), key_file_size, PROT_READ, mmap_flags);
       PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
-      PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ, mmap_flags);
-      ChunkIteratorImpl<Key> chunk_iterator(value_size_, logical_block_size_, num_values_per_block_,
-                                            num_values_per_chunk_, chunk_id, n_entries, keys,
-                                            indices, mapped_value.ptr());
+      const size_t value_file_size = value_file.Size();
+      PosixMappedFile mapped_value(std::move(value_file), value_file_size, PROT_READ, mmap_flags);
+      ChunkIteratorImpl<Key> chunk_iterator(
+          value_size_, logical_block_size_, num_values_per_block_, num_values_per_chunk_,
+          chunk_id, n_entries, static_cast<const Key*>(mapped_key.ptr()),
+          static_cast<const uint64_t*>(mapped_index.ptr()), mapped_value.ptr(), Filter);
       Hook(&chunk_iterator);
     }
   }
@@ -703,6 +1074,7 @@ void PersistentTableImpl<Key, Engine>::SaveSnapshot(const std::string& name) {
 
 template<typename Key, typename Engine>
 PersistentTable::Iterator* PersistentTableImpl<Key, Engine>::ReadSnapshot(const std::string& name) {
+  WaitBackgroundTask();
   return new SnapshotIteratorImpl<Key, Engine>(this, name, value_size_, logical_block_size_,
                                                num_values_per_block_, num_values_per_chunk_);
 }
@@ -742,10 +1114,24 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
         num_values_per_block_(num_values_per_block),
         num_values_per_chunk_(num_values_per_chunk),
         current_chunk_(0) {
-    const std::string snapshot_list = table_->SnapshotListFilePath(snapshot_name);
-    std::ifstream list_if(snapshot_list);
-    std::string index_filename;
-    while (std::getline(list_if, index_filename)) { indices_names_.push_back(index_filename); }
+    const std::vector<std::string> chain = table_->GetSnapshotChain(snapshot_name);
+    for (const auto& name : chain) {
+      for (const auto& index_filename : ReadLines(table_->SnapshotListFilePath(name))) {
+        indices_names_.emplace_back(name, index_filename);
+      }
+    }
+    if (chain.size() > 1) {
+      // The final rows of the keys put since the first snapshot of the chain
+      for (const auto& name_and_index : indices_names_) {
+        if (name_and_index.first == chain.front()) { continue; }
+        table_->ForEachSnapshotEntry(name_and_index.first, name_and_index.second,
+                                     [&](Key key, uint64_t row) { delta_rows_[key] = row; });
+      }
+      filter_ = [this](Key key, uint64_t row) {
+        auto it = delta_rows_.find(key);
+        return it == delta_rows_.end() || it->second == row;
+      };
+    }
   }
   ~SnapshotIteratorImpl() override = default;
 
@@ -753,10 +1139,11 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
     *return_keys = 0;
     while (current_chunk_ < indices_names_.size()) {
       if (!chunk_iterator_) {
-        const std::string snapshot_base = table_->SnapshotDirPath(snapshot_name_);
-        const uint64_t chunk_id = GetChunkId(indices_names_[current_chunk_], kIndexFileNamePrefix);
-        PosixFile index_file(PosixFile::JoinPath(snapshot_base, indices_names_[current_chunk_]),
-                             O_RDONLY, 0644);
+        const auto& name_and_index = indices_names_[current_chunk_];
+        const std::string snapshot_base = table_->SnapshotDirPath(name_and_index.first);
+        const uint64_t chunk_id = GetChunkId(name_and_index.second, kIndexFileNamePrefix);
+        PosixFile index_file(PosixFile::JoinPath(snapshot_base, name_and_index.second), O_RDONLY,
+                             0644);
         const size_t index_file_size = index_file.Size();
         CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
         if (index_file_size == 0) {
@@ -773,7 +1160,7 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
         chunk_iterator_.reset(new ChunkIteratorImpl<Key>(
             value_size_, logical_block_size_, num_values_per_block_, num_values_per_chunk_,
             chunk_id, n_entries, static_cast<const Key*>(keys_file_->ptr()),
-            static_cast<const uint64_t*>(indices_file_->ptr()), values_file_->ptr()));
+            static_cast<const uint64_t*>(indices_file_->ptr()), values_file_->ptr(), filter_));
       }
       chunk_iterator_->Next(num_keys, return_keys, keys, values);
       if (*return_keys == 0) {
@@ -799,7 +1186,10 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
   uint32_t num_values_per_block_;
   uint64_t num_values_per_chunk_;
   size_t current_chunk_;
-  std::vector<std::string> indices_names_;
+  // The snapshot and the index file of every chunk, over the snapshots of the chain
+  std::vector<std::pair<std::string, std::string>> indices_names_;
+  robin_hood::unordered_flat_map<Key, uint64_t> delta_rows_;
+  std::function<bool(Key key, uint64_t row)> filter_;
   std::unique_ptr<PosixMappedFile> keys_file_;
   std::unique_ptr<PosixMappedFile> values_file_;
   std::unique_ptr<PosixMappedFile> indices_file_;
@@ -23,12 +23,16 @@ namespace oneflow {
 
 namespace embedding {
 
-#if defined(WITH_CUDA) || defined(WITH_ROCM)
-
 struct PersistentTableKeyValueStoreOptions {
   PersistentTableOptions table_options{};
 };
 
+// Serves the keys and values in host memory, for the embeddings placed on cpu
+std::unique_ptr<KeyValueStore> NewHostPersistentTableKeyValueStore(
+    const PersistentTableKeyValueStoreOptions& options);
+
+#if defined(WITH_CUDA) || defined(WITH_ROCM)
+
 std::unique_ptr<KeyValueStore> NewPersistentTableKeyValueStore(
     const PersistentTableKeyValueStoreOptions& options);
 
@@ -0,0 +1,214 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/persistent_table.h"
+#include <gtest/gtest.h>
+#include "oneflow/core/embedding/posix_file.h"
+#include <dirent.h>
+#include <numeric>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+#ifdef __linux__
+
+constexpr uint32_t kValueLength = 4;
+
+std::string CreateTempDirectory() {
+  const char* tmp_env = getenv("TMPDIR");
+  const char* tmp_dir = tmp_env == nullptr ? "/tmp" : tmp_env;
+  std::string tpl = std::string(tmp_dir) + "/test_persistent_table_XXXXXX";
+  char* path = mkdtemp(const_cast<char*>(tpl.c_str()));
+  PCHECK(path != nullptr);
+  return std::string(path);
+}
+
+std::unique_ptr<PersistentTable> NewTestTable(const std::string& path) {
+  PersistentTableOptions options;
+  options.path = path;
+  options.key_size = sizeof(uint64_t);
+  options.value_size = kValueLength * sizeof(float);
+  options.physical_block_size = 512;
+  // Small chunks, so that the snapshots span several of them
+  options.target_chunk_size_mb = 1;
+  return NewPersistentTable(options);
+}
+
+float ValueOf(uint64_t key, uint32_t version) { return key * 10 + version; }
+
+void PutKeys(PersistentTable* table, uint64_t begin, uint64_t end, uint64_t step,
+             uint32_t version) {
+  std::vector<uint64_t> keys;
+  for (uint64_t key = begin; key < end; key += step) { keys.push_back(key); }
+  std::vector<float> values(keys.size() * kValueLength);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    std::fill_n(values.data() + i * kValueLength, kValueLength, ValueOf(keys[i], version));
+  }
+  table->Put(keys.size(), keys.data(), values.data());
+}
+
+// versions[key] is the version the key must have, or -1 if it must be missing
+void CheckKeys(PersistentTable* table, const std::vector<int32_t>& versions) {
+  std::vector<uint64_t> keys(versions.size());
+  std::iota(keys.begin(), keys.end(), 0);
+  std::vector<float> values(keys.size() * kValueLength);
+  std::vector<uint32_t> missing_indices(keys.size());
+  uint32_t n_missing = 0;
+  table->Get(keys.size(), keys.data(), values.data(), &n_missing, missing_indices.data());
+  std::vector<bool> missing(keys.size(), false);
+  for (uint32_t i = 0; i < n_missing; ++i) { missing[missing_indices[i]] = true; }
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(missing[i], versions[i] < 0) << "key " << i;
+    if (versions[i] >= 0) { ASSERT_EQ(values[i * kValueLength], ValueOf(i, versions[i])); }
+  }
+}
+
+void CheckSnapshotContent(PersistentTable* table, const std::string& name,
+                          const std::vector<int32_t>& versions) {
+  std::unique_ptr<PersistentTable::Iterator> iter(table->ReadSnapshot(name));
+  std::vector<uint64_t> keys(1024);
+  std::vector<float> values(keys.size() * kValueLength);
+  std::vector<bool> seen(versions.size(), false);
+  while (true) {
+    uint32_t n_result = 0;
+    iter->Next(keys.size(), &n_result, keys.data(), values.data());
+    if (n_result == 0) { break; }
+    for (uint32_t i = 0; i < n_result; ++i) {
+      ASSERT_LT(keys[i], versions.size());
+      ASSERT_FALSE(seen[keys[i]]) << "key " << keys[i] << " is returned twice";
+      seen[keys[i]] = true;
+      ASSERT_EQ(values[i * kValueLength], ValueOf(keys[i], versions[keys[i]]));
+    }
+  }
+  for (size_t i = 0; i < versions.size(); ++i) { ASSERT_EQ(seen[i], versions[i] >= 0); }
+}
+
+// Saves s0, s1 and s2, with some keys updated and some added between them, and returns the
+// versions of the keys in every snapshot
+std::vector<std::vector<int32_t>> SaveSnapshots(PersistentTable* table, uint64_t num_keys) {
+  std::vector<std::vector<int32_t>> versions(3, std::vector<int32_t>(num_keys, -1));
+  PutKeys(table, 0, num_keys / 2, 1, 0);
+  std::fill_n(versions[0].begin(), num_keys / 2, 0);
+  table->SaveSnapshot("s0");
+  PutKeys(table, 0, num_keys, 3, 1);
+  versions[1] = versions[0];
+  for (uint64_t key = 0; key < num_keys; key += 3) { versions[1][key] = 1; }
+  table->SaveSnapshot("s1");
+  PutKeys(table, num_keys / 2, num_keys, 1, 2);
+  versions[2] = versions[1];
+  std::fill(versions[2].begin() + num_keys / 2, versions[2].end(), 2);
+  table->SaveSnapshot("s2");
+  return versions;
+}
+
+void TestSnapshots(bool remove_shard_offsets) {
+  const std::string path = CreateTempDirectory();
+  const uint64_t num_keys = 100000;
+  std::unique_ptr<PersistentTable> table = NewTestTable(path);
+  const auto versions = SaveSnapshots(table.get(), num_keys);
+  table.reset();
+  if (remove_shard_offsets) {
+    // Snapshots saved by older versions have no offsets of the index shards
+    for (const std::string name : {"s0", "s1", "s2"}) {
+      const std::string snapshot_dir = PosixFile::JoinPath(path, "snapshots/" + name);
+      DIR* dir = opendir(snapshot_dir.c_str());
+      PCHECK(dir != nullptr);
+      std::vector<std::string> shards_files;
+      struct dirent* ent = nullptr;
+      while ((ent = readdir(dir)) != nullptr) {
+        const std::string file_name = ent->d_name;
+        if (file_name.rfind("index_shards-", 0) == 0) { shards_files.push_back(file_name); }
+      }
+      PCHECK(closedir(dir) == 0);
+      ASSERT_FALSE(shards_files.empty());
+      for (const auto& file_name : shards_files) {
+        PCHECK(unlink(PosixFile::JoinPath(snapshot_dir, file_name).c_str()) == 0);
+      }
+    }
+  }
+  table = NewTestTable(path);
+  for (int i : {2, 0, 1}) {
+    const std::string name = "s" + std::to_string(i);
+    ASSERT_TRUE(table->SnapshotExists(name));
+    table->LoadSnapshot(name);
+    CheckKeys(table.get(), versions[i]);
+    CheckSnapshotContent(table.get(), name, versions[i]);
+  }
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+class ScopedEnv final {
+ public:
+  ScopedEnv(const std::string& name, const std::string& value) : name_(name) {
+    setenv(name.c_str(), value.c_str(), 1);
+  }
+  ~ScopedEnv() { unsetenv(name_.c_str()); }
+
+ private:
+  std::string name_;
+};
+
+#endif  // __linux__
+
+}  // namespace
+
+#ifdef __linux__
+
+TEST(PersistentTable, FullSnapshot) { TestSnapshots(false); }
+
+TEST(PersistentTable, DeltaSnapshot) {
+  ScopedEnv env("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_MAX_SNAPSHOT_DELTAS", "2");
+  TestSnapshots(false);
+}
+
+TEST(PersistentTable, SnapshotWithoutShardOffsets) {
+  ScopedEnv env("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_MAX_SNAPSHOT_DELTAS", "2");
+  TestSnapshots(true);
+}
+
+TEST(PersistentTable, AsyncSaveAndLazyLoad) {
+  ScopedEnv async_save("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_ASYNC_SNAPSHOT_SAVE", "1");
+  ScopedEnv lazy_load("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_LAZY_SNAPSHOT_LOAD", "1");
+  const std::string path = CreateTempDirectory();
+  const uint64_t num_keys = 100000;
+  std::unique_ptr<PersistentTable> table = NewTestTable(path);
+  PutKeys(table.get(), 0, num_keys, 1, 0);
+  table->SaveSnapshot("s0");
+  // Overwrite all of the keys while the snapshot may still be written
+  PutKeys(table.get(), 0, num_keys, 1, 1);
+  CheckKeys(table.get(), std::vector<int32_t>(num_keys, 1));
+  table->LoadSnapshot("s0");
+  CheckKeys(table.get(), std::vector<int32_t>(num_keys, 0));
+  PutKeys(table.get(), 0, num_keys, 2, 2);
+  std::vector<int32_t> versions(num_keys, 0);
+  for (uint64_t key = 0; key < num_keys; key += 2) { versions[key] = 2; }
+  table->SaveSnapshot("s1");
+  table.reset();
+  table = NewTestTable(path);
+  table->LoadSnapshot("s1");
+  CheckKeys(table.get(), versions);
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+#endif  // __linux__
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,95 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_COMMON_PRIMITIVE_ADD_ND_H_
+#define ONEFLOW_CORE_EP_COMMON_PRIMITIVE_ADD_ND_H_
+
+#include "oneflow/core/ep/include/primitive/add_nd.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace add_nd {
+
+constexpr size_t kMaxNumDims = 8;
+
+struct AddNdSrc {
+  const void* src;
+  int64_t src_dims[kMaxNumDims];
+  int64_t src_pos[kMaxNumDims];
+  int64_t dst_pos[kMaxNumDims];
+  int64_t extent[kMaxNumDims];
+};
+
+// Drops the sources with nothing to add, and merges every axis fully covered by all the
+// remaining sources into the previous one
+inline void SimplifyAddNd(size_t num_dims, const int64_t* dst_dims, size_t arity,
+                          const void* const* srcs, const int64_t* const* src_dims,
+                          const int64_t* const* src_pos, const int64_t* const* dst_pos,
+                          const int64_t* const* extent, size_t* simplified_num_dims,
+                          int64_t* simplified_dst_dims, std::vector<AddNdSrc>* simplified_srcs) {
+  CHECK_GT(num_dims, 0);
+  CHECK_LE(num_dims, kMaxNumDims);
+  std::vector<size_t> valid_srcs;
+  for (size_t i = 0; i < arity; ++i) {
+    if (std::all_of(extent[i], extent[i] + num_dims, [](int64_t dim) { return dim > 0; })) {
+      valid_srcs.push_back(i);
+    }
+  }
+  simplified_srcs->resize(valid_srcs.size());
+  for (size_t i = 0; i < valid_srcs.size(); ++i) {
+    simplified_srcs->at(i).src = srcs[valid_srcs.at(i)];
+  }
+  size_t valid_num_dims = 0;
+  for (size_t d = 0; d < num_dims; ++d) {
+    const bool fully_covered =
+        std::all_of(valid_srcs.cbegin(), valid_srcs.cend(), [&](size_t i) {
+          return src_dims[i][d] == dst_dims[d] && extent[i][d] == dst_dims[d] && src_pos[i][d] == 0
+                 && dst_pos[i][d] == 0;
+        });
+    if (d != 0 && fully_covered) {
+      simplified_dst_dims[valid_num_dims - 1] *= dst_dims[d];
+      for (auto& src : *simplified_srcs) {
+        src.src_dims[valid_num_dims - 1] *= dst_dims[d];
+        src.src_pos[valid_num_dims - 1] *= dst_dims[d];
+        src.dst_pos[valid_num_dims - 1] *= dst_dims[d];
+        src.extent[valid_num_dims - 1] *= dst_dims[d];
+      }
+    } else {
+      simplified_dst_dims[valid_num_dims] = dst_dims[d];
+      for (size_t i = 0; i < valid_srcs.size(); ++i) {
+        const size_t src_index = valid_srcs.at(i);
+        auto& src = simplified_srcs->at(i);
+        src.src_dims[valid_num_dims] = src_dims[src_index][d];
+        src.src_pos[valid_num_dims] = src_pos[src_index][d];
+        src.dst_pos[valid_num_dims] = dst_pos[src_index][d];
+        src.extent[valid_num_dims] = extent[src_index][d];
+      }
+      valid_num_dims += 1;
+    }
+  }
+  *simplified_num_dims = valid_num_dims;
+}
+
+}  // namespace add_nd
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_COMMON_PRIMITIVE_ADD_ND_H_
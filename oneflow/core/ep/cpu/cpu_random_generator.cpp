@@ -21,17 +21,118 @@ limitations under the License.
 namespace oneflow {
 namespace ep {
 
+namespace {
+
+constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+constexpr int kPhiloxRounds = 10;
+// Counter blocks generated together by Fill, in lanes the compiler can vectorize
+constexpr int kPhiloxBatchBlocks = 16;
+
+inline void PhiloxRound(uint32_t* c0, uint32_t* c1, uint32_t* c2, uint32_t* c3, uint32_t k0,
+                        uint32_t k1) {
+  const uint64_t p0 = static_cast<uint64_t>(kPhiloxM0) * *c0;
+  const uint64_t p1 = static_cast<uint64_t>(kPhiloxM1) * *c2;
+  *c0 = static_cast<uint32_t>(p1 >> 32) ^ *c1 ^ k0;
+  *c1 = static_cast<uint32_t>(p1);
+  *c2 = static_cast<uint32_t>(p0 >> 32) ^ *c3 ^ k1;
+  *c3 = static_cast<uint32_t>(p0);
+}
+
+}  // namespace
+
+std::array<uint32_t, 4> Philox4x32Engine::Block(std::array<uint32_t, 4> counter,
+                                                std::array<uint32_t, 2> key) {
+  for (int r = 0; r < kPhiloxRounds; ++r) {
+    PhiloxRound(&counter[0], &counter[1], &counter[2], &counter[3], key[0], key[1]);
+    key[0] += kPhiloxW0;
+    key[1] += kPhiloxW1;
+  }
+  return counter;
+}
+
+void Philox4x32Engine::Fill(uint64_t offset, int64_t n, uint32_t* out) const {
+  uint64_t block = offset / 4;
+  const int64_t skip = offset % 4;
+  if (skip != 0 && n > 0) {
+    const std::array<uint32_t, 4> numbers = GenerateBlock(block);
+    const int64_t count = std::min<int64_t>(4 - skip, n);
+    std::copy(numbers.begin() + skip, numbers.begin() + skip + count, out);
+    out += count;
+    n -= count;
+    block += 1;
+  }
+  while (n >= 4 * kPhiloxBatchBlocks) {
+    uint32_t c0[kPhiloxBatchBlocks];
+    uint32_t c1[kPhiloxBatchBlocks];
+    uint32_t c2[kPhiloxBatchBlocks];
+    uint32_t c3[kPhiloxBatchBlocks];
+    for (int j = 0; j < kPhiloxBatchBlocks; ++j) {
+      c0[j] = static_cast<uint32_t>(block + j);
+      c1[j] = static_cast<uint32_t>((block + j) >> 32);
+      c2[j] = subsequence_[0];
+      c3[j] = subsequence_[1];
+    }
+    uint32_t k0 = key_[0];
+    uint32_t k1 = key_[1];
+    for (int r = 0; r < kPhiloxRounds; ++r) {
+      for (int j = 0; j < kPhiloxBatchBlocks; ++j) {
+        PhiloxRound(&c0[j], &c1[j], &c2[j], &c3[j], k0, k1);
+      }
+      k0 += kPhiloxW0;
+      k1 += kPhiloxW1;
+    }
+    for (int j = 0; j < kPhiloxBatchBlocks; ++j) {
+      out[4 * j] = c0[j];
+      out[4 * j + 1] = c1[j];
+      out[4 * j + 2] = c2[j];
+      out[4 * j + 3] = c3[j];
+    }
+    out += 4 * kPhiloxBatchBlocks;
+    n -= 4 * kPhiloxBatchBlocks;
+    block += kPhiloxBatchBlocks;
+  }
+  while (n > 0) {
+    const std::array<uint32_t, 4> numbers = GenerateBlock(block);
+    const int64_t count = std::min<int64_t>(4, n);
+    std::copy(numbers.begin(), numbers.begin() + count, out);
+    out += count;
+    n -= count;
+    block += 1;
+  }
+}
+
 struct CPUGeneratorState {
   static constexpr int64_t state_size = std::mt19937::state_size;  // 624
   int64_t states[state_size] = {};
   int64_t seed = 0;
+  int64_t philox_offset = 0;
 };
 constexpr int64_t CPUGeneratorState::state_size;
+// The states saved before the philox offset was added
+constexpr size_t kLegacyCPUGeneratorStateSize = sizeof(CPUGeneratorState) - sizeof(int64_t);
+
+CPUGenerator::CPUGenerator(uint64_t seed, int device_index)
+    : RandomGenerator(),
+      seed_(seed),
+      engine_(seed),
+      torch_engine_(seed),
+      use_philox_(ParseBooleanFromEnv("ONEFLOW_CPU_RANDOM_GENERATOR_USE_PHILOX", false)) {}
 
 void CPUGenerator::set_current_seed(uint64_t seed) {
   seed_ = seed;
   engine_.seed(seed_);
   torch_engine_ = pytorch_mt19937_engine(seed);
+  philox_offset_ = 0;
+}
+
+uint64_t CPUGenerator::get_philox_offset(uint64_t increment) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t offset = philox_offset_;
+  philox_offset_ += increment;
+  return offset;
 }
 
 size_t CPUGenerator::GetStateSize() const { return sizeof(CPUGeneratorState); }
@@ -54,14 +155,18 @@ void CPUGenerator::GetState(size_t state_size, void* state) const {
     local_state.states[i] = std::atoll(splits[i].data());
   }
   local_state.seed = current_seed();
+  local_state.philox_offset = philox_offset_;
   memcpy(state, &local_state, sizeof(CPUGeneratorState));
 }
 
 void CPUGenerator::SetState(size_t state_size, const void* state) {
-  CHECK_EQ_OR_THROW(state_size, GetStateSize())
+  CHECK_OR_THROW(state_size == GetStateSize() || state_size == kLegacyCPUGeneratorStateSize)
       << "state size of cpu generator should be equal to " << GetStateSize();
-  const CPUGeneratorState* local_state = static_cast<const CPUGeneratorState*>(state);
+  CPUGeneratorState local_state_buffer;
+  memcpy(&local_state_buffer, state, state_size);
+  const CPUGeneratorState* local_state = &local_state_buffer;
   seed_ = local_state->seed;
+  philox_offset_ = local_state->philox_offset;
   std::stringstream ss;
   for (int i = 0; i < CPUGeneratorState::state_size; ++i) { ss << local_state->states[i] << " "; }
   ss << CPUGeneratorState::state_size;
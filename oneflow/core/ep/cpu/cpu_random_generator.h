@@ -114,10 +114,37 @@ class pytorch_mt19937_engine {
   }
 };
 
+// Philox4x32-10 of "Parallel Random Numbers: As Easy as 1, 2, 3", the generator of curand. The
+// numbers of a stream are computed from the key and their position only, so any range of the
+// stream can be generated on its own and a stream can be split between threads.
+class Philox4x32Engine {
+ public:
+  explicit Philox4x32Engine(uint64_t seed, uint64_t subsequence = 0)
+      : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+        subsequence_{static_cast<uint32_t>(subsequence),
+                     static_cast<uint32_t>(subsequence >> 32)} {}
+
+  // Writes the numbers [offset, offset + n) of the stream to out
+  void Fill(uint64_t offset, int64_t n, uint32_t* out) const;
+
+  // The 4 numbers of the counter (c0, c1, c2, c3) under the key (k0, k1)
+  static std::array<uint32_t, 4> Block(std::array<uint32_t, 4> counter,
+                                       std::array<uint32_t, 2> key);
+
+ private:
+  std::array<uint32_t, 4> GenerateBlock(uint64_t block) const {
+    return Block({static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32),
+                  subsequence_[0], subsequence_[1]},
+                 key_);
+  }
+
+  std::array<uint32_t, 2> key_;
+  std::array<uint32_t, 2> subsequence_;
+};
+
 class CPUGenerator : public RandomGenerator {
  public:
-  explicit CPUGenerator(uint64_t seed, int device_index)
-      : RandomGenerator(), seed_(seed), engine_(seed), torch_engine_(seed) {}
+  explicit CPUGenerator(uint64_t seed, int device_index);
 
   virtual ~CPUGenerator() = default;
 
@@ -128,6 +155,13 @@ class CPUGenerator : public RandomGenerator {
 
   pytorch_mt19937_engine& torch_engine() { return torch_engine_; }
 
+  // Whether the kernels draw their numbers from the philox stream instead of engine(), so that
+  // they can generate them in parallel, set by ONEFLOW_CPU_RANDOM_GENERATOR_USE_PHILOX
+  bool use_philox() const { return use_philox_; }
+  Philox4x32Engine philox_engine() const { return Philox4x32Engine(seed_); }
+  // Reserves the next increment numbers of the philox stream and returns the offset of the first
+  uint64_t get_philox_offset(uint64_t increment);
+
   std::string device_type_name() const override { return "cpu"; }
   int64_t device_index() const override { return 0; }
 
@@ -143,6 +177,10 @@ class CPUGenerator : public RandomGenerator {
   //                     refer to
   //                     https://github.com/pytorch/pytorch/blob/master/aten/src/ATen/CPUGenerator.cpp#L206
   pytorch_mt19937_engine torch_engine_;
+
+ private:
+  bool use_philox_;
+  uint64_t philox_offset_ = 0;
 };
 
 }  // namespace ep
@@ -0,0 +1,77 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/cpu/cpu_random_generator.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace test {
+
+TEST(Philox4x32Engine, KnownAnswers) {
+  // The known answer tests of Random123
+  EXPECT_EQ(Philox4x32Engine::Block({0, 0, 0, 0}, {0, 0}),
+            (std::array<uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+  EXPECT_EQ(Philox4x32Engine::Block({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                                    {0xffffffff, 0xffffffff}),
+            (std::array<uint32_t, 4>{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+  EXPECT_EQ(Philox4x32Engine::Block({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                                    {0xa4093822, 0x299f31d0}),
+            (std::array<uint32_t, 4>{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(Philox4x32Engine, FillRanges) {
+  const Philox4x32Engine engine(0x123456789abcdefULL, 7);
+  const int64_t n = 1000;
+  std::vector<uint32_t> expected(n);
+  for (int64_t block = 0; block < n / 4; ++block) {
+    const std::array<uint32_t, 4> numbers = Philox4x32Engine::Block(
+        {static_cast<uint32_t>(block), 0, 7, 0}, {0x89abcdef, 0x01234567});
+    std::copy(numbers.begin(), numbers.end(), expected.begin() + block * 4);
+  }
+  std::vector<uint32_t> all(n);
+  engine.Fill(0, n, all.data());
+  EXPECT_EQ(all, expected);
+  // Any range of the stream is the same as in the whole stream
+  for (int64_t begin : {0, 1, 3, 5, 64, 67, 130}) {
+    for (int64_t size : {0, 1, 2, 5, 64, 65, 130, 600}) {
+      std::vector<uint32_t> range(size);
+      engine.Fill(begin, size, range.data());
+      EXPECT_TRUE(std::equal(range.begin(), range.end(), expected.begin() + begin))
+          << "begin " << begin << " size " << size;
+    }
+  }
+}
+
+TEST(CPUGenerator, PhiloxOffsetState) {
+  CPUGenerator generator(1, 0);
+  EXPECT_EQ(generator.get_philox_offset(12), 0U);
+  EXPECT_EQ(generator.get_philox_offset(8), 12U);
+  std::vector<uint8_t> state(generator.GetStateSize());
+  generator.GetState(state.size(), state.data());
+  EXPECT_EQ(generator.get_philox_offset(4), 20U);
+  generator.SetState(state.size(), state.data());
+  EXPECT_EQ(generator.get_philox_offset(4), 20U);
+  generator.set_current_seed(2);
+  EXPECT_EQ(generator.get_philox_offset(4), 0U);
+}
+
+}  // namespace test
+
+}  // namespace ep
+
+}  // namespace oneflow
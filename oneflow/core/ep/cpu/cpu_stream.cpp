@@ -28,6 +28,11 @@ Maybe<void> CpuStream::Sync() { return Maybe<void>::Ok(); }
 
 void CpuStream::RecordEvent(Event* /*event*/) {}
 
+Maybe<void> CpuStream::OnExecutionContextSetup() {
+  BindCurrentThreadToCpus(cpu_ids_);
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> CpuStream::InitThreadRuntime() {
   const auto thread_runtime_type = GetStringFromEnv("OF_THREADING_RUNTIME", [] {
     if (thread::IsTbbEnabled()) { return "TBB"; }
@@ -62,19 +62,36 @@ class CpuStream : public Stream {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CpuStream);
 
-  explicit CpuStream(CpuDevice* device) : device_(device) {
+  explicit CpuStream(CpuDevice* device) : device_(device), num_threads_(0) {
     CHECK_JUST(InitThreadRuntime());
 #ifdef WITH_ONEDNN
     onednn_executor_ = std::make_unique<ep::OneDnnExecutor>(this);
 #endif
   }
 
+  // Runs the parallel parts of kernels with thread_runtime and num_threads threads instead of the
+  // runtime and the thread number shared by the device. The thread that sets up the execution
+  // context takes part in the parallel parts, and is bound to cpu_ids if it is not empty.
+  CpuStream(CpuDevice* device, std::shared_ptr<thread::RuntimeBase> thread_runtime,
+            size_t num_threads, std::vector<int32_t> cpu_ids)
+      : device_(device),
+        num_threads_(num_threads),
+        cpu_ids_(std::move(cpu_ids)),
+        thread_runtime_(std::move(thread_runtime)) {
+#ifdef WITH_ONEDNN
+    onednn_executor_ = std::make_unique<ep::OneDnnExecutor>(this);
+#endif
+  }
+
   ~CpuStream() override = default;
 
   DeviceType device_type() const override;
   CpuDevice* device() const override;
   Maybe<void> Sync() override;
   void RecordEvent(Event* event) override;
+  Maybe<void> OnExecutionContextSetup() override;
+
+  size_t num_threads() const { return num_threads_ > 0 ? num_threads_ : device_->GetNumThreads(); }
 
   template<typename F>
   void ParallelFor(int64_t begin, int64_t end, const F& func) {
@@ -83,7 +100,7 @@ class CpuStream : public Stream {
 
   template<typename F>
   void ParallelFor(int64_t begin, int64_t end, const F& func, size_t grain_size) {
-    thread_runtime_->ParallelFor(begin, end, func, device()->GetNumThreads(), grain_size);
+    thread_runtime_->ParallelFor(begin, end, func, num_threads(), grain_size);
   }
 
 #ifdef WITH_ONEDNN
@@ -92,6 +109,9 @@ class CpuStream : public Stream {
 
  private:
   CpuDevice* device_;
+  // 0 means the thread number of the device
+  size_t num_threads_;
+  std::vector<int32_t> cpu_ids_;
   static constexpr size_t kParallelForDefaultGrain = 32768;
   std::shared_ptr<thread::RuntimeBase> thread_runtime_;
 
@@ -119,7 +139,7 @@ class OneDnnExecutor {
 
   template<typename F>
   void Launch(const F& f) {
-    CpuNumThreadsGuard guard(cpu_stream_->device()->GetNumThreads());
+    CpuNumThreadsGuard guard(cpu_stream_->num_threads());
     f(engine_.get(), stream_.get());
     stream_->wait();
   }
@@ -0,0 +1,130 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/add_nd.h"
+#include "oneflow/core/ep/common/primitive/add_nd.h"
+#include "oneflow/core/ep/common/primitive/util.h"
+#include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+using add_nd::AddNdSrc;
+using add_nd::kMaxNumDims;
+
+// Every row of dst along the last axis is zeroed and then accumulated from the covering rows of
+// the sources while it stays in cache
+template<typename T>
+void AddNdRows(size_t num_dims, T* dst, const int64_t* dst_dims, const std::vector<AddNdSrc>& srcs,
+               int64_t row_begin, int64_t row_end) {
+  const int64_t row_size = dst_dims[num_dims - 1];
+  int64_t row_index[kMaxNumDims];
+  for (int64_t row = row_begin; row < row_end; ++row) {
+    int64_t remaining = row;
+    for (int64_t d = static_cast<int64_t>(num_dims) - 2; d >= 0; --d) {
+      row_index[d] = remaining % dst_dims[d];
+      remaining /= dst_dims[d];
+    }
+    T* dst_row = dst + row * row_size;
+    std::fill(dst_row, dst_row + row_size, static_cast<T>(0));
+    for (const AddNdSrc& src : srcs) {
+      bool covered = true;
+      int64_t src_offset = 0;
+      for (size_t d = 0; d + 1 < num_dims; ++d) {
+        const int64_t index = row_index[d] - src.dst_pos[d];
+        if (index < 0 || index >= src.extent[d]) {
+          covered = false;
+          break;
+        }
+        src_offset = src_offset * src.src_dims[d] + index + src.src_pos[d];
+      }
+      if (!covered) { continue; }
+      const size_t last = num_dims - 1;
+      const T* src_row =
+          reinterpret_cast<const T*>(src.src) + src_offset * src.src_dims[last] + src.src_pos[last];
+      T* dst_ptr = dst_row + src.dst_pos[last];
+      for (int64_t i = 0; i < src.extent[last]; ++i) { dst_ptr[i] += src_row[i]; }
+    }
+  }
+}
+
+template<typename T>
+class AddNdImpl : public AddNd {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AddNdImpl);
+  AddNdImpl() = default;
+  ~AddNdImpl() override = default;
+
+  void Launch(Stream* stream, size_t num_dims, void* dst, const int64_t* dst_dims, size_t arity,
+              const void* const* srcs, const int64_t* const* src_dims,
+              const int64_t* const* src_pos, const int64_t* const* dst_pos,
+              const int64_t* const* extent) const override {
+    size_t simplified_num_dims = 0;
+    int64_t simplified_dst_dims[kMaxNumDims];
+    std::vector<AddNdSrc> simplified_srcs;
+    add_nd::SimplifyAddNd(num_dims, dst_dims, arity, srcs, src_dims, src_pos, dst_pos, extent,
+                          &simplified_num_dims, simplified_dst_dims, &simplified_srcs);
+    const int64_t row_size = simplified_dst_dims[simplified_num_dims - 1];
+    int64_t num_rows = 1;
+    for (size_t d = 0; d + 1 < simplified_num_dims; ++d) { num_rows *= simplified_dst_dims[d]; }
+    if (num_rows == 0 || row_size == 0) { return; }
+    T* dst_ptr = reinterpret_cast<T*>(dst);
+    const size_t grain_size = std::max<int64_t>(32768 / row_size, 1);
+    stream->As<CpuStream>()->ParallelFor(
+        0, num_rows,
+        [&](int64_t begin, int64_t end) {
+          AddNdRows<T>(simplified_num_dims, dst_ptr, simplified_dst_dims, simplified_srcs, begin,
+                       end);
+        },
+        grain_size);
+  }
+};
+
+template<typename T>
+std::unique_ptr<AddNd> NewAddNd() {
+  return std::unique_ptr<AddNd>(new AddNdImpl<T>());
+}
+
+class AddNdFactoryImpl : public AddNdFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AddNdFactoryImpl);
+  AddNdFactoryImpl() = default;
+  ~AddNdFactoryImpl() override = default;
+
+  std::unique_ptr<AddNd> New(DataType data_type, size_t max_num_dims) override {
+    if (max_num_dims > kMaxNumDims) { return nullptr; }
+#define MAKE_NEW_ADD_ND_ENTRY(type_cpp, type_proto) {type_proto, NewAddNd<type_cpp>},
+
+    static const std::map<DataType, std::function<std::unique_ptr<AddNd>()>> new_add_nd_handle{
+        OF_PP_FOR_EACH_TUPLE(MAKE_NEW_ADD_ND_ENTRY, CPU_PRIMITIVE_ALL_TYPE_SEQ)};
+
+#undef MAKE_NEW_ADD_ND_ENTRY
+    return NewPrimitiveFromHandlers(new_add_nd_handle, data_type);
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, AddNdFactory, AddNdFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
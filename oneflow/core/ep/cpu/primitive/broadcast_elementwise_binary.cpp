@@ -343,6 +343,16 @@ std::unique_ptr<BroadcastElementwiseBinary> NewBroadcastElementwiseBinary(Scalar
   CPU_PRIMITIVE_DOUBLE_TYPE_SEQ \
   CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
 
+// The ops run in bfloat16 on cpu by auto mixed precision
+#define BFLOAT16_BINARY_OP_SEQ         \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kAdd) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kSub) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMul) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kDiv) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMax) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMin) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kReluBackwardWithDyY)
+
 #ifdef WITH_ONEDNN
 
 uint32_t OnednnFormatTagMap[kMaxNumDims] = {dnnl_a,     dnnl_ab,     dnnl_abc,     dnnl_abcd,
@@ -445,9 +455,10 @@ class OneDnnBroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
   Scalar attr0, attr1;
 };
 
-#define CPU_PRIMITIVE_BINARY_ONEDNN_TYPE_SEQ                               \
-  OF_PP_MAKE_TUPLE_SEQ(dnnl::memory::data_type::u8, DataType::kBool, bool) \
-  OF_PP_MAKE_TUPLE_SEQ(dnnl::memory::data_type::f32, DataType::kFloat, float)
+#define CPU_PRIMITIVE_BINARY_ONEDNN_TYPE_SEQ                                         \
+  OF_PP_MAKE_TUPLE_SEQ(dnnl::memory::data_type::u8, DataType::kBool, bool)           \
+  OF_PP_MAKE_TUPLE_SEQ(dnnl::memory::data_type::f32, DataType::kFloat, float)        \
+  OF_PP_MAKE_TUPLE_SEQ(dnnl::memory::data_type::bf16, DataType::kBFloat16, bfloat16)
 
 // OneDNN binary op does not support s32
 // CPU_PRIMITIVE_ONEDNN_INT32_TYPE_SEQ
@@ -601,7 +612,12 @@ class BroadcastElementwiseBinaryFactoryImpl : public BroadcastElementwiseBinaryF
                                             OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
                                                 MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY,
                                                 BINARY_MATH_BACKWARD_OP_SEQ_COMPLEX,
-                                                CPU_PRIMITIVE_COMPLEX_TYPE_SEQ)};
+                                                CPU_PRIMITIVE_COMPLEX_TYPE_SEQ)
+
+                                                OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
+                                                    MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY,
+                                                    BFLOAT16_BINARY_OP_SEQ,
+                                                    CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ)};
 
 #undef MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY
 #undef MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY
@@ -13,10 +13,15 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <map>
+#include <tuple>
 #include "oneflow/core/ep/include/primitive/primitive.h"
 #include "oneflow/core/ep/include/primitive/broadcast_matmul.h"
 #include "oneflow/core/ep/common/primitive/broadcast_matmul.h"
 #include "oneflow/core/common/blas.h"
+#include "oneflow/core/common/bfloat16.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/common/onednn.h"
 
 namespace oneflow {
 
@@ -114,6 +119,164 @@ void LaunchCblasBroadcastMatmul(Stream* /*stream*/, DataType data_type,
                              a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
 }
 
+#ifdef WITH_ONEDNN
+
+// The matmul primitives of the bfloat16 matmuls run by this thread, the primitive descriptors
+// are slow to create compared with the small matmuls of inference
+class OneDnnBFloat16MatmulCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OneDnnBFloat16MatmulCache);
+  OneDnnBFloat16MatmulCache() = default;
+  ~OneDnnBFloat16MatmulCache() = default;
+
+  const dnnl::matmul& Get(dnnl::engine* onednn_engine, bool trans_a, bool trans_b, int64_t m,
+                          int64_t n, int64_t k, float alpha, float beta) {
+    const Key key{onednn_engine, trans_a, trans_b, m, n, k, alpha, beta};
+    auto it = matmuls_.find(key);
+    if (it != matmuls_.end()) { return it->second; }
+    // The shapes of a model are few, a cache this large only holds a changing batch size
+    if (matmuls_.size() >= kMaxCacheSize) { matmuls_.clear(); }
+    using dims = dnnl::memory::dims;
+    using data_type = dnnl::memory::data_type;
+    using format_tag = dnnl::memory::format_tag;
+    const auto a_md =
+        dnnl::memory::desc(dims{m, k}, data_type::bf16, trans_a ? format_tag::ba : format_tag::ab);
+    const auto b_md =
+        dnnl::memory::desc(dims{k, n}, data_type::bf16, trans_b ? format_tag::ba : format_tag::ab);
+    const auto c_md = dnnl::memory::desc(dims{m, n}, data_type::bf16, format_tag::ab);
+    dnnl::primitive_attr attr;
+    if (alpha != 1.0f) { attr.set_output_scales(0, {alpha}); }
+    if (beta != 0.0f) {
+      dnnl::post_ops post_ops;
+      post_ops.append_sum(beta);
+      attr.set_post_ops(post_ops);
+    }
+    const auto matmul_d = dnnl::matmul::desc(a_md, b_md, c_md);
+    const auto matmul_pd = dnnl::matmul::primitive_desc(matmul_d, attr, *onednn_engine);
+    return matmuls_.emplace(key, dnnl::matmul(matmul_pd)).first->second;
+  }
+
+ private:
+  using Key = std::tuple<dnnl::engine*, bool, bool, int64_t, int64_t, int64_t, float, float>;
+  static constexpr size_t kMaxCacheSize = 256;
+  std::map<Key, dnnl::matmul> matmuls_;
+};
+
+// c = alpha * a * b + beta * c in bfloat16 with float accumulation, using the bf16 instructions
+// of the cpu if any
+void OneDnnBFloat16Matmul(CpuStream* stream, bool trans_a, bool trans_b, int64_t m, int64_t n,
+                          int64_t k, float alpha, const bfloat16* a, const bfloat16* b, float beta,
+                          bfloat16* c) {
+  static thread_local OneDnnBFloat16MatmulCache cache;
+  stream->onednn_executor()->Launch([&](dnnl::engine* onednn_engine,
+                                        dnnl::stream* onednn_stream) {
+    const dnnl::matmul& matmul = cache.Get(onednn_engine, trans_a, trans_b, m, n, k, alpha, beta);
+    using dims = dnnl::memory::dims;
+    using data_type = dnnl::memory::data_type;
+    using format_tag = dnnl::memory::format_tag;
+    const auto a_md =
+        dnnl::memory::desc(dims{m, k}, data_type::bf16, trans_a ? format_tag::ba : format_tag::ab);
+    const auto b_md =
+        dnnl::memory::desc(dims{k, n}, data_type::bf16, trans_b ? format_tag::ba : format_tag::ab);
+    const auto c_md = dnnl::memory::desc(dims{m, n}, data_type::bf16, format_tag::ab);
+    auto a_mem = dnnl::memory(a_md, *onednn_engine, const_cast<bfloat16*>(a));
+    auto b_mem = dnnl::memory(b_md, *onednn_engine, const_cast<bfloat16*>(b));
+    auto c_mem = dnnl::memory(c_md, *onednn_engine, c);
+    matmul.execute(*onednn_stream,
+                   {{DNNL_ARG_SRC, a_mem}, {DNNL_ARG_WEIGHTS, b_mem}, {DNNL_ARG_DST, c_mem}});
+  });
+}
+
+#endif  // WITH_ONEDNN
+
+// The tiles of the bfloat16 matmul without onednn, converted to float on the stack of the thread
+// computing them instead of converting whole matrices into buffers
+constexpr int64_t kBFloat16TileM = 32;
+constexpr int64_t kBFloat16TileN = 32;
+constexpr int64_t kBFloat16TileK = 128;
+
+// c = alpha * a * b + beta * c in float by tiles of c, and the result rounded to bfloat16
+void BlockedBFloat16Matmul(CpuStream* stream, bool trans_a, bool trans_b, int64_t m, int64_t n,
+                           int64_t k, float alpha, const bfloat16* a, const bfloat16* b,
+                           float beta, bfloat16* c) {
+  const int64_t tiles_m = (m + kBFloat16TileM - 1) / kBFloat16TileM;
+  const int64_t tiles_n = (n + kBFloat16TileN - 1) / kBFloat16TileN;
+  stream->ParallelFor(
+      0, tiles_m * tiles_n,
+      [&](int64_t begin, int64_t end) {
+        float a_tile[kBFloat16TileM * kBFloat16TileK];
+        float b_tile[kBFloat16TileK * kBFloat16TileN];
+        float c_tile[kBFloat16TileM * kBFloat16TileN];
+        for (int64_t tile = begin; tile < end; ++tile) {
+          const int64_t m0 = (tile / tiles_n) * kBFloat16TileM;
+          const int64_t n0 = (tile % tiles_n) * kBFloat16TileN;
+          const int64_t tile_m = std::min(kBFloat16TileM, m - m0);
+          const int64_t tile_n = std::min(kBFloat16TileN, n - n0);
+          for (int64_t i = 0; i < tile_m; ++i) {
+            for (int64_t j = 0; j < tile_n; ++j) {
+              c_tile[i * tile_n + j] =
+                  beta == 0.0f ? 0.0f : beta * static_cast<float>(c[(m0 + i) * n + n0 + j]);
+            }
+          }
+          for (int64_t k0 = 0; k0 < k; k0 += kBFloat16TileK) {
+            const int64_t tile_k = std::min(kBFloat16TileK, k - k0);
+            for (int64_t i = 0; i < tile_m; ++i) {
+              for (int64_t l = 0; l < tile_k; ++l) {
+                a_tile[i * tile_k + l] = static_cast<float>(
+                    trans_a ? a[(k0 + l) * m + m0 + i] : a[(m0 + i) * k + k0 + l]);
+              }
+            }
+            for (int64_t l = 0; l < tile_k; ++l) {
+              for (int64_t j = 0; j < tile_n; ++j) {
+                b_tile[l * tile_n + j] = static_cast<float>(
+                    trans_b ? b[(n0 + j) * k + k0 + l] : b[(k0 + l) * n + n0 + j]);
+              }
+            }
+            CblasMatmul<float>(CblasNoTrans, CblasNoTrans, tile_m, tile_n, tile_k, alpha, a_tile,
+                               b_tile, 1.0f, c_tile);
+          }
+          for (int64_t i = 0; i < tile_m; ++i) {
+            for (int64_t j = 0; j < tile_n; ++j) {
+              c[(m0 + i) * n + n0 + j] = static_cast<bfloat16>(c_tile[i * tile_n + j]);
+            }
+          }
+        }
+      },
+      1);
+}
+
+void LaunchBFloat16BroadcastMatmul(Stream* stream, BlasTransposeType transpose_a,
+                                   BlasTransposeType transpose_b, int64_t num_batch_dims,
+                                   const int64_t* broadcast_batch_dims,
+                                   const int64_t* a_batch_dims, const int64_t* b_batch_dims,
+                                   const int64_t* c_batch_dims, int64_t m, int64_t n, int64_t k,
+                                   Scalar alpha, const void* a, const void* b, Scalar beta,
+                                   void* c) {
+  CpuStream* cpu_stream = stream->As<CpuStream>();
+  const bool trans_a = transpose_a == BlasTransposeType::T;
+  const bool trans_b = transpose_b == BlasTransposeType::T;
+  const float alpha_value = alpha.Value<float>();
+  auto func = [&](const void* batch_a, const void* batch_b, void* batch_c, Scalar batch_beta) {
+    const float beta_value = batch_beta.Value<float>();
+#ifdef WITH_ONEDNN
+    if (OneDnnIsEnabled()) {
+      OneDnnBFloat16Matmul(cpu_stream, trans_a, trans_b, m, n, k, alpha_value,
+                           static_cast<const bfloat16*>(batch_a),
+                           static_cast<const bfloat16*>(batch_b), beta_value,
+                           static_cast<bfloat16*>(batch_c));
+      return;
+    }
+#endif  // WITH_ONEDNN
+    BlockedBFloat16Matmul(cpu_stream, trans_a, trans_b, m, n, k, alpha_value,
+                          static_cast<const bfloat16*>(batch_a),
+                          static_cast<const bfloat16*>(batch_b), beta_value,
+                          static_cast<bfloat16*>(batch_c));
+  };
+  ForEachMatmul<kMaxNumDims>(DataType::kBFloat16, m, n, k, beta, num_batch_dims,
+                             broadcast_batch_dims, a_batch_dims, b_batch_dims, c_batch_dims, a, b,
+                             c, func);
+}
+
 void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType transpose_a,
                            BlasTransposeType transpose_b, int64_t num_batch_dims,
                            const int64_t* broadcast_batch_dims, const int64_t* a_batch_dims,
@@ -136,6 +299,10 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
     LaunchCblasBroadcastMatmul<std::complex<double>>(
         stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
         a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
+  } else if (data_type == DataType::kBFloat16) {
+    LaunchBFloat16BroadcastMatmul(stream, transpose_a, transpose_b, num_batch_dims,
+                                  broadcast_batch_dims, a_batch_dims, b_batch_dims, c_batch_dims,
+                                  m, n, k, alpha, a, b, beta, c);
   } else {
     UNIMPLEMENTED();
   }
@@ -152,7 +319,8 @@ class BroadcastMatmulFactoryImpl : public BroadcastMatmulFactory {
                                        size_t max_num_dims) override {
     if (max_num_dims > kMaxNumDims) { return nullptr; }
     if (data_type == DataType::kFloat || data_type == DataType::kDouble
-        || data_type == DataType::kComplex64 || data_type == DataType::kComplex128) {
+        || data_type == DataType::kComplex64 || data_type == DataType::kComplex128
+        || data_type == DataType::kBFloat16) {
       return std::make_unique<BroadcastMatmulImpl<kMaxNumDims>>(data_type, transpose_a,
                                                                 transpose_b);
     } else {
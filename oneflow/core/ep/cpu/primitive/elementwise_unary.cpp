@@ -85,8 +85,9 @@ class ElementwiseUnaryFactoryImpl : public ElementwiseUnaryFactory {
                           std::function<std::unique_ptr<ElementwiseUnary>(Scalar, Scalar)>>
         new_elementwise_unary_handle{
             // For All Type OP
-            OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_SAME_DTYPE_ELEMENTWISE_UNARY_ENTRY,
-                                             UNARY_MATH_OP_SEQ, CPU_PRIMITIVE_NATIVE_TYPE_SEQ)
+            OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
+                MAKE_NEW_SAME_DTYPE_ELEMENTWISE_UNARY_ENTRY, UNARY_MATH_OP_SEQ,
+                CPU_PRIMITIVE_NATIVE_TYPE_SEQ CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ)
             // For Float Type OP
             OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
                 MAKE_NEW_SAME_DTYPE_ELEMENTWISE_UNARY_ENTRY, UNARY_FLOATING_MATH_OP_SEQ,
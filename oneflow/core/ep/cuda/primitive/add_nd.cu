@@ -0,0 +1,236 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/add_nd.h"
+#include "oneflow/core/ep/common/primitive/add_nd.h"
+#include "oneflow/core/ep/cuda/primitive/type_seq.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/common/nd_index_offset_helper.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+using add_nd::AddNdSrc;
+using add_nd::kMaxNumDims;
+
+constexpr size_t kMaxArity = 8;
+
+template<size_t num_dims, typename IndexType>
+struct AddNdSrcParam {
+  const void* src{};
+  NdIndexOffsetHelper<IndexType, num_dims> src_index_helper;
+  IndexType src_pos[num_dims];
+  IndexType dst_begin[num_dims];
+  IndexType dst_end[num_dims];
+};
+
+template<size_t num_dims, typename IndexType>
+struct AddNdKernelParams {
+  NdIndexOffsetHelper<IndexType, num_dims> dst_index_helper;
+  AddNdSrcParam<num_dims, IndexType> srcs[kMaxArity];
+  size_t arity{};
+  bool accumulate{};
+  IndexType count{};
+  void* dst{};
+};
+
+// The complex types have no arithmetic operators on the device
+template<typename T>
+struct AddNdOp {
+  __device__ static T Zero() { return static_cast<T>(0.0f); }
+  __device__ static T Add(T a, T b) { return a + b; }
+};
+
+template<typename T>
+struct ComplexAddNdOp {
+  __device__ static T Zero() { return T{0, 0}; }
+  __device__ static T Add(T a, T b) { return T{a.x + b.x, a.y + b.y}; }
+};
+
+#ifdef WITH_ROCM
+template<>
+struct AddNdOp<hipComplex> : public ComplexAddNdOp<hipComplex> {};
+template<>
+struct AddNdOp<hipDoubleComplex> : public ComplexAddNdOp<hipDoubleComplex> {};
+#else
+template<>
+struct AddNdOp<cuComplex> : public ComplexAddNdOp<cuComplex> {};
+template<>
+struct AddNdOp<cuDoubleComplex> : public ComplexAddNdOp<cuDoubleComplex> {};
+#endif
+
+// One thread per element of dst, which reads every source covering it
+template<typename T, size_t num_dims, typename IndexType>
+__global__ void AddNdKernel(AddNdKernelParams<num_dims, IndexType> params) {
+  T* dst = reinterpret_cast<T*>(params.dst);
+  IndexType dst_index[num_dims];
+  IndexType src_index[num_dims];
+  CUDA_1D_KERNEL_LOOP_T(IndexType, i, params.count) {
+    params.dst_index_helper.OffsetToNdIndex(i, dst_index);
+    T sum = params.accumulate ? dst[i] : AddNdOp<T>::Zero();
+    for (size_t a = 0; a < params.arity; ++a) {
+      const AddNdSrcParam<num_dims, IndexType>& src = params.srcs[a];
+      bool covered = true;
+#pragma unroll
+      for (size_t d = 0; d < num_dims; ++d) {
+        covered = covered && dst_index[d] >= src.dst_begin[d] && dst_index[d] < src.dst_end[d];
+        src_index[d] = dst_index[d] - src.dst_begin[d] + src.src_pos[d];
+      }
+      if (covered) {
+        const T* src_ptr = reinterpret_cast<const T*>(src.src);
+        sum = AddNdOp<T>::Add(sum, src_ptr[src.src_index_helper.NdIndexToOffset(src_index)]);
+      }
+    }
+    dst[i] = sum;
+  }
+}
+
+template<typename T, size_t num_dims, typename IndexType>
+void LaunchKernel(Stream* stream, void* dst, const int64_t* dst_dims, const AddNdSrc* srcs,
+                  size_t arity, bool accumulate, size_t count) {
+  AddNdKernelParams<num_dims, IndexType> params;
+  params.dst_index_helper = NdIndexOffsetHelper<IndexType, num_dims>(dst_dims);
+  for (size_t a = 0; a < arity; ++a) {
+    auto& src = params.srcs[a];
+    src.src = srcs[a].src;
+    src.src_index_helper = NdIndexOffsetHelper<IndexType, num_dims>(srcs[a].src_dims);
+    for (size_t d = 0; d < num_dims; ++d) {
+      src.src_pos[d] = srcs[a].src_pos[d];
+      src.dst_begin[d] = srcs[a].dst_pos[d];
+      src.dst_end[d] = srcs[a].dst_pos[d] + srcs[a].extent[d];
+    }
+  }
+  params.arity = arity;
+  params.accumulate = accumulate;
+  params.count = static_cast<IndexType>(count);
+  params.dst = dst;
+  GPU(Stream_t) cuda_stream = stream->As<CudaStream>()->cuda_stream();
+  AddNdKernel<T, num_dims, IndexType>
+      <<<BlocksNum4ThreadsNum(count), kCudaThreadsNumPerBlock, 0, cuda_stream>>>(params);
+}
+
+template<typename T, size_t num_dims>
+void DispatchIndexType(Stream* stream, void* dst, const int64_t* dst_dims, const AddNdSrc* srcs,
+                       size_t arity, bool accumulate) {
+  size_t count = 1;
+  for (size_t d = 0; d < num_dims; ++d) { count *= dst_dims[d]; }
+  if (count < GetMaxVal<int32_t>()) {
+    LaunchKernel<T, num_dims, int32_t>(stream, dst, dst_dims, srcs, arity, accumulate, count);
+  } else {
+    LaunchKernel<T, num_dims, int64_t>(stream, dst, dst_dims, srcs, arity, accumulate, count);
+  }
+}
+
+template<typename T>
+void DispatchNumDims(Stream* stream, size_t num_dims, void* dst, const int64_t* dst_dims,
+                     const AddNdSrc* srcs, size_t arity, bool accumulate) {
+  void (*func)(Stream* /*stream*/, void* /*dst*/, const int64_t* /*dst_dims*/,
+               const AddNdSrc* /*srcs*/, size_t /*arity*/, bool /*accumulate*/) = nullptr;
+  if (num_dims == 1) {
+    func = DispatchIndexType<T, 1>;
+  } else if (num_dims == 2) {
+    func = DispatchIndexType<T, 2>;
+  } else if (num_dims == 3) {
+    func = DispatchIndexType<T, 3>;
+  } else if (num_dims == 4) {
+    func = DispatchIndexType<T, 4>;
+  } else if (num_dims == 5) {
+    func = DispatchIndexType<T, 5>;
+  } else if (num_dims == 6) {
+    func = DispatchIndexType<T, 6>;
+  } else if (num_dims == 7) {
+    func = DispatchIndexType<T, 7>;
+  } else if (num_dims == 8) {
+    func = DispatchIndexType<T, 8>;
+  } else {
+    UNIMPLEMENTED();
+  }
+  func(stream, dst, dst_dims, srcs, arity, accumulate);
+}
+
+template<typename T>
+class AddNdImpl : public AddNd {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AddNdImpl);
+  AddNdImpl() = default;
+  ~AddNdImpl() override = default;
+
+  void Launch(Stream* stream, size_t num_dims, void* dst, const int64_t* dst_dims, size_t arity,
+              const void* const* srcs, const int64_t* const* src_dims,
+              const int64_t* const* src_pos, const int64_t* const* dst_pos,
+              const int64_t* const* extent) const override {
+    size_t simplified_num_dims = 0;
+    int64_t simplified_dst_dims[kMaxNumDims];
+    std::vector<AddNdSrc> simplified_srcs;
+    add_nd::SimplifyAddNd(num_dims, dst_dims, arity, srcs, src_dims, src_pos, dst_pos, extent,
+                          &simplified_num_dims, simplified_dst_dims, &simplified_srcs);
+    if (std::any_of(simplified_dst_dims, simplified_dst_dims + simplified_num_dims,
+                    [](int64_t dim) { return dim == 0; })) {
+      return;
+    }
+    // The sources beyond kMaxArity are accumulated by more passes
+    size_t offset = 0;
+    do {
+      const size_t chunk_arity = std::min(kMaxArity, simplified_srcs.size() - offset);
+      DispatchNumDims<T>(stream, simplified_num_dims, dst, simplified_dst_dims,
+                         simplified_srcs.data() + offset, chunk_arity, offset != 0);
+      offset += chunk_arity;
+    } while (offset < simplified_srcs.size());
+  }
+};
+
+template<typename T>
+std::unique_ptr<AddNd> NewAddNd() {
+  return std::unique_ptr<AddNd>(new AddNdImpl<T>());
+}
+
+// The same types as the Add primitive, which SliceBoxingAdd used before
+#define CUDA_PRIMITIVE_ADD_ND_TYPE_SEQ CUDA_PRIMITIVE_REAL_TYPE_SEQ CUDA_PRIMITIVE_COMPLEX_TYPE_SEQ
+
+class AddNdFactoryImpl : public AddNdFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AddNdFactoryImpl);
+  AddNdFactoryImpl() = default;
+  ~AddNdFactoryImpl() override = default;
+
+  std::unique_ptr<AddNd> New(DataType data_type, size_t max_num_dims) override {
+    if (max_num_dims > kMaxNumDims) { return nullptr; }
+#define MAKE_NEW_ADD_ND_ENTRY(type_cpp, type_proto) {type_proto, NewAddNd<type_cpp>},
+
+    static const std::map<DataType, std::function<std::unique_ptr<AddNd>()>> new_add_nd_handle{
+        OF_PP_FOR_EACH_TUPLE(MAKE_NEW_ADD_ND_ENTRY, CUDA_PRIMITIVE_ADD_ND_TYPE_SEQ)};
+
+#undef MAKE_NEW_ADD_ND_ENTRY
+    const auto it = new_add_nd_handle.find(data_type);
+    if (it != new_add_nd_handle.end()) {
+      return it->second();
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCUDA, AddNdFactory, AddNdFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
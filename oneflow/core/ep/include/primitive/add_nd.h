@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_PRIMITIVE_ADD_ND_H_
+#define ONEFLOW_CORE_EP_PRIMITIVE_ADD_ND_H_
+
+#include "oneflow/core/ep/include/primitive/primitive.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// Sums sources of different extents into dst in a single pass. The box of srcs[i] starting at
+// src_pos[i] with extent[i] is added to the box of dst starting at dst_pos[i], and the elements
+// of dst covered by no source are set to zero.
+class AddNd : public Primitive {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AddNd);
+  AddNd() = default;
+  ~AddNd() override = default;
+
+  virtual void Launch(Stream* stream, size_t num_dims, void* dst, const int64_t* dst_dims,
+                      size_t arity, const void* const* srcs, const int64_t* const* src_dims,
+                      const int64_t* const* src_pos, const int64_t* const* dst_pos,
+                      const int64_t* const* extent) const = 0;
+};
+
+class AddNdFactory : public Factory<AddNd> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AddNdFactory);
+  AddNdFactory() = default;
+  ~AddNdFactory() override = default;
+
+  virtual std::unique_ptr<AddNd> New(DataType data_type, size_t max_num_dims) = 0;
+};
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_PRIMITIVE_ADD_ND_H_
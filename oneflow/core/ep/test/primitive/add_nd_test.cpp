@@ -0,0 +1,162 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/test/primitive/primitive_test.h"
+#include "oneflow/core/ep/include/primitive/memset.h"
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/ep/include/primitive/add.h"
+#include "oneflow/core/ep/include/primitive/add_nd.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace primitive {
+
+namespace test {
+
+namespace {
+
+template<DataType data_type, typename T>
+void TestAddNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+               int64_t num_dims, size_t arity) {
+  std::vector<int64_t> dst_dims(num_dims);
+  int64_t dst_elem = 1;
+  for (int64_t d = 0; d < num_dims; ++d) {
+    dst_dims.at(d) = 4 + std::rand() % 8;
+    dst_elem *= dst_dims.at(d);
+  }
+  // Every source holds a random box of dst at a random position of itself
+  std::vector<std::vector<int64_t>> src_dims(arity, std::vector<int64_t>(num_dims));
+  std::vector<std::vector<int64_t>> src_pos = src_dims;
+  std::vector<std::vector<int64_t>> dst_pos = src_dims;
+  std::vector<std::vector<int64_t>> extent = src_dims;
+  std::vector<int64_t> src_elem(arity, 1);
+  for (size_t a = 0; a < arity; ++a) {
+    for (int64_t d = 0; d < num_dims; ++d) {
+      extent[a][d] = 1 + std::rand() % dst_dims.at(d);
+      dst_pos[a][d] = std::rand() % (dst_dims.at(d) - extent[a][d] + 1);
+      src_pos[a][d] = std::rand() % 3;
+      src_dims[a][d] = src_pos[a][d] + extent[a][d] + std::rand() % 3;
+      src_elem[a] *= src_dims[a][d];
+    }
+  }
+  std::vector<std::vector<T>> src_values(arity);
+  std::vector<T> expected(dst_elem, static_cast<T>(0));
+  for (size_t a = 0; a < arity; ++a) {
+    src_values[a].resize(src_elem[a]);
+    for (auto& value : src_values[a]) { value = static_cast<T>(std::rand() % 100); }
+    int64_t extent_elem = 1;
+    for (int64_t d = 0; d < num_dims; ++d) { extent_elem *= extent[a][d]; }
+    for (int64_t i = 0; i < extent_elem; ++i) {
+      int64_t remaining = i;
+      int64_t src_offset = 0;
+      int64_t dst_offset = 0;
+      int64_t src_stride = 1;
+      int64_t dst_stride = 1;
+      for (int64_t d = num_dims - 1; d >= 0; --d) {
+        const int64_t index = remaining % extent[a][d];
+        remaining /= extent[a][d];
+        src_offset += (index + src_pos[a][d]) * src_stride;
+        dst_offset += (index + dst_pos[a][d]) * dst_stride;
+        src_stride *= src_dims[a][d];
+        dst_stride *= dst_dims.at(d);
+      }
+      expected.at(dst_offset) += src_values[a].at(src_offset);
+    }
+  }
+  const int64_t dst_size = dst_elem * sizeof(T);
+
+  for (const auto& device_type : device_types) {
+    auto device = registry->GetDevice(device_type, 0);
+    ep::test::StreamGuard stream(device.get());
+    std::unique_ptr<Memcpy> h2d = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kHtoD);
+    ASSERT_TRUE(h2d.operator bool());
+    std::unique_ptr<Memcpy> d2h = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kDtoH);
+    ASSERT_TRUE(d2h.operator bool());
+    std::unique_ptr<Memset> memset = NewPrimitive<MemsetFactory>(device_type);
+    ASSERT_TRUE(memset.operator bool());
+    std::unique_ptr<AddNd> add_nd = NewPrimitive<AddNdFactory>(device_type, data_type, num_dims);
+    ASSERT_TRUE(add_nd.operator bool());
+    std::vector<std::unique_ptr<ep::test::PinnedMemoryGuard>> inputs;
+    std::vector<std::unique_ptr<ep::test::DeviceMemoryGuard>> device_inputs;
+    std::vector<const void*> srcs;
+    std::vector<const int64_t*> src_dims_ptrs;
+    std::vector<const int64_t*> src_pos_ptrs;
+    std::vector<const int64_t*> dst_pos_ptrs;
+    std::vector<const int64_t*> extent_ptrs;
+    for (size_t a = 0; a < arity; ++a) {
+      const int64_t src_size = src_elem[a] * sizeof(T);
+      inputs.emplace_back(new ep::test::PinnedMemoryGuard(device.get(), src_size));
+      device_inputs.emplace_back(new ep::test::DeviceMemoryGuard(device.get(), src_size));
+      std::copy(src_values[a].begin(), src_values[a].end(), inputs.back()->ptr<T>());
+      h2d->Launch(stream.stream(), device_inputs.back()->ptr(), inputs.back()->ptr(), src_size);
+      srcs.push_back(device_inputs.back()->ptr());
+      src_dims_ptrs.push_back(src_dims[a].data());
+      src_pos_ptrs.push_back(src_pos[a].data());
+      dst_pos_ptrs.push_back(dst_pos[a].data());
+      extent_ptrs.push_back(extent[a].data());
+    }
+    ep::test::PinnedMemoryGuard output(device.get(), dst_size);
+    ep::test::DeviceMemoryGuard device_output(device.get(), dst_size);
+    // The elements covered by no source must be overwritten with zeros
+    memset->Launch(stream.stream(), device_output.ptr(), 0x55, dst_size);
+    add_nd->Launch(stream.stream(), num_dims, device_output.ptr(), dst_dims.data(), arity,
+                   srcs.data(), src_dims_ptrs.data(), src_pos_ptrs.data(), dst_pos_ptrs.data(),
+                   extent_ptrs.data());
+    d2h->Launch(stream.stream(), output.ptr(), device_output.ptr(), dst_size);
+    CHECK_JUST(stream.stream()->Sync());
+    for (int64_t i = 0; i < dst_elem; ++i) { ASSERT_EQ(expected.at(i), *(output.ptr<T>() + i)); }
+  }
+}
+
+}  // namespace
+
+TEST_F(PrimitiveTest, TestAddNd) {
+  for (int num_dims = 1; num_dims < 5; ++num_dims) {
+    for (size_t arity : {1, 2, 3, 11}) {
+      TestAddNd<DataType::kDouble, double>(&device_manager_registry_, available_device_types_,
+                                           num_dims, arity);
+      TestAddNd<DataType::kFloat, float>(&device_manager_registry_, available_device_types_,
+                                         num_dims, arity);
+      TestAddNd<DataType::kInt32, int32_t>(&device_manager_registry_, available_device_types_,
+                                           num_dims, arity);
+      TestAddNd<DataType::kInt64, int64_t>(&device_manager_registry_, available_device_types_,
+                                           num_dims, arity);
+    }
+  }
+}
+
+// SliceBoxingAdd takes AddNd for every data type it used to sum with Add
+TEST_F(PrimitiveTest, TestAddNdSupportsAddDataTypes) {
+  for (const auto& device_type : available_device_types_) {
+    for (int data_type = DataType_MIN; data_type <= DataType_MAX; ++data_type) {
+      if (!DataType_IsValid(data_type)) { continue; }
+      const DataType type = static_cast<DataType>(data_type);
+      if (!NewPrimitive<AddFactory>(device_type, type)) { continue; }
+      ASSERT_TRUE(NewPrimitive<AddNdFactory>(device_type, type, 4).operator bool())
+          << DataType_Name(type) << " on " << device_type;
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace primitive
+
+}  // namespace ep
+
+}  // namespace oneflow
@@ -0,0 +1,137 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/eager_op_trace.h"
+#include "oneflow/core/eager/dev_vm_dep_object_consume_mode.h"
+#include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/stream_guard.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_storage.h"
+#include "oneflow/core/vm/op_call_instruction_policy.h"
+#include "oneflow/core/vm/virtual_machine.h"
+#include "oneflow/user/kernels/stateful_opkernel.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+EagerOpTrace** MutCurrentCapturingEagerOpTrace() {
+  static thread_local EagerOpTrace* trace = nullptr;
+  return &trace;
+}
+
+}  // namespace
+
+EagerOpTrace* CurrentCapturingEagerOpTrace() { return *MutCurrentCapturingEagerOpTrace(); }
+
+EagerOpTrace::~EagerOpTrace() {
+  if (is_capturing_) { *MutCurrentCapturingEagerOpTrace() = nullptr; }
+}
+
+Maybe<void> EagerOpTrace::BeginCapture() {
+  CHECK_OR_RETURN(CurrentCapturingEagerOpTrace() == nullptr)
+      << Error::RuntimeError() << "Another eager op trace is capturing on this thread";
+  Reset();
+  is_capturing_ = true;
+  *MutCurrentCapturingEagerOpTrace() = this;
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EagerOpTrace::EndCapture() {
+  CHECK_OR_RETURN(is_capturing_) << Error::RuntimeError() << "The eager op trace is not capturing";
+  is_capturing_ = false;
+  *MutCurrentCapturingEagerOpTrace() = nullptr;
+  return Maybe<void>::Ok();
+}
+
+void EagerOpTrace::Reset() {
+  op_calls_.clear();
+  external_inputs_.clear();
+  captured_eager_blob_objects_.clear();
+  tensor_storages_.clear();
+  invalid_reason_.clear();
+}
+
+void EagerOpTrace::Invalidate(const std::string& reason) {
+  if (invalid_reason_.empty()) { invalid_reason_ = reason; }
+}
+
+Maybe<void> EagerOpTrace::RecordOpCall(const std::shared_ptr<StatefulOpKernel>& kernel,
+                                       const TensorTuple& inputs, const TensorTuple& outputs,
+                                       const vm::EagerBlobObjectList& input_eager_blob_objects,
+                                       const vm::EagerBlobObjectList& output_eager_blob_objects,
+                                       const OpExprInterpContext& ctx, Symbol<Stream> stream) {
+  if (!is_valid()) { return Maybe<void>::Ok(); }
+  if (!kernel->output_tuple_indexes4mut2_obns().empty()) {
+    Invalidate("op " + kernel->op_type_name() + " has outputs of dynamic shapes");
+    return Maybe<void>::Ok();
+  }
+  for (int i = 0; i < inputs.size(); ++i) {
+    const auto& eager_blob_object = input_eager_blob_objects.at(i);
+    if (captured_eager_blob_objects_.insert(eager_blob_object.get()).second) {
+      external_inputs_.emplace_back(
+          ExternalInput{inputs.at(i), eager_blob_object, eager_blob_object->shape()});
+      tensor_storages_.emplace_back(JUST(inputs.at(i)->tensor_storage()));
+    }
+  }
+  for (int i = 0; i < outputs.size(); ++i) {
+    if (captured_eager_blob_objects_.insert(output_eager_blob_objects.at(i).get()).second) {
+      tensor_storages_.emplace_back(JUST(outputs.at(i)->tensor_storage()));
+    }
+  }
+  // Convert the stream at capture, as the stream guard may be gone at replay
+  stream = JUST(StreamGuard::TryConvertStream(stream));
+  auto* vm_stream = JUST(Singleton<VirtualMachine>::Get()->GetVmStream(stream));
+  const auto& instruction_policy = JUST(vm::OpCallInstructionPolicy::New(
+      vm_stream, kernel, vm::EagerBlobObjectList(input_eager_blob_objects),
+      vm::EagerBlobObjectList(output_eager_blob_objects),
+      std::shared_ptr<const GlobalTensorInferResult>(), ctx,
+      *CurrentDevVmDepObjectConsumeMode()));
+  op_calls_.emplace_back(OpCall{instruction_policy, stream});
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EagerOpTrace::CheckExternalInputs() {
+  for (const auto& input : external_inputs_) {
+    const auto& tensor = input.tensor.lock();
+    // The storage is kept by the trace, so nothing reads what the replay writes into it
+    if (!tensor) { continue; }
+    if (JUST(tensor->eager_blob_object()) != input.eager_blob_object) {
+      Invalidate("an input tensor has been replaced since the capture");
+    } else if (input.eager_blob_object->shape() != input.shape) {
+      Invalidate("an input tensor has been resized from " + input.shape.ToString() + " to "
+                 + input.eager_blob_object->shape().ToString() + " since the capture");
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EagerOpTrace::Replay() {
+  CHECK_OR_RETURN(!is_capturing_) << Error::RuntimeError()
+                                  << "Can not replay an eager op trace while capturing it";
+  JUST(CheckExternalInputs());
+  CHECK_OR_RETURN(is_valid()) << Error::RuntimeError() << "The eager op trace is invalid because "
+                              << invalid_reason_ << ", please capture it again";
+  return PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+    for (const auto& op_call : op_calls_) {
+      JUST(builder->Call(*op_call.instruction_policy, op_call.stream));
+    }
+    return Maybe<void>::Ok();
+  });
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,103 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_EAGER_OP_TRACE_H_
+#define ONEFLOW_CORE_FRAMEWORK_EAGER_OP_TRACE_H_
+
+#include "oneflow/core/common/hash_container.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/framework/op_interpreter.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/eager/eager_blob_object.h"
+
+namespace oneflow {
+
+class Stream;
+
+namespace vm {
+
+class OpCallInstructionPolicy;
+
+}  // namespace vm
+
+namespace one {
+
+class StatefulOpKernel;
+class TensorStorage;
+
+// Records the eager local op calls dispatched by the current thread between BeginCapture and
+// EndCapture, and replays them later on the same tensors, like cuda graphs but on any device.
+// The instructions are built once at capture with their kernels chosen and their dependences
+// analysed, and the storage of every tensor used by the captured ops is kept by the trace.
+// Only the ops dispatched by the eager local interpreter are recorded, so host accesses like
+// numpy() in the captured region are not replayed.
+class EagerOpTrace final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(EagerOpTrace);
+  EagerOpTrace() = default;
+  ~EagerOpTrace();
+
+  Maybe<void> BeginCapture();
+  Maybe<void> EndCapture();
+  // Fails and invalidates the trace if an input of the captured ops has been resized or
+  // replaced since the capture, in which case the step has to be captured again.
+  Maybe<void> Replay();
+  void Reset();
+
+  bool is_capturing() const { return is_capturing_; }
+  bool is_valid() const { return invalid_reason_.empty(); }
+  const std::string& invalid_reason() const { return invalid_reason_; }
+  size_t num_ops() const { return op_calls_.size(); }
+
+  Maybe<void> RecordOpCall(const std::shared_ptr<StatefulOpKernel>& kernel,
+                           const TensorTuple& inputs, const TensorTuple& outputs,
+                           const vm::EagerBlobObjectList& input_eager_blob_objects,
+                           const vm::EagerBlobObjectList& output_eager_blob_objects,
+                           const OpExprInterpContext& ctx, Symbol<Stream> stream);
+  void Invalidate(const std::string& reason);
+
+ private:
+  struct OpCall {
+    std::shared_ptr<vm::OpCallInstructionPolicy> instruction_policy;
+    Symbol<Stream> stream;
+  };
+
+  // A tensor produced outside of the captured region
+  struct ExternalInput {
+    std::weak_ptr<Tensor> tensor;
+    std::shared_ptr<vm::EagerBlobObject> eager_blob_object;
+    Shape shape;
+  };
+
+  Maybe<void> CheckExternalInputs();
+
+  bool is_capturing_ = false;
+  std::string invalid_reason_;
+  std::vector<OpCall> op_calls_;
+  std::vector<ExternalInput> external_inputs_;
+  HashSet<const vm::EagerBlobObject*> captured_eager_blob_objects_;
+  std::vector<std::shared_ptr<TensorStorage>> tensor_storages_;
+};
+
+// The trace capturing on the current thread, or nullptr
+EagerOpTrace* CurrentCapturingEagerOpTrace();
+
+}  // namespace one
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_EAGER_OP_TRACE_H_
@@ -405,6 +405,25 @@ Maybe<void> InstructionsBuilder::Call(
   return Maybe<void>::Ok();
 }
 
+Maybe<void> InstructionsBuilder::Call(
+    const vm::OpCallInstructionPolicy& op_call_instruction_policy, Symbol<Stream> stream) {
+  Symbol<Stream> allocator_stream = JUST(GetAllocatorStream(stream));
+  if (stream != allocator_stream) {
+    JUST(AllocateTensors(op_call_instruction_policy.outputs(), allocator_stream));
+  }
+  JUST(SoftSyncStream(op_call_instruction_policy.outputs(), stream));
+  JUST(SoftSyncStream(op_call_instruction_policy.inputs(), stream));
+  for (const auto& output : op_call_instruction_policy.outputs()) {
+    if (!output->producer_stream().has_value()) { JUST(output->init_producer_stream(stream)); }
+    output->set_last_used_stream(stream);
+  }
+  auto instruction = intrusive::make_shared<vm::Instruction>(
+      op_call_instruction_policy.vm_stream(),
+      std::make_shared<vm::OpCallInstructionPolicy>(op_call_instruction_policy));
+  instruction_list_->EmplaceBack(std::move(instruction));
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> InstructionsBuilder::ReleaseTensor(
     const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object) {
   const auto& last_used_stream = JUST(eager_blob_object->last_used_stream());
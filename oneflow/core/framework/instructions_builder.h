@@ -40,6 +40,10 @@ class LocalTensor;
 class GlobalTensorInferResult;
 }  // namespace one
 
+namespace vm {
+class OpCallInstructionPolicy;
+}  // namespace vm
+
 class NNGraphIf;
 
 class SharedEventRecord;
@@ -137,6 +141,11 @@ class InstructionsBuilder : public std::enable_shared_from_this<InstructionsBuil
       const std::shared_ptr<const one::GlobalTensorInferResult>& global_tensor_infer_result,
       const one::OpExprInterpContext& ctx, Symbol<Stream> stream);
 
+  // Issue a copy of an op call built before, which skips choosing the kernel and collecting the
+  // dependences again
+  Maybe<void> Call(const vm::OpCallInstructionPolicy& op_call_instruction_policy,
+                   Symbol<Stream> stream);
+
   Maybe<void> SoftSyncStream(const vm::EagerBlobObjectList& eager_blob_objects,
                              Symbol<Stream> stream);
 
@@ -524,13 +524,15 @@ Maybe<void> NNGraph::NaiveCompile() {
     std::string plan_name = "plan:" + job_name();
     if (GlobalProcessCtx::IsThisProcessMaster()) {
       // TODO(chengcheng): split plan for each rank.
-      Singleton<CtrlClient>::Get()->PushKV(plan_name, plan_);
+      // NOTE: the plan goes through the master kv, which relays it along a tree of ranks in the
+      // hierarchical ctrl mode instead of all the ranks pulling it from one server.
+      Singleton<CtrlClient>::Get()->PushMasterKV(plan_name, plan_);
     } else {
-      Singleton<CtrlClient>::Get()->PullKV(plan_name, &plan_);
+      Singleton<CtrlClient>::Get()->PullMasterKV(plan_name, &plan_);
     }
     OF_SESSION_BARRIER();
     if (GlobalProcessCtx::IsThisProcessMaster()) {
-      Singleton<CtrlClient>::Get()->ClearKV(plan_name);
+      Singleton<CtrlClient>::Get()->ClearMasterKV(plan_name);
     }
   }
   compile_tc->Count("[GraphCompile]" + name_ + " SyncPlan", 0, true);
@@ -722,6 +722,13 @@ Maybe<void> BuiltinOpExprImpl<ImageDecoderRandomCropResizeOpConf>::BuildOpConf(
   proto->set_random_area_max(JUST(attrs.GetAttr<float>("random_area_max")));
   proto->set_random_aspect_ratio_min(JUST(attrs.GetAttr<float>("random_aspect_ratio_min")));
   proto->set_random_aspect_ratio_max(JUST(attrs.GetAttr<float>("random_aspect_ratio_max")));
+  proto->set_output_data_type(JUST(attrs.GetAttr<DataType>("output_data_type")));
+  proto->set_output_layout(JUST(attrs.GetAttr<std::string>("output_layout")));
+  proto->clear_mean();
+  for (float mean : JUST(attrs.GetAttr<std::vector<float>>("mean"))) { proto->add_mean(mean); }
+  proto->clear_std();
+  for (float std : JUST(attrs.GetAttr<std::vector<float>>("std"))) { proto->add_std(std); }
+  proto->set_mirror_probability(JUST(attrs.GetAttr<float>("mirror_probability")));
   return Maybe<void>::Ok();
 }
 
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/common/device_type.pb.h"
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/eager_op_trace.h"
 #include "oneflow/core/framework/mutable_attr_map.h"
 #include "oneflow/core/framework/op_interpreter.h"
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
@@ -152,6 +153,16 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
 
   if (default_device->enum_type() == DeviceType::kMeta) { return Maybe<void>::Ok(); }
 
+  if (auto* trace = CurrentCapturingEagerOpTrace()) {
+    TensorTuple actual_inputs(inputs.size());
+    for (int i = 0, host_input_index = 0; i < inputs.size(); i++) {
+      actual_inputs.at(i) = user_op_expr.IsHostMemoryInput(i) ? host_inputs.at(host_input_index++)
+                                                              : inputs.at(i);
+    }
+    JUST(trace->RecordOpCall(kernel, actual_inputs, *outputs, input_eager_blob_objects,
+                             output_eager_blob_objects, ctx, result->stream()));
+  }
+
   JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
     return builder->Call(kernel, std::move(input_eager_blob_objects),
                          std::move(output_eager_blob_objects), ctx, result->stream());
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <atomic>
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/framework/dtype.h"
 #include "oneflow/core/framework/variable_tensor_mgr.h"
@@ -24,6 +25,16 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+std::atomic<int64_t> variable_generation(0);
+
+}  // namespace
+
+int64_t VariableGeneration() { return variable_generation.load(std::memory_order_acquire); }
+
+void IncreaseVariableGeneration() { variable_generation.fetch_add(1, std::memory_order_release); }
+
 Maybe<void> VariableTensorMgr::Set(const std::string& variable_op_name,
                                    const std::shared_ptr<one::Tensor>& variable_tensor,
                                    const Symbol<DType>& dtype) {
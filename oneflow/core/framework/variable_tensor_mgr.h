@@ -57,6 +57,11 @@ class VariableTensorMgr final {
   std::map<std::string, std::shared_ptr<one::Tensor>> variables_;
 };
 
+// Counts the updates of the variables made out of the graphs, e.g. by load_state_dict, so the
+// kernels keeping a transform of their weights know when to redo it
+int64_t VariableGeneration();
+void IncreaseVariableGeneration();
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_FRAMEWORK_VARIABLE_TENSOR_MGR_H_
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include <memory>
 #include <string>
+#include "oneflow/core/auto_parallel/cost_database.h"
 #include "oneflow/core/common/singleton.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/graph/compute_task_node.h"
@@ -45,6 +46,23 @@ enum TaskClassifier : int {
 // The difference between a descending order and its corresponding ascending order
 static const int kDiff4AscendDescend = 100;
 
+// A kernel measured shorter than this would be covered by the cpu time for launching it.
+static const double kShortKernelTimeUs = 10.0;
+
+// Look up the measured kernel time of the compute task node in the cost database.
+// Return false if not measured.
+bool GetMeasuredComputeTime(const CompTaskNode* comp_task_node, double* time_us) {
+  const auto* cost_database = Singleton<auto_parallel::CostDatabase>::Get();
+  if (cost_database == nullptr || comp_task_node->op_node() == nullptr) { return false; }
+  const OpNode* op_node = comp_task_node->op_node();
+  auto LogicalBlobDesc4Bn = [&](const std::string& bn) -> const BlobDesc& {
+    return op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(bn));
+  };
+  const auto& key = CHECK_JUST(auto_parallel::ComputeCostKey4Op(
+      op_node->op(), op_node->nd_sbp_signature(), LogicalBlobDesc4Bn, op_node->parallel_desc()));
+  return cost_database->GetComputeTime(key, time_us);
+}
+
 class TopoStruct {
  public:
   TaskNode* node = nullptr;
@@ -336,11 +354,15 @@ void TopoStruct::ComputeMemoryIncrement() {
 
 // Exceed time = time of cpu - time of gpu
 void TopoStruct::ComputeExceedTime() {
-  if (node->GetTaskType() == TaskType::kNormalForward
-      && ShortGpuTime(dynamic_cast<const CompTaskNode*>(node)->op()->op_conf())) {
+  exceed_time = 0;
+  if (node->GetTaskType() != TaskType::kNormalForward) { return; }
+  const auto* comp_task_node = dynamic_cast<const CompTaskNode*>(node);
+  // Prefer the profiled kernel time over the empirical list of operators
+  double time_us = 0.0;
+  if (GetMeasuredComputeTime(comp_task_node, &time_us)) {
+    if (time_us < kShortKernelTimeUs) { exceed_time = 1; }
+  } else if (ShortGpuTime(comp_task_node->op()->op_conf())) {
     exceed_time = 1;
-  } else {
-    exceed_time = 0;
   }
 }
 
@@ -20,8 +20,7 @@ limitations under the License.
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job_rewriter/job_completer.h"
-#include "oneflow/core/thread/thread_pool.h"
-#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/common/cost_util.h"
 #include "oneflow/core/job/lazy_mode.h"
 
@@ -54,30 +53,25 @@ void Compiler::Compile(Job* job, Plan* plan) const {
   compile_tc->Count("[GraphCompile]" + job_name + " BuildTaskGraph", 1, true);
 
   // Step3: put infomation from task_gph into plan.
-  const int64_t node_num = task_gph->node_num();
-  const int64_t cpu_num = std::thread::hardware_concurrency();
-  const int64_t thread_pool_size = std::min(node_num, cpu_num);
-  BlockingCounter counter(node_num);
+  // NOTE: use the shared work-stealing pool instead of spawning a pool per compilation.
+  std::vector<TaskNode*> task_nodes;
+  task_nodes.reserve(task_gph->node_num());
+  task_gph->ForEachNode([&](TaskNode* task_node) { task_nodes.push_back(task_node); });
   std::mutex mtx;
-  ThreadPool thread_pool(thread_pool_size);
-  task_gph->ForEachNode([&](TaskNode* task_node) {
-    thread_pool.AddWork([task_node, plan, &job_desc, &counter, &mtx]() {
-      if (!task_node->IsMeaningLess()) {
-        TaskProto task_proto;
-        task_node->ToProto(&task_proto);
-        {
-          std::unique_lock<std::mutex> guard(mtx);
-          if (task_node->GetTaskType() == kNormalForward || task_node->GetTaskType() == kRepeat
-              || task_node->GetTaskType() == kAcc) {
-            PlanUtil::CreateOpAttributeRef(plan, job_desc.job_id(), &task_proto);
-          }
-          plan->mutable_task()->Add(std::move(task_proto));
-        }  // guard(mtx)
+  MultiThreadLoop(task_nodes.size(), [&](size_t i) {
+    TaskNode* task_node = task_nodes.at(i);
+    if (task_node->IsMeaningLess()) { return; }
+    TaskProto task_proto;
+    task_node->ToProto(&task_proto);
+    {
+      std::unique_lock<std::mutex> guard(mtx);
+      if (task_node->GetTaskType() == kNormalForward || task_node->GetTaskType() == kRepeat
+          || task_node->GetTaskType() == kAcc) {
+        PlanUtil::CreateOpAttributeRef(plan, job_desc.job_id(), &task_proto);
       }
-      counter.Decrease();
-    } /* thread_pool.AddWork */);
-  } /* task_gph->ForEachNode */);
-  counter.WaitForeverUntilCntEqualZero();
+      plan->mutable_task()->Add(std::move(task_proto));
+    }  // guard(mtx)
+  });
   // NOTE(levi): release task_gph here to decrise memory peak.
   task_gph.reset();
   compile_tc->Count("[GraphCompile]" + job_name + " AddTaskToPlan", 1, true);
@@ -52,6 +52,8 @@ limitations under the License.
 #include "oneflow/core/kernel/sync_check_kernel_observer.h"
 #include "oneflow/core/kernel/blob_access_checker_kernel_observer.h"
 #include "oneflow/core/kernel/profiler_kernel_observer.h"
+#include "oneflow/core/kernel/cost_calibration_kernel_observer.h"
+#include "oneflow/core/auto_parallel/cost_database.h"
 #include "oneflow/core/embedding/embedding_manager.h"
 #include "oneflow/core/vm/remat/env.h"
 #ifdef WITH_RDMA
@@ -195,10 +197,10 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
   Singleton<remat::AllocatorManager>::New();
   Singleton<ThreadPool>::New(Singleton<ResourceDesc, ForSession>::Get()->ComputeThreadPoolSize());
   SetCpuDeviceManagerNumThreads();
+  Singleton<embedding::EmbeddingManager>::New();
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
   Singleton<CudnnConvAlgoCache>::New();
   Singleton<CudnnHandlePool>::New();
-  Singleton<embedding::EmbeddingManager>::New();
 #endif
   const auto& vaild_ccl_comm_mgr_device_types =
       EagerCclCommMgrBuilder::Get().vaild_ccl_comm_mgr_device_types();
@@ -218,8 +220,24 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
     Singleton<CommNet>::SetAllocated(Singleton<EpollCommNet>::Get());
   }
 #endif  // __linux__
+  const std::string& cost_database_path = auto_parallel::CostDatabasePath();
+  if (!cost_database_path.empty()) {
+    Singleton<auto_parallel::CostDatabase>::New();
+    if (LocalFS()->FileExists(cost_database_path)) {
+      JUST(Singleton<auto_parallel::CostDatabase>::Get()->Load(cost_database_path));
+    }
+  }
   {
     std::vector<std::shared_ptr<KernelObserver>> kernel_observers;
+    if (ParseBooleanFromEnv("ONEFLOW_AUTO_PARALLEL_COST_CALIBRATION", false)) {
+      CHECK_OR_RETURN(!cost_database_path.empty())
+          << "Environment variable ONEFLOW_AUTO_PARALLEL_COST_DATABASE should be set to the path "
+             "of the cost database while calibrating";
+      LOG(WARNING) << "Environment variable ONEFLOW_AUTO_PARALLEL_COST_CALIBRATION has been set to "
+                      "a truthy value, it will impact performance";
+      kernel_observers.emplace_back(
+          new CostCalibrationKernelObserver(Singleton<auto_parallel::CostDatabase>::Get()));
+    }
     if (ParseBooleanFromEnv("ONEFLOW_DEBUG_KERNEL_SYNC_CHECK", false)) {
       LOG(WARNING)
           << "Environment variable ONEFLOW_DEBUG_KERNEL_SYNC_CHECK has been set to a truthy "
@@ -242,6 +260,15 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
   if (is_normal_exit_.has_value() && !CHECK_JUST(is_normal_exit_)) { return; }
   TensorBufferPool::Delete();
   Singleton<KernelObserver>::Delete();
+  if (Singleton<auto_parallel::CostDatabase>::Get() != nullptr) {
+    // All the ranks should load the same database to make the same sbp decision
+    if (ParseBooleanFromEnv("ONEFLOW_AUTO_PARALLEL_COST_CALIBRATION", false)
+        && GlobalProcessCtx::Rank() == 0) {
+      CHECK_JUST(Singleton<auto_parallel::CostDatabase>::Get()->Save(
+          auto_parallel::CostDatabasePath()));
+    }
+    Singleton<auto_parallel::CostDatabase>::Delete();
+  }
 #ifdef __linux__
   if (Singleton<ResourceDesc, ForSession>::Get()->process_ranks().size() > 1) {
     if (Singleton<EpollCommNet>::Get() != dynamic_cast<EpollCommNet*>(Singleton<CommNet>::Get())) {
@@ -252,8 +279,8 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
   Singleton<EpollCommNet>::Delete();
 #endif  // __linux__
   Singleton<vm::VirtualMachineScope>::Delete();
-#if defined(WITH_CUDA) || defined(WITH_ROCM)
   Singleton<embedding::EmbeddingManager>::Delete();
+#if defined(WITH_CUDA) || defined(WITH_ROCM)
   Singleton<CudnnConvAlgoCache>::Delete();
   Singleton<CudnnHandlePool>::Delete();
 #endif
@@ -954,7 +954,7 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
       LogJob("pass_cnt_" + std::to_string(pass_cnt) + "-" + pass_name + cnt_str + "-before");
       FLAGS_v = 3;
     }
-    JUST(JobPass4Name(pass_name)(mut_job(), &job_pass_ctx));
+    JUST(ApplyJobPass(pass_name, mut_job(), &job_pass_ctx));
     if (unlikely(NeedLogJob(pass_name))) {
       FLAGS_v = prev_v;
       std::string cnt_str = cnt > 0 ? std::to_string(cnt) : "";
@@ -1027,6 +1027,8 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
     JUST(DoPass("DoParallelCastBeforeWideningTypeCast"));
     JUST(DoPass("FuseCastScalePass"));
     JUST(DoPass("PruneParallelCastOpsPass"));
+    // after the ir round trip, which could eliminate the observers inserted by it
+    JUST(DoPass("PostTrainingQuantization"));
     JUST(DoPass("FuseUpdateOpsPass"));
     JUST(DoPass("FuseModelUpdateCastOpsPass"));
     JUST(DoPass("MultiTensorModelUpdatePass"));
@@ -1041,6 +1043,9 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
   }
   JUST(DoPass("DumpBlobParallelConfPass"));
   JUST(CheckJob());
+  if (ParseBooleanFromEnv("ONEFLOW_PRINT_JOB_PASS_COST", false)) {
+    LOG(INFO) << job_name << " " << JobPassCostReport(job_pass_ctx);
+  }
   compile_tc->Count("[GraphCompile]" + job_name + " OptimizationLogicalGraph", 0);
   return Maybe<void>::Ok();
 }
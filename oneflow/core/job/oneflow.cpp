@@ -120,6 +120,8 @@ void PushPlan(const std::string& plan_name, Plan&& plan) {
   *(cluster_thrd_ids.mutable_machine_id2thrd_ids()) = HashMap2PbMap(machine_id2thrd_ids);
   Singleton<CtrlClient>::Get()->PushKV(cluster_thrd_ids_key(plan_name), cluster_thrd_ids);
 
+  std::vector<std::pair<std::string, std::string>> sub_plan_kvs;
+  sub_plan_kvs.reserve(mchn_thrd_id2task_protos.size());
   for (std::pair<const std::pair<int64_t, int64_t>, std::list<oneflow::TaskProto>>& pair :
        mchn_thrd_id2task_protos) {
     SubPlan sub_plan;
@@ -128,9 +130,10 @@ void PushPlan(const std::string& plan_name, Plan&& plan) {
       sub_plan.mutable_task()->Add(std::move(pair.second.front()));
       pair.second.pop_front();
     }
-    Singleton<CtrlClient>::Get()->PushKV(
-        sub_plan_key(plan_name, pair.first.first, pair.first.second), sub_plan);
+    sub_plan_kvs.emplace_back(sub_plan_key(plan_name, pair.first.first, pair.first.second), "");
+    sub_plan.SerializeToString(&sub_plan_kvs.back().second);
   }
+  Singleton<CtrlClient>::Get()->BatchPushKV(sub_plan_kvs);
 
   for (const auto& mem_block : plan.block_chunk_list().mem_block()) {
     *machine_id2block7chunk[mem_block.machine_id()].add_mem_block() = mem_block;
@@ -159,9 +162,15 @@ void PullPlan(const std::string& plan_name, Plan* plan) {
   auto thrd_ids_it = machine_id2thrd_ids.find(machine_id);
   CHECK(thrd_ids_it != machine_id2thrd_ids.end());
   std::vector<int64_t> thrd_id_vec = PbRf2StdVec(thrd_ids_it->second.thrd_id());
+  std::vector<std::string> sub_plan_keys;
   for (auto thrd_id : thrd_id_vec) {
+    sub_plan_keys.emplace_back(sub_plan_key(plan_name, machine_id, thrd_id));
+  }
+  std::vector<std::string> sub_plan_vals;
+  Singleton<CtrlClient>::Get()->BatchPullKV(sub_plan_keys, &sub_plan_vals);
+  for (const std::string& sub_plan_val : sub_plan_vals) {
     SubPlan sub_plan;
-    Singleton<CtrlClient>::Get()->PullKV(sub_plan_key(plan_name, machine_id, thrd_id), &sub_plan);
+    CHECK(sub_plan.ParseFromString(sub_plan_val));
     plan->mutable_task()->MergeFrom(sub_plan.task());
   }
   CtrlRegstDescInfo ctrl_regst_desc_info;
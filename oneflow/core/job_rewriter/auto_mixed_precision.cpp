@@ -50,11 +50,14 @@ bool FindInNoCastRegisry(const std::string& op_type, const OpArg& op_arg) {
   return false;
 }
 
-std::function<bool(OpNode*)> MakePredicatorIsAllowedToRunWithHalf(const OpGraph& op_graph) {
+bool IsCpuNode(OpNode* node) { return node->parallel_desc().device_type() == DeviceType::kCPU; }
+
+std::function<bool(OpNode*)> MakePredicatorIsAllowedToRunWithHalf(
+    const OpGraph& op_graph, const DataType mixed_precision_data_type) {
   auto allowed_set = std::make_shared<HashSet<OpNode*>>();
   op_graph.ForEachNode([&](OpNode* node) {
-    // half computation is not supported on cpu
-    if (node->parallel_desc().device_type() == DeviceType::kCPU) { return; }
+    // only bfloat16 computation is supported on cpu
+    if (IsCpuNode(node) && mixed_precision_data_type != DataType::kBFloat16) { return; }
     if (node->op().output_bns().size() > 0
         || IsUserOpWithTypeName(node->op().op_conf(), "one_embedding_fused_lookup_grad")) {
       INSERT_CHECK(allowed_set->insert(node));
@@ -160,7 +163,10 @@ class AutoMixedPrecision final : public JobPass {
       : white_list_(AutoMixedPrecisionLists::WhiteList()),
         black_list_(AutoMixedPrecisionLists::BlackList()),
         gray_list_(AutoMixedPrecisionLists::GrayList()),
-        clear_list_(AutoMixedPrecisionLists::ClearList()) {}
+        clear_list_(AutoMixedPrecisionLists::ClearList()),
+        cpu_white_list_(AutoMixedPrecisionLists::CpuWhiteList()),
+        cpu_gray_list_(AutoMixedPrecisionLists::CpuGrayList()),
+        cpu_clear_list_(AutoMixedPrecisionLists::CpuClearList()) {}
   ~AutoMixedPrecision() = default;
 
   bool IsEnabled(const JobPassCtx& ctx) const {
@@ -184,10 +190,24 @@ class AutoMixedPrecision final : public JobPass {
   void InsertCastOp(const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
                     const DataType mixed_precision_data_type, JobBuilder* job_builder) const;
 
+  bool IsWhite(OpNode* node) const {
+    return IsNodeInList(IsCpuNode(node) ? cpu_white_list_ : white_list_, node);
+  }
+  bool IsBlack(OpNode* node) const { return IsNodeInList(black_list_, node); }
+  bool IsGray(OpNode* node) const {
+    return IsNodeInList(IsCpuNode(node) ? cpu_gray_list_ : gray_list_, node);
+  }
+  bool IsClear(OpNode* node) const {
+    return IsNodeInList(IsCpuNode(node) ? cpu_clear_list_ : clear_list_, node);
+  }
+
   const AMPList& white_list_;
   const AMPList& black_list_;
   const AMPList& gray_list_;
   const AMPList& clear_list_;
+  const AMPList& cpu_white_list_;
+  const AMPList& cpu_gray_list_;
+  const AMPList& cpu_clear_list_;
 };
 
 Maybe<void> AutoMixedPrecision::Apply(Job* job, JobPassCtx* ctx) const {
@@ -200,6 +220,9 @@ Maybe<void> AutoMixedPrecision::Apply(Job* job, JobPassCtx* ctx) const {
   VerifyAMPList(black_list_);
   VerifyAMPList(gray_list_);
   VerifyAMPList(clear_list_);
+  VerifyAMPList(cpu_white_list_);
+  VerifyAMPList(cpu_gray_list_);
+  VerifyAMPList(cpu_clear_list_);
 
   std::function<std::string(OpNode* const&)> OpName4Node = [](OpNode* const& node) {
     return node->op().op_name();
@@ -211,16 +234,17 @@ Maybe<void> AutoMixedPrecision::Apply(Job* job, JobPassCtx* ctx) const {
   VLOG(3) << "BlackSet include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(black_set, OpName4Node);
 
-  auto IsAllowedToRunWithHalf = MakePredicatorIsAllowedToRunWithHalf(op_graph);
+  const DataType mixed_precision_data_type = ctx->job_desc().mixed_precision_data_type();
+  CHECK(mixed_precision_data_type == DataType::kFloat16
+        || mixed_precision_data_type == DataType::kBFloat16);
+  auto IsAllowedToRunWithHalf =
+      MakePredicatorIsAllowedToRunWithHalf(op_graph, mixed_precision_data_type);
   FillWhiteSet(op_graph, IsAllowedToRunWithHalf, black_set, &white_set);
   VLOG(3) << "WhiteSet Before Propagate include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(white_set, OpName4Node);
   PropagateWhiteThroughClearNodes(op_graph, IsAllowedToRunWithHalf, black_set, &white_set);
   VLOG(2) << "WhiteSet include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(white_set, OpName4Node);
-  const DataType mixed_precision_data_type = ctx->job_desc().mixed_precision_data_type();
-  CHECK(mixed_precision_data_type == DataType::kFloat16
-        || mixed_precision_data_type == DataType::kBFloat16);
   InsertCastOp(op_graph, white_set, mixed_precision_data_type, &job_builder);
   return Maybe<void>::Ok();
 }
@@ -229,10 +253,8 @@ void AutoMixedPrecision::FillBlackSet(const OpGraph& op_graph, HashSet<OpNode*>*
   HashSet<OpNode*> upstream_or_part_of_black_and_gray;
   DfsTopoGraphTraversal(
       op_graph, true,
-      [&](OpNode* node) {
-        return IsNodeInList(black_list_, node) || IsNodeInList(gray_list_, node);
-      },
-      [&](OpNode* node) { return IsNodeInList(clear_list_, node); },
+      [&](OpNode* node) { return IsBlack(node) || IsGray(node); },
+      [&](OpNode* node) { return IsClear(node); },
       [&](OpNode* node) { return IsKeyFound(upstream_or_part_of_black_and_gray, node); },
       [&](OpNode* node) {
         INSERT_CHECK(upstream_or_part_of_black_and_gray.insert(node));
@@ -242,7 +264,7 @@ void AutoMixedPrecision::FillBlackSet(const OpGraph& op_graph, HashSet<OpNode*>*
 
   // propagate black through upstream_or_part_of_black_and_gray
   DfsTopoGraphTraversal(
-      op_graph, false, [&](OpNode* node) { return IsNodeInList(black_list_, node); },
+      op_graph, false, [&](OpNode* node) { return IsBlack(node); },
       [&](OpNode* node) { return IsKeyFound(upstream_or_part_of_black_and_gray, node); },
       [&](OpNode* node) { return IsKeyFound(*black_set, node); },
       [&](OpNode* node) {
@@ -257,16 +279,14 @@ void AutoMixedPrecision::FillWhiteSet(const OpGraph& op_graph,
                                       HashSet<OpNode*>* white_set) const {
   auto IsWhiteOrSinkAndAllowedToRunHalf = [&](OpNode* node) {
     return IsAllowedToRunWithHalf(node)
-           && (IsNodeInList(white_list_, node)
-               || (node->out_edges().empty()
-                   && (IsNodeInList(gray_list_, node) || IsNodeInList(clear_list_, node))));
+           && (IsWhite(node) || (node->out_edges().empty() && (IsGray(node) || IsClear(node))));
   };
   HashSet<OpNode*> upstream_or_part_of_white;
   DfsTopoGraphTraversal(
       op_graph, true, IsWhiteOrSinkAndAllowedToRunHalf,
       [&](OpNode* node) {
         return !IsKeyFound(black_set, node) && IsAllowedToRunWithHalf(node)
-               && (IsNodeInList(gray_list_, node) || IsNodeInList(clear_list_, node));
+               && (IsGray(node) || IsClear(node));
       },
       [&](OpNode* node) { return IsKeyFound(upstream_or_part_of_white, node); },
       [&](OpNode* node) {
@@ -276,7 +296,7 @@ void AutoMixedPrecision::FillWhiteSet(const OpGraph& op_graph,
       });
 
   auto IsWhiteAndAllowedToRunHalf = [&](OpNode* node) {
-    return IsAllowedToRunWithHalf(node) && IsNodeInList(white_list_, node);
+    return IsAllowedToRunWithHalf(node) && IsWhite(node);
   };
   DfsTopoGraphTraversal(
       op_graph, false, IsWhiteAndAllowedToRunHalf,
@@ -296,7 +316,7 @@ void AutoMixedPrecision::PropagateWhiteThroughClearNodes(
         op_graph, !is_downward, [&](OpNode* node) { return false; },
         [&](OpNode* node) {
           return !IsKeyFound(*white_set, node) && !IsKeyFound(black_set, node)
-                 && IsNodeInList(clear_list_, node) && IsAllowedToRunWithHalf(node);
+                 && IsClear(node) && IsAllowedToRunWithHalf(node);
         },
         [&](OpNode* node) { return IsKeyFound(*white_set, node); },
         [&](OpNode* node) {
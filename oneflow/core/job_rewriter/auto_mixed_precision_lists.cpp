@@ -532,3 +532,26 @@ const AMPList& AutoMixedPrecisionLists::ClearList() {
 }  // namespace oneflow
 
 #endif
+
+namespace oneflow {
+
+const AMPList& AutoMixedPrecisionLists::CpuWhiteList() {
+  static AMPList white_list = {"matmul", "batch_matmul", "broadcast_matmul",
+                               "broadcast_matmul_grad_b", "amp_white_identity"};
+  return white_list;
+}
+
+const AMPList& AutoMixedPrecisionLists::CpuGrayList() {
+  static AMPList gray_list = {"add_n",         "bias_add",      "broadcast_add", "broadcast_sub",
+                              "broadcast_mul", "broadcast_div", "scalar_add",    "scalar_mul",
+                              "scalar_div"};
+  return gray_list;
+}
+
+const AMPList& AutoMixedPrecisionLists::CpuClearList() {
+  static AMPList clear_list = {"reshape",  "reshape_like", "squeeze", "expand_dims",
+                               "identity", "transpose",    "relu",    "relu_grad"};
+  return clear_list;
+}
+
+}  // namespace oneflow
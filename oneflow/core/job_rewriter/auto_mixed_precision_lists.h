@@ -30,6 +30,10 @@ class AutoMixedPrecisionLists final {
   static const AMPList& BlackList();
   static const AMPList& GrayList();
   static const AMPList& ClearList();
+  // The ops with bfloat16 kernels on cpu, the black list is shared with the other devices
+  static const AMPList& CpuWhiteList();
+  static const AMPList& CpuGrayList();
+  static const AMPList& CpuClearList();
 };
 
 }  // namespace oneflow
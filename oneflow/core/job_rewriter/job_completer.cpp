@@ -149,29 +149,32 @@ Maybe<void> JobCompleter::Complete(Job* job) {
   compile_tc->Count("[GraphCompile]" + job_name + " AutoSourceAndSinkTick", 1, true);
   JUST(WithOpGraphAndMutJob(job, &MultiClientAutoInterfaceCriticalSectionTick));
   compile_tc->Count("[GraphCompile]" + job_name + " CriticalSectionTick", 1, true);
-  JUST(JobPass4Name("SystemOpFillJobNamePass")(job, &job_pass_ctx));
+  JUST(ApplyJobPass("SystemOpFillJobNamePass", job, &job_pass_ctx));
   compile_tc->Count("[GraphCompile]" + job_name + " SystemOpFillJobNamePass", 1, true);
-  JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+  JUST(ApplyJobPass("DumpBlobParallelConfPass", job, &job_pass_ctx));
   compile_tc->Count("[GraphCompile]" + job_name + " DumpBlobParallelConfPass", 1, true);
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
   if (Singleton<ResourceDesc, ForSession>::Get()->nccl_use_compute_stream()) {
     // NOTE(chengcheng): this pass need as last pass for insert correct op with nccl boxing.
-    JUST(JobPass4Name("InsertNcclLogicalOpPass")(job, &job_pass_ctx));
+    JUST(ApplyJobPass("InsertNcclLogicalOpPass", job, &job_pass_ctx));
     compile_tc->Count("[GraphCompile]" + job_name + " InsertNcclLogicalOpPass", 1, true);
     // NOTE(chengcheng): must do this pass after InsertNcclLogicalOpPass for nccl op fusion and
     //    add ctrl stirct order.
-    JUST(JobPass4Name("NcclLogicalOpFusionPass")(job, &job_pass_ctx));
+    JUST(ApplyJobPass("NcclLogicalOpFusionPass", job, &job_pass_ctx));
     compile_tc->Count("[GraphCompile]" + job_name + " NcclLogicalOpFusionPass", 1, true);
-    JUST(JobPass4Name("NcclLogicalChainStrictOrderPass")(job, &job_pass_ctx));
+    JUST(ApplyJobPass("NcclLogicalChainStrictOrderPass", job, &job_pass_ctx));
     compile_tc->Count("[GraphCompile]" + job_name + " NcclLogicalChainStrictOrderPass", 1, true);
 
     // NOTE(chengcheng): Because insert new logical nccl op, MUST dump time shape, sbp again.
-    JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+    JUST(ApplyJobPass("DumpBlobParallelConfPass", job, &job_pass_ctx));
     compile_tc->Count("[GraphCompile]" + job_name + " DumpBlobParallelConfPass", 1, true);
   }
 #endif  // WITH_CUDA
-  JUST(JobPass4Name("LogicalChainPass")(job, &job_pass_ctx));
-  JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+  JUST(ApplyJobPass("LogicalChainPass", job, &job_pass_ctx));
+  JUST(ApplyJobPass("DumpBlobParallelConfPass", job, &job_pass_ctx));
+  if (ParseBooleanFromEnv("ONEFLOW_PRINT_JOB_PASS_COST", false)) {
+    LOG(INFO) << job_name << " " << JobPassCostReport(job_pass_ctx);
+  }
 
   JUST(CheckAndLogOpGraph(*job));
   compile_tc->Count("[GraphCompile]" + job_name + " CheckAndLogOpGraph", 1, true);
@@ -274,7 +277,7 @@ Maybe<void> JobCompleter::UpdateSharedGraphForNewInput(
 #ifdef WITH_CUTLASS
   // Warmup cutlass conv with new input shape.
   JobPassCtx job_pass_ctx(GlobalJobDesc());
-  JUST(JobPass4Name("CutlassConvTuningWarmupPass")(job, &job_pass_ctx));
+  JUST(ApplyJobPass("CutlassConvTuningWarmupPass", job, &job_pass_ctx));
 #endif  // WITH_CUTLASS
 
   JUST(CheckAndLogOpGraph(*job));
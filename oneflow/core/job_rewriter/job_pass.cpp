@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/job_rewriter/job_pass.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
 
 namespace oneflow {
 
@@ -40,4 +43,47 @@ const JobPass& JobPass4Name(const std::string& pass_name) {
   return *iter->second;
 }
 
+Maybe<void> ApplyJobPass(const std::string& pass_name, Job* job, JobPassCtx* ctx) {
+  const auto start = std::chrono::steady_clock::now();
+  JUST(JobPass4Name(pass_name)(job, ctx));
+  const auto cost = std::chrono::steady_clock::now() - start;
+  ctx->AddPassCost(pass_name, std::chrono::duration_cast<std::chrono::microseconds>(cost).count());
+  return Maybe<void>::Ok();
+}
+
+std::string JobPassCostReport(const JobPassCtx& ctx) {
+  struct TotalCost {
+    int64_t cost_us = 0;
+    int64_t run_cnt = 0;
+  };
+  std::vector<std::string> pass_names;
+  HashMap<std::string, TotalCost> pass_name2total_cost;
+  int64_t total_cost_us = 0;
+  for (const auto& pass_cost : ctx.pass_costs()) {
+    auto iter = pass_name2total_cost.find(pass_cost.pass_name);
+    if (iter == pass_name2total_cost.end()) {
+      pass_names.emplace_back(pass_cost.pass_name);
+      iter = pass_name2total_cost.emplace(pass_cost.pass_name, TotalCost()).first;
+    }
+    iter->second.cost_us += pass_cost.cost_us;
+    iter->second.run_cnt += 1;
+    total_cost_us += pass_cost.cost_us;
+  }
+  std::stable_sort(pass_names.begin(), pass_names.end(),
+                   [&](const std::string& lhs, const std::string& rhs) {
+                     return pass_name2total_cost.at(lhs).cost_us
+                            > pass_name2total_cost.at(rhs).cost_us;
+                   });
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(2);
+  ss << "job pass cost, total " << total_cost_us / 1000.0 << " ms";
+  for (const auto& pass_name : pass_names) {
+    const TotalCost& total_cost = pass_name2total_cost.at(pass_name);
+    ss << "\n  " << pass_name << ": " << total_cost.cost_us / 1000.0 << " ms, "
+       << 100.0 * total_cost.cost_us / std::max<int64_t>(total_cost_us, 1) << "%, "
+       << total_cost.run_cnt << " run(s)";
+  }
+  return ss.str();
+}
+
 }  // namespace oneflow
@@ -91,9 +91,19 @@ class JobPassCtx {
     return Maybe<void>::Ok();
   }
 
+  struct PassCost {
+    std::string pass_name;
+    int64_t cost_us;
+  };
+  void AddPassCost(const std::string& pass_name, int64_t cost_us) {
+    pass_costs_.emplace_back(PassCost{pass_name, cost_us});
+  }
+  const std::vector<PassCost>& pass_costs() const { return pass_costs_; }
+
  private:
   const JobDesc* job_desc_;
   HashMap<std::string, std::unique_ptr<JobPassState>> key2state_;
+  std::vector<PassCost> pass_costs_;
 };
 
 #define REGISTER_JOB_PASS(pass_name, pass_type) COMMAND(RegisterJobPass(pass_name, new pass_type))
@@ -102,6 +112,11 @@ void RegisterJobPass(const std::string& pass_name, const JobPass* pass);
 bool HasJobPass(const std::string& pass_name);
 const JobPass& JobPass4Name(const std::string& pass_name);
 
+// Runs the pass on job and records its cost into ctx.
+Maybe<void> ApplyJobPass(const std::string& pass_name, Job* job, JobPassCtx* ctx);
+// Per pass total cost recorded in ctx, most expensive first.
+std::string JobPassCostReport(const JobPassCtx& ctx);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_JOB_REWRITER_JOB_PASS_H_
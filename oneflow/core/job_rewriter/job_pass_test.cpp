@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <regex>
+#include <thread>
+#include "gtest/gtest.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// Sleeps for the number of milliseconds given by the ops of the job, so that the passes have
+// costs in a known order
+class JobPassCostTestPass final : public JobPass {
+ public:
+  JobPassCostTestPass() = default;
+  ~JobPassCostTestPass() override = default;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(job->net().op_size()));
+    return Maybe<void>::Ok();
+  }
+};
+
+class JobPassCostNopTestPass final : public JobPass {
+ public:
+  JobPassCostNopTestPass() = default;
+  ~JobPassCostNopTestPass() override = default;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override { return Maybe<void>::Ok(); }
+};
+
+REGISTER_JOB_PASS("JobPassCostTestPass", JobPassCostTestPass);
+REGISTER_JOB_PASS("JobPassCostNopTestPass", JobPassCostNopTestPass);
+
+struct ResourceDescScope final {
+  ResourceDescScope() { Singleton<ResourceDesc, ForSession>::New(Resource()); }
+  ~ResourceDescScope() { Singleton<ResourceDesc, ForSession>::Delete(); }
+};
+
+}  // namespace
+
+TEST(JobPass, cost_report) {
+  ResourceDescScope scope;
+  Job job;
+  job.mutable_job_conf()->set_job_name("job_pass_cost_report");
+  job.mutable_job_conf()->mutable_predict_conf();
+  for (int i = 0; i < 5; ++i) { job.mutable_net()->add_op()->set_name(std::to_string(i)); }
+  JobDesc job_desc(job.job_conf());
+  JobPassCtx ctx(job_desc);
+  CHECK_JUST(ApplyJobPass("JobPassCostNopTestPass", &job, &ctx));
+  CHECK_JUST(ApplyJobPass("JobPassCostTestPass", &job, &ctx));
+  CHECK_JUST(ApplyJobPass("JobPassCostTestPass", &job, &ctx));
+  ASSERT_EQ(ctx.pass_costs().size(), 3u);
+  ASSERT_EQ(ctx.pass_costs().at(0).pass_name, "JobPassCostNopTestPass");
+  ASSERT_GE(ctx.pass_costs().at(1).cost_us, 5000);
+  // the most expensive pass comes first, with the runs of the same pass summed up
+  const std::regex report_regex(
+      "job pass cost, total [0-9]+\\.[0-9]{2} ms\n"
+      "  JobPassCostTestPass: [0-9]+\\.[0-9]{2} ms, [0-9]+\\.[0-9]{2}%, 2 run\\(s\\)\n"
+      "  JobPassCostNopTestPass: [0-9]+\\.[0-9]{2} ms, [0-9]+\\.[0-9]{2}%, 1 run\\(s\\)");
+  const std::string report = JobPassCostReport(ctx);
+  ASSERT_TRUE(std::regex_match(report, report_regex)) << report;
+}
+
+}  // namespace test
+
+}  // namespace oneflow
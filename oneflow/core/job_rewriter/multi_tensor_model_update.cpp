@@ -213,7 +213,6 @@ Maybe<void> MultiTensorModelUpdatePass::Apply(const OpGraph& op_graph,
                                               JobBuilder* job_builder) const {
   if (!job_builder->job().job_conf().has_train_conf()) { return Maybe<void>::Ok(); }
   std::vector<OperatorConf> delete_ops;
-  ParallelConf parallel_conf{};
   HashMap<SGDOptimizerKey, user_op::UserOpConfWrapperBuilder> multi_tensor_sgd_update_hashmap;
   HashMap<AdamOptimizerKey, user_op::UserOpConfWrapperBuilder> multi_tensor_adam_update_hashmap;
   HashSet<std::string> processed_variable_list{};
@@ -231,10 +230,9 @@ Maybe<void> MultiTensorModelUpdatePass::Apply(const OpGraph& op_graph,
       }
       const user_op::UserOpConfWrapper model_update_user_conf(
           find_model_update_update_node->op().op_conf());
-      // Multi tensor update pass only support for CUDA currently.
-      if (find_model_update_update_node->parallel_desc().device_type() != DeviceType::kCUDA) {
-        continue;
-      }
+      // Multi tensor update pass only support for CUDA and CPU currently.
+      const DeviceType device_type = find_model_update_update_node->parallel_desc().device_type();
+      if (device_type != DeviceType::kCUDA && device_type != DeviceType::kCPU) { continue; }
 
       // Multi tensor update pass only support Data Parallel.
       bool if_data_parallel = true;
@@ -251,7 +249,8 @@ Maybe<void> MultiTensorModelUpdatePass::Apply(const OpGraph& op_graph,
       if (IfVariableProcessed(processed_variable_list, model_update_user_conf)) { continue; }
 
       delete_ops.emplace_back(find_model_update_update_node->op().op_conf());
-      parallel_conf = find_model_update_update_node->parallel_desc().parallel_conf();
+      const ParallelConf& parallel_conf =
+          find_model_update_update_node->parallel_desc().parallel_conf();
 
       std::string scale_by_tensor_lbn = "";
       std::string skip_if_lbn = "";
@@ -396,11 +395,11 @@ Maybe<void> MultiTensorModelUpdatePass::Apply(const OpGraph& op_graph,
   });
   for (auto& op : multi_tensor_sgd_update_hashmap) {
     auto multi_tensor_model_update_sgd_op = op.second.Build();
-    job_builder->AddOps(parallel_conf, {multi_tensor_model_update_sgd_op.op_conf()});
+    job_builder->AddOps(op.first.parallel_conf, {multi_tensor_model_update_sgd_op.op_conf()});
   }
   for (auto& op : multi_tensor_adam_update_hashmap) {
     auto multi_tensor_model_update_adam_op = op.second.Build();
-    job_builder->AddOps(parallel_conf, {multi_tensor_model_update_adam_op.op_conf()});
+    job_builder->AddOps(op.first.parallel_conf, {multi_tensor_model_update_adam_op.op_conf()});
   }
   job_builder->DelOps(delete_ops);
   return Maybe<void>::Ok();
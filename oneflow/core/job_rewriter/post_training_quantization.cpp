@@ -0,0 +1,389 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job_rewriter/pass_util.h"
+
+namespace oneflow {
+
+namespace {
+
+const std::string OBSERVER_SUFFIX = "-ptq-observer";
+const std::string MOVING_MAX_SUFFIX = "-ptq-moving-max";
+const std::string MOVING_MIN_SUFFIX = "-ptq-moving-min";
+const std::string TRAIN_STEP_SUFFIX = "-ptq-train-step";
+const std::string SCALE_SUFFIX = "-ptq-scale";
+const std::string QUANTIZED_SUFFIX = "-ptq-quantized";
+
+constexpr double kInt8MaxValue = 127.0;
+
+// A matmul or conv2d reading its weight from a variable, with the bias add and relu following it
+struct QuantizableChain {
+  const OpNode* head = nullptr;
+  const OpNode* tail = nullptr;
+  std::vector<const OpNode*> nodes;
+  bool is_conv = false;
+  std::string activation_lbn;
+  std::string weight_lbn;
+  std::string bias_lbn;
+  bool relu = false;
+  std::string out_lbn;
+};
+
+std::string SoleOutputLbn(const OpNode* node) {
+  CHECK_EQ(node->op().output_bns().size(), 1);
+  return GenLogicalBlobName(node->op().BnInOp2Lbi(node->op().SoleObn()));
+}
+
+bool IsFloatBlob(const OpNode* node, const std::string& lbn) {
+  return node->LogicalBlobDesc4Lbi(GenLogicalBlobId(lbn)).data_type() == DataType::kFloat;
+}
+
+bool IsVariableOutput(const OpGraph& op_graph, const std::string& lbn) {
+  const OpNode* producer = op_graph.OpNode4OpName(GenLogicalBlobId(lbn).op_name());
+  return producer->op().op_conf().has_variable_conf();
+}
+
+bool MatchHead(const OpGraph& op_graph, const OpNode* node, QuantizableChain* chain) {
+  const OperatorConf& op_conf = node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  if (node->parallel_desc().device_type() != DeviceType::kCPU) { return false; }
+  const user_op::UserOpConfWrapper conf(op_conf);
+  if (conf.has_input("_add_to_output", 0)) { return false; }
+  const std::string& op_type_name = conf.op_type_name();
+  if (op_type_name == "matmul" || op_type_name == "broadcast_matmul") {
+    if (conf.attr<bool>("transpose_a") || !conf.attr<bool>("transpose_b")
+        || conf.attr<double>("alpha") != 1.0) {
+      return false;
+    }
+    chain->activation_lbn = conf.input("a", 0);
+    chain->weight_lbn = conf.input("b", 0);
+  } else if (op_type_name == "fused_matmul_bias") {
+    if (conf.attr<double>("alpha") != 1.0) { return false; }
+    chain->activation_lbn = conf.input("x", 0);
+    chain->weight_lbn = conf.input("weight", 0);
+    chain->bias_lbn = conf.input("bias", 0);
+  } else if (op_type_name == "conv2d") {
+    if (conf.attr<std::string>("data_format") != "channels_first"
+        || conf.attr<int32_t>("groups") != 1) {
+      return false;
+    }
+    chain->is_conv = true;
+    chain->activation_lbn = conf.input("in", 0);
+    chain->weight_lbn = conf.input("weight", 0);
+    if (conf.has_input("bias", 0)) { chain->bias_lbn = conf.input("bias", 0); }
+  } else {
+    return false;
+  }
+  const Shape& weight_shape =
+      node->LogicalBlobDesc4Lbi(GenLogicalBlobId(chain->weight_lbn)).shape();
+  if (weight_shape.NumAxes() != (chain->is_conv ? 4 : 2)) { return false; }
+  if (!IsFloatBlob(node, chain->activation_lbn) || !IsFloatBlob(node, chain->weight_lbn)) {
+    return false;
+  }
+  if (!IsVariableOutput(op_graph, chain->weight_lbn)) { return false; }
+  chain->head = node;
+  chain->tail = node;
+  chain->nodes = {node};
+  chain->out_lbn = SoleOutputLbn(node);
+  return true;
+}
+
+// The op reading the output of the chain, if it is the only one
+const OpNode* SoleConsumer(const QuantizableChain& chain) {
+  if (chain.tail->out_edges().size() != 1) { return nullptr; }
+  const OpNode* next = chain.tail->SoleOutEdge()->dst_node();
+  if (!next->op().op_conf().has_user_conf()) { return nullptr; }
+  if (next->parallel_desc() != chain.head->parallel_desc()) { return nullptr; }
+  return next;
+}
+
+void Absorb(const OpNode* node, QuantizableChain* chain) {
+  chain->tail = node;
+  chain->nodes.emplace_back(node);
+  chain->out_lbn = SoleOutputLbn(node);
+}
+
+bool IsChannelBias(const OpGraph& op_graph, const QuantizableChain& chain,
+                   const std::string& lbn) {
+  const int64_t channels =
+      chain.head->LogicalBlobDesc4Lbi(GenLogicalBlobId(chain.weight_lbn)).shape().At(0);
+  const BlobDesc& blob_desc = chain.head->LogicalBlobDesc4Lbi(GenLogicalBlobId(lbn));
+  return blob_desc.shape() == Shape({channels}) && blob_desc.data_type() == DataType::kFloat
+         && IsVariableOutput(op_graph, lbn);
+}
+
+void TryAbsorbBiasAdd(const OpGraph& op_graph, QuantizableChain* chain) {
+  if (!chain->bias_lbn.empty()) { return; }
+  const OpNode* next = SoleConsumer(*chain);
+  if (next == nullptr) { return; }
+  const user_op::UserOpConfWrapper conf(next->op().op_conf());
+  std::string bias_lbn;
+  if (conf.op_type_name() == "bias_add") {
+    const int64_t num_axes =
+        chain->tail->LogicalBlobDesc4Lbi(GenLogicalBlobId(chain->out_lbn)).shape().NumAxes();
+    if (conf.input("a", 0) != chain->out_lbn) { return; }
+    if (conf.attr<int32_t>("axis") != (chain->is_conv ? 1 : num_axes - 1)) { return; }
+    bias_lbn = conf.input("b", 0);
+  } else if (conf.op_type_name() == "broadcast_add" && !chain->is_conv) {
+    if (conf.input("x", 0) == chain->out_lbn) {
+      bias_lbn = conf.input("y", 0);
+    } else if (conf.input("y", 0) == chain->out_lbn) {
+      bias_lbn = conf.input("x", 0);
+    } else {
+      return;
+    }
+  } else {
+    return;
+  }
+  if (bias_lbn == chain->out_lbn || !IsChannelBias(op_graph, *chain, bias_lbn)) { return; }
+  chain->bias_lbn = bias_lbn;
+  Absorb(next, chain);
+}
+
+void TryAbsorbRelu(QuantizableChain* chain) {
+  const OpNode* next = SoleConsumer(*chain);
+  if (next == nullptr || !IsUserOpWithTypeName(next->op().op_conf(), "relu")) { return; }
+  chain->relu = true;
+  Absorb(next, chain);
+}
+
+// Both modes find the same chains in the same order, so the ranges observed in calibration are
+// found by name
+std::vector<QuantizableChain> FindQuantizableChains(const OpGraph& op_graph) {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* node) {
+    for (const std::string& name : node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(name);
+    }
+  });
+  const auto HasCtrlEdges = [&](const OpNode* node) {
+    return !node->op().op_conf().ctrl_in_op_name().empty()
+           || IsKeyFound(ctrl_in_op_names, node->op().op_name());
+  };
+  std::vector<QuantizableChain> chains;
+  op_graph.TopoForEachNode([&](const OpNode* node) {
+    QuantizableChain chain;
+    if (!MatchHead(op_graph, node, &chain)) { return; }
+    TryAbsorbBiasAdd(op_graph, &chain);
+    TryAbsorbRelu(&chain);
+    if (std::any_of(chain.nodes.cbegin(), chain.nodes.cend(), HasCtrlEdges)) { return; }
+    chains.emplace_back(std::move(chain));
+  });
+  return chains;
+}
+
+OperatorConf ZeroVariableOpConf(const std::string& name, DataType data_type,
+                                int64_t scope_symbol_id) {
+  OperatorConf variable_op_conf;
+  variable_op_conf.set_name(name);
+  variable_op_conf.set_scope_symbol_id(scope_symbol_id);
+  VariableOpConf* variable_conf = variable_op_conf.mutable_variable_conf();
+  variable_conf->set_out("out");
+  variable_conf->mutable_shape()->add_dim(1);
+  variable_conf->set_data_type(data_type);
+  variable_conf->mutable_initializer()->mutable_constant_conf()->set_value(0);
+  return variable_op_conf;
+}
+
+// The range of an activation is named after the first chain reading it rather than after the
+// activation, as the names of the input ops differ between graphs
+HashMap<std::string, std::string> RangeNamePrefix4ActivationLbn(
+    const std::vector<QuantizableChain>& chains) {
+  HashMap<std::string, std::string> prefix4lbn;
+  for (const auto& chain : chains) {
+    prefix4lbn.emplace(chain.activation_lbn, chain.head->op().op_name());
+  }
+  return prefix4lbn;
+}
+
+std::string VariableLbn(const OperatorConf& variable_op_conf) {
+  return GenLogicalBlobName(variable_op_conf.name(), variable_op_conf.variable_conf().out());
+}
+
+class PostTrainingQuantization final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PostTrainingQuantization);
+  PostTrainingQuantization() = default;
+  ~PostTrainingQuantization() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_post_training_quantization();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override;
+
+ private:
+  Maybe<void> InsertObservers(const PtqConfig& ptq_config,
+                              const std::vector<QuantizableChain>& chains,
+                              JobBuilder* job_builder) const;
+  Maybe<void> RewriteIntoInt8Ops(const std::vector<QuantizableChain>& chains,
+                                 JobBuilder* job_builder) const;
+};
+
+Maybe<void> PostTrainingQuantization::Apply(Job* job, JobPassCtx* ctx) const {
+  if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+  CHECK_OR_RETURN(!ctx->job_desc().IsTrain())
+      << "Post training quantization only applies to inference graphs";
+  const OpGraph op_graph(*job);
+  const std::vector<QuantizableChain> chains = FindQuantizableChains(op_graph);
+  if (chains.empty()) { return Maybe<void>::Ok(); }
+  JobBuilder job_builder(job);
+  const PtqConfig& ptq_config = ctx->job_desc().job_conf().ptq_config();
+  if (ptq_config.calibration()) {
+    return InsertObservers(ptq_config, chains, &job_builder);
+  } else {
+    return RewriteIntoInt8Ops(chains, &job_builder);
+  }
+}
+
+Maybe<void> PostTrainingQuantization::InsertObservers(const PtqConfig& ptq_config,
+                                                      const std::vector<QuantizableChain>& chains,
+                                                      JobBuilder* job_builder) const {
+  const auto prefix4lbn = RangeNamePrefix4ActivationLbn(chains);
+  for (const auto& chain : chains) {
+    const std::string& lbn = chain.activation_lbn;
+    const std::string& prefix = prefix4lbn.at(lbn);
+    if (prefix != chain.head->op().op_name()) { continue; }
+    const int64_t scope_symbol_id = chain.head->op().op_conf().scope_symbol_id();
+    const OperatorConf train_step_var =
+        ZeroVariableOpConf(prefix + TRAIN_STEP_SUFFIX, DataType::kInt64, scope_symbol_id);
+    const OperatorConf moving_max_var =
+        ZeroVariableOpConf(prefix + MOVING_MAX_SUFFIX, DataType::kFloat, scope_symbol_id);
+    const OperatorConf moving_min_var =
+        ZeroVariableOpConf(prefix + MOVING_MIN_SUFFIX, DataType::kFloat, scope_symbol_id);
+    // The train step stays zero, so the moving max keeps updating as long as calibration runs
+    const auto observer_op =
+        user_op::UserOpConfWrapperBuilder(prefix + OBSERVER_SUFFIX)
+            .Op("moving_average_min_max_observer")
+            .Input("in", lbn)
+            .Input("current_train_step", VariableLbn(train_step_var))
+            .Input("moving_max", VariableLbn(moving_max_var))
+            .Input("moving_min", VariableLbn(moving_min_var))
+            .Output("scale")
+            .Output("zero_point")
+            .Attr("training", true)
+            .Attr<int64_t>("stop_update_after_iters", 0)
+            .Attr<std::string>("quantization_formula", "google")
+            .Attr<std::string>("quantization_scheme", "symmetric")
+            .Attr<int32_t>("quantization_bit", 8)
+            .Attr("momentum", ptq_config.moving_max_momentum())
+            .ScopeSymbolId(scope_symbol_id)
+            .Build();
+    job_builder->AddOps(chain.head->parallel_desc().parallel_conf(),
+                        {train_step_var, moving_max_var, moving_min_var, observer_op.op_conf()});
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> PostTrainingQuantization::RewriteIntoInt8Ops(
+    const std::vector<QuantizableChain>& chains, JobBuilder* job_builder) const {
+  HashMap<const OpNode*, const QuantizableChain*> chain4head;
+  HashMap<std::string, std::string> new_lbn4old_lbn;
+  for (const auto& chain : chains) {
+    chain4head.emplace(chain.head, &chain);
+    new_lbn4old_lbn.emplace(chain.out_lbn,
+                            GenLogicalBlobName(chain.head->op().op_name() + QUANTIZED_SUFFIX,
+                                               "out_0"));
+  }
+  // The chains fed only by other chains output int8, requantized with the scale of their users
+  const auto IsFeedingOnlyChains = [&](const QuantizableChain& chain) {
+    for (const OpEdge* edge : chain.tail->out_edges()) {
+      const auto it = chain4head.find(edge->dst_node());
+      if (it == chain4head.end() || it->second->activation_lbn != chain.out_lbn) { return false; }
+    }
+    return !chain.tail->out_edges().empty();
+  };
+
+  const auto prefix4lbn = RangeNamePrefix4ActivationLbn(chains);
+  HashMap<std::string, std::string> scale_lbn4activation_lbn;
+  const auto GetScaleLbn = [&](const QuantizableChain& chain, const std::string& activation_lbn) {
+    const auto it = scale_lbn4activation_lbn.find(activation_lbn);
+    if (it != scale_lbn4activation_lbn.end()) { return it->second; }
+    const std::string& prefix = prefix4lbn.at(activation_lbn);
+    const int64_t scope_symbol_id = chain.head->op().op_conf().scope_symbol_id();
+    const OperatorConf moving_max_var =
+        ZeroVariableOpConf(prefix + MOVING_MAX_SUFFIX, DataType::kFloat, scope_symbol_id);
+    const auto scale_op = user_op::UserOpConfWrapperBuilder(prefix + SCALE_SUFFIX)
+                              .Op("scalar_mul")
+                              .Input("in", VariableLbn(moving_max_var))
+                              .Output("out")
+                              .Attr("has_float_operand", true)
+                              .Attr("float_operand", 1.0 / kInt8MaxValue)
+                              .ScopeSymbolId(scope_symbol_id)
+                              .Build();
+    job_builder->AddOps(chain.head->parallel_desc().parallel_conf(),
+                        {moving_max_var, scale_op.op_conf()});
+    const std::string scale_lbn = scale_op.output("out", 0);
+    scale_lbn4activation_lbn.emplace(activation_lbn, scale_lbn);
+    return scale_lbn;
+  };
+
+  OpConfCache op_conf_cache;
+  std::vector<std::string> del_op_names;
+  for (const auto& chain : chains) {
+    const auto new_input_it = new_lbn4old_lbn.find(chain.activation_lbn);
+    const std::string& input_lbn =
+        new_input_it == new_lbn4old_lbn.end() ? chain.activation_lbn : new_input_it->second;
+    const user_op::UserOpConfWrapper head_conf(chain.head->op().op_conf());
+    user_op::UserOpConfWrapperBuilder builder(chain.head->op().op_name() + QUANTIZED_SUFFIX);
+    if (chain.is_conv) {
+      builder.Op("quantized_conv2d")
+          .Input("in", input_lbn)
+          .Input("weight", chain.weight_lbn)
+          .Input("in_scale", GetScaleLbn(chain, chain.activation_lbn))
+          .Attr("padding_before", head_conf.attr<std::vector<int32_t>>("padding_before"))
+          .Attr("strides", head_conf.attr<std::vector<int32_t>>("strides"))
+          .Attr("dilation_rate", head_conf.attr<std::vector<int32_t>>("dilation_rate"));
+    } else {
+      builder.Op("quantized_matmul")
+          .Input("a", input_lbn)
+          .Input("b", chain.weight_lbn)
+          .Input("a_scale", GetScaleLbn(chain, chain.activation_lbn));
+    }
+    if (!chain.bias_lbn.empty()) { builder.Input("bias", chain.bias_lbn); }
+    const bool requantize = IsFeedingOnlyChains(chain);
+    if (requantize) { builder.Input("out_scale", GetScaleLbn(chain, chain.out_lbn)); }
+    const auto new_op = builder.Output("out")
+                            .Attr<std::string>("activation", chain.relu ? "relu" : "none")
+                            .ScopeSymbolId(chain.head->op().op_conf().scope_symbol_id())
+                            .Build();
+    job_builder->AddOps(chain.head->parallel_desc().parallel_conf(), {new_op.op_conf()});
+    for (const OpNode* node : chain.nodes) { del_op_names.emplace_back(node->op().op_name()); }
+    if (requantize) { continue; }
+    // The other users of the chain read the float output of the new op
+    for (const OpEdge* edge : chain.tail->out_edges()) {
+      if (IsKeyFound(chain4head, edge->dst_node())) { continue; }
+      OperatorConf dst_op_conf = op_conf_cache.GetLatest(edge->dst_node()->op().op_conf());
+      for (const LogicalBlobId& lbi : edge->lbis()) {
+        for (const std::string& ibn : edge->lbi2ibns().at(lbi)) {
+          ReplaceInputLbnInOpCustomizedConf(&dst_op_conf, ibn, new_op.output("out", 0));
+        }
+      }
+      op_conf_cache.Put(dst_op_conf);
+    }
+  }
+  job_builder->MutOpsOnlyOnce(op_conf_cache.op_confs());
+  job_builder->DelOps(del_op_names);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("PostTrainingQuantization", PostTrainingQuantization);
+
+}  // namespace oneflow
@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/core/kernel/cost_calibration_kernel_observer.h"
+#include "oneflow/core/auto_parallel/cost_database.h"
+#include "oneflow/core/kernel/kernel.h"
+#include "oneflow/core/framework/to_string.h"
+
+namespace oneflow {
+
+namespace {
+
+// Kernels of an actor thread run one after another, so a thread local start point is enough.
+thread_local std::chrono::steady_clock::time_point kernel_start_time;
+
+}  // namespace
+
+void CostCalibrationKernelObserver::WillForwardDataContent(KernelContext* kernel_ctx,
+                                                           const Kernel* kernel) {
+  // Do not count the work queued by the previous kernels
+  CHECK_JUST_MSG(kernel_ctx->stream()->Sync(), kernel->op_conf().name());
+  kernel_start_time = std::chrono::steady_clock::now();
+}
+
+void CostCalibrationKernelObserver::DidForwardDataContent(KernelContext* kernel_ctx,
+                                                          const Kernel* kernel) {
+  CHECK_JUST_MSG(kernel_ctx->stream()->Sync(), kernel->op_conf().name());
+  const double time_us = std::chrono::duration<double, std::micro>(
+                             std::chrono::steady_clock::now() - kernel_start_time)
+                             .count();
+  if (auto_parallel::IsTransferKernel(kernel)) {
+    int64_t bytes = 0;
+    for (const auto& obn : kernel->op_attribute().output_bns()) {
+      const Blob* blob = kernel_ctx->BnInOp2Blob(obn);
+      if (blob != nullptr) { bytes += blob->ByteSizeOfBlobBody(); }
+    }
+    const DeviceType device_type =
+        CHECK_JUST(DeviceType4DeviceTag(kernel->op_conf().device_tag()));
+    cost_database_->AddTransfer(device_type, bytes, time_us);
+  } else {
+    cost_database_->AddComputeTime(auto_parallel::ComputeCostKey4Kernel(kernel_ctx, kernel),
+                                   time_us);
+  }
+}
+
+}  // namespace oneflow
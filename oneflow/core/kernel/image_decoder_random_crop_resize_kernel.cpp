@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "oneflow/core/common/error.h"
+#include "oneflow/core/common/bfloat16.h"
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/common/channel.h"
@@ -22,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/user/image/random_crop_generator.h"
 #include "oneflow/user/image/jpeg_decoder.h"
+#include "oneflow/user/image/image_util.h"
 #include <opencv2/opencv.hpp>
 
 #ifdef WITH_CUDA
@@ -50,8 +52,20 @@ struct Task {
   size_t length;
   unsigned char* dst;
   RandomCropGenerator* crop_generator;
+  bool mirror;
 };
 
+ImageOutputParam GetOutputParam(const ImageDecoderRandomCropResizeOpConf& conf) {
+  ImageOutputParam param;
+  param.data_type = conf.output_data_type();
+  param.channels_first = conf.output_layout() == "NCHW";
+  for (int c = 0; c < kNumChannels; ++c) {
+    if (conf.mean_size() > 0) { param.mean[c] = conf.mean(conf.mean_size() == 1 ? 0 : c); }
+    if (conf.std_size() > 0) { param.inv_std[c] = 1.0f / conf.std(conf.std_size() == 1 ? 0 : c); }
+  }
+  return param;
+}
+
 struct Work {
   std::shared_ptr<std::vector<Task>> tasks;
   unsigned char* workspace = nullptr;
@@ -122,85 +136,111 @@ class DecodeHandle {
   virtual void DecodeRandomCropResize(const unsigned char* data, size_t length,
                                       RandomCropGenerator* crop_generator, unsigned char* workspace,
                                       size_t workspace_size, unsigned char* dst, int target_width,
-                                      int target_height) = 0;
+                                      int target_height, bool mirror) = 0;
   virtual void WarmupOnce(int warmup_size, unsigned char* workspace, size_t workspace_size) = 0;
   virtual void Synchronize() = 0;
 };
 
 using DecodeHandleFactory = std::function<std::shared_ptr<DecodeHandle>()>;
 template<DeviceType device_type>
-DecodeHandleFactory CreateDecodeHandleFactory(int target_width, int target_height);
+DecodeHandleFactory CreateDecodeHandleFactory(int target_width, int target_height,
+                                              const ImageOutputParam& output_param);
 
 class CpuDecodeHandle final : public DecodeHandle {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CpuDecodeHandle);
-  CpuDecodeHandle() = default;
+  CpuDecodeHandle() : CpuDecodeHandle(ImageOutputParam()) {}
+  explicit CpuDecodeHandle(const ImageOutputParam& output_param)
+      : output_param_(output_param),
+        enable_dct_scaling_(ParseBooleanFromEnv("ONEFLOW_DECODER_ENABLE_DCT_SCALING", true)) {}
   ~CpuDecodeHandle() override = default;
 
   void DecodeRandomCropResize(const unsigned char* data, size_t length,
                               RandomCropGenerator* crop_generator, unsigned char* workspace,
                               size_t workspace_size, unsigned char* dst, int target_width,
-                              int target_height) override;
+                              int target_height, bool mirror) override;
   void WarmupOnce(int warmup_size, unsigned char* workspace, size_t workspace_size) override {
     // do nothing
   }
   void Synchronize() override {
     // do nothing
   }
+
+ private:
+  ImageOutputParam output_param_;
+  bool enable_dct_scaling_;
+  std::vector<unsigned char> resized_buffer_;
 };
 
-bool CpuJpegDecodeRandomCropResize(const unsigned char* data, size_t length,
-                                   RandomCropGenerator* crop_generator, unsigned char* workspace,
-                                   size_t workspace_size, unsigned char* dst, int target_width,
-                                   int target_height) {
-  cv::Mat image_mat;
-  if (JpegPartialDecodeRandomCropImage(data, length, crop_generator, workspace, workspace_size,
-                                       &image_mat)) {
+// Decode the crop into a RGB image, or a BGR image on the OpenCV fallback path.
+// Neither path copies the crop out of the decoded image.
+bool DecodeRandomCrop(const unsigned char* data, size_t length,
+                      RandomCropGenerator* crop_generator, unsigned char* workspace,
+                      size_t workspace_size, int min_width, int min_height, cv::Mat* image,
+                      cv::Mat* cropped) {
+  if (JpegPartialDecodeRandomCropScaledImage(data, length, crop_generator, min_width, min_height,
+                                             workspace, workspace_size, cropped)) {
     return false;
   }
-
-  cv::Mat dst_mat(target_height, target_width, CV_8UC3, dst, cv::Mat::AUTO_STEP);
-  cv::resize(image_mat, dst_mat, cv::Size(target_width, target_height), 0, 0, cv::INTER_LINEAR);
-  return true;
-}
-
-void OpencvDecodeRandomCropResize(const unsigned char* data, size_t length,
-                                  RandomCropGenerator* crop_generator, unsigned char* dst,
-                                  int target_width, int target_height) {
-  cv::Mat image =
+  *image =
       cv::imdecode(cv::Mat(1, length, CV_8UC1, const_cast<unsigned char*>(data)), cv::IMREAD_COLOR);
-  cv::Mat cropped;
+  CHECK(image->data != nullptr) << "Failed to decode image";
   if (crop_generator) {
     cv::Rect roi;
-    GenerateRandomCropRoi(crop_generator, image.cols, image.rows, &roi.x, &roi.y, &roi.width,
+    GenerateRandomCropRoi(crop_generator, image->cols, image->rows, &roi.x, &roi.y, &roi.width,
                           &roi.height);
-    image(roi).copyTo(cropped);
+    *cropped = (*image)(roi);
   } else {
-    cropped = image;
+    *cropped = *image;
   }
-  cv::Mat resized;
-  cv::resize(cropped, resized, cv::Size(target_width, target_height), 0, 0, cv::INTER_LINEAR);
-  cv::Mat dst_mat(target_height, target_width, CV_8UC3, dst, cv::Mat::AUTO_STEP);
-  cv::cvtColor(resized, dst_mat, cv::COLOR_BGR2RGB);
+  return true;
 }
 
 void CpuDecodeHandle::DecodeRandomCropResize(const unsigned char* data, size_t length,
                                              RandomCropGenerator* crop_generator,
                                              unsigned char* workspace, size_t workspace_size,
                                              unsigned char* dst, int target_width,
-                                             int target_height) {
-  if (CpuJpegDecodeRandomCropResize(data, length, crop_generator, workspace, workspace_size, dst,
-                                    target_width, target_height)) {
+                                             int target_height, bool mirror) {
+  cv::Mat image;
+  cv::Mat cropped;
+  const bool bgr = DecodeRandomCrop(data, length, crop_generator, workspace, workspace_size,
+                                    enable_dct_scaling_ ? target_width : 0,
+                                    enable_dct_scaling_ ? target_height : 0, &image, &cropped);
+  const cv::Size target_size(target_width, target_height);
+  if (output_param_.data_type == DataType::kUInt8 && !output_param_.channels_first && !bgr) {
+    cv::Mat dst_mat(target_height, target_width, CV_8UC3, dst, cv::Mat::AUTO_STEP);
+    cv::resize(cropped, dst_mat, target_size, 0, 0, cv::INTER_LINEAR);
+    if (mirror) { cv::flip(dst_mat, dst_mat, 1); }
     return;
   }
-
-  OpencvDecodeRandomCropResize(data, length, crop_generator, dst, target_width, target_height);
+  resized_buffer_.resize(target_width * target_height * kNumChannels);
+  cv::Mat resized(target_height, target_width, CV_8UC3, resized_buffer_.data(),
+                  cv::Mat::AUTO_STEP);
+  cv::resize(cropped, resized, target_size, 0, 0, cv::INTER_LINEAR);
+  if (output_param_.data_type == DataType::kUInt8 && !output_param_.channels_first) {
+    cv::Mat dst_mat(target_height, target_width, CV_8UC3, dst, cv::Mat::AUTO_STEP);
+    cv::cvtColor(resized, dst_mat, cv::COLOR_BGR2RGB);
+    if (mirror) { cv::flip(dst_mat, dst_mat, 1); }
+  } else if (output_param_.data_type == DataType::kUInt8) {
+    NormalizeImage<unsigned char>(resized.data, target_height, target_width, bgr, mirror,
+                                  output_param_, dst);
+  } else if (output_param_.data_type == DataType::kFloat) {
+    NormalizeImage<float>(resized.data, target_height, target_width, bgr, mirror, output_param_,
+                          reinterpret_cast<float*>(dst));
+  } else if (output_param_.data_type == DataType::kBFloat16) {
+    NormalizeImage<bfloat16>(resized.data, target_height, target_width, bgr, mirror,
+                             output_param_, reinterpret_cast<bfloat16*>(dst));
+  } else {
+    UNIMPLEMENTED();
+  }
 }
 
 template<>
-DecodeHandleFactory CreateDecodeHandleFactory<DeviceType::kCPU>(int target_width,
-                                                                int target_height) {
-  return []() -> std::shared_ptr<DecodeHandle> { return std::make_shared<CpuDecodeHandle>(); };
+DecodeHandleFactory CreateDecodeHandleFactory<DeviceType::kCPU>(
+    int target_width, int target_height, const ImageOutputParam& output_param) {
+  return [output_param]() -> std::shared_ptr<DecodeHandle> {
+    return std::make_shared<CpuDecodeHandle>(output_param);
+  };
 }
 
 #if defined(WITH_NVJPEG)
@@ -243,7 +283,7 @@ class GpuDecodeHandle final : public DecodeHandle {
   void DecodeRandomCropResize(const unsigned char* data, size_t length,
                               RandomCropGenerator* crop_generator, unsigned char* workspace,
                               size_t workspace_size, unsigned char* dst, int target_width,
-                              int target_height) override;
+                              int target_height, bool mirror) override;
   void WarmupOnce(int warmup_size, unsigned char* workspace, size_t workspace_size) override;
   void Synchronize() override;
 
@@ -413,7 +453,8 @@ void GpuDecodeHandle::DecodeRandomCropResize(const unsigned char* data, size_t l
                                              RandomCropGenerator* crop_generator,
                                              unsigned char* workspace, size_t workspace_size,
                                              unsigned char* dst, int target_width,
-                                             int target_height) {
+                                             int target_height, bool mirror) {
+  CHECK(!mirror) << "The gpu decoder does not support mirror";
   int width[NVJPEG_MAX_COMPONENT];
   int height[NVJPEG_MAX_COMPONENT];
   nvjpegChromaSubsampling_t subsampling{};
@@ -423,7 +464,8 @@ void GpuDecodeHandle::DecodeRandomCropResize(const unsigned char* data, size_t l
   if (status != NVJPEG_STATUS_SUCCESS) {
     CHECK_LE(target_width * target_height * kNumChannels, fallback_buffer_size_);
     fallback_handle_.DecodeRandomCropResize(data, length, crop_generator, nullptr, 0,
-                                            fallback_buffer_, target_width, target_height);
+                                            fallback_buffer_, target_width, target_height,
+                                            /*mirror=*/false);
     OF_CUDA_CHECK(cudaMemcpyAsync(dst, fallback_buffer_,
                                   target_width * target_height * kNumChannels, cudaMemcpyDefault,
                                   cuda_stream_));
@@ -468,8 +510,9 @@ void GpuDecodeHandle::WarmupOnce(int warmup_size, unsigned char* workspace, size
 void GpuDecodeHandle::Synchronize() { OF_CUDA_CHECK(cudaStreamSynchronize(cuda_stream_)); }
 
 template<>
-DecodeHandleFactory CreateDecodeHandleFactory<DeviceType::kCUDA>(int target_width,
-                                                                 int target_height) {
+DecodeHandleFactory CreateDecodeHandleFactory<DeviceType::kCUDA>(
+    int target_width, int target_height, const ImageOutputParam& output_param) {
+  CHECK(output_param.data_type == DataType::kUInt8 && !output_param.channels_first);
   int dev = 0;
   OF_CUDA_CHECK(cudaGetDevice(&dev));
   return [dev, target_width, target_height]() -> std::shared_ptr<DecodeHandle> {
@@ -514,7 +557,8 @@ class Worker final {
         if (task_id >= work->tasks->size()) { break; }
         const Task& task = work->tasks->at(task_id);
         handle->DecodeRandomCropResize(task.data, task.length, task.crop_generator, work->workspace,
-                                       work->workspace_size, task.dst, target_width, target_height);
+                                       work->workspace_size, task.dst, target_width, target_height,
+                                       task.mirror);
         handle->Synchronize();
       }
       work->done_counter->Decrease();
@@ -536,6 +580,7 @@ class ImageDecoderRandomCropResizeKernel final : public Kernel {
   void ForwardDataContent(KernelContext* ctx) const override;
 
   std::vector<std::unique_ptr<RandomCropGenerator>> random_crop_generators_;
+  std::unique_ptr<std::mt19937> mirror_generator_;
   std::vector<std::unique_ptr<Worker>> workers_;
 };
 
@@ -549,6 +594,10 @@ void ImageDecoderRandomCropResizeKernel<device_type>::VirtualKernelInit(KernelCo
   std::seed_seq seq{this->kernel_conf().image_decoder_random_crop_resize_conf().seed()};
   std::vector<int> seeds(batch_size);
   seq.generate(seeds.begin(), seeds.end());
+  // A separate sequence keeps the crop windows the same as without mirror
+  std::seed_seq mirror_seq{this->kernel_conf().image_decoder_random_crop_resize_conf().seed(),
+                           int64_t{1}};
+  mirror_generator_.reset(new std::mt19937(mirror_seq));
   AspectRatioRange aspect_ratio_range{
       conf.random_aspect_ratio_min(),
       conf.random_aspect_ratio_max(),
@@ -564,7 +613,8 @@ void ImageDecoderRandomCropResizeKernel<device_type>::VirtualKernelInit(KernelCo
   workers_.resize(conf.num_workers());
   for (int64_t i = 0; i < conf.num_workers(); ++i) {
     workers_.at(i).reset(new Worker(
-        CreateDecodeHandleFactory<device_type>(conf.target_width(), conf.target_height()),
+        CreateDecodeHandleFactory<device_type>(conf.target_width(), conf.target_height(),
+                                               GetOutputParam(conf)),
         conf.target_width(), conf.target_height(), conf.warmup_size()));
   }
 }
@@ -577,21 +627,25 @@ void ImageDecoderRandomCropResizeKernel<device_type>::ForwardDataContent(KernelC
   Blob* out = ctx->BnInOp2Blob("out");
   Blob* tmp = ctx->BnInOp2Blob("tmp");
   CHECK_EQ(in->data_type(), DataType::kTensorBuffer);
-  CHECK_EQ(out->data_type(), DataType::kUInt8);
+  CHECK_EQ(out->data_type(), conf.output_data_type());
   const ShapeView& in_shape = in->shape();
   const int64_t num_in_axes = in_shape.NumAxes();
   const ShapeView& out_shape = out->shape();
   const int64_t num_out_axes = out_shape.NumAxes();
   CHECK_EQ(num_out_axes, num_in_axes + 3);
   for (int i = 0; i < num_in_axes; ++i) { CHECK_EQ(out_shape.At(i), in_shape.At(i)); }
-  CHECK_EQ(out_shape.At(num_in_axes), conf.target_height());
-  CHECK_EQ(out_shape.At(num_in_axes + 1), conf.target_width());
-  CHECK_EQ(out_shape.At(num_in_axes + 2), kNumChannels);
+  const int64_t channel_axis = conf.output_layout() == "NCHW" ? num_in_axes : num_in_axes + 2;
+  const int64_t height_axis = conf.output_layout() == "NCHW" ? num_in_axes + 1 : num_in_axes;
+  CHECK_EQ(out_shape.At(height_axis), conf.target_height());
+  CHECK_EQ(out_shape.At(height_axis + 1), conf.target_width());
+  CHECK_EQ(out_shape.At(channel_axis), kNumChannels);
   CHECK_EQ(tmp->data_type(), DataType::kUInt8);
   const int64_t batch_size = in_shape.elem_cnt();
   const auto* buffers = in->dptr<TensorBuffer>();
   auto* out_ptr = out->mut_dptr<unsigned char>();
-  const int64_t out_instance_size = conf.target_height() * conf.target_width() * kNumChannels;
+  const int64_t out_instance_size = conf.target_height() * conf.target_width() * kNumChannels
+                                    * GetSizeOfDataType(conf.output_data_type());
+  std::bernoulli_distribution mirror_distribution(conf.mirror_probability());
   auto* workspace_ptr = tmp->mut_dptr<unsigned char>();
   size_t workspace_size_per_worker = tmp->shape().elem_cnt() / workers_.size();
   std::shared_ptr<BlockingCounter> done_counter(new BlockingCounter(workers_.size()));
@@ -604,6 +658,7 @@ void ImageDecoderRandomCropResizeKernel<device_type>::ForwardDataContent(KernelC
     tasks->at(task_id).length = buffer->elem_cnt();
     tasks->at(task_id).dst = out_ptr + task_id * out_instance_size;
     tasks->at(task_id).crop_generator = random_crop_generators_.at(task_id).get();
+    tasks->at(task_id).mirror = mirror_distribution(*mirror_generator_);
   }
   // Larger images will be processed first, balancing the work time of the workers.
   std::sort(tasks->begin(), tasks->end(),
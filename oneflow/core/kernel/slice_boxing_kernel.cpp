@@ -17,8 +17,7 @@ limitations under the License.
 #include "oneflow/core/register/tensor_slice_copier.h"
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/ep/include/primitive/add.h"
-#include "oneflow/core/ep/include/primitive/copy_nd.h"
-#include "oneflow/core/ep/include/primitive/memset.h"
+#include "oneflow/core/ep/include/primitive/add_nd.h"
 
 namespace oneflow {
 
@@ -30,12 +29,11 @@ class SliceBoxingKernel : public Kernel {
 
  protected:
   virtual const SliceBoxingConf& GetCustomizedBoxingConf() const = 0;
+  void VirtualKernelInit(KernelContext* ctx) override;
 
   const std::vector<std::shared_ptr<TensorSliceCopier>>& tensor_slice_copier_vec() const;
 
  private:
-  void VirtualKernelInit(KernelContext* ctx) override;
-
   std::vector<std::shared_ptr<TensorSliceCopier>> tensor_slice_copier_vec_;
 };
 
@@ -58,7 +56,16 @@ class SliceBoxingAddKernel final : public SliceBoxingKernel {
 
  private:
   virtual const SliceBoxingConf& GetCustomizedBoxingConf() const override;
+  void VirtualKernelInit(KernelContext* ctx) override;
   void ForwardDataContent(KernelContext* ctx) const override;
+
+  // Where each input is added into out, in the coordinates of the slices
+  DimVector out_dims_;
+  std::vector<DimVector> in_dims_;
+  std::vector<DimVector> in_pos_;
+  std::vector<DimVector> out_pos_;
+  std::vector<DimVector> extent_;
+  std::unique_ptr<ep::primitive::AddNd> add_nd_primitive_;
 };
 
 void SliceBoxingKernel::VirtualKernelInit(KernelContext* ctx) {
@@ -97,38 +104,66 @@ const SliceBoxingConf& SliceBoxingAddKernel::GetCustomizedBoxingConf() const {
   return this->op_conf().slice_boxing_add_conf().slice_boxing_conf();
 }
 
+void SliceBoxingAddKernel::VirtualKernelInit(KernelContext* ctx) {
+  SliceBoxingKernel::VirtualKernelInit(ctx);
+  const SliceBoxingConf& conf = GetCustomizedBoxingConf();
+  const TensorSliceView out_slice(conf.out_slice());
+  const int64_t num_axes = out_slice.shape().NumAxes();
+  if (num_axes == 0) { return; }
+  out_dims_ = out_slice.shape().dim_vec();
+  for (const TensorSliceViewProto& in_slice_proto : conf.in_slice()) {
+    const TensorSliceView in_slice(in_slice_proto);
+    const TensorSliceView intersection = out_slice.Intersect(in_slice);
+    in_dims_.emplace_back(in_slice.shape().dim_vec());
+    if (intersection.IsEmpty()) {
+      in_pos_.emplace_back(DimVector(num_axes, 0));
+      out_pos_.emplace_back(DimVector(num_axes, 0));
+      extent_.emplace_back(DimVector(num_axes, 0));
+    } else {
+      in_pos_.emplace_back(intersection.OffsetTo(in_slice).dim_vec());
+      out_pos_.emplace_back(intersection.OffsetTo(out_slice).dim_vec());
+      extent_.emplace_back(intersection.shape().dim_vec());
+    }
+  }
+  add_nd_primitive_ = ep::primitive::NewPrimitive<ep::primitive::AddNdFactory>(
+      ctx->stream()->device_type(), this->kernel_conf().data_type(), num_axes);
+  CHECK(add_nd_primitive_);
+}
+
 void SliceBoxingAddKernel::ForwardDataContent(KernelContext* ctx) const {
   Blob* out = ctx->BnInOp2Blob("out");
   if (out->shape_view().elem_cnt() == 0) { return; }
-  std::unique_ptr<ep::primitive::Add> primitive =
-      ep::primitive::NewPrimitive<ep::primitive::AddFactory>(ctx->stream()->device_type(),
-                                                             out->data_type());
-  CHECK(primitive);
-  std::unique_ptr<ep::primitive::Memset> memset_primitive =
-      ep::primitive::NewPrimitive<ep::primitive::MemsetFactory>(ctx->stream()->device_type());
-  CHECK(memset_primitive);
-  FOR_RANGE(int64_t, i, 0, this->op_attribute().input_bns().size()) {
+  const int64_t num_inputs = this->op_attribute().input_bns().size();
+  std::vector<const void*> srcs(num_inputs);
+  FOR_RANGE(int64_t, i, 0, num_inputs) {
     const Blob* in_i = ctx->BnInOp2Blob(GenRepeatedBn("in", i));
-    if (i == 0) {
-      if (in_i->shape().NumAxes() == 0 && out->shape().NumAxes() == 0) {
-        AutoMemcpy(ctx->stream(), out, in_i);
-      } else {
-        this->tensor_slice_copier_vec().at(i)->Copy(ctx->stream(), out, in_i);
-      }
-    } else {
-      if (in_i->shape() == out->shape()) {
-        primitive->Launch(ctx->stream(), out->dptr(), in_i->dptr(), out->mut_dptr(),
-                          out->shape().elem_cnt());
-      } else {
-        Blob* buf = ctx->BnInOp2Blob("buf");
-        memset_primitive->Launch(ctx->stream(), buf->mut_dptr(), 0,
-                                 buf->shape().elem_cnt() * GetSizeOfDataType(buf->data_type()));
-        this->tensor_slice_copier_vec().at(i)->Copy(ctx->stream(), buf, in_i);
-        primitive->Launch(ctx->stream(), out->dptr(), buf->dptr(), out->mut_dptr(),
-                          out->shape().elem_cnt());
-      }
-    }
+    CHECK_EQ(in_i->data_type(), out->data_type());
+    srcs.at(i) = in_i->dptr();
+  }
+  if (!add_nd_primitive_) {
+    // Scalars
+    std::unique_ptr<ep::primitive::Add> primitive =
+        ep::primitive::NewPrimitive<ep::primitive::AddFactory>(ctx->stream()->device_type(),
+                                                               out->data_type());
+    CHECK(primitive);
+    primitive->Launch(ctx->stream(), srcs.data(), srcs.size(), out->mut_dptr(),
+                      out->shape_view().elem_cnt());
+    return;
+  }
+  // All the inputs are summed into out in a single pass, each over its overlap with out
+  std::vector<const int64_t*> in_dims(num_inputs);
+  std::vector<const int64_t*> in_pos(num_inputs);
+  std::vector<const int64_t*> out_pos(num_inputs);
+  std::vector<const int64_t*> extent(num_inputs);
+  FOR_RANGE(int64_t, i, 0, num_inputs) {
+    in_dims.at(i) = in_dims_.at(i).data();
+    in_pos.at(i) = in_pos_.at(i).data();
+    out_pos.at(i) = out_pos_.at(i).data();
+    extent.at(i) = extent_.at(i).data();
   }
+  add_nd_primitive_->Launch(ctx->stream(), out_dims_.size(), out->mut_dptr(), out_dims_.data(),
+                            num_inputs, srcs.data(), in_dims.data(), in_pos.data(),
+                            out_pos.data(), extent.data());
 }
 
 REGISTER_KERNEL(OperatorConf::kSliceBoxingCopyConf, SliceBoxingCopyKernel);
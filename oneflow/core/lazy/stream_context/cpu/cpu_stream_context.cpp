@@ -23,13 +23,72 @@ limitations under the License.
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/cpu/cpu_device.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/thread/thread_runtime.h"
+#include <sstream>
 
 namespace oneflow {
 
+namespace {
+
+// Parses cpu sets like "0-3;4-7,12", sets are separated by ';' and consist of cpus and ranges of
+// cpus separated by ','.
+Maybe<std::vector<std::vector<int32_t>>> ParseCpuSets(const std::string& str) {
+  std::vector<std::vector<int32_t>> cpu_sets;
+  std::istringstream sets_stream(str);
+  std::string set_str;
+  while (std::getline(sets_stream, set_str, ';')) {
+    std::vector<int32_t> cpu_set;
+    std::istringstream set_stream(set_str);
+    std::string range_str;
+    while (std::getline(set_stream, range_str, ',')) {
+      int32_t first = 0;
+      int32_t last = 0;
+      char dash = 0;
+      std::istringstream range_stream(range_str);
+      range_stream >> first;
+      CHECK_OR_RETURN(!range_stream.fail()) << "Invalid cpu set: " << set_str;
+      last = first;
+      if (range_stream >> dash) {
+        CHECK_OR_RETURN(dash == '-' && (range_stream >> last)) << "Invalid cpu set: " << set_str;
+      }
+      CHECK_OR_RETURN((range_stream >> std::ws).eof() && 0 <= first && first <= last)
+          << "Invalid cpu set: " << set_str;
+      for (int32_t cpu_id = first; cpu_id <= last; ++cpu_id) { cpu_set.emplace_back(cpu_id); }
+    }
+    CHECK_OR_RETURN(!cpu_set.empty()) << "Empty cpu set in " << str;
+    cpu_sets.emplace_back(std::move(cpu_set));
+  }
+  return cpu_sets;
+}
+
+// By default the streams share the threading runtime of the device. With
+// ONEFLOW_LAZY_CPU_STREAM_CPU_SETS, e.g. "0-3;4-7", each stream runs the parallel parts of its
+// kernels on a pool of its own, bound to the cpu sets in turn by stream index, with as many
+// threads as the set has cpus. ONEFLOW_LAZY_CPU_STREAM_NUM_THREADS overrides the thread number,
+// and gives unbound pools of their own to the streams when it is set alone.
+ep::Stream* NewCpuStream(ep::Device* device, const StreamId& stream_id) {
+  const std::string cpu_sets_str = GetStringFromEnv("ONEFLOW_LAZY_CPU_STREAM_CPU_SETS", "");
+  const int64_t num_threads = ParseIntegerFromEnv("ONEFLOW_LAZY_CPU_STREAM_NUM_THREADS", 0);
+  if (cpu_sets_str.empty() && num_threads <= 0) { return device->CreateStream(); }
+  std::vector<int32_t> cpu_ids;
+  if (!cpu_sets_str.empty()) {
+    const auto cpu_sets = CHECK_JUST(ParseCpuSets(cpu_sets_str));
+    cpu_ids = cpu_sets.at(stream_id.stream_index() % cpu_sets.size());
+  }
+  const int32_t pool_num_threads =
+      static_cast<int32_t>(num_threads > 0 ? num_threads : cpu_ids.size());
+  // the actor thread of the stream is bound to the cpus as well and is one of the threads
+  auto thread_runtime = std::make_shared<thread::OfRuntime>(pool_num_threads, cpu_ids);
+  return new ep::CpuStream(static_cast<ep::CpuDevice*>(device), std::move(thread_runtime),
+                           pool_num_threads, std::move(cpu_ids));
+}
+
+}  // namespace
+
 class CpuStreamContext : public StreamContext, public KernelObserverProvider {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CpuStreamContext);
-  CpuStreamContext();
+  explicit CpuStreamContext(const StreamId& stream_id);
   ~CpuStreamContext() override;
 
   ep::Stream* stream() override;
@@ -43,9 +102,9 @@ class CpuStreamContext : public StreamContext, public KernelObserverProvider {
   std::unique_ptr<KernelObserver> kernel_observer_;
 };
 
-CpuStreamContext::CpuStreamContext() : stream_(nullptr) {
+CpuStreamContext::CpuStreamContext(const StreamId& stream_id) : stream_(nullptr) {
   device_ = Singleton<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
-  stream_ = device_->CreateStream();  // NOLINT
+  stream_ = NewCpuStream(device_.get(), stream_id);  // NOLINT
   std::vector<std::shared_ptr<KernelObserver>> kernel_observers;
   if (ParseBooleanFromEnv("ONEFLOW_DEBUG_KERNEL_SYNC_CHECK_NUMERICS", false)) {
     kernel_observers.emplace_back(new CpuCheckNumericsKernelObserver());
@@ -66,7 +125,7 @@ KernelObserver* CpuStreamContext::GetKernelObserver() { return kernel_observer_.
 
 REGISTER_STREAM_CONTEXT_CREATOR_WITH_STREAM_ID(DeviceType::kCPU,
                                                ([](const StreamId& stream_id) -> StreamContext* {
-                                                 return new CpuStreamContext();
+                                                 return new CpuStreamContext(stream_id);
                                                }));
 
 }  // namespace oneflow
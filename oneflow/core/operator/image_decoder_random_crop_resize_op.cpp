@@ -33,15 +33,50 @@ Maybe<void> InferBlobDescs(const OperatorConf& op_conf,
   BlobDesc* out = BlobDesc4BnInOp("out");
   CHECK_EQ_OR_RETURN(in->data_type(), DataType::kTensorBuffer);
   *out = *in;
-  out->set_data_type(DataType::kUInt8);
+  out->set_data_type(conf.output_data_type());
   DimVector out_dim_vec = in->shape().dim_vec();
-  out_dim_vec.emplace_back(conf.target_height());
-  out_dim_vec.emplace_back(conf.target_width());
-  out_dim_vec.emplace_back(3);
+  if (conf.output_layout() == "NCHW") {
+    out_dim_vec.emplace_back(3);
+    out_dim_vec.emplace_back(conf.target_height());
+    out_dim_vec.emplace_back(conf.target_width());
+  } else {
+    out_dim_vec.emplace_back(conf.target_height());
+    out_dim_vec.emplace_back(conf.target_width());
+    out_dim_vec.emplace_back(3);
+  }
   out->set_shape(Shape(out_dim_vec));
   return Maybe<void>::Ok();
 }
 
+bool IsUint8NHWCOutput(const ImageDecoderRandomCropResizeOpConf& conf) {
+  return conf.output_data_type() == DataType::kUInt8 && conf.output_layout() == "NHWC"
+         && conf.mirror_probability() == 0;
+}
+
+Maybe<void> CheckOutputConf(const ImageDecoderRandomCropResizeOpConf& conf,
+                            DeviceType device_type) {
+  CHECK_OR_RETURN(conf.output_layout() == "NHWC" || conf.output_layout() == "NCHW")
+      << "output_layout should be NHWC or NCHW, but got " << conf.output_layout();
+  CHECK_OR_RETURN(conf.mirror_probability() >= 0 && conf.mirror_probability() <= 1)
+      << "mirror_probability should be in [0, 1]";
+  if (conf.output_data_type() == DataType::kUInt8) {
+    CHECK_OR_RETURN(conf.mean_size() == 0 && conf.std_size() == 0)
+        << "mean and std are only supported by the float outputs";
+  } else {
+    CHECK_OR_RETURN(conf.output_data_type() == DataType::kFloat
+                    || conf.output_data_type() == DataType::kBFloat16)
+        << "output_data_type should be uint8, float or bfloat16, but got "
+        << DataType_Name(conf.output_data_type());
+    CHECK_OR_RETURN(conf.mean_size() <= 1 || conf.mean_size() == 3);
+    CHECK_OR_RETURN(conf.std_size() <= 1 || conf.std_size() == 3);
+  }
+  if (device_type != DeviceType::kCPU) {
+    CHECK_OR_RETURN(IsUint8NHWCOutput(conf))
+        << "Only the cpu decoder supports mirrored, normalized or NCHW outputs";
+  }
+  return Maybe<void>::Ok();
+}
+
 }  // namespace
 
 class ImageDecoderRandomCropResizeOp final : public Operator {
@@ -61,6 +96,8 @@ class ImageDecoderRandomCropResizeOp final : public Operator {
   Maybe<void> InferLogicalOutBlobDescs(
       const std::function<BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
       const ParallelDesc& parallel_desc) const override {
+    JUST(CheckOutputConf(this->op_conf().image_decoder_random_crop_resize_conf(),
+                         parallel_desc.device_type()));
     return InferBlobDescs(this->op_conf(), BlobDesc4BnInOp);
   }
 
@@ -67,10 +67,6 @@ class SliceBoxingAddOp final : public SliceBoxingOp {
   const SliceBoxingConf& GetCustomizedBoxingConf() const override {
     return op_conf().slice_boxing_add_conf().slice_boxing_conf();
   }
-  void VirtualInitFromOpConf() override;
-  Maybe<void> InferInternalBlobDescs(
-      const std::function<BlobDesc*(const std::string&)>& GetBlobDesc4BnInOp,
-      const ParallelContext* parallel_ctx, const JobDesc* job_desc) const override;
   Symbol<OperatorConf> GetOpConfWithoutOpNameAndLbn() const override;
 };
 
@@ -129,15 +125,6 @@ Symbol<OperatorConf> SliceBoxingCopyOp::GetOpConfWithoutOpNameAndLbn() const {
   return SymbolOf(op_conf);
 }
 
-void SliceBoxingAddOp::VirtualInitFromOpConf() { EnrollTmpBn("buf"); }
-
-Maybe<void> SliceBoxingAddOp::InferInternalBlobDescs(
-    const std::function<BlobDesc*(const std::string&)>& GetBlobDesc4BnInOp,
-    const ParallelContext* parallel_ctx, const JobDesc* job_desc) const {
-  *GetBlobDesc4BnInOp("buf") = *GetBlobDesc4BnInOp("out");
-  return Maybe<void>::Ok();
-}
-
 Symbol<OperatorConf> SliceBoxingAddOp::GetOpConfWithoutOpNameAndLbn() const {
   OperatorConf op_conf(this->op_conf());
   op_conf.set_name("undefined-op-name");
@@ -35,7 +35,9 @@ namespace oneflow {
   OF_PP_MAKE_TUPLE_SEQ(PullKV)        \
   OF_PP_MAKE_TUPLE_SEQ(Clear)         \
   OF_PP_MAKE_TUPLE_SEQ(IncreaseCount) \
-  OF_PP_MAKE_TUPLE_SEQ(EraseCount)
+  OF_PP_MAKE_TUPLE_SEQ(EraseCount)    \
+  OF_PP_MAKE_TUPLE_SEQ(BatchPushKV)   \
+  OF_PP_MAKE_TUPLE_SEQ(BatchPullKV)
 
 #define CatRequest(method) method##Request,
 #define CatReqponse(method) method##Response,
@@ -100,6 +102,11 @@ class CtrlClient {
     *v = oneflow_cast<T>(v_str);
   }
 
+  // Push or pull many keys with one request to each of the servers they are sharded to
+  virtual void BatchPushKV(const std::vector<std::pair<std::string, std::string>>& kvs) = 0;
+  virtual void BatchPullKV(const std::vector<std::string>& keys,
+                           std::vector<std::string>* vals) = 0;
+
   virtual void Clear() = 0;
   virtual int32_t IncreaseCount(const std::string& k, int32_t v) = 0;
   int32_t IncreaseCount(const std::string& k) { return IncreaseCount(k, 1); }
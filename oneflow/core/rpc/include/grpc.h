@@ -47,6 +47,8 @@ class GrpcCtrlClient final : public CtrlClient {
   void PullKV(const std::string& k, std::string* v) override;
   void PullKV(const std::string& k, PbMessage* msg) override;
   void PullMasterKV(const std::string& k, PbMessage* msg) override;
+  void BatchPushKV(const std::vector<std::pair<std::string, std::string>>& kvs) override;
+  void BatchPullKV(const std::vector<std::string>& keys, std::vector<std::string>* vals) override;
   void Clear() override;
   int32_t IncreaseCount(const std::string& k, int32_t v) override;
   void EraseCount(const std::string& k) override;
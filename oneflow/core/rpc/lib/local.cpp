@@ -132,6 +132,20 @@ void LocalCtrlClient::PullMasterKV(const std::string& k, PbMessage* msg) {
   PullKV(k, [&](const std::string& i) { msg->ParseFromString(i); });
 }
 
+void LocalCtrlClient::BatchPushKV(const std::vector<std::pair<std::string, std::string>>& kvs) {
+  std::unique_lock<std::mutex> lck(kv_mtx_);
+  for (const auto& kv : kvs) {
+    CHECK(kv_.emplace(kv.first, kv.second).second) << "duplicate key: " << kv.first;
+  }
+  kv_cv_.notify_all();
+}
+
+void LocalCtrlClient::BatchPullKV(const std::vector<std::string>& keys,
+                                  std::vector<std::string>* vals) {
+  vals->resize(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) { PullKV(keys.at(i), &vals->at(i)); }
+}
+
 void LocalCtrlClient::Clear() {
   {
     std::unique_lock<std::mutex> lck(done_names_mtx_);
@@ -211,6 +225,12 @@ class DryRunCtrlClient : public CtrlClient {
   void PullMasterKV(const std::string& k, PbMessage* msg) override {
     local_ctrl_client_->PullMasterKV(k, msg);
   }
+  void BatchPushKV(const std::vector<std::pair<std::string, std::string>>& kvs) override {
+    local_ctrl_client_->BatchPushKV(kvs);
+  }
+  void BatchPullKV(const std::vector<std::string>& keys, std::vector<std::string>* vals) override {
+    local_ctrl_client_->BatchPullKV(keys, vals);
+  }
   void Clear() override { local_ctrl_client_->Clear(); }
   int32_t IncreaseCount(const std::string& k, int32_t v) override {
     return local_ctrl_client_->IncreaseCount(k, v);
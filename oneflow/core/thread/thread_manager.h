@@ -59,23 +59,30 @@ void MultiThreadLoop(size_t work_num, const DoEachT& DoEachWork, int64_t limit_t
     FOR_RANGE(size_t, i, 0, work_num) { DoEachWork(i); }
     return;
   }
-  size_t thread_num = Singleton<ThreadPool>::Get()->thread_num();
+  ThreadPool* thread_pool = Singleton<ThreadPool>::Get();
+  size_t range_num = thread_pool->thread_num();
   if (limit_thread_num > 0) {
-    thread_num = std::min(thread_num, static_cast<size_t>(limit_thread_num));
+    range_num = std::min(range_num, static_cast<size_t>(limit_thread_num));
+  } else {
+    // more ranges than threads so that idle workers can steal from a slow one
+    range_num *= 4;
   }
-  thread_num = std::min(work_num, thread_num);
-  BalancedSplitter bs(work_num, thread_num);
-  BlockingCounter bc(thread_num);
-  FOR_RANGE(size_t, range_id, 0, thread_num) {
-    Singleton<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, DoEachWork] {
+  range_num = std::min(work_num, range_num);
+  BalancedSplitter bs(work_num, range_num);
+  WaitGroup wait_group(range_num);
+  std::vector<ThreadPool::Task> works;
+  works.reserve(range_num);
+  FOR_RANGE(size_t, range_id, 0, range_num) {
+    works.emplace_back([&wait_group, &bs, range_id, &DoEachWork] {
       size_t start = bs.At(range_id).begin();
       size_t end = bs.At(range_id).end();
       FOR_RANGE(size_t, i, start, end) { DoEachWork(i); }
-      bc.Decrease();
+      wait_group.Done();
     });
   }
-  // busy loop wait.
-  bc.WaitForeverUntilCntEqualZero();
+  thread_pool->AddWorks(std::move(works));
+  // the calling thread runs ranges too instead of blocking
+  thread_pool->Wait(&wait_group);
 }
 
 inline bool* MutIsMainThread() {
@@ -15,32 +15,246 @@ limitations under the License.
 */
 #include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/vm/sync_vm_mode_guard.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace oneflow {
 
-ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+namespace {
+
+constexpr size_t kNoWorker = static_cast<size_t>(-1);
+
+struct WorkerInfo {
+  const ThreadPool* pool = nullptr;
+  size_t id = kNoWorker;
+};
+
+WorkerInfo* MutCurrentWorkerInfo() {
+  thread_local WorkerInfo info;
+  return &info;
+}
+
+bool PopFront(std::deque<ThreadPool::Task>* works, std::atomic<size_t>* size,
+              ThreadPool::Task* work) {
+  if (works->empty()) { return false; }
+  *work = std::move(works->front());
+  works->pop_front();
+  size->store(works->size(), std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace
+
+void BindCurrentThreadToCpus(const std::vector<int32_t>& cpu_ids) {
+  if (cpu_ids.empty()) { return; }
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int32_t cpu_id : cpu_ids) { CPU_SET(cpu_id, &cpu_set); }
+  const int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+  if (ret != 0) { LOG(WARNING) << "Failed to bind the thread to cpus: " << ret; }
+#else
+  LOG(WARNING) << "Binding threads to cpus is only supported on Linux";
+#endif
+}
+
+void WaitGroup::Done() {
+  ThreadPool* pool = nullptr;
+  {
+    // decrease under the lock, so the waiter can not return before the lock is released
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cnt_.fetch_sub(1) != 1) { return; }
+    pool = waiting_pool_;
+  }
+  // the waiter may return and destroy this object from here on
+  if (pool != nullptr) { pool->WakeUpAll(); }
+}
+
+ThreadPool::ThreadPool(int32_t thread_num, const std::vector<int32_t>& cpu_ids)
+    : threads_(thread_num), work_cnt_(0), pending_cnt_(0), idle_cnt_(0), is_closed_(false) {
+  FOR_RANGE(int32_t, i, 0, thread_num) { work_queues_.emplace_back(new WorkQueue()); }
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      SyncVmModeGuard guard(SyncVmMode::kEnable);
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
+    threads_[i] = std::thread([this, i, cpu_ids]() {
+      BindCurrentThreadToCpus(cpu_ids);
+      WorkerLoop(i);
     });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    is_closed_ = true;
+  }
+  idle_cond_.notify_all();
+  for (auto& thread : threads_) { thread.join(); }
+}
+
+size_t ThreadPool::CurrentWorkerId() const {
+  const WorkerInfo* info = MutCurrentWorkerInfo();
+  return info->pool == this ? info->id : kNoWorker;
+}
+
+void ThreadPool::WorkerLoop(size_t worker_id) {
+  SyncVmModeGuard guard(SyncVmMode::kEnable);
+  *MutCurrentWorkerInfo() = WorkerInfo{this, worker_id};
+  Task work;
+  while (true) {
+    if (PopOrSteal(worker_id, &work)) {
+      work();
+      work.Reset();
+      continue;
+    }
+    // a work is being moved between queues
+    if (pending_cnt_.load() > 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cnt_.fetch_add(1);
+    idle_cond_.wait(lock, [this]() { return pending_cnt_.load() > 0 || is_closed_; });
+    idle_cnt_.fetch_sub(1);
+    // works queued before closing are drained first
+    if (is_closed_ && pending_cnt_.load() == 0) { break; }
+  }
+}
+
+bool ThreadPool::PopOrSteal(size_t worker_id, Task* work) {
+  const size_t queue_num = work_queues_.size();
+  if (worker_id != kNoWorker) {
+    WorkQueue* queue = work_queues_.at(worker_id).get();
+    if (queue->size.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      if (PopFront(&queue->works, &queue->size, work)) {
+        pending_cnt_.fetch_sub(1);
+        return true;
+      }
+    }
+  }
+  if (pending_cnt_.load() <= 0) { return false; }
+  const size_t start = worker_id != kNoWorker ? worker_id + 1 : work_cnt_.load() % queue_num;
+  FOR_RANGE(size_t, i, 0, queue_num) {
+    const size_t victim_id = (start + i) % queue_num;
+    if (victim_id == worker_id) { continue; }
+    if (Steal(victim_id, worker_id, work)) {
+      pending_cnt_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::Steal(size_t victim_id, size_t worker_id, Task* work) {
+  WorkQueue* victim = work_queues_.at(victim_id).get();
+  if (victim->size.load(std::memory_order_relaxed) == 0) { return false; }
+  std::vector<Task> stolen;
+  {
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (victim->works.empty()) { return false; }
+    // a worker takes half of the queue so that later works run without stealing again, other
+    // threads only help with a single work
+    const size_t steal_num = worker_id == kNoWorker ? 1 : (victim->works.size() + 1) / 2;
+    stolen.reserve(steal_num);
+    FOR_RANGE(size_t, i, 0, steal_num) {
+      stolen.emplace_back(std::move(victim->works.back()));
+      victim->works.pop_back();
+    }
+    victim->size.store(victim->works.size(), std::memory_order_relaxed);
+  }
+  *work = std::move(stolen.back());
+  stolen.pop_back();
+  if (!stolen.empty()) {
+    WorkQueue* queue = work_queues_.at(worker_id).get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    for (auto it = stolen.rbegin(); it != stolen.rend(); ++it) {
+      queue->works.emplace_back(std::move(*it));
+    }
+    queue->size.store(queue->works.size(), std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void ThreadPool::NotifyNewWorks(size_t work_num) {
+  // pairs with the idle_cnt_ increment before the wait predicate in WorkerLoop, either the
+  // worker sees the new works or we see the idle worker
+  if (idle_cnt_.load() == 0) { return; }
+  { std::lock_guard<std::mutex> lock(idle_mutex_); }
+  if (work_num == 1) {
+    idle_cond_.notify_one();
+  } else {
+    idle_cond_.notify_all();
+  }
+}
+
+void ThreadPool::WakeUpAll() {
+  { std::lock_guard<std::mutex> lock(idle_mutex_); }
+  idle_cond_.notify_all();
+}
+
+void ThreadPool::AddWork(Task work) {
+  size_t queue_id = CurrentWorkerId();
+  // works added by a worker stay on its own queue for locality
+  if (queue_id == kNoWorker) {
+    queue_id = work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_queues_.size();
+  }
+  WorkQueue* queue = work_queues_.at(queue_id).get();
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->works.emplace_back(std::move(work));
+    queue->size.store(queue->works.size(), std::memory_order_relaxed);
   }
+  pending_cnt_.fetch_add(1);
+  NotifyNewWorks(1);
 }
 
-void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+void ThreadPool::AddWorks(std::vector<Task>&& works) {
+  if (works.empty()) { return; }
+  const size_t queue_num = work_queues_.size();
+  const size_t queue_offset = work_cnt_.fetch_add(works.size(), std::memory_order_relaxed);
+  const size_t used_queue_num = std::min(queue_num, works.size());
+  FOR_RANGE(size_t, i, 0, used_queue_num) {
+    WorkQueue* queue = work_queues_.at((queue_offset + i) % queue_num).get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    for (size_t j = i; j < works.size(); j += used_queue_num) {
+      queue->works.emplace_back(std::move(works.at(j)));
+    }
+    queue->size.store(queue->works.size(), std::memory_order_relaxed);
+  }
+  pending_cnt_.fetch_add(works.size());
+  NotifyNewWorks(works.size());
+  works.clear();
+}
+
+void ThreadPool::Wait(WaitGroup* wait_group) {
+  {
+    std::lock_guard<std::mutex> lock(wait_group->mutex_);
+    CHECK(wait_group->waiting_pool_ == nullptr || wait_group->waiting_pool_ == this)
+        << "a WaitGroup can only be waited on one pool";
+    wait_group->waiting_pool_ = this;
+  }
+  const size_t worker_id = CurrentWorkerId();
+  // works of other callers may be picked up as well, run them in the same mode as a worker
+  SyncVmModeGuard guard(SyncVmMode::kEnable);
+  Task work;
+  while (!wait_group->IsDone()) {
+    if (PopOrSteal(worker_id, &work)) {
+      work();
+      work.Reset();
+      continue;
+    }
+    if (pending_cnt_.load() > 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cnt_.fetch_add(1);
+    idle_cond_.wait(lock, [&]() { return wait_group->IsDone() || pending_cnt_.load() > 0; });
+    idle_cnt_.fetch_sub(1);
+  }
+  // make sure WaitGroup::Done has released the mutex before the caller destroys wait_group
+  std::lock_guard<std::mutex> lock(wait_group->mutex_);
 }
 
 }  // namespace oneflow
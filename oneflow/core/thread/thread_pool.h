@@ -16,28 +16,168 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <type_traits>
 #include "oneflow/core/common/util.h"
-#include "oneflow/core/common/channel.h"
 
 namespace oneflow {
 
+class ThreadPool;
+
+// Counts outstanding works, ThreadPool::Wait runs queued works on the waiting thread until the
+// count drops to zero.
+class WaitGroup final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WaitGroup);
+  explicit WaitGroup(int64_t cnt = 0) : cnt_(cnt), waiting_pool_(nullptr) {}
+  ~WaitGroup() = default;
+
+  void Add(int64_t cnt) { cnt_.fetch_add(cnt); }
+  void Done();
+  bool IsDone() const { return cnt_.load() == 0; }
+
+ private:
+  friend class ThreadPool;
+
+  std::atomic<int64_t> cnt_;
+  std::mutex mutex_;
+  ThreadPool* waiting_pool_;
+};
+
 class ThreadPool final {
  public:
+  // A move-only void() callable. Callables up to kInlineSize bytes, such as lambdas capturing a
+  // few references, are stored inline so that submitting them does not allocate.
+  class Task final {
+   public:
+    static constexpr size_t kInlineSize = 48;
+
+    Task() : ops_(nullptr) {}
+    template<typename F, typename = typename std::enable_if<
+                             !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f) {  // NOLINT
+      using Fn = typename std::decay<F>::type;
+      if constexpr (sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t)
+                    && std::is_nothrow_move_constructible<Fn>::value) {
+        new (&storage_) Fn(std::forward<F>(f));
+        ops_ = &InlineOps<Fn>::ops;
+      } else {
+        *reinterpret_cast<Fn**>(&storage_) = new Fn(std::forward<F>(f));
+        ops_ = &HeapOps<Fn>::ops;
+      }
+    }
+    Task(Task&& other) noexcept : ops_(other.ops_) {
+      if (ops_ != nullptr) {
+        ops_->move(&other.storage_, &storage_);
+        other.ops_ = nullptr;
+      }
+    }
+    Task& operator=(Task&& other) noexcept {
+      if (this != &other) {
+        Reset();
+        ops_ = other.ops_;
+        if (ops_ != nullptr) {
+          ops_->move(&other.storage_, &storage_);
+          other.ops_ = nullptr;
+        }
+      }
+      return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { Reset(); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+    void operator()() { ops_->invoke(&storage_); }
+    void Reset() {
+      if (ops_ != nullptr) {
+        ops_->destroy(&storage_);
+        ops_ = nullptr;
+      }
+    }
+
+   private:
+    using Storage = typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type;
+    struct Ops {
+      void (*invoke)(Storage*);
+      // move constructs dst from src and destroys src
+      void (*move)(Storage* src, Storage* dst);
+      void (*destroy)(Storage*);
+    };
+    template<typename Fn>
+    struct InlineOps {
+      static Fn* Get(Storage* s) { return reinterpret_cast<Fn*>(s); }
+      static constexpr Ops ops = {
+          [](Storage* s) { (*Get(s))(); },
+          [](Storage* src, Storage* dst) {
+            new (dst) Fn(std::move(*Get(src)));
+            Get(src)->~Fn();
+          },
+          [](Storage* s) { Get(s)->~Fn(); }};
+    };
+    template<typename Fn>
+    struct HeapOps {
+      static Fn*& Get(Storage* s) { return *reinterpret_cast<Fn**>(s); }
+      static constexpr Ops ops = {[](Storage* s) { (*Get(s))(); },
+                                  [](Storage* src, Storage* dst) {
+                                    *reinterpret_cast<Fn**>(dst) = Get(src);
+                                  },
+                                  [](Storage* s) { delete Get(s); }};
+    };
+
+    Storage storage_;
+    const Ops* ops_;
+  };
+
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
   ThreadPool() = delete;
-  ThreadPool(int32_t thread_num);
+  // The workers only run on the cpus in cpu_ids if it is not empty, which is supported on Linux.
+  ThreadPool(int32_t thread_num, const std::vector<int32_t>& cpu_ids = {});
   ~ThreadPool();
 
   int32_t thread_num() const { return threads_.size(); }
-  void AddWork(const std::function<void()>& work);
+  void AddWork(Task work);
+  // Submits all works at once, spreading them over the worker queues with one lock per queue.
+  void AddWorks(std::vector<Task>&& works);
+  // Runs queued works on the calling thread until wait_group is done, so waiting inside a work
+  // does not deadlock the pool.
+  void Wait(WaitGroup* wait_group);
 
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
+  friend class WaitGroup;
+
+  // Works are pushed to the back and popped from the front by the owner, idle workers steal
+  // half of the queue from the back of a busy one.
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Task> works;
+    std::atomic<size_t> size{0};
+  };
+
+  void WorkerLoop(size_t worker_id);
+  bool PopOrSteal(size_t worker_id, Task* work);
+  bool Steal(size_t victim_id, size_t worker_id, Task* work);
+  size_t CurrentWorkerId() const;
+  void NotifyNewWorks(size_t work_num);
+  void WakeUpAll();
+
+  std::vector<std::unique_ptr<WorkQueue>> work_queues_;
   std::vector<std::thread> threads_;
 
   std::atomic<size_t> work_cnt_;
+  // number of queued works that have not been taken yet
+  std::atomic<int64_t> pending_cnt_;
+  std::atomic<int64_t> idle_cnt_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  bool is_closed_;
 };
 
+// Binds the calling thread to the cpus in cpu_ids if it is not empty, which is supported on Linux.
+void BindCurrentThreadToCpus(const std::vector<int32_t>& cpu_ids);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_THREAD_THREAD_POOL_H_
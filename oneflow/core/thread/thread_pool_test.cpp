@@ -0,0 +1,155 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <array>
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/thread/thread_runtime.h"
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace oneflow {
+namespace test {
+
+TEST(ThreadPool, add_works_and_wait) {
+  ThreadPool pool(4);
+  std::atomic<int64_t> sum(0);
+  WaitGroup wait_group(100);
+  std::vector<ThreadPool::Task> works;
+  for (int64_t i = 0; i < 100; ++i) {
+    works.emplace_back([i, &sum, &wait_group]() {
+      sum += i;
+      wait_group.Done();
+    });
+  }
+  pool.AddWorks(std::move(works));
+  pool.Wait(&wait_group);
+  ASSERT_EQ(sum, 4950);
+}
+
+TEST(ThreadPool, nested_wait) {
+  ThreadPool pool(2);
+  std::atomic<int64_t> cnt(0);
+  WaitGroup wait_group(8);
+  FOR_RANGE(int, i, 0, 8) {
+    pool.AddWork([&]() {
+      // waiting inside a work runs the inner works instead of blocking the worker
+      WaitGroup inner_wait_group(4);
+      FOR_RANGE(int, j, 0, 4) {
+        pool.AddWork([&]() {
+          ++cnt;
+          inner_wait_group.Done();
+        });
+      }
+      pool.Wait(&inner_wait_group);
+      wait_group.Done();
+    });
+  }
+  pool.Wait(&wait_group);
+  ASSERT_EQ(cnt, 32);
+}
+
+TEST(ThreadPool, blocked_work_does_not_stall_its_queue) {
+  ThreadPool pool(2);
+  std::atomic<int64_t> cnt(0);
+  WaitGroup wait_group(16);
+  std::vector<ThreadPool::Task> works;
+  // the first work only finishes after all works queued behind it have been stolen and run
+  works.emplace_back([&]() {
+    while (cnt < 15) { std::this_thread::yield(); }
+    wait_group.Done();
+  });
+  FOR_RANGE(int, i, 0, 15) {
+    works.emplace_back([&]() {
+      ++cnt;
+      wait_group.Done();
+    });
+  }
+  pool.AddWorks(std::move(works));
+  pool.Wait(&wait_group);
+  ASSERT_EQ(cnt, 15);
+}
+
+TEST(ThreadPool, task_with_large_capture) {
+  ThreadPool pool(1);
+  std::array<int64_t, 16> values{};
+  values.back() = 42;
+  int64_t result = 0;
+  WaitGroup wait_group(1);
+  pool.AddWork([values, &result, &wait_group]() {
+    result = values.back();
+    wait_group.Done();
+  });
+  pool.Wait(&wait_group);
+  ASSERT_EQ(result, 42);
+}
+
+TEST(ThreadPool, task_move) {
+  auto value = std::make_shared<int>(1);
+  ThreadPool::Task task([value]() { ++*value; });
+  ASSERT_EQ(value.use_count(), 2);
+  ThreadPool::Task moved(std::move(task));
+  ASSERT_FALSE(static_cast<bool>(task));
+  moved();
+  ASSERT_EQ(*value, 2);
+  moved.Reset();
+  ASSERT_EQ(value.use_count(), 1);
+}
+
+#ifdef __linux__
+TEST(ThreadPool, bind_to_cpus) {
+  cpu_set_t allowed;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(cpu_set_t), &allowed), 0);
+  int32_t cpu_id = 0;
+  while (!CPU_ISSET(cpu_id, &allowed)) { ++cpu_id; }
+  ThreadPool pool(2, {cpu_id});
+  std::array<int, 8> cpus{};
+  WaitGroup wait_group(cpus.size());
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    pool.AddWork([i, &cpus, &wait_group]() {
+      cpus[i] = sched_getcpu();
+      wait_group.Done();
+    });
+  }
+  // wait without helping, so that all works run on the pool workers
+  while (!wait_group.IsDone()) { std::this_thread::yield(); }
+  for (int cpu : cpus) { ASSERT_EQ(cpu, cpu_id); }
+}
+
+TEST(ThreadPool, bound_runtime_with_caller) {
+  cpu_set_t allowed;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(cpu_set_t), &allowed), 0);
+  int32_t cpu_id = 0;
+  while (!CPU_ISSET(cpu_id, &allowed)) { ++cpu_id; }
+  // two workers and the caller, which takes part in the parallel for
+  thread::OfRuntime runtime(3, {cpu_id});
+  std::array<int, 6> cpus{};
+  std::thread caller([&]() {
+    BindCurrentThreadToCpus({cpu_id});
+    runtime.ParallelFor(
+        0, cpus.size(),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) { cpus[i] = sched_getcpu(); }
+        },
+        3, 1);
+  });
+  caller.join();
+  for (int cpu : cpus) { ASSERT_EQ(cpu, cpu_id); }
+}
+#endif
+
+}  // namespace test
+}  // namespace oneflow
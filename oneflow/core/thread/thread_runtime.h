@@ -69,28 +69,51 @@ class SeqRuntime final : public RuntimeBase {
 };
 
 class OfRuntime final : public RuntimeBase {
+ public:
+  OfRuntime() : thread_num_(0) {}
+  // Runs the works on a pool of its own rather than the global one. The pool is created by the
+  // first ParallelFor, so that streams which never run parallel kernels do not own idle threads.
+  // The caller runs works in ThreadPool::Wait too, so the pool has thread_num - 1 workers and the
+  // caller is expected to be bound to cpu_ids as well.
+  OfRuntime(int32_t thread_num, std::vector<int32_t> cpu_ids)
+      : thread_num_(thread_num), cpu_ids_(std::move(cpu_ids)) {}
+
  private:
+  ThreadPool* GetThreadPool() {
+    if (thread_num_ == 0) { return Singleton<ThreadPool>::Get(); }
+    if (thread_num_ == 1) { return nullptr; }
+    std::call_once(thread_pool_created_,
+                   [this] { thread_pool_.reset(new ThreadPool(thread_num_ - 1, cpu_ids_)); });
+    return thread_pool_.get();
+  }
+
   void ParallelForImpl(int64_t begin, int64_t end, const CallableT& func, size_t num_threads,
                        size_t grain_size) override {
-    if (unlikely(pthread_fork::IsForkedSubProcess()) || Singleton<ThreadPool>::Get() == nullptr) {
-      return SeqFor(begin, end, func);
-    }
+    if (unlikely(pthread_fork::IsForkedSubProcess())) { return SeqFor(begin, end, func); }
+    ThreadPool* thread_pool = GetThreadPool();
+    if (thread_pool == nullptr) { return SeqFor(begin, end, func); }
     const size_t num_elements = end - begin;
     num_threads = std::min(num_elements, num_threads);
     BalancedSplitter bs(num_elements, num_threads);
-    BlockingCounter bc(num_threads);
-
+    WaitGroup wait_group(num_threads);
+    std::vector<ThreadPool::Task> works;
+    works.reserve(num_threads);
     FOR_RANGE(size_t, range_id, 0, num_threads) {
-      Singleton<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, func] {
-        const size_t begin_ = bs.At(range_id).begin();
-        const size_t end_ = bs.At(range_id).end();
+      works.emplace_back([&wait_group, &bs, range_id, begin, &func] {
+        const size_t begin_ = begin + bs.At(range_id).begin();
+        const size_t end_ = begin + bs.At(range_id).end();
         SeqFor(begin_, end_, func);
-        bc.Decrease();
+        wait_group.Done();
       });
     }
-    // buzy loop wait.
-    bc.WaitForeverUntilCntEqualZero();
+    thread_pool->AddWorks(std::move(works));
+    thread_pool->Wait(&wait_group);
   }
+
+  int32_t thread_num_;
+  std::vector<int32_t> cpu_ids_;
+  std::once_flag thread_pool_created_;
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 
 #if WITH_TBB
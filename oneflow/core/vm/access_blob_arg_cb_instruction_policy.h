@@ -79,7 +79,9 @@ class AccessBlobArgCbInstructionPolicy final : public InstructionPolicy {
     auto rematable_storage =
         std::dynamic_pointer_cast<RematableTensorStorage>(eager_blob_object()->tensor_storage());
 
-    if (rematable_storage && !rematable_storage->is_in_memory()) {
+    if (rematable_storage && rematable_storage->is_spilled()) {
+      CHECK_JUST(rematable_storage->Restore(instruction->mut_stream()));
+    } else if (rematable_storage && !rematable_storage->is_in_memory()) {
       OpCallInstructionPolicy tmp_op = rematable_storage->compute_op();
       CHECK_JUST(Recompute(&tmp_op, instruction->mut_stream()));
     }
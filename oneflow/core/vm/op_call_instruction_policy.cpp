@@ -30,6 +30,7 @@ limitations under the License.
 #include "oneflow/core/framework/stream_get_stream_type_name.h"
 #include "oneflow/core/vm/stream_get_allocator_stream_type.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/util.h"
 #include "fmt/core.h"
 
 namespace oneflow {
@@ -70,7 +71,16 @@ struct OpCallInstructionUtil final {
     if (op_call_instruction_policy->user_opkernel()->has_state_or_cache()) {
       TryInitOpKernelStateAndCache(op_call_instruction_policy, stream, &state, &cache);
     }
+    // The spill tier compares the compute time of a tensor to its transfer time
+    const bool measure_compute_time =
+        outputs_rematable && Singleton<remat::Env>::Get()->is_spill_enabled();
+    const auto compute_started_at = measure_compute_time ? profiler::GetTimeNow() : 0;
     OpKernelCompute(op_call_instruction_policy, stream, state, cache);
+    if (measure_compute_time && stream->device_type() != DeviceType::kCPU) {
+      JUST(stream->Sync());
+    }
+    const double compute_time =
+        measure_compute_time ? (profiler::GetTimeNow() - compute_started_at) / 1e9 : 0;
     if (unlikely(op_call_instruction_policy->need_temp_storage())) {
       DeallocateTempStorage(op_call_instruction_policy, allocator);
     }
@@ -78,6 +88,7 @@ struct OpCallInstructionUtil final {
     if (inputs_rematable || outputs_rematable) {
       JUST(remat_helper->UpdateRematInfo(first, recompute, inputs_rematable, outputs_rematable));
     }
+    if (measure_compute_time) { remat_helper->SetMeasuredComputeTime(compute_time); }
     return Maybe<void>::Ok();
   }
 
@@ -52,13 +52,14 @@ void DisjointSet::update_after_compute(vm::RematableTensorStorage* obj) {
 
 Maybe<void> DisjointSet::update_after_release(vm::RematableTensorStorage* obj) {
   CHECK_NOTNULL_OR_RETURN(obj);
-  if (obj->is_eviction_disabled()) { return Maybe<void>::Ok(); }
+  // A spilled tensor is copied back instead of being recomputed with its neighbors
+  if (obj->is_eviction_disabled() || obj->is_spilled()) { return Maybe<void>::Ok(); }
 
   const auto merge_nodes = [&obj](const auto& eager_blob_objects) {
     for (int i = 0; i < eager_blob_objects.size(); ++i) {
       if (auto storage = std::dynamic_pointer_cast<vm::RematableTensorStorage>(
               eager_blob_objects[i]->tensor_storage());
-          storage && !storage->is_in_memory()) {
+          storage && !storage->is_in_memory() && !storage->is_spilled()) {
         merge(storage->node, obj->node);
       }
     }
@@ -105,6 +105,7 @@ vm::OpCallInstructionPolicy Env::update_tensor_with_storage(
   VLOG(1) << "update_tensor_with_storage: storage " << storage->id();
   // set compute_op_ and compute_time_
   new_storage->set_compute_op(storage->dtr_compute_op(), storage->compute_time());
+  new_storage->set_measured_compute_time(storage->measured_compute_time());
   // set blob_bytes_
   new_storage->set_blob_dptr(nullptr, storage->blob_bytes());
   // set is_initialized_
@@ -123,10 +124,31 @@ void Env::add_eviction_num(bool eager_eviction) {
   }
 }
 
+namespace {
+
+void UpdateBandwidth(double* bandwidth, size_t bytes, double seconds) {
+  if (seconds <= 0) { return; }
+  *bandwidth = 0.75 * *bandwidth + 0.25 * bytes / seconds;
+}
+
+}  // namespace
+
+void Env::add_spill(size_t bytes, double seconds) {
+  spill_num_++;
+  UpdateBandwidth(&spill_bandwidth_, bytes, seconds);
+}
+
+void Env::add_restore(size_t bytes, double seconds) {
+  restore_num_++;
+  UpdateBandwidth(&spill_bandwidth_, bytes, seconds);
+}
+
 Env::~Env() {
   LOG(INFO) << "forced eviction num: " << forced_eviction_num_;
   LOG(INFO) << "eager eviction num: " << eager_eviction_num_;
   LOG(INFO) << "recomputation num: " << recomputation_num_;
+  LOG(INFO) << "spill num: " << spill_num_;
+  LOG(INFO) << "restore num: " << restore_num_;
   LOG(INFO) << "duration: " << time_now_;
 
   const char* prefix = std::getenv("ONEFLOW_REMAT_SUMMARY_FILE_PREFIX");
@@ -135,6 +157,8 @@ Env::~Env() {
     json cpp_summary{{"forced eviction", forced_eviction_num_},
                      {"eager eviction", eager_eviction_num_},
                      {"recomputation", recomputation_num_},
+                     {"spill", spill_num_},
+                     {"restore", restore_num_},
                      {"dataset time", time_now_}};
 
     json full_json;
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "oneflow/core/common/env_var/remat.h"
 #include "oneflow/core/common/util.h"
+#include "oneflow/core/vm/remat/spill.h"
 
 #define VLOG_REMAT(verbose_level) \
   if (Singleton<remat::Env>::Get()->log_enabled()) VLOG(verbose_level)
@@ -59,6 +60,8 @@ class Env {
     eager_eviction_num_ = 0;
     forced_eviction_num_ = 0;
     recomputation_num_ = 0;
+    spill_num_ = 0;
+    restore_num_ = 0;
   }
 
   std::set<vm::RematableTensorStorage*> need_eager_eviction_storages;
@@ -71,6 +74,26 @@ class Env {
 
   bool log_enabled() const { return EnvBool<ONEFLOW_REMAT_LOG>(); }
 
+  void set_spill_enabled(bool enabled) { spill_enabled_ = enabled; }
+  bool is_spill_enabled() const { return spill_enabled_; }
+  void set_spill_compression(bool enabled) { spill_compression_ = enabled; }
+  void set_spill_dir(const std::string& dir) { spill_dir_ = dir; }
+  const std::string& spill_dir() const { return spill_dir_; }
+  // Spilled tensors are written to files under spill_dir if it is set, e.g. on a NVMe disk
+  SpillTier spill_tier() const {
+    if (!spill_dir_.empty()) { return SpillTier::kFile; }
+    return spill_compression_ ? SpillTier::kCompressedHost : SpillTier::kHost;
+  }
+
+  // Bytes per second of copying a tensor to or from the spill tier, a moving average of the
+  // measured spills and restores
+  double spill_bandwidth() const { return spill_bandwidth_; }
+  void set_spill_bandwidth(double bandwidth) { spill_bandwidth_ = bandwidth; }
+  void add_spill(size_t bytes, double seconds);
+  void add_restore(size_t bytes, double seconds);
+  int spill_num() const { return spill_num_; }
+  int restore_num() const { return restore_num_; }
+
  private:
   double time_now_ = 0;
 
@@ -80,6 +103,13 @@ class Env {
 
   size_t budget_in_bytes_ = 0;
   bool small_pieces_optimization_ = true;
+
+  bool spill_enabled_ = EnvBool<ONEFLOW_REMAT_SPILL>();
+  bool spill_compression_ = EnvBool<ONEFLOW_REMAT_SPILL_COMPRESSION>();
+  std::string spill_dir_ = GetStringFromEnv("ONEFLOW_REMAT_SPILL_DIR", "");
+  double spill_bandwidth_ = EnvInteger<ONEFLOW_REMAT_SPILL_BANDWIDTH_MB>() * 1024. * 1024.;
+  int spill_num_ = 0;
+  int restore_num_ = 0;
 };
 
 struct CurrentOpTypeName {
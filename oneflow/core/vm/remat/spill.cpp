@@ -0,0 +1,174 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/remat/spill.h"
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/ep/include/stream.h"
+#include "oneflow/core/vm/remat/env.h"
+
+namespace oneflow {
+namespace remat {
+
+namespace {
+
+using Word = uint64_t;
+
+Word LoadWord(const char* ptr) {
+  Word word;  // NOLINT
+  std::memcpy(&word, ptr, sizeof(Word));
+  return word;
+}
+
+void AppendBytes(std::vector<char>* dst, const void* src, size_t bytes) {
+  const char* begin = static_cast<const char*>(src);
+  dst->insert(dst->end(), begin, begin + bytes);
+}
+
+// Encodes the words of src as a sequence of (number of zero words, number of literal words,
+// literal words), followed by the bytes after the last whole word
+void CompressZeroRuns(const std::vector<char>& src, std::vector<char>* dst) {
+  const size_t num_words = src.size() / sizeof(Word);
+  size_t i = 0;
+  while (i < num_words) {
+    Word num_zeros = 0;
+    while (i < num_words && LoadWord(src.data() + i * sizeof(Word)) == 0) {
+      ++num_zeros;
+      ++i;
+    }
+    const size_t literal_begin = i;
+    while (i < num_words && LoadWord(src.data() + i * sizeof(Word)) != 0) { ++i; }
+    const Word num_literals = i - literal_begin;
+    AppendBytes(dst, &num_zeros, sizeof(Word));
+    AppendBytes(dst, &num_literals, sizeof(Word));
+    AppendBytes(dst, src.data() + literal_begin * sizeof(Word), num_literals * sizeof(Word));
+  }
+  AppendBytes(dst, src.data() + num_words * sizeof(Word), src.size() % sizeof(Word));
+}
+
+Maybe<void> DecompressZeroRuns(const std::vector<char>& src, std::vector<char>* dst) {
+  const size_t num_words = dst->size() / sizeof(Word);
+  size_t src_offset = 0;
+  size_t i = 0;
+  while (i < num_words) {
+    CHECK_LE_OR_RETURN(src_offset + 2 * sizeof(Word), src.size());
+    const Word num_zeros = LoadWord(src.data() + src_offset);
+    const Word num_literals = LoadWord(src.data() + src_offset + sizeof(Word));
+    src_offset += 2 * sizeof(Word);
+    CHECK_LE_OR_RETURN(i + num_zeros + num_literals, num_words);
+    CHECK_LE_OR_RETURN(src_offset + num_literals * sizeof(Word), src.size());
+    std::memset(dst->data() + i * sizeof(Word), 0, num_zeros * sizeof(Word));
+    i += num_zeros;
+    std::memcpy(dst->data() + i * sizeof(Word), src.data() + src_offset,
+                num_literals * sizeof(Word));
+    i += num_literals;
+    src_offset += num_literals * sizeof(Word);
+  }
+  const size_t tail_bytes = dst->size() % sizeof(Word);
+  CHECK_EQ_OR_RETURN(src_offset + tail_bytes, src.size());
+  std::memcpy(dst->data() + num_words * sizeof(Word), src.data() + src_offset, tail_bytes);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Memcpy(ep::Stream* stream, ep::primitive::MemcpyKind kind, void* dst, const void* src,
+                   size_t bytes) {
+  auto memcpy =
+      ep::primitive::NewPrimitive<ep::primitive::MemcpyFactory>(stream->device_type(), kind);
+  CHECK_OR_RETURN(memcpy) << "no memcpy primitive on device " << stream->device_type();
+  memcpy->Launch(stream, dst, src, bytes);
+  // The host buffer is read or freed right after the copy
+  JUST(stream->Sync());
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+SpilledBlob::~SpilledBlob() {
+  if (!path_.empty()) { std::remove(path_.c_str()); }
+}
+
+Maybe<SpilledBlob> SpilledBlob::New(ep::Stream* stream, const char* dptr, size_t bytes,
+                                    int64_t id) {
+  auto blob = std::make_shared<SpilledBlob>(Singleton<Env>::Get()->spill_tier(), bytes);
+  std::vector<char> host_buffer(bytes);
+  JUST(Memcpy(stream, ep::primitive::MemcpyKind::kDtoH, host_buffer.data(), dptr, bytes));
+  JUST(blob->Store(std::move(host_buffer), id));
+  return blob;
+}
+
+Maybe<void> SpilledBlob::Restore(ep::Stream* stream, char* dptr) const {
+  if (tier_ != SpillTier::kFile && !is_compressed_) {
+    return Memcpy(stream, ep::primitive::MemcpyKind::kHtoD, dptr, data_.data(), bytes_);
+  }
+  std::vector<char> host_buffer(bytes_);
+  JUST(Load(&host_buffer));
+  JUST(Memcpy(stream, ep::primitive::MemcpyKind::kHtoD, dptr, host_buffer.data(), bytes_));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SpilledBlob::Store(std::vector<char>&& host_buffer, int64_t id) {
+  switch (tier_) {
+    case SpillTier::kHost: {
+      data_ = std::move(host_buffer);
+      break;
+    }
+    case SpillTier::kCompressedHost: {
+      CompressZeroRuns(host_buffer, &data_);
+      is_compressed_ = data_.size() < host_buffer.size();
+      // Incompressible tensors are kept as they are
+      if (!is_compressed_) { data_ = std::move(host_buffer); }
+      data_.shrink_to_fit();
+      break;
+    }
+    case SpillTier::kFile: {
+      path_ = Singleton<Env>::Get()->spill_dir() + "/oneflow_remat_spill_"
+              + std::to_string(getpid()) + "_" + std::to_string(id);
+      std::ofstream ofs(path_, std::ios::binary | std::ios::trunc);
+      CHECK_OR_RETURN(ofs.is_open()) << "can not open spill file " << path_;
+      ofs.write(host_buffer.data(), host_buffer.size());
+      CHECK_OR_RETURN(ofs.good()) << "can not write spill file " << path_;
+      break;
+    }
+    default: UNIMPLEMENTED_THEN_RETURN();
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SpilledBlob::Load(std::vector<char>* host_buffer) const {
+  switch (tier_) {
+    case SpillTier::kCompressedHost: {
+      CHECK_OR_RETURN(is_compressed_);
+      JUST(DecompressZeroRuns(data_, host_buffer));
+      break;
+    }
+    case SpillTier::kFile: {
+      std::ifstream ifs(path_, std::ios::binary);
+      CHECK_OR_RETURN(ifs.is_open()) << "can not open spill file " << path_;
+      ifs.read(host_buffer->data(), bytes_);
+      CHECK_OR_RETURN(ifs.good()) << "can not read spill file " << path_;
+      break;
+    }
+    default: UNIMPLEMENTED_THEN_RETURN();
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace remat
+}  // namespace oneflow
@@ -0,0 +1,69 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+namespace ep {
+class Stream;
+}
+
+namespace remat {
+
+// Where a spilled tensor is kept, see remat::Env for how it is chosen
+enum class SpillTier {
+  kHost,
+  // Runs of zero words are dropped, they are common in the activations after relu and dropout
+  kCompressedHost,
+  kFile,
+};
+
+// The copy of an evicted tensor kept out of the memory budget, so that the tensor can be copied
+// back instead of being recomputed
+class SpilledBlob final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SpilledBlob);
+  SpilledBlob(SpillTier tier, size_t bytes) : tier_(tier), bytes_(bytes) {}
+  ~SpilledBlob();
+
+  // Copies `bytes` bytes at `dptr` on the device of `stream` to the tier configured in remat::Env
+  static Maybe<SpilledBlob> New(ep::Stream* stream, const char* dptr, size_t bytes, int64_t id);
+
+  Maybe<void> Restore(ep::Stream* stream, char* dptr) const;
+
+  SpillTier tier() const { return tier_; }
+  size_t bytes() const { return bytes_; }
+  // The host memory taken by the blob, 0 for the file tier
+  size_t host_bytes() const { return data_.size(); }
+
+ private:
+  Maybe<void> Store(std::vector<char>&& host_buffer, int64_t id);
+  Maybe<void> Load(std::vector<char>* host_buffer) const;
+
+  SpillTier tier_;
+  size_t bytes_;
+  bool is_compressed_ = false;
+  std::vector<char> data_;
+  std::string path_;
+};
+
+}  // namespace remat
+}  // namespace oneflow
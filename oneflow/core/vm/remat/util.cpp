@@ -284,7 +284,7 @@ Maybe<void> RematHelper::_IncReferenceNumOfRecomputedTensor(
     auto& storage = input_storages_[i];
     storage->Pin();
     VLOG_REMAT(1) << "No." << i << " input is in memory? " << storage->is_in_memory();
-    if (!storage->is_in_memory()) {
+    if (!storage->is_in_memory() && !storage->is_spilled()) {
       OpCallInstructionPolicy tmp_op = storage->compute_op();
       if (!storage->is_needed_by_backward()) {
         Singleton<remat::Env>::Get()->need_eager_eviction_storages.insert(storage.get());
@@ -320,7 +320,10 @@ Maybe<void> RematHelper::RematInputs(
 
   for (int i = 0; i < input_storages_.size(); i++) {
     auto& storage = input_storages_[i];
-    if (!storage->is_in_memory()) {
+    if (storage->is_spilled()) {
+      VLOG_REMAT(1) << "restore No." << i << " input. Storage id: " << storage->id();
+      JUST(storage->Restore(vm_stream));
+    } else if (!storage->is_in_memory()) {
       VLOG_REMAT(1) << "recompute No." << i << " input by " << storage->compute_op_type_name()
                     << ". Storage id: " << storage->id();
       OpCallInstructionPolicy tmp_op = storage->compute_op();
@@ -350,6 +353,10 @@ Maybe<void> RematHelper::EagerlyEvictRemattedTensors(bool first) {
   return Maybe<void>::Ok();
 }
 
+void RematHelper::SetMeasuredComputeTime(double seconds) {
+  for (auto& storage : output_storages_) { storage->set_measured_compute_time(seconds); }
+}
+
 Maybe<void> RematHelper::UpdateRematInfo(bool first, bool recompute, bool include_input,
                                          bool include_output) {
   if (include_output) {
@@ -379,6 +386,8 @@ Maybe<void> RematHelper::UpdateRematInfo(bool first, bool recompute, bool includ
       }
       storage->Unpin();
       storage->Access();
+      // The spilled copy of an output recomputed along with another output is stale
+      storage->clear_spilled_blob();
       remat::DisjointSet::update_after_compute(storage.get());
     }
   }
@@ -52,6 +52,7 @@ class RematHelper {
       const std::function<Maybe<void>(OpCallInstructionPolicy*, vm::Stream*)>& compute_fn);
   Maybe<void> EagerlyEvictRemattedTensors(bool first);
   Maybe<void> UpdateRematInfo(bool first, bool recompute, bool include_input, bool include_output);
+  void SetMeasuredComputeTime(double seconds);
 
  private:
   Maybe<int> IncReferenceNumOfRecomputedTensor();
@@ -24,6 +24,8 @@ limitations under the License.
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/LLVMIR/NVVMDialect.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "OneFlow/Conversion/OneFlowToTosa.h"
@@ -38,6 +40,7 @@ limitations under the License.
 #include "OneFlow/Transform/OneFlowStream.h"
 #include "OneFlow/Transform/EliminateAllocOps.h"
 #include "OneFlow/Transform/TraitFolder.h"
+#include "OneFlow/Transform/TileAndVectorize.h"
 
 #ifdef WITH_MLIR_CUDA_CODEGEN
 #include "OneFlow/Conversion/NVVMToCubin.h"
@@ -52,6 +55,8 @@ namespace oneflow {
 #include "OneFlow/OneFlowPasses.h.inc"
 
 LogicalResult LowerModuleToLLVM(mlir::MLIRContext* context, ModuleOp module);
+// Like LowerModuleToLLVM, but also lowers softmax and tiles and vectorizes the loops for the host
+LogicalResult LowerModuleToHostLLVM(mlir::MLIRContext* context, ModuleOp module);
 #ifdef WITH_MLIR_CUDA_CODEGEN
 LogicalResult LowerModuleToCUDALLVM(mlir::MLIRContext* context, ModuleOp module);
 #endif  // WITH_MLIR_CUDA_CODEGEN
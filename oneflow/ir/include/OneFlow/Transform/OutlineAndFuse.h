@@ -33,6 +33,7 @@ inline const std::string RAW_GRAPH = "oneflow.raw_graph";
 
 std::unique_ptr<mlir::Pass> createWrapOpsToKernelLaunchPass();
 std::unique_ptr<mlir::Pass> createOutlineJitFunctionPass();
+std::unique_ptr<mlir::Pass> createOutlineCpuFusibleOpsPass();
 std::unique_ptr<mlir::Pass> createFuseIntoExistingOpPass();
 std::unique_ptr<mlir::Pass> createGroupMatMul();
 std::unique_ptr<mlir::Pass> createFuseForwardOps();
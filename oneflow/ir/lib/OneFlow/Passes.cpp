@@ -104,6 +104,9 @@ limitations under the License.
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Dialect/Bufferization/Transforms/Passes.h"
 #include "mlir/Conversion/SCFToControlFlow/SCFToControlFlow.h"
+#include "mlir/Conversion/MathToLLVM/MathToLLVM.h"
+#include "mlir/Conversion/VectorToLLVM/ConvertVectorToLLVMPass.h"
+#include "mlir/Conversion/VectorToSCF/VectorToSCF.h"
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/None.h"
@@ -1059,6 +1062,32 @@ LogicalResult LowerModuleToLLVM(mlir::MLIRContext* context, ModuleOp module) {
   return pm.run(module);
 }
 
+LogicalResult LowerModuleToHostLLVM(mlir::MLIRContext* context, ModuleOp module) {
+  mlir::PassManager pm(context);
+  mlir::oneflow::CheckEnableIRPrinting(pm);
+  // softmax has no tosa lowering, so it must be decomposed before the full tosa conversion
+  pm.addPass(createLowerOneFlowToLinalgPass());
+  AddLoweringToLinalgMemRefPasses(pm);
+  pm.addNestedPass<func::FuncOp>(createTileAndVectorizeLinalgPass());
+  pm.addNestedPass<func::FuncOp>(createCanonicalizerPass());
+  pm.addNestedPass<func::FuncOp>(createConvertVectorToSCFPass());
+  pm.addNestedPass<func::FuncOp>(createConvertLinalgToLoopsPass());
+  pm.addNestedPass<func::FuncOp>(createConvertSCFToCFPass());
+  pm.addNestedPass<func::FuncOp>(createFoldAllocToSubviewPass());
+  pm.addPass(createInsertOneFlowMemPoolPass());
+  pm.addPass(createAppendOneFlowStreamPass());
+  pm.addPass(memref::createExpandOpsPass());
+  pm.addPass(memref::createExpandStridedMetadataPass());
+  pm.addPass(createConvertVectorToLLVMPass());
+  pm.addPass(createFinalizeMemRefToLLVMConversionPass());
+  pm.addPass(createLowerAffinePass());
+  pm.addPass(createConvertMathToLLVMPass());
+  pm.addPass(createConvertLinalgToLLVMPass());
+  pm.addPass(createConvertFuncToLLVMPass());
+  pm.addPass(createReconcileUnrealizedCastsPass());
+  return pm.run(module);
+}
+
 #ifdef WITH_MLIR_CUDA_CODEGEN
 
 void AddLoweringLinalgOnBufferToGpuWithStdPasses(PassManager& pm) {
@@ -23,6 +23,12 @@ limitations under the License.
 #include "mlir/Parser/Parser.h"
 #include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
 #include "mlir/Bytecode/BytecodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
 
 namespace mlir {
 
@@ -154,7 +160,9 @@ std::string convertFuncToByte(func::FuncOp& func) {
   return byte;
 }
 
-std::string lowerFuncToLLVMByte(const std::string& raw_byte, const StringAttr& device_tag) {
+std::string lowerFuncToLLVMByte(
+    const std::string& raw_byte,
+    const std::function<void(mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module)>& lower) {
   mlir::DialectRegistry registry;
   mlir::registerAllDialects(registry);
   registry.insert<mlir::oneflow::OneFlowDialect>();
@@ -164,7 +172,7 @@ std::string lowerFuncToLLVMByte(const std::string& raw_byte, const StringAttr& d
       ::mlir::parseSourceString<mlir::ModuleOp>(raw_byte, &mlir_ctx);
   mlir::registerLLVMDialectTranslation(registry);
   if (::oneflow::ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
-  getLowerFunction(device_tag)(&mlir_ctx, *module);
+  lower(&mlir_ctx, *module);
   if (::oneflow::ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
   (*module)->setAttr(jit::RAW_GRAPH, StringAttr::get(&mlir_ctx, raw_byte));
 
@@ -174,6 +182,142 @@ std::string lowerFuncToLLVMByte(const std::string& raw_byte, const StringAttr& d
   return byte;
 }
 
+std::string lowerFuncToLLVMByte(const std::string& raw_byte, const StringAttr& device_tag) {
+  return lowerFuncToLLVMByte(raw_byte, getLowerFunction(device_tag));
+}
+
+// Cached functions are lowered under this name, which is replaced with the name of the jit op
+// after loading.
+constexpr llvm::StringLiteral kCachedJitFuncName = "oneflow_cached_jit_func";
+// Bump it when the host lowering pipeline changes, so that modules lowered before are not reused.
+constexpr int kJitCacheVersion = 1;
+
+// Returns the function without what differs between processes and graphs: its name, the op names,
+// the scope symbol ids and the locations.
+std::string canonicalizeFuncToByte(func::FuncOp function) {
+  func::FuncOp cloned = function.clone();
+  cloned.setSymName(kCachedJitFuncName);
+  auto unknownLoc = UnknownLoc::get(function->getContext());
+  int64_t opIndex = 0;
+  cloned->walk([&](Operation* op) {
+    op->setLoc(unknownLoc);
+    for (Region& region : op->getRegions()) {
+      for (Block& block : region) {
+        for (BlockArgument arg : block.getArguments()) { arg.setLoc(unknownLoc); }
+      }
+    }
+    if (op->hasAttr("op_name")) {
+      op->setAttr("op_name", StringAttr::get(op->getContext(), "op" + std::to_string(opIndex++)));
+    }
+    if (auto scope = op->getAttrOfType<IntegerAttr>("scope_symbol_id")) {
+      op->setAttr("scope_symbol_id", IntegerAttr::get(scope.getType(), 0));
+    }
+  });
+  std::string byte = convertFuncToByte(cloned);
+  cloned.erase();
+  return byte;
+}
+
+// Gives the symbols of a cached module the name of the jit op and attaches the raw graph of the op.
+std::string renameCachedJitFunc(const std::string& cached_byte, StringRef name,
+                                const std::string& raw_byte) {
+  mlir::DialectRegistry registry;
+  mlir::registerAllDialects(registry);
+  registry.insert<mlir::oneflow::OneFlowDialect>();
+  mlir::MLIRContext mlir_ctx(registry);
+  mlir::OwningOpRef<mlir::ModuleOp> module =
+      ::mlir::parseSourceString<mlir::ModuleOp>(cached_byte, &mlir_ctx);
+  CHECK(module) << "fail to parse the cached jit module of " << name.str();
+  for (Operation& op : module->getBody()->getOperations()) {
+    auto symbol = op.getAttrOfType<StringAttr>(SymbolTable::getSymbolAttrName());
+    if (!symbol) { continue; }
+    std::string newName = symbol.getValue().str();
+    const size_t pos = newName.find(kCachedJitFuncName.str());
+    if (pos == std::string::npos) { continue; }
+    newName.replace(pos, kCachedJitFuncName.size(), name.str());
+    CHECK(succeeded(
+        SymbolTable::replaceAllSymbolUses(&op, StringAttr::get(&mlir_ctx, newName), *module)));
+    SymbolTable::setSymbolName(&op, newName);
+  }
+  (*module)->setAttr(jit::RAW_GRAPH, StringAttr::get(&mlir_ctx, raw_byte));
+
+  std::string byte;
+  llvm::raw_string_ostream os_byte(byte);
+  mlir::writeBytecodeToFile(*module, os_byte);
+  return byte;
+}
+
+// The lowered modules are kept in ONEFLOW_MLIR_JIT_CACHE_DIR if it is set. The key is the hash of
+// the canonicalized function, whose tensor types carry the shapes, together with the cache and
+// LLVM versions.
+std::string lowerFuncToHostLLVMByteWithCache(func::FuncOp function, const std::string& raw_byte) {
+  auto lower = [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
+    CHECK(mlir::succeeded(mlir::oneflow::LowerModuleToHostLLVM(mlir_ctx, module)))
+        << "fail to lower OneFlow to host LLVM";
+  };
+  const std::string cache_dir = ::oneflow::GetStringFromEnv("ONEFLOW_MLIR_JIT_CACHE_DIR", "");
+  if (cache_dir.empty()) { return lowerFuncToLLVMByte(raw_byte, lower); }
+  const std::string canonical_byte = canonicalizeFuncToByte(function);
+  const std::string key = canonical_byte + "\n" + std::to_string(kJitCacheVersion) + "\n"
+                          + LLVM_VERSION_STRING;
+  llvm::SmallString<128> path(cache_dir);
+  llvm::sys::path::append(path, llvm::formatv("{0:x-16}.mlirbc", llvm::xxHash64(key)).str());
+  if (auto cached = llvm::MemoryBuffer::getFile(path)) {
+    return renameCachedJitFunc((*cached)->getBuffer().str(), function.getSymName(), raw_byte);
+  }
+  std::string byte = lowerFuncToLLVMByte(canonical_byte, lower);
+  // write to a unique file then rename it, so that other processes never read a partial module
+  llvm::SmallString<128> tmp_path;
+  int fd = -1;
+  if (!llvm::sys::fs::create_directories(cache_dir)
+      && !llvm::sys::fs::createUniqueFile(Twine(path) + ".%%%%%%", fd, tmp_path)) {
+    {
+      llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+      os << byte;
+    }
+    if (llvm::sys::fs::rename(tmp_path, path)) { (void)llvm::sys::fs::remove(tmp_path); }
+  }
+  return renameCachedJitFunc(byte, function.getSymName(), raw_byte);
+}
+
+bool isCpuFusibleOp(Operation* op) {
+  if (!llvm::isa<CastOp, ScalarMulByTensorOp, ReluOp, BroadcastAddOp, Add2Op, SoftmaxOp>(op)) {
+    return false;
+  }
+  if (OpTrait::IsOpConfCompatible<void>::getDeviceTag(op).getValue() != "cpu") { return false; }
+  // the cpu jit kernel is registered for floating outputs and takes static shapes only
+  auto isSupported = [](Type type) {
+    auto tensor = type.dyn_cast<RankedTensorType>();
+    return tensor && tensor.hasStaticShape()
+           && (tensor.getElementType().isF32() || tensor.getElementType().isF64());
+  };
+  return llvm::all_of(op->getOperandTypes(), isSupported)
+         && llvm::all_of(op->getResultTypes(), isSupported);
+}
+
+// An op joins the region if it consumes a value of the region and all of its other operands are
+// defined before the region, so that the jit op can take the place of the first op of the region
+// without creating a cycle.
+bool canJoinRegion(Operation* op, ArrayRef<Operation*> region,
+                   const llvm::DenseSet<Operation*>& regionOps) {
+  if (region.empty()) { return false; }
+  Operation* front = region.front();
+  if (OpTrait::IsOpConfCompatible<void>::getDeviceName(op)
+      != OpTrait::IsOpConfCompatible<void>::getDeviceName(front)) {
+    return false;
+  }
+  bool consumesRegion = false;
+  for (auto operand : op->getOperands()) {
+    auto defOp = operand.getDefiningOp();
+    if (defOp && regionOps.contains(defOp)) {
+      consumesRegion = true;
+    } else if (defOp && !defOp->isBeforeInBlock(front)) {
+      return false;
+    }
+  }
+  return consumesRegion;
+}
+
 }  // namespace
 
 class OutlineJitFunctionPass : public OutlineJitFunctionPassBase<OutlineJitFunctionPass> {
@@ -259,12 +403,94 @@ class OutlineJitFunctionPass : public OutlineJitFunctionPassBase<OutlineJitFunct
   }
 };
 
+class OutlineCpuFusibleOpsPass : public OutlineCpuFusibleOpsPassBase<OutlineCpuFusibleOpsPass> {
+  void runOnOperation() override {
+    FunctionOpInterface job = getOperation();
+    SmallVector<SmallVector<Operation*, 8>, 4> regions;
+    SmallVector<Operation*, 8> region;
+    llvm::DenseSet<Operation*> regionOps;
+    for (auto& op : job.getFunctionBody().front().getOperations()) {
+      if (!isCpuFusibleOp(&op)) { continue; }
+      if (!canJoinRegion(&op, region, regionOps)) {
+        if (static_cast<int>(region.size()) >= minRegionSize) { regions.push_back(region); }
+        region.clear();
+        regionOps.clear();
+      }
+      region.push_back(&op);
+      regionOps.insert(&op);
+    }
+    if (static_cast<int>(region.size()) >= minRegionSize) { regions.push_back(region); }
+    for (const auto& ops : regions) {
+      if (failed(outline(job, ops))) {
+        signalPassFailure();
+        return;
+      }
+    }
+  }
+
+  LogicalResult outline(FunctionOpInterface job, ArrayRef<Operation*> ops) {
+    Operation* front = ops.front();
+    llvm::DenseSet<Operation*> regionOps(ops.begin(), ops.end());
+    OpBuilder builder{&getContext()};
+    auto block = new Block();
+    builder.setInsertionPointToStart(block);
+    IRMapping mapping;
+    SmallVector<::mlir::Value, 4> entries, exits, mappedExits;
+    SmallVector<Type, 4> argumentTypes, resultTypes;
+    for (auto op : ops) {
+      for (auto operand : op->getOperands()) {
+        if (mapping.contains(operand)) { continue; }
+        entries.push_back(operand);
+        argumentTypes.push_back(operand.getType());
+        mapping.map(operand, block->addArgument(operand.getType(), operand.getLoc()));
+      }
+      builder.clone(*op, mapping);
+      for (auto result : op->getResults()) {
+        if (llvm::any_of(result.getUsers(),
+                         [&](Operation* user) { return !regionOps.contains(user); })) {
+          exits.push_back(result);
+          mappedExits.push_back(mapping.lookup(result));
+          resultTypes.push_back(result.getType());
+        }
+      }
+    }
+    builder.create<func::ReturnOp>(front->getLoc(), mappedExits);
+
+    auto mod = job->getParentOfType<ModuleOp>();
+    if (!mod) { return job->emitError() << "fail to outline"; }
+    auto name = JITOpNamePrefix + std::to_string(getCountJITFunction());
+    SmallString<16> tempBuffer;
+    name = SanitizeIdentifier(name, tempBuffer);
+    builder.setInsertionPointToStart(&mod.getRegion().front());
+    auto function = builder.create<func::FuncOp>(
+        front->getLoc(), name, builder.getFunctionType(argumentTypes, resultTypes));
+    function.getBody().push_front(block);
+
+    builder.setInsertionPoint(front);
+    NamedAttrList attributes =
+        GetJitOpAttributes(builder, name, argumentTypes.size(), resultTypes.size(), front);
+    std::string byte = convertFuncToByte(function);
+    if (compileToLLVM.getValue()) { byte = lowerFuncToHostLLVMByteWithCache(function, byte); }
+    auto jitOp = builder.create<MlirJitOp>(front->getLoc(), function, attributes, entries);
+    jitOp->setAttr("mlir_assembly", builder.getStringAttr(byte));
+    for (const auto& old : llvm::enumerate(exits)) {
+      old.value().replaceAllUsesWith(jitOp->getResult(old.index()));
+    }
+    for (auto op : llvm::reverse(ops)) { op->erase(); }
+    return success();
+  }
+};
+
 }  // namespace
 
 std::unique_ptr<Pass> createOutlineJitFunctionPass() {
   return std::make_unique<OutlineJitFunctionPass>();
 }
 
+std::unique_ptr<Pass> createOutlineCpuFusibleOpsPass() {
+  return std::make_unique<OutlineCpuFusibleOpsPass>();
+}
+
 }  // namespace oneflow
 
 }  // namespace mlir
@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "OneFlow/Passes.h"
+#include "mlir/Dialect/Linalg/Transforms/Transforms.h"
+#include "mlir/Dialect/Linalg/Utils/Utils.h"
+#include "mlir/IR/PatternMatch.h"
+
+#include <optional>
+
+namespace mlir {
+namespace oneflow {
+
+namespace {
+
+// Every parallel loop but the innermost one is tiled by 1, so that the innermost tile is a
+// contiguous row of vectorWidth elements. Reduction loops are kept whole.
+std::optional<SmallVector<int64_t, 4>> getTileSizes(linalg::LinalgOp op, int64_t vectorWidth) {
+  SmallVector<int64_t, 4> ranges = op.getStaticLoopRanges();
+  SmallVector<utils::IteratorType> iterators = op.getIteratorTypesArray();
+  if (ranges.empty() || !linalg::isParallelIterator(iterators.back())) { return std::nullopt; }
+  if (ranges.back() % vectorWidth != 0) { return std::nullopt; }
+  SmallVector<int64_t, 4> tileSizes(ranges.size(), 0);
+  for (size_t i = 0; i + 1 < ranges.size(); ++i) {
+    if (linalg::isParallelIterator(iterators[i])) { tileSizes[i] = 1; }
+  }
+  tileSizes.back() = vectorWidth;
+  return tileSizes;
+}
+
+class TileAndVectorizeLinalgPass
+    : public TileAndVectorizeLinalgPassBase<TileAndVectorizeLinalgPass> {
+  void runOnOperation() override {
+    SmallVector<linalg::LinalgOp, 4> targets;
+    getOperation().walk([&](linalg::LinalgOp op) {
+      if (op.hasBufferSemantics() && !op.hasDynamicShape()) { targets.push_back(op); }
+    });
+    IRRewriter rewriter(&getContext());
+    for (auto op : targets) {
+      // the ops left untouched are lowered to scalar loops, which llvm may still vectorize
+      auto tileSizes = getTileSizes(op, vectorWidth);
+      if (!tileSizes) { continue; }
+      rewriter.setInsertionPoint(op);
+      auto options = linalg::LinalgTilingOptions().setTileSizes(*tileSizes);
+      auto tiled = linalg::tileLinalgOp(rewriter, op, options);
+      if (failed(tiled)) { continue; }
+      rewriter.eraseOp(op);
+      (void)linalg::vectorize(rewriter, tiled->op);
+    }
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<Pass> createTileAndVectorizeLinalgPass() {
+  return std::make_unique<TileAndVectorizeLinalgPass>();
+}
+
+}  // namespace oneflow
+}  // namespace mlir
@@ -30,8 +30,10 @@ limitations under the License.
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/ExecutionEngine/MemRefUtils.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
 #include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
 #include "mlir/Target/LLVMIR/Dialect/Builtin/BuiltinToLLVMIRTranslation.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/Support/TargetSelect.h"
 
 namespace oneflow {
@@ -113,12 +115,28 @@ mlir::DialectRegistry getDialectRegistry() {
   return registry;
 }
 
-void WithMlirContext(
-    user_op::KernelComputeContext* ctx, const llvm::SmallVector<llvm::StringRef, 4>& ext_libs,
-    const std::function<mlir::OwningOpRef<mlir::ModuleOp>(mlir::MLIRContext* mlir_ctx)>& parse,
-    void* stream) {
+// Building the machine code of a module costs much more than running it, so it is done once per
+// kernel instead of once per launch.
+class MlirJitKernelState final : public user_op::OpKernelState {
+ public:
+  explicit MlirJitKernelState(std::unique_ptr<mlir::ExecutionEngine>&& engine)
+      : engine_(std::move(engine)) {}
+  ~MlirJitKernelState() override = default;
+
+  mlir::ExecutionEngine* engine() const { return engine_.get(); }
+
+ private:
+  std::unique_ptr<mlir::ExecutionEngine> engine_;
+};
+
+std::shared_ptr<user_op::OpKernelState> CreateMlirJitKernelState(
+    user_op::KernelInitContext* ctx) {
+  llvm::SmallVector<llvm::StringRef, 4> ext_libs(
+      {SharedLibPaths()->begin(), SharedLibPaths()->end()});
   mlir::MLIRContext mlir_ctx(getDialectRegistry());
-  mlir::OwningOpRef<mlir::ModuleOp> module = parse(&mlir_ctx);
+  const auto& mlir_assembly = ctx->Attr<std::vector<char>>("mlir_assembly");
+  mlir::OwningOpRef<mlir::ModuleOp> module = mlir::parseSourceString<mlir::ModuleOp>(
+      llvm::StringRef(mlir_assembly.data(), mlir_assembly.size() - 1), &mlir_ctx);
   CHECK(module) << "fail to parse MLIR, op: " << ctx->op_name();
   if (ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
 
@@ -126,17 +144,37 @@ void WithMlirContext(
   jitOptions.transformer = {};
   jitOptions.jitCodeGenOptLevel = std::nullopt;
   jitOptions.sharedLibPaths = ext_libs;
+  // on cpu, optimize the module for the host so that llvm vectorizes the loops left scalar
+  std::unique_ptr<llvm::TargetMachine> target_machine;
+  if (ctx->device_type() == DeviceType::kCPU) {
+    auto builder_or_error = llvm::orc::JITTargetMachineBuilder::detectHost();
+    CHECK(!!builder_or_error) << "fail to detect the host, "
+                              << llvm::toString(builder_or_error.takeError());
+    auto target_machine_or_error = builder_or_error->createTargetMachine();
+    CHECK(!!target_machine_or_error) << "fail to create the target machine, "
+                                     << llvm::toString(target_machine_or_error.takeError());
+    target_machine = std::move(target_machine_or_error.get());
+    jitOptions.transformer = mlir::makeOptimizingTransformer(
+        /*optLevel=*/3, /*sizeLevel=*/0, target_machine.get());
+    jitOptions.jitCodeGenOptLevel = llvm::CodeGenOpt::Aggressive;
+  }
 
   auto jit_or_error = mlir::ExecutionEngine::create(*module, jitOptions);
   CHECK(!!jit_or_error) << "failed to create JIT exe engine, "
                         << llvm::toString(jit_or_error.takeError());
-  auto jit = std::move(jit_or_error.get());
+  return std::make_shared<MlirJitKernelState>(std::move(jit_or_error.get()));
+}
+
+void InvokeMlirJit(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+                   void* stream) {
+  auto* jit_state = dynamic_cast<MlirJitKernelState*>(state);
+  CHECK_NOTNULL(jit_state);
   llvm::SmallVector<OpaqueMemRefDescriptor> args /* args must outlive JIT invocation */ =
       GetMLIRCInterfaceArgs(ctx);
   llvm::SmallVector<void*> packed_args{};
   for (auto& arg /* arg must be a reference*/ : args) { packed_args.push_back(&arg); }
   packed_args.push_back(&stream);
-  auto error = jit->invokePacked(GetMLIRCInterface(ctx->op_name()), packed_args);
+  auto error = jit_state->engine()->invokePacked(GetMLIRCInterface(ctx->op_name()), packed_args);
   CHECK(!error) << "fail to invoke jit engine, error: " << llvm::toString(std::move(error));
 }
 
@@ -164,17 +202,14 @@ class MlirJitCpuKernel final : public user_op::OpKernel {
   ~MlirJitCpuKernel() = default;
 
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          auto mlir_assembly = ctx->Attr<std::vector<char>>("mlir_assembly");
-          return mlir::parseSourceString<mlir::ModuleOp>(
-              llvm::StringRef(mlir_assembly.data(), mlir_assembly.size() - 1), mlir_ctx);
-        },
-        nullptr);
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateMlirJitKernelState(ctx);
+  }
+
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    InvokeMlirJit(ctx, state, nullptr);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -206,20 +241,18 @@ class MlirJitGpuKernel final : public user_op::OpKernel {
   ~MlirJitGpuKernel() = default;
 
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          auto mlir_assembly = ctx->Attr<std::vector<char>>("mlir_assembly");
-          return mlir::parseSourceString<mlir::ModuleOp>(
-              llvm::StringRef(mlir_assembly.data(), mlir_assembly.size() - 1), mlir_ctx);
-        },
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateMlirJitKernelState(ctx);
+  }
+
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    InvokeMlirJit(ctx, state,
 #ifdef WITH_CUDA
-        ctx->stream()->As<ep::CudaStream>()->cuda_stream());
+                  ctx->stream()->As<ep::CudaStream>()->cuda_stream());
 #else
-        nullptr);
+                  nullptr);
 #endif  // WITH_CUDA
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -33,6 +33,10 @@ Operation* getEntryJobOp(Operation* op);
 
 StringAttr getValueDevice(Value value);
 
+// Returns true if the value is a variable placed on host, which is serialized as
+// a ParameterDef and mapped by the runtime instead of being memory planned.
+bool isHostParameterValue(Value value);
+
 Optional<StringRef> getLiteStringElementType(Type type);
 Optional<StringRef> getLiteStringElementType(::mlir::oneflow::DataType type);
 
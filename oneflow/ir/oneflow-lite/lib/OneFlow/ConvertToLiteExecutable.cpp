@@ -200,6 +200,44 @@ static oneflow_lite_OpDef_ref_t createLiteVariableOpDef(
   return oneflow_lite_OpDef_end(builder);
 }
 
+static oneflow_lite_ParameterDef_ref_t createLiteParameterDef(FlatbufferBuilder& builder,
+                                                              VariableOp op,
+                                                              StringRef checkpointDir) {
+  TensorType type = op.getOutput().getType().cast<TensorType>();
+  auto elemType = getLiteStringElementType(type.getElementType());
+  if (!elemType) {
+    llvm::errs() << "error tensor element type: " << type.getElementType() << "\n";
+    exit(1);
+  }
+  llvm::SmallString<128> inputFilename;
+  llvm::sys::path::native(checkpointDir + "/" + op.getOpName() + "/out", inputFilename);
+  std::string errorMessage;
+  auto input = mlir::openInputFile(inputFilename, &errorMessage);
+  if (!input) {
+    llvm::errs() << errorMessage << "\n";
+    exit(1);
+  }
+  size_t expectedSize = type.getNumElements() * type.getElementTypeBitWidth() / 8;
+  if (input->getBufferSize() != expectedSize) {
+    llvm::errs() << "size of " << inputFilename << " is " << input->getBufferSize()
+                 << " bytes, but " << expectedSize << " bytes are expected\n";
+    exit(1);
+  }
+  oneflow_lite_ParameterDef_start(builder);
+  oneflow_lite_ParameterDef_type_add(builder, builder.createString(elemType.value()));
+  oneflow_lite_ParameterDef_sizes_add(builder, builder.createInt64Vec(type.getShape()));
+  // align the buffer to a cache line so that it can be used directly from the mapped file
+  auto buffer = builder.streamUint8Vec(
+      [&](llvm::raw_ostream& stream) {
+        stream << input->getBuffer();
+        stream.flush();
+        return true;
+      },
+      /*alignment=*/64);
+  oneflow_lite_ParameterDef_buffer_add(builder, buffer);
+  return oneflow_lite_ParameterDef_end(builder);
+}
+
 static oneflow_lite_OpDef_ref_t createLiteOpDef(
     FlatbufferBuilder& builder, Operation* op, llvm::DenseMap<Value, int>& valueOrdering,
     const llvm::DenseMap<StringRef, int>& deviceOrdering) {
@@ -235,7 +273,8 @@ static oneflow_lite_OpDef_ref_t createLiteOpDef(
 }
 
 static oneflow_lite_TensorDef_ref_t createLiteTensorDef(FlatbufferBuilder& builder, Value value,
-                                                        int segmentId, size_t segmentOffset) {
+                                                        int segmentId, size_t segmentOffset,
+                                                        int parameterId) {
   TensorType type = value.getType().cast<TensorType>();
   oneflow_lite_TensorDef_start(builder);
   auto elemType = getLiteStringElementType(type.getElementType());
@@ -250,6 +289,7 @@ static oneflow_lite_TensorDef_ref_t createLiteTensorDef(FlatbufferBuilder& build
                                      builder.createInt64Vec(llvm::SmallVector<int64_t, 4>{}));
   oneflow_lite_TensorDef_segment_id_add(builder, segmentId);
   oneflow_lite_TensorDef_segment_offset_add(builder, segmentOffset);
+  oneflow_lite_TensorDef_parameter_id_add(builder, parameterId);
   return oneflow_lite_TensorDef_end(builder);
 }
 
@@ -310,6 +350,8 @@ LogicalResult ConvertToLiteExecutable(MLIRContext* context, ModuleOp module, Con
   llvm::SmallVector<int, 4> inputValueOrdering, outputValueOrdering;
   llvm::SmallVector<StringRef, 4> inputValueNames, outputValueNames;
   llvm::SmallVector<oneflow_lite_OpDef_ref_t, 4> opDefs;
+  llvm::SmallVector<oneflow_lite_ParameterDef_ref_t, 4> parameterDefs;
+  llvm::DenseMap<Value, int> valueParameters;
 
   entryJobOp->walk([&](Operation* op) {
     if (!op->hasTrait<OpTrait::IsOpConfCompatible>()) { return; }
@@ -326,6 +368,13 @@ LogicalResult ConvertToLiteExecutable(MLIRContext* context, ModuleOp module, Con
           op->getAttrOfType<StringAttr>(OpTrait::IsOpConfCompatible<void>::getOpNameAttr())
               .getValue());
     } else if (auto variableOp = llvm::dyn_cast<VariableOp>(op)) {
+      if (isHostParameterValue(variableOp.getOutput())) {
+        valueOrdering.try_emplace(variableOp.getOutput(), valueOrdering.size());
+        valueParameters[variableOp.getOutput()] = parameterDefs.size();
+        parameterDefs.push_back(
+            createLiteParameterDef(builder, variableOp, options.checkpointDir));
+        return;
+      }
       opDefs.push_back(createLiteVariableOpDef(builder, variableOp, valueOrdering, deviceOrdering,
                                                options.checkpointDir));
     } else {
@@ -340,7 +389,10 @@ LogicalResult ConvertToLiteExecutable(MLIRContext* context, ModuleOp module, Con
   for (auto value : orderedValues) {
     int segmentId = bufferStrategy.getValueSegmentId(value);
     size_t segmentOffset = bufferStrategy.getValueSegmentOffset(value);
-    tensorDefs.push_back(createLiteTensorDef(builder, value, segmentId, segmentOffset));
+    auto it = valueParameters.find(value);
+    int parameterId = it == valueParameters.end() ? -1 : it->second;
+    tensorDefs.push_back(
+        createLiteTensorDef(builder, value, segmentId, segmentOffset, parameterId));
   }
   oneflow_lite_ExecutableDef_operands_add(builder, builder.createOffsetVecDestructive(tensorDefs));
 
@@ -354,6 +406,8 @@ LogicalResult ConvertToLiteExecutable(MLIRContext* context, ModuleOp module, Con
     segmentDefs.push_back(createLiteBufferSegmentDef(builder, segment, deviceOrdering));
   }
   oneflow_lite_ExecutableDef_segments_add(builder, builder.createOffsetVecDestructive(segmentDefs));
+  oneflow_lite_ExecutableDef_parameters_add(builder,
+                                            builder.createOffsetVecDestructive(parameterDefs));
 
   oneflow_lite_ExecutableDef_end_as_root(builder);
 
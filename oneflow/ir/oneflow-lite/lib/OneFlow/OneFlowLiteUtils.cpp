@@ -71,6 +71,11 @@ StringAttr getValueDevice(Value value) {
   return device;
 }
 
+bool isHostParameterValue(Value value) {
+  auto variableOp = value.getDefiningOp<VariableOp>();
+  return variableOp && variableOp.getDeviceTag() == "host";
+}
+
 Optional<StringRef> getLiteStringElementType(Type type) {
   assert(type.isIntOrFloat());
   if (type.isF16()) {
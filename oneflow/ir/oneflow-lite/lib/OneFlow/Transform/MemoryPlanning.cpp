@@ -63,8 +63,8 @@ class ValueLiveness {
   bool isLivenessOverlap(Value lhs, Value rhs) {
     LiveRange lhs_liveness = liveness[lhs];
     LiveRange rhs_liveness = liveness[rhs];
-    return lhs_liveness.liveEnd < rhs_liveness.liveStart
-           || lhs_liveness.liveStart > rhs_liveness.liveEnd;
+    return lhs_liveness.liveStart <= rhs_liveness.liveEnd
+           && rhs_liveness.liveStart <= lhs_liveness.liveEnd;
   }
 
  private:
@@ -152,8 +152,11 @@ void MemoryPlanningPass::computeValueSizeAndSort() {
     valueList.insert(op->getOperands().begin(), op->getOperands().end());
     valueList.insert(op->getResults().begin(), op->getResults().end());
   });
+  // host parameters are mapped from the executable and need no buffer
+  valueList.remove_if([](Value value) { return isHostParameterValue(value); });
   sortedValues = valueList.takeVector();
-  llvm::sort(sortedValues.begin(), sortedValues.end(), [](Value lhs, Value rhs) {
+  // values of the same size keep the program order, so that the plan is deterministic
+  llvm::stable_sort(sortedValues, [](Value lhs, Value rhs) {
     assert(lhs.getType().isa<TensorType>());
     assert(rhs.getType().isa<TensorType>());
     return getTensorBitSize(lhs.getType().cast<TensorType>())
@@ -180,6 +183,7 @@ void MemoryPlanningPass::doMemoryPlanning() {
       if (canShareMemoryWithBlock(value, block)) {
         block.push_back(value);
         shared = true;
+        break;
       }
     }
     if (!shared) { memoryBlocks.push_back(llvm::SmallVector<Value, 4>{value}); }
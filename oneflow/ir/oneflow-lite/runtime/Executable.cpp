@@ -0,0 +1,66 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "runtime/Executable.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#include "flatcc/flatcc_verifier.h"
+#pragma GCC diagnostic pop
+
+namespace oneflow_lite {
+
+Executable::Executable(void* data, size_t size)
+    : data_(data), size_(size), def_(oneflow_lite_ExecutableDef_as_root(data)) {}
+
+Executable::~Executable() { munmap(data_, size_); }
+
+Status Executable::Load(const std::string& path, std::shared_ptr<const Executable>* executable) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) { return Status::Error("failed to open " + path + ": " + strerror(errno)); }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int err = errno;
+    close(fd);
+    return Status::Error("failed to stat " + path + ": " + strerror(err));
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  if (size == 0) {
+    close(fd);
+    return Status::Error(path + " is empty");
+  }
+  // pages are faulted in on first touch, so parameters that are never read cost nothing
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int err = errno;
+  close(fd);
+  if (data == MAP_FAILED) { return Status::Error("failed to map " + path + ": " + strerror(err)); }
+
+  int ret = oneflow_lite_ExecutableDef_verify_as_root(data, size);
+  if (ret != flatcc_verify_ok) {
+    munmap(data, size);
+    return Status::Error(path + " is not a valid executable: " + flatcc_verify_error_string(ret));
+  }
+  executable->reset(new Executable(data, size));
+  return Status::OK();
+}
+
+}  // namespace oneflow_lite
@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_EXECUTABLE_H_
+#define ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_EXECUTABLE_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "runtime/Status.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#include "schemas/executable_generated.h"
+#pragma GCC diagnostic pop
+
+namespace oneflow_lite {
+
+// A read-only executable mapped from a file produced by oneflow-lite-compile. Parameter
+// buffers are used in place, so the mapping must outlive every session created from it.
+class Executable final {
+ public:
+  Executable(const Executable&) = delete;
+  Executable& operator=(const Executable&) = delete;
+  ~Executable();
+
+  static Status Load(const std::string& path, std::shared_ptr<const Executable>* executable);
+
+  oneflow_lite_ExecutableDef_table_t def() const { return def_; }
+  size_t size() const { return size_; }
+
+ private:
+  Executable(void* data, size_t size);
+
+  void* data_;
+  size_t size_;
+  oneflow_lite_ExecutableDef_table_t def_;
+};
+
+}  // namespace oneflow_lite
+
+#endif  // ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_EXECUTABLE_H_
@@ -0,0 +1,451 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "runtime/Kernel.h"
+
+// Reference host kernels. They cover the ops of common MLP and CNN inference graphs in f32;
+// data movement ops such as reshape work on any data type.
+
+namespace oneflow_lite {
+
+namespace {
+
+Status CheckArity(const KernelContext& ctx, size_t min_inputs, size_t num_outputs) {
+  LITE_CHECK_OR_RETURN(ctx.inputs.size() >= min_inputs,
+                       "expects at least " + std::to_string(min_inputs) + " inputs, but got "
+                           + std::to_string(ctx.inputs.size()));
+  LITE_CHECK_OR_RETURN(ctx.outputs.size() == num_outputs,
+                       "expects " + std::to_string(num_outputs) + " outputs, but got "
+                           + std::to_string(ctx.outputs.size()));
+  return Status::OK();
+}
+
+Status CheckF32(const KernelContext& ctx) {
+  for (const Tensor* tensor : ctx.inputs) {
+    LITE_CHECK_OR_RETURN(tensor->dtype == DataType::kF32,
+                         std::string("only f32 is supported, but got ")
+                             + DataTypeName(tensor->dtype));
+  }
+  for (const Tensor* tensor : ctx.outputs) {
+    LITE_CHECK_OR_RETURN(tensor->dtype == DataType::kF32,
+                         std::string("only f32 is supported, but got ")
+                             + DataTypeName(tensor->dtype));
+  }
+  return Status::OK();
+}
+
+// identity, reshape, flatten, expand_dims and squeeze only change the shape
+Status CopyKernel(const KernelContext& ctx) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 1, 1));
+  const Tensor* in = ctx.inputs[0];
+  Tensor* out = ctx.outputs[0];
+  LITE_CHECK_OR_RETURN(in->nbytes() == out->nbytes(),
+                       "can not copy " + ShapeToString(in->shape) + " to "
+                           + ShapeToString(out->shape));
+  if (in->data != out->data) { memcpy(out->data, in->data, out->nbytes()); }
+  return Status::OK();
+}
+
+// variables of executables compiled for other devices are embedded as constant ops
+Status ConstantKernel(const KernelContext& ctx) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 0, 1));
+  size_t size = 0;
+  const void* value = ctx.attrs.GetBytes("value", &size);
+  LITE_CHECK_OR_RETURN(value, "constant has no value");
+  LITE_CHECK_OR_RETURN(size == ctx.outputs[0]->nbytes(),
+                       "constant has " + std::to_string(size) + " bytes, but the output needs "
+                           + std::to_string(ctx.outputs[0]->nbytes()));
+  memcpy(ctx.outputs[0]->data, value, size);
+  return Status::OK();
+}
+
+template<typename F>
+Status UnaryKernel(const KernelContext& ctx, F f) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 1, 1));
+  LITE_RETURN_IF_ERROR(CheckF32(ctx));
+  const Tensor* in = ctx.inputs[0];
+  Tensor* out = ctx.outputs[0];
+  LITE_CHECK_OR_RETURN(in->elem_cnt() == out->elem_cnt(), "input and output sizes mismatch");
+  const float* x = in->ptr<float>();
+  float* y = out->ptr<float>();
+  const int64_t n = out->elem_cnt();
+  for (int64_t i = 0; i < n; ++i) { y[i] = f(x[i]); }
+  return Status::OK();
+}
+
+Status ReluKernel(const KernelContext& ctx) {
+  return UnaryKernel(ctx, [](float x) { return x > 0.f ? x : 0.f; });
+}
+
+Status SigmoidKernel(const KernelContext& ctx) {
+  return UnaryKernel(ctx, [](float x) { return 1.f / (1.f + expf(-x)); });
+}
+
+Status TanhKernel(const KernelContext& ctx) {
+  return UnaryKernel(ctx, [](float x) { return tanhf(x); });
+}
+
+Status GeluKernel(const KernelContext& ctx) {
+  return UnaryKernel(ctx, [](float x) { return 0.5f * x * (1.f + erff(x * float(M_SQRT1_2))); });
+}
+
+Status SiluKernel(const KernelContext& ctx) {
+  return UnaryKernel(ctx, [](float x) { return x / (1.f + expf(-x)); });
+}
+
+float GetScalarOperand(const OpAttrs& attrs) {
+  if (attrs.GetBool("has_float_operand", false)) {
+    return static_cast<float>(attrs.GetFloat("float_operand", 0.0));
+  }
+  return static_cast<float>(attrs.GetInt("int_operand", 0));
+}
+
+Status ScalarAddKernel(const KernelContext& ctx) {
+  const float operand = GetScalarOperand(ctx.attrs);
+  return UnaryKernel(ctx, [operand](float x) { return x + operand; });
+}
+
+Status ScalarMulKernel(const KernelContext& ctx) {
+  const float operand = GetScalarOperand(ctx.attrs);
+  return UnaryKernel(ctx, [operand](float x) { return x * operand; });
+}
+
+// Strides of |tensor| broadcast to |shape|, 0 for broadcast dimensions.
+Status GetBroadcastStrides(const Tensor& tensor, const std::vector<int64_t>& shape,
+                           std::vector<int64_t>* strides) {
+  const int64_t ndim = shape.size();
+  const int64_t offset = ndim - static_cast<int64_t>(tensor.shape.size());
+  LITE_CHECK_OR_RETURN(offset >= 0, "can not broadcast " + ShapeToString(tensor.shape) + " to "
+                                        + ShapeToString(shape));
+  strides->assign(ndim, 0);
+  int64_t stride = 1;
+  for (int64_t d = ndim - 1; d >= offset; --d) {
+    const int64_t dim = tensor.shape[d - offset];
+    LITE_CHECK_OR_RETURN(dim == shape[d] || dim == 1, "can not broadcast "
+                                                          + ShapeToString(tensor.shape) + " to "
+                                                          + ShapeToString(shape));
+    if (dim != 1) { (*strides)[d] = stride; }
+    stride *= dim;
+  }
+  return Status::OK();
+}
+
+template<typename F>
+Status BroadcastBinaryKernel(const KernelContext& ctx, F f) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 2, 1));
+  LITE_RETURN_IF_ERROR(CheckF32(ctx));
+  const Tensor* lhs = ctx.inputs[0];
+  const Tensor* rhs = ctx.inputs[1];
+  Tensor* out = ctx.outputs[0];
+  const float* x = lhs->ptr<float>();
+  const float* y = rhs->ptr<float>();
+  float* z = out->ptr<float>();
+  const int64_t n = out->elem_cnt();
+  if (lhs->elem_cnt() == n && rhs->elem_cnt() == n) {
+    for (int64_t i = 0; i < n; ++i) { z[i] = f(x[i], y[i]); }
+    return Status::OK();
+  }
+  if (lhs->elem_cnt() == n && rhs->elem_cnt() == 1) {
+    const float y0 = y[0];
+    for (int64_t i = 0; i < n; ++i) { z[i] = f(x[i], y0); }
+    return Status::OK();
+  }
+  std::vector<int64_t> x_strides, y_strides;
+  LITE_RETURN_IF_ERROR(GetBroadcastStrides(*lhs, out->shape, &x_strides));
+  LITE_RETURN_IF_ERROR(GetBroadcastStrides(*rhs, out->shape, &y_strides));
+  const int64_t ndim = out->shape.size();
+  std::vector<int64_t> index(ndim, 0);
+  int64_t x_offset = 0;
+  int64_t y_offset = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    z[i] = f(x[x_offset], y[y_offset]);
+    for (int64_t d = ndim - 1; d >= 0; --d) {
+      x_offset += x_strides[d];
+      y_offset += y_strides[d];
+      if (++index[d] < out->shape[d]) { break; }
+      x_offset -= x_strides[d] * index[d];
+      y_offset -= y_strides[d] * index[d];
+      index[d] = 0;
+    }
+  }
+  return Status::OK();
+}
+
+Status BroadcastAddKernel(const KernelContext& ctx) {
+  return BroadcastBinaryKernel(ctx, [](float x, float y) { return x + y; });
+}
+
+Status BroadcastSubKernel(const KernelContext& ctx) {
+  return BroadcastBinaryKernel(ctx, [](float x, float y) { return x - y; });
+}
+
+Status BroadcastMulKernel(const KernelContext& ctx) {
+  return BroadcastBinaryKernel(ctx, [](float x, float y) { return x * y; });
+}
+
+Status BroadcastDivKernel(const KernelContext& ctx) {
+  return BroadcastBinaryKernel(ctx, [](float x, float y) { return x / y; });
+}
+
+Status AddNKernel(const KernelContext& ctx) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 1, 1));
+  LITE_RETURN_IF_ERROR(CheckF32(ctx));
+  Tensor* out = ctx.outputs[0];
+  const int64_t n = out->elem_cnt();
+  for (const Tensor* in : ctx.inputs) {
+    LITE_CHECK_OR_RETURN(in->elem_cnt() == n, "input and output sizes mismatch");
+  }
+  float* y = out->ptr<float>();
+  // the output may alias the first input, so accumulate into it in place
+  const float* x0 = ctx.inputs[0]->ptr<float>();
+  for (int64_t i = 0; i < n; ++i) { y[i] = x0[i]; }
+  for (size_t k = 1; k < ctx.inputs.size(); ++k) {
+    const float* x = ctx.inputs[k]->ptr<float>();
+    for (int64_t i = 0; i < n; ++i) { y[i] += x[i]; }
+  }
+  return Status::OK();
+}
+
+Status BiasAddKernel(const KernelContext& ctx) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 2, 1));
+  LITE_RETURN_IF_ERROR(CheckF32(ctx));
+  const Tensor* a = ctx.inputs[0];
+  const Tensor* b = ctx.inputs[1];
+  Tensor* out = ctx.outputs[0];
+  const int64_t ndim = a->shape.size();
+  int64_t axis = ctx.attrs.GetInt("axis", 0);
+  if (axis < 0) { axis += ndim; }
+  LITE_CHECK_OR_RETURN(axis >= 0 && axis < ndim, "axis " + std::to_string(axis)
+                                                     + " is out of range");
+  const int64_t channels = a->shape[axis];
+  LITE_CHECK_OR_RETURN(b->elem_cnt() == channels, "bias size mismatches");
+  int64_t outer = 1;
+  int64_t inner = 1;
+  for (int64_t d = 0; d < axis; ++d) { outer *= a->shape[d]; }
+  for (int64_t d = axis + 1; d < ndim; ++d) { inner *= a->shape[d]; }
+  const float* x = a->ptr<float>();
+  const float* bias = b->ptr<float>();
+  float* y = out->ptr<float>();
+  for (int64_t o = 0; o < outer; ++o) {
+    for (int64_t c = 0; c < channels; ++c) {
+      const int64_t offset = (o * channels + c) * inner;
+      for (int64_t i = 0; i < inner; ++i) { y[offset + i] = x[offset + i] + bias[c]; }
+    }
+  }
+  return Status::OK();
+}
+
+// c = alpha * op(a) * op(b) + beta * c, all matrices are row major.
+void Gemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k, float alpha,
+          const float* a, const float* b, float beta, float* c) {
+  for (int64_t i = 0; i < m; ++i) {
+    float* c_row = c + i * n;
+    if (beta == 0.f) {
+      std::fill(c_row, c_row + n, 0.f);
+    } else if (beta != 1.f) {
+      for (int64_t j = 0; j < n; ++j) { c_row[j] *= beta; }
+    }
+    if (trans_b) {
+      for (int64_t j = 0; j < n; ++j) {
+        const float* b_row = b + j * k;
+        float sum = 0.f;
+        for (int64_t p = 0; p < k; ++p) {
+          sum += (trans_a ? a[p * m + i] : a[i * k + p]) * b_row[p];
+        }
+        c_row[j] += alpha * sum;
+      }
+    } else {
+      // i-p-j order keeps the innermost loop contiguous so that it vectorizes
+      for (int64_t p = 0; p < k; ++p) {
+        const float a_ip = alpha * (trans_a ? a[p * m + i] : a[i * k + p]);
+        const float* b_row = b + p * n;
+        for (int64_t j = 0; j < n; ++j) { c_row[j] += a_ip * b_row[j]; }
+      }
+    }
+  }
+}
+
+Status MatmulKernel(const KernelContext& ctx) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 2, 1));
+  LITE_RETURN_IF_ERROR(CheckF32(ctx));
+  const Tensor* a = ctx.inputs[0];
+  const Tensor* b = ctx.inputs[1];
+  Tensor* out = ctx.outputs[0];
+  LITE_CHECK_OR_RETURN(a->shape.size() >= 2 && b->shape.size() >= 2,
+                       "matmul expects matrices, but got " + ShapeToString(a->shape) + " and "
+                           + ShapeToString(b->shape));
+  const bool trans_a = ctx.attrs.GetBool("transpose_a", false);
+  const bool trans_b = ctx.attrs.GetBool("transpose_b", false);
+  const float alpha = static_cast<float>(ctx.attrs.GetFloat("alpha", 1.0));
+  const size_t a_ndim = a->shape.size();
+  const size_t b_ndim = b->shape.size();
+  const int64_t m = trans_a ? a->shape[a_ndim - 1] : a->shape[a_ndim - 2];
+  const int64_t k = trans_a ? a->shape[a_ndim - 2] : a->shape[a_ndim - 1];
+  const int64_t b_k = trans_b ? b->shape[b_ndim - 1] : b->shape[b_ndim - 2];
+  const int64_t n = trans_b ? b->shape[b_ndim - 2] : b->shape[b_ndim - 1];
+  LITE_CHECK_OR_RETURN(k == b_k, "matmul reduces mismatched dimensions " + std::to_string(k)
+                                     + " and " + std::to_string(b_k));
+  // batched a with a shared b covers broadcast_matmul of linear layers, the batch sizes come
+  // from the leading dimensions so that empty matrices are fine
+  int64_t batch = 1;
+  for (size_t d = 0; d + 2 < a_ndim; ++d) { batch *= a->shape[d]; }
+  int64_t b_batch = 1;
+  for (size_t d = 0; d + 2 < b_ndim; ++d) { b_batch *= b->shape[d]; }
+  LITE_CHECK_OR_RETURN(b_batch == 1 || b_batch == batch,
+                       "can not broadcast " + ShapeToString(b->shape) + " to batch size "
+                           + std::to_string(batch));
+  LITE_CHECK_OR_RETURN(out->elem_cnt() == batch * m * n, "output size mismatches");
+  float beta = 0.f;
+  if (ctx.inputs.size() > 2) {
+    // _add_to_output
+    LITE_CHECK_OR_RETURN(ctx.inputs[2]->elem_cnt() == out->elem_cnt(),
+                         "add_to_output size mismatches");
+    if (ctx.inputs[2]->data != out->data) {
+      memcpy(out->data, ctx.inputs[2]->data, out->nbytes());
+    }
+    beta = 1.f;
+  }
+  for (int64_t i = 0; i < batch; ++i) {
+    Gemm(trans_a, trans_b, m, n, k, alpha, a->ptr<float>() + i * m * k,
+         b->ptr<float>() + (b_batch == 1 ? 0 : i * k * n), beta, out->ptr<float>() + i * m * n);
+  }
+  return Status::OK();
+}
+
+Status SoftmaxKernel(const KernelContext& ctx) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 1, 1));
+  LITE_RETURN_IF_ERROR(CheckF32(ctx));
+  const Tensor* in = ctx.inputs[0];
+  Tensor* out = ctx.outputs[0];
+  LITE_CHECK_OR_RETURN(!in->shape.empty(), "softmax expects at least 1 dimension");
+  const int64_t cols = in->shape.back();
+  const int64_t rows = cols == 0 ? 0 : in->elem_cnt() / cols;
+  for (int64_t r = 0; r < rows; ++r) {
+    const float* x = in->ptr<float>() + r * cols;
+    float* y = out->ptr<float>() + r * cols;
+    const float max = *std::max_element(x, x + cols);
+    float sum = 0.f;
+    for (int64_t c = 0; c < cols; ++c) {
+      y[c] = expf(x[c] - max);
+      sum += y[c];
+    }
+    const float scale = 1.f / sum;
+    for (int64_t c = 0; c < cols; ++c) { y[c] *= scale; }
+  }
+  return Status::OK();
+}
+
+Status Conv2DKernel(const KernelContext& ctx) {
+  LITE_RETURN_IF_ERROR(CheckArity(ctx, 2, 1));
+  LITE_RETURN_IF_ERROR(CheckF32(ctx));
+  LITE_CHECK_OR_RETURN(ctx.attrs.GetString("data_format", "channels_first") == "channels_first",
+                       "only channels_first is supported");
+  const Tensor* in = ctx.inputs[0];
+  const Tensor* weight = ctx.inputs[1];
+  const Tensor* bias = ctx.inputs.size() > 2 ? ctx.inputs[2] : nullptr;
+  Tensor* out = ctx.outputs[0];
+  LITE_CHECK_OR_RETURN(in->shape.size() == 4 && weight->shape.size() == 4
+                           && out->shape.size() == 4,
+                       "conv2d expects 4-D tensors");
+  std::vector<int64_t> pads = ctx.attrs.GetInts("padding_before");
+  std::vector<int64_t> strides = ctx.attrs.GetInts("strides");
+  std::vector<int64_t> dilations = ctx.attrs.GetInts("dilation_rate");
+  if (pads.empty()) { pads.assign(2, 0); }
+  if (strides.empty()) { strides.assign(2, 1); }
+  if (dilations.empty()) { dilations.assign(2, 1); }
+  LITE_CHECK_OR_RETURN(pads.size() == 2 && strides.size() == 2 && dilations.size() == 2,
+                       "conv2d expects 2-D padding, strides and dilations");
+  const int64_t groups = ctx.attrs.GetInt("groups", 1);
+  const int64_t batch = in->shape[0];
+  const int64_t in_channels = in->shape[1];
+  const int64_t in_h = in->shape[2];
+  const int64_t in_w = in->shape[3];
+  const int64_t filters = weight->shape[0];
+  const int64_t kernel_channels = weight->shape[1];
+  const int64_t kernel_h = weight->shape[2];
+  const int64_t kernel_w = weight->shape[3];
+  const int64_t out_h = out->shape[2];
+  const int64_t out_w = out->shape[3];
+  LITE_CHECK_OR_RETURN(groups > 0 && in_channels == kernel_channels * groups
+                           && filters % groups == 0 && out->shape[1] == filters,
+                       "conv2d channels mismatch");
+  LITE_CHECK_OR_RETURN(!bias || bias->elem_cnt() == filters, "conv2d bias size mismatches");
+  const int64_t filters_per_group = filters / groups;
+  const float* x = in->ptr<float>();
+  const float* w = weight->ptr<float>();
+  float* y = out->ptr<float>();
+  for (int64_t b = 0; b < batch; ++b) {
+    for (int64_t f = 0; f < filters; ++f) {
+      const int64_t g = f / filters_per_group;
+      const float init = bias ? bias->ptr<float>()[f] : 0.f;
+      float* y_plane = y + (b * filters + f) * out_h * out_w;
+      std::fill(y_plane, y_plane + out_h * out_w, init);
+      for (int64_t c = 0; c < kernel_channels; ++c) {
+        const float* x_plane = x + (b * in_channels + g * kernel_channels + c) * in_h * in_w;
+        const float* w_plane = w + (f * kernel_channels + c) * kernel_h * kernel_w;
+        for (int64_t kh = 0; kh < kernel_h; ++kh) {
+          for (int64_t kw = 0; kw < kernel_w; ++kw) {
+            const float wv = w_plane[kh * kernel_w + kw];
+            for (int64_t oh = 0; oh < out_h; ++oh) {
+              const int64_t ih = oh * strides[0] - pads[0] + kh * dilations[0];
+              if (ih < 0 || ih >= in_h) { continue; }
+              for (int64_t ow = 0; ow < out_w; ++ow) {
+                const int64_t iw = ow * strides[1] - pads[1] + kw * dilations[1];
+                if (iw < 0 || iw >= in_w) { continue; }
+                y_plane[oh * out_w + ow] += wv * x_plane[ih * in_w + iw];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+void RegisterHostKernels(KernelRegistry* registry) {
+  registry->Register("constant", ConstantKernel);
+  registry->Register("identity", CopyKernel);
+  registry->Register("reshape", CopyKernel);
+  registry->Register("flatten", CopyKernel);
+  registry->Register("expand_dims", CopyKernel);
+  registry->Register("squeeze", CopyKernel);
+  registry->Register("relu", ReluKernel);
+  registry->Register("sigmoid", SigmoidKernel);
+  registry->Register("tanh", TanhKernel);
+  registry->Register("gelu", GeluKernel);
+  registry->Register("silu", SiluKernel);
+  registry->Register("scalar_add", ScalarAddKernel);
+  registry->Register("scalar_mul", ScalarMulKernel);
+  registry->Register("broadcast_add", BroadcastAddKernel);
+  registry->Register("broadcast_sub", BroadcastSubKernel);
+  registry->Register("broadcast_mul", BroadcastMulKernel);
+  registry->Register("broadcast_div", BroadcastDivKernel);
+  registry->Register("add_n", AddNKernel);
+  registry->Register("bias_add", BiasAddKernel);
+  registry->Register("matmul", MatmulKernel);
+  registry->Register("broadcast_matmul", MatmulKernel);
+  registry->Register("softmax", SoftmaxKernel);
+  registry->Register("conv2d", Conv2DKernel);
+}
+
+}  // namespace oneflow_lite
@@ -0,0 +1,138 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "runtime/Kernel.h"
+
+#include <string.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#include "schemas/attributes/bool_generated.h"
+#include "schemas/attributes/f32_generated.h"
+#include "schemas/attributes/f64_generated.h"
+#include "schemas/attributes/i32_generated.h"
+#include "schemas/attributes/i32s_generated.h"
+#include "schemas/attributes/i64_generated.h"
+#include "schemas/attributes/i64s_generated.h"
+#include "schemas/attributes/shape_generated.h"
+#include "schemas/attributes/str_generated.h"
+#pragma GCC diagnostic pop
+
+namespace oneflow_lite {
+
+namespace {
+
+bool TypeIs(oneflow_lite_AttrDef_table_t attr, const char* type) {
+  flatbuffers_string_t attr_type = oneflow_lite_AttrDef_type(attr);
+  return attr_type && strcmp(attr_type, type) == 0;
+}
+
+// Attribute values are nested flatbuffers except for raw byte buffers.
+const void* NestedRoot(oneflow_lite_AttrDef_table_t attr) {
+  return oneflow_lite_AttrDef_value(attr);
+}
+
+}  // namespace
+
+oneflow_lite_AttrDef_table_t OpAttrs::Find(const char* key) const {
+  if (!attrs_) { return nullptr; }
+  size_t num_attrs = oneflow_lite_AttrDef_vec_len(attrs_);
+  for (size_t i = 0; i < num_attrs; ++i) {
+    auto attr = oneflow_lite_AttrDef_vec_at(attrs_, i);
+    flatbuffers_string_t attr_key = oneflow_lite_AttrDef_key(attr);
+    if (attr_key && strcmp(attr_key, key) == 0) { return attr; }
+  }
+  return nullptr;
+}
+
+bool OpAttrs::GetBool(const char* key, bool default_value) const {
+  auto attr = Find(key);
+  if (!attr || !TypeIs(attr, "bool")) { return default_value; }
+  return oneflow_lite_BoolDef_value(oneflow_lite_BoolDef_as_root(NestedRoot(attr)));
+}
+
+int64_t OpAttrs::GetInt(const char* key, int64_t default_value) const {
+  auto attr = Find(key);
+  if (!attr) { return default_value; }
+  if (TypeIs(attr, "i32")) {
+    return oneflow_lite_I32Def_value(oneflow_lite_I32Def_as_root(NestedRoot(attr)));
+  }
+  if (TypeIs(attr, "i64")) {
+    return oneflow_lite_I64Def_value(oneflow_lite_I64Def_as_root(NestedRoot(attr)));
+  }
+  return default_value;
+}
+
+double OpAttrs::GetFloat(const char* key, double default_value) const {
+  auto attr = Find(key);
+  if (!attr) { return default_value; }
+  if (TypeIs(attr, "f32")) {
+    return oneflow_lite_F32Def_value(oneflow_lite_F32Def_as_root(NestedRoot(attr)));
+  }
+  if (TypeIs(attr, "f64")) {
+    return oneflow_lite_F64Def_value(oneflow_lite_F64Def_as_root(NestedRoot(attr)));
+  }
+  return default_value;
+}
+
+std::string OpAttrs::GetString(const char* key, const std::string& default_value) const {
+  auto attr = Find(key);
+  if (!attr || !(TypeIs(attr, "str") || TypeIs(attr, "dtype"))) { return default_value; }
+  flatbuffers_string_t value =
+      oneflow_lite_StringDef_value(oneflow_lite_StringDef_as_root(NestedRoot(attr)));
+  return value ? std::string(value, flatbuffers_string_len(value)) : default_value;
+}
+
+std::vector<int64_t> OpAttrs::GetInts(const char* key) const {
+  std::vector<int64_t> values;
+  auto attr = Find(key);
+  if (!attr) { return values; }
+  if (TypeIs(attr, "i32s")) {
+    auto vec = oneflow_lite_I32sDef_value(oneflow_lite_I32sDef_as_root(NestedRoot(attr)));
+    for (size_t i = 0; i < flatbuffers_int32_vec_len(vec); ++i) {
+      values.push_back(flatbuffers_int32_vec_at(vec, i));
+    }
+  } else if (TypeIs(attr, "i64s")) {
+    auto vec = oneflow_lite_I64sDef_value(oneflow_lite_I64sDef_as_root(NestedRoot(attr)));
+    for (size_t i = 0; i < flatbuffers_int64_vec_len(vec); ++i) {
+      values.push_back(flatbuffers_int64_vec_at(vec, i));
+    }
+  } else if (TypeIs(attr, "shape") || TypeIs(attr, "stride")) {
+    auto vec = oneflow_lite_ShapeDef_value(oneflow_lite_ShapeDef_as_root(NestedRoot(attr)));
+    for (size_t i = 0; i < flatbuffers_int64_vec_len(vec); ++i) {
+      values.push_back(flatbuffers_int64_vec_at(vec, i));
+    }
+  }
+  return values;
+}
+
+const void* OpAttrs::GetBytes(const char* key, size_t* size) const {
+  auto attr = Find(key);
+  if (!attr) { return nullptr; }
+  flatbuffers_int8_vec_t value = oneflow_lite_AttrDef_value(attr);
+  *size = flatbuffers_int8_vec_len(value);
+  return value;
+}
+
+KernelRegistry* KernelRegistry::Global() {
+  static KernelRegistry* registry = [] {
+    auto* registry = new KernelRegistry();
+    RegisterHostKernels(registry);
+    return registry;
+  }();
+  return registry;
+}
+
+}  // namespace oneflow_lite
@@ -0,0 +1,90 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_KERNEL_H_
+#define ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_KERNEL_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "runtime/Status.h"
+#include "runtime/Tensor.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#include "schemas/executable_generated.h"
+#pragma GCC diagnostic pop
+
+namespace oneflow_lite {
+
+// Typed access to the serialized attributes of an OpDef, see createLiteOpAttrs in
+// ConvertToLiteExecutable.cpp for the encoding.
+class OpAttrs {
+ public:
+  OpAttrs() = default;
+  explicit OpAttrs(oneflow_lite_AttrDef_vec_t attrs) : attrs_(attrs) {}
+
+  bool Has(const char* key) const { return Find(key) != nullptr; }
+
+  bool GetBool(const char* key, bool default_value) const;
+  int64_t GetInt(const char* key, int64_t default_value) const;
+  double GetFloat(const char* key, double default_value) const;
+  std::string GetString(const char* key, const std::string& default_value) const;
+  std::vector<int64_t> GetInts(const char* key) const;
+  // Returns the raw value of an attribute stored as a byte buffer, such as the value of a
+  // constant op.
+  const void* GetBytes(const char* key, size_t* size) const;
+
+ private:
+  oneflow_lite_AttrDef_table_t Find(const char* key) const;
+
+  oneflow_lite_AttrDef_vec_t attrs_ = nullptr;
+};
+
+struct KernelContext {
+  const std::vector<Tensor*>& inputs;
+  const std::vector<Tensor*>& outputs;
+  const OpAttrs& attrs;
+};
+
+using HostKernel = Status (*)(const KernelContext& ctx);
+
+class KernelRegistry final {
+ public:
+  static KernelRegistry* Global();
+
+  void Register(const std::string& op_name, HostKernel kernel) { kernels_[op_name] = kernel; }
+
+  HostKernel Lookup(const std::string& op_name) const {
+    auto it = kernels_.find(op_name);
+    return it == kernels_.end() ? nullptr : it->second;
+  }
+
+ private:
+  KernelRegistry() = default;
+
+  std::unordered_map<std::string, HostKernel> kernels_;
+};
+
+// Defined in HostKernels.cpp. Kernels are registered explicitly rather than by static
+// initializers, which a static link of the runtime would drop.
+void RegisterHostKernels(KernelRegistry* registry);
+
+}  // namespace oneflow_lite
+
+#endif  // ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_KERNEL_H_
@@ -0,0 +1,163 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "runtime/Executable.h"
+#include "runtime/Session.h"
+
+namespace oneflow_lite {
+
+namespace {
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " <executable> [--input <name>=<file>]... [--output-dir <dir>]"
+               " [--iterations <n>] [--print-memory-plan]\n"
+               "Inputs and outputs are raw little-endian tensor data, missing inputs are zeros.\n";
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+Status ReadFile(const std::string& path, Tensor* tensor) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  LITE_CHECK_OR_RETURN(file, "failed to open " + path);
+  size_t size = static_cast<size_t>(file.tellg());
+  LITE_CHECK_OR_RETURN(size == tensor->nbytes(),
+                       path + " has " + std::to_string(size) + " bytes, but "
+                           + std::to_string(tensor->nbytes()) + " bytes are expected");
+  file.seekg(0);
+  file.read(static_cast<char*>(tensor->data), size);
+  LITE_CHECK_OR_RETURN(file, "failed to read " + path);
+  return Status::OK();
+}
+
+Status WriteFile(const std::string& path, const Tensor& tensor) {
+  std::ofstream file(path, std::ios::binary);
+  LITE_CHECK_OR_RETURN(file, "failed to open " + path);
+  file.write(static_cast<const char*>(tensor.data), tensor.nbytes());
+  LITE_CHECK_OR_RETURN(file, "failed to write " + path);
+  return Status::OK();
+}
+
+// Prints the segments of the memory plan and the number of operands placed in each of them.
+void PrintMemoryPlan(oneflow_lite_ExecutableDef_table_t def) {
+  oneflow_lite_BufferSegmentDef_vec_t segments = oneflow_lite_ExecutableDef_segments(def);
+  oneflow_lite_TensorDef_vec_t operands = oneflow_lite_ExecutableDef_operands(def);
+  std::vector<int> num_operands(oneflow_lite_BufferSegmentDef_vec_len(segments), 0);
+  for (size_t i = 0; i < oneflow_lite_TensorDef_vec_len(operands); ++i) {
+    auto operand = oneflow_lite_TensorDef_vec_at(operands, i);
+    if (oneflow_lite_TensorDef_parameter_id(operand) >= 0) { continue; }
+    int segment_id = oneflow_lite_TensorDef_segment_id(operand);
+    if (segment_id >= 0 && static_cast<size_t>(segment_id) < num_operands.size()) {
+      ++num_operands[segment_id];
+    }
+  }
+  for (size_t i = 0; i < num_operands.size(); ++i) {
+    auto segment = oneflow_lite_BufferSegmentDef_vec_at(segments, i);
+    std::cerr << "Segment " << i << ": " << oneflow_lite_BufferSegmentDef_size(segment)
+              << " bytes, " << num_operands[i] << " operands\n";
+  }
+}
+
+Status RunMain(int argc, char** argv) {
+  std::string executable_path;
+  std::vector<std::pair<std::string, std::string>> input_files;
+  std::string output_dir;
+  int iterations = 1;
+  bool print_memory_plan = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--input" && i + 1 < argc) {
+      std::string value = argv[++i];
+      size_t pos = value.find('=');
+      LITE_CHECK_OR_RETURN(pos != std::string::npos, "--input expects <name>=<file>");
+      input_files.emplace_back(value.substr(0, pos), value.substr(pos + 1));
+    } else if (arg == "--output-dir" && i + 1 < argc) {
+      output_dir = argv[++i];
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+      LITE_CHECK_OR_RETURN(iterations > 0, "--iterations expects a positive number");
+    } else if (arg == "--print-memory-plan") {
+      print_memory_plan = true;
+    } else if (executable_path.empty() && arg[0] != '-') {
+      executable_path = arg;
+    } else {
+      PrintUsage(argv[0]);
+      return Status::Error("unknown argument " + arg);
+    }
+  }
+  if (executable_path.empty()) {
+    PrintUsage(argv[0]);
+    return Status::Error("no executable is given");
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<const Executable> executable;
+  LITE_RETURN_IF_ERROR(Executable::Load(executable_path, &executable));
+  std::unique_ptr<Session> session;
+  LITE_RETURN_IF_ERROR(Session::Create(executable, &session));
+  std::cerr << "Loaded " << executable_path << " in " << ElapsedMs(start) << " ms\n";
+  if (print_memory_plan) { PrintMemoryPlan(executable->def()); }
+
+  for (size_t i = 0; i < session->num_inputs(); ++i) {
+    Tensor* input = session->input(i);
+    memset(input->data, 0, input->nbytes());
+  }
+  for (const auto& it : input_files) {
+    int index = session->FindInput(it.first);
+    LITE_CHECK_OR_RETURN(index >= 0, "no input named " + it.first);
+    LITE_RETURN_IF_ERROR(ReadFile(it.second, session->input(index)));
+  }
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) { LITE_RETURN_IF_ERROR(session->Run()); }
+  std::cerr << "Ran " << iterations << " iterations in " << ElapsedMs(start) / iterations
+            << " ms on average\n";
+
+  for (size_t i = 0; i < session->num_outputs(); ++i) {
+    const Tensor& output = session->output(i);
+    std::cerr << "Output " << session->output_name(i) << ": " << DataTypeName(output.dtype)
+              << ShapeToString(output.shape) << "\n";
+    if (!output_dir.empty()) {
+      LITE_RETURN_IF_ERROR(WriteFile(output_dir + "/" + session->output_name(i) + ".bin", output));
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+}  // namespace oneflow_lite
+
+int main(int argc, char** argv) {
+  oneflow_lite::Status status = oneflow_lite::RunMain(argc, argv);
+  if (!status.ok()) {
+    std::cerr << status.message() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,499 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "runtime/Executable.h"
+#include "runtime/Kernel.h"
+#include "runtime/Session.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#include "schemas/attributes/bool_generated.h"
+#include "schemas/attributes/i32_generated.h"
+#include "schemas/attributes/i64s_generated.h"
+#include "schemas/attributes/str_generated.h"
+#pragma GCC diagnostic pop
+
+namespace oneflow_lite {
+namespace test {
+
+namespace {
+
+// A serialized attribute, value is a nested flatbuffer as written by createLiteOpAttrs.
+struct AttrSpec {
+  std::string type;
+  std::string key;
+  std::vector<int8_t> value;
+};
+
+struct OperandSpec {
+  std::vector<int64_t> shape;
+  int segment_id = -1;
+  int64_t segment_offset = 0;
+  int parameter_id = -1;
+};
+
+struct OpSpec {
+  std::string name;
+  std::vector<int32_t> inputs;
+  std::vector<int32_t> outputs;
+  std::vector<AttrSpec> attrs;
+  int device = 0;
+};
+
+// The parts of an ExecutableDef the host runtime reads, all tensors are f32.
+struct ExecutableSpec {
+  std::vector<std::string> devices = {"host"};
+  std::vector<OperandSpec> operands;
+  std::vector<OpSpec> ops;
+  std::vector<int32_t> inputs;
+  std::vector<int32_t> outputs;
+  std::vector<std::string> input_names;
+  std::vector<std::string> output_names;
+  std::vector<int64_t> segment_sizes;
+  std::vector<std::vector<float>> parameters;
+};
+
+std::vector<int8_t> CopyBuffer(flatcc_builder_t* builder) {
+  std::vector<int8_t> buffer(flatcc_builder_get_buffer_size(builder));
+  flatcc_builder_copy_buffer(builder, buffer.data(), buffer.size());
+  return buffer;
+}
+
+AttrSpec BoolAttr(const std::string& key, bool value) {
+  flatcc_builder_t builder;
+  flatcc_builder_init(&builder);
+  oneflow_lite_BoolDef_start_as_root(&builder);
+  oneflow_lite_BoolDef_value_add(&builder, value);
+  oneflow_lite_BoolDef_end_as_root(&builder);
+  AttrSpec attr{"bool", key, CopyBuffer(&builder)};
+  flatcc_builder_clear(&builder);
+  return attr;
+}
+
+AttrSpec Int32Attr(const std::string& key, int32_t value) {
+  flatcc_builder_t builder;
+  flatcc_builder_init(&builder);
+  oneflow_lite_I32Def_start_as_root(&builder);
+  oneflow_lite_I32Def_value_add(&builder, value);
+  oneflow_lite_I32Def_end_as_root(&builder);
+  AttrSpec attr{"i32", key, CopyBuffer(&builder)};
+  flatcc_builder_clear(&builder);
+  return attr;
+}
+
+AttrSpec Int64sAttr(const std::string& key, const std::vector<int64_t>& value) {
+  flatcc_builder_t builder;
+  flatcc_builder_init(&builder);
+  oneflow_lite_I64sDef_start_as_root(&builder);
+  oneflow_lite_I64sDef_value_add(
+      &builder, flatbuffers_int64_vec_create(&builder, value.data(), value.size()));
+  oneflow_lite_I64sDef_end_as_root(&builder);
+  AttrSpec attr{"i64s", key, CopyBuffer(&builder)};
+  flatcc_builder_clear(&builder);
+  return attr;
+}
+
+AttrSpec StringAttr(const std::string& key, const std::string& value) {
+  flatcc_builder_t builder;
+  flatcc_builder_init(&builder);
+  oneflow_lite_StringDef_start_as_root(&builder);
+  oneflow_lite_StringDef_value_add(&builder,
+                                   flatbuffers_string_create_str(&builder, value.c_str()));
+  oneflow_lite_StringDef_end_as_root(&builder);
+  AttrSpec attr{"str", key, CopyBuffer(&builder)};
+  flatcc_builder_clear(&builder);
+  return attr;
+}
+
+flatbuffers_string_vec_ref_t CreateStringVec(flatcc_builder_t* builder,
+                                             const std::vector<std::string>& strs) {
+  flatbuffers_string_vec_start(builder);
+  for (const std::string& str : strs) {
+    flatbuffers_string_vec_push_create_str(builder, str.c_str());
+  }
+  return flatbuffers_string_vec_end(builder);
+}
+
+std::vector<int8_t> Serialize(const ExecutableSpec& spec) {
+  flatcc_builder_t builder;
+  flatcc_builder_init(&builder);
+  oneflow_lite_ExecutableDef_start_as_root(&builder);
+  oneflow_lite_ExecutableDef_version_add(&builder, 0);
+  oneflow_lite_ExecutableDef_devices_add(&builder, CreateStringVec(&builder, spec.devices));
+
+  std::vector<oneflow_lite_OpDef_ref_t> ops;
+  for (const OpSpec& op : spec.ops) {
+    std::vector<oneflow_lite_AttrDef_ref_t> attrs;
+    for (const AttrSpec& attr : op.attrs) {
+      oneflow_lite_AttrDef_start(&builder);
+      oneflow_lite_AttrDef_type_add(&builder,
+                                    flatbuffers_string_create_str(&builder, attr.type.c_str()));
+      oneflow_lite_AttrDef_key_add(&builder,
+                                   flatbuffers_string_create_str(&builder, attr.key.c_str()));
+      oneflow_lite_AttrDef_value_add(
+          &builder, flatbuffers_int8_vec_create(&builder, attr.value.data(), attr.value.size()));
+      attrs.push_back(oneflow_lite_AttrDef_end(&builder));
+    }
+    oneflow_lite_OpDef_start(&builder);
+    oneflow_lite_OpDef_name_add(&builder,
+                                flatbuffers_string_create_str(&builder, op.name.c_str()));
+    oneflow_lite_OpDef_inputs_add(
+        &builder, flatbuffers_int32_vec_create(&builder, op.inputs.data(), op.inputs.size()));
+    oneflow_lite_OpDef_outputs_add(
+        &builder, flatbuffers_int32_vec_create(&builder, op.outputs.data(), op.outputs.size()));
+    oneflow_lite_OpDef_attrs_add(
+        &builder, oneflow_lite_AttrDef_vec_create(&builder, attrs.data(), attrs.size()));
+    oneflow_lite_OpDef_device_add(&builder, op.device);
+    ops.push_back(oneflow_lite_OpDef_end(&builder));
+  }
+  oneflow_lite_ExecutableDef_ops_add(
+      &builder, oneflow_lite_OpDef_vec_create(&builder, ops.data(), ops.size()));
+
+  std::vector<oneflow_lite_TensorDef_ref_t> operands;
+  for (const OperandSpec& operand : spec.operands) {
+    flatbuffers_int64_vec_ref_t sizes =
+        flatbuffers_int64_vec_create(&builder, operand.shape.data(), operand.shape.size());
+    oneflow_lite_TensorDef_start(&builder);
+    oneflow_lite_TensorDef_type_add(&builder, flatbuffers_string_create_str(&builder, "f32"));
+    oneflow_lite_TensorDef_sizes_add(&builder, sizes);
+    oneflow_lite_TensorDef_segment_id_add(&builder, operand.segment_id);
+    oneflow_lite_TensorDef_segment_offset_add(&builder, operand.segment_offset);
+    oneflow_lite_TensorDef_parameter_id_add(&builder, operand.parameter_id);
+    operands.push_back(oneflow_lite_TensorDef_end(&builder));
+  }
+  oneflow_lite_ExecutableDef_operands_add(
+      &builder, oneflow_lite_TensorDef_vec_create(&builder, operands.data(), operands.size()));
+
+  oneflow_lite_ExecutableDef_inputs_add(
+      &builder, flatbuffers_int32_vec_create(&builder, spec.inputs.data(), spec.inputs.size()));
+  oneflow_lite_ExecutableDef_outputs_add(
+      &builder, flatbuffers_int32_vec_create(&builder, spec.outputs.data(), spec.outputs.size()));
+  oneflow_lite_ExecutableDef_input_names_add(&builder,
+                                             CreateStringVec(&builder, spec.input_names));
+  oneflow_lite_ExecutableDef_output_names_add(&builder,
+                                              CreateStringVec(&builder, spec.output_names));
+
+  std::vector<oneflow_lite_BufferSegmentDef_ref_t> segments;
+  for (int64_t size : spec.segment_sizes) {
+    oneflow_lite_BufferSegmentDef_start(&builder);
+    oneflow_lite_BufferSegmentDef_size_add(&builder, size);
+    oneflow_lite_BufferSegmentDef_device_add(&builder, 0);
+    oneflow_lite_BufferSegmentDef_alignment_add(&builder, 512);
+    segments.push_back(oneflow_lite_BufferSegmentDef_end(&builder));
+  }
+  oneflow_lite_ExecutableDef_segments_add(
+      &builder,
+      oneflow_lite_BufferSegmentDef_vec_create(&builder, segments.data(), segments.size()));
+
+  std::vector<oneflow_lite_ParameterDef_ref_t> parameters;
+  for (const std::vector<float>& parameter : spec.parameters) {
+    oneflow_lite_ParameterDef_start(&builder);
+    oneflow_lite_ParameterDef_type_add(&builder, flatbuffers_string_create_str(&builder, "f32"));
+    oneflow_lite_ParameterDef_buffer_add(
+        &builder,
+        flatbuffers_int8_vec_create(&builder, reinterpret_cast<const int8_t*>(parameter.data()),
+                                    parameter.size() * sizeof(float)));
+    parameters.push_back(oneflow_lite_ParameterDef_end(&builder));
+  }
+  oneflow_lite_ExecutableDef_parameters_add(
+      &builder,
+      oneflow_lite_ParameterDef_vec_create(&builder, parameters.data(), parameters.size()));
+  oneflow_lite_ExecutableDef_end_as_root(&builder);
+
+  std::vector<int8_t> buffer = CopyBuffer(&builder);
+  flatcc_builder_clear(&builder);
+  return buffer;
+}
+
+// Writes the buffer to a temporary file which is removed on destruction.
+class TempFile {
+ public:
+  explicit TempFile(const std::vector<int8_t>& buffer) {
+    const char* dir = getenv("TMPDIR");
+    std::string path =
+        std::string(dir && *dir ? dir : "/tmp") + "/oneflow_lite_runtime_test_XXXXXX";
+    int fd = mkstemp(&path[0]);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    path_ = path;
+    std::ofstream(path_, std::ios::binary)
+        .write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  }
+  ~TempFile() { unlink(path_.c_str()); }
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+Status CreateSession(const ExecutableSpec& spec, std::unique_ptr<Session>* session) {
+  TempFile file(Serialize(spec));
+  std::shared_ptr<const Executable> executable;
+  LITE_RETURN_IF_ERROR(Executable::Load(file.path(), &executable));
+  // the mapping stays valid after the file is unlinked
+  return Session::Create(executable, session);
+}
+
+// An executable running a single op on inputs and outputs that each have their own segment.
+ExecutableSpec SingleOpExecutable(const std::string& name,
+                                  const std::vector<std::vector<int64_t>>& input_shapes,
+                                  const std::vector<int64_t>& output_shape,
+                                  const std::vector<AttrSpec>& attrs) {
+  ExecutableSpec spec;
+  OpSpec op{name, {}, {}, attrs};
+  for (const auto& shape : input_shapes) {
+    op.inputs.push_back(spec.operands.size());
+    spec.inputs.push_back(spec.operands.size());
+    spec.input_names.push_back("input_" + std::to_string(spec.inputs.size() - 1));
+    spec.operands.push_back(OperandSpec{shape, static_cast<int>(spec.segment_sizes.size())});
+    spec.segment_sizes.push_back(4096);
+  }
+  op.outputs.push_back(spec.operands.size());
+  spec.outputs.push_back(spec.operands.size());
+  spec.output_names.push_back("output");
+  spec.operands.push_back(OperandSpec{output_shape, static_cast<int>(spec.segment_sizes.size())});
+  spec.segment_sizes.push_back(4096);
+  spec.ops.push_back(op);
+  return spec;
+}
+
+Tensor MakeTensor(std::vector<int64_t> shape, std::vector<float>* data) {
+  Tensor tensor;
+  tensor.dtype = DataType::kF32;
+  tensor.shape = std::move(shape);
+  tensor.data = data->data();
+  return tensor;
+}
+
+Status RunKernel(const std::string& name, const std::vector<Tensor*>& inputs,
+                 const std::vector<Tensor*>& outputs) {
+  HostKernel kernel = KernelRegistry::Global()->Lookup(name);
+  LITE_CHECK_OR_RETURN(kernel, "no host kernel for op " + name);
+  OpAttrs attrs;
+  return kernel(KernelContext{inputs, outputs, attrs});
+}
+
+void ExpectValues(const std::vector<float>& expected, const float* actual) {
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-5) << "index " << i;
+  }
+}
+
+}  // namespace
+
+TEST(HostKernels, matmul) {
+  std::vector<float> a_data = {1, 2, 3, 4, 5, 6};
+  std::vector<float> b_data = {1, 0, -1, 2, 0.5, 1, 0, -2, 3, 1, 1, 0};
+  std::vector<float> c_data(8);
+  Tensor a = MakeTensor({2, 3}, &a_data);
+  Tensor b = MakeTensor({3, 4}, &b_data);
+  Tensor c = MakeTensor({2, 4}, &c_data);
+  ASSERT_TRUE(RunKernel("matmul", {&a, &b}, {&c}).ok());
+  ExpectValues({11, 5, 2, -2, 24.5, 11, 2, -2}, c_data.data());
+}
+
+TEST(HostKernels, broadcast_matmul) {
+  std::vector<float> a_data = {1, 2, 3, 4, 5, 6, 7, 8};
+  std::vector<float> b_data = {1, -1, 2, 0};
+  std::vector<float> c_data(8);
+  Tensor a = MakeTensor({2, 2, 2}, &a_data);
+  Tensor b = MakeTensor({2, 2}, &b_data);
+  Tensor c = MakeTensor({2, 2, 2}, &c_data);
+  ASSERT_TRUE(RunKernel("broadcast_matmul", {&a, &b}, {&c}).ok());
+  ExpectValues({5, -1, 11, -3, 17, -5, 23, -7}, c_data.data());
+}
+
+TEST(HostKernels, matmul_zero_dims) {
+  std::vector<float> empty;
+  std::vector<float> b_data(12, 1.f);
+  // no rows and an empty batch
+  for (const std::vector<int64_t>& a_shape :
+       std::vector<std::vector<int64_t>>{{0, 3}, {0, 2, 3}, {2, 0, 3}}) {
+    std::vector<int64_t> c_shape = a_shape;
+    c_shape.back() = 4;
+    Tensor a = MakeTensor(a_shape, &empty);
+    Tensor b = MakeTensor({3, 4}, &b_data);
+    Tensor c = MakeTensor(c_shape, &empty);
+    Status status = RunKernel("broadcast_matmul", {&a, &b}, {&c});
+    EXPECT_TRUE(status.ok()) << ShapeToString(a_shape) << ": " << status.message();
+  }
+  // an empty reduction writes zeros
+  std::vector<float> c_data(6, std::numeric_limits<float>::quiet_NaN());
+  Tensor a = MakeTensor({2, 0}, &empty);
+  Tensor b = MakeTensor({0, 3}, &empty);
+  Tensor c = MakeTensor({2, 3}, &c_data);
+  ASSERT_TRUE(RunKernel("matmul", {&a, &b}, {&c}).ok());
+  ExpectValues({0, 0, 0, 0, 0, 0}, c_data.data());
+}
+
+TEST(HostKernels, broadcast_add) {
+  std::vector<float> x_data = {1, 2};
+  std::vector<float> y_data = {10, 20, 30};
+  std::vector<float> z_data(6);
+  Tensor x = MakeTensor({2, 1}, &x_data);
+  Tensor y = MakeTensor({1, 3}, &y_data);
+  Tensor z = MakeTensor({2, 3}, &z_data);
+  ASSERT_TRUE(RunKernel("broadcast_add", {&x, &y}, {&z}).ok());
+  ExpectValues({11, 21, 31, 12, 22, 32}, z_data.data());
+  Tensor bad = MakeTensor({2, 2}, &z_data);
+  EXPECT_FALSE(RunKernel("broadcast_add", {&x, &bad}, {&z}).ok());
+}
+
+TEST(HostKernels, softmax) {
+  std::vector<float> x_data = {1, 2, 3, 0, 0, 0};
+  std::vector<float> y_data(6);
+  Tensor x = MakeTensor({2, 3}, &x_data);
+  Tensor y = MakeTensor({2, 3}, &y_data);
+  ASSERT_TRUE(RunKernel("softmax", {&x}, {&y}).ok());
+  ExpectValues({0.09003057f, 0.24472847f, 0.66524096f, 1.f / 3, 1.f / 3, 1.f / 3},
+               y_data.data());
+}
+
+TEST(HostKernels, conv2d) {
+  std::vector<float> x(9);
+  for (size_t i = 0; i < x.size(); ++i) { x[i] = i + 1; }
+  std::vector<float> weight(4, 1.f);
+  std::unique_ptr<Session> session;
+  ExecutableSpec spec =
+      SingleOpExecutable("conv2d", {{1, 1, 3, 3}, {1, 1, 2, 2}}, {1, 1, 2, 2},
+                         {StringAttr("data_format", "channels_first"),
+                          Int64sAttr("padding_before", {1, 1}), Int64sAttr("strides", {2, 2})});
+  Status status = CreateSession(spec, &session);
+  ASSERT_TRUE(status.ok()) << status.message();
+  memcpy(session->input(0)->data, x.data(), x.size() * sizeof(float));
+  memcpy(session->input(1)->data, weight.data(), weight.size() * sizeof(float));
+  status = session->Run();
+  ASSERT_TRUE(status.ok()) << status.message();
+  ExpectValues({1, 5, 11, 28}, session->output(0).ptr<float>());
+}
+
+TEST(HostKernels, matmul_transpose_b_attr) {
+  std::unique_ptr<Session> session;
+  ExecutableSpec spec = SingleOpExecutable("matmul", {{1, 2}, {3, 2}}, {1, 3},
+                                           {BoolAttr("transpose_b", true)});
+  Status status = CreateSession(spec, &session);
+  ASSERT_TRUE(status.ok()) << status.message();
+  const float x[] = {1, 2};
+  const float w[] = {1, 0, 0, 1, 1, 1};
+  memcpy(session->input(0)->data, x, sizeof(x));
+  memcpy(session->input(1)->data, w, sizeof(w));
+  ASSERT_TRUE(session->Run().ok());
+  ExpectValues({1, 2, 3}, session->output(0).ptr<float>());
+}
+
+// y = relu(x * w + b) with w and b stored as parameters, the relu output reuses the segment of
+// x as the memory planning would.
+ExecutableSpec LinearReluExecutable() {
+  ExecutableSpec spec;
+  spec.operands = {
+      OperandSpec{{1, 2}, 0},         OperandSpec{{2, 3}, -1, 0, 0}, OperandSpec{{3}, -1, 0, 1},
+      OperandSpec{{1, 3}, 1},         OperandSpec{{1, 3}, 1, 64},    OperandSpec{{1, 3}, 0},
+  };
+  spec.parameters = {{1, 2, 3, -1, -2, -3}, {0.5, 0.5, 10}};
+  spec.ops = {
+      OpSpec{"matmul", {0, 1}, {3}, {}},
+      OpSpec{"bias_add", {3, 2}, {4}, {Int32Attr("axis", 1)}},
+      OpSpec{"relu", {4}, {5}, {}},
+  };
+  spec.inputs = {0};
+  spec.outputs = {5};
+  spec.input_names = {"x"};
+  spec.output_names = {"y"};
+  spec.segment_sizes = {512, 512};
+  return spec;
+}
+
+TEST(Session, linear_relu) {
+  std::unique_ptr<Session> session;
+  Status status = CreateSession(LinearReluExecutable(), &session);
+  ASSERT_TRUE(status.ok()) << status.message();
+  ASSERT_EQ(session->num_inputs(), 1u);
+  ASSERT_EQ(session->num_outputs(), 1u);
+  ASSERT_EQ(session->FindInput("x"), 0);
+  ASSERT_EQ(session->FindOutput("y"), 0);
+  ASSERT_EQ(session->FindInput("y"), -1);
+  for (const std::vector<float>& x : {std::vector<float>{1, 1}, std::vector<float>{2, -1}}) {
+    memcpy(session->input(0)->data, x.data(), x.size() * sizeof(float));
+    ASSERT_TRUE(session->Run().ok());
+    const std::vector<float> expected = {
+        std::max(0.f, x[0] * 1 + x[1] * -1 + 0.5f), std::max(0.f, x[0] * 2 + x[1] * -2 + 0.5f),
+        std::max(0.f, x[0] * 3 + x[1] * -3 + 10)};
+    ExpectValues(expected, session->output(0).ptr<float>());
+  }
+}
+
+TEST(Session, rejects_invalid_executables) {
+  auto expect_error = [](const ExecutableSpec& spec, const std::string& message) {
+    std::unique_ptr<Session> session;
+    Status status = CreateSession(spec, &session);
+    ASSERT_FALSE(status.ok());
+    EXPECT_NE(status.message().find(message), std::string::npos) << status.message();
+  };
+  ExecutableSpec spec = LinearReluExecutable();
+  spec.ops[2].name = "unknown_op";
+  expect_error(spec, "no host kernel for op unknown_op");
+
+  spec = LinearReluExecutable();
+  spec.devices = {"ascend"};
+  expect_error(spec, "not supported by the host runtime");
+
+  spec = LinearReluExecutable();
+  spec.parameters[1].push_back(0);
+  expect_error(spec, "parameter 1 has 16 bytes");
+
+  spec = LinearReluExecutable();
+  spec.operands[4].segment_offset = 508;
+  expect_error(spec, "operand 4 overflows segment 1");
+
+  spec = LinearReluExecutable();
+  spec.ops[0].inputs[1] = 42;
+  expect_error(spec, "out of range operand");
+}
+
+TEST(Executable, load_errors) {
+  std::shared_ptr<const Executable> executable;
+  Status status = Executable::Load("/nonexistent/model.lite", &executable);
+  ASSERT_FALSE(status.ok());
+  EXPECT_NE(status.message().find("failed to open"), std::string::npos);
+
+  TempFile garbage(std::vector<int8_t>(64, 0x7f));
+  status = Executable::Load(garbage.path(), &executable);
+  ASSERT_FALSE(status.ok());
+  EXPECT_NE(status.message().find("is not a valid executable"), std::string::npos);
+
+  TempFile valid(Serialize(LinearReluExecutable()));
+  status = Executable::Load(valid.path(), &executable);
+  ASSERT_TRUE(status.ok()) << status.message();
+  EXPECT_EQ(oneflow_lite_OpDef_vec_len(oneflow_lite_ExecutableDef_ops(executable->def())), 3u);
+}
+
+}  // namespace test
+}  // namespace oneflow_lite
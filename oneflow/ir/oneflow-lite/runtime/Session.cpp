@@ -0,0 +1,221 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "runtime/Session.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace oneflow_lite {
+
+namespace {
+
+constexpr size_t kMinAlignment = 64;
+
+std::string GetString(flatbuffers_string_t str) {
+  return str ? std::string(str, flatbuffers_string_len(str)) : std::string();
+}
+
+Status CheckHostDevice(oneflow_lite_ExecutableDef_table_t def, int device) {
+  flatbuffers_string_vec_t devices = oneflow_lite_ExecutableDef_devices(def);
+  size_t num_devices = flatbuffers_string_vec_len(devices);
+  LITE_CHECK_OR_RETURN(device >= 0 && static_cast<size_t>(device) < num_devices,
+                       "device index " + std::to_string(device) + " is out of range");
+  std::string name = GetString(flatbuffers_string_vec_at(devices, device));
+  LITE_CHECK_OR_RETURN(name == "host",
+                       "device " + name + " is not supported by the host runtime, recompile the "
+                       "model with --targets=host");
+  return Status::OK();
+}
+
+}  // namespace
+
+Status Session::Create(std::shared_ptr<const Executable> executable,
+                       std::unique_ptr<Session>* session) {
+  LITE_CHECK_OR_RETURN(executable, "executable is null");
+  std::unique_ptr<Session> result(new Session(std::move(executable)));
+  LITE_RETURN_IF_ERROR(result->AllocateSegments());
+  LITE_RETURN_IF_ERROR(result->BindOperands());
+  LITE_RETURN_IF_ERROR(result->PrepareOps());
+  *session = std::move(result);
+  return Status::OK();
+}
+
+void* Session::AllocateBuffer(size_t size, size_t alignment) {
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, alignment, size == 0 ? alignment : size) != 0) { return nullptr; }
+  buffers_.emplace_back(ptr);
+  return ptr;
+}
+
+Status Session::AllocateSegments() {
+  auto def = executable_->def();
+  oneflow_lite_BufferSegmentDef_vec_t segments = oneflow_lite_ExecutableDef_segments(def);
+  size_t num_segments = oneflow_lite_BufferSegmentDef_vec_len(segments);
+  for (size_t i = 0; i < num_segments; ++i) {
+    auto segment = oneflow_lite_BufferSegmentDef_vec_at(segments, i);
+    LITE_RETURN_IF_ERROR(CheckHostDevice(def, oneflow_lite_BufferSegmentDef_device(segment)));
+    int64_t size = oneflow_lite_BufferSegmentDef_size(segment);
+    size_t alignment = oneflow_lite_BufferSegmentDef_alignment(segment);
+    LITE_CHECK_OR_RETURN(size >= 0, "segment " + std::to_string(i) + " has a negative size");
+    if (alignment < kMinAlignment) { alignment = kMinAlignment; }
+    LITE_CHECK_OR_RETURN((alignment & (alignment - 1)) == 0,
+                         "segment alignment " + std::to_string(alignment) + " is not a power of 2");
+    void* ptr = AllocateBuffer(size, alignment);
+    LITE_CHECK_OR_RETURN(ptr, "failed to allocate " + std::to_string(size) + " bytes for segment "
+                                  + std::to_string(i));
+    segments_.push_back(static_cast<char*>(ptr));
+    segment_sizes_.push_back(size);
+  }
+  return Status::OK();
+}
+
+Status Session::BindOperands() {
+  auto def = executable_->def();
+  oneflow_lite_TensorDef_vec_t operands = oneflow_lite_ExecutableDef_operands(def);
+  oneflow_lite_ParameterDef_vec_t parameters = oneflow_lite_ExecutableDef_parameters(def);
+  size_t num_operands = oneflow_lite_TensorDef_vec_len(operands);
+  size_t num_parameters = oneflow_lite_ParameterDef_vec_len(parameters);
+  operands_.resize(num_operands);
+  for (size_t i = 0; i < num_operands; ++i) {
+    auto operand = oneflow_lite_TensorDef_vec_at(operands, i);
+    Tensor& tensor = operands_[i];
+    tensor.dtype = ParseDataType(oneflow_lite_TensorDef_type(operand));
+    LITE_CHECK_OR_RETURN(tensor.dtype != DataType::kInvalid,
+                         "operand " + std::to_string(i) + " has an unsupported type "
+                             + GetString(oneflow_lite_TensorDef_type(operand)));
+    flatbuffers_int64_vec_t sizes = oneflow_lite_TensorDef_sizes(operand);
+    for (size_t j = 0; j < flatbuffers_int64_vec_len(sizes); ++j) {
+      tensor.shape.push_back(flatbuffers_int64_vec_at(sizes, j));
+      LITE_CHECK_OR_RETURN(tensor.shape.back() >= 0,
+                           "operand " + std::to_string(i) + " has a dynamic shape");
+    }
+    size_t nbytes = tensor.nbytes();
+
+    int parameter_id = oneflow_lite_TensorDef_parameter_id(operand);
+    int segment_id = oneflow_lite_TensorDef_segment_id(operand);
+    if (parameter_id >= 0) {
+      LITE_CHECK_OR_RETURN(static_cast<size_t>(parameter_id) < num_parameters,
+                           "parameter " + std::to_string(parameter_id) + " is out of range");
+      auto parameter = oneflow_lite_ParameterDef_vec_at(parameters, parameter_id);
+      flatbuffers_int8_vec_t buffer = oneflow_lite_ParameterDef_buffer(parameter);
+      LITE_CHECK_OR_RETURN(flatbuffers_int8_vec_len(buffer) == nbytes,
+                           "parameter " + std::to_string(parameter_id) + " has "
+                               + std::to_string(flatbuffers_int8_vec_len(buffer))
+                               + " bytes, but the operand needs " + std::to_string(nbytes));
+      // kernels never write their inputs, so the mapped buffer is used as is unless an
+      // old executable left it misaligned
+      void* data = const_cast<int8_t*>(buffer);
+      if (reinterpret_cast<uintptr_t>(data) % DataTypeSize(tensor.dtype) != 0) {
+        void* copy = AllocateBuffer(nbytes, kMinAlignment);
+        LITE_CHECK_OR_RETURN(copy, "failed to allocate " + std::to_string(nbytes) + " bytes");
+        memcpy(copy, data, nbytes);
+        data = copy;
+      }
+      tensor.data = data;
+    } else if (segment_id >= 0) {
+      LITE_CHECK_OR_RETURN(static_cast<size_t>(segment_id) < segments_.size(),
+                           "segment " + std::to_string(segment_id) + " is out of range");
+      int64_t offset = oneflow_lite_TensorDef_segment_offset(operand);
+      LITE_CHECK_OR_RETURN(offset >= 0 && offset + nbytes <= segment_sizes_[segment_id],
+                           "operand " + std::to_string(i) + " overflows segment "
+                               + std::to_string(segment_id));
+      tensor.data = segments_[segment_id] + offset;
+    } else {
+      // not planned, such as an input that is directly returned as an output
+      tensor.data = AllocateBuffer(nbytes, kMinAlignment);
+      LITE_CHECK_OR_RETURN(tensor.data, "failed to allocate " + std::to_string(nbytes) + " bytes");
+    }
+  }
+
+  auto bind = [&](flatbuffers_int32_vec_t indices, flatbuffers_string_vec_t names,
+                  std::vector<int>* bound, std::vector<std::string>* bound_names) {
+    for (size_t i = 0; i < flatbuffers_int32_vec_len(indices); ++i) {
+      int index = flatbuffers_int32_vec_at(indices, i);
+      LITE_CHECK_OR_RETURN(index >= 0 && static_cast<size_t>(index) < num_operands,
+                           "operand " + std::to_string(index) + " is out of range");
+      bound->push_back(index);
+      bound_names->push_back(i < flatbuffers_string_vec_len(names)
+                                 ? GetString(flatbuffers_string_vec_at(names, i))
+                                 : std::to_string(i));
+    }
+    return Status::OK();
+  };
+  LITE_RETURN_IF_ERROR(bind(oneflow_lite_ExecutableDef_inputs(def),
+                            oneflow_lite_ExecutableDef_input_names(def), &inputs_,
+                            &input_names_));
+  LITE_RETURN_IF_ERROR(bind(oneflow_lite_ExecutableDef_outputs(def),
+                            oneflow_lite_ExecutableDef_output_names(def), &outputs_,
+                            &output_names_));
+  return Status::OK();
+}
+
+Status Session::PrepareOps() {
+  auto def = executable_->def();
+  // functions carry AOT code for other backends, the host lowering emits none
+  oneflow_lite_OpFunctionDef_vec_t functions = oneflow_lite_ExecutableDef_functions(def);
+  LITE_CHECK_OR_RETURN(oneflow_lite_OpFunctionDef_vec_len(functions) == 0,
+                       "executable functions are not supported by the host runtime");
+
+  oneflow_lite_OpDef_vec_t ops = oneflow_lite_ExecutableDef_ops(def);
+  size_t num_ops = oneflow_lite_OpDef_vec_len(ops);
+  ops_.resize(num_ops);
+  for (size_t i = 0; i < num_ops; ++i) {
+    auto op = oneflow_lite_OpDef_vec_at(ops, i);
+    OpInstance& instance = ops_[i];
+    instance.name = GetString(oneflow_lite_OpDef_name(op));
+    LITE_RETURN_IF_ERROR(CheckHostDevice(def, oneflow_lite_OpDef_device(op)));
+    instance.kernel = KernelRegistry::Global()->Lookup(instance.name);
+    LITE_CHECK_OR_RETURN(instance.kernel, "no host kernel for op " + instance.name);
+    auto bind = [&](flatbuffers_int32_vec_t indices, std::vector<Tensor*>* tensors) {
+      for (size_t j = 0; j < flatbuffers_int32_vec_len(indices); ++j) {
+        int index = flatbuffers_int32_vec_at(indices, j);
+        LITE_CHECK_OR_RETURN(index >= 0 && static_cast<size_t>(index) < operands_.size(),
+                             "op " + instance.name + " uses an out of range operand");
+        tensors->push_back(&operands_[index]);
+      }
+      return Status::OK();
+    };
+    LITE_RETURN_IF_ERROR(bind(oneflow_lite_OpDef_inputs(op), &instance.inputs));
+    LITE_RETURN_IF_ERROR(bind(oneflow_lite_OpDef_outputs(op), &instance.outputs));
+    instance.attrs = OpAttrs(oneflow_lite_OpDef_attrs(op));
+  }
+  return Status::OK();
+}
+
+int Session::FindInput(const std::string& name) const {
+  for (size_t i = 0; i < input_names_.size(); ++i) {
+    if (input_names_[i] == name) { return i; }
+  }
+  return -1;
+}
+
+int Session::FindOutput(const std::string& name) const {
+  for (size_t i = 0; i < output_names_.size(); ++i) {
+    if (output_names_[i] == name) { return i; }
+  }
+  return -1;
+}
+
+Status Session::Run() {
+  for (const auto& op : ops_) {
+    KernelContext ctx{op.inputs, op.outputs, op.attrs};
+    Status status = op.kernel(ctx);
+    if (!status.ok()) { return Status::Error(op.name + ": " + status.message()); }
+  }
+  return Status::OK();
+}
+
+}  // namespace oneflow_lite
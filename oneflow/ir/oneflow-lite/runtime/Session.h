@@ -0,0 +1,94 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_SESSION_H_
+#define ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_SESSION_H_
+
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "runtime/Executable.h"
+#include "runtime/Kernel.h"
+#include "runtime/Status.h"
+#include "runtime/Tensor.h"
+
+namespace oneflow_lite {
+
+// Executes a host executable. All memory is allocated when the session is created: one arena
+// per BufferSegmentDef of the memory plan, while parameters point into the mapped executable.
+// Inputs are written in place through input() and outputs stay valid until the next Run().
+// A session is not thread safe, create one session per thread instead.
+class Session final {
+ public:
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
+  ~Session() = default;
+
+  static Status Create(std::shared_ptr<const Executable> executable,
+                       std::unique_ptr<Session>* session);
+
+  size_t num_inputs() const { return inputs_.size(); }
+  size_t num_outputs() const { return outputs_.size(); }
+  const std::string& input_name(size_t i) const { return input_names_[i]; }
+  const std::string& output_name(size_t i) const { return output_names_[i]; }
+  // Returns -1 if there is no input or output with the name.
+  int FindInput(const std::string& name) const;
+  int FindOutput(const std::string& name) const;
+
+  Tensor* input(size_t i) { return &operands_[inputs_[i]]; }
+  const Tensor& output(size_t i) const { return operands_[outputs_[i]]; }
+
+  Status Run();
+
+ private:
+  struct FreeDeleter {
+    void operator()(void* ptr) const { free(ptr); }
+  };
+  using Buffer = std::unique_ptr<void, FreeDeleter>;
+
+  struct OpInstance {
+    std::string name;
+    HostKernel kernel;
+    std::vector<Tensor*> inputs;
+    std::vector<Tensor*> outputs;
+    OpAttrs attrs;
+  };
+
+  explicit Session(std::shared_ptr<const Executable> executable)
+      : executable_(std::move(executable)) {}
+
+  Status AllocateSegments();
+  Status BindOperands();
+  Status PrepareOps();
+  void* AllocateBuffer(size_t size, size_t alignment);
+
+  std::shared_ptr<const Executable> executable_;
+  std::vector<Buffer> buffers_;
+  std::vector<char*> segments_;
+  std::vector<size_t> segment_sizes_;
+  std::vector<Tensor> operands_;
+  std::vector<OpInstance> ops_;
+  std::vector<int> inputs_;
+  std::vector<int> outputs_;
+  std::vector<std::string> input_names_;
+  std::vector<std::string> output_names_;
+};
+
+}  // namespace oneflow_lite
+
+#endif  // ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_SESSION_H_
@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_STATUS_H_
+#define ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_STATUS_H_
+
+#include <string>
+#include <utility>
+
+namespace oneflow_lite {
+
+// The runtime must not depend on the framework, so errors are reported with a
+// plain status object instead of Maybe.
+class Status {
+ public:
+  Status() = default;
+
+  static Status OK() { return Status(); }
+  static Status Error(std::string message) { return Status(std::move(message)); }
+
+  bool ok() const { return !error_; }
+  const std::string& message() const { return message_; }
+
+ private:
+  explicit Status(std::string message) : error_(true), message_(std::move(message)) {}
+
+  bool error_ = false;
+  std::string message_;
+};
+
+}  // namespace oneflow_lite
+
+#define LITE_RETURN_IF_ERROR(expr)                      \
+  do {                                                 \
+    auto _lite_status = (expr);                        \
+    if (!_lite_status.ok()) { return _lite_status; }   \
+  } while (0)
+
+#define LITE_CHECK_OR_RETURN(cond, message)                                      \
+  do {                                                                           \
+    if (!(cond)) { return ::oneflow_lite::Status::Error(std::string(message)); } \
+  } while (0)
+
+#endif  // ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_STATUS_H_
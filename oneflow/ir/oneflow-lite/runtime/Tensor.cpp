@@ -0,0 +1,71 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "runtime/Tensor.h"
+
+#include <string.h>
+
+namespace oneflow_lite {
+
+namespace {
+
+struct DataTypeInfo {
+  DataType dtype;
+  const char* name;
+  size_t size;
+};
+
+constexpr DataTypeInfo kDataTypeInfos[] = {
+    {DataType::kBool, "bool", 1}, {DataType::kI8, "i8", 1},     {DataType::kI16, "i16", 2},
+    {DataType::kI32, "i32", 4},   {DataType::kI64, "i64", 8},   {DataType::kU8, "u8", 1},
+    {DataType::kU16, "u16", 2},   {DataType::kU32, "u32", 4},   {DataType::kU64, "u64", 8},
+    {DataType::kF16, "f16", 2},   {DataType::kBF16, "bf16", 2}, {DataType::kF32, "f32", 4},
+    {DataType::kF64, "f64", 8},
+};
+
+}  // namespace
+
+DataType ParseDataType(const char* name) {
+  if (!name) { return DataType::kInvalid; }
+  for (const auto& info : kDataTypeInfos) {
+    if (strcmp(info.name, name) == 0) { return info.dtype; }
+  }
+  return DataType::kInvalid;
+}
+
+const char* DataTypeName(DataType dtype) {
+  for (const auto& info : kDataTypeInfos) {
+    if (info.dtype == dtype) { return info.name; }
+  }
+  return "invalid";
+}
+
+size_t DataTypeSize(DataType dtype) {
+  for (const auto& info : kDataTypeInfos) {
+    if (info.dtype == dtype) { return info.size; }
+  }
+  return 0;
+}
+
+std::string ShapeToString(const std::vector<int64_t>& shape) {
+  std::string str = "(";
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (i > 0) { str += ", "; }
+    str += std::to_string(shape[i]);
+  }
+  return str + ")";
+}
+
+}  // namespace oneflow_lite
@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_TENSOR_H_
+#define ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_TENSOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace oneflow_lite {
+
+// Element types use the same names as TensorDef.type in executable.fbs.
+enum class DataType {
+  kInvalid = 0,
+  kBool,
+  kI8,
+  kI16,
+  kI32,
+  kI64,
+  kU8,
+  kU16,
+  kU32,
+  kU64,
+  kF16,
+  kBF16,
+  kF32,
+  kF64,
+};
+
+DataType ParseDataType(const char* name);
+const char* DataTypeName(DataType dtype);
+size_t DataTypeSize(DataType dtype);
+
+// A non-owning view of a dense tensor, the memory is owned by the session or the executable.
+struct Tensor {
+  DataType dtype = DataType::kInvalid;
+  std::vector<int64_t> shape;
+  void* data = nullptr;
+
+  int64_t elem_cnt() const {
+    int64_t cnt = 1;
+    for (int64_t dim : shape) { cnt *= dim; }
+    return cnt;
+  }
+  size_t nbytes() const { return elem_cnt() * DataTypeSize(dtype); }
+
+  template<typename T>
+  T* ptr() const {
+    return static_cast<T*>(data);
+  }
+};
+
+std::string ShapeToString(const std::vector<int64_t>& shape);
+
+}  // namespace oneflow_lite
+
+#endif  // ONEFLOW_IR_ONEFLOW_LITE_RUNTIME_TENSOR_H_
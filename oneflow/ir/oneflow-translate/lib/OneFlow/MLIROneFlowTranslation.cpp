@@ -827,6 +827,10 @@ LogicalResult ApplyRoundTripPatterns(RoundTripOneFlowJobWrapperInterface& job_wr
     pm.addNestedPass<Job>(oneflow::createOutlineJitFunctionPass());
     pm.addPass(createCanonicalizerPass());
   }
+  if (job_wrapper.IsLastIRPass()
+      && ::oneflow::ParseBooleanFromEnv("ONEFLOW_MLIR_FUSE_CPU_OPS", false)) {
+    pm.addNestedPass<Job>(oneflow::createOutlineCpuFusibleOpsPass());
+  }
   if (!job_wrapper.IsLastIRPass()
       && ::oneflow::ParseBooleanFromEnv("ONEFLOW_MLIR_FUSE_OPS_WITH_BACKWARD_IMPL", false)) {
     pm.addPass(oneflow::createFuseOpsWithBackwardImpl());
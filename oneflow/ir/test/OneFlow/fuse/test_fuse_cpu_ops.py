@@ -0,0 +1,87 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# RUN: python3 -m oneflow.test_utils.throttle --with-cuda=%with_cuda python3 %s | FileCheck %s
+# CHECK: mlir_jit
+
+import os
+import tempfile
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class ActivationChain(flow.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.bias = flow.nn.Parameter(flow.randn(64))
+
+    def forward(self, x, scale):
+        return flow.softmax(flow.relu(x + self.bias) * scale, dim=-1)
+
+
+def do_fuse_cpu_ops(test_case, cache_dir):
+    x = flow.randn(16, 64)
+    scale = flow.tensor([0.5], dtype=flow.float32)
+    module_to_run = ActivationChain()
+    module_to_run.eval()
+    y_eager = module_to_run(x, scale)
+
+    class GraphToRun(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.fw = module_to_run
+
+        def build(self, x, scale):
+            return self.fw(x, scale)
+
+    graph_to_run = GraphToRun()
+    y_lazy = graph_to_run(x, scale)
+    test_case.assertTrue(
+        np.allclose(y_eager.numpy(), y_lazy.numpy(), rtol=1e-5, atol=1e-5)
+    )
+    # the lowered regions are kept on disk, keyed by the region and its shapes
+    test_case.assertTrue(len(os.listdir(cache_dir)) > 0)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFuseCpuOps(oneflow.unittest.MLIRTestCase):
+    def setUp(self):
+        self.cache_dir = tempfile.TemporaryDirectory()
+        envs = {
+            "ONEFLOW_MLIR_ENABLE_ROUND_TRIP": "1",
+            "ONEFLOW_MLIR_FUSE_CPU_OPS": "1",
+            "ONEFLOW_MLIR_JIT_CACHE_DIR": self.cache_dir.name,
+        }
+        self.saved_envs = {key: os.environ.get(key) for key in envs}
+        os.environ.update(envs)
+
+    def tearDown(self):
+        # restore the values from before the test, rather than removing every MLIR env
+        for key, value in self.saved_envs.items():
+            if value is None:
+                os.environ.pop(key, None)
+            else:
+                os.environ[key] = value
+        self.cache_dir.cleanup()
+
+    def test_fuse_cpu_ops(test_case):
+        do_fuse_cpu_ops(test_case, test_case.cache_dir.name)
+
+
+if __name__ == "__main__":
+    unittest.main()
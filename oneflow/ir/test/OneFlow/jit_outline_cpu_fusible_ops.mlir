@@ -0,0 +1,33 @@
+// RUN: oneflow-opt %s \
+// RUN: -pass-pipeline="builtin.module(oneflow.job(outline-cpu-fusible-ops{compile-to-llvm=0}))" \
+// RUN: | FileCheck --dump-input=always %s
+
+// CHECK-LABEL: oneflow.job @GraphToRun_cpu
+// CHECK: oneflow.mlir_jit
+// CHECK-NOT: oneflow.relu
+// CHECK-NOT: oneflow.broadcast_add
+// CHECK-NOT: oneflow.scalar_mul_by_tensor
+// CHECK-NOT: oneflow.softmax
+oneflow.job @GraphToRun_cpu(%arg0: tensor<4x64xf32>, %arg1: tensor<64xf32>, %arg2: tensor<1xf32>) -> tensor<4x64xf32> {
+  %output = "oneflow.input"(%arg0) {data_type = 2 : i32, device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], is_dynamic = false, nd_sbp = ["B"], op_name = "_GraphToRun_cpu_input.0.0_2", output_lbns = ["_GraphToRun_cpu_input.0.0_2/out"], scope_symbol_id = 34 : i64, shape = [4 : si64, 64 : si64]} : (tensor<4x64xf32>) -> tensor<4x64xf32>
+  %output_0 = "oneflow.input"(%arg1) {data_type = 2 : i32, device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], is_dynamic = false, nd_sbp = ["B"], op_name = "_GraphToRun_cpu_input.0.1_3", output_lbns = ["_GraphToRun_cpu_input.0.1_3/out"], scope_symbol_id = 34 : i64, shape = [64 : si64]} : (tensor<64xf32>) -> tensor<64xf32>
+  %output_1 = "oneflow.input"(%arg2) {data_type = 2 : i32, device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], is_dynamic = false, nd_sbp = ["B"], op_name = "_GraphToRun_cpu_input.0.2_4", output_lbns = ["_GraphToRun_cpu_input.0.2_4/out"], scope_symbol_id = 34 : i64, shape = [1 : si64]} : (tensor<1xf32>) -> tensor<1xf32>
+  %0 = "oneflow.broadcast_add"(%output, %output_0) {device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], op_name = "fw-broadcast_add-0", scope_symbol_id = 41 : i64} : (tensor<4x64xf32>, tensor<64xf32>) -> tensor<4x64xf32>
+  %1 = "oneflow.relu"(%0) {device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], op_name = "fw-relu-1", scope_symbol_id = 41 : i64} : (tensor<4x64xf32>) -> tensor<4x64xf32>
+  %2 = "oneflow.scalar_mul_by_tensor"(%1, %output_1) {device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], op_name = "fw-scalar_mul_by_tensor-2", scope_symbol_id = 41 : i64} : (tensor<4x64xf32>, tensor<1xf32>) -> tensor<4x64xf32>
+  %3 = "oneflow.softmax"(%2) {device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], op_name = "fw-softmax-3", scope_symbol_id = 41 : i64} : (tensor<4x64xf32>) -> tensor<4x64xf32>
+  %output_2 = "oneflow.output"(%3) {data_type = 2 : i32, device_name = ["@0:0"], device_tag = "cpu", hierarchy = [1], is_dynamic = false, nd_sbp = ["B"], op_name = "_GraphToRun_cpu_output.0.0_2", output_lbns = ["_GraphToRun_cpu_output.0.0_2/out"], scope_symbol_id = 34 : i64, shape = [4 : si64, 64 : si64]} : (tensor<4x64xf32>) -> tensor<4x64xf32>
+  oneflow.return %output_2 : tensor<4x64xf32>
+}
+
+// CHECK-LABEL: oneflow.job @GraphToRun_cuda
+// CHECK-NOT: oneflow.mlir_jit
+// CHECK: oneflow.relu
+oneflow.job @GraphToRun_cuda(%arg0: tensor<4x64xf32>, %arg1: tensor<64xf32>) -> tensor<4x64xf32> {
+  %output = "oneflow.input"(%arg0) {data_type = 2 : i32, device_name = ["@0:0"], device_tag = "cuda", hierarchy = [1], is_dynamic = false, nd_sbp = ["B"], op_name = "_GraphToRun_cuda_input.0.0_2", output_lbns = ["_GraphToRun_cuda_input.0.0_2/out"], scope_symbol_id = 34 : i64, shape = [4 : si64, 64 : si64]} : (tensor<4x64xf32>) -> tensor<4x64xf32>
+  %output_0 = "oneflow.input"(%arg1) {data_type = 2 : i32, device_name = ["@0:0"], device_tag = "cuda", hierarchy = [1], is_dynamic = false, nd_sbp = ["B"], op_name = "_GraphToRun_cuda_input.0.1_3", output_lbns = ["_GraphToRun_cuda_input.0.1_3/out"], scope_symbol_id = 34 : i64, shape = [64 : si64]} : (tensor<64xf32>) -> tensor<64xf32>
+  %0 = "oneflow.broadcast_add"(%output, %output_0) {device_name = ["@0:0"], device_tag = "cuda", hierarchy = [1], op_name = "fw-broadcast_add-0", scope_symbol_id = 41 : i64} : (tensor<4x64xf32>, tensor<64xf32>) -> tensor<4x64xf32>
+  %1 = "oneflow.relu"(%0) {device_name = ["@0:0"], device_tag = "cuda", hierarchy = [1], op_name = "fw-relu-1", scope_symbol_id = 41 : i64} : (tensor<4x64xf32>) -> tensor<4x64xf32>
+  %output_1 = "oneflow.output"(%1) {data_type = 2 : i32, device_name = ["@0:0"], device_tag = "cuda", hierarchy = [1], is_dynamic = false, nd_sbp = ["B"], op_name = "_GraphToRun_cuda_output.0.0_2", output_lbns = ["_GraphToRun_cuda_output.0.0_2/out"], scope_symbol_id = 34 : i64, shape = [4 : si64, 64 : si64]} : (tensor<4x64xf32>) -> tensor<4x64xf32>
+  oneflow.return %output_1 : tensor<4x64xf32>
+}
@@ -0,0 +1,58 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+
+# The saved job is compiled as is, without the MLIR rewrites the other lit tests enable
+os.environ["ONEFLOW_MLIR_ENABLE_ROUND_TRIP"] = "0"
+os.environ["ONEFLOW_MLIR_FUSE_FORWARD_OPS"] = "0"
+
+import oneflow as flow
+
+# The RUN lines pass the paths of oneflow-lite-compile and oneflow-lite-run
+LITE_COMPILE, LITE_RUN = sys.argv[1:3]
+del sys.argv[1:3]
+
+
+def _io_op_name(graph, conf):
+    (name,) = [op.name for op in graph._forward_job_proto.net.op if op.HasField(conf)]
+    return name
+
+
+def run_lite(graph, x, run_args=()):
+    """Saves the compiled graph, compiles it for the host and runs it on x"""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        model_dir = os.path.join(tmpdir, "model")
+        flow.save(graph, model_dir)
+        executable = os.path.join(tmpdir, "model.lite")
+        subprocess.run([LITE_COMPILE, model_dir, "-o", executable], check=True)
+        input_file = os.path.join(tmpdir, "input.bin")
+        x.numpy().astype(np.float32).tofile(input_file)
+        input_name = _io_op_name(graph, "input_conf")
+        output_name = _io_op_name(graph, "output_conf")
+        sys.stdout.flush()
+        subprocess.run(
+            [LITE_RUN, executable, "--input", f"{input_name}={input_file}"]
+            + ["--output-dir", tmpdir]
+            + list(run_args),
+            check=True,
+            stderr=subprocess.STDOUT,
+        )
+        return np.fromfile(os.path.join(tmpdir, f"{output_name}.bin"), dtype=np.float32)
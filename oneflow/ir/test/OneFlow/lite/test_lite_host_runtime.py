@@ -0,0 +1,71 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# RUN: python3 %s oneflow-lite-compile oneflow-lite-run | FileCheck %s
+# CHECK: mlp outputs match
+# CHECK: cnn outputs match
+
+import unittest
+
+import numpy as np
+from lite_util import run_lite
+
+import oneflow as flow
+import oneflow.nn as nn
+import oneflow.unittest
+
+
+class EvalGraph(nn.Graph):
+    def __init__(self, model):
+        super().__init__()
+        self.model = model
+
+    def build(self, x):
+        return self.model(x)
+
+
+def _test_lite_host_runtime(test_case, model, x):
+    model.eval()
+    graph = EvalGraph(model)
+    expected = graph(x).numpy()
+    output = run_lite(graph, x)
+    test_case.assertTrue(
+        np.allclose(output.reshape(expected.shape), expected, rtol=1e-4, atol=1e-5)
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestLiteHostRuntime(flow.unittest.TestCase):
+    def test_mlp(test_case):
+        model = nn.Sequential(
+            nn.Linear(16, 32), nn.ReLU(), nn.Linear(32, 10), nn.Softmax(dim=-1)
+        )
+        _test_lite_host_runtime(test_case, model, flow.randn(4, 16))
+        print("mlp outputs match")
+
+    def test_cnn(test_case):
+        model = nn.Sequential(
+            nn.Conv2d(3, 8, 3, padding=1),
+            nn.ReLU(),
+            nn.Conv2d(8, 4, 3, stride=2),
+            nn.Flatten(),
+            nn.Linear(36, 10),
+        )
+        _test_lite_host_runtime(test_case, model, flow.randn(2, 3, 8, 8))
+        print("cnn outputs match")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,55 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# RUN: python3 %s oneflow-lite-compile oneflow-lite-run | FileCheck %s
+
+# Four ops on same sized values, x -> a -> b -> c -> d. A value may reuse the block of
+# the values whose lifetimes ended before it is written, so the plan alternates between
+# two blocks: {x, b, d} and {a, c}.
+# CHECK: Segment 0: 4096 bytes, 3 operands
+# CHECK-NEXT: Segment 1: 4096 bytes, 2 operands
+# CHECK-NOT: Segment 2
+# CHECK: memory plan outputs match
+
+import unittest
+
+import numpy as np
+from lite_util import run_lite
+
+import oneflow as flow
+import oneflow.nn as nn
+import oneflow.unittest
+
+
+class ChainGraph(nn.Graph):
+    def build(self, x):
+        return flow.sigmoid(flow.relu(x * 2 + 1))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestLiteMemoryPlanning(flow.unittest.TestCase):
+    def test_chain(test_case):
+        x = flow.randn(4, 256)
+        graph = ChainGraph()
+        expected = graph(x).numpy()
+        output = run_lite(graph, x, ["--print-memory-plan"])
+        test_case.assertTrue(
+            np.allclose(output.reshape(expected.shape), expected, rtol=1e-5, atol=1e-6)
+        )
+        print("memory plan outputs match")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -63,6 +63,7 @@ config.excludes = [
     "networks",
     "test_fuse_cast_scale.mlir.py",
     "test_util.py",
+    "lite_util.py",
     "test_mlir_opt.mlir.py",
     "lit.cfg.py",
     "saved_model",
@@ -116,6 +117,8 @@ tools = [
     "oneflow-opt",
     "oneflow-translate",
     "oneflow-runner",
+    "oneflow-lite-compile",
+    "oneflow-lite-run",
     add_runtime("mlir_runner_utils"),
 ]
 
@@ -14,11 +14,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 #ifdef __linux__
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <unistd.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #endif
@@ -74,6 +79,58 @@ size_t GetNumCompleteEpochs(size_t num_samples, size_t seq_length, size_t tokens
   return separate_last_epoch ? (num_epochs - 1) : num_epochs;
 }
 
+constexpr char kIndexCacheMagicCode[] = "OFGPTIDX";
+constexpr uint64_t kIndexCacheVersion = 1;
+
+// Followed by the doc indices, the sample indices and the shuffle indices
+struct IndexCacheHeader {
+  char magic_code[sizeof(kIndexCacheMagicCode) - 1];
+  uint64_t version;
+  uint64_t key;
+  uint64_t num_doc_indices;
+  uint64_t num_sample_indices;
+  uint64_t num_shuffle_indices;
+};
+
+bool EnableIndexCache() {
+#ifdef __linux__
+  return ParseBooleanFromEnv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE", true);
+#else
+  return false;
+#endif
+}
+
+// The indices only depend on the dataset files and the arguments below
+uint64_t GetIndexCacheKey(const std::string& data_file_prefix, size_t seq_len, size_t num_samples,
+                          const std::vector<int64_t>& split_sizes, size_t split_index,
+                          bool shuffle, uint32_t seed) {
+  std::ostringstream ss;
+  ss << seq_len << "," << num_samples << "," << split_index << "," << shuffle << "," << seed;
+  for (int64_t split_size : split_sizes) { ss << "," << split_size; }
+#ifdef __linux__
+  for (const char* suffix : {".idx", ".bin"}) {
+    struct stat s;
+    const std::string filename = data_file_prefix + suffix;
+    CHECK(stat(filename.c_str(), &s) != -1)
+        << "stat " << filename << " failed: " << strerror(errno);
+    ss << "," << s.st_size << "," << s.st_mtime;
+  }
+#endif
+  return std::hash<std::string>()(ss.str());
+}
+
+// Next to the dataset unless ONEFLOW_GPT_DATASET_INDEX_CACHE_DIR is set
+std::string GetIndexCachePath(const std::string& data_file_prefix, size_t seq_len,
+                              size_t num_samples, uint32_t seed, uint64_t key) {
+  const std::string cache_dir = GetStringFromEnv("ONEFLOW_GPT_DATASET_INDEX_CACHE_DIR", "");
+  const std::string prefix =
+      cache_dir.empty() ? data_file_prefix : JoinPath(cache_dir, Basename(data_file_prefix));
+  std::ostringstream ss;
+  ss << prefix << "_" << num_samples << "ns_" << seq_len << "sl_" << seed << "s_" << std::hex
+     << key << ".gpt_index";
+  return ss.str();
+}
+
 }  // namespace
 
 constexpr char MegatronGPTIndex::kMagicCode[];
@@ -142,6 +199,17 @@ MappedBuffer::~MappedBuffer() {
 #endif
 }
 
+void MappedBuffer::Prefetch(size_t offset, size_t size) const {
+#ifdef __linux__
+  if (offset >= size_ || size == 0) { return; }
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t begin = offset / page_size * page_size;
+  const size_t end = std::min(offset + size, size_);
+  // only a hint, a failure is harmless
+  madvise(static_cast<char*>(mapped_) + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
 MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_prefix, size_t seq_len,
                                                size_t label_len, size_t num_samples,
                                                const std::vector<int64_t>& split_sizes,
@@ -161,11 +229,27 @@ MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_pref
   tokens_per_epoch_ = GetEpochNumTokens(epoch_doc_indices);
   num_epochs_ = GetNumEpochs(num_samples_, seq_len_, tokens_per_epoch_);
   num_complete_epochs_ = GetNumCompleteEpochs(num_samples_, seq_len_, tokens_per_epoch_);
-  InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
-  size_t total_num_samples = static_cast<size_t>(
-      std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-  InitSampleIndices(total_num_samples);
-  InitShuffleIndices(sample_indices_.size());
+  const bool enable_index_cache = EnableIndexCache();
+  uint64_t cache_key = 0;
+  std::string cache_path;
+  if (enable_index_cache) {
+    cache_key = GetIndexCacheKey(data_file_prefix, seq_len_, num_samples_, split_sizes,
+                                 split_index, shuffle_, seed_);
+    cache_path = GetIndexCachePath(data_file_prefix, seq_len_, num_samples_, seed_, cache_key);
+  }
+  if (!enable_index_cache || !LoadIndexCache(cache_path, cache_key)) {
+    InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
+    size_t total_num_samples = static_cast<size_t>(
+        std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
+    InitSampleIndices(total_num_samples);
+    InitShuffleIndices(sample_index_buf_.size());
+    BindIndexArrays();
+    if (enable_index_cache) {
+      SaveIndexCache(cache_path, cache_key);
+      // map the file just written, which frees the memory of the indices
+      LoadIndexCache(cache_path, cache_key);
+    }
+  }
   std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
   VLOG(2) << "Create GPT Dataset successed, sequence length: " << seq_len_
           << ", number of samples: " << num_samples_
@@ -174,6 +258,7 @@ MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_pref
           << ", number of epochs: " << num_epochs_
           << ", number of complete epochs: " << num_complete_epochs_
           << ", shuffle: " << std::boolalpha << shuffle_ << ", random_seed: " << seed_
+          << ", index cache: " << (index_cache_ ? cache_path : "none")
           << ", elapsed time: " << elapse.count() << " ms";
 }
 
@@ -185,7 +270,7 @@ size_t MegatronGPTMMapDataset::GetEpochNumTokens(const std::vector<size_t>& doc_
 
 void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
                                             size_t num_epochs, size_t num_complete_epochs) {
-  doc_indices_.reserve(epoch_doc_indices.size() * num_epochs);
+  doc_index_buf_.reserve(epoch_doc_indices.size() * num_epochs);
   InitDocIndices(epoch_doc_indices, num_complete_epochs);
   if (num_epochs != num_complete_epochs) {
     CHECK_EQ(num_complete_epochs + 1, num_epochs);
@@ -195,55 +280,159 @@ void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc
 
 void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
                                             size_t num_epochs) {
-  auto start = std::distance(doc_indices_.cbegin(), doc_indices_.cend());
+  auto start = std::distance(doc_index_buf_.cbegin(), doc_index_buf_.cend());
   FOR_RANGE(size_t, i, 0, num_epochs) {
-    doc_indices_.insert(doc_indices_.end(), epoch_doc_indices.cbegin(), epoch_doc_indices.cend());
+    doc_index_buf_.insert(doc_index_buf_.end(), epoch_doc_indices.cbegin(),
+                          epoch_doc_indices.cend());
   }
-  if (shuffle_) { std::shuffle(doc_indices_.begin() + start, doc_indices_.end(), gen_); }
+  if (shuffle_) { std::shuffle(doc_index_buf_.begin() + start, doc_index_buf_.end(), gen_); }
 }
 
 void MegatronGPTMMapDataset::InitSampleIndices(size_t total_num_samples) {
-  sample_indices_.reserve(total_num_samples);
-  size_t doc_indices_idx = 0;
-  size_t doc_offset = 0;
-  FOR_RANGE(size_t, i, 0, total_num_samples) {
-    if (doc_indices_idx >= doc_indices_.size()) { break; }
-    sample_indices_.emplace_back(doc_indices_idx, doc_offset);
-    int remaining_tokens = seq_len_;
-    while (remaining_tokens > 0) {
-      CHECK_LT(doc_indices_idx, doc_indices_.size());
-      size_t doc_len = index_->doc_length(doc_indices_[doc_indices_idx]);
-      CHECK_LT(doc_offset, doc_len);
-      doc_len -= doc_offset;
-      if (remaining_tokens < doc_len) {
-        // move offset inside doc
-        doc_offset += remaining_tokens;
-      } else {
-        // move to next doc
-        doc_indices_idx += 1;
-        doc_offset = 0;
+  // the i-th sample starts at the (i * seq_len_)-th token of the concatenated docs, so chunks of
+  // samples can be located independently and then walked in parallel
+  std::vector<size_t> doc_start_tokens(doc_index_buf_.size() + 1, 0);
+  FOR_RANGE(size_t, i, 0, doc_index_buf_.size()) {
+    doc_start_tokens[i + 1] = doc_start_tokens[i] + index_->doc_length(doc_index_buf_[i]);
+  }
+  CHECK_LE(total_num_samples * seq_len_, doc_start_tokens.back());
+  sample_index_buf_.resize(total_num_samples);
+  constexpr size_t kNumSamplesPerChunk = 64 * 1024;
+  const size_t num_chunks = RoundUp(total_num_samples, kNumSamplesPerChunk) / kNumSamplesPerChunk;
+  MultiThreadLoop(num_chunks, [&](size_t chunk_id) {
+    const size_t begin = chunk_id * kNumSamplesPerChunk;
+    const size_t end = std::min(begin + kNumSamplesPerChunk, total_num_samples);
+    const size_t start_token = begin * seq_len_;
+    size_t doc_indices_idx = std::upper_bound(doc_start_tokens.cbegin(), doc_start_tokens.cend(),
+                                              start_token)
+                             - doc_start_tokens.cbegin() - 1;
+    size_t doc_offset = start_token - doc_start_tokens[doc_indices_idx];
+    FOR_RANGE(size_t, i, begin, end) {
+      sample_index_buf_[i] = SampleIndex{doc_indices_idx, doc_offset};
+      int remaining_tokens = seq_len_;
+      while (remaining_tokens > 0) {
+        CHECK_LT(doc_indices_idx, doc_index_buf_.size());
+        size_t doc_len = index_->doc_length(doc_index_buf_[doc_indices_idx]);
+        CHECK_LT(doc_offset, doc_len);
+        doc_len -= doc_offset;
+        if (remaining_tokens < doc_len) {
+          // move offset inside doc
+          doc_offset += remaining_tokens;
+        } else {
+          // move to next doc
+          doc_indices_idx += 1;
+          doc_offset = 0;
+        }
+        remaining_tokens -= doc_len;
       }
-      remaining_tokens -= doc_len;
     }
-  }
-  CHECK_EQ(sample_indices_.size(), total_num_samples);
-  CHECK_GE(sample_indices_.size(), num_samples_);
+  });
+  CHECK_GE(sample_index_buf_.size(), num_samples_);
 }
 
 void MegatronGPTMMapDataset::InitShuffleIndices(size_t total_num_samples) {
-  shuffle_indices_.resize(total_num_samples);
-  std::iota(shuffle_indices_.begin(), shuffle_indices_.end(), 0);
+  shuffle_index_buf_.resize(total_num_samples);
+  std::iota(shuffle_index_buf_.begin(), shuffle_index_buf_.end(), 0);
   if (shuffle_) {
     size_t num_samples = static_cast<size_t>(
         std::floor(static_cast<double>(num_complete_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-    CHECK_LE(num_samples, shuffle_indices_.size());
-    std::shuffle(shuffle_indices_.begin(), shuffle_indices_.begin() + num_samples, gen_);
+    CHECK_LE(num_samples, shuffle_index_buf_.size());
+    std::shuffle(shuffle_index_buf_.begin(), shuffle_index_buf_.begin() + num_samples, gen_);
     if (num_complete_epochs_ != num_epochs_) {
-      std::shuffle(shuffle_indices_.begin() + num_samples, shuffle_indices_.end(), gen_);
+      std::shuffle(shuffle_index_buf_.begin() + num_samples, shuffle_index_buf_.end(), gen_);
+    }
+  }
+}
+
+void MegatronGPTMMapDataset::BindIndexArrays() {
+  doc_indices_ = IndexArray<size_t>(doc_index_buf_.data(), doc_index_buf_.size());
+  sample_indices_ = IndexArray<SampleIndex>(sample_index_buf_.data(), sample_index_buf_.size());
+  shuffle_indices_ = IndexArray<size_t>(shuffle_index_buf_.data(), shuffle_index_buf_.size());
+}
+
+bool MegatronGPTMMapDataset::LoadIndexCache(const std::string& cache_path, uint64_t cache_key) {
+  if (access(cache_path.c_str(), R_OK) != 0) { return false; }
+  auto index_cache = std::make_unique<const MappedBuffer>(cache_path);
+  if (index_cache->size() < sizeof(IndexCacheHeader)) { return false; }
+  const auto* header = static_cast<const IndexCacheHeader*>(index_cache->ptr());
+  if (std::memcmp(header->magic_code, kIndexCacheMagicCode, sizeof(header->magic_code)) != 0
+      || header->version != kIndexCacheVersion || header->key != cache_key) {
+    LOG(WARNING) << "GPT Dataset ignores the mismatched index cache file " << cache_path;
+    return false;
+  }
+  const size_t doc_indices_bytes = header->num_doc_indices * sizeof(size_t);
+  const size_t sample_indices_bytes = header->num_sample_indices * sizeof(SampleIndex);
+  const size_t shuffle_indices_bytes = header->num_shuffle_indices * sizeof(size_t);
+  if (index_cache->size()
+      != sizeof(IndexCacheHeader) + doc_indices_bytes + sample_indices_bytes
+             + shuffle_indices_bytes) {
+    LOG(WARNING) << "GPT Dataset ignores the truncated index cache file " << cache_path;
+    return false;
+  }
+  const char* ptr = static_cast<const char*>(index_cache->ptr()) + sizeof(IndexCacheHeader);
+  doc_indices_ =
+      IndexArray<size_t>(reinterpret_cast<const size_t*>(ptr), header->num_doc_indices);
+  ptr += doc_indices_bytes;
+  sample_indices_ = IndexArray<SampleIndex>(reinterpret_cast<const SampleIndex*>(ptr),
+                                            header->num_sample_indices);
+  ptr += sample_indices_bytes;
+  shuffle_indices_ =
+      IndexArray<size_t>(reinterpret_cast<const size_t*>(ptr), header->num_shuffle_indices);
+  CHECK_GE(sample_indices_.size(), num_samples_);
+  index_cache_ = std::move(index_cache);
+  std::vector<size_t>().swap(doc_index_buf_);
+  std::vector<SampleIndex>().swap(sample_index_buf_);
+  std::vector<size_t>().swap(shuffle_index_buf_);
+  return true;
+}
+
+void MegatronGPTMMapDataset::SaveIndexCache(const std::string& cache_path,
+                                            uint64_t cache_key) const {
+  IndexCacheHeader header{};
+  std::memcpy(header.magic_code, kIndexCacheMagicCode, sizeof(header.magic_code));
+  header.version = kIndexCacheVersion;
+  header.key = cache_key;
+  header.num_doc_indices = doc_index_buf_.size();
+  header.num_sample_indices = sample_index_buf_.size();
+  header.num_shuffle_indices = shuffle_index_buf_.size();
+  // ranks on any host sharing the file system may write the same file at once, so the file is
+  // written under a unique name in the same directory and renamed, which is atomic
+  std::string tmp_path = cache_path + ".tmpXXXXXX";
+  const int fd = mkstemp(&tmp_path[0]);
+  if (fd < 0) {
+    LOG(WARNING) << "GPT Dataset failed to create a temporary file for the index cache file "
+                 << cache_path << ": " << strerror(errno);
+    return;
+  }
+  // mkstemp creates the file readable by the owner only
+  fchmod(fd, 0644);
+  close(fd);
+  {
+    std::ofstream stream(tmp_path, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(doc_index_buf_.data()),
+                 doc_index_buf_.size() * sizeof(size_t));
+    stream.write(reinterpret_cast<const char*>(sample_index_buf_.data()),
+                 sample_index_buf_.size() * sizeof(SampleIndex));
+    stream.write(reinterpret_cast<const char*>(shuffle_index_buf_.data()),
+                 shuffle_index_buf_.size() * sizeof(size_t));
+    if (stream.good()) { stream.close(); }
+    if (!stream.good() || std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+      LOG(WARNING) << "GPT Dataset failed to write the index cache file " << cache_path;
+      std::remove(tmp_path.c_str());
     }
   }
 }
 
+void MegatronGPTMMapDataset::Prefetch(size_t index, size_t count) const {
+  const size_t end = std::min(index + count, num_samples());
+  FOR_RANGE(size_t, i, index, end) {
+    ForEachTokenSpan(i, [&](size_t offset, size_t num_tokens) {
+      data_->Prefetch(offset, num_tokens * dtype_size_);
+    });
+  }
+}
+
 const HashMap<char, size_t> MegatronGPTMMapDataset::kDTypeCode2Size = {
     {1, 1},  // DataType::kUInt8
     {2, 1},  // DataType::kInt8
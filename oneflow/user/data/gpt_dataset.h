@@ -52,6 +52,8 @@ class MappedBuffer final {
 
   const void* ptr() const { return mapped_; }
   size_t size() const { return size_; }
+  // Ask the kernel to read the pages of [offset, offset + size) ahead asynchronously
+  void Prefetch(size_t offset, size_t size) const;
 
  private:
   void* mapped_;
@@ -66,18 +68,52 @@ class MegatronGPTMMapDataset final {
   OF_DISALLOW_COPY_AND_MOVE(MegatronGPTMMapDataset);
   ~MegatronGPTMMapDataset() = default;
 
+  size_t num_samples() const { return shuffle_indices_.size(); }
+
   template<typename T>
   void GetSample(size_t index, T* data) const;
+  // Read samples [index, index + count) into data back to back. The token spans of all the
+  // samples are read in the order of their file offsets.
+  template<typename T>
+  void GetSamples(size_t index, size_t count, T* data) const;
+  // Prefetch the tokens of samples [index, index + count), indices out of range are ignored
+  void Prefetch(size_t index, size_t count) const;
 
  private:
   static const HashMap<char, size_t> kDTypeCode2Size;
 
+  struct SampleIndex {
+    size_t doc_indices_idx;
+    size_t doc_offset;
+  };
+
+  // Points into either the in-memory indices or the mapped index cache file
+  template<typename T>
+  class IndexArray final {
+   public:
+    IndexArray() : data_(nullptr), size_(0) {}
+    IndexArray(const T* data, size_t size) : data_(data), size_(size) {}
+
+    size_t size() const { return size_; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+   private:
+    const T* data_;
+    size_t size_;
+  };
+
   size_t GetEpochNumTokens(const std::vector<size_t>& doc_indices) const;
   void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, size_t num_epochs,
                       size_t num_complete_epochs);
   void InitDocIndices(const std::vector<size_t>& doc_indices, size_t num_epochs);
   void InitSampleIndices(size_t total_num_samples);
   void InitShuffleIndices(size_t total_num_samples);
+  void BindIndexArrays();
+  bool LoadIndexCache(const std::string& cache_path, uint64_t cache_key);
+  void SaveIndexCache(const std::string& cache_path, uint64_t cache_key) const;
+  // Calls Handler(bytes_offset, num_tokens) for every contiguous token span of the sample
+  template<typename HandlerT>
+  void ForEachTokenSpan(size_t index, const HandlerT& Handler) const;
   template<typename T>
   void ReadTokens(const void* src, size_t offset, T* dst, size_t size) const;
 
@@ -96,18 +132,23 @@ class MegatronGPTMMapDataset final {
   size_t tokens_per_epoch_;
   size_t num_epochs_;
   size_t num_complete_epochs_;
-  std::vector<size_t> doc_indices_;
-  std::vector<std::pair<size_t, size_t>> sample_indices_;
-  std::vector<size_t> shuffle_indices_;
+  // built in memory, released once the indices are mapped from the index cache file
+  std::vector<size_t> doc_index_buf_;
+  std::vector<SampleIndex> sample_index_buf_;
+  std::vector<size_t> shuffle_index_buf_;
+  std::unique_ptr<const MappedBuffer> index_cache_;
+  IndexArray<size_t> doc_indices_;
+  IndexArray<SampleIndex> sample_indices_;
+  IndexArray<size_t> shuffle_indices_;
 };
 
-template<typename T>
-void MegatronGPTMMapDataset::GetSample(size_t index, T* data) const {
+template<typename HandlerT>
+void MegatronGPTMMapDataset::ForEachTokenSpan(size_t index, const HandlerT& Handler) const {
   CHECK_LT(index, shuffle_indices_.size());
   const size_t sample_index = shuffle_indices_[index];
   CHECK_LT(sample_index, sample_indices_.size());
-  size_t doc_indices_idx = sample_indices_[sample_index].first;
-  size_t doc_offset = sample_indices_[sample_index].second;
+  size_t doc_indices_idx = sample_indices_[sample_index].doc_indices_idx;
+  size_t doc_offset = sample_indices_[sample_index].doc_offset;
   int remaining_tokens = sample_len_;
   while (remaining_tokens > 0) {
     CHECK_LT(doc_indices_idx, doc_indices_.size());
@@ -122,13 +163,44 @@ void MegatronGPTMMapDataset::GetSample(size_t index, T* data) const {
       doc_indices_idx += 1;
       doc_offset = 0;
     }
-    ReadTokens(data_->ptr(), offset, data, num_tokens);
-    data += num_tokens;
+    Handler(offset, num_tokens);
     remaining_tokens -= num_tokens;
   }
   CHECK_EQ(remaining_tokens, 0);
 }
 
+template<typename T>
+void MegatronGPTMMapDataset::GetSample(size_t index, T* data) const {
+  ForEachTokenSpan(index, [&](size_t offset, size_t num_tokens) {
+    ReadTokens(data_->ptr(), offset, data, num_tokens);
+    data += num_tokens;
+  });
+}
+
+template<typename T>
+void MegatronGPTMMapDataset::GetSamples(size_t index, size_t count, T* data) const {
+  struct TokenSpan {
+    size_t bytes_offset;
+    size_t num_tokens;
+    T* dst;
+  };
+  std::vector<TokenSpan> spans;
+  FOR_RANGE(size_t, i, 0, count) {
+    T* dst = data + i * sample_len_;
+    ForEachTokenSpan(index + i, [&](size_t offset, size_t num_tokens) {
+      spans.emplace_back(TokenSpan{offset, num_tokens, dst});
+      dst += num_tokens;
+    });
+  }
+  // sequential page faults on the data file are much cheaper than random ones
+  std::sort(spans.begin(), spans.end(), [](const TokenSpan& lhs, const TokenSpan& rhs) {
+    return lhs.bytes_offset < rhs.bytes_offset;
+  });
+  for (const auto& span : spans) {
+    ReadTokens(data_->ptr(), span.bytes_offset, span.dst, span.num_tokens);
+  }
+}
+
 template<typename T>
 void MegatronGPTMMapDataset::ReadTokens(const void* src, size_t bytes_offset, T* dst,
                                         size_t size) const {
@@ -0,0 +1,165 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include "gtest/gtest.h"
+#include "oneflow/core/embedding/posix_file.h"
+#include "oneflow/user/data/gpt_dataset.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+std::string CreateTempDirectory() {
+  const char* tmp_env = getenv("TMPDIR");
+  const char* tmp_dir = tmp_env == nullptr ? "/tmp" : tmp_env;
+  std::string tpl = std::string(tmp_dir) + "/test_gpt_dataset_XXXXXX";
+  char* path = mkdtemp(const_cast<char*>(tpl.c_str()));
+  PCHECK(path != nullptr);
+  return std::string(path);
+}
+
+size_t CountFiles(const std::string& dir) {
+  size_t num_files = 0;
+  DIR* dirp = opendir(dir.c_str());
+  PCHECK(dirp != nullptr);
+  while (struct dirent* ent = readdir(dirp)) {
+    if (ent->d_type == DT_REG) { num_files += 1; }
+  }
+  PCHECK(closedir(dirp) == 0);
+  return num_files;
+}
+
+// Int32 tokens holding their global positions, stored doc after doc
+void CreateDataset(const std::string& prefix, const std::vector<int32_t>& doc_lengths) {
+  const int64_t num_docs = doc_lengths.size();
+  std::vector<int64_t> addresses;
+  std::vector<int32_t> tokens;
+  for (int32_t doc_length : doc_lengths) {
+    addresses.emplace_back(tokens.size() * sizeof(int32_t));
+    FOR_RANGE(int32_t, i, 0, doc_length) { tokens.emplace_back(tokens.size()); }
+  }
+  std::vector<int64_t> doc_offsets(num_docs + 1);
+  std::iota(doc_offsets.begin(), doc_offsets.end(), 0);
+  FILE* bin_file = fopen((prefix + ".bin").c_str(), "wb");
+  CHECK(bin_file != nullptr);
+  CHECK_EQ(fwrite(tokens.data(), sizeof(int32_t), tokens.size(), bin_file), tokens.size());
+  CHECK_EQ(fclose(bin_file), 0);
+  FILE* idx_file = fopen((prefix + ".idx").c_str(), "wb");
+  CHECK(idx_file != nullptr);
+  const uint64_t version = 1;
+  const char dtype_code = 4;  // int32
+  const uint64_t sizes_size = num_docs;
+  const uint64_t doc_offsets_size = num_docs + 1;
+  fwrite(MegatronGPTIndex::kMagicCode, 1, MegatronGPTIndex::kMagicCodeLen, idx_file);
+  fwrite(&version, sizeof(version), 1, idx_file);
+  fwrite(&dtype_code, sizeof(dtype_code), 1, idx_file);
+  fwrite(&sizes_size, sizeof(sizes_size), 1, idx_file);
+  fwrite(&doc_offsets_size, sizeof(doc_offsets_size), 1, idx_file);
+  fwrite(doc_lengths.data(), sizeof(int32_t), num_docs, idx_file);
+  fwrite(addresses.data(), sizeof(int64_t), num_docs, idx_file);
+  fwrite(doc_offsets.data(), sizeof(int64_t), num_docs + 1, idx_file);
+  CHECK_EQ(fclose(idx_file), 0);
+}
+
+std::vector<int32_t> RandomDocLengths(size_t num_docs) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int32_t> dist(1, 300);
+  std::vector<int32_t> doc_lengths(num_docs);
+  for (auto& doc_length : doc_lengths) { doc_length = dist(gen); }
+  return doc_lengths;
+}
+
+std::vector<int64_t> ReadAllSamples(const MegatronGPTMMapDataset& dataset, size_t sample_len) {
+  std::vector<int64_t> tokens(dataset.num_samples() * sample_len);
+  FOR_RANGE(size_t, i, 0, dataset.num_samples()) {
+    dataset.GetSample(i, tokens.data() + i * sample_len);
+  }
+  return tokens;
+}
+
+}  // namespace
+
+TEST(MegatronGPTMMapDataset, samples_follow_the_docs) {
+  const std::string dir = CreateTempDirectory();
+  const std::string prefix = dir + "/dataset";
+  const auto doc_lengths = RandomDocLengths(1000);
+  CreateDataset(prefix, doc_lengths);
+  const size_t num_tokens = std::accumulate(doc_lengths.begin(), doc_lengths.end(), size_t(0));
+  setenv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE", "0", 1);
+  const size_t seq_len = 31;
+  MegatronGPTMMapDataset dataset(prefix, seq_len, 1, 5000, {1}, 0, false, 0);
+  // without shuffle the i-th sample holds the tokens from i * seq_len on, and every epoch
+  // starts over from the first token
+  const auto tokens = ReadAllSamples(dataset, seq_len + 1);
+  FOR_RANGE(size_t, i, 0, dataset.num_samples()) {
+    FOR_RANGE(size_t, j, 0, seq_len + 1) {
+      ASSERT_EQ(tokens[i * (seq_len + 1) + j], (i * seq_len + j) % num_tokens);
+    }
+  }
+  unsetenv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE");
+  embedding::PosixFile::RecursiveDelete(dir);
+}
+
+TEST(MegatronGPTMMapDataset, index_cache) {
+  const std::string dir = CreateTempDirectory();
+  const std::string prefix = dir + "/dataset";
+  CreateDataset(prefix, RandomDocLengths(3000));
+  const size_t seq_len = 37;
+  setenv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE", "0", 1);
+  std::vector<int64_t> expected;
+  {
+    MegatronGPTMMapDataset dataset(prefix, seq_len, 1, 100000, {949, 50, 1}, 0, true, 1234);
+    expected = ReadAllSamples(dataset, seq_len + 1);
+  }
+  setenv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE", "1", 1);
+  // the first one builds and writes the cache, the second one maps it
+  FOR_RANGE(int, i, 0, 2) {
+    MegatronGPTMMapDataset dataset(prefix, seq_len, 1, 100000, {949, 50, 1}, 0, true, 1234);
+    ASSERT_EQ(CountFiles(dir), 3);
+    ASSERT_EQ(ReadAllSamples(dataset, seq_len + 1), expected);
+  }
+  unsetenv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE");
+  embedding::PosixFile::RecursiveDelete(dir);
+}
+
+TEST(MegatronGPTMMapDataset, get_samples) {
+  const std::string dir = CreateTempDirectory();
+  const std::string prefix = dir + "/dataset";
+  CreateDataset(prefix, RandomDocLengths(500));
+  setenv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE", "0", 1);
+  const size_t seq_len = 63;
+  const size_t batch_size = 16;
+  MegatronGPTMMapDataset dataset(prefix, seq_len, 1, 1000, {1}, 0, true, 0);
+  const auto expected = ReadAllSamples(dataset, seq_len + 1);
+  std::vector<int64_t> batch(batch_size * (seq_len + 1));
+  for (size_t i = 0; i + batch_size <= dataset.num_samples(); i += batch_size) {
+    dataset.GetSamples(i, batch_size, batch.data());
+    dataset.Prefetch(i + batch_size, batch_size);
+    ASSERT_TRUE(std::equal(batch.begin(), batch.end(), expected.begin() + i * (seq_len + 1)));
+  }
+  // out of range prefetches are ignored
+  dataset.Prefetch(dataset.num_samples() - 1, batch_size);
+  unsetenv("ONEFLOW_GPT_DATASET_ENABLE_INDEX_CACHE");
+  embedding::PosixFile::RecursiveDelete(dir);
+}
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -0,0 +1,543 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/raw_batch_reader.h"
+#include "oneflow/core/common/channel.h"
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+// The largest logical block size of the devices we care about
+constexpr size_t kDirectIoAlignment = 4096;
+// Keep a single read well below the 2GB limit of the result in a completion
+constexpr size_t kMaxReadBytes = 64 * 1024 * 1024;
+
+class PreadRawBatchReader final : public RawBatchReader {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PreadRawBatchReader);
+  PreadRawBatchReader(std::vector<std::unique_ptr<embedding::PosixFile>>&& files,
+                      std::vector<RawBlock>&& blocks, size_t block_size_bytes, size_t num_workers)
+      : head_(0),
+        tail_(0),
+        files_(std::move(files)),
+        blocks_(std::move(blocks)),
+        block_size_bytes_(block_size_bytes),
+        num_workers_(num_workers) {
+    for (size_t i = 0; i < num_workers_; ++i) {
+      Worker worker;
+      auto* sq = new Channel<RawBatchRequest>();
+      auto* cq = new Channel<RawBatchRequest>();
+      worker.sq.reset(sq);
+      worker.cq.reset(cq);
+      worker.thread = std::thread([sq, cq, this]() {
+        while (true) {
+          RawBatchRequest request;
+          auto status = sq->Receive(&request);
+          if (status == kChannelStatusErrorClosed) { break; }
+          CHECK_EQ(status, kChannelStatusSuccess) << "channel error";
+          size_t buffer_offset = 0;
+          for (size_t i = 0; i < request.blocks->size(); ++i) {
+            size_t block_index = request.blocks->at(i);
+            const RawBlock& block = blocks_[block_index];
+            size_t remaining = block_size_bytes_;
+            size_t file_index = block.file_index;
+            size_t file_offset = block.offset_in_file;
+            while (remaining != 0) {
+              const size_t bytes_to_read =
+                  std::min(remaining, files_.at(file_index)->Size() - file_offset);
+              PCHECK(pread(files_[file_index]->fd(),
+                           reinterpret_cast<unsigned char*>(request.buffer) + buffer_offset,
+                           bytes_to_read, file_offset)
+                     == bytes_to_read)
+                  << "file read error";
+              remaining -= bytes_to_read;
+              buffer_offset += bytes_to_read;
+              if (remaining != 0) {
+                file_index = (file_index + 1) % files_.size();
+                file_offset = 0;
+              }
+            }
+          }
+          CHECK(cq->Send(std::move(request)) == kChannelStatusSuccess) << "channel error";
+        }
+      });
+      workers_.emplace_back(std::move(worker));
+    }
+  }
+  ~PreadRawBatchReader() override {
+    for (auto& work : workers_) { work.Close(); }
+  }
+
+  void SubmitRequest(RawBatchRequest&& request) override {
+    size_t worker_id = head_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    workers_.at(worker_id).sq->Send(std::move(request));
+  }
+  void WaitCompleted(RawBatchRequest* request) override {
+    size_t worker_id = tail_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    workers_.at(worker_id).cq->Receive(request);
+  }
+
+ private:
+  struct Worker {
+    std::thread thread;
+    std::unique_ptr<Channel<RawBatchRequest>> sq;
+    std::unique_ptr<Channel<RawBatchRequest>> cq;
+    void Close() {
+      sq->Close();
+      cq->Close();
+      thread.join();
+    }
+  };
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+  std::vector<Worker> workers_;
+  std::vector<std::unique_ptr<embedding::PosixFile>> files_;
+  std::vector<RawBlock> blocks_;
+  size_t block_size_bytes_;
+  size_t num_workers_;
+};
+
+#ifdef __NR_io_uring_setup
+
+// A minimal io_uring wrapper on raw syscalls, the submission queue is only used by one thread
+class IoUring final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(IoUring);
+  explicit IoUring(uint32_t entries) : params_{} {
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params_));
+    PCHECK(ring_fd_ >= 0) << "io_uring_setup failed";
+    sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = (params_.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) { sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_); }
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params_.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = reinterpret_cast<struct io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+    sq_tail_ = RingField(sq_ring_, params_.sq_off.tail);
+    sq_mask_ = *RingField(sq_ring_, params_.sq_off.ring_mask);
+    sq_array_ = RingField(sq_ring_, params_.sq_off.array);
+    cq_head_ = RingField(cq_ring_, params_.cq_off.head);
+    cq_tail_ = RingField(cq_ring_, params_.cq_off.tail);
+    cq_mask_ = *RingField(cq_ring_, params_.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(reinterpret_cast<char*>(cq_ring_)
+                                                   + params_.cq_off.cqes);
+    num_prepared_ = 0;
+  }
+  ~IoUring() {
+    PCHECK(munmap(sqes_, sqes_size_) == 0);
+    if (cq_ring_ != sq_ring_) { PCHECK(munmap(cq_ring_, cq_ring_size_) == 0); }
+    PCHECK(munmap(sq_ring_, sq_ring_size_) == 0);
+    PCHECK(close(ring_fd_) == 0);
+  }
+
+  uint32_t entries() const { return params_.sq_entries; }
+
+  void PrepareReadv(int fd, const struct iovec* iov, uint64_t offset, uint64_t user_data) {
+    const uint32_t tail = *sq_tail_ + num_prepared_;
+    const uint32_t index = tail & sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = 1;
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+    num_prepared_ += 1;
+  }
+
+  // Submit the prepared reads and wait until at least min_complete reads are completed
+  void SubmitAndWait(uint32_t min_complete) {
+    const uint32_t to_submit = num_prepared_;
+    if (to_submit != 0) { __atomic_store_n(sq_tail_, *sq_tail_ + to_submit, __ATOMIC_RELEASE); }
+    num_prepared_ = 0;
+    if (to_submit == 0 && min_complete == 0) { return; }
+    const unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    uint32_t submitted = 0;
+    while (true) {
+      const long ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit - submitted, min_complete,
+                               flags, nullptr, 0);
+      if (ret >= 0) {
+        submitted += ret;
+        if (submitted == to_submit) { break; }
+      } else {
+        PCHECK(errno == EINTR || errno == EAGAIN || errno == EBUSY) << "io_uring_enter failed";
+      }
+    }
+  }
+
+  template<typename Handler>
+  void ForEachCompletion(const Handler& handler) {
+    uint32_t head = *cq_head_;
+    const uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      handler(cqe.user_data, cqe.res);
+      head += 1;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+
+ private:
+  void* Map(size_t size, off_t offset) {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                     offset);
+    PCHECK(ptr != MAP_FAILED) << "io_uring mmap failed";
+    return ptr;
+  }
+  static uint32_t* RingField(void* ring, uint32_t offset) {
+    return reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(ring) + offset);
+  }
+
+  struct io_uring_params params_;
+  int ring_fd_;
+  size_t sq_ring_size_;
+  size_t cq_ring_size_;
+  size_t sqes_size_;
+  void* sq_ring_;
+  void* cq_ring_;
+  struct io_uring_sqe* sqes_;
+  uint32_t* sq_tail_;
+  uint32_t sq_mask_;
+  uint32_t* sq_array_;
+  uint32_t* cq_head_;
+  uint32_t* cq_tail_;
+  uint32_t cq_mask_;
+  struct io_uring_cqe* cqes_;
+  uint32_t num_prepared_;
+};
+
+class IoUringRawBatchReader final : public RawBatchReader {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(IoUringRawBatchReader);
+  IoUringRawBatchReader(std::vector<std::unique_ptr<embedding::PosixFile>>&& files,
+                        std::vector<RawBlock>&& blocks, size_t block_size_bytes,
+                        size_t queue_depth, bool direct_io)
+      : files_(std::move(files)),
+        blocks_(std::move(blocks)),
+        block_size_bytes_(block_size_bytes),
+        direct_io_(direct_io),
+        ring_(queue_depth),
+        num_inflight_reads_(0),
+        closed_(false) {
+    thread_ = std::thread(&IoUringRawBatchReader::PollLoop, this);
+  }
+  ~IoUringRawBatchReader() override {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    cond_.notify_one();
+    thread_.join();
+    cq_.Close();
+    for (void* buffer : staging_buffers_) { free(buffer); }  // NOLINT
+  }
+
+  void SubmitRequest(RawBatchRequest&& request) override {
+    bool notify = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      notify = sq_.empty();
+      sq_.emplace_back(std::move(request));
+    }
+    if (notify) { cond_.notify_one(); }
+  }
+  void WaitCompleted(RawBatchRequest* request) override { cq_.Receive(request); }
+
+ private:
+  struct PendingRequest;
+
+  struct Read {
+    PendingRequest* owner;
+    int fd;
+    // The bytes to read into dst
+    size_t file_offset;
+    unsigned char* dst;
+    size_t length;
+    // The aligned range read into the staging buffer if it is not null
+    unsigned char* staging;
+    size_t staging_size;
+    size_t aligned_offset;
+    size_t aligned_length;
+    size_t bytes_done;
+    // Where the last submission started, O_DIRECT resubmissions start at an aligned offset
+    size_t bytes_resumed;
+    struct iovec iov;
+  };
+
+  struct PendingRequest {
+    RawBatchRequest request;
+    std::vector<Read> reads;
+    size_t num_submitted;
+    size_t num_done;
+  };
+
+  // Translate the blocks into reads, coalescing those adjacent in both the file and the buffer
+  void PlanReads(PendingRequest* pending) {
+    auto* buffer = reinterpret_cast<unsigned char*>(pending->request.buffer);
+    size_t buffer_offset = 0;
+    size_t last_file_index = 0;
+    auto& reads = pending->reads;
+    const auto& AppendRead = [&](size_t file_index, size_t file_offset, size_t length) {
+      if (!reads.empty() && last_file_index == file_index
+          && reads.back().file_offset + reads.back().length == file_offset
+          && reads.back().dst + reads.back().length == buffer + buffer_offset
+          && reads.back().length + length <= kMaxReadBytes) {
+        reads.back().length += length;
+      } else {
+        Read read{};
+        read.owner = pending;
+        read.fd = files_[file_index]->fd();
+        read.file_offset = file_offset;
+        read.dst = buffer + buffer_offset;
+        read.length = length;
+        reads.emplace_back(read);
+        last_file_index = file_index;
+      }
+      buffer_offset += length;
+    };
+    for (size_t block_index : *pending->request.blocks) {
+      const RawBlock& block = blocks_.at(block_index);
+      size_t remaining = block_size_bytes_;
+      size_t file_index = block.file_index;
+      size_t file_offset = block.offset_in_file;
+      while (remaining != 0) {
+        size_t bytes_to_read = std::min(remaining, files_.at(file_index)->Size() - file_offset);
+        remaining -= bytes_to_read;
+        while (bytes_to_read != 0) {
+          const size_t length = std::min(bytes_to_read, kMaxReadBytes);
+          AppendRead(file_index, file_offset, length);
+          file_offset += length;
+          bytes_to_read -= length;
+        }
+        if (remaining != 0) {
+          file_index = (file_index + 1) % files_.size();
+          file_offset = 0;
+        }
+      }
+    }
+    for (Read& read : reads) {
+      read.aligned_offset = read.file_offset;
+      read.aligned_length = read.length;
+      if (!direct_io_) { continue; }
+      read.aligned_offset = read.file_offset / kDirectIoAlignment * kDirectIoAlignment;
+      read.aligned_length =
+          RoundUp(read.file_offset + read.length, kDirectIoAlignment) - read.aligned_offset;
+      if (read.aligned_offset != read.file_offset || read.aligned_length != read.length
+          || reinterpret_cast<uintptr_t>(read.dst) % kDirectIoAlignment != 0) {
+        read.staging = AcquireStagingBuffer(read.aligned_length, &read.staging_size);
+      }
+    }
+    pending->num_submitted = 0;
+    pending->num_done = 0;
+  }
+
+  unsigned char* AcquireStagingBuffer(size_t size, size_t* capacity) {
+    for (auto it = free_staging_buffers_.begin(); it != free_staging_buffers_.end(); ++it) {
+      if (it->second >= size) {
+        unsigned char* buffer = it->first;
+        *capacity = it->second;
+        free_staging_buffers_.erase(it);
+        return buffer;
+      }
+    }
+    *capacity = RoundUp(size, kDirectIoAlignment);
+    void* buffer = aligned_alloc(kDirectIoAlignment, *capacity);  // NOLINT
+    CHECK(buffer != nullptr) << "Failed to allocate staging buffer";
+    staging_buffers_.emplace_back(buffer);
+    return reinterpret_cast<unsigned char*>(buffer);
+  }
+
+  void ReleaseStagingBuffer(unsigned char* buffer, size_t capacity) {
+    free_staging_buffers_.emplace_back(buffer, capacity);
+  }
+
+  void PrepareRead(Read* read) {
+    unsigned char* dst = read->staging != nullptr ? read->staging : read->dst;
+    // A short O_DIRECT read may stop in the middle of a sector, the rest of the sector is read
+    // again so that the offset, length and buffer stay aligned
+    read->bytes_resumed = direct_io_
+                              ? read->bytes_done / kDirectIoAlignment * kDirectIoAlignment
+                              : read->bytes_done;
+    read->iov.iov_base = dst + read->bytes_resumed;
+    read->iov.iov_len = read->aligned_length - read->bytes_resumed;
+    ring_.PrepareReadv(read->fd, &read->iov, read->aligned_offset + read->bytes_resumed,
+                       reinterpret_cast<uint64_t>(read));
+    num_inflight_reads_ += 1;
+  }
+
+  void OnReadCompleted(Read* read, int32_t res) {
+    num_inflight_reads_ -= 1;
+    if (res == -EINTR || res == -EAGAIN) {
+      retries_.emplace_back(read);
+      return;
+    }
+    CHECK_GE(res, 0) << "file read error: " << strerror(-res);
+    const size_t bytes_done = read->bytes_resumed + res;
+    // Reading with O_DIRECT may stop at the end of the file before the aligned end
+    const size_t bytes_needed = read->file_offset + read->length - read->aligned_offset;
+    if (bytes_done < bytes_needed) {
+      CHECK_GT(bytes_done, read->bytes_done) << "unexpected end of file";
+      read->bytes_done = bytes_done;
+      retries_.emplace_back(read);
+      return;
+    }
+    read->bytes_done = bytes_done;
+    if (read->staging != nullptr) {
+      std::memcpy(read->dst, read->staging + (read->file_offset - read->aligned_offset),
+                  read->length);
+      ReleaseStagingBuffer(read->staging, read->staging_size);
+      read->staging = nullptr;
+    }
+    read->owner->num_done += 1;
+  }
+
+  // Return false if the reader is closed and there are no more requests
+  bool PopRequests(bool blocking, std::deque<RawBatchRequest>* requests) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (blocking) { cond_.wait(lock, [this]() { return !sq_.empty() || closed_; }); }
+    if (sq_.empty()) { return !closed_; }
+    requests->swap(sq_);
+    return true;
+  }
+
+  void PollLoop() {
+    std::deque<std::unique_ptr<PendingRequest>> pending_requests;
+    while (true) {
+      std::deque<RawBatchRequest> requests;
+      if (!PopRequests(pending_requests.empty(), &requests) && pending_requests.empty()) { break; }
+      for (auto& request : requests) {
+        pending_requests.emplace_back(new PendingRequest());
+        pending_requests.back()->request = std::move(request);
+        PlanReads(pending_requests.back().get());
+      }
+      // Retries first, then the reads of the earliest requests
+      while (!retries_.empty() && num_inflight_reads_ < ring_.entries()) {
+        PrepareRead(retries_.front());
+        retries_.pop_front();
+      }
+      for (auto& pending : pending_requests) {
+        while (pending->num_submitted < pending->reads.size()
+               && num_inflight_reads_ < ring_.entries()) {
+          PrepareRead(&pending->reads[pending->num_submitted]);
+          pending->num_submitted += 1;
+        }
+        if (num_inflight_reads_ == ring_.entries()) { break; }
+      }
+      ring_.SubmitAndWait(num_inflight_reads_ > 0 ? 1 : 0);
+      ring_.ForEachCompletion([this](uint64_t user_data, int32_t res) {
+        OnReadCompleted(reinterpret_cast<Read*>(user_data), res);
+      });
+      while (!pending_requests.empty()
+             && pending_requests.front()->num_done == pending_requests.front()->reads.size()) {
+        CHECK(cq_.Send(std::move(pending_requests.front()->request)) == kChannelStatusSuccess)
+            << "channel error";
+        pending_requests.pop_front();
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<embedding::PosixFile>> files_;
+  std::vector<RawBlock> blocks_;
+  size_t block_size_bytes_;
+  bool direct_io_;
+  IoUring ring_;
+  uint32_t num_inflight_reads_;
+  std::deque<Read*> retries_;
+  std::vector<void*> staging_buffers_;
+  std::vector<std::pair<unsigned char*, size_t>> free_staging_buffers_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<RawBatchRequest> sq_;
+  bool closed_;
+  Channel<RawBatchRequest> cq_;
+  std::thread thread_;
+};
+
+#endif  // __NR_io_uring_setup
+
+}  // namespace
+
+std::vector<RawBlock> MakeRawBlocks(const std::vector<std::unique_ptr<embedding::PosixFile>>& files,
+                                    size_t num_blocks, size_t block_size_bytes) {
+  size_t file_index = 0;
+  size_t offset_in_file = 0;
+  std::vector<RawBlock> blocks;
+  blocks.reserve(num_blocks);
+  for (size_t i = 0; i < num_blocks; ++i) {
+    blocks.emplace_back(RawBlock{file_index, offset_in_file});
+    size_t remaining = block_size_bytes;
+    while (remaining != 0) {
+      if (files[file_index]->Size() - offset_in_file >= remaining) {
+        offset_in_file += remaining;
+        if (offset_in_file == files[file_index]->Size()) { offset_in_file = 0; }
+        remaining = 0;
+      } else {
+        remaining -= (files[file_index]->Size() - offset_in_file);
+        offset_in_file = 0;
+        file_index = (file_index + 1) % files.size();
+      }
+    }
+  }
+  return blocks;
+}
+
+std::unique_ptr<RawBatchReader> NewPreadRawBatchReader(
+    std::vector<std::unique_ptr<embedding::PosixFile>>&& files, std::vector<RawBlock>&& blocks,
+    size_t block_size_bytes, size_t num_workers) {
+  return std::unique_ptr<RawBatchReader>(new PreadRawBatchReader(
+      std::move(files), std::move(blocks), block_size_bytes, num_workers));
+}
+
+bool IsIoUringAvailable() {
+#ifdef __NR_io_uring_setup
+  static const bool available = []() {
+    struct io_uring_params params {};
+    const int fd = static_cast<int>(syscall(__NR_io_uring_setup, 1, &params));
+    if (fd < 0) { return false; }
+    PCHECK(close(fd) == 0);
+    return true;
+  }();
+  return available;
+#else
+  return false;
+#endif  // __NR_io_uring_setup
+}
+
+std::unique_ptr<RawBatchReader> NewIoUringRawBatchReader(
+    std::vector<std::unique_ptr<embedding::PosixFile>>&& files, std::vector<RawBlock>&& blocks,
+    size_t block_size_bytes, size_t queue_depth, bool direct_io) {
+#ifdef __NR_io_uring_setup
+  CHECK(IsIoUringAvailable()) << "io_uring is not available";
+  CHECK_GT(queue_depth, 0);
+  return std::unique_ptr<RawBatchReader>(new IoUringRawBatchReader(
+      std::move(files), std::move(blocks), block_size_bytes, queue_depth, direct_io));
+#else
+  UNIMPLEMENTED() << "io_uring is not available";
+  return nullptr;
+#endif  // __NR_io_uring_setup
+}
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -0,0 +1,73 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_RAW_BATCH_READER_H_
+#define ONEFLOW_USER_DATA_RAW_BATCH_READER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/embedding/posix_file.h"
+
+namespace oneflow {
+
+namespace data {
+
+// A block starts at offset_in_file of files[file_index] and may continue into the next files
+struct RawBlock {
+  size_t file_index;
+  size_t offset_in_file;
+};
+
+struct RawBatchRequest {
+  std::shared_ptr<std::vector<size_t>> blocks;
+  void* buffer{};
+};
+
+// Split the concatenation of files into num_blocks blocks, wrapping around at the end
+std::vector<RawBlock> MakeRawBlocks(const std::vector<std::unique_ptr<embedding::PosixFile>>& files,
+                                    size_t num_blocks, size_t block_size_bytes);
+
+// Read the blocks of each request into its buffer back-to-back.
+// Requests are completed in the order they are submitted.
+class RawBatchReader {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(RawBatchReader);
+  RawBatchReader() = default;
+  virtual ~RawBatchReader() = default;
+
+  virtual void SubmitRequest(RawBatchRequest&& request) = 0;
+  virtual void WaitCompleted(RawBatchRequest* request) = 0;
+};
+
+// Each worker thread issues one blocking pread for every block of its requests
+std::unique_ptr<RawBatchReader> NewPreadRawBatchReader(
+    std::vector<std::unique_ptr<embedding::PosixFile>>&& files, std::vector<RawBlock>&& blocks,
+    size_t block_size_bytes, size_t num_workers);
+
+// Whether the kernel supports io_uring and it is not forbidden by the sandbox
+bool IsIoUringAvailable();
+
+// A single thread keeps up to queue_depth reads in flight with io_uring, across requests.
+// Blocks adjacent in both the file and the buffer are coalesced into one read. If direct_io is
+// set, the files must be opened with O_DIRECT, and the reads not aligned to the logical block
+// size go through a pool of recycled aligned staging buffers.
+std::unique_ptr<RawBatchReader> NewIoUringRawBatchReader(
+    std::vector<std::unique_ptr<embedding::PosixFile>>&& files, std::vector<RawBlock>&& blocks,
+    size_t block_size_bytes, size_t queue_depth, bool direct_io);
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_RAW_BATCH_READER_H_
@@ -0,0 +1,184 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include "gtest/gtest.h"
+#include "oneflow/user/data/raw_batch_reader.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+// Files holding consecutive uint32 values, so that every byte tells its global offset
+std::vector<std::string> CreateFiles(const std::string& prefix,
+                                     const std::vector<size_t>& num_values) {
+  std::vector<std::string> filenames;
+  uint32_t value = 0;
+  for (size_t i = 0; i < num_values.size(); ++i) {
+    filenames.emplace_back(prefix + std::to_string(i));
+    std::vector<uint32_t> values(num_values[i]);
+    for (auto& v : values) { v = value++; }
+    FILE* file = fopen(filenames.back().c_str(), "wb");
+    CHECK(file != nullptr);
+    CHECK_EQ(fwrite(values.data(), sizeof(uint32_t), values.size(), file), values.size());
+    CHECK_EQ(fclose(file), 0);
+  }
+  return filenames;
+}
+
+void RemoveFiles(const std::vector<std::string>& filenames) {
+  for (const auto& filename : filenames) { std::remove(filename.c_str()); }
+}
+
+// Return an empty vector if the file system does not support the flags
+std::vector<std::unique_ptr<embedding::PosixFile>> OpenFiles(
+    const std::vector<std::string>& filenames, int flags) {
+  std::vector<std::unique_ptr<embedding::PosixFile>> files;
+  for (const auto& filename : filenames) {
+    const int fd = open(filename.c_str(), flags);
+    if (fd == -1) { return {}; }
+    PCHECK(close(fd) == 0);
+    files.emplace_back(new embedding::PosixFile(filename, flags, 0644));
+  }
+  return files;
+}
+
+using ReaderFactory = std::function<std::unique_ptr<RawBatchReader>(
+    std::vector<std::unique_ptr<embedding::PosixFile>>&&, std::vector<RawBlock>&&)>;
+
+// Read all the blocks in a shuffled order with queue_depth requests in flight and check them
+void ReadAllBlocks(const std::vector<std::string>& filenames, int flags, size_t total_values,
+                   size_t block_size_bytes, size_t blocks_per_request, size_t queue_depth,
+                   const ReaderFactory& factory) {
+  auto files = OpenFiles(filenames, flags);
+  CHECK(!files.empty());
+  const size_t num_blocks = total_values * sizeof(uint32_t) / block_size_bytes;
+  auto blocks = MakeRawBlocks(files, num_blocks, block_size_bytes);
+  std::vector<size_t> order(num_blocks);
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937_64 generator(0);
+  std::shuffle(order.begin(), order.end(), generator);
+  auto reader = factory(std::move(files), std::move(blocks));
+  const size_t num_requests = num_blocks / blocks_per_request;
+  const size_t request_bytes = RoundUp(block_size_bytes * blocks_per_request, 4096);
+  size_t next_request = 0;
+  const auto& Submit = [&](RawBatchRequest&& request) {
+    auto begin = order.begin() + next_request * blocks_per_request;
+    request.blocks->assign(begin, begin + blocks_per_request);
+    next_request += 1;
+    reader->SubmitRequest(std::move(request));
+  };
+  for (size_t i = 0; i < std::min(queue_depth, num_requests); ++i) {
+    RawBatchRequest request;
+    request.blocks = std::make_shared<std::vector<size_t>>();
+    request.buffer = aligned_alloc(4096, request_bytes);  // NOLINT
+    Submit(std::move(request));
+  }
+  for (size_t i = 0; i < num_requests; ++i) {
+    RawBatchRequest request;
+    reader->WaitCompleted(&request);
+    // Requests are completed in order
+    const auto* bytes = reinterpret_cast<const unsigned char*>(request.buffer);
+    std::vector<unsigned char> expected(block_size_bytes);
+    for (size_t j = 0; j < blocks_per_request; ++j) {
+      const size_t block_index = order.at(i * blocks_per_request + j);
+      for (size_t k = 0; k < block_size_bytes; ++k) {
+        const size_t offset = block_index * block_size_bytes + k;
+        const uint32_t value = static_cast<uint32_t>(offset / sizeof(uint32_t));
+        expected[k] = reinterpret_cast<const unsigned char*>(&value)[offset % sizeof(uint32_t)];
+      }
+      EXPECT_EQ(std::memcmp(bytes + j * block_size_bytes, expected.data(), block_size_bytes), 0)
+          << "block " << block_index << " mismatch";
+    }
+    if (next_request < num_requests) {
+      Submit(std::move(request));
+    } else {
+      free(request.buffer);  // NOLINT
+    }
+  }
+}
+
+ReaderFactory PreadFactory(size_t num_workers, size_t block_size_bytes) {
+  return [=](std::vector<std::unique_ptr<embedding::PosixFile>>&& files,
+             std::vector<RawBlock>&& blocks) {
+    return NewPreadRawBatchReader(std::move(files), std::move(blocks), block_size_bytes,
+                                  num_workers);
+  };
+}
+
+ReaderFactory IoUringFactory(size_t queue_depth, size_t block_size_bytes, bool direct_io) {
+  return [=](std::vector<std::unique_ptr<embedding::PosixFile>>&& files,
+             std::vector<RawBlock>&& blocks) {
+    return NewIoUringRawBatchReader(std::move(files), std::move(blocks), block_size_bytes,
+                                    queue_depth, direct_io);
+  };
+}
+
+}  // namespace
+
+TEST(RawBatchReader, pread) {
+  // Blocks of 1200 bytes cross the boundaries of files with unaligned sizes
+  const std::vector<size_t> num_values = {10007, 3001, 20000};
+  const size_t total_values = 33008;
+  const size_t block_size_bytes = 1200;
+  const auto filenames = CreateFiles("raw_batch_reader_test_pread_", num_values);
+  ReadAllBlocks(filenames, O_RDONLY, total_values, block_size_bytes, 4, 8,
+                PreadFactory(2, block_size_bytes));
+  RemoveFiles(filenames);
+}
+
+TEST(RawBatchReader, io_uring) {
+  if (!IsIoUringAvailable()) { GTEST_SKIP() << "io_uring is not available"; }
+  const std::vector<size_t> num_values = {10007, 3001, 20000};
+  const size_t total_values = 33008;
+  const auto filenames = CreateFiles("raw_batch_reader_test_io_uring_", num_values);
+  for (size_t block_size_bytes : {1200, 4096}) {
+    ReadAllBlocks(filenames, O_RDONLY, total_values, block_size_bytes, 4, 8,
+                  IoUringFactory(16, block_size_bytes, false));
+    if (!OpenFiles(filenames, O_RDONLY | O_DIRECT).empty()) {
+      ReadAllBlocks(filenames, O_RDONLY | O_DIRECT, total_values, block_size_bytes, 4, 8,
+                    IoUringFactory(16, block_size_bytes, true));
+    }
+  }
+  RemoveFiles(filenames);
+}
+
+TEST(RawBatchReader, large_requests) {
+  // 8MB in 64KB blocks read in a random order, with requests of 1MB
+  const size_t total_values = 2 * 1024 * 1024;
+  const size_t block_size_bytes = 64 * 1024;
+  const size_t blocks_per_request = 16;
+  const size_t queue_depth = 8;
+  const auto filenames = CreateFiles("raw_batch_reader_test_large_requests_", {total_values});
+  ReadAllBlocks(filenames, O_RDONLY, total_values, block_size_bytes, blocks_per_request,
+                queue_depth, PreadFactory(4, block_size_bytes));
+  if (IsIoUringAvailable()) {
+    ReadAllBlocks(filenames, O_RDONLY, total_values, block_size_bytes, blocks_per_request,
+                  queue_depth, IoUringFactory(64, block_size_bytes, false));
+    if (!OpenFiles(filenames, O_RDONLY | O_DIRECT).empty()) {
+      ReadAllBlocks(filenames, O_RDONLY | O_DIRECT, total_values, block_size_bytes,
+                    blocks_per_request, queue_depth, IoUringFactory(64, block_size_bytes, true));
+    }
+  }
+  RemoveFiles(filenames);
+}
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/framework/user_op_tensor.h"
 #include <opencv2/opencv.hpp>
+#include <array>
 
 namespace oneflow {
 
@@ -46,6 +47,42 @@ int GetCvInterpolationFlag(const std::string& inter_type, int org_w, int org_h,
                            int res_h);
 bool CheckInterpolationValid(const std::string& interp_type, std::ostringstream& ss);
 
+// How resized RGB images are written into the output of the fused image decoder
+struct ImageOutputParam {
+  DataType data_type = DataType::kUInt8;
+  bool channels_first = false;
+  std::array<float, 3> mean{};
+  std::array<float, 3> inv_std{1, 1, 1};
+};
+
+// Mirror, normalize and convert the layout in one pass over a resized HWC image
+template<typename T>
+void NormalizeImage(const unsigned char* src, int height, int width, bool bgr, bool mirror,
+                    const ImageOutputParam& param, T* dst) {
+  constexpr int kNumChannels = 3;
+  for (int c = 0; c < kNumChannels; ++c) {
+    const int src_c = bgr ? kNumChannels - 1 - c : c;
+    const float scale = param.inv_std[c];
+    const float bias = -param.mean[c] * param.inv_std[c];
+    const int64_t dst_c_stride = param.channels_first ? 1 : kNumChannels;
+    for (int h = 0; h < height; ++h) {
+      const unsigned char* src_row = src + h * width * kNumChannels + src_c;
+      T* dst_row = param.channels_first ? dst + (c * height + h) * width
+                                        : dst + h * width * kNumChannels + c;
+      if (mirror) {
+        for (int w = 0; w < width; ++w) {
+          dst_row[w * dst_c_stride] =
+              static_cast<T>(src_row[(width - 1 - w) * kNumChannels] * scale + bias);
+        }
+      } else {
+        for (int w = 0; w < width; ++w) {
+          dst_row[w * dst_c_stride] = static_cast<T>(src_row[w * kNumChannels] * scale + bias);
+        }
+      }
+    }
+  }
+}
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_USER_IMAGE_IMAGE_UTIL_H_
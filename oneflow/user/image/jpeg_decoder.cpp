@@ -35,10 +35,35 @@ class LibjpegCtx {
   struct jpeg_decompress_struct* compress_info_;
 };
 
+namespace {
+
+// The largest denominator in {1, 2, 4, 8} of the DCT scaling, which keeps the crop no smaller
+// than min_width x min_height
+int GetDctScaleDenom(unsigned int crop_w, unsigned int crop_h, int min_width, int min_height) {
+  if (min_width <= 0 || min_height <= 0) { return 1; }
+  int scale_denom = 8;
+  while (scale_denom > 1
+         && (crop_w < scale_denom * static_cast<unsigned int>(min_width)
+             || crop_h < scale_denom * static_cast<unsigned int>(min_height))) {
+    scale_denom /= 2;
+  }
+  return scale_denom;
+}
+
+}  // namespace
+
 bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                       RandomCropGenerator* random_crop_gen,
                                       unsigned char* workspace, size_t workspace_size,
                                       cv::Mat* out_mat) {
+  return JpegPartialDecodeRandomCropScaledImage(data, length, random_crop_gen, 0, 0, workspace,
+                                                workspace_size, out_mat);
+}
+
+bool JpegPartialDecodeRandomCropScaledImage(const unsigned char* data, size_t length,
+                                            RandomCropGenerator* random_crop_gen, int min_width,
+                                            int min_height, unsigned char* workspace,
+                                            size_t workspace_size, cv::Mat* out_mat) {
   struct jpeg_decompress_struct compress_info {};
   struct jpeg_error_mgr jpeg_err {};
   compress_info.err = jpeg_std_error(&jpeg_err);
@@ -52,22 +77,54 @@ bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
 
   int rc = jpeg_read_header(ctx_guard.compress_info(), TRUE);
   if (rc != JPEG_HEADER_OK) { return false; }
+  // libjpeg can not convert CMYK to RGB
+  if (ctx_guard.compress_info()->jpeg_color_space == JCS_CMYK
+      || ctx_guard.compress_info()->jpeg_color_space == JCS_YCCK) {
+    return false;
+  }
+  ctx_guard.compress_info()->out_color_space = JCS_RGB;
 
-  jpeg_start_decompress(ctx_guard.compress_info());
-  int width = ctx_guard.compress_info()->output_width;
-  int height = ctx_guard.compress_info()->output_height;
-  int pixel_size = ctx_guard.compress_info()->output_components;
-
-  unsigned int u_crop_x = 0, u_crop_y = 0, u_crop_w = width, u_crop_h = height;
+  const unsigned int image_width = ctx_guard.compress_info()->image_width;
+  const unsigned int image_height = ctx_guard.compress_info()->image_height;
+  unsigned int u_crop_x = 0, u_crop_y = 0, u_crop_w = image_width, u_crop_h = image_height;
   if (random_crop_gen) {
     CropWindow crop;
-    random_crop_gen->GenerateCropWindow({height, width}, &crop);
+    random_crop_gen->GenerateCropWindow({image_height, image_width}, &crop);
     u_crop_y = crop.anchor.At(0);
     u_crop_x = crop.anchor.At(1);
     u_crop_h = crop.shape.At(0);
     u_crop_w = crop.shape.At(1);
   }
 
+  // Downscale in the DCT domain, which skips most of the IDCT and upsampling work
+  const int scale_denom = GetDctScaleDenom(u_crop_w, u_crop_h, min_width, min_height);
+  if (scale_denom > 1) {
+    ctx_guard.compress_info()->scale_num = 1;
+    ctx_guard.compress_info()->scale_denom = scale_denom;
+    jpeg_calc_output_dimensions(ctx_guard.compress_info());
+    const unsigned int output_width = ctx_guard.compress_info()->output_width;
+    const unsigned int output_height = ctx_guard.compress_info()->output_height;
+    const auto& ScaleDown = [](unsigned int pos, unsigned int from, unsigned int to) {
+      return static_cast<unsigned int>(static_cast<uint64_t>(pos) * to / from);
+    };
+    const auto& ScaleUp = [](unsigned int pos, unsigned int from, unsigned int to) {
+      return static_cast<unsigned int>((static_cast<uint64_t>(pos) * to + from - 1) / from);
+    };
+    const unsigned int crop_x_end =
+        std::min(ScaleUp(u_crop_x + u_crop_w, image_width, output_width), output_width);
+    const unsigned int crop_y_end =
+        std::min(ScaleUp(u_crop_y + u_crop_h, image_height, output_height), output_height);
+    u_crop_x = ScaleDown(u_crop_x, image_width, output_width);
+    u_crop_y = ScaleDown(u_crop_y, image_height, output_height);
+    u_crop_w = std::max(crop_x_end, u_crop_x + 1) - u_crop_x;
+    u_crop_h = std::max(crop_y_end, u_crop_y + 1) - u_crop_y;
+  }
+
+  jpeg_start_decompress(ctx_guard.compress_info());
+  int width = ctx_guard.compress_info()->output_width;
+  int height = ctx_guard.compress_info()->output_height;
+  int pixel_size = ctx_guard.compress_info()->output_components;
+
   unsigned int tmp_w = u_crop_w;
   jpeg_crop_scanline(ctx_guard.compress_info(), &u_crop_x, &tmp_w);
   if (jpeg_skip_scanlines(ctx_guard.compress_info(), u_crop_y) != u_crop_y) { return false; }
@@ -84,7 +141,13 @@ bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
   } else {
     decode_output_pointer = workspace;
   }
-  out_mat->create(u_crop_h, u_crop_w, CV_8UC3);
+  // Decode into the rest of the workspace if it is large enough, saving an allocation per image
+  const size_t out_offset = RoundUp(image_space_size, kCudaAlignSize);
+  if (workspace != nullptr && out_offset + u_crop_h * out_row_stride <= workspace_size) {
+    *out_mat = cv::Mat(u_crop_h, u_crop_w, CV_8UC3, workspace + out_offset);
+  } else {
+    out_mat->create(u_crop_h, u_crop_w, CV_8UC3);
+  }
 
   while (ctx_guard.compress_info()->output_scanline < u_crop_y + u_crop_h) {
     unsigned char* buffer_array[1];
@@ -27,6 +27,14 @@ bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                       unsigned char* workspace, size_t workspace_size,
                                       cv::Mat* out_mat);
 
+// Same as JpegPartialDecodeRandomCropImage, but the crop is downscaled while decoding by the
+// largest factor in {1/2, 1/4, 1/8} which keeps it no smaller than min_width x min_height.
+// The output may live in the workspace, and it is always RGB.
+bool JpegPartialDecodeRandomCropScaledImage(const unsigned char* data, size_t length,
+                                            RandomCropGenerator* random_crop_gen, int min_width,
+                                            int min_height, unsigned char* workspace,
+                                            size_t workspace_size, cv::Mat* out_mat);
+
 void OpenCvPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                         RandomCropGenerator* random_crop_gen,
                                         const std::string& color_space, cv::Mat& out_mat);
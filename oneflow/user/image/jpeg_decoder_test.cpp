@@ -23,6 +23,7 @@ limitations under the License.
 #include <opencv2/opencv.hpp>
 #include "oneflow/user/image/jpeg_decoder.h"
 #include "oneflow/user/image/image_util.h"
+#include "oneflow/core/common/bfloat16.h"
 
 namespace oneflow {
 
@@ -93,4 +94,139 @@ TEST(JPEG, decoder) {
   }
 }
 
+TEST(JPEG, scaled_decoder) {
+  std::vector<unsigned char> jpg;
+  GenerateImage(jpg, 192, 192);
+  // The whole image is cropped, and 1/4 is the largest scale keeping it no smaller than 40x40
+  RandomCropGenerator random_crop_gen({1.0, 1.0}, {1.0, 1.0}, 0, 1);
+  std::vector<unsigned char> workspace(192 * 192 * 3 + kCudaAlignSize);
+  cv::Mat scaled_image_mat;
+  ASSERT_TRUE(JpegPartialDecodeRandomCropScaledImage(jpg.data(), jpg.size(), &random_crop_gen, 40,
+                                                     40, workspace.data(), workspace.size(),
+                                                     &scaled_image_mat));
+  ASSERT_EQ(scaled_image_mat.cols, 48);
+  ASSERT_EQ(scaled_image_mat.rows, 48);
+
+  cv::Mat image_mat;
+  ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpg.data(), jpg.size(), nullptr, nullptr, 0,
+                                               &image_mat));
+  cv::Mat resized_image_mat;
+  cv::resize(image_mat, resized_image_mat, cv::Size(48, 48), 0, 0, cv::INTER_AREA);
+  // Only the pixels away from the quadrant edges are compared
+  for (int y : {8, 40}) {
+    for (int x : {8, 40}) {
+      const auto& scaled = scaled_image_mat.at<cv::Vec3b>(y, x);
+      const auto& resized = resized_image_mat.at<cv::Vec3b>(y, x);
+      for (int c = 0; c < 3; ++c) { ASSERT_NEAR(scaled[c], resized[c], 8); }
+    }
+  }
+}
+
+namespace {
+
+// Decodes the generated image and resizes it to the given size as the fused decoder does
+cv::Mat DecodeAndResize(int target_width, int target_height) {
+  std::vector<unsigned char> jpg;
+  GenerateImage(jpg, 192, 192);
+  cv::Mat image_mat;
+  CHECK(JpegPartialDecodeRandomCropImage(jpg.data(), jpg.size(), nullptr, nullptr, 0, &image_mat));
+  cv::Mat resized;
+  cv::resize(image_mat, resized, cv::Size(target_width, target_height), 0, 0, cv::INTER_LINEAR);
+  return resized;
+}
+
+ImageOutputParam GetImageNetOutputParam(DataType data_type, bool channels_first) {
+  ImageOutputParam param;
+  param.data_type = data_type;
+  param.channels_first = channels_first;
+  param.mean = {123.68f, 116.779f, 103.939f};
+  param.inv_std = {1.0f / 58.393f, 1.0f / 57.12f, 1.0f / 57.375f};
+  return param;
+}
+
+// The unfused path: decode, flip, normalize the HWC image in float and transpose it at last
+std::vector<float> DecodeThenNormalize(const cv::Mat& resized, bool mirror,
+                                       const ImageOutputParam& param) {
+  cv::Mat image = resized.clone();
+  if (mirror) { cv::flip(image, image, 1); }
+  const int height = image.rows;
+  const int width = image.cols;
+  std::vector<float> out(height * width * 3);
+  for (int h = 0; h < height; ++h) {
+    for (int w = 0; w < width; ++w) {
+      const auto& pixel = image.at<cv::Vec3b>(h, w);
+      for (int c = 0; c < 3; ++c) {
+        const float value = (pixel[c] - param.mean[c]) * param.inv_std[c];
+        const int64_t offset =
+            param.channels_first ? (c * height + h) * width + w : (h * width + w) * 3 + c;
+        out[offset] = value;
+      }
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(JPEG, fused_normalize_float) {
+  const cv::Mat resized = DecodeAndResize(40, 24);
+  for (bool channels_first : {false, true}) {
+    for (bool mirror : {false, true}) {
+      const ImageOutputParam param = GetImageNetOutputParam(DataType::kFloat, channels_first);
+      std::vector<float> fused(resized.total() * 3);
+      NormalizeImage<float>(resized.data, resized.rows, resized.cols, false, mirror, param,
+                            fused.data());
+      const std::vector<float> expected = DecodeThenNormalize(resized, mirror, param);
+      for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_NEAR(fused[i], expected[i], 1e-5) << "channels_first " << channels_first
+                                                 << " mirror " << mirror << " index " << i;
+      }
+    }
+  }
+}
+
+TEST(JPEG, fused_normalize_bgr_input) {
+  const cv::Mat resized = DecodeAndResize(40, 24);
+  cv::Mat bgr;
+  cv::cvtColor(resized, bgr, cv::COLOR_RGB2BGR);
+  const ImageOutputParam param = GetImageNetOutputParam(DataType::kFloat, true);
+  std::vector<float> fused(resized.total() * 3);
+  NormalizeImage<float>(bgr.data, bgr.rows, bgr.cols, true, true, param, fused.data());
+  const std::vector<float> expected = DecodeThenNormalize(resized, true, param);
+  for (size_t i = 0; i < expected.size(); ++i) { ASSERT_NEAR(fused[i], expected[i], 1e-5); }
+}
+
+TEST(JPEG, fused_normalize_bfloat16) {
+  const cv::Mat resized = DecodeAndResize(40, 24);
+  const ImageOutputParam param = GetImageNetOutputParam(DataType::kBFloat16, true);
+  std::vector<bfloat16> fused(resized.total() * 3);
+  NormalizeImage<bfloat16>(resized.data, resized.rows, resized.cols, false, true, param,
+                           fused.data());
+  const std::vector<float> expected = DecodeThenNormalize(resized, true, param);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    // bfloat16 keeps 8 significant bits
+    ASSERT_NEAR(static_cast<float>(fused[i]), expected[i], std::abs(expected[i]) / 128 + 1e-3);
+  }
+}
+
+TEST(JPEG, fused_uint8_nchw) {
+  const cv::Mat resized = DecodeAndResize(40, 24);
+  ImageOutputParam param;
+  param.channels_first = true;
+  std::vector<unsigned char> fused(resized.total() * 3);
+  NormalizeImage<unsigned char>(resized.data, resized.rows, resized.cols, false, true, param,
+                                fused.data());
+  cv::Mat flipped;
+  cv::flip(resized, flipped, 1);
+  std::vector<cv::Mat> planes;
+  cv::split(flipped, planes);
+  for (int c = 0; c < 3; ++c) {
+    for (int h = 0; h < resized.rows; ++h) {
+      for (int w = 0; w < resized.cols; ++w) {
+        ASSERT_EQ(fused[(c * resized.rows + h) * resized.cols + w], planes[c].at<uint8_t>(h, w));
+      }
+    }
+  }
+}
+
 }  // namespace oneflow
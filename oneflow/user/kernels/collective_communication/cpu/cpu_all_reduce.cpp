@@ -120,9 +120,9 @@ struct AllReduceImpl final {
 
 #define MAKE_ALL_REDUCE_ENTRY(func_name, T, reduce_type) func_name<T, reduce_type>::Call
 
-DEFINE_STATIC_SWITCH_FUNC(Maybe<void>, AllReduceImpl, MAKE_ALL_REDUCE_ENTRY,  // NOLINT
-                          MAKE_DATA_TYPE_CTRV_SEQ(POD_DATA_TYPE_SEQ),         // NOLINT
-                          REDUCE_TYPE_CTRV_SEQ);                              // NOLINT
+DEFINE_STATIC_SWITCH_FUNC(Maybe<void>, AllReduceImpl, MAKE_ALL_REDUCE_ENTRY,    // NOLINT
+                          MAKE_DATA_TYPE_CTRV_SEQ(POD_AND_HALF_DATA_TYPE_SEQ),  // NOLINT
+                          REDUCE_TYPE_CTRV_SEQ);                                // NOLINT
 
 #undef MAKE_ALL_REDUCE_ENTRY
 
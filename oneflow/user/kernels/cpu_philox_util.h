@@ -0,0 +1,78 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CPU_PHILOX_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CPU_PHILOX_UTIL_H_
+
+#include "oneflow/core/ep/cpu/cpu_random_generator.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+// Uniform in [0, 1) from the high 24 bits
+inline float PhiloxUniformFloat(uint32_t x) {
+  return static_cast<float>(x >> 8) * (1.0f / static_cast<float>(1 << 24));
+}
+
+// Uniform in [0, 1) from the high 53 bits of (hi, lo)
+inline double PhiloxUniformDouble(uint32_t hi, uint32_t lo) {
+  const uint64_t x = (static_cast<uint64_t>(hi) << 32) | lo;
+  return static_cast<double>(x >> 11) * (1.0 / static_cast<double>(1ULL << 53));
+}
+
+// Uniform in [0, 1) of T from kNumPerElem philox numbers
+template<typename T>
+struct PhiloxUniform;
+
+template<>
+struct PhiloxUniform<float> {
+  static constexpr int64_t kNumPerElem = 1;
+  static float Get(const uint32_t* numbers) { return PhiloxUniformFloat(numbers[0]); }
+};
+
+template<>
+struct PhiloxUniform<double> {
+  static constexpr int64_t kNumPerElem = 2;
+  static double Get(const uint32_t* numbers) { return PhiloxUniformDouble(numbers[0], numbers[1]); }
+};
+
+// At namespace scope, gcc 12 crashes on local constexprs sizing an array in a lambda of a template
+constexpr int64_t kPhiloxMaxNumPerElem = 4;
+constexpr int64_t kPhiloxBatchSize = 1024;
+
+// Calls fn(i, numbers) for every i in [0, n) in parallel, where numbers points to the
+// num_per_elem philox numbers of element i. Element i always gets the numbers at
+// offset + i * num_per_elem of the stream, so the result does not depend on the number of threads.
+template<typename F>
+void PhiloxParallelForEach(ep::Stream* stream, ep::CPUGenerator* generator, int64_t n,
+                           int64_t num_per_elem, const F& fn) {
+  CHECK_GT(num_per_elem, 0);
+  CHECK_LE(num_per_elem, kPhiloxMaxNumPerElem);
+  if (n <= 0) { return; }
+  const uint64_t offset = generator->get_philox_offset(n * num_per_elem);
+  const ep::Philox4x32Engine engine = generator->philox_engine();
+  stream->As<ep::CpuStream>()->ParallelFor(0, n, [&](int64_t begin, int64_t end) {
+    uint32_t numbers[kPhiloxBatchSize * kPhiloxMaxNumPerElem];
+    for (int64_t start = begin; start < end; start += kPhiloxBatchSize) {
+      const int64_t size = std::min(kPhiloxBatchSize, end - start);
+      engine.Fill(offset + start * num_per_elem, size * num_per_elem, numbers);
+      for (int64_t i = 0; i < size; ++i) { fn(start + i, numbers + i * num_per_elem); }
+    }
+  });
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CPU_PHILOX_UTIL_H_
@@ -0,0 +1,119 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/cpu_philox_util.h"
+#include "oneflow/user/kernels/distributions/normal_distribution.h"
+#include "oneflow/user/kernels/distributions/uniform_distribution.h"
+#include "oneflow/user/kernels/random_mask_generator.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/thread/thread_runtime.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+namespace oneflow {
+namespace test {
+
+namespace {
+
+// Several grains of ParallelFor, with a tail that is not a multiple of the philox block
+constexpr int64_t kElemCnt = (1 << 20) + 7;
+constexpr uint64_t kSeed = 1234;
+
+std::vector<size_t> ThreadNums() {
+  const size_t max_thread_num = std::max<size_t>(std::thread::hardware_concurrency(), 3);
+  return {1, 2, max_thread_num};
+}
+
+class PhiloxKernelTest : public testing::Test {
+ protected:
+  PhiloxKernelTest() : device_(nullptr) {
+    setenv("ONEFLOW_CPU_RANDOM_GENERATOR_USE_PHILOX", "1", 1);
+    cpu_generator_ = std::make_shared<ep::CPUGenerator>(kSeed, 0);
+    unsetenv("ONEFLOW_CPU_RANDOM_GENERATOR_USE_PHILOX");
+    generator_ = std::make_shared<one::Generator>(cpu_generator_);
+  }
+
+  // Runs fn(stream, out) with the generator reseeded, on a stream of each thread number, and
+  // expects the outputs to be bitwise identical
+  template<typename T, typename F>
+  void ExpectSameForAnyThreadNum(const F& fn) {
+    ASSERT_TRUE(cpu_generator_->use_philox());
+    // bytes rather than std::vector<T>, which has no data() for bool
+    std::vector<char> expected;
+    for (size_t thread_num : ThreadNums()) {
+      ep::CpuStream stream(&device_,
+                           std::make_shared<thread::OfRuntime>(thread_num, std::vector<int32_t>()),
+                           thread_num, std::vector<int32_t>());
+      generator_->set_current_seed(kSeed);
+      std::vector<char> out(kElemCnt * sizeof(T));
+      fn(&stream, reinterpret_cast<T*>(out.data()));
+      // the next call continues the stream instead of repeating it
+      std::vector<char> next(kElemCnt * sizeof(T));
+      fn(&stream, reinterpret_cast<T*>(next.data()));
+      ASSERT_TRUE(out != next);
+      if (expected.empty()) {
+        expected = std::move(out);
+      } else {
+        ASSERT_TRUE(expected == out) << "thread num " << thread_num;
+      }
+    }
+  }
+
+  ep::CpuDevice device_;
+  std::shared_ptr<ep::CPUGenerator> cpu_generator_;
+  std::shared_ptr<one::Generator> generator_;
+};
+
+}  // namespace
+
+TEST_F(PhiloxKernelTest, uniform) {
+  ExpectSameForAnyThreadNum<float>([&](ep::Stream* stream, float* out) {
+    UniformDistribution<DeviceType::kCPU, float>(-1, 2)(stream, kElemCnt, out, generator_);
+  });
+  ExpectSameForAnyThreadNum<double>([&](ep::Stream* stream, double* out) {
+    UniformDistribution<DeviceType::kCPU, double>(-1, 2)(stream, kElemCnt, out, generator_);
+  });
+  ExpectSameForAnyThreadNum<float16>([&](ep::Stream* stream, float16* out) {
+    UniformDistribution<DeviceType::kCPU, float16>(static_cast<float16>(-1.0f),
+                                                   static_cast<float16>(2.0f))(stream, kElemCnt,
+                                                                               out, generator_);
+  });
+}
+
+TEST_F(PhiloxKernelTest, normal) {
+  ExpectSameForAnyThreadNum<float>([&](ep::Stream* stream, float* out) {
+    NormalDistribution<DeviceType::kCPU, float>(0.5, 2)(stream, kElemCnt, out, generator_);
+  });
+  ExpectSameForAnyThreadNum<double>([&](ep::Stream* stream, double* out) {
+    NormalDistribution<DeviceType::kCPU, double>(0.5, 2)(stream, kElemCnt, out, generator_);
+  });
+  ExpectSameForAnyThreadNum<float16>([&](ep::Stream* stream, float16* out) {
+    NormalDistribution<DeviceType::kCPU, float16>(static_cast<float16>(0.5f),
+                                                  static_cast<float16>(2.0f))(stream, kElemCnt,
+                                                                              out, generator_);
+  });
+}
+
+TEST_F(PhiloxKernelTest, random_mask) {
+  ExpectSameForAnyThreadNum<bool>([&](ep::Stream* stream, bool* out) {
+    RandomMaskGenerator<DeviceType::kCPU>(generator_).Generate(stream, kElemCnt, 0.3, out);
+  });
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -0,0 +1,666 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/hash_container.h"
+#include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/framework/transport_util.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr uint32_t kPaddingRevIndex = 0xffffffff;
+constexpr size_t kRowGrainSize = 64;
+constexpr size_t kColGrainSize = 16;
+
+class CpuDataShuffleKernelState final : public user_op::OpKernelState {
+ public:
+  explicit CpuDataShuffleKernelState(user_op::KernelInitContext* ctx)
+      : parallel_desc_(ctx->parallel_desc()) {
+    const std::string& embedding_name = ctx->Attr<std::string>("embedding_name");
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    embedding_state_ = Singleton<embedding::EmbeddingManager>::Get()->GetEmbeddingState(
+        embedding_name, parallel_id);
+  }
+  ~CpuDataShuffleKernelState() override = default;
+
+  const ParallelDesc& parallel_desc() const { return parallel_desc_; }
+  embedding::EmbeddingState* EmbeddingState() { return embedding_state_; }
+
+ private:
+  ParallelDesc parallel_desc_;
+  embedding::EmbeddingState* embedding_state_;
+};
+
+// Sends send_sizes[i] bytes to and receives recv_sizes[i] bytes from the i-th rank of the
+// placement, the sizes of each pair of ranks have to agree.
+Maybe<void> AllToAll(const ParallelDesc& parallel_desc, int64_t parallel_id,
+                     const std::vector<const char*>& send_ptrs,
+                     const std::vector<size_t>& send_sizes, const std::vector<char*>& recv_ptrs,
+                     const std::vector<size_t>& recv_sizes) {
+  const int64_t parallel_num = parallel_desc.parallel_num();
+  CHECK_EQ_OR_RETURN(send_sizes.at(parallel_id), recv_sizes.at(parallel_id));
+  if (send_sizes.at(parallel_id) > 0 && recv_ptrs.at(parallel_id) != send_ptrs.at(parallel_id)) {
+    std::memcpy(recv_ptrs.at(parallel_id), send_ptrs.at(parallel_id), send_sizes.at(parallel_id));
+  }
+  if (parallel_num == 1) { return Maybe<void>::Ok(); }
+  TransportToken transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  for (int64_t step = 1; step < parallel_num; ++step) {
+    const int64_t dst = (parallel_id + step) % parallel_num;
+    const int64_t src = (parallel_id - step + parallel_num) % parallel_num;
+    NaiveAsyncTransportCtx transport_ctx(
+        transport_token,
+        [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+          *buffer = const_cast<char*>(send_ptrs.at(dst));
+          *size = send_sizes.at(dst);
+          *Cb = [] {};
+          return Maybe<void>::Ok();
+        },
+        [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+          *buffer = recv_ptrs.at(src);
+          *size = recv_sizes.at(src);
+          *Cb = [] {};
+          return Maybe<void>::Ok();
+        });
+    if (send_sizes.at(dst) > 0) {
+      JUST(TransportUtil::SendDataToRank(JUST(parallel_desc.MachineId4ParallelId(dst)),
+                                         transport_token, &transport_ctx));
+    }
+    if (recv_sizes.at(src) > 0) {
+      JUST(TransportUtil::ReceiveDataFromRank(JUST(parallel_desc.MachineId4ParallelId(src)),
+                                              transport_token, &transport_ctx));
+    }
+    JUST(transport_ctx.WaitDone());
+  }
+  return Maybe<void>::Ok();
+}
+
+// Sends the rows of the i-th partition of send_rows to the i-th rank and receives the rows of
+// the rank in the i-th partition of recv_rows, the partitions are contiguous in both buffers.
+template<typename T>
+void ShuffleRows(const ParallelDesc& parallel_desc, int64_t parallel_id,
+                 const std::vector<int64_t>& send_offsets, const std::vector<int64_t>& send_rows,
+                 const T* send_data, const std::vector<int64_t>& recv_rows, int64_t row_size,
+                 T* recv_data) {
+  const int64_t parallel_num = parallel_desc.parallel_num();
+  std::vector<const char*> send_ptrs(parallel_num);
+  std::vector<size_t> send_sizes(parallel_num);
+  std::vector<char*> recv_ptrs(parallel_num);
+  std::vector<size_t> recv_sizes(parallel_num);
+  int64_t recv_offset = 0;
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    send_ptrs.at(i) = reinterpret_cast<const char*>(send_data + send_offsets.at(i) * row_size);
+    send_sizes.at(i) = send_rows.at(i) * row_size * sizeof(T);
+    recv_ptrs.at(i) = reinterpret_cast<char*>(recv_data + recv_offset * row_size);
+    recv_sizes.at(i) = recv_rows.at(i) * row_size * sizeof(T);
+    recv_offset += recv_rows.at(i);
+  }
+  CHECK_JUST(AllToAll(parallel_desc, parallel_id, send_ptrs, send_sizes, recv_ptrs, recv_sizes));
+}
+
+std::vector<int64_t> ExclusivePrefixSum(const std::vector<int64_t>& counts) {
+  std::vector<int64_t> offsets(counts.size());
+  int64_t sum = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    offsets.at(i) = sum;
+    sum += counts.at(i);
+  }
+  return offsets;
+}
+
+// The number of ids the rank sends to (row) and receives from (col) every rank, row i of the
+// matrix holds the number of unique ids of rank i for each partition.
+void GetShuffleRows(const std::vector<uint32_t>& num_unique_matrix, int64_t parallel_id,
+                    int64_t parallel_num, std::vector<int64_t>* row, std::vector<int64_t>* col) {
+  row->resize(parallel_num);
+  col->resize(parallel_num);
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    row->at(i) = num_unique_matrix.at(parallel_id * parallel_num + i);
+    col->at(i) = num_unique_matrix.at(i * parallel_num + parallel_id);
+  }
+}
+
+// Unlike the hash table of the cuda kernel, the unique ids of a partition are in the order of
+// their first occurrence, and partition i starts at i * num_keys.
+template<typename K, typename V, typename IDX>
+void UniqueAndPartition(int64_t num_keys, int64_t num_partition, const K* keys, const V* values,
+                        IDX* num_partitioned_unique, K* partitioned_unique_keys,
+                        V* partitioned_unique_values, IDX* inverse_indices,
+                        bool need_process_values, bool has_padding_idx, int64_t padding_idx) {
+  std::fill(num_partitioned_unique, num_partitioned_unique + num_partition, 0);
+  HashMap<K, IDX> key2index;
+  key2index.reserve(num_keys);
+  for (int64_t i = 0; i < num_keys; ++i) {
+    const K key = keys[i];
+    if (has_padding_idx && static_cast<int64_t>(key) == padding_idx) {
+      inverse_indices[i] = static_cast<IDX>(kPaddingRevIndex);
+      continue;
+    }
+    auto it = key2index.find(key);
+    if (it == key2index.end()) {
+      const int64_t partition_id =
+          num_partition == 1 ? 0 : embedding::ShardingHash()(key) % num_partition;
+      const IDX index = partition_id * num_keys + num_partitioned_unique[partition_id];
+      num_partitioned_unique[partition_id] += 1;
+      partitioned_unique_keys[index] = key;
+      if (need_process_values) { partitioned_unique_values[index] = values[i]; }
+      it = key2index.emplace(key, index).first;
+    }
+    inverse_indices[i] = it->second;
+  }
+}
+
+template<typename U>
+std::vector<U> GenerateTableIds(int64_t num_ids, int32_t num_tables) {
+  std::vector<U> table_ids(num_ids);
+  for (int64_t i = 0; i < num_ids; ++i) { table_ids.at(i) = i % num_tables; }
+  return table_ids;
+}
+
+// The rows of out whose index is out of range, like the padding ids, are zeros.
+template<typename T, typename IDX>
+void GatherRows(ep::Stream* stream, const IDX* indices, int64_t num_indices, const T* in,
+                int64_t num_rows, int64_t row_size, T* out) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_indices,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t index = static_cast<int64_t>(indices[i]);
+          T* out_row = out + i * row_size;
+          if (index >= 0 && index < num_rows) {
+            std::copy(in + index * row_size, in + (index + 1) * row_size, out_row);
+          } else {
+            std::fill(out_row, out_row + row_size, static_cast<T>(0));
+          }
+        }
+      },
+      kRowGrainSize);
+}
+
+// out[indices[i]] += in[i], the threads own disjoint columns so that no row is written twice.
+template<typename T, typename IDX>
+void UnsortedSegmentSumRows(ep::Stream* stream, const IDX* indices, int64_t num_indices,
+                            const T* in, int64_t num_rows, int64_t row_size, T* out) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, row_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = 0; i < num_indices; ++i) {
+          const int64_t index = static_cast<int64_t>(indices[i]);
+          if (index < 0 || index >= num_rows) { continue; }
+          const T* in_row = in + i * row_size;
+          T* out_row = out + index * row_size;
+          for (int64_t col = begin; col < end; ++col) { out_row[col] += in_row[col]; }
+        }
+      },
+      kColGrainSize);
+}
+
+}  // namespace
+
+template<typename K, typename U, typename IDX>
+class CpuIdShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuIdShuffleKernel() : current_iter_(0) {}
+  ~CpuIdShuffleKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_num_unique = ctx->Tensor4ArgNameAndIndex("cur_rank_num_unique", 0);
+    user_op::Tensor* cur_rank_unique_ids = ctx->Tensor4ArgNameAndIndex("cur_rank_unique_ids", 0);
+    user_op::Tensor* cur_rank_unique_table_ids =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_table_ids", 0);
+    user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    const bool has_padding_idx = ctx->Attr<bool>("has_padding_idx");
+    const bool has_table_ids = ctx->has_input("table_ids", 0);
+    const bool need_gen_table_ids = (!has_table_ids && num_tables > 1);
+    const bool need_process_table_ids = (has_table_ids || num_tables > 1);
+    const int64_t num_ids = ids->shape_view().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    const ParallelDesc& parallel_desc = kernel_state->parallel_desc();
+    CHECK_EQ(sizeof(IDX), sizeof(uint32_t)) << "assume sizeof(IDX) equals to sizeof(uint32_t)";
+
+    std::vector<U> generated_table_ids;
+    const U* table_ids_ptr = nullptr;
+    if (has_table_ids) {
+      table_ids_ptr = ctx->Tensor4ArgNameAndIndex("table_ids", 0)->dptr<U>();
+    } else if (need_gen_table_ids) {
+      generated_table_ids = GenerateTableIds<U>(num_ids, num_tables);
+      table_ids_ptr = generated_table_ids.data();
+    }
+    // 1. unique and partition the ids by the rank holding them
+    std::vector<IDX> num_partitioned_unique(parallel_num);
+    std::vector<K> partitioned_unique_ids(parallel_num * num_ids);
+    std::vector<U> partitioned_unique_table_ids(need_process_table_ids ? parallel_num * num_ids
+                                                                       : 0);
+    IDX* inverse_ptr = inverse_unique_partition_indices->mut_dptr<IDX>();
+    UniqueAndPartition<K, U, IDX>(num_ids, parallel_num, ids->dptr<K>(), table_ids_ptr,
+                                  num_partitioned_unique.data(), partitioned_unique_ids.data(),
+                                  partitioned_unique_table_ids.data(), inverse_ptr,
+                                  need_process_table_ids, has_padding_idx, padding_idx);
+
+    // 2. all gather the number of unique ids of every partition
+    IDX* matrix_ptr = num_unique_matrix->mut_dptr<IDX>();
+    {
+      const size_t row_bytes = parallel_num * sizeof(IDX);
+      std::vector<const char*> send_ptrs(
+          parallel_num, reinterpret_cast<const char*>(num_partitioned_unique.data()));
+      std::vector<size_t> sizes(parallel_num, row_bytes);
+      std::vector<char*> recv_ptrs(parallel_num);
+      for (int64_t i = 0; i < parallel_num; ++i) {
+        recv_ptrs.at(i) = reinterpret_cast<char*>(matrix_ptr + i * parallel_num);
+      }
+      CHECK_JUST(AllToAll(parallel_desc, parallel_id, send_ptrs, sizes, recv_ptrs, sizes));
+    }
+    std::vector<uint32_t> num_unique_matrix_vec(parallel_num * parallel_num);
+    std::memcpy(num_unique_matrix_vec.data(), matrix_ptr,
+                parallel_num * parallel_num * sizeof(IDX));
+    std::vector<int64_t> send_rows;
+    std::vector<int64_t> recv_rows;
+    GetShuffleRows(num_unique_matrix_vec, parallel_id, parallel_num, &send_rows, &recv_rows);
+
+    // 3. make the inverse indices point into the contiguous partitions
+    if (parallel_num > 1) {
+      const std::vector<int64_t> partition_offsets = ExclusivePrefixSum(send_rows);
+      for (int64_t i = 0; i < num_ids; ++i) {
+        const IDX index = inverse_ptr[i];
+        if (index == static_cast<IDX>(kPaddingRevIndex)) { continue; }
+        const int64_t partition_id = static_cast<int64_t>(index) / num_ids;
+        inverse_ptr[i] = partition_offsets.at(partition_id) + index - partition_id * num_ids;
+      }
+    }
+
+    // 4. send the unique ids to the ranks holding them and unique the received ids
+    std::vector<int64_t> send_offsets(parallel_num);
+    for (int64_t i = 0; i < parallel_num; ++i) { send_offsets.at(i) = i * num_ids; }
+    int64_t received_elem_cnt = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) { received_elem_cnt += recv_rows.at(i); }
+    std::vector<K> received_ids(received_elem_cnt);
+    ShuffleRows<K>(parallel_desc, parallel_id, send_offsets, send_rows,
+                   partitioned_unique_ids.data(), recv_rows, 1, received_ids.data());
+    std::vector<U> received_table_ids;
+    if (need_process_table_ids) {
+      received_table_ids.resize(received_elem_cnt);
+      ShuffleRows<U>(parallel_desc, parallel_id, send_offsets, send_rows,
+                     partitioned_unique_table_ids.data(), recv_rows, 1,
+                     received_table_ids.data());
+    }
+    IDX* cur_rank_num_unique_ptr = cur_rank_num_unique->mut_dptr<IDX>();
+    UniqueAndPartition<K, U, IDX>(received_elem_cnt, 1, received_ids.data(),
+                                  received_table_ids.data(), cur_rank_num_unique_ptr,
+                                  cur_rank_unique_ids->mut_dptr<K>(),
+                                  cur_rank_unique_table_ids->mut_dptr<U>(),
+                                  cur_rank_inverse_indices->mut_dptr<IDX>(),
+                                  need_process_table_ids, has_padding_idx, padding_idx);
+    if (!need_process_table_ids) {
+      std::memset(cur_rank_unique_table_ids->mut_dptr(), 0, received_elem_cnt * sizeof(U));
+    }
+
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    embedding_state->SetIdNumUniqueMatrix(num_unique_matrix_vec, current_iter_);
+    embedding_state->SetIdFinalNumUnique(*cur_rank_num_unique_ptr, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define CPU_ID_DATA_TYPE_SEQ                        \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_TABLE_ID_DATA_TYPE_SEQ                  \
+  OF_PP_MAKE_TUPLE_SEQ(uint8_t, DataType::kUInt8)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int8_t, DataType::kInt8)     \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_IDX_DATA_TYPE_SEQ                       \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ID_SHUFFLE_KERNEL(k_dtype_pair, table_id_dtype_pair, idx_dtype_pair)         \
+  REGISTER_USER_KERNEL("id_shuffle")                                                              \
+      .SetCreateFn<CpuIdShuffleKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                             \
+                                      OF_PP_PAIR_FIRST(table_id_dtype_pair),                      \
+                                      OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                        \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                  \
+          && (user_op::HobDataType("cur_rank_unique_table_ids", 0)                                \
+              == OF_PP_PAIR_SECOND(table_id_dtype_pair))                                          \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ID_SHUFFLE_KERNEL, CPU_ID_DATA_TYPE_SEQ,
+                                 CPU_TABLE_ID_DATA_TYPE_SEQ, CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class CpuEmbeddingShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingShuffleKernel() : current_iter_(0) {}
+  ~CpuEmbeddingShuffleKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    embedding_state->OnEmbeddingShuffleStart(ctx, current_iter_);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const bool skip_last_gather = ctx->Attr<bool>("skip_last_gather");
+    const int64_t num_ids = inverse_unique_partition_indices->shape_view().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    const std::vector<uint32_t>& num_unique_matrix_vec =
+        embedding_state->GetIdNumUniqueMatrix(current_iter_);
+    const uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    std::vector<int64_t> unique_partitioned_rows;
+    std::vector<int64_t> cur_rank_rows;
+    GetShuffleRows(num_unique_matrix_vec, parallel_id, parallel_num, &unique_partitioned_rows,
+                   &cur_rank_rows);
+    int64_t cur_rank_num_ids = 0;
+    int64_t unique_partitioned_num_ids = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      cur_rank_num_ids += cur_rank_rows.at(i);
+      unique_partitioned_num_ids += unique_partitioned_rows.at(i);
+    }
+    const T* cur_rank_embeddings_ptr = reinterpret_cast<const T*>(
+        embedding_state->EmbeddingShuffleCurRankEmbeddings(current_iter_));
+
+    // 1. reverse cur_rank unique, from (num_unique, embedding_size) to (cur_rank_num_ids,
+    // embedding_size)
+    std::vector<T> reverse_unique_cur_rank_embeddings(cur_rank_num_ids * embedding_size);
+    GatherRows<T, IDX>(ctx->stream(), cur_rank_inverse_indices->dptr<IDX>(), cur_rank_num_ids,
+                       cur_rank_embeddings_ptr, num_unique, embedding_size,
+                       reverse_unique_cur_rank_embeddings.data());
+
+    // 2. send the embeddings back to the ranks asking for them, from (cur_rank_num_ids,
+    // embedding_size) to (unique_partitioned_num_ids, embedding_size)
+    std::vector<T> received_embeddings;
+    T* received_ptr = embeddings->mut_dptr<T>();
+    if (!skip_last_gather) {
+      received_embeddings.resize(unique_partitioned_num_ids * embedding_size);
+      received_ptr = received_embeddings.data();
+    }
+    ShuffleRows<T>(kernel_state->parallel_desc(), parallel_id, ExclusivePrefixSum(cur_rank_rows),
+                   cur_rank_rows, reverse_unique_cur_rank_embeddings.data(),
+                   unique_partitioned_rows, embedding_size, received_ptr);
+
+    // 3. reverse unique_partition, from (unique_partitioned_num_ids, embedding_size) to
+    // (num_ids, embedding_size)
+    if (!skip_last_gather) {
+      GatherRows<T, IDX>(ctx->stream(), inverse_unique_partition_indices->dptr<IDX>(), num_ids,
+                         received_ptr, unique_partitioned_num_ids, embedding_size,
+                         embeddings->mut_dptr<T>());
+    }
+    embedding_state->OnEmbeddingShuffleEnd(ctx, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)                      \
+  REGISTER_USER_KERNEL("embedding_shuffle")                                                      \
+      .SetCreateFn<CpuEmbeddingShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                     \
+                                             OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("cur_rank_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)) \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class CpuEmbeddingGradientShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingGradientShuffleKernel() : current_iter_(0) {}
+  ~CpuEmbeddingGradientShuffleKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_unique_embedding_grad =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_embedding_grad", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const bool only_zero_valid_grad = ctx->Attr<bool>("only_zero_valid_grad");
+    const bool skip_first_scatter = ctx->Attr<bool>("skip_first_scatter");
+    const int64_t num_ids = inverse_unique_partition_indices->shape_view().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    const std::vector<uint32_t>& num_unique_matrix_vec =
+        embedding_state->GetIdNumUniqueMatrix(current_iter_);
+    const uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    std::vector<int64_t> unique_partitioned_rows;
+    std::vector<int64_t> cur_rank_rows;
+    GetShuffleRows(num_unique_matrix_vec, parallel_id, parallel_num, &unique_partitioned_rows,
+                   &cur_rank_rows);
+    int64_t cur_rank_num_ids = 0;
+    int64_t unique_partitioned_num_ids = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      cur_rank_num_ids += cur_rank_rows.at(i);
+      unique_partitioned_num_ids += unique_partitioned_rows.at(i);
+    }
+
+    // 1. sum to unique grad, from (num_ids, embedding_size) to (unique_partitioned_num_ids,
+    // embedding_size)
+    std::vector<T> unique_partition_embedding_grad;
+    const T* unique_embedding_grad_ptr = embedding_grad->dptr<T>();
+    if (!skip_first_scatter) {
+      unique_partition_embedding_grad.resize(unique_partitioned_num_ids * embedding_size);
+      UnsortedSegmentSumRows<T, IDX>(ctx->stream(), inverse_unique_partition_indices->dptr<IDX>(),
+                                     num_ids, embedding_grad->dptr<T>(),
+                                     unique_partitioned_num_ids, embedding_size,
+                                     unique_partition_embedding_grad.data());
+      unique_embedding_grad_ptr = unique_partition_embedding_grad.data();
+    }
+
+    // 2. send the grad to the ranks holding the ids, from (unique_partitioned_num_ids,
+    // embedding_size) to (cur_rank_num_ids, embedding_size)
+    std::vector<T> received_embedding_grad(cur_rank_num_ids * embedding_size);
+    ShuffleRows<T>(kernel_state->parallel_desc(), parallel_id,
+                   ExclusivePrefixSum(unique_partitioned_rows), unique_partitioned_rows,
+                   unique_embedding_grad_ptr, cur_rank_rows, embedding_size,
+                   received_embedding_grad.data());
+
+    // 3. sum to unique grad, from (cur_rank_num_ids, embedding_size) to (num_unique,
+    // embedding_size), the rows after num_unique are zeros too unless only_zero_valid_grad
+    T* out_ptr = cur_rank_unique_embedding_grad->mut_dptr<T>();
+    const int64_t zero_elem_cnt = only_zero_valid_grad
+                                      ? num_unique * embedding_size
+                                      : cur_rank_unique_embedding_grad->shape_view().elem_cnt();
+    std::fill(out_ptr, out_ptr + zero_elem_cnt, static_cast<T>(0));
+    UnsortedSegmentSumRows<T, IDX>(ctx->stream(), cur_rank_inverse_indices->dptr<IDX>(),
+                                   cur_rank_num_ids, received_embedding_grad.data(), num_unique,
+                                   embedding_size, out_ptr);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)             \
+  REGISTER_USER_KERNEL("embedding_gradient_shuffle")                                             \
+      .SetCreateFn<CpuEmbeddingGradientShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),             \
+                                                     OF_PP_PAIR_FIRST(idx_dtype_pair)>>()        \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))      \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename K, typename V, typename IDX>
+class CpuUniqueKeyValuePairKernel final : public user_op::OpKernel {
+ public:
+  CpuUniqueKeyValuePairKernel() : current_iter_(0) {}
+  ~CpuUniqueKeyValuePairKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* keys = ctx->Tensor4ArgNameAndIndex("keys", 0);
+    user_op::Tensor* num_unique = ctx->Tensor4ArgNameAndIndex("num_unique", 0);
+    user_op::Tensor* unique_keys = ctx->Tensor4ArgNameAndIndex("unique_keys", 0);
+    user_op::Tensor* unique_values = ctx->Tensor4ArgNameAndIndex("unique_values", 0);
+    user_op::Tensor* inverse_indices = ctx->Tensor4ArgNameAndIndex("inverse_indices", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    const bool has_padding_idx = ctx->Attr<bool>("has_padding_idx");
+    const bool has_values = ctx->has_input("values", 0);
+    const int64_t num_keys = keys->shape_view().elem_cnt();
+    std::vector<V> generated_values;
+    const V* values_ptr = nullptr;
+    if (has_values) {
+      values_ptr = ctx->Tensor4ArgNameAndIndex("values", 0)->dptr<V>();
+    } else if (num_tables > 1) {
+      generated_values = GenerateTableIds<V>(num_keys, num_tables);
+      values_ptr = generated_values.data();
+    }
+    const bool need_process_table_ids = (has_values || num_tables > 1);
+    IDX* num_unique_ptr = num_unique->mut_dptr<IDX>();
+    UniqueAndPartition<K, V, IDX>(num_keys, 1, keys->dptr<K>(), values_ptr, num_unique_ptr,
+                                  unique_keys->mut_dptr<K>(), unique_values->mut_dptr<V>(),
+                                  inverse_indices->mut_dptr<IDX>(), need_process_table_ids,
+                                  has_padding_idx, padding_idx);
+    const uint32_t num_unique_ids = *num_unique_ptr;
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    std::vector<uint32_t> num_unique_matrix_vec({num_unique_ids});
+    embedding_state->SetIdNumUniqueMatrix(num_unique_matrix_vec, current_iter_);
+    embedding_state->SetIdFinalNumUnique(num_unique_ids, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL(k_dtype_pair, value_dtype_pair, idx_dtype_pair) \
+  REGISTER_USER_KERNEL("unique_key_value_pair")                                                   \
+      .SetCreateFn<CpuUniqueKeyValuePairKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                    \
+                                               OF_PP_PAIR_FIRST(value_dtype_pair),                \
+                                               OF_PP_PAIR_FIRST(idx_dtype_pair)>>()               \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("keys", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                 \
+          && (user_op::HobDataType("inverse_indices", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))    \
+          && (user_op::HobDataType("unique_values", 0) == OF_PP_PAIR_SECOND(value_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL, CPU_ID_DATA_TYPE_SEQ,
+                                 CPU_TABLE_ID_DATA_TYPE_SEQ, CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class CpuOneEmbeddingGatherKernel final : public user_op::OpKernel {
+ public:
+  CpuOneEmbeddingGatherKernel() : current_iter_(0) {}
+  ~CpuOneEmbeddingGatherKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuDataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuDataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    embedding_state->OnEmbeddingGatherStart(ctx, current_iter_);
+    const user_op::Tensor* indices = ctx->Tensor4ArgNameAndIndex("indices", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const T* in_ptr = reinterpret_cast<const T*>(embedding_state->EmbeddingGatherIn(current_iter_));
+    GatherRows<T, IDX>(ctx->stream(), indices->dptr<IDX>(), indices->shape_view().elem_cnt(),
+                       in_ptr, num_unique, embedding_size, out->mut_dptr<T>());
+    embedding_state->OnEmbeddingGatherEnd(ctx, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_GATHER_KERNEL(in_type, indices_type)                     \
+  REGISTER_USER_KERNEL("one_embedding_gather")                                              \
+      .SetCreateFn<CpuOneEmbeddingGatherKernel<OF_PP_PAIR_FIRST(in_type),                   \
+                                               OF_PP_PAIR_FIRST(indices_type)>>()           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
+                       && (user_op::HobDataType("in", 0) == OF_PP_PAIR_SECOND(in_type))     \
+                       && (user_op::HobDataType("indices", 0) == OF_PP_PAIR_SECOND(indices_type)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_GATHER_KERNEL, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
@@ -16,15 +16,40 @@ limitations under the License.
 
 #include "oneflow/user/kernels/distributions/normal_distribution.h"
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/cpu_philox_util.h"
 
 namespace oneflow {
 
+namespace {
+
+// Box-Muller transform of two uniforms of each element
+template<typename T, typename ComputeType>
+void PhiloxNormalDistribution(ep::Stream* stream, ep::CPUGenerator* gen, const int64_t elem_cnt,
+                              ComputeType mean, ComputeType std, T* dptr) {
+  constexpr int64_t kNumPerUniform = PhiloxUniform<ComputeType>::kNumPerElem;
+  PhiloxParallelForEach(
+      stream, gen, elem_cnt, 2 * kNumPerUniform, [&](int64_t i, const uint32_t* numbers) {
+        const ComputeType u1 =
+            static_cast<ComputeType>(1) - PhiloxUniform<ComputeType>::Get(numbers);
+        const ComputeType u2 = PhiloxUniform<ComputeType>::Get(numbers + kNumPerUniform);
+        const ComputeType radius = std::sqrt(static_cast<ComputeType>(-2) * std::log(u1));
+        const ComputeType theta = static_cast<ComputeType>(2 * M_PI) * u2;
+        dptr[i] = static_cast<T>(mean + std * radius * std::cos(theta));
+      });
+}
+
+}  // namespace
+
 template<typename T>
 void NormalDistribution<DeviceType::kCPU, T>::operator()(
     ep::Stream* stream, const int64_t elem_cnt, T* dptr,
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0) << "elem_cnt must be non-negative, but got " << elem_cnt;
   auto gen = CHECK_JUST(generator->Get<ep::CPUGenerator>());
+  if (gen->use_philox()) {
+    PhiloxNormalDistribution<T, T>(stream, gen.get(), elem_cnt, mean_, std_, dptr);
+    return;
+  }
   std::normal_distribution<T> random_distribution(mean_, std_);
   for (int64_t i = 0; i < elem_cnt; ++i) { dptr[i] = random_distribution(gen->engine()); }
 }
@@ -43,6 +68,10 @@ void NormalDistribution<DeviceType::kCPU, float16>::operator()(
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0) << "elem_cnt must be non-negative, but got " << elem_cnt;
   auto gen = CHECK_JUST(generator->Get<ep::CPUGenerator>());
+  if (gen->use_philox()) {
+    PhiloxNormalDistribution<float16, float>(stream, gen.get(), elem_cnt, mean_, std_, dptr);
+    return;
+  }
   std::normal_distribution<float> random_distribution(mean_, std_);
   for (int64_t i = 0; i < elem_cnt; ++i) {
     dptr[i] = static_cast<float16>(random_distribution(gen->engine()));
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/distributions/uniform_distribution.h"
+#include "oneflow/user/kernels/cpu_philox_util.h"
 
 namespace oneflow {
 
@@ -33,12 +34,30 @@ class CPUUniformDistributionImpl<T,
   std::uniform_real_distribution<T> random_distribution_;
 };
 
+namespace {
+
+template<typename T, typename ComputeType>
+void PhiloxUniformDistribution(ep::Stream* stream, ep::CPUGenerator* gen, const int64_t elem_cnt,
+                               ComputeType low, ComputeType high, T* dptr) {
+  PhiloxParallelForEach(stream, gen, elem_cnt, PhiloxUniform<ComputeType>::kNumPerElem,
+                        [&](int64_t i, const uint32_t* numbers) {
+                          const ComputeType u = PhiloxUniform<ComputeType>::Get(numbers);
+                          dptr[i] = static_cast<T>(low + (high - low) * u);
+                        });
+}
+
+}  // namespace
+
 template<typename T>
 void UniformDistribution<DeviceType::kCPU, T>::operator()(
     ep::Stream* stream, const int64_t elem_cnt, T* dptr,
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0) << "elem_cnt must be non-negative, but got " << elem_cnt;
   auto gen = CHECK_JUST(generator->Get<ep::CPUGenerator>());
+  if (gen->use_philox()) {
+    PhiloxUniformDistribution<T, T>(stream, gen.get(), elem_cnt, low_, high_, dptr);
+    return;
+  }
   CPUUniformDistributionImpl<T> impl(low_, high_);
   for (int64_t i = 0; i < elem_cnt; ++i) { dptr[i] = impl(gen->engine()); }
 }
@@ -57,6 +76,10 @@ void UniformDistribution<DeviceType::kCPU, float16>::operator()(
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0) << "elem_cnt must be non-negative, but got " << elem_cnt;
   auto gen = CHECK_JUST(generator->Get<ep::CPUGenerator>());
+  if (gen->use_philox()) {
+    PhiloxUniformDistribution<float16, float>(stream, gen.get(), elem_cnt, low_, high_, dptr);
+    return;
+  }
   CPUUniformDistributionImpl<float> impl(low_, high_);
   for (int64_t i = 0; i < elem_cnt; ++i) { dptr[i] = static_cast<float16>(impl(gen->engine())); }
 }
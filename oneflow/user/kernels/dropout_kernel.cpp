@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/user/kernels/op_kernel_wrapper.h"
 #include "oneflow/user/kernels/dropout_kernel.h"
 #include "oneflow/user/kernels/random_seed_util.h"
+#include "oneflow/user/kernels/cpu_philox_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
 
 namespace oneflow {
@@ -38,6 +39,14 @@ void FusedDropoutKernel(ep::Stream* stream, const int64_t elem_cnt,
   `uniform_real_distribution` interval is [a, b).
   And `curand_uniform4` interval is (0, 1.0], so we use > in CUDA and use >= in CPU.
   */
+  if (cpu_gen->use_philox()) {
+    PhiloxParallelForEach(stream, cpu_gen.get(), elem_cnt, 1,
+                          [&](int64_t i, const uint32_t* numbers) {
+                            mask[i] = PhiloxUniformFloat(numbers[0]) >= rate;
+                            y[i] = x[i] * static_cast<T>(mask[i]) * scale;
+                          });
+    return;
+  }
   std::uniform_real_distribution<float> random_distribution(GetZeroVal<float>(),
                                                             GetOneVal<float>());
   for (int64_t i = 0; i < elem_cnt; ++i) {
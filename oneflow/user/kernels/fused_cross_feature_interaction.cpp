@@ -0,0 +1,215 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kRowGrainSize = 64;
+
+std::unique_ptr<ep::primitive::Matmul> NewMatmulPrimitive(DeviceType device_type,
+                                                          DataType data_type, bool transpose_a,
+                                                          bool transpose_b) {
+  const auto trans_a =
+      transpose_a ? ep::primitive::BlasTransposeType::T : ep::primitive::BlasTransposeType::N;
+  const auto trans_b =
+      transpose_b ? ep::primitive::BlasTransposeType::T : ep::primitive::BlasTransposeType::N;
+  return ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(device_type, data_type, trans_a,
+                                                                   trans_b);
+}
+
+auto MatmulPrimitiveExists() {
+  return hob::make_custom("MatmulPrimitiveExists", [](const user_op::KernelRegContext& ctx) {
+    const DataType data_type = ctx.TensorDesc4ArgNameAndIndex("x", 0)->data_type();
+    return NewMatmulPrimitive(ctx.device_type(), data_type, false, true).operator bool()
+           && NewMatmulPrimitive(ctx.device_type(), data_type, true, false).operator bool();
+  });
+}
+
+// c (m, n) = a (m, k) matmul b (k, n), with a and b transposed as asked
+void LaunchMatmul(ep::Stream* stream, DataType data_type, bool transpose_a, bool transpose_b,
+                  size_t m, size_t n, size_t k, const void* a, const void* b, void* c) {
+  auto matmul = NewMatmulPrimitive(stream->device_type(), data_type, transpose_a, transpose_b);
+  CHECK(matmul);
+  matmul->Launch(stream, m, n, k, 1.0, a, b, 0.0, c);
+}
+
+template<typename F>
+void ForEachRow(ep::Stream* stream, int64_t rows, const F& func) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) { func(row); }
+      },
+      kRowGrainSize);
+}
+
+}  // namespace
+
+// vector: out = x0 * (x matmul weight^T) + bias + x, with weight (1, E)
+// matrix: out = x0 * (x matmul weight^T + bias) + x, with weight (E, E)
+template<typename T>
+class CpuFusedCrossFeatureInteractionKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedCrossFeatureInteractionKernel() = default;
+  ~CpuFusedCrossFeatureInteractionKernel() override = default;
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* x0 = ctx->Tensor4ArgNameAndIndex("x0", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* matmul_result = ctx->Tensor4ArgNameAndIndex("matmul_result", 0);
+    const bool vector_mode = ctx->Attr<std::string>("interaction_mode") == "vector";
+    CHECK_EQ(out->shape_view().NumAxes(), 2);
+    const int64_t batch_size = x->shape_view().At(0);
+    const int64_t cols = out->shape_view().At(1);
+    const int64_t out_size = weight->shape_view().At(0);
+    CHECK_EQ(out_size, vector_mode ? 1 : cols);
+    LaunchMatmul(ctx->stream(), x->data_type(), /*transpose_a=*/false, /*transpose_b=*/true,
+                 batch_size, out_size, x->shape_view().At(1), x->dptr(), weight->dptr(),
+                 matmul_result->mut_dptr());
+    const T* x_ptr = x->dptr<T>();
+    const T* x0_ptr = x0->dptr<T>();
+    const T* bias_ptr = bias->dptr<T>();
+    const T* mm_ptr = matmul_result->dptr<T>();
+    T* out_ptr = out->mut_dptr<T>();
+    ForEachRow(ctx->stream(), batch_size, [&](int64_t row) {
+      const int64_t offset = row * cols;
+      for (int64_t col = 0; col < cols; ++col) {
+        const int64_t i = offset + col;
+        if (vector_mode) {
+          out_ptr[i] = x0_ptr[i] * mm_ptr[row] + bias_ptr[col] + x_ptr[i];
+        } else {
+          out_ptr[i] = (mm_ptr[i] + bias_ptr[col]) * x0_ptr[i] + x_ptr[i];
+        }
+      }
+    });
+  }
+};
+
+#define REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_KERNEL(dtype)                    \
+  REGISTER_USER_KERNEL("fused_cross_feature_interaction")                             \
+      .SetCreateFn<CpuFusedCrossFeatureInteractionKernel<dtype>>()                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                 \
+                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value) \
+                       && MatmulPrimitiveExists());
+
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_KERNEL(float)
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_KERNEL(double)
+
+template<typename T, bool is_v2>
+class CpuFusedCrossFeatureInteractionGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedCrossFeatureInteractionGradKernel() = default;
+  ~CpuFusedCrossFeatureInteractionGradKernel() override = default;
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* x0 = ctx->Tensor4ArgNameAndIndex("x0", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* matmul_result = ctx->Tensor4ArgNameAndIndex("matmul_result", 0);
+    user_op::Tensor* dx0 = ctx->Tensor4ArgNameAndIndex("dx0", 0);
+    user_op::Tensor* dw = ctx->Tensor4ArgNameAndIndex("dw", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    user_op::Tensor* dbias = ctx->Tensor4ArgNameAndIndex("dbias", 0);
+    const int64_t batch_size = dy->shape_view().At(0);
+    const int64_t hidden_size = dy->shape_view().At(1);
+    // v1 reduces the matmul result to (B, 1), v2 keeps it (B, E)
+    const int64_t out_size = weight->shape_view().At(0);
+    const int64_t in_size = weight->shape_view().At(1);
+    CHECK_EQ(out_size, is_v2 ? hidden_size : 1);
+    const T* dy_ptr = dy->dptr<T>();
+    const T* x0_ptr = x0->dptr<T>();
+    const T* mm_ptr = matmul_result->dptr<T>();
+    const T* bias_ptr = is_v2 ? ctx->Tensor4ArgNameAndIndex("bias", 0)->dptr<T>() : nullptr;
+    T* dx0_ptr = dx0->mut_dptr<T>();
+
+    // step1: dmatmul_result0 = dy * x0, summed over the hidden dim in v1, and dx0
+    std::vector<T> dmatmul_result0(batch_size * out_size);
+    ForEachRow(ctx->stream(), batch_size, [&](int64_t row) {
+      const int64_t offset = row * hidden_size;
+      T sum = 0;
+      for (int64_t col = 0; col < hidden_size; ++col) {
+        const int64_t i = offset + col;
+        const T dy_mul_x0 = dy_ptr[i] * x0_ptr[i];
+        if (is_v2) {
+          dmatmul_result0[i] = dy_mul_x0;
+          dx0_ptr[i] = (mm_ptr[i] + bias_ptr[col]) * dy_ptr[i];
+        } else {
+          sum += dy_mul_x0;
+          dx0_ptr[i] = dy_ptr[i] * mm_ptr[row];
+        }
+      }
+      if (!is_v2) { dmatmul_result0[row] = sum; }
+    });
+
+    // step2: dx = dmatmul_result0 matmul weight + dy
+    LaunchMatmul(ctx->stream(), dy->data_type(), /*transpose_a=*/false, /*transpose_b=*/false,
+                 batch_size, in_size, out_size, dmatmul_result0.data(), weight->dptr(),
+                 dx->mut_dptr());
+    T* dx_ptr = dx->mut_dptr<T>();
+    ForEachRow(ctx->stream(), batch_size, [&](int64_t row) {
+      for (int64_t col = 0; col < hidden_size; ++col) {
+        dx_ptr[row * hidden_size + col] += dy_ptr[row * hidden_size + col];
+      }
+    });
+
+    // step3: dw = dmatmul_result0^T matmul x
+    LaunchMatmul(ctx->stream(), dy->data_type(), /*transpose_a=*/true, /*transpose_b=*/false,
+                 out_size, in_size, batch_size, dmatmul_result0.data(), x->dptr(),
+                 dw->mut_dptr());
+
+    // step4: dbias, the sum of dy in v1 and of dmatmul_result0 in v2 over the batch
+    const T* dbias_src = is_v2 ? dmatmul_result0.data() : dy_ptr;
+    T* dbias_ptr = dbias->mut_dptr<T>();
+    std::fill(dbias_ptr, dbias_ptr + hidden_size, static_cast<T>(0));
+    for (int64_t row = 0; row < batch_size; ++row) {
+      for (int64_t col = 0; col < hidden_size; ++col) {
+        dbias_ptr[col] += dbias_src[row * hidden_size + col];
+      }
+    }
+  }
+};
+
+#define REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_GRAD_KERNEL(op_type_name, dtype, is_v2) \
+  REGISTER_USER_KERNEL(op_type_name)                                                         \
+      .SetCreateFn<CpuFusedCrossFeatureInteractionGradKernel<dtype, is_v2>>()                \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                        \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value)       \
+                       && MatmulPrimitiveExists());
+
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_GRAD_KERNEL("fused_cross_feature_interaction_v1_grad",
+                                                         float, false)
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_GRAD_KERNEL("fused_cross_feature_interaction_v1_grad",
+                                                         double, false)
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_GRAD_KERNEL("fused_cross_feature_interaction_v2_grad",
+                                                         float, true)
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_GRAD_KERNEL("fused_cross_feature_interaction_v2_grad",
+                                                         double, true)
+
+}  // namespace oneflow
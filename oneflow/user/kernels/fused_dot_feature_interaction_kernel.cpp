@@ -0,0 +1,297 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// The rows of the features of a sample, concatenated along the feature dim
+template<typename Ptr>
+std::vector<Ptr> GetFeatureRows(const std::vector<Ptr>& features,
+                                const std::vector<int64_t>& feature_dims, int64_t batch_idx,
+                                int64_t vector_size) {
+  std::vector<Ptr> rows;
+  for (size_t i = 0; i < features.size(); ++i) {
+    Ptr batch_in = features.at(i) + batch_idx * feature_dims.at(i) * vector_size;
+    for (int64_t j = 0; j < feature_dims.at(i); ++j) { rows.push_back(batch_in + j * vector_size); }
+  }
+  return rows;
+}
+
+template<typename T>
+T Dot(const T* x, const T* y, int64_t n) {
+  T sum = 0;
+  for (int64_t i = 0; i < n; ++i) { sum += x[i] * y[i]; }
+  return sum;
+}
+
+template<typename T>
+void GetFeatures(user_op::KernelComputeContext* ctx, std::vector<const T*>* features,
+                 std::vector<int64_t>* feature_dims) {
+  for (int64_t i = 0; i < ctx->input_size("features"); ++i) {
+    const user_op::Tensor* feature = ctx->Tensor4ArgNameAndIndex("features", i);
+    features->push_back(feature->dptr<T>());
+    feature_dims->push_back(feature->shape_view().At(1));
+  }
+}
+
+}  // namespace
+
+// The pairs (i, j) with j < i + offset of the concatenated features are laid out row by row after
+// output_concat, as the gather indices of the cuda kernel.
+template<typename T>
+class CpuFusedDotFeatureInteractionKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedDotFeatureInteractionKernel() = default;
+  ~CpuFusedDotFeatureInteractionKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CHECK(!ctx->has_input("sparse_feature", 0)) << "sparse_feature is not supported. ";
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    std::vector<const T*> features;
+    std::vector<int64_t> feature_dims;
+    GetFeatures<T>(ctx, &features, &feature_dims);
+    const int64_t batch_size = out->shape_view().At(0);
+    const int64_t out_dim = out->shape_view().At(1);
+    const int64_t vector_size = ctx->TensorDesc4ArgNameAndIndex("features", 0)->shape().At(2);
+    const int64_t valid_out_dim = out_dim - ctx->Attr<int32_t>("output_padding");
+    const int64_t offset = ctx->Attr<bool>("self_interaction") ? 1 : 0;
+    int64_t output_concat_end_dim = 0;
+    const T* output_concat_ptr = nullptr;
+    if (ctx->has_input("output_concat", 0)) {
+      const user_op::Tensor* output_concat = ctx->Tensor4ArgNameAndIndex("output_concat", 0);
+      output_concat_end_dim = output_concat->shape_view().At(1);
+      output_concat_ptr = output_concat->dptr<T>();
+    }
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t b = begin; b < end; ++b) {
+            const std::vector<const T*> rows =
+                GetFeatureRows(features, feature_dims, b, vector_size);
+            T* out_row = out->mut_dptr<T>() + b * out_dim;
+            std::copy(output_concat_ptr + b * output_concat_end_dim,
+                      output_concat_ptr + (b + 1) * output_concat_end_dim, out_row);
+            const int64_t num_rows = rows.size();
+            int64_t col = output_concat_end_dim;
+            for (int64_t i = 0; i < num_rows; ++i) {
+              for (int64_t j = 0; j < i + offset; ++j) {
+                out_row[col++] = Dot(rows.at(i), rows.at(j), vector_size);
+              }
+            }
+            CHECK_EQ(col, valid_out_dim);
+            std::fill(out_row + valid_out_dim, out_row + out_dim, static_cast<T>(0));
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_KERNEL(dtype)                        \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction")                                 \
+      .SetCreateFn<CpuFusedDotFeatureInteractionKernel<dtype>>()                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "none"));
+
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_KERNEL(float)
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_KERNEL(double)
+
+template<typename T>
+class CpuFusedDotFeatureInteractionGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedDotFeatureInteractionGradKernel() = default;
+  ~CpuFusedDotFeatureInteractionGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CHECK(!ctx->has_input("sparse_feature", 0)) << "sparse_feature is not supported. ";
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    std::vector<const T*> features;
+    std::vector<int64_t> feature_dims;
+    GetFeatures<T>(ctx, &features, &feature_dims);
+    std::vector<T*> features_grad;
+    for (int64_t i = 0; i < ctx->output_size("features_grad"); ++i) {
+      features_grad.push_back(ctx->Tensor4ArgNameAndIndex("features_grad", i)->mut_dptr<T>());
+    }
+    const int64_t batch_size = dy->shape_view().At(0);
+    const int64_t out_dim = dy->shape_view().At(1);
+    const int64_t vector_size = ctx->TensorDesc4ArgNameAndIndex("features", 0)->shape().At(2);
+    const int64_t offset = ctx->Attr<bool>("self_interaction") ? 1 : 0;
+    const int64_t output_concat_end_dim = ctx->Attr<int32_t>("output_concat_grad_dim");
+    T* output_concat_grad_ptr = nullptr;
+    if (ctx->has_output("output_concat_grad", 0)) {
+      output_concat_grad_ptr =
+          ctx->Tensor4ArgNameAndIndex("output_concat_grad", 0)->mut_dptr<T>();
+    }
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t b = begin; b < end; ++b) {
+            const T* dy_row = dy->dptr<T>() + b * out_dim;
+            if (output_concat_grad_ptr != nullptr) {
+              std::copy(dy_row, dy_row + output_concat_end_dim,
+                        output_concat_grad_ptr + b * output_concat_end_dim);
+            }
+            const std::vector<const T*> rows =
+                GetFeatureRows(features, feature_dims, b, vector_size);
+            const std::vector<T*> grad_rows =
+                GetFeatureRows(features_grad, feature_dims, b, vector_size);
+            for (T* grad_row : grad_rows) {
+              std::fill(grad_row, grad_row + vector_size, static_cast<T>(0));
+            }
+            // d(x_i . x_j) reaches both x_i and x_j, and twice x_i when i == j
+            const int64_t num_rows = rows.size();
+            int64_t col = output_concat_end_dim;
+            for (int64_t i = 0; i < num_rows; ++i) {
+              for (int64_t j = 0; j < i + offset; ++j) {
+                const T grad = dy_row[col++];
+                for (int64_t k = 0; k < vector_size; ++k) {
+                  grad_rows.at(i)[k] += grad * rows.at(j)[k];
+                  grad_rows.at(j)[k] += grad * rows.at(i)[k];
+                }
+              }
+            }
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_GRAD_KERNEL(dtype)                  \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction_grad")                           \
+      .SetCreateFn<CpuFusedDotFeatureInteractionGradKernel<dtype>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                  \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "none"));
+
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_GRAD_KERNEL(float)
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_GRAD_KERNEL(double)
+
+// out = 0.5 * ((sum_i x_i)^2 - sum_i x_i^2), the sum of the products of every pair of features
+template<typename T>
+class CpuFusedDotFeatureInteractionPoolingSumKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedDotFeatureInteractionPoolingSumKernel() = default;
+  ~CpuFusedDotFeatureInteractionPoolingSumKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    std::vector<const T*> features;
+    std::vector<int64_t> feature_dims;
+    GetFeatures<T>(ctx, &features, &feature_dims);
+    const int64_t batch_size = out->shape_view().At(0);
+    const int64_t vector_size = out->shape_view().At(1);
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> square_sum(vector_size);
+          for (int64_t b = begin; b < end; ++b) {
+            T* sum = out->mut_dptr<T>() + b * vector_size;
+            std::fill(sum, sum + vector_size, static_cast<T>(0));
+            std::fill(square_sum.begin(), square_sum.end(), static_cast<T>(0));
+            for (const T* row : GetFeatureRows(features, feature_dims, b, vector_size)) {
+              for (int64_t k = 0; k < vector_size; ++k) {
+                sum[k] += row[k];
+                square_sum[k] += row[k] * row[k];
+              }
+            }
+            for (int64_t k = 0; k < vector_size; ++k) {
+              sum[k] = (sum[k] * sum[k] - square_sum[k]) * static_cast<T>(0.5);
+            }
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_KERNEL(dtype)            \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction")                                 \
+      .SetCreateFn<CpuFusedDotFeatureInteractionPoolingSumKernel<dtype>>()              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "sum"));
+
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_KERNEL(float)
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_KERNEL(double)
+
+template<typename T>
+class CpuFusedDotFeatureInteractionPoolingSumGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedDotFeatureInteractionPoolingSumGradKernel() = default;
+  ~CpuFusedDotFeatureInteractionPoolingSumGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    std::vector<const T*> features;
+    std::vector<int64_t> feature_dims;
+    GetFeatures<T>(ctx, &features, &feature_dims);
+    std::vector<T*> features_grad;
+    for (int64_t i = 0; i < ctx->output_size("features_grad"); ++i) {
+      features_grad.push_back(ctx->Tensor4ArgNameAndIndex("features_grad", i)->mut_dptr<T>());
+    }
+    const int64_t batch_size = dy->shape_view().At(0);
+    const int64_t vector_size = dy->shape_view().At(1);
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> sum(vector_size);
+          for (int64_t b = begin; b < end; ++b) {
+            const T* dy_row = dy->dptr<T>() + b * vector_size;
+            const std::vector<const T*> rows =
+                GetFeatureRows(features, feature_dims, b, vector_size);
+            const std::vector<T*> grad_rows =
+                GetFeatureRows(features_grad, feature_dims, b, vector_size);
+            std::fill(sum.begin(), sum.end(), static_cast<T>(0));
+            for (const T* row : rows) {
+              for (int64_t k = 0; k < vector_size; ++k) { sum[k] += row[k]; }
+            }
+            for (size_t i = 0; i < rows.size(); ++i) {
+              T* grad_row = grad_rows.at(i);
+              for (int64_t k = 0; k < vector_size; ++k) {
+                grad_row[k] = dy_row[k] * (sum[k] - rows.at(i)[k]);
+              }
+            }
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_GRAD_KERNEL(dtype)      \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction_grad")                           \
+      .SetCreateFn<CpuFusedDotFeatureInteractionPoolingSumGradKernel<dtype>>()         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                  \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "sum"));
+
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_GRAD_KERNEL(float)
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_GRAD_KERNEL(double)
+
+}  // namespace oneflow
@@ -79,11 +79,11 @@ class GPTDataLoader final : public OpKernelState {
     CHECK_EQ(tokens->shape_view().NumAxes(), 2);
     CHECK_EQ(tokens->shape_view().At(0), batch_size_);
     CHECK_EQ(tokens->shape_view().At(1), sample_len);
-    T* dptr = tokens->mut_dptr<T>();
-    for (size_t i = 0; i < batch_size_; ++i) {
-      size_t sample_iter = iter * batch_size_ * num_shards_ + shard_index_ * batch_size_ + i;
-      dataset_->GetSample(sample_iter, dptr + i * sample_len);
-    }
+    // the samples of a shard are consecutive in every iteration
+    const size_t sample_iter = iter * batch_size_ * num_shards_ + shard_index_ * batch_size_;
+    dataset_->GetSamples(sample_iter, batch_size_, tokens->mut_dptr<T>());
+    // warm up the page cache for this shard's next batch while the current one is computed
+    dataset_->Prefetch(sample_iter + batch_size_ * num_shards_, batch_size_);
   }
 
   template<typename T>
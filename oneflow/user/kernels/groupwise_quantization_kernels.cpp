@@ -0,0 +1,582 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/platform.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+
+#if defined(OF_PLATFORM_IS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define OF_GROUPWISE_QUANTIZATION_WITH_AVX2
+#include <immintrin.h>
+#endif
+
+namespace oneflow {
+
+namespace {
+
+// The q-th element of a row of quantized weights, two int4 elements are packed in one byte with
+// the even one in the high nibble
+template<typename U, int num_bits>
+inline float LoadQuantized(const U* row, int64_t q) {
+  if (num_bits == 8) { return static_cast<float>(row[q]); }
+  const U packed = row[q / 2];
+  if (std::is_signed<U>::value) {
+    return static_cast<float>((q % 2 == 0) ? static_cast<int8_t>(packed >> 4)
+                                           : static_cast<int8_t>(packed << 4) >> 4);
+  } else {
+    return static_cast<float>((q % 2 == 0) ? (packed >> 4) : (packed & 0xF));
+  }
+}
+
+// The dequantized value is q * scale + zero, where the zero of symmetric uint8 weights is implied
+// by their offset
+template<typename U>
+inline float SymmetricZeroPoint(bool symmetric, int32_t num_bits) {
+  if (symmetric && !std::is_signed<U>::value) {
+    return -static_cast<float>((1 << (num_bits - 1)) - 1);
+  }
+  return 0.0f;
+}
+
+template<typename U, int num_bits>
+void GroupwiseDequantize(ep::CpuStream* stream, bool symmetric, int64_t outer_size,
+                         int64_t group_size, int64_t inner_size, const U* in, const float* scale,
+                         const float* zero, float* out) {
+  const float zero_point = SymmetricZeroPoint<U>(symmetric, num_bits);
+  const size_t grain_size = std::max<int64_t>(32768 / (group_size * inner_size), 1);
+  stream->ParallelFor(
+      0, outer_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t o = begin; o < end; ++o) {
+          const float* scale_row = scale + o * inner_size;
+          const float* zero_row = zero == nullptr ? nullptr : zero + o * inner_size;
+          for (int64_t g = 0; g < group_size; ++g) {
+            const int64_t offset = (o * group_size + g) * inner_size;
+            for (int64_t i = 0; i < inner_size; ++i) {
+              const float s = scale_row[i];
+              const float z = zero_row == nullptr ? zero_point * s : zero_row[i];
+              out[offset + i] = LoadQuantized<U, num_bits>(in, offset + i) * s + z;
+            }
+          }
+        }
+      },
+      grain_size);
+}
+
+class GroupwiseDequantizeKernel final : public user_op::OpKernel {
+ public:
+  GroupwiseDequantizeKernel() = default;
+  ~GroupwiseDequantizeKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* scale = ctx->Tensor4ArgNameAndIndex("scale", 0);
+    const user_op::Tensor* zero = nullptr;
+    if (ctx->has_input("zero", 0)) { zero = ctx->Tensor4ArgNameAndIndex("zero", 0); }
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const int64_t group_size = ctx->Attr<int64_t>("group_size");
+    const int64_t group_dim = ctx->Attr<int64_t>("group_dim");
+    const int32_t num_bits = ctx->Attr<int32_t>("num_bits");
+    const bool symmetric = ctx->Attr<bool>("symmetric");
+    const int64_t num_in_axes = in->shape_view().NumAxes();
+    CHECK_GE(num_in_axes, 1);
+    CHECK_EQ(scale->shape_view().NumAxes(), num_in_axes);
+    if (zero != nullptr) { CHECK_EQ(zero->shape_view().NumAxes(), num_in_axes); }
+    CHECK_EQ(out->shape_view().NumAxes(), num_in_axes);
+    CHECK_GE(group_dim, 0);
+    CHECK_LT(group_dim, num_in_axes);
+    for (int i = 0; i < num_in_axes; ++i) {
+      if (i == num_in_axes - 1) {
+        CHECK_EQ(out->shape_view().At(i), in->shape_view().At(i) * (8 / num_bits));
+      } else {
+        CHECK_EQ(out->shape_view().At(i), in->shape_view().At(i));
+      }
+    }
+    const int64_t group_dim_size = out->shape_view().At(group_dim);
+    CHECK_GT(group_size, 0);
+    CHECK_LE(group_size, group_dim_size);
+    CHECK_EQ(group_dim_size % group_size, 0);
+    const int64_t num_groups = group_dim_size / group_size;
+    for (int i = 0; i < num_in_axes; ++i) {
+      const int64_t expected_dim_size = i == group_dim ? num_groups : out->shape_view().At(i);
+      CHECK_EQ(scale->shape_view().At(i), expected_dim_size);
+      if (zero != nullptr) { CHECK_EQ(zero->shape_view().At(i), expected_dim_size); }
+    }
+    const int64_t outer_size = out->shape_view().Count(0, group_dim) * num_groups;
+    const int64_t inner_size = out->shape_view().Count(group_dim + 1);
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+    const float* zero_ptr = zero == nullptr ? nullptr : zero->dptr<float>();
+#define DEQUANTIZE(U, bits)                                                        \
+  GroupwiseDequantize<U, bits>(stream, symmetric, outer_size, group_size, inner_size, \
+                               in->dptr<U>(), scale->dptr<float>(), zero_ptr,         \
+                               out->mut_dptr<float>())
+    if (in->data_type() == DataType::kUInt8 && num_bits == 8) {
+      DEQUANTIZE(uint8_t, 8);
+    } else if (in->data_type() == DataType::kUInt8 && num_bits == 4) {
+      DEQUANTIZE(uint8_t, 4);
+    } else if (in->data_type() == DataType::kInt8 && num_bits == 8) {
+      DEQUANTIZE(int8_t, 8);
+    } else if (in->data_type() == DataType::kInt8 && num_bits == 4) {
+      DEQUANTIZE(int8_t, 4);
+    } else {
+      UNIMPLEMENTED();
+    }
+#undef DEQUANTIZE
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("groupwise_dequantize")
+    .SetCreateFn<GroupwiseDequantizeKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobDataType("scale", 0) == DataType::kFloat));
+
+template<typename U>
+struct QuantizedMatmulParams {
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  int64_t group_size;
+  int64_t num_groups;
+  const float* x;
+  const U* w;
+  const float* scale;
+  const float* zero;
+  const float* bias;
+  float* out;
+  float zero_point;
+  // The sums of x over every group of k, only needed when grouping along k with a zero
+  const float* x_group_sum;
+};
+
+template<typename U>
+inline float ZeroOf(const QuantizedMatmulParams<U>& params, int64_t offset, float s) {
+  return params.zero == nullptr ? params.zero_point * s : params.zero[offset];
+}
+
+template<typename U, int num_bits>
+inline const U* WeightRow(const QuantizedMatmulParams<U>& params, int64_t j) {
+  return params.w + j * params.k * num_bits / 8;
+}
+
+template<typename U>
+inline float BiasOf(const QuantizedMatmulParams<U>& params, int64_t j) {
+  return params.bias == nullptr ? 0.0f : params.bias[j];
+}
+
+template<typename U, int num_bits>
+void QuantizedMatmulColumns(const QuantizedMatmulParams<U>& params, bool group_along_k,
+                            int64_t col_begin, int64_t col_end) {
+  const int64_t k = params.k;
+  for (int64_t j = col_begin; j < col_end; ++j) {
+    const U* w_row = WeightRow<U, num_bits>(params, j);
+    for (int64_t i = 0; i < params.m; ++i) {
+      const float* x_row = params.x + i * k;
+      float sum = 0;
+      if (group_along_k) {
+        for (int64_t g = 0; g < params.num_groups; ++g) {
+          float acc = 0;
+          for (int64_t q = g * params.group_size; q < (g + 1) * params.group_size; ++q) {
+            acc += x_row[q] * LoadQuantized<U, num_bits>(w_row, q);
+          }
+          const int64_t scale_offset = j * params.num_groups + g;
+          const float s = params.scale[scale_offset];
+          sum += s * acc;
+          if (params.x_group_sum != nullptr) {
+            sum += ZeroOf(params, scale_offset, s) * params.x_group_sum[i * params.num_groups + g];
+          }
+        }
+      } else {
+        const int64_t scale_offset = (j / params.group_size) * k;
+        for (int64_t q = 0; q < k; ++q) {
+          const float s = params.scale[scale_offset + q];
+          const float w = LoadQuantized<U, num_bits>(w_row, q) * s
+                          + ZeroOf(params, scale_offset + q, s);
+          sum += x_row[q] * w;
+        }
+      }
+      params.out[i * params.n + j] = sum + BiasOf(params, j);
+    }
+  }
+}
+
+#ifdef OF_GROUPWISE_QUANTIZATION_WITH_AVX2
+
+#define OF_AVX2_TARGET __attribute__((target("avx2,fma")))
+
+bool CpuSupportsAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return supported;
+}
+
+OF_AVX2_TARGET inline float HorizontalSum(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  __m128 shuf = _mm_movehdup_ps(sum);
+  sum = _mm_add_ps(sum, shuf);
+  shuf = _mm_movehl_ps(shuf, sum);
+  return _mm_cvtss_f32(_mm_add_ss(sum, shuf));
+}
+
+// Converts the 8 quantized elements of a row from q, which must be even for int4, to floats in
+// registers
+template<typename U, int num_bits>
+OF_AVX2_TARGET inline __m256 LoadQuantized8(const U* row, int64_t q) {
+  __m256i v;
+  if (num_bits == 8) {
+    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + q));
+    v = std::is_signed<U>::value ? _mm256_cvtepi8_epi32(bytes) : _mm256_cvtepu8_epi32(bytes);
+  } else {
+    int32_t packed = 0;
+    std::memcpy(&packed, row + q / 2, sizeof(packed));
+    const __m128i bytes = _mm_cvtsi32_si128(packed);
+    // Every byte goes to two lanes, which move its high or low nibble to the top bits
+    v = _mm256_cvtepu8_epi32(_mm_unpacklo_epi8(bytes, bytes));
+    v = _mm256_sllv_epi32(v, _mm256_setr_epi32(24, 28, 24, 28, 24, 28, 24, 28));
+    v = std::is_signed<U>::value ? _mm256_srai_epi32(v, 28) : _mm256_srli_epi32(v, 28);
+  }
+  return _mm256_cvtepi32_ps(v);
+}
+
+// rows x cols block of out. Every 8 elements of a row of x are loaded once for all the columns of
+// the block. The weights of a group share one scale, so x * q is accumulated in registers and
+// scaled once per group.
+template<typename U, int num_bits, int rows, int cols>
+OF_AVX2_TARGET void QuantizedMatmulGroupAlongKAvx2(const QuantizedMatmulParams<U>& params,
+                                                   int64_t i0, int64_t j0) {
+  const int64_t k = params.k;
+  const U* w_rows[cols];
+  for (int c = 0; c < cols; ++c) { w_rows[c] = WeightRow<U, num_bits>(params, j0 + c); }
+  const float* x_rows[rows];
+  __m256 sum[rows][cols];
+  float sum_tail[rows][cols];
+  for (int r = 0; r < rows; ++r) {
+    x_rows[r] = params.x + (i0 + r) * k;
+    for (int c = 0; c < cols; ++c) {
+      sum[r][c] = _mm256_setzero_ps();
+      sum_tail[r][c] = 0;
+    }
+  }
+  for (int64_t g = 0; g < params.num_groups; ++g) {
+    const int64_t end = (g + 1) * params.group_size;
+    __m256 acc[rows][cols];
+    float acc_tail[rows][cols];
+    for (int r = 0; r < rows; ++r) {
+      for (int c = 0; c < cols; ++c) {
+        acc[r][c] = _mm256_setzero_ps();
+        acc_tail[r][c] = 0;
+      }
+    }
+    int64_t q = g * params.group_size;
+    if (num_bits == 4 && q % 2 != 0) {
+      for (int c = 0; c < cols; ++c) {
+        const float w = LoadQuantized<U, num_bits>(w_rows[c], q);
+        for (int r = 0; r < rows; ++r) { acc_tail[r][c] += x_rows[r][q] * w; }
+      }
+      q += 1;
+    }
+    for (; q + 8 <= end; q += 8) {
+      __m256 w[cols];
+      for (int c = 0; c < cols; ++c) { w[c] = LoadQuantized8<U, num_bits>(w_rows[c], q); }
+      for (int r = 0; r < rows; ++r) {
+        const __m256 x = _mm256_loadu_ps(x_rows[r] + q);
+        for (int c = 0; c < cols; ++c) { acc[r][c] = _mm256_fmadd_ps(x, w[c], acc[r][c]); }
+      }
+    }
+    for (; q < end; ++q) {
+      for (int c = 0; c < cols; ++c) {
+        const float w = LoadQuantized<U, num_bits>(w_rows[c], q);
+        for (int r = 0; r < rows; ++r) { acc_tail[r][c] += x_rows[r][q] * w; }
+      }
+    }
+    for (int c = 0; c < cols; ++c) {
+      const int64_t scale_offset = (j0 + c) * params.num_groups + g;
+      const float s = params.scale[scale_offset];
+      const __m256 s_v = _mm256_set1_ps(s);
+      for (int r = 0; r < rows; ++r) {
+        sum[r][c] = _mm256_fmadd_ps(s_v, acc[r][c], sum[r][c]);
+        sum_tail[r][c] += s * acc_tail[r][c];
+      }
+      if (params.x_group_sum != nullptr) {
+        const float z = ZeroOf(params, scale_offset, s);
+        for (int r = 0; r < rows; ++r) {
+          sum_tail[r][c] += z * params.x_group_sum[(i0 + r) * params.num_groups + g];
+        }
+      }
+    }
+  }
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      params.out[(i0 + r) * params.n + j0 + c] =
+          HorizontalSum(sum[r][c]) + sum_tail[r][c] + BiasOf(params, j0 + c);
+    }
+  }
+}
+
+// rows x cols block of out. The weights are dequantized in registers with the scale and zero rows
+// of their group, and every 8 elements of a row of x are loaded once for all the columns.
+template<typename U, int num_bits, int rows, int cols>
+OF_AVX2_TARGET void QuantizedMatmulGroupAlongNAvx2(const QuantizedMatmulParams<U>& params,
+                                                   int64_t i0, int64_t j0) {
+  const int64_t k = params.k;
+  const U* w_rows[cols];
+  int64_t scale_offsets[cols];
+  const float* scale_rows[cols];
+  const float* zero_rows[cols];
+  for (int c = 0; c < cols; ++c) {
+    w_rows[c] = WeightRow<U, num_bits>(params, j0 + c);
+    scale_offsets[c] = ((j0 + c) / params.group_size) * k;
+    scale_rows[c] = params.scale + scale_offsets[c];
+    zero_rows[c] = params.zero == nullptr ? nullptr : params.zero + scale_offsets[c];
+  }
+  const __m256 zero_point = _mm256_set1_ps(params.zero_point);
+  const float* x_rows[rows];
+  __m256 acc[rows][cols];
+  for (int r = 0; r < rows; ++r) {
+    x_rows[r] = params.x + (i0 + r) * k;
+    for (int c = 0; c < cols; ++c) { acc[r][c] = _mm256_setzero_ps(); }
+  }
+  int64_t q = 0;
+  for (; q + 8 <= k; q += 8) {
+    __m256 w[cols];
+    for (int c = 0; c < cols; ++c) {
+      const __m256 s = _mm256_loadu_ps(scale_rows[c] + q);
+      const __m256 z = zero_rows[c] == nullptr ? _mm256_mul_ps(zero_point, s)
+                                               : _mm256_loadu_ps(zero_rows[c] + q);
+      w[c] = _mm256_fmadd_ps(LoadQuantized8<U, num_bits>(w_rows[c], q), s, z);
+    }
+    for (int r = 0; r < rows; ++r) {
+      const __m256 x = _mm256_loadu_ps(x_rows[r] + q);
+      for (int c = 0; c < cols; ++c) { acc[r][c] = _mm256_fmadd_ps(x, w[c], acc[r][c]); }
+    }
+  }
+  float acc_tail[rows][cols] = {};
+  for (; q < k; ++q) {
+    for (int c = 0; c < cols; ++c) {
+      const float s = scale_rows[c][q];
+      const float w =
+          LoadQuantized<U, num_bits>(w_rows[c], q) * s + ZeroOf(params, scale_offsets[c] + q, s);
+      for (int r = 0; r < rows; ++r) { acc_tail[r][c] += x_rows[r][q] * w; }
+    }
+  }
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      params.out[(i0 + r) * params.n + j0 + c] =
+          HorizontalSum(acc[r][c]) + acc_tail[r][c] + BiasOf(params, j0 + c);
+    }
+  }
+}
+
+template<typename U, int num_bits, int rows, int cols>
+OF_AVX2_TARGET void QuantizedMatmulBlockAvx2(const QuantizedMatmulParams<U>& params,
+                                             bool group_along_k, int64_t i0, int64_t j0) {
+  if (group_along_k) {
+    QuantizedMatmulGroupAlongKAvx2<U, num_bits, rows, cols>(params, i0, j0);
+  } else {
+    QuantizedMatmulGroupAlongNAvx2<U, num_bits, rows, cols>(params, i0, j0);
+  }
+}
+
+// The block of rows x cols of out at (i0, j0), cols is at most 4
+template<typename U, int num_bits, int rows>
+OF_AVX2_TARGET void QuantizedMatmulRowsAvx2(const QuantizedMatmulParams<U>& params,
+                                            bool group_along_k, int64_t i0, int64_t j0,
+                                            int64_t cols) {
+  if (cols == 4) {
+    QuantizedMatmulBlockAvx2<U, num_bits, rows, 4>(params, group_along_k, i0, j0);
+  } else if (cols == 3) {
+    QuantizedMatmulBlockAvx2<U, num_bits, rows, 3>(params, group_along_k, i0, j0);
+  } else if (cols == 2) {
+    QuantizedMatmulBlockAvx2<U, num_bits, rows, 2>(params, group_along_k, i0, j0);
+  } else {
+    QuantizedMatmulBlockAvx2<U, num_bits, rows, 1>(params, group_along_k, i0, j0);
+  }
+}
+
+template<typename U, int num_bits>
+OF_AVX2_TARGET void QuantizedMatmulColumnsAvx2(const QuantizedMatmulParams<U>& params,
+                                               bool group_along_k, int64_t col_begin,
+                                               int64_t col_end) {
+  // 2 x 4 blocks keep the accumulators and the dequantized weights in the 16 ymm registers
+  constexpr int kMaxRows = 2;
+  constexpr int64_t kMaxCols = 4;
+  for (int64_t j = col_begin; j < col_end; j += kMaxCols) {
+    const int64_t cols = std::min(kMaxCols, col_end - j);
+    int64_t i = 0;
+    for (; i + kMaxRows <= params.m; i += kMaxRows) {
+      QuantizedMatmulRowsAvx2<U, num_bits, kMaxRows>(params, group_along_k, i, j, cols);
+    }
+    if (i < params.m) {
+      QuantizedMatmulRowsAvx2<U, num_bits, 1>(params, group_along_k, i, j, cols);
+    }
+  }
+}
+
+#undef OF_AVX2_TARGET
+
+#endif  // OF_GROUPWISE_QUANTIZATION_WITH_AVX2
+
+template<typename U, int num_bits>
+void QuantizedMatmulBias(ep::CpuStream* stream, bool symmetric, int64_t m, int64_t n, int64_t k,
+                         int64_t group_dim, int64_t group_size, const float* x, const U* w,
+                         const float* scale, const float* zero, const float* bias, float* out) {
+  QuantizedMatmulParams<U> params{};
+  params.m = m;
+  params.n = n;
+  params.k = k;
+  params.group_size = group_size;
+  params.num_groups = (group_dim == 0 ? n : k) / group_size;
+  params.x = x;
+  params.w = w;
+  params.scale = scale;
+  params.zero = zero;
+  params.bias = bias;
+  params.out = out;
+  params.zero_point = SymmetricZeroPoint<U>(symmetric, num_bits);
+  const bool group_along_k = group_dim == 1;
+  std::vector<float> x_group_sum;
+  if (group_along_k && (zero != nullptr || params.zero_point != 0)) {
+    x_group_sum.resize(m * params.num_groups);
+    for (int64_t i = 0; i < m; ++i) {
+      for (int64_t g = 0; g < params.num_groups; ++g) {
+        const float* x_group = x + i * k + g * group_size;
+        x_group_sum[i * params.num_groups + g] =
+            std::accumulate(x_group, x_group + group_size, 0.0f);
+      }
+    }
+    params.x_group_sum = x_group_sum.data();
+  }
+  // Every task computes whole columns of out so a row of weights is read from memory once
+  const size_t grain_size = std::max<int64_t>(32768 / (m * k), 1);
+  stream->ParallelFor(
+      0, n,
+      [&](int64_t begin, int64_t end) {
+#ifdef OF_GROUPWISE_QUANTIZATION_WITH_AVX2
+        if (CpuSupportsAvx2()) {
+          QuantizedMatmulColumnsAvx2<U, num_bits>(params, group_along_k, begin, end);
+          return;
+        }
+#endif  // OF_GROUPWISE_QUANTIZATION_WITH_AVX2
+        QuantizedMatmulColumns<U, num_bits>(params, group_along_k, begin, end);
+      },
+      grain_size);
+}
+
+class FusedLinearWithGroupwiseQuantizedWeightKernel final : public user_op::OpKernel {
+ public:
+  FusedLinearWithGroupwiseQuantizedWeightKernel() = default;
+  ~FusedLinearWithGroupwiseQuantizedWeightKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* w = ctx->Tensor4ArgNameAndIndex("w", 0);
+    const user_op::Tensor* w_scale = ctx->Tensor4ArgNameAndIndex("w_scale", 0);
+    const user_op::Tensor* b =
+        (ctx->has_input("b", 0)) ? ctx->Tensor4ArgNameAndIndex("b", 0) : nullptr;
+    const user_op::Tensor* w_zero =
+        (ctx->has_input("w_zero", 0)) ? ctx->Tensor4ArgNameAndIndex("w_zero", 0) : nullptr;
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const DataType data_type = x->data_type();
+    CHECK_EQ(w_scale->data_type(), data_type);
+    CHECK_EQ(out->data_type(), data_type);
+    const int64_t group_size = ctx->Attr<int64_t>("group_size");
+    const int64_t group_dim = ctx->Attr<int64_t>("group_dim");
+    CHECK(group_dim == 0 || group_dim == 1);
+    const int32_t num_bits = ctx->Attr<int32_t>("num_bits");
+    const bool symmetric = ctx->Attr<bool>("symmetric");
+    CHECK_GE(x->shape_view().NumAxes(), 2);
+    const int64_t k = x->shape_view().At(x->shape_view().NumAxes() - 1);
+    const int64_t m = x->shape_view().elem_cnt() / k;
+    CHECK_EQ(w->shape_view().NumAxes(), 2);
+    if (num_bits == 4) {
+      CHECK_EQ(w->shape_view().At(1) * 2, k);
+    } else if (num_bits == 8) {
+      CHECK_EQ(w->shape_view().At(1), k);
+    } else {
+      UNIMPLEMENTED();
+    }
+    const int64_t n = w->shape_view().At(0);
+    const int64_t group_dim_size = group_dim == 0 ? n : k;
+    CHECK_GT(group_size, 0);
+    CHECK_LE(group_size, group_dim_size);
+    CHECK_EQ(group_dim_size % group_size, 0);
+    const int64_t num_groups = group_dim_size / group_size;
+    if (group_dim == 0) {
+      CHECK_EQ(w_scale->shape_view().At(0), num_groups);
+      CHECK_EQ(w_scale->shape_view().At(1), k);
+    } else {
+      CHECK_EQ(w_scale->shape_view().At(0), n);
+      CHECK_EQ(w_scale->shape_view().At(1), num_groups);
+    }
+    if (w_zero != nullptr) {
+      CHECK_EQ(w_zero->data_type(), data_type);
+      CHECK(w_zero->shape_view() == w_scale->shape_view());
+    }
+    if (b != nullptr) {
+      CHECK_EQ(b->data_type(), data_type);
+      CHECK_EQ(b->shape_view().NumAxes(), 1);
+      CHECK_EQ(b->shape_view().At(0), n);
+    }
+    CHECK_EQ(x->shape_view().NumAxes(), out->shape_view().NumAxes());
+    for (int i = 0; i < x->shape_view().NumAxes() - 1; ++i) {
+      CHECK_EQ(out->shape_view().At(i), x->shape_view().At(i));
+    }
+    CHECK_EQ(out->shape_view().At(out->shape_view().NumAxes() - 1), n);
+    if (symmetric) {
+      CHECK(w_zero == nullptr);
+    } else {
+      CHECK(w_zero != nullptr);
+    }
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+    const float* zero_ptr = w_zero == nullptr ? nullptr : w_zero->dptr<float>();
+    const float* bias_ptr = b == nullptr ? nullptr : b->dptr<float>();
+#define MATMUL_BIAS(U, bits)                                                                    \
+  QuantizedMatmulBias<U, bits>(stream, symmetric, m, n, k, group_dim, group_size,               \
+                               x->dptr<float>(), w->dptr<U>(), w_scale->dptr<float>(), zero_ptr, \
+                               bias_ptr, out->mut_dptr<float>())
+    const DataType quant_type = w->data_type();
+    if (quant_type == DataType::kUInt8 && num_bits == 8) {
+      MATMUL_BIAS(uint8_t, 8);
+    } else if (quant_type == DataType::kUInt8 && num_bits == 4) {
+      MATMUL_BIAS(uint8_t, 4);
+    } else if (quant_type == DataType::kInt8 && num_bits == 8) {
+      MATMUL_BIAS(int8_t, 8);
+    } else if (quant_type == DataType::kInt8 && num_bits == 4) {
+      MATMUL_BIAS(int8_t, 4);
+    } else {
+      UNIMPLEMENTED();
+    }
+#undef MATMUL_BIAS
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("fused_linear_with_groupwise_quantized_weight")
+    .SetCreateFn<FusedLinearWithGroupwiseQuantizedWeightKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobDataType("out", 0) == DataType::kFloat));
+
+}  // namespace
+
+}  // namespace oneflow
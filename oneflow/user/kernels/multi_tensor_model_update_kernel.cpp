@@ -93,6 +93,9 @@ class MultiTensorSGDUpdateKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
@@ -178,6 +181,9 @@ class MultiTensorMomentumUpdateKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value) \
                        && (user_op::HobDataType("momentum_buf", 0) == GetDataType<gtype>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_MOMENTUM_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_UPDATE_MOMENTUM_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 REGISTER_MULTI_TENSOR_UPDATE_MOMENTUM_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
 REGISTER_MULTI_TENSOR_UPDATE_MOMENTUM_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
@@ -288,6 +294,9 @@ class MultiTensorAdamUpdateKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
@@ -369,6 +378,8 @@ class MultiTensorSGDUpdateWithCastKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value) \
                        && (user_op::HobDataType("model_copy", 0) == GetDataType<float16>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_WITH_CAST_KERNEL(DeviceType::kCPU, float, float);
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float);
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float16);
@@ -456,6 +467,8 @@ class MultiTensorMomentumUpdateWithCastKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("momentum_buf", 0) == GetDataType<gtype>::value) \
                        && (user_op::HobDataType("model_copy", 0) == GetDataType<float16>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_MOMENTUM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCPU, float, float);
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 REGISTER_MULTI_TENSOR_UPDATE_MOMENTUM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float);
 REGISTER_MULTI_TENSOR_UPDATE_MOMENTUM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float16);
@@ -568,6 +581,8 @@ class MultiTensorAdamUpdateWithCastKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value) \
                        && (user_op::HobDataType("model_copy", 0) == GetDataType<float16>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCPU, float, float);
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float);
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float16);
@@ -617,6 +632,8 @@ class MultiTensorYoloV5WeightUpdateKernel final : public user_op::OpKernel,
       .SetIsMatchedHob((user_op::HobDeviceType() == device)              \
                        && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value));
 
+REGISTER_MULTI_TENSOR_YOLOV5_WEIGHT_UPDATE_KERNEL(DeviceType::kCPU, float);
+
 #if defined(WITH_CUDA) || defined(WITH_ROCM)
 REGISTER_MULTI_TENSOR_YOLOV5_WEIGHT_UPDATE_KERNEL(DeviceType::kCUDA, float);
 #endif
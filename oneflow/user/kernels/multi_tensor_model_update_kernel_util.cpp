@@ -0,0 +1,317 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/multi_tensor_model_update_kernel_util.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// Tensors are cut into chunks of kChunkSize elements, so that a batch of a few large and many
+// small tensors is still spread evenly over the threads.
+constexpr int64_t kChunkSize = 4096;
+constexpr size_t kChunkGrainSize = 8;
+
+template<int N, typename F>
+void ForEachChunk(ep::Stream* stream, const int64_t n_tensor,
+                  const TensorTupleParams<N>& tensor_tuple_params, const F& func) {
+  std::vector<std::pair<int32_t, int64_t>> chunks;
+  for (int32_t tensor_idx = 0; tensor_idx < n_tensor; ++tensor_idx) {
+    for (int64_t offset = 0; offset < tensor_tuple_params.sizes[tensor_idx];
+         offset += kChunkSize) {
+      chunks.emplace_back(tensor_idx, offset);
+    }
+  }
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, chunks.size(),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int32_t tensor_idx = chunks[i].first;
+          const int64_t offset = chunks[i].second;
+          const int64_t n = std::min(kChunkSize, tensor_tuple_params.sizes[tensor_idx] - offset);
+          func(tensor_idx, offset, n);
+        }
+      },
+      kChunkGrainSize);
+}
+
+template<typename T>
+void CopyToHalf(const int64_t n, const T* model, float16* model_copy) {
+  for (int64_t i = 0; i < n; ++i) { model_copy[i] = static_cast<float16>(model[i]); }
+}
+
+// The loops below keep the per element work branch free, the conditions they test are the same
+// for all elements, so that compilers can vectorize them.
+template<typename T, typename G>
+void SGDUpdate(const int64_t n, T scale, float l1, float l2, float weight_decay,
+               float learning_rate, const G* model_diff, T* model) {
+  for (int64_t i = 0; i < n; ++i) {
+    const T model_val = model[i];
+    const T model_diff_t =
+        CastScaleRegularizeGradientFunctor<T, G>()(model_diff[i], model_val, scale, l1, l2);
+    model[i] = model_val - learning_rate * (model_diff_t + weight_decay * model_val);
+  }
+}
+
+template<typename T, typename G>
+void MomentumUpdate(const int64_t n, T scale, float l1, float l2, float weight_decay,
+                    float learning_rate, float momentum, float dampening, bool nesterov,
+                    bool maximize, const G* model_diff, T* model, T* momentum_buf) {
+  const T alpha = maximize ? learning_rate : -learning_rate;
+  for (int64_t i = 0; i < n; ++i) {
+    const T model_val = model[i];
+    T model_diff_t =
+        CastScaleRegularizeGradientFunctor<T, G>()(model_diff[i], model_val, scale, l1, l2);
+    if (weight_decay != 0.f) { model_diff_t += weight_decay * model_val; }
+    const T buf = momentum * momentum_buf[i] + (1.f - dampening) * model_diff_t;
+    momentum_buf[i] = buf;
+    model_diff_t = nesterov ? model_diff_t + momentum * buf : buf;
+    model[i] = model_val + alpha * model_diff_t;
+  }
+}
+
+template<typename T, typename G>
+void AdamUpdate(const int64_t n, T scale, float l1, float l2, float beta1, float beta2,
+                float epsilon, float weight_decay, float learning_rate, float bias_correction1,
+                float bias_correction2, const G* model_diff, T* model, T* m, T* v) {
+  const T step_size = learning_rate / bias_correction1;
+  const T sqrt_bias_correction2 = std::sqrt(static_cast<T>(bias_correction2));
+  for (int64_t i = 0; i < n; ++i) {
+    const T model_val = model[i];
+    const T model_diff_t =
+        CastScaleRegularizeGradientFunctor<T, G>()(model_diff[i], model_val, scale, l1, l2);
+    const T m_val = beta1 * m[i] + (1 - beta1) * model_diff_t;
+    const T v_val = beta2 * v[i] + (1 - beta2) * model_diff_t * model_diff_t;
+    m[i] = m_val;
+    v[i] = v_val;
+    const T denom = std::sqrt(v_val) / sqrt_bias_correction2 + epsilon;
+    model[i] = model_val - step_size * (m_val / denom) - learning_rate * weight_decay * model_val;
+  }
+}
+
+// With N == kCastTuples the last pointer of each tuple is the half model copy.
+template<typename T, typename G, int N, int kCastTuples>
+void MultiTensorSGDUpdate(ep::Stream* stream, const int64_t n_tensor, T scale, float l1,
+                          float l2, float weight_decay, float learning_rate_val, float lr_scale,
+                          const float* learning_rate, const T* scale_by_ptr,
+                          const int64_t* skip_if, const TensorTupleParams<N>& tensor_tuple_params) {
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate != nullptr) { learning_rate_val = *learning_rate; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  learning_rate_val *= lr_scale;
+  ForEachChunk(stream, n_tensor, tensor_tuple_params,
+               [&](int32_t tensor_idx, int64_t offset, int64_t n) {
+                 T* model = static_cast<T*>(tensor_tuple_params.ptr[0][tensor_idx]) + offset;
+                 const G* model_diff =
+                     static_cast<const G*>(tensor_tuple_params.ptr[1][tensor_idx]) + offset;
+                 SGDUpdate<T, G>(n, scale, l1, l2, weight_decay, learning_rate_val, model_diff,
+                                 model);
+                 if (N == kCastTuples) {
+                   CopyToHalf<T>(
+                       n, model,
+                       static_cast<float16*>(tensor_tuple_params.ptr[N - 1][tensor_idx]) + offset);
+                 }
+               });
+}
+
+template<typename T, typename G, int N, int kCastTuples>
+void MultiTensorMomentumUpdate(ep::Stream* stream, const int64_t n_tensor, T scale, float l1,
+                               float l2, float weight_decay, float learning_rate_val,
+                               float lr_scale, const float* learning_rate, const T* scale_by_ptr,
+                               const int64_t* skip_if, const float momentum,
+                               const float dampening, const bool nesterov, const bool maximize,
+                               const TensorTupleParams<N>& tensor_tuple_params) {
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate != nullptr) { learning_rate_val = *learning_rate; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  learning_rate_val *= lr_scale;
+  ForEachChunk(stream, n_tensor, tensor_tuple_params,
+               [&](int32_t tensor_idx, int64_t offset, int64_t n) {
+                 T* model = static_cast<T*>(tensor_tuple_params.ptr[0][tensor_idx]) + offset;
+                 const G* model_diff =
+                     static_cast<const G*>(tensor_tuple_params.ptr[1][tensor_idx]) + offset;
+                 T* momentum_buf = static_cast<T*>(tensor_tuple_params.ptr[2][tensor_idx]) + offset;
+                 MomentumUpdate<T, G>(n, scale, l1, l2, weight_decay, learning_rate_val, momentum,
+                                      dampening, nesterov, maximize, model_diff, model,
+                                      momentum_buf);
+                 if (N == kCastTuples) {
+                   CopyToHalf<T>(
+                       n, model,
+                       static_cast<float16*>(tensor_tuple_params.ptr[N - 1][tensor_idx]) + offset);
+                 }
+               });
+}
+
+template<typename T, typename G, int N, int kCastTuples>
+void MultiTensorAdamUpdate(ep::Stream* stream, const int64_t n_tensor, T scale, float l1,
+                           float l2, float beta1, float beta2, float epsilon, float weight_decay,
+                           float learning_rate_val, float bias_correction1_val,
+                           float bias_correction2_val, float lr_scale, const float* learning_rate,
+                           const T* scale_by_ptr, const int64_t* skip_if,
+                           const float* bias_correction1_ptr, const float* bias_correction2_ptr,
+                           const TensorTupleParams<N>& tensor_tuple_params) {
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate != nullptr) { learning_rate_val = *learning_rate; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  if (bias_correction1_ptr != nullptr) { bias_correction1_val = *bias_correction1_ptr; }
+  if (bias_correction2_ptr != nullptr) { bias_correction2_val = *bias_correction2_ptr; }
+  learning_rate_val *= lr_scale;
+  ForEachChunk(stream, n_tensor, tensor_tuple_params,
+               [&](int32_t tensor_idx, int64_t offset, int64_t n) {
+                 T* model = static_cast<T*>(tensor_tuple_params.ptr[0][tensor_idx]) + offset;
+                 const G* model_diff =
+                     static_cast<const G*>(tensor_tuple_params.ptr[1][tensor_idx]) + offset;
+                 T* m = static_cast<T*>(tensor_tuple_params.ptr[2][tensor_idx]) + offset;
+                 T* v = static_cast<T*>(tensor_tuple_params.ptr[3][tensor_idx]) + offset;
+                 AdamUpdate<T, G>(n, scale, l1, l2, beta1, beta2, epsilon, weight_decay,
+                                  learning_rate_val, bias_correction1_val, bias_correction2_val,
+                                  model_diff, model, m, v);
+                 if (N == kCastTuples) {
+                   CopyToHalf<T>(
+                       n, model,
+                       static_cast<float16*>(tensor_tuple_params.ptr[N - 1][tensor_idx]) + offset);
+                 }
+               });
+}
+
+template<typename T>
+void YoloV5WeightUpdate(const int64_t n, float d, const T* model_update, T* model) {
+  for (int64_t i = 0; i < n; ++i) { model[i] = model[i] * d + (1 - d) * model_update[i]; }
+}
+
+}  // namespace
+
+template<typename T, typename G>
+struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float weight_decay, float learning_rate_val,
+                     float lr_scale, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, TensorTupleParams<2> tensor_tuple_params) {
+    MultiTensorSGDUpdate<T, G, 2, 3>(stream, n_tensor, scale, l1, l2, weight_decay,
+                                     learning_rate_val, lr_scale, learning_rate, scale_by_ptr,
+                                     skip_if, tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
+template<typename T, typename G>
+struct MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float weight_decay, float learning_rate_val,
+                     float lr_scale, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, const float momentum, const float dampening,
+                     const bool nesterov, const bool maximize,
+                     TensorTupleParams<3> tensor_tuple_params) {
+    MultiTensorMomentumUpdate<T, G, 3, 4>(stream, n_tensor, scale, l1, l2, weight_decay,
+                                          learning_rate_val, lr_scale, learning_rate,
+                                          scale_by_ptr, skip_if, momentum, dampening, nesterov,
+                                          maximize, tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
+template<typename T, typename G>
+struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float beta1, float beta2, float epsilon,
+                     float weight_decay, bool amsgrad, bool do_bias_correction,
+                     float learning_rate_val, float bias_correction1_val,
+                     float bias_correction2_val, float lr_scale, const float* learning_rate,
+                     const T* scale_by_ptr, const int64_t* skip_if, const float* bias_correction1,
+                     const float* bias_correction2, TensorTupleParams<4> tensor_tuple_params) {
+    MultiTensorAdamUpdate<T, G, 4, 5>(stream, n_tensor, scale, l1, l2, beta1, beta2, epsilon,
+                                      weight_decay, learning_rate_val, bias_correction1_val,
+                                      bias_correction2_val, lr_scale, learning_rate, scale_by_ptr,
+                                      skip_if, bias_correction1, bias_correction2,
+                                      tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
+template<typename T, typename G>
+struct MultiTensorSGDUpdateWithCastKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float weight_decay, float learning_rate_val,
+                     float lr_scale, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, TensorTupleParams<3> tensor_tuple_params) {
+    MultiTensorSGDUpdate<T, G, 3, 3>(stream, n_tensor, scale, l1, l2, weight_decay,
+                                     learning_rate_val, lr_scale, learning_rate, scale_by_ptr,
+                                     skip_if, tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorSGDUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>;
+
+template<typename T, typename G>
+struct MultiTensorMomentumUpdateWithCastKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float weight_decay, float learning_rate_val,
+                     float lr_scale, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, const float momentum, const float dampening,
+                     const bool nesterov, const bool maximize,
+                     TensorTupleParams<4> tensor_tuple_params) {
+    MultiTensorMomentumUpdate<T, G, 4, 4>(stream, n_tensor, scale, l1, l2, weight_decay,
+                                          learning_rate_val, lr_scale, learning_rate,
+                                          scale_by_ptr, skip_if, momentum, dampening, nesterov,
+                                          maximize, tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorMomentumUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>;
+
+template<typename T, typename G>
+struct MultiTensorAdamUpdateWithCastKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float beta1, float beta2, float epsilon,
+                     float weight_decay, bool amsgrad, bool do_bias_correction,
+                     float learning_rate_val, float bias_correction1_val,
+                     float bias_correction2_val, float lr_scale, const float* learning_rate,
+                     const T* scale_by_ptr, const int64_t* skip_if, const float* bias_correction1,
+                     const float* bias_correction2, TensorTupleParams<5> tensor_tuple_params) {
+    MultiTensorAdamUpdate<T, G, 5, 5>(stream, n_tensor, scale, l1, l2, beta1, beta2, epsilon,
+                                      weight_decay, learning_rate_val, bias_correction1_val,
+                                      bias_correction2_val, lr_scale, learning_rate, scale_by_ptr,
+                                      skip_if, bias_correction1, bias_correction2,
+                                      tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorAdamUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>;
+
+template<typename T>
+struct MultiTensorYoloV5WeightUpdateKernelUtil<DeviceType::kCPU, T> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, float d,
+                     TensorTupleParams<2> tensor_tuple_params) {
+    ForEachChunk(stream, n_tensor, tensor_tuple_params,
+                 [&](int32_t tensor_idx, int64_t offset, int64_t n) {
+                   YoloV5WeightUpdate<T>(
+                       n, d,
+                       static_cast<const T*>(tensor_tuple_params.ptr[1][tensor_idx]) + offset,
+                       static_cast<T*>(tensor_tuple_params.ptr[0][tensor_idx]) + offset);
+                 });
+  }
+};
+
+template struct MultiTensorYoloV5WeightUpdateKernelUtil<DeviceType::kCPU, float>;
+
+}  // namespace oneflow
@@ -0,0 +1,238 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/multi_tensor_model_update_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/thread/thread_runtime.h"
+
+#include <gtest/gtest.h>
+#include <random>
+
+namespace oneflow {
+namespace test {
+
+namespace {
+
+// Sizes around the chunk size of the CPU kernels, with more chunks than threads
+const std::vector<int64_t> kSizes = {1, 7, 4095, 4096, 4097, 20000};
+constexpr int kNumThreads = 4;
+constexpr float kTolerance = 1e-5;
+
+using Tensors = std::vector<std::vector<float>>;
+
+Tensors RandomTensors(std::mt19937* gen, float low, float high) {
+  std::uniform_real_distribution<float> dist(low, high);
+  Tensors tensors(kSizes.size());
+  for (size_t t = 0; t < kSizes.size(); ++t) {
+    tensors.at(t).resize(kSizes.at(t));
+    for (float& value : tensors.at(t)) { value = dist(*gen); }
+  }
+  return tensors;
+}
+
+template<int N>
+TensorTupleParams<N> MakeParams(const std::vector<void*>& ptrs_per_tuple,
+                                const std::vector<Tensors*>& tuples) {
+  TensorTupleParams<N> params{};
+  for (size_t t = 0; t < kSizes.size(); ++t) {
+    for (int i = 0; i < N; ++i) {
+      params.ptr[i][t] = static_cast<size_t>(i) < tuples.size()
+                             ? static_cast<void*>(tuples.at(i)->at(t).data())
+                             : static_cast<void**>(ptrs_per_tuple.at(i))[t];
+    }
+    params.sizes[t] = kSizes.at(t);
+  }
+  return params;
+}
+
+float Regularize(float model_diff, float model, float scale, float l1, float l2) {
+  return model_diff * scale + l1 * ((model >= 0) - (model <= 0)) + l2 * model;
+}
+
+void ExpectNear(const Tensors& expected, const Tensors& actual) {
+  for (size_t t = 0; t < expected.size(); ++t) {
+    for (size_t i = 0; i < expected.at(t).size(); ++i) {
+      ASSERT_NEAR(expected.at(t).at(i), actual.at(t).at(i), kTolerance)
+          << "tensor " << t << " index " << i;
+    }
+  }
+}
+
+class MultiTensorModelUpdateTest : public testing::Test {
+ protected:
+  MultiTensorModelUpdateTest()
+      : device_(nullptr),
+        stream_(&device_,
+                std::make_shared<thread::OfRuntime>(kNumThreads, std::vector<int32_t>()),
+                kNumThreads, std::vector<int32_t>()),
+        gen_(0) {}
+
+  ep::CpuDevice device_;
+  ep::CpuStream stream_;
+  std::mt19937 gen_;
+};
+
+}  // namespace
+
+TEST_F(MultiTensorModelUpdateTest, sgd) {
+  Tensors model = RandomTensors(&gen_, -1, 1);
+  Tensors model_diff = RandomTensors(&gen_, -1, 1);
+  const float scale = 0.5;
+  const float scale_by = 2;
+  const float l1 = 0.01;
+  const float l2 = 0.02;
+  const float weight_decay = 0.1;
+  const float learning_rate = 0.3;
+  const float lr_scale = 0.5;
+  Tensors expected = model;
+  for (size_t t = 0; t < model.size(); ++t) {
+    for (size_t i = 0; i < model.at(t).size(); ++i) {
+      float& m = expected.at(t).at(i);
+      const float g = Regularize(model_diff.at(t).at(i), m, scale * scale_by, l1, l2);
+      m = m - learning_rate * lr_scale * (g + weight_decay * m);
+    }
+  }
+  MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+      &stream_, 0, kSizes.size(), scale, l1, l2, weight_decay, 0, lr_scale, &learning_rate,
+      &scale_by, nullptr, MakeParams<2>({}, {&model, &model_diff}));
+  ExpectNear(expected, model);
+}
+
+TEST_F(MultiTensorModelUpdateTest, sgd_skip_if) {
+  Tensors model = RandomTensors(&gen_, -1, 1);
+  Tensors model_diff = RandomTensors(&gen_, -1, 1);
+  const Tensors origin = model;
+  const int64_t skip = 1;
+  MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+      &stream_, 0, kSizes.size(), 1, 0, 0, 0, 0.1, 1, nullptr, nullptr, &skip,
+      MakeParams<2>({}, {&model, &model_diff}));
+  ASSERT_EQ(origin, model);
+}
+
+TEST_F(MultiTensorModelUpdateTest, momentum) {
+  for (const bool nesterov : {false, true}) {
+    for (const bool maximize : {false, true}) {
+      Tensors model = RandomTensors(&gen_, -1, 1);
+      Tensors momentum_buf = RandomTensors(&gen_, -0.1, 0.1);
+      Tensors expected = model;
+      Tensors expected_buf = momentum_buf;
+      const float scale = 0.25;
+      const float l1 = 0.01;
+      const float l2 = 0.02;
+      const float weight_decay = 0.05;
+      const float learning_rate = 0.1;
+      const float momentum = 0.9;
+      const float dampening = 0.1;
+      for (int step = 0; step < 2; ++step) {
+        Tensors model_diff = RandomTensors(&gen_, -1, 1);
+        for (size_t t = 0; t < model.size(); ++t) {
+          for (size_t i = 0; i < model.at(t).size(); ++i) {
+            float& m = expected.at(t).at(i);
+            float& buf = expected_buf.at(t).at(i);
+            float g = Regularize(model_diff.at(t).at(i), m, scale, l1, l2) + weight_decay * m;
+            buf = momentum * buf + (1 - dampening) * g;
+            g = nesterov ? g + momentum * buf : buf;
+            m = maximize ? m + learning_rate * g : m - learning_rate * g;
+          }
+        }
+        MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+            &stream_, 0, kSizes.size(), scale, l1, l2, weight_decay, learning_rate, 1, nullptr,
+            nullptr, nullptr, momentum, dampening, nesterov, maximize,
+            MakeParams<3>({}, {&model, &model_diff, &momentum_buf}));
+      }
+      ExpectNear(expected, model);
+      ExpectNear(expected_buf, momentum_buf);
+    }
+  }
+}
+
+TEST_F(MultiTensorModelUpdateTest, adam) {
+  Tensors model = RandomTensors(&gen_, -1, 1);
+  Tensors model_diff = RandomTensors(&gen_, -1, 1);
+  Tensors m = RandomTensors(&gen_, -0.1, 0.1);
+  Tensors v = RandomTensors(&gen_, 0, 0.1);
+  const float scale = 2;
+  const float scale_by = 0.25;
+  const float l1 = 0.01;
+  const float l2 = 0.02;
+  const float beta1 = 0.9;
+  const float beta2 = 0.999;
+  const float epsilon = 1e-8;
+  const float weight_decay = 0.1;
+  const float learning_rate = 0.01;
+  const float bias_correction1 = 0.19;
+  const float bias_correction2 = 0.002;
+  Tensors expected = model;
+  Tensors expected_m = m;
+  Tensors expected_v = v;
+  for (size_t t = 0; t < model.size(); ++t) {
+    for (size_t i = 0; i < model.at(t).size(); ++i) {
+      float& x = expected.at(t).at(i);
+      const float g = Regularize(model_diff.at(t).at(i), x, scale * scale_by, l1, l2);
+      float& m_val = expected_m.at(t).at(i);
+      float& v_val = expected_v.at(t).at(i);
+      m_val = beta1 * m_val + (1 - beta1) * g;
+      v_val = beta2 * v_val + (1 - beta2) * g * g;
+      const float denom = std::sqrt(v_val) / std::sqrt(bias_correction2) + epsilon;
+      x = x - learning_rate / bias_correction1 * (m_val / denom) - learning_rate * weight_decay * x;
+    }
+  }
+  MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+      &stream_, 0, kSizes.size(), scale, l1, l2, beta1, beta2, epsilon, weight_decay, false, true,
+      learning_rate, 1, 1, 1, nullptr, &scale_by, nullptr, &bias_correction1, &bias_correction2,
+      MakeParams<4>({}, {&model, &model_diff, &m, &v}));
+  ExpectNear(expected, model);
+  ExpectNear(expected_m, m);
+  ExpectNear(expected_v, v);
+}
+
+TEST_F(MultiTensorModelUpdateTest, sgd_with_cast) {
+  Tensors model = RandomTensors(&gen_, -1, 1);
+  Tensors model_diff = RandomTensors(&gen_, -1, 1);
+  std::vector<std::vector<float16>> model_copy(kSizes.size());
+  std::vector<void*> model_copy_ptrs(kSizes.size());
+  for (size_t t = 0; t < kSizes.size(); ++t) {
+    model_copy.at(t).resize(kSizes.at(t));
+    model_copy_ptrs.at(t) = model_copy.at(t).data();
+  }
+  MultiTensorSGDUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>::Update(
+      &stream_, 0, kSizes.size(), 1, 0, 0, 0, 0.1, 1, nullptr, nullptr, nullptr,
+      MakeParams<3>({nullptr, nullptr, model_copy_ptrs.data()}, {&model, &model_diff}));
+  for (size_t t = 0; t < kSizes.size(); ++t) {
+    for (size_t i = 0; i < model.at(t).size(); ++i) {
+      ASSERT_EQ(static_cast<float>(static_cast<float16>(model.at(t).at(i))),
+                static_cast<float>(model_copy.at(t).at(i)));
+    }
+  }
+}
+
+TEST_F(MultiTensorModelUpdateTest, yolov5_weight_update) {
+  Tensors model = RandomTensors(&gen_, -1, 1);
+  Tensors model_update = RandomTensors(&gen_, -1, 1);
+  const float d = 0.3;
+  Tensors expected = model;
+  for (size_t t = 0; t < model.size(); ++t) {
+    for (size_t i = 0; i < model.at(t).size(); ++i) {
+      expected.at(t).at(i) = expected.at(t).at(i) * d + (1 - d) * model_update.at(t).at(i);
+    }
+  }
+  MultiTensorYoloV5WeightUpdateKernelUtil<DeviceType::kCPU, float>::Update(
+      &stream_, 0, kSizes.size(), d, MakeParams<2>({}, {&model, &model_update}));
+  ExpectNear(expected, model);
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -0,0 +1,229 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_ONE_EMBEDDING_INITIALIZER_H_
+#define ONEFLOW_USER_KERNELS_ONE_EMBEDDING_INITIALIZER_H_
+
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+enum class InitializerType { kUniform, kNormal, kConstant, kTruncNormal };
+
+struct EmbeddingInitializer {
+  InitializerType type;
+  union {
+    struct {
+      float low;
+      float high;
+    } uniform_param;
+    struct {
+      float mean;
+      float std;
+    } normal_param;
+    struct {
+      float value;
+    } constant_param;
+    struct {
+      float mean;
+      float std;
+      float a;
+      float b;
+    } trunc_normal_param;
+  };
+
+  bool operator==(const EmbeddingInitializer& rhs) const {
+    if (this->type != rhs.type) { return false; }
+    if (rhs.type == InitializerType::kUniform) {
+      return (this->uniform_param.low == rhs.uniform_param.low)
+             && (this->uniform_param.high == rhs.uniform_param.high);
+    } else if (rhs.type == InitializerType::kNormal) {
+      return (this->normal_param.mean == rhs.normal_param.mean)
+             && (this->normal_param.std == rhs.normal_param.std);
+    } else if (rhs.type == InitializerType::kConstant) {
+      return this->constant_param.value == rhs.constant_param.value;
+    } else if (rhs.type == InitializerType::kTruncNormal) {
+      return (this->trunc_normal_param.mean == rhs.trunc_normal_param.mean)
+             && (this->trunc_normal_param.std == rhs.trunc_normal_param.std)
+             && (this->trunc_normal_param.a == rhs.trunc_normal_param.a)
+             && (this->trunc_normal_param.b == rhs.trunc_normal_param.b);
+    } else {
+      UNIMPLEMENTED();
+      return false;
+    }
+  }
+};
+
+inline void ParseInitializerFromJson(const nlohmann::json& initializer,
+                                     EmbeddingInitializer* embedding_initializer) {
+  CHECK(initializer.contains("type"));
+  CHECK(initializer["type"].is_string());
+  std::string type = initializer["type"].get<std::string>();
+  if (type == "uniform") {
+    embedding_initializer->type = InitializerType::kUniform;
+    CHECK(initializer.contains("low"));
+    CHECK(initializer.contains("high"));
+    CHECK(initializer["low"].is_number());
+    CHECK(initializer["high"].is_number());
+    embedding_initializer->uniform_param.low = initializer["low"];
+    embedding_initializer->uniform_param.high = initializer["high"];
+  } else if (type == "normal") {
+    CHECK(initializer.contains("mean"));
+    CHECK(initializer.contains("std"));
+    CHECK(initializer["mean"].is_number());
+    CHECK(initializer["std"].is_number());
+    embedding_initializer->type = InitializerType::kNormal;
+    embedding_initializer->normal_param.mean = initializer["mean"];
+    embedding_initializer->normal_param.std = initializer["std"];
+  } else if (type == "constant") {
+    CHECK(initializer.contains("value"));
+    CHECK(initializer["value"].is_number());
+    embedding_initializer->type = InitializerType::kConstant;
+    embedding_initializer->constant_param.value = initializer["value"];
+  } else if (type == "trunc_normal") {
+    CHECK(initializer.contains("mean"));
+    CHECK(initializer.contains("std"));
+    CHECK(initializer.contains("a"));
+    CHECK(initializer.contains("b"));
+    CHECK(initializer["mean"].is_number());
+    CHECK(initializer["std"].is_number());
+    CHECK(initializer["a"].is_number());
+    CHECK(initializer["b"].is_number());
+    embedding_initializer->type = InitializerType::kTruncNormal;
+    embedding_initializer->trunc_normal_param.mean = initializer["mean"];
+    embedding_initializer->trunc_normal_param.std = initializer["std"];
+    embedding_initializer->trunc_normal_param.a = initializer["a"];
+    embedding_initializer->trunc_normal_param.b = initializer["b"];
+  } else {
+    UNIMPLEMENTED() << "Unsupported initializer type";
+  }
+}
+
+inline int32_t ParseJsonToUniqueInitializerVecAndReturnOffset(
+    const nlohmann::json& initializer, std::vector<EmbeddingInitializer>* initializers) {
+  EmbeddingInitializer embedding_initializer;
+  ParseInitializerFromJson(initializer, &embedding_initializer);
+  for (int32_t i = 0; i < initializers->size(); ++i) {
+    if (initializers->at(i) == embedding_initializer) { return i; }
+  }
+  initializers->push_back(embedding_initializer);
+  return initializers->size() - 1;
+}
+
+inline void SetInitializerIndex(int32_t row_id, int32_t col_start, int32_t col_end,
+                                int64_t line_size, int8_t index,
+                                std::vector<int8_t>* initializer_index) {
+  int64_t row_offset = row_id * line_size;
+  for (int32_t col = col_start; col < col_end; ++col) {
+    initializer_index->at(row_offset + col) = index;
+  }
+}
+
+inline void ParseAndSetStateInitializerIndex(const std::string& state_initializer,
+                                             const int32_t num_tables, const int64_t line_size,
+                                             const int64_t embedding_size,
+                                             std::vector<EmbeddingInitializer>* initializer_params,
+                                             std::vector<int8_t>* initializer_index) {
+  if (line_size == embedding_size) { return; }
+  CHECK(!state_initializer.empty());
+  auto initializers = nlohmann::json::parse(state_initializer);
+  CHECK(initializers.is_array());
+  const int num_states = line_size / embedding_size - 1;
+  CHECK_EQ(num_states, initializers.size());
+  for (int32_t i = 0; i < num_states; ++i) {
+    int32_t offset =
+        ParseJsonToUniqueInitializerVecAndReturnOffset(initializers.at(i), initializer_params);
+    int32_t col_start = embedding_size + i * embedding_size;
+    int32_t col_end = col_start + embedding_size;
+    CHECK_LE(col_end, line_size);
+    for (int32_t j = 0; j < num_tables; ++j) {
+      SetInitializerIndex(j, col_start, col_end, line_size, offset, initializer_index);
+    }
+  }
+}
+
+inline void ParseAndSetStepInitializerIndex(const int32_t num_tables, const int64_t line_size,
+                                            const int64_t embedding_size,
+                                            std::vector<EmbeddingInitializer>* initializer_params,
+                                            std::vector<int8_t>* initializer_index) {
+  if (line_size % embedding_size == 0) { return; }
+  nlohmann::json initializer;
+  initializer["type"] = "constant";
+  initializer["value"] = 0.0;
+  int32_t offset = ParseJsonToUniqueInitializerVecAndReturnOffset(initializer, initializer_params);
+  int32_t col_start = line_size / embedding_size * embedding_size;
+  int32_t col_end = line_size;
+  CHECK_LE(col_end, line_size);
+  for (int32_t j = 0; j < num_tables; ++j) {
+    SetInitializerIndex(j, col_start, col_end, line_size, offset, initializer_index);
+  }
+}
+
+inline void ParseAndSetModelInitializerIndex(const nlohmann::json& tables,
+                                             const std::vector<int64_t>& column_dims,
+                                             const int32_t num_tables, const int32_t num_columns,
+                                             const int64_t line_size, const int64_t embedding_size,
+                                             std::vector<EmbeddingInitializer>* initializer_params,
+                                             std::vector<int8_t>* initializer_index) {
+  for (int32_t i = 0; i < num_tables; ++i) {
+    auto table = tables.at(i);
+    CHECK(table.contains("columns"));
+    auto columns = table["columns"];
+    CHECK(columns.is_array());
+    CHECK_EQ(num_columns, columns.size()) << "columns size must equal to num embedding dims";
+    int32_t col_start = 0;
+    for (int k = 0; k < columns.size(); ++k) {
+      auto column = columns.at(k);
+      CHECK(column.contains("initializer"));
+      int32_t offset =
+          ParseJsonToUniqueInitializerVecAndReturnOffset(column["initializer"], initializer_params);
+      int32_t col_end = col_start + column_dims.at(k);
+      SetInitializerIndex(i, col_start, col_end, line_size, offset, initializer_index);
+      col_start = col_end;
+    }
+    CHECK_EQ(col_start, embedding_size);
+  }
+}
+
+inline void ParseInitializers(const int64_t line_size, const int64_t embedding_size,
+                              const std::string& state_initializer,
+                              const std::string& json_serialized,
+                              std::vector<EmbeddingInitializer>* initializer_params,
+                              std::vector<int8_t>* initializer_index) {
+  auto json_object = nlohmann::json::parse(json_serialized);
+  CHECK(json_object.contains("column_dims"));
+  std::vector<int64_t> column_dims = json_object["column_dims"];
+  const int32_t num_columns = column_dims.size();
+  CHECK(json_object.contains("tables"));
+  auto tables = json_object["tables"];
+  CHECK(tables.is_array());
+  const int32_t num_tables = tables.size();
+  initializer_index->resize(num_tables * line_size);
+  ParseAndSetStepInitializerIndex(num_tables, line_size, embedding_size, initializer_params,
+                                  initializer_index);
+  ParseAndSetStateInitializerIndex(state_initializer, num_tables, line_size, embedding_size,
+                                   initializer_params, initializer_index);
+  ParseAndSetModelInitializerIndex(tables, column_dims, num_tables, num_columns, line_size,
+                                   embedding_size, initializer_params, initializer_index);
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_ONE_EMBEDDING_INITIALIZER_H_
@@ -0,0 +1,482 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/embedding/key_value_store.h"
+#include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/cast.h"
+#include "oneflow/user/kernels/one_embedding_initializer.h"
+#include <random>
+
+namespace oneflow {
+
+namespace {
+
+using embedding::EmbeddingInitializer;
+using embedding::InitializerType;
+using embedding::ParseInitializers;
+
+constexpr size_t kRowGrainSize = 64;
+
+class CpuEmbeddingKernelState final : public user_op::OpKernelState {
+ public:
+  explicit CpuEmbeddingKernelState(user_op::KernelInitContext* ctx) {
+    const std::string& embedding_name = ctx->Attr<std::string>("embedding_name");
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    key_value_store_ = Singleton<embedding::EmbeddingManager>::Get()->GetKeyValueStore(
+        embedding_name, parallel_id);
+    uint32_t max_query_length =
+        ctx->TensorDesc4ArgNameAndIndex("unique_ids", 0)->shape().elem_cnt();
+    key_value_store_->ReserveQueryLength(max_query_length);
+    embedding_state_ = Singleton<embedding::EmbeddingManager>::Get()->GetEmbeddingState(
+        embedding_name, parallel_id);
+    ParseInitializers(ctx->Attr<int64_t>("line_size"), ctx->Attr<int64_t>("embedding_size"),
+                      ctx->Attr<std::string>("state_initializer"),
+                      ctx->Attr<std::string>("embedding_tables"), &initializer_param_,
+                      &initializer_index_);
+  }
+  ~CpuEmbeddingKernelState() override = default;
+
+  embedding::KeyValueStore* KeyValueStore() { return key_value_store_; }
+
+  embedding::EmbeddingState* EmbeddingState() { return embedding_state_; }
+
+  const int8_t* InitializerIndex() { return initializer_index_.data(); }
+  const EmbeddingInitializer* Initializers() { return initializer_param_.data(); }
+
+ private:
+  embedding::KeyValueStore* key_value_store_;
+  embedding::EmbeddingState* embedding_state_;
+  std::vector<EmbeddingInitializer> initializer_param_;
+  std::vector<int8_t> initializer_index_;
+};
+
+class CpuEmbeddingPutKernelState final : public user_op::OpKernelState {
+ public:
+  explicit CpuEmbeddingPutKernelState(user_op::KernelInitContext* ctx) {
+    const std::string& embedding_name = ctx->Attr<std::string>("embedding_name");
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    key_value_store_ = Singleton<embedding::EmbeddingManager>::Get()->GetKeyValueStore(
+        embedding_name, parallel_id);
+    uint32_t max_query_length =
+        ctx->TensorDesc4ArgNameAndIndex("unique_ids", 0)->shape().elem_cnt();
+    key_value_store_->ReserveQueryLength(max_query_length);
+    embedding_state_ = Singleton<embedding::EmbeddingManager>::Get()->GetEmbeddingState(
+        embedding_name, parallel_id);
+  }
+  ~CpuEmbeddingPutKernelState() override = default;
+
+  embedding::KeyValueStore* KeyValueStore() { return key_value_store_; }
+  embedding::EmbeddingState* EmbeddingState() { return embedding_state_; }
+
+ private:
+  embedding::KeyValueStore* key_value_store_;
+  embedding::EmbeddingState* embedding_state_;
+};
+
+// The values of a missing row only depend on the seed and the id, like the cuda kernel which
+// seeds philox with them, so a row is initialized the same whatever the batch it comes in.
+template<typename T, typename K, typename U>
+void InitMissingValues(ep::Stream* stream, uint64_t seed, const int32_t line_size,
+                       const EmbeddingInitializer* initializer_param,
+                       const int8_t* initializer_index, const K* unique_ids, const U* table_ids,
+                       uint32_t num_missing, const uint32_t* missing_indices, T* values) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_missing,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const uint32_t index = missing_indices[row];
+          const int32_t table_idx = table_ids[index];
+          const uint64_t id = static_cast<uint64_t>(unique_ids[index]);
+          std::seed_seq seq{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                            static_cast<uint32_t>(id), static_cast<uint32_t>(id >> 32)};
+          std::mt19937 engine(seq);
+          std::uniform_real_distribution<float> uniform(0.F, 1.F);
+          std::normal_distribution<float> normal(0.F, 1.F);
+          T* row_values = values + static_cast<int64_t>(index) * line_size;
+          for (int32_t col = 0; col < line_size; ++col) {
+            const int32_t initializer_idx = initializer_index[table_idx * line_size + col];
+            const EmbeddingInitializer& initializer = initializer_param[initializer_idx];
+            T value;
+            if (initializer.type == InitializerType::kUniform) {
+              const float low = initializer.uniform_param.low;
+              const float high = initializer.uniform_param.high;
+              value = uniform(engine) * (high - low) + low;
+            } else if (initializer.type == InitializerType::kNormal) {
+              value = normal(engine) * initializer.normal_param.std + initializer.normal_param.mean;
+            } else if (initializer.type == InitializerType::kConstant) {
+              value = initializer.constant_param.value;
+            } else if (initializer.type == InitializerType::kTruncNormal) {
+              const float mean = initializer.trunc_normal_param.mean;
+              const float std = initializer.trunc_normal_param.std;
+              const float a = initializer.trunc_normal_param.a;
+              const float b = initializer.trunc_normal_param.b;
+              do { value = normal(engine) * std + mean; } while (value < a || value > b);
+            } else {
+              UNIMPLEMENTED();
+            }
+            row_values[col] = value;
+          }
+        }
+      },
+      kRowGrainSize);
+}
+
+template<typename T, typename K, typename U>
+void LookupAndInitMissing(ep::Stream* stream, CpuEmbeddingKernelState* kernel_state, uint64_t seed,
+                          uint32_t num_unique, const int64_t line_size, const bool put_to_store,
+                          const void* unique_ids, const void* table_ids, uint32_t* num_missing_ptr,
+                          uint32_t* missing_indices, void* store_values) {
+  embedding::KeyValueStore* store = kernel_state->KeyValueStore();
+  store->Get(stream, num_unique, unique_ids, store_values, num_missing_ptr, missing_indices);
+  const uint32_t num_missing = *num_missing_ptr;
+  if (num_missing > 0) {
+    InitMissingValues<T, K, U>(stream, seed, line_size, kernel_state->Initializers(),
+                               kernel_state->InitializerIndex(),
+                               reinterpret_cast<const K*>(unique_ids),
+                               reinterpret_cast<const U*>(table_ids), num_missing, missing_indices,
+                               reinterpret_cast<T*>(store_values));
+  }
+  if (put_to_store) { store->Put(stream, num_unique, unique_ids, store_values); }
+}
+
+template<typename T>
+void CopyValuesToEmbeddings(ep::Stream* stream, int64_t num_unique, const int32_t embedding_size,
+                            const int32_t value_size, const DataType value_dtype,
+                            const DataType embedding_dtype, const T* values, void* embeddings) {
+  if (value_dtype == embedding_dtype) {
+    T* embeddings_ptr = reinterpret_cast<T*>(embeddings);
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, num_unique,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            std::copy(values + row * value_size, values + row * value_size + embedding_size,
+                      embeddings_ptr + row * embedding_size);
+          }
+        },
+        kRowGrainSize);
+    return;
+  }
+  std::unique_ptr<ep::primitive::Cast> cast_primitive =
+      ep::primitive::NewPrimitive<ep::primitive::CastFactory>(DeviceType::kCPU, value_dtype,
+                                                              embedding_dtype);
+  CHECK(cast_primitive);
+  if (value_size == embedding_size) {
+    cast_primitive->Launch(stream, values, embeddings, num_unique * embedding_size);
+  } else {
+    const size_t embedding_row_bytes = embedding_size * GetSizeOfDataType(embedding_dtype);
+    for (int64_t row = 0; row < num_unique; ++row) {
+      cast_primitive->Launch(stream, values + row * value_size,
+                             reinterpret_cast<char*>(embeddings) + row * embedding_row_bytes,
+                             embedding_size);
+    }
+  }
+}
+
+template<typename T, bool is_prefetch>
+user_op::InferTmpSizeFn GenCpuEmbeddingInferTmpSizeFn() {
+  return [](user_op::InferContext* ctx) {
+    const user_op::TensorDesc& unique_ids = ctx->InputTensorDesc("unique_ids", 0);
+    int64_t num_ids = unique_ids.shape().elem_cnt();
+    size_t num_missing_size = GetCudaAlignedSize(sizeof(uint32_t));
+    size_t missing_indices_size = GetCudaAlignedSize(num_ids * sizeof(uint32_t));
+    size_t value_buffer_size = 0;
+    if (is_prefetch) {
+      size_t value_byte_size = ctx->Attr<int64_t>("line_size") * sizeof(T);
+      value_buffer_size = GetCudaAlignedSize(num_ids * value_byte_size);
+    }
+    return num_missing_size + missing_indices_size + value_buffer_size;
+  };
+}
+
+class CpuIdShuffleCopyOutKernelState final : public user_op::OpKernelState {
+ public:
+  explicit CpuIdShuffleCopyOutKernelState(user_op::KernelInitContext* ctx) {
+    const std::string& embedding_name = ctx->Attr<std::string>("embedding_name");
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    embedding_state_ = Singleton<embedding::EmbeddingManager>::Get()->GetEmbeddingState(
+        embedding_name, parallel_id);
+  }
+  ~CpuIdShuffleCopyOutKernelState() override = default;
+
+  embedding::EmbeddingState* EmbeddingState() { return embedding_state_; }
+
+ private:
+  embedding::EmbeddingState* embedding_state_;
+};
+
+template<typename T>
+void CopyTensorPrefix(user_op::KernelComputeContext* ctx, const std::string& in_name,
+                      const std::string& out_name, int64_t elem_cnt) {
+  const T* in = ctx->Tensor4ArgNameAndIndex(in_name, 0)->dptr<T>();
+  T* out = ctx->Tensor4ArgNameAndIndex(out_name, 0)->mut_dptr<T>();
+  std::copy(in, in + elem_cnt, out);
+}
+
+}  // namespace
+
+template<typename T, typename K, typename U, typename IDX>
+class CpuEmbeddingPrefetchKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingPrefetchKernel() : current_iter_(0){};
+  ~CpuEmbeddingPrefetchKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    std::unique_ptr<embedding::TmpBufferAllocator> allocator =
+        embedding_state->NewTmpBufferAllocator(ctx);
+    uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    const user_op::Tensor* unique_ids = ctx->Tensor4ArgNameAndIndex("unique_ids", 0);
+    const user_op::Tensor* table_ids = ctx->Tensor4ArgNameAndIndex("table_ids", 0);
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t seed = ctx->Attr<int64_t>("seed");
+    void* num_missing_ptr;
+    allocator->Allocate(&num_missing_ptr, sizeof(uint32_t));
+    void* missing_indices_ptr;
+    allocator->Allocate(&missing_indices_ptr, num_unique * sizeof(uint32_t));
+    void* values_ptr;
+    allocator->Allocate(&values_ptr, num_unique * line_size * sizeof(T));
+    LookupAndInitMissing<T, K, U>(ctx->stream(), kernel_state, seed, num_unique, line_size, true,
+                                  unique_ids->dptr(), table_ids->dptr(),
+                                  reinterpret_cast<uint32_t*>(num_missing_ptr),
+                                  reinterpret_cast<uint32_t*>(missing_indices_ptr), values_ptr);
+    allocator->Free(num_missing_ptr);
+    allocator->Free(missing_indices_ptr);
+    allocator->Free(values_ptr);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define CPU_EMBEDDING_DATA_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(float, DataType::kFloat)
+
+#define CPU_ID_DATA_TYPE_SEQ                        \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_TABLE_ID_DATA_TYPE_SEQ                  \
+  OF_PP_MAKE_TUPLE_SEQ(uint8_t, DataType::kUInt8)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int8_t, DataType::kInt8)     \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define CPU_IDX_DATA_TYPE_SEQ                       \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_EMBEDDING_PREFETCH_KERNEL(t_dtype_pair, k_dtype_pair, table_dtype_pair,   \
+                                               idx_dtype_pair)                                 \
+  REGISTER_USER_KERNEL("embedding_prefetch")                                                   \
+      .SetCreateFn<CpuEmbeddingPrefetchKernel<                                                 \
+          OF_PP_PAIR_FIRST(t_dtype_pair), OF_PP_PAIR_FIRST(k_dtype_pair),                      \
+          OF_PP_PAIR_FIRST(table_dtype_pair), OF_PP_PAIR_FIRST(idx_dtype_pair)>>()             \
+      .SetIsMatchedHob(                                                                        \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                       \
+          && (user_op::HobDataType("unique_ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))        \
+          && (user_op::HobDataType("table_ids", 0) == OF_PP_PAIR_SECOND(table_dtype_pair))     \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn(GenCpuEmbeddingInferTmpSizeFn<OF_PP_PAIR_FIRST(t_dtype_pair), true>());
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_PREFETCH_KERNEL,
+                                 CPU_EMBEDDING_DATA_TYPE_SEQ, CPU_ID_DATA_TYPE_SEQ,
+                                 CPU_TABLE_ID_DATA_TYPE_SEQ, CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename K, typename U, typename IDX>
+class CpuEmbeddingLookupKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingLookupKernel() : current_iter_(0){};
+  ~CpuEmbeddingLookupKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    std::unique_ptr<embedding::TmpBufferAllocator> allocator =
+        embedding_state->NewTmpBufferAllocator(ctx);
+    embedding_state->OnEmbeddingLookupStart(ctx, current_iter_);
+    const user_op::Tensor* unique_ids = ctx->Tensor4ArgNameAndIndex("unique_ids", 0);
+    const user_op::Tensor* table_ids = ctx->Tensor4ArgNameAndIndex("table_ids", 0);
+    user_op::Tensor* unique_values = ctx->Tensor4ArgNameAndIndex("unique_values", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t seed = ctx->Attr<int64_t>("seed");
+    uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    void* values_ptr = embedding_state->LookupUniqueValues(current_iter_);
+    void* num_missing_ptr;
+    allocator->Allocate(&num_missing_ptr, sizeof(uint32_t));
+    void* missing_indices_ptr;
+    allocator->Allocate(&missing_indices_ptr, num_unique * sizeof(uint32_t));
+    LookupAndInitMissing<T, K, U>(ctx->stream(), kernel_state, seed, num_unique, line_size, false,
+                                  unique_ids->dptr(), table_ids->dptr(),
+                                  reinterpret_cast<uint32_t*>(num_missing_ptr),
+                                  reinterpret_cast<uint32_t*>(missing_indices_ptr), values_ptr);
+    allocator->Free(num_missing_ptr);
+    allocator->Free(missing_indices_ptr);
+    if (ctx->has_output("embeddings", 0)) {
+      void* embeddings_ptr = embedding_state->LookupEmbeddings(current_iter_);
+      user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+      CopyValuesToEmbeddings<T>(ctx->stream(), num_unique, embedding_size, line_size,
+                                unique_values->data_type(), embeddings->data_type(),
+                                reinterpret_cast<T*>(values_ptr), embeddings_ptr);
+    }
+    embedding_state->OnEmbeddingLookupEnd(ctx, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_EMBEDDING_LOOKUP_KERNEL(t_dtype_pair, k_dtype_pair, table_dtype_pair,     \
+                                             idx_dtype_pair)                                   \
+  REGISTER_USER_KERNEL("embedding_lookup")                                                     \
+      .SetCreateFn<CpuEmbeddingLookupKernel<                                                   \
+          OF_PP_PAIR_FIRST(t_dtype_pair), OF_PP_PAIR_FIRST(k_dtype_pair),                      \
+          OF_PP_PAIR_FIRST(table_dtype_pair), OF_PP_PAIR_FIRST(idx_dtype_pair)>>()             \
+      .SetIsMatchedHob(                                                                        \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                       \
+          && (user_op::HobDataType("unique_values", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))     \
+          && (user_op::HobDataType("unique_ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))        \
+          && (user_op::HobDataType("table_ids", 0) == OF_PP_PAIR_SECOND(table_dtype_pair))     \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn(GenCpuEmbeddingInferTmpSizeFn<OF_PP_PAIR_FIRST(t_dtype_pair), false>());
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_LOOKUP_KERNEL, CPU_EMBEDDING_DATA_TYPE_SEQ,
+                                 CPU_ID_DATA_TYPE_SEQ, CPU_TABLE_ID_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+class CpuEmbeddingPutKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingPutKernel() : current_iter_(0){};
+  ~CpuEmbeddingPutKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingPutKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingPutKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::KeyValueStore* store = kernel_state->KeyValueStore();
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    embedding_state->OnEmbeddingPutStart(ctx, current_iter_);
+    const user_op::Tensor* unique_ids = ctx->Tensor4ArgNameAndIndex("unique_ids", 0);
+    uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    store->Put(ctx->stream(), num_unique, unique_ids->dptr(),
+               embedding_state->EmbeddingPutUniqueEmbeddings(current_iter_));
+    embedding_state->OnEmbeddingPutEnd(ctx, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_EMBEDDING_PUT_KERNEL(dtype, typeproto)           \
+  REGISTER_USER_KERNEL("embedding_put")                               \
+      .SetCreateFn<CpuEmbeddingPutKernel>()                           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("num_unique_ids", 0) == typeproto));
+
+OF_PP_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_PUT_KERNEL, CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename K, typename U, typename IDX>
+class CpuIdShuffleCopyOutKernel final : public user_op::OpKernel {
+ public:
+  CpuIdShuffleCopyOutKernel() : current_iter_(0){};
+  ~CpuIdShuffleCopyOutKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuIdShuffleCopyOutKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuIdShuffleCopyOutKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    const uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    const std::vector<uint32_t>& num_unique_matrix_vec =
+        embedding_state->GetIdNumUniqueMatrix(current_iter_);
+    uint32_t cur_rank_num_ids = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      cur_rank_num_ids += num_unique_matrix_vec.at(i * parallel_num + parallel_id);
+    }
+    const int64_t num_ids =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0)->shape_view().elem_cnt();
+    CopyTensorPrefix<K>(ctx, "cur_rank_unique_ids", "out_cur_rank_unique_ids", num_unique);
+    CopyTensorPrefix<U>(ctx, "cur_rank_unique_table_ids", "out_cur_rank_unique_table_ids",
+                        num_unique);
+    CopyTensorPrefix<IDX>(ctx, "cur_rank_inverse_indices", "out_cur_rank_inverse_indices",
+                          cur_rank_num_ids);
+    CopyTensorPrefix<IDX>(ctx, "inverse_unique_partition_indices",
+                          "out_inverse_unique_partition_indices", num_ids);
+    CopyTensorPrefix<IDX>(ctx, "num_unique_matrix", "out_num_unique_matrix",
+                          parallel_num * parallel_num);
+    CopyTensorPrefix<IDX>(ctx, "cur_rank_num_unique", "out_cur_rank_num_unique", 1);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_ID_SHUFFLE_COPY_OUT_KERNEL(k_dtype_pair, table_id_dtype_pair,               \
+                                                idx_dtype_pair)                                  \
+  REGISTER_USER_KERNEL("id_shuffle_copy_out")                                                    \
+      .SetCreateFn<CpuIdShuffleCopyOutKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                     \
+                                             OF_PP_PAIR_FIRST(table_id_dtype_pair),              \
+                                             OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("cur_rank_unique_ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair)) \
+          && (user_op::HobDataType("cur_rank_unique_table_ids", 0)                               \
+              == OF_PP_PAIR_SECOND(table_id_dtype_pair))                                         \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ID_SHUFFLE_COPY_OUT_KERNEL, CPU_ID_DATA_TYPE_SEQ,
+                                 CPU_TABLE_ID_DATA_TYPE_SEQ, CPU_IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
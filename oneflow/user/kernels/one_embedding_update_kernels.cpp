@@ -0,0 +1,319 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/core/embedding/embedding_manager.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kRowGrainSize = 64;
+
+class CpuEmbeddingUpdateKernelState final : public user_op::OpKernelState {
+ public:
+  explicit CpuEmbeddingUpdateKernelState(user_op::KernelInitContext* ctx) {
+    const std::string& embedding_name = ctx->Attr<std::string>("embedding_name");
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    embedding_state_ = Singleton<embedding::EmbeddingManager>::Get()->GetEmbeddingState(
+        embedding_name, parallel_id);
+  }
+  ~CpuEmbeddingUpdateKernelState() override = default;
+
+  embedding::EmbeddingState* EmbeddingState() { return embedding_state_; }
+
+ private:
+  embedding::EmbeddingState* embedding_state_;
+};
+
+template<typename T>
+struct UpdateArgs {
+  T scale;
+  float l1;
+  float l2;
+  float weight_decay;
+  float learning_rate;
+  bool skip;
+};
+
+// The scalar inputs are on the host, so they are read once here instead of in every row.
+template<typename T>
+UpdateArgs<T> GetUpdateArgs(user_op::KernelComputeContext* ctx) {
+  UpdateArgs<T> args{};
+  args.scale = static_cast<T>(ctx->Attr<double>("scale"));
+  args.l1 = ctx->Attr<float>("l1");
+  args.l2 = ctx->Attr<float>("l2");
+  args.weight_decay = ctx->Attr<float>("weight_decay");
+  args.learning_rate = ctx->Attr<float>("learning_rate_val");
+  if (ctx->has_input("learning_rate", 0)) {
+    args.learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+  }
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+    CHECK_EQ(scale_by_tensor->shape_view().elem_cnt(), 1);
+    args.scale *= *scale_by_tensor->dptr<T>();
+  }
+  if (ctx->has_input("down_scale_by_tensor", 0)) {
+    const user_op::Tensor* down_scale_by_tensor =
+        ctx->Tensor4ArgNameAndIndex("down_scale_by_tensor", 0);
+    CHECK_EQ(down_scale_by_tensor->shape_view().elem_cnt(), 1);
+    args.scale /= *down_scale_by_tensor->dptr<T>();
+  }
+  args.skip = false;
+  if (ctx->has_input("skip_if", 0)) {
+    const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+    CHECK_EQ(skip_if->shape_view().elem_cnt(), 1);
+    args.skip = *skip_if->dptr<int64_t>() != 0;
+  }
+  return args;
+}
+
+int64_t GetTrainStep(user_op::KernelComputeContext* ctx) {
+  if (ctx->has_input("train_step", 0)) {
+    return *ctx->Tensor4ArgNameAndIndex("train_step", 0)->dptr<int64_t>() + 1;
+  }
+  return ctx->Attr<int64_t>("train_step_val");
+}
+
+// Copies every unique row to the updated values and then applies UpdateRow to it. The unique
+// rows are disjoint, so they are updated by the threads of the stream without any atomics.
+template<typename T, typename G, typename F>
+void UpdateUniqueRows(ep::Stream* stream, int64_t num_unique, int64_t line_size,
+                      int64_t embedding_size, bool skip, const G* model_diff,
+                      const T* unique_values, T* updated_unique_values, const F& UpdateRow) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_unique,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const T* row_values = unique_values + row * line_size;
+          T* updated_row_values = updated_unique_values + row * line_size;
+          std::copy(row_values, row_values + line_size, updated_row_values);
+          if (!skip) { UpdateRow(model_diff + row * embedding_size, updated_row_values); }
+        }
+      },
+      kRowGrainSize);
+}
+
+}  // namespace
+
+template<typename T, typename G, typename IDX>
+class CpuSgdEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuSgdEmbeddingUpdateKernel() : current_iter_(0){};
+  ~CpuSgdEmbeddingUpdateKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingUpdateKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingUpdateKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    embedding_state->OnEmbeddingUpdateStart(ctx, current_iter_);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(embedding_grad->shape_view().NumAxes(), 2);
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    CHECK_EQ(line_size, embedding_size);
+    const UpdateArgs<T> args = GetUpdateArgs<T>(ctx);
+    const T* unique_embeddings_ptr =
+        reinterpret_cast<const T*>(embedding_state->EmbeddingUpdateUniqueEmbeddings(current_iter_));
+    T* updated_unique_embeddings_ptr = reinterpret_cast<T*>(
+        embedding_state->EmbeddingUpdateUpdatedUniqueEmbeddings(current_iter_));
+    const uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    UpdateUniqueRows<T, G>(ctx->stream(), num_unique, line_size, embedding_size, args.skip,
+                           embedding_grad->dptr<G>(), unique_embeddings_ptr,
+                           updated_unique_embeddings_ptr, [&](const G* diff, T* model) {
+                             for (int64_t col = 0; col < embedding_size; ++col) {
+                               SGDUpdateFunctor<T, G>()(diff + col, model + col, args.scale,
+                                                        args.l1, args.l2, args.weight_decay,
+                                                        args.learning_rate);
+                             }
+                           });
+    embedding_state->OnEmbeddingUpdateEnd(ctx, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define CPU_IDX_DATA_TYPE_SEQ                       \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ONE_EMBEDDING_SGD_UPDATE_KERNEL(t_dtype_pair, g_type_pair, idx_dtype_pair) \
+  REGISTER_USER_KERNEL("one_embedding_sgd_update")                                              \
+      .SetCreateFn<CpuSgdEmbeddingUpdateKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                  \
+                                               OF_PP_PAIR_FIRST(g_type_pair),                   \
+                                               OF_PP_PAIR_FIRST(idx_dtype_pair)>>()             \
+      .SetIsMatchedHob(                                                                         \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                        \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))   \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(g_type_pair))      \
+          && (user_op::HobDataType("unique_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_SGD_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename G, typename IDX>
+class CpuAdamEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuAdamEmbeddingUpdateKernel() : current_iter_(0){};
+  ~CpuAdamEmbeddingUpdateKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingUpdateKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingUpdateKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    embedding_state->OnEmbeddingUpdateStart(ctx, current_iter_);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(embedding_grad->shape_view().NumAxes(), 2);
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    CHECK_EQ(line_size, embedding_size * 3);
+    const UpdateArgs<T> args = GetUpdateArgs<T>(ctx);
+    const auto beta1 = ctx->Attr<float>("beta1");
+    const auto beta2 = ctx->Attr<float>("beta2");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    float bias_correction1 = ctx->Attr<float>("bias_correction1_val");
+    if (ctx->has_input("bias_correction1", 0)) {
+      bias_correction1 = *ctx->Tensor4ArgNameAndIndex("bias_correction1", 0)->dptr<float>();
+    }
+    float bias_correction2 = ctx->Attr<float>("bias_correction2_val");
+    if (ctx->has_input("bias_correction2", 0)) {
+      bias_correction2 = *ctx->Tensor4ArgNameAndIndex("bias_correction2", 0)->dptr<float>();
+    }
+    const T* unique_embeddings_ptr =
+        reinterpret_cast<const T*>(embedding_state->EmbeddingUpdateUniqueEmbeddings(current_iter_));
+    T* updated_unique_embeddings_ptr = reinterpret_cast<T*>(
+        embedding_state->EmbeddingUpdateUpdatedUniqueEmbeddings(current_iter_));
+    const uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    UpdateUniqueRows<T, G>(
+        ctx->stream(), num_unique, line_size, embedding_size, args.skip, embedding_grad->dptr<G>(),
+        unique_embeddings_ptr, updated_unique_embeddings_ptr, [&](const G* diff, T* model) {
+          T* m = model + embedding_size;
+          T* v = model + 2 * embedding_size;
+          for (int64_t col = 0; col < embedding_size; ++col) {
+            AdamUpdateFunctor<T, G>()(diff + col, model + col, m + col, v + col, nullptr,
+                                      args.scale, args.l1, args.l2, beta1, beta2, epsilon,
+                                      args.weight_decay, false, bias_correction1, bias_correction2,
+                                      args.learning_rate);
+          }
+        });
+    embedding_state->OnEmbeddingUpdateEnd(ctx, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_ADAM_UPDATE_KERNEL(t_dtype_pair, g_type_pair, idx_dtype_pair) \
+  REGISTER_USER_KERNEL("one_embedding_adam_update")                                              \
+      .SetCreateFn<CpuAdamEmbeddingUpdateKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                  \
+                                                OF_PP_PAIR_FIRST(g_type_pair),                   \
+                                                OF_PP_PAIR_FIRST(idx_dtype_pair)>>()             \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))    \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(g_type_pair))       \
+          && (user_op::HobDataType("unique_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_ADAM_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename G, typename IDX>
+class CpuAdagradEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuAdagradEmbeddingUpdateKernel() : current_iter_(0){};
+  ~CpuAdagradEmbeddingUpdateKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<CpuEmbeddingUpdateKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<CpuEmbeddingUpdateKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::EmbeddingState* embedding_state = kernel_state->EmbeddingState();
+    embedding_state->OnEmbeddingUpdateStart(ctx, current_iter_);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(embedding_grad->shape_view().NumAxes(), 2);
+    const int64_t line_size = ctx->Attr<int64_t>("line_size");
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    CHECK_EQ(line_size, embedding_size * 2);
+    const UpdateArgs<T> args = GetUpdateArgs<T>(ctx);
+    const auto lr_decay = ctx->Attr<float>("lr_decay");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const int64_t train_step = GetTrainStep(ctx);
+    const float learning_rate = args.learning_rate / (1 + (train_step - 1) * lr_decay);
+    const T* unique_embeddings_ptr =
+        reinterpret_cast<const T*>(embedding_state->EmbeddingUpdateUniqueEmbeddings(current_iter_));
+    T* updated_unique_embeddings_ptr = reinterpret_cast<T*>(
+        embedding_state->EmbeddingUpdateUpdatedUniqueEmbeddings(current_iter_));
+    const uint32_t num_unique = embedding_state->GetIdNumUnique(current_iter_);
+    UpdateUniqueRows<T, G>(
+        ctx->stream(), num_unique, line_size, embedding_size, args.skip, embedding_grad->dptr<G>(),
+        unique_embeddings_ptr, updated_unique_embeddings_ptr, [&](const G* diff, T* model) {
+          T* sum = model + embedding_size;
+          for (int64_t col = 0; col < embedding_size; ++col) {
+            AdagradUpdateFunctor<T, G>()(diff + col, model + col, sum + col, args.scale, args.l1,
+                                         args.l2, epsilon, args.weight_decay, learning_rate);
+          }
+        });
+    embedding_state->OnEmbeddingUpdateEnd(ctx, current_iter_);
+    current_iter_++;
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  mutable int64_t current_iter_;
+};
+
+#define REGISTER_CPU_ONE_EMBEDDING_ADAGRAD_UPDATE_KERNEL(t_dtype_pair, g_type_pair,           \
+                                                         idx_dtype_pair)                      \
+  REGISTER_USER_KERNEL("one_embedding_adagrad_update")                                        \
+      .SetCreateFn<CpuAdagradEmbeddingUpdateKernel<OF_PP_PAIR_FIRST(t_dtype_pair),            \
+                                                   OF_PP_PAIR_FIRST(g_type_pair),             \
+                                                   OF_PP_PAIR_FIRST(idx_dtype_pair)>>()       \
+      .SetIsMatchedHob(                                                                       \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                      \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)) \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(g_type_pair))    \
+          && (user_op::HobDataType("unique_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_ADAGRAD_UPDATE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, FLOATING_DATA_TYPE_SEQ,
+                                 CPU_IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
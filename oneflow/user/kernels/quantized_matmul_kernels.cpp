@@ -0,0 +1,364 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/common/onednn.h"
+#include "oneflow/core/framework/variable_tensor_mgr.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr float kInt8MaxValue = 127.0f;
+
+int8_t QuantizeValue(float value, float inv_scale) {
+  const float quantized = std::nearbyint(value * inv_scale);
+  return static_cast<int8_t>(std::min(std::max(quantized, -kInt8MaxValue), kInt8MaxValue));
+}
+
+float GetQuantizationScale(const user_op::Tensor* scale) {
+  const float value = *scale->dptr<float>();
+  CHECK_GT(value, 0) << "The quantization scale is not positive, the ranges of the activations "
+                        "should be observed by running the graph in calibration mode first";
+  return value;
+}
+
+void QuantizeTensor(ep::CpuStream* stream, const float* in, int64_t elem_cnt, float scale,
+                    int8_t* out) {
+  const float inv_scale = 1.0f / scale;
+  stream->ParallelFor(0, elem_cnt, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) { out[i] = QuantizeValue(in[i], inv_scale); }
+  });
+}
+
+// The weight of [channels, k] quantized symmetrically per channel. The weights are constant in
+// inference, so they are quantized at the first run and only again once the variables are
+// updated out of the graph, e.g. by load_state_dict.
+class QuantizedWeightState final : public user_op::OpKernelState {
+ public:
+  QuantizedWeightState() : generation_(-1) {}
+  ~QuantizedWeightState() override = default;
+
+  const int8_t* Get(ep::CpuStream* stream, const float* weight, int64_t channels, int64_t k) {
+    const int64_t generation = VariableGeneration();
+    if (generation == generation_) { return weight_.data(); }
+    weight_.resize(channels * k);
+    scales_.resize(channels);
+    stream->ParallelFor(0, channels, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; ++c) {
+        const float* row = weight + c * k;
+        float max_abs = 0;
+        for (int64_t i = 0; i < k; ++i) { max_abs = std::max(max_abs, std::abs(row[i])); }
+        scales_[c] = max_abs > 0 ? max_abs / kInt8MaxValue : 1.0f;
+        const float inv_scale = 1.0f / scales_[c];
+        for (int64_t i = 0; i < k; ++i) { weight_[c * k + i] = QuantizeValue(row[i], inv_scale); }
+      }
+    });
+    generation_ = generation;
+    return weight_.data();
+  }
+  const float* scales() const { return scales_.data(); }
+
+ private:
+  int64_t generation_;
+  std::vector<int8_t> weight_;
+  std::vector<float> scales_;
+};
+
+// c[m, n] = a[m, k] * b[n, k]^T in int32
+void Int8Gemm(ep::CpuStream* stream, int64_t m, int64_t n, int64_t k, const int8_t* a,
+              const int8_t* b, int32_t* c) {
+#ifdef WITH_ONEDNN
+  if (ep::primitive::OneDnnIsEnabled()) {
+    stream->onednn_executor()->Launch([&](dnnl::engine* onednn_engine,
+                                          dnnl::stream* onednn_stream) {
+      using dims = dnnl::memory::dims;
+      using data_type = dnnl::memory::data_type;
+      using format_tag = dnnl::memory::format_tag;
+      const auto a_md = dnnl::memory::desc(dims{m, k}, data_type::s8, format_tag::ab);
+      const auto b_md = dnnl::memory::desc(dims{k, n}, data_type::s8, format_tag::ba);
+      const auto c_md = dnnl::memory::desc(dims{m, n}, data_type::s32, format_tag::ab);
+      auto a_mem = dnnl::memory(a_md, *onednn_engine, const_cast<int8_t*>(a));
+      auto b_mem = dnnl::memory(b_md, *onednn_engine, const_cast<int8_t*>(b));
+      auto c_mem = dnnl::memory(c_md, *onednn_engine, c);
+      const auto matmul_d = dnnl::matmul::desc(a_md, b_md, c_md);
+      const auto matmul_pd = dnnl::matmul::primitive_desc(matmul_d, *onednn_engine);
+      dnnl::matmul(matmul_pd).execute(*onednn_stream, {{DNNL_ARG_SRC, a_mem},
+                                                       {DNNL_ARG_WEIGHTS, b_mem},
+                                                       {DNNL_ARG_DST, c_mem}});
+    });
+    return;
+  }
+#endif  // WITH_ONEDNN
+  const size_t grain = std::max<int64_t>(1, 32768 / std::max<int64_t>(1, n * k));
+  stream->ParallelFor(
+      0, m,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int8_t* a_row = a + i * k;
+          for (int64_t j = 0; j < n; ++j) {
+            const int8_t* b_row = b + j * k;
+            int32_t sum = 0;
+            for (int64_t l = 0; l < k; ++l) {
+              sum += static_cast<int32_t>(a_row[l]) * static_cast<int32_t>(b_row[l]);
+            }
+            c[i * n + j] = sum;
+          }
+        }
+      },
+      grain);
+}
+
+void StoreValue(float value, float /*inv_out_scale*/, float* out) { *out = value; }
+
+void StoreValue(float value, float inv_out_scale, int8_t* out) {
+  *out = QuantizeValue(value, inv_out_scale);
+}
+
+// Dequantizes the accumulators, adds the bias, applies the activation and stores the result,
+// requantized with out_scale if the output is int8
+struct EpilogueParams {
+  int64_t rows;
+  int64_t cols;
+  bool channels_in_rows;
+  float in_scale;
+  const float* weight_scales;
+  const float* bias;
+  bool relu;
+  float out_scale;
+};
+
+template<typename T>
+void Epilogue(ep::CpuStream* stream, const EpilogueParams& params, const int32_t* acc, T* out) {
+  const float inv_out_scale = 1.0f / params.out_scale;
+  stream->ParallelFor(0, params.rows, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      for (int64_t j = 0; j < params.cols; ++j) {
+        const int64_t channel = params.channels_in_rows ? i : j;
+        float value = static_cast<float>(acc[i * params.cols + j]) * params.in_scale
+                      * params.weight_scales[channel];
+        if (params.bias != nullptr) { value += params.bias[channel]; }
+        if (params.relu) { value = std::max(value, 0.0f); }
+        StoreValue(value, inv_out_scale, out + i * params.cols + j);
+      }
+    }
+  });
+}
+
+void Epilogue(ep::CpuStream* stream, const EpilogueParams& params, const int32_t* acc,
+              user_op::Tensor* out, int64_t out_offset) {
+  if (out->data_type() == DataType::kInt8) {
+    Epilogue<int8_t>(stream, params, acc, out->mut_dptr<int8_t>() + out_offset);
+  } else {
+    Epilogue<float>(stream, params, acc, out->mut_dptr<float>() + out_offset);
+  }
+}
+
+// The activation as int8, quantized into the tmp buffer if it is float
+const int8_t* GetQuantizedInput(ep::CpuStream* stream, const user_op::Tensor* in, float scale,
+                                int8_t* buffer) {
+  if (in->data_type() == DataType::kInt8) { return in->dptr<int8_t>(); }
+  QuantizeTensor(stream, in->dptr<float>(), in->shape_view().elem_cnt(), scale, buffer);
+  return buffer;
+}
+
+float GetOutScale(user_op::KernelComputeContext* ctx) {
+  if (!ctx->has_input("out_scale", 0)) { return 1.0f; }
+  return GetQuantizationScale(ctx->Tensor4ArgNameAndIndex("out_scale", 0));
+}
+
+const float* GetBias(user_op::KernelComputeContext* ctx) {
+  if (!ctx->has_input("bias", 0)) { return nullptr; }
+  return ctx->Tensor4ArgNameAndIndex("bias", 0)->dptr<float>();
+}
+
+class QuantizedMatmulKernel final : public user_op::OpKernel {
+ public:
+  QuantizedMatmulKernel() = default;
+  ~QuantizedMatmulKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<QuantizedWeightState>();
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const user_op::Tensor* b = ctx->Tensor4ArgNameAndIndex("b", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    auto* weight_state = dynamic_cast<QuantizedWeightState*>(state);
+    CHECK_NOTNULL(weight_state);
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+    const int64_t k = b->shape_view().At(1);
+    const int64_t n = b->shape_view().At(0);
+    const int64_t m = a->shape_view().elem_cnt() / k;
+    if (m == 0) { return; }
+    const float a_scale = GetQuantizationScale(ctx->Tensor4ArgNameAndIndex("a_scale", 0));
+    const int8_t* weight = weight_state->Get(stream, b->dptr<float>(), n, k);
+    int8_t* quantized_a = tmp_buffer->mut_dptr<int8_t>();
+    int32_t* acc = reinterpret_cast<int32_t*>(tmp_buffer->mut_dptr<char>()
+                                              + GetCudaAlignedSize(m * k * sizeof(int8_t)));
+    Int8Gemm(stream, m, n, k, GetQuantizedInput(stream, a, a_scale, quantized_a), weight, acc);
+    EpilogueParams params{};
+    params.rows = m;
+    params.cols = n;
+    params.channels_in_rows = false;
+    params.in_scale = a_scale;
+    params.weight_scales = weight_state->scales();
+    params.bias = GetBias(ctx);
+    params.relu = ctx->Attr<std::string>("activation") == "relu";
+    params.out_scale = GetOutScale(ctx);
+    Epilogue(stream, params, acc, out, 0);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("quantized_matmul")
+    .SetCreateFn<QuantizedMatmulKernel>()
+    .SetIsMatchedHob(user_op::HobDeviceType() == DeviceType::kCPU)
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {
+      const int64_t k = ctx->InputShape("b", 0).At(1);
+      const int64_t n = ctx->InputShape("b", 0).At(0);
+      const int64_t m = ctx->InputShape("a", 0).elem_cnt() / k;
+      return GetCudaAlignedSize(m * k * sizeof(int8_t))
+             + GetCudaAlignedSize(m * n * sizeof(int32_t));
+    });
+
+struct QuantizedConv2DShape {
+  explicit QuantizedConv2DShape(const Shape& in_shape, const Shape& weight_shape,
+                                const Shape& out_shape)
+      : batch(in_shape.At(0)),
+        channels(in_shape.At(1)),
+        height(in_shape.At(2)),
+        width(in_shape.At(3)),
+        filters(weight_shape.At(0)),
+        kernel_height(weight_shape.At(2)),
+        kernel_width(weight_shape.At(3)),
+        out_height(out_shape.At(2)),
+        out_width(out_shape.At(3)) {}
+
+  int64_t in_size() const { return channels * height * width; }
+  int64_t patch_size() const { return channels * kernel_height * kernel_width; }
+  int64_t out_size() const { return out_height * out_width; }
+
+  int64_t batch;
+  int64_t channels;
+  int64_t height;
+  int64_t width;
+  int64_t filters;
+  int64_t kernel_height;
+  int64_t kernel_width;
+  int64_t out_height;
+  int64_t out_width;
+};
+
+// Gathers the patch of every output position of an image into a row of [out_size, patch_size]
+void Im2Row(ep::CpuStream* stream, const QuantizedConv2DShape& shape,
+            const std::vector<int32_t>& padding_before, const std::vector<int32_t>& strides,
+            const std::vector<int32_t>& dilation_rate, const int8_t* in, int8_t* rows) {
+  stream->ParallelFor(0, shape.out_size(), [&](int64_t begin, int64_t end) {
+    for (int64_t r = begin; r < end; ++r) {
+      const int64_t oh = r / shape.out_width;
+      const int64_t ow = r % shape.out_width;
+      int8_t* row = rows + r * shape.patch_size();
+      for (int64_t c = 0; c < shape.channels; ++c) {
+        for (int64_t kh = 0; kh < shape.kernel_height; ++kh) {
+          const int64_t ih = oh * strides.at(0) - padding_before.at(0) + kh * dilation_rate.at(0);
+          for (int64_t kw = 0; kw < shape.kernel_width; ++kw) {
+            const int64_t iw = ow * strides.at(1) - padding_before.at(1) + kw * dilation_rate.at(1);
+            const bool inside = ih >= 0 && ih < shape.height && iw >= 0 && iw < shape.width;
+            *row++ = inside ? in[(c * shape.height + ih) * shape.width + iw] : 0;
+          }
+        }
+      }
+    }
+  });
+}
+
+class QuantizedConv2DKernel final : public user_op::OpKernel {
+ public:
+  QuantizedConv2DKernel() = default;
+  ~QuantizedConv2DKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<QuantizedWeightState>();
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    auto* weight_state = dynamic_cast<QuantizedWeightState*>(state);
+    CHECK_NOTNULL(weight_state);
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+    const QuantizedConv2DShape shape(Shape(in->shape_view()), Shape(weight->shape_view()),
+                                     Shape(out->shape_view()));
+    if (shape.batch == 0 || shape.out_size() == 0) { return; }
+    const float in_scale = GetQuantizationScale(ctx->Tensor4ArgNameAndIndex("in_scale", 0));
+    const int8_t* quantized_weight =
+        weight_state->Get(stream, weight->dptr<float>(), shape.filters, shape.patch_size());
+    char* buffer = tmp_buffer->mut_dptr<char>();
+    int8_t* quantized_in = reinterpret_cast<int8_t*>(buffer);
+    buffer += GetCudaAlignedSize(shape.batch * shape.in_size() * sizeof(int8_t));
+    int8_t* rows = reinterpret_cast<int8_t*>(buffer);
+    buffer += GetCudaAlignedSize(shape.out_size() * shape.patch_size() * sizeof(int8_t));
+    int32_t* acc = reinterpret_cast<int32_t*>(buffer);
+    const int8_t* in_ptr = GetQuantizedInput(stream, in, in_scale, quantized_in);
+    EpilogueParams params{};
+    params.rows = shape.filters;
+    params.cols = shape.out_size();
+    params.channels_in_rows = true;
+    params.in_scale = in_scale;
+    params.weight_scales = weight_state->scales();
+    params.bias = GetBias(ctx);
+    params.relu = ctx->Attr<std::string>("activation") == "relu";
+    params.out_scale = GetOutScale(ctx);
+    for (int64_t i = 0; i < shape.batch; ++i) {
+      Im2Row(stream, shape, ctx->Attr<std::vector<int32_t>>("padding_before"),
+             ctx->Attr<std::vector<int32_t>>("strides"),
+             ctx->Attr<std::vector<int32_t>>("dilation_rate"), in_ptr + i * shape.in_size(), rows);
+      // [filters, patch_size] x [out_size, patch_size]^T, which is the NCHW layout of the image
+      Int8Gemm(stream, shape.filters, shape.out_size(), shape.patch_size(), quantized_weight, rows,
+               acc);
+      Epilogue(stream, params, acc, out, i * shape.filters * shape.out_size());
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("quantized_conv2d")
+    .SetCreateFn<QuantizedConv2DKernel>()
+    .SetIsMatchedHob(user_op::HobDeviceType() == DeviceType::kCPU)
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {
+      const QuantizedConv2DShape shape(ctx->InputShape("in", 0), ctx->InputShape("weight", 0),
+                                       ctx->OutputShape("out", 0));
+      return GetCudaAlignedSize(shape.batch * shape.in_size() * sizeof(int8_t))
+             + GetCudaAlignedSize(shape.out_size() * shape.patch_size() * sizeof(int8_t))
+             + GetCudaAlignedSize(shape.filters * shape.out_size() * sizeof(int32_t));
+    });
+
+}  // namespace
+
+}  // namespace oneflow
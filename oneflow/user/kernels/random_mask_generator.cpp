@@ -14,12 +14,19 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/random_mask_generator.h"
+#include "oneflow/user/kernels/cpu_philox_util.h"
 
 namespace oneflow {
 
 void RandomMaskGenerator<DeviceType::kCPU>::Generate(ep::Stream* stream, const int64_t n,
                                                      const float rate, bool* mask) {
   CHECK_GE(n, 0);
+  if (generator_->use_philox()) {
+    PhiloxParallelForEach(stream, generator_.get(), n, 1, [&](int64_t i, const uint32_t* numbers) {
+      mask[i] = PhiloxUniformFloat(numbers[0]) > rate;
+    });
+    return;
+  }
   std::uniform_real_distribution<float> random_distribution(GetZeroVal<float>(),
                                                             GetOneVal<float>());
   for (int64_t i = 0; i < n; ++i) { mask[i] = random_distribution(generator_->engine()) > rate; }
@@ -14,9 +14,227 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/unique_kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
+namespace {
+
+// Every shard of the parallel unique handles at least this many elements
+constexpr int64_t kMinElementsPerShard = 1 << 15;
+constexpr int64_t kHashBatchSize = 1024;
+
+template<typename KEY>
+typename std::enable_if<std::is_integral<KEY>::value, uint64_t>::type KeyBits(KEY key) {
+  return static_cast<uint64_t>(key);
+}
+
+// Equal keys must get equal hashes, so -0.0 is hashed as 0.0
+template<typename KEY>
+typename std::enable_if<std::is_floating_point<KEY>::value, uint64_t>::type KeyBits(KEY key) {
+  using Bits = typename std::conditional<sizeof(KEY) == 4, uint32_t, uint64_t>::type;
+  Bits bits = 0;
+  std::memcpy(&bits, &key, sizeof(KEY));
+  return key == 0 ? 0 : bits;
+}
+
+inline uint64_t MixHash(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Branch free over a batch of keys so that it can be vectorized
+template<typename KEY>
+void HashKeys(const KEY* keys, int64_t n, uint64_t* hashes) {
+  for (int64_t i = 0; i < n; ++i) { hashes[i] = MixHash(KeyBits(keys[i])); }
+}
+
+// The high bits of the hash pick the shard, the low bits the slot in the table of the shard
+inline int64_t ShardOf(uint64_t hash, int64_t num_shards) {
+  return static_cast<int64_t>(((hash >> 32) * static_cast<uint64_t>(num_shards)) >> 32);
+}
+
+template<typename KEY, typename IDX>
+void SerialUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                            IDX* idx_out, IDX* count, bool sorted) {
+  std::vector<int64_t> sorted_idx(n);
+  std::iota(sorted_idx.begin(), sorted_idx.end(), 0);
+  if (sorted) {
+    std::sort(sorted_idx.begin(), sorted_idx.end(),
+              [&in](size_t a, size_t b) { return in[a] < in[b]; });
+  }
+
+  HashMap<KEY, IDX> map;
+  for (int64_t i : sorted_idx) {
+    KEY in_i = in[i];
+    auto it = map.find(in_i);
+    if (it == map.end()) {
+      IDX idx = map.size();
+      if (count != nullptr) { count[idx] = 1; }
+      idx_out[i] = idx;
+      unique_out[idx] = in_i;
+      map[in_i] = idx;
+    } else {
+      IDX idx = it->second;
+      if (count != nullptr) { count[idx] += 1; }
+      idx_out[i] = idx;
+    }
+  }
+  *num_unique = map.size();
+}
+
+// The elements are hash partitioned into shards, every shard is deduplicated by its own thread
+// with an open addressing table, then the local uniques are ranked globally either by their
+// first occurrence or by their value, which is what the serial version gives.
+template<typename KEY, typename IDX>
+void ParallelUniqueWithCounts(ep::CpuStream* stream, int64_t num_shards, int64_t n,
+                              const KEY* in, IDX* num_unique, KEY* unique_out, IDX* idx_out,
+                              IDX* count, bool sorted) {
+  const BalancedSplitter chunks(n, num_shards);
+  auto ForEachShard = [&](const std::function<void(int64_t)>& fn) {
+    stream->ParallelFor(
+        0, num_shards,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t s = begin; s < end; ++s) { fn(s); }
+        },
+        1);
+  };
+
+  // Count the elements of every chunk going to every shard
+  std::vector<uint64_t> hashes(n);
+  std::vector<int64_t> chunk_shard_offsets(num_shards * num_shards, 0);
+  ForEachShard([&](int64_t c) {
+    int64_t* shard_counts = chunk_shard_offsets.data() + c * num_shards;
+    const Range range = chunks.At(c);
+    for (int64_t i = range.begin(); i < range.end(); i += kHashBatchSize) {
+      const int64_t batch_size = std::min(kHashBatchSize, range.end() - i);
+      HashKeys(in + i, batch_size, hashes.data() + i);
+      for (int64_t j = i; j < i + batch_size; ++j) {
+        shard_counts[ShardOf(hashes[j], num_shards)] += 1;
+      }
+    }
+  });
+  // Bucket the elements by shard, keeping them in input order inside of every shard
+  std::vector<int64_t> shard_offsets(num_shards + 1, 0);
+  for (int64_t s = 0; s < num_shards; ++s) {
+    int64_t offset = shard_offsets[s];
+    for (int64_t c = 0; c < num_shards; ++c) {
+      const int64_t chunk_count = chunk_shard_offsets[c * num_shards + s];
+      chunk_shard_offsets[c * num_shards + s] = offset;
+      offset += chunk_count;
+    }
+    shard_offsets[s + 1] = offset;
+  }
+  std::vector<int64_t> order(n);
+  ForEachShard([&](int64_t c) {
+    int64_t* cursors = chunk_shard_offsets.data() + c * num_shards;
+    const Range range = chunks.At(c);
+    for (int64_t i = range.begin(); i < range.end(); ++i) {
+      order[cursors[ShardOf(hashes[i], num_shards)]++] = i;
+    }
+  });
+
+  // Deduplicate every shard, the local uniques come in order of their first occurrence
+  std::vector<std::vector<KEY>> local_keys(num_shards);
+  std::vector<std::vector<int64_t>> local_firsts(num_shards);
+  std::vector<std::vector<IDX>> local_counts(num_shards);
+  std::vector<IDX> local_idx(n);
+  ForEachShard([&](int64_t s) {
+    const int64_t shard_size = shard_offsets[s + 1] - shard_offsets[s];
+    int64_t capacity = 1;
+    while (capacity < 2 * shard_size) { capacity *= 2; }
+    const uint64_t mask = capacity - 1;
+    std::vector<IDX> table(capacity, -1);
+    auto& keys = local_keys[s];
+    auto& firsts = local_firsts[s];
+    auto& counts = local_counts[s];
+    for (int64_t p = shard_offsets[s]; p < shard_offsets[s + 1]; ++p) {
+      const int64_t i = order[p];
+      const KEY key = in[i];
+      uint64_t slot = hashes[i] & mask;
+      while (table[slot] != -1 && !(keys[table[slot]] == key)) { slot = (slot + 1) & mask; }
+      if (table[slot] == -1) {
+        table[slot] = keys.size();
+        keys.push_back(key);
+        firsts.push_back(i);
+        counts.push_back(0);
+      }
+      local_idx[p] = table[slot];
+      counts[table[slot]] += 1;
+    }
+  });
+
+  std::vector<int64_t> unique_offsets(num_shards + 1, 0);
+  for (int64_t s = 0; s < num_shards; ++s) {
+    unique_offsets[s + 1] = unique_offsets[s] + local_keys[s].size();
+  }
+  const int64_t total_unique = unique_offsets[num_shards];
+  std::vector<IDX> global_ids(total_unique);
+  if (sorted) {
+    // The rank of a key is the number of smaller keys over all of the shards
+    std::vector<std::vector<KEY>> sorted_keys(num_shards);
+    ForEachShard([&](int64_t s) {
+      sorted_keys[s] = local_keys[s];
+      std::sort(sorted_keys[s].begin(), sorted_keys[s].end());
+    });
+    ForEachShard([&](int64_t s) {
+      const int64_t num_local_unique = local_keys[s].size();
+      for (int64_t u = 0; u < num_local_unique; ++u) {
+        const KEY key = local_keys[s][u];
+        int64_t rank = 0;
+        for (const auto& keys : sorted_keys) {
+          rank += std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+        }
+        global_ids[unique_offsets[s] + u] = rank;
+      }
+    });
+  } else {
+    // The rank of a key is the number of first occurrences before its own
+    std::vector<int64_t> first_slots(n, -1);
+    ForEachShard([&](int64_t s) {
+      const int64_t num_local_unique = local_firsts[s].size();
+      for (int64_t u = 0; u < num_local_unique; ++u) {
+        first_slots[local_firsts[s][u]] = unique_offsets[s] + u;
+      }
+    });
+    std::vector<int64_t> chunk_ranks(num_shards + 1, 0);
+    ForEachShard([&](int64_t c) {
+      const Range range = chunks.At(c);
+      for (int64_t i = range.begin(); i < range.end(); ++i) {
+        if (first_slots[i] != -1) { chunk_ranks[c + 1] += 1; }
+      }
+    });
+    for (int64_t c = 0; c < num_shards; ++c) { chunk_ranks[c + 1] += chunk_ranks[c]; }
+    ForEachShard([&](int64_t c) {
+      int64_t rank = chunk_ranks[c];
+      const Range range = chunks.At(c);
+      for (int64_t i = range.begin(); i < range.end(); ++i) {
+        if (first_slots[i] != -1) { global_ids[first_slots[i]] = rank++; }
+      }
+    });
+  }
+
+  ForEachShard([&](int64_t s) {
+    const IDX* shard_global_ids = global_ids.data() + unique_offsets[s];
+    const int64_t num_local_unique = local_keys[s].size();
+    for (int64_t u = 0; u < num_local_unique; ++u) {
+      unique_out[shard_global_ids[u]] = local_keys[s][u];
+      if (count != nullptr) { count[shard_global_ids[u]] = local_counts[s][u]; }
+    }
+    for (int64_t p = shard_offsets[s]; p < shard_offsets[s + 1]; ++p) {
+      idx_out[order[p]] = shard_global_ids[local_idx[p]];
+    }
+  });
+  *num_unique = total_unique;
+}
+
+}  // namespace
+
 template<typename KEY, typename IDX>
 struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void Unique(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
@@ -28,30 +246,15 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes, bool sorted) {
-    std::vector<int64_t> sorted_idx(n);
-    std::iota(sorted_idx.begin(), sorted_idx.end(), 0);
-    if (sorted) {
-      std::sort(sorted_idx.begin(), sorted_idx.end(),
-                [&in](size_t a, size_t b) { return in[a] < in[b]; });
-    }
-
-    HashMap<KEY, IDX> map;
-    for (int64_t i : sorted_idx) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
+    auto* cpu_stream = stream->As<ep::CpuStream>();
+    const int64_t num_shards =
+        std::min<int64_t>(cpu_stream->num_threads(), n / kMinElementsPerShard);
+    if (num_shards <= 1) {
+      SerialUniqueWithCounts(n, in, num_unique, unique_out, idx_out, count, sorted);
+    } else {
+      ParallelUniqueWithCounts(cpu_stream, num_shards, n, in, num_unique, unique_out, idx_out,
+                               count, sorted);
     }
-    *num_unique = map.size();
   }
 
   static void GetUniqueWorkspaceSizeInBytes(ep::Stream* stream, int64_t n,
@@ -0,0 +1,105 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+#include "oneflow/user/ops/nn_util.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<void> CheckQuantizationScale(user_op::InferContext* ctx, const std::string& arg_name) {
+  CHECK_EQ_OR_RETURN(ctx->InputShape(arg_name, 0).elem_cnt(), 1)
+      << "The " << arg_name << " of quantized_conv2d should be a per-tensor scale";
+  CHECK_EQ_OR_RETURN(ctx->InputDType(arg_name, 0), DataType::kFloat)
+      << "The " << arg_name << " of quantized_conv2d should be float";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/*static*/ Maybe<void> QuantizedConv2DOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  // Only channels_first convolutions of one group are quantized
+  const Shape& in_shape = ctx->InputShape("in", 0);
+  const Shape& weight_shape = ctx->InputShape("weight", 0);
+  CHECK_EQ_OR_RETURN(in_shape.NumAxes(), 4);
+  CHECK_EQ_OR_RETURN(weight_shape.NumAxes(), 4);
+  CHECK_EQ_OR_RETURN(weight_shape.At(1), in_shape.At(1));
+  const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+  const auto& strides = ctx->Attr<std::vector<int32_t>>("strides");
+  const auto& dilation_rate = ctx->Attr<std::vector<int32_t>>("dilation_rate");
+  CHECK_EQ_OR_RETURN(padding_before.size(), 2);
+  CHECK_EQ_OR_RETURN(strides.size(), 2);
+  CHECK_EQ_OR_RETURN(dilation_rate.size(), 2);
+  const int64_t filters = weight_shape.At(0);
+  if (ctx->has_input("bias", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("bias", 0), Shape({filters}));
+  }
+  DimVector out_shape{in_shape.At(0), filters, 0, 0};
+  for (int32_t i = 0; i < 2; ++i) {
+    JUST(CalcConvOut(in_shape.At(2 + i), weight_shape.At(2 + i), dilation_rate.at(i), strides.at(i),
+                     padding_before.at(i), &out_shape.at(2 + i)));
+  }
+  ctx->SetOutputShape("out", 0, Shape(out_shape));
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedConv2DOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> QuantizedConv2DOp::GetSbp(user_op::SbpContext* ctx) {
+  std::vector<user_op::OpArg> broadcast_args{user_op::OpArg("weight", 0),
+                                             user_op::OpArg("in_scale", 0)};
+  if (ctx->user_op_conf().has_input("bias", 0)) { broadcast_args.emplace_back("bias", 0); }
+  if (ctx->user_op_conf().has_input("out_scale", 0)) {
+    broadcast_args.emplace_back("out_scale", 0);
+  }
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("in", 0), 0)
+      .Broadcast(broadcast_args)
+      .Split(user_op::OpArg("out", 0), 0)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedConv2DOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType in_dtype = ctx->InputDType("in", 0);
+  CHECK_OR_RETURN(in_dtype == DataType::kFloat || in_dtype == DataType::kInt8)
+      << "The input of quantized_conv2d should be float or int8 quantized with in_scale";
+  CHECK_EQ_OR_RETURN(ctx->InputDType("weight", 0), DataType::kFloat);
+  JUST(CheckQuantizationScale(ctx, "in_scale"));
+  if (ctx->has_input("bias", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("bias", 0), DataType::kFloat);
+  }
+  if (ctx->has_input("out_scale", 0)) {
+    JUST(CheckQuantizationScale(ctx, "out_scale"));
+    ctx->SetOutputDType("out", 0, DataType::kInt8);
+  } else {
+    ctx->SetOutputDType("out", 0, DataType::kFloat);
+  }
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedConv2DOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                    const user_op::UserOpConfWrapper& op_conf) {
+  const std::string& activation = op_conf.attr<std::string>("activation");
+  CHECK_OR_RETURN(activation == "none" || activation == "relu")
+      << "Unsupported activation " << activation << " of quantized_conv2d";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<void> CheckQuantizationScale(user_op::InferContext* ctx, const std::string& arg_name) {
+  CHECK_EQ_OR_RETURN(ctx->InputShape(arg_name, 0).elem_cnt(), 1)
+      << "The " << arg_name << " of quantized_matmul should be a per-tensor scale";
+  CHECK_EQ_OR_RETURN(ctx->InputDType(arg_name, 0), DataType::kFloat)
+      << "The " << arg_name << " of quantized_matmul should be float";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/*static*/ Maybe<void> QuantizedMatmulOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  // (..., k) x (n, k) -> (..., n)
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  const Shape& b_shape = ctx->InputShape("b", 0);
+  CHECK_GE_OR_RETURN(a_shape.NumAxes(), 2);
+  CHECK_EQ_OR_RETURN(b_shape.NumAxes(), 2);
+  const int64_t n = b_shape.At(0);
+  CHECK_EQ_OR_RETURN(a_shape.At(a_shape.NumAxes() - 1), b_shape.At(1));
+  if (ctx->has_input("bias", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("bias", 0), Shape({n}));
+  }
+  Shape out_shape = a_shape;
+  out_shape.Set(a_shape.NumAxes() - 1, n);
+  ctx->SetOutputShape("out", 0, out_shape);
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedMatmulOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> QuantizedMatmulOp::GetSbp(user_op::SbpContext* ctx) {
+  const int64_t num_axes = ctx->LogicalTensorDesc4InputArgNameAndIndex("a", 0).shape().NumAxes();
+  std::vector<user_op::OpArg> broadcast_args{user_op::OpArg("b", 0), user_op::OpArg("a_scale", 0)};
+  if (ctx->user_op_conf().has_input("bias", 0)) { broadcast_args.emplace_back("bias", 0); }
+  if (ctx->user_op_conf().has_input("out_scale", 0)) {
+    broadcast_args.emplace_back("out_scale", 0);
+  }
+  for (int64_t i = 0; i < num_axes - 1; ++i) {
+    ctx->NewBuilder()
+        .Split(user_op::OpArg("a", 0), i)
+        .Broadcast(broadcast_args)
+        .Split(user_op::OpArg("out", 0), i)
+        .Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedMatmulOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType a_dtype = ctx->InputDType("a", 0);
+  CHECK_OR_RETURN(a_dtype == DataType::kFloat || a_dtype == DataType::kInt8)
+      << "The input a of quantized_matmul should be float or int8 quantized with a_scale";
+  CHECK_EQ_OR_RETURN(ctx->InputDType("b", 0), DataType::kFloat);
+  JUST(CheckQuantizationScale(ctx, "a_scale"));
+  if (ctx->has_input("bias", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("bias", 0), DataType::kFloat);
+  }
+  if (ctx->has_input("out_scale", 0)) {
+    JUST(CheckQuantizationScale(ctx, "out_scale"));
+    ctx->SetOutputDType("out", 0, DataType::kInt8);
+  } else {
+    ctx->SetOutputDType("out", 0, DataType::kFloat);
+  }
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedMatmulOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                    const user_op::UserOpConfWrapper& op_conf) {
+  const std::string& activation = op_conf.attr<std::string>("activation");
+  CHECK_OR_RETURN(activation == "none" || activation == "relu")
+      << "Unsupported activation " << activation << " of quantized_matmul";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
@@ -379,6 +379,7 @@ from oneflow.framework.generator import (
     initial_seed,
     get_rng_state,
     set_rng_state,
+    philox4x32,
 )
 
 # NOTE(chengcheng) oneflow.Model is unavailable now.
@@ -103,6 +103,32 @@ def set_rng_state(state):
     return oneflow.default_generator.set_state(state)
 
 
+def philox4x32(n, seed, offset=0, subsequence=0):
+    r"""
+    Returns the numbers ``[offset, offset + n)`` of the Philox4x32-10 stream of
+    ``seed`` and ``subsequence`` as a numpy ``uint32`` array. Any range of the
+    stream can be generated on its own, and it is the stream the CPU random kernels
+    draw from when ``ONEFLOW_CPU_RANDOM_GENERATOR_USE_PHILOX`` is set.
+
+    Args:
+        n (int): The number of numbers to return.
+        seed (int): The seed, the 64 bit key of the generator.
+        offset (int): The position of the first number in the stream. Default: 0.
+        subsequence (int): The stream of the seed to use. Default: 0.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> flow.philox4x32(4, seed=0)
+        array([1713891541, 3781805453, 3159862348, 2600524760], dtype=uint32)
+    """
+    return oneflow._oneflow_internal.philox4x32(
+        int(n), int(seed), int(offset), int(subsequence)
+    )
+
+
 default_generator = oneflow._oneflow_internal.default_generator("cpu")
 oneflow._oneflow_internal.Generator.__getstate__ = _getstate
 oneflow._oneflow_internal.Generator.__setstate__ = _setstate
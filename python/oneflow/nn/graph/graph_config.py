@@ -469,6 +469,49 @@ class GraphConfig(object):
         """
         self.proto.enable_fused_model_update_cast = mode
 
+    def enable_post_training_quantization(
+        self, mode: bool = True, *, calibration: bool = False, momentum: float = 0.95
+    ):
+        r"""If set to true, the matmuls and conv2ds of a CPU inference graph, with the bias adds and
+        relus following them, are run in int8.
+
+        The ranges of the activations are observed by a graph with ``calibration=True``, which
+        runs in float and keeps moving averages of the max absolute values of the activations in
+        its state dict. Load that state dict into a graph with ``calibration=False`` to rewrite
+        it into int8 ops. The weights are quantized per output channel.
+
+        For example:
+
+        .. code-block:: python
+
+            class Graph(flow.nn.Graph):
+                def __init__(self, model, calibration):
+                    super().__init__()
+                    self.model = model
+                    self.config.enable_post_training_quantization(calibration=calibration)
+
+                def build(self, x):
+                    return self.model(x)
+
+            calibration_graph = Graph(model, calibration=True)
+            for x in calibration_data:
+                calibration_graph(x)
+            int8_graph = Graph(model, calibration=False)
+            int8_graph.load_state_dict(calibration_graph.state_dict())
+
+        Args:
+            mode (bool, optional): The default value is True.
+            calibration (bool, optional): Observe the ranges of the activations instead of
+                running in int8. The default value is False.
+            momentum (float, optional): The momentum of the moving averages of the observed
+                ranges. The default value is 0.95.
+        """
+        assert type(mode) is bool
+        assert type(calibration) is bool
+        self.proto.enable_post_training_quantization = mode
+        self.proto.ptq_config.calibration = calibration
+        self.proto.ptq_config.moving_max_momentum = momentum
+
     def _generate_optimizer_and_variable_configs(
         self, opt_dict: OptDict = None, variables_conf: OrderedDict = None,
     ):
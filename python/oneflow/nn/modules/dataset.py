@@ -434,8 +434,28 @@ class OFRecordImageDecoderRandomCrop(Module):
         random_seed: Optional[int] = None,
         random_area: Sequence[float] = [0.08, 1.0],
         random_aspect_ratio: Sequence[float] = [0.75, 1.333333],
+        output_dtype: flow.dtype = flow.uint8,
+        output_layout: str = "NHWC",
+        mean: Sequence[float] = [],
+        std: Sequence[float] = [],
+        mirror_probability: float = 0.0,
     ):
         super().__init__()
+        # The decoded images have different sizes, so they are only emitted as uint8 HWC
+        # tensor buffers. Use CropMirrorNormalize on them, or the fused options of
+        # OFRecordImageGpuDecoderRandomCropResize, which also decodes on cpu.
+        if (
+            output_dtype != flow.uint8
+            or output_layout != "NHWC"
+            or len(mean) > 0
+            or len(std) > 0
+            or mirror_probability != 0
+        ):
+            raise ValueError(
+                "OFRecordImageDecoderRandomCrop only supports uint8 NHWC outputs "
+                "without mirror or normalization, use CropMirrorNormalize or "
+                "OFRecordImageGpuDecoderRandomCropResize instead"
+            )
         self.blob_name = blob_name
         self.color_space = color_space
         self.num_attempts = num_attempts
@@ -492,6 +512,11 @@ class OFRecordImageGpuDecoderRandomCropResize(Module):
         num_workers: Optional[int] = 3,
         warmup_size: Optional[int] = 6400,
         max_num_pixels: Optional[int] = 67108864,
+        output_dtype: flow.dtype = flow.uint8,
+        output_layout: str = "NHWC",
+        mean: Sequence[float] = [],
+        std: Sequence[float] = [],
+        mirror_probability: float = 0.0,
     ):
         super().__init__()
         self.target_width = target_width
@@ -505,6 +530,11 @@ class OFRecordImageGpuDecoderRandomCropResize(Module):
         self.num_workers = num_workers
         self.warmup_size = warmup_size
         self.max_num_pixels = max_num_pixels
+        self.output_dtype = output_dtype
+        self.output_layout = output_layout
+        self.mean = mean
+        self.std = std
+        self.mirror_probability = mirror_probability
         gpu_decoder_conf = (
             flow.core.operator.op_conf_pb2.ImageDecoderRandomCropResizeOpConf()
         )
@@ -541,6 +571,11 @@ class OFRecordImageGpuDecoderRandomCropResize(Module):
             num_workers=self.num_workers,
             warmup_size=self.warmup_size,
             max_num_pixels=self.max_num_pixels,
+            output_dtype=self.output_dtype,
+            output_layout=self.output_layout,
+            mean=self.mean,
+            std=self.std,
+            mirror_probability=self.mirror_probability,
         )
         if not res.is_cuda:
             print(
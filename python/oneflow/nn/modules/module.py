@@ -181,6 +181,8 @@ class Module(object):
         del state["_load_state_dict_pre_hooks"]
         del state["_is_full_backward_hook"]
         del state["_non_persistent_buffers_set"]
+        # The reducer holds hooks on the parameters, __setstate__ creates it again
+        state.pop("_ddp_reducer", None)
         return state
 
     def __setstate__(self, state):
@@ -193,8 +195,11 @@ class Module(object):
         self._is_full_backward_hook = None
         self._non_persistent_buffers_set = set()
         if hasattr(self, "_is_ddp_module") and self._is_ddp_module:
-            # flow.nn.parallel.DistributedDataParallel updates the module inplace
-            flow.nn.parallel.DistributedDataParallel(self, broadcast_parameters=False)
+            # flow.nn.parallel.DistributedDataParallel updates the module inplace, and
+            # creates the reducer and the hooks dropped by __getstate__
+            flow.nn.parallel.DistributedDataParallel(
+                self, broadcast_parameters=False, **self.__dict__.get("_ddp_kwargs", {})
+            )
 
     def forward(self, *args, **kwargs):
         raise NotImplementedError()
@@ -998,6 +1003,8 @@ class Module(object):
 
         load(self)
         load = None
+        # The kernels keeping a transform of the weights, e.g. the quantized ones, redo it
+        flow._oneflow_internal.IncreaseVariableGeneration()
         if strict:
             if len(unexpected_keys) > 0:
                 error_msgs.insert(
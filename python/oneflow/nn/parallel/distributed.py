@@ -14,74 +14,43 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 import warnings
-from collections import OrderedDict
 
 import oneflow as flow
 from oneflow.support.env_var_util import parse_boolean_from_env
 from oneflow.framework.tensor_tuple_util import convert_to_tensor_tuple
-from oneflow.nn.utils.parameters_grouping import ContiguousParamsGroup
 from oneflow.framework.args_tree import ArgsTree
 
 
-def allreduce_fn(module, param, use_bucket):
-    ddp_state_for_reversed_params = module._ddp_state_for_reversed_params
-
-    def allreduce_with_bucket(grad):
-        buckets = module._buckets
-        bucket_tensors = module._bucket_tensors
-        ddp_state_for_reversed_params[param][0] = True
-        for index, bucket in enumerate(buckets):
-            deleted = all(ddp_state_for_reversed_params[x][1] for x in bucket)
-            if deleted:
-                continue
-
-            assert not any(ddp_state_for_reversed_params[x][1] for x in bucket)
-
-            all_params_in_bucket_ready = all(
-                ddp_state_for_reversed_params[x][0] for x in bucket
-            )
-            if all_params_in_bucket_ready:
-                for x in bucket:
-                    ddp_state_for_reversed_params[x][1] = True
-                # NOTE(jianhao)(higher-order-grad):
-                # local allreduce doesn't have gradient function, higher-order grad may be unsupported
-                flow._C.local_all_reduce(bucket_tensors[index], inplace=True)
-            else:
-                break
-
-    def allreduce_without_bucket(grad):
-        ddp_state_for_reversed_params[param][0] = True
-        for cur_param, (ready, deleted) in ddp_state_for_reversed_params.items():
-            if deleted:
-                continue
-            if ready:
-                ddp_state_for_reversed_params[cur_param][1] = True
-                # NOTE(jianhao)(higher-order-grad): local allreduce doesn't have gradient function, higher-order grad may be unsupported
-                if cur_param is param:
-                    flow._C.local_all_reduce(grad, True)
-                else:
-                    flow._C.local_all_reduce(cur_param.grad, True)
-            else:
-                break
-
-    return allreduce_with_bucket if use_bucket else allreduce_without_bucket
-
-
 def DistributedDataParallel(
     module: "flow.nn.Module",
     *,
     broadcast_buffers: bool = True,
     broadcast_parameters: bool = True,
-    bucket_size: int = 10,
+    bucket_size: int = None,
     use_bucket: bool = True,
+    bucket_cap_mb: float = 25,
+    grad_compression_dtype: flow.dtype = None,
 ):
+    """Averages the gradients of module over the data parallel ranks in the backward.
+
+    The gradients are kept in flat buckets of at most bucket_cap_mb megabytes, and
+    every bucket is all-reduced as soon as its gradients are ready, overlapping the
+    communication with the rest of the backward. After the first iteration the
+    buckets are rebuilt in the order the gradients got ready. The gradients are cast
+    to grad_compression_dtype (e.g. flow.bfloat16) for the all-reduce if it is set.
+    """
     assert all(x.dtype == flow.float32 for x in module.parameters())
+    assert grad_compression_dtype in (None, flow.float16, flow.bfloat16)
+    if bucket_size is not None:
+        warnings.warn(
+            "bucket_size is deprecated and ignored, the buckets are capped by bytes "
+            "with bucket_cap_mb"
+        )
     if use_bucket and parse_boolean_from_env("ONEFLOW_DISABLE_VIEW", False):
         warnings.warn(
             "because the environment variable 'ONEFLOW_DISABLE_VIEW' is set to true, so the view mechanism is disabled, and we will set use_bucket=False"
         )
         use_bucket = False
-    world_size = flow.env.get_world_size()
     if broadcast_parameters:
         with flow.no_grad():
             for x in module.parameters():
@@ -91,59 +60,23 @@ def DistributedDataParallel(
                 # after flow._C.comm_broadcast
                 x.requires_grad_(requires_grad)
 
-    if use_bucket:
-        all_grad_size = sum([x.numel() for x in module.parameters()])
-        if all_grad_size > 0:
-            device = list(module.parameters())[0].device
-            assert all(x.device == device for x in module.parameters())
-        reversed_param_list = list(
-            reversed(
-                list([param for param in module.parameters() if param.requires_grad])
-            )
-        )
-
-        module._bucket_index = {
-            x: i // bucket_size for i, x in enumerate(reversed_param_list)
-        }
-        module._buckets = [
-            reversed_param_list[i : i + bucket_size]
-            for i in range(0, len(reversed_param_list), bucket_size)
-        ]
-
-        module._params_group = ContiguousParamsGroup(module._buckets)
-        module._bucket_tensors = module._params_group.grouped_parameters_grad
-
-    ddp_state_for_reversed_params = OrderedDict(
-        reversed([(x, [False, False]) for x in module.parameters() if x.requires_grad])
+    # The gradients of the last parameters are usually ready first
+    reversed_params = list(
+        reversed([x for x in module.parameters() if x.requires_grad])
+    )
+    bucket_cap_bytes = int(bucket_cap_mb * 1024 * 1024) if use_bucket else 0
+    module._ddp_reducer = flow._oneflow_internal.DDPReducer(
+        convert_to_tensor_tuple(reversed_params),
+        bucket_cap_bytes,
+        grad_compression_dtype,
     )
-    module._ddp_state_for_reversed_params = ddp_state_for_reversed_params
-    # The gradient shoule be averaged by all the nodes, so besides allreduce,
-    # a division by world_size is required.
-    # Use x * (1 / world_size) instead of x / world_size for two reasons:
-    # 1. multiplication is faster than division
-    # 2. An inplace operation is needed here (for allreduce grouping)
-    #    But we do not have inplace division in oneflow.
-    mul_factor = 1 / world_size
-
-    def inplace_mul_and_return_none(x):
-        x.mul_(mul_factor)
-        return None
-
-    for param in module.parameters():
-        if param.requires_grad:
-            param._register_post_grad_accumulation_hook(inplace_mul_and_return_none)
-            param._register_post_grad_accumulation_hook(
-                allreduce_fn(module, param, use_bucket)
-            )
 
     def post_forward_hook(module, input, output):
-        ddp_state_for_reversed_params = module._ddp_state_for_reversed_params
-        for state in ddp_state_for_reversed_params.values():
-            state[0], state[1] = False, False
+        module._ddp_reducer.prepare_for_backward()
+        # Every parameter gets a gradient, even if it is unused by the forward
         output = ArgsTree(output).map_leaf(
             lambda x: flow._C.select_top_n(
-                convert_to_tensor_tuple([x, *ddp_state_for_reversed_params.keys()]),
-                n=1,
+                convert_to_tensor_tuple([x, *reversed_params]), n=1
             )[0]
         )
         buffers = list(module.buffers())
@@ -163,5 +96,12 @@ def DistributedDataParallel(
         module.register_forward_pre_hook(pre_forward_hook)
 
     module._is_ddp_module = True
+    # Module.__setstate__ applies DistributedDataParallel again with them after a copy
+    module._ddp_kwargs = dict(
+        broadcast_buffers=broadcast_buffers,
+        use_bucket=use_bucket,
+        bucket_cap_mb=bucket_cap_mb,
+        grad_compression_dtype=grad_compression_dtype,
+    )
 
     return module
@@ -207,6 +207,9 @@ class Embedding(Module):
             len(key_value_store_options["kv_store"]["caches"]) > 0
             and key_value_store_options["kv_store"]["caches"][0]["policy"] == "full"
         )
+        self.store_device_type = key_value_store_options["kv_store"].get(
+            "device_type", "cuda"
+        )
         self.key_value_store_options = json.dumps(key_value_store_options)
         self.embedding_tables = json.dumps(embedding_tables)
         self.num_tables = len(embedding_tables["tables"])
@@ -224,7 +227,9 @@ class Embedding(Module):
     def _save_to_state_dict(self, destination, prefix, keep_vars):
         super()._save_to_state_dict(destination, prefix, keep_vars)
         snapshot_timestamp_tensor = flow.tensor(
-            datetime.datetime.now().timestamp(), dtype=flow.float64, device="cuda"
+            datetime.datetime.now().timestamp(),
+            dtype=flow.float64,
+            device=self.store_device_type,
         )
         # Broadcast timestamp tensor from master rank.
         flow.comm.broadcast(snapshot_timestamp_tensor, src=0)
@@ -724,6 +729,41 @@ def make_cached_host_mem_store_options(
     return options
 
 
+def make_cpu_store_options(
+    persistent_path, capacity, size_factor=1, storage_dim=-1, physical_block_size=4096
+):
+    """make CPU only store_options param of MultiTableEmbedding, the embeddings are kept in host memory and looked up, updated and shuffled by the cpu kernels, which lets the embedding be placed on cpu
+
+    Args:
+        persistent_path (str, list): persistent storage path of Embedding. If passed a str, current rank Embedding will be saved in path/rank_id-num_ranks path. If passed a list, the list length must equals num_ranks, each elem of list represent the path of rank_id Embedding.
+        capacity (int): total capacity of Embedding
+        size_factor (int, optional): store size factor of embedding_dim, if SGD update, and momentum = 0, should be 1, if momentum > 0, it should be 2. if Adam, should be 3. Defaults to 1.
+        storage_dim (int, optional): number of elements in embedding storage, if set storage_dim, the size_factor param will be invalid. if SGD update, and momentum = 0, storage_dim should be embedding_size*1, if momentum > 0, storage_dim should be embedding_size*2. if Adam, storage_dim should be embedding_size*3. Defaults to -1.
+        physical_block_size (int, optional): physical_block_size should be sector size. Defaults to 4096.
+
+    Returns:
+        dict: CPU only store_options param of MultiTableEmbedding
+
+    See also :func:`oneflow.one_embedding.make_device_mem_store_options`
+    """
+    assert isinstance(persistent_path, (str, list, tuple))
+    assert capacity > 0
+    options = {
+        "kv_store": {
+            "device_type": "cpu",
+            "caches": [],
+            "persistent_table": {
+                "path": persistent_path,
+                "physical_block_size": physical_block_size,
+                "capacity_hint": int(capacity),
+            },
+        },
+        "size_factor": size_factor,
+        "storage_dim": storage_dim,
+    }
+    return options
+
+
 def make_uniform_initializer(low=0.0, high=1.0):
     """make uniform initializer param of make_table_options
 
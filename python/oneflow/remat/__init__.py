@@ -53,3 +53,23 @@ set_small_pieces_optimization = (
 is_small_pieces_optimization_enabled = (
     flow._oneflow_internal.remat.is_small_pieces_optimization_enabled
 )
+
+
+def set_spill(enabled: bool, compression: bool = False, spill_dir: str = ""):
+    """Spills the evicted tensors which are cheaper to copy back than to recompute,
+    to the host memory, compressed if `compression` is True, or to files under
+    `spill_dir` if it is set.
+    """
+    flow._oneflow_internal.remat.set_spill_enabled(enabled)
+    flow._oneflow_internal.remat.set_spill_compression(compression)
+    flow._oneflow_internal.remat.set_spill_dir(spill_dir)
+
+
+def set_spill_bandwidth(bandwidth: str):
+    """Sets the assumed bytes per second of spilling, e.g. "4GB", which is then
+    updated by the measured spills and restores.
+    """
+    flow._oneflow_internal.remat.set_spill_bandwidth(parse_size(bandwidth))
+
+
+is_spill_enabled = flow._oneflow_internal.remat.is_spill_enabled
@@ -19,6 +19,7 @@ with correct environment variables like ONEFLOW_VM_MULTI_THREAD=0
 """
 from contextlib import contextmanager
 import os
+import tempfile
 import unittest
 import functools
 
@@ -38,6 +39,14 @@ def is_in_memory(tensor):
     return flow._oneflow_internal.remat.is_in_memory(tensor)
 
 
+def spill(tensor):
+    flow._oneflow_internal.remat.spill(tensor)
+
+
+def is_spilled(tensor):
+    return flow._oneflow_internal.remat.is_spilled(tensor)
+
+
 placeholder_size = 0
 
 
@@ -251,6 +260,74 @@ class TestRemat(flow.unittest.TestCase):
         self.assertTrue(np.array_equal(x6.numpy(), np.ones(x6.shape) * 11))
         self.assertTrue(np.array_equal(x3.numpy(), np.ones(x3.shape) * 5))
 
+    @flow.unittest.skip_unless_1n1d()
+    @memory_budget(12, "cpu")
+    def test_remat_spill_and_restore(self, device):
+        with tempfile.TemporaryDirectory() as spill_dir:
+            try:
+                for compression, directory in [
+                    (False, ""),
+                    (True, ""),
+                    (False, spill_dir),
+                ]:
+                    flow.remat.set_spill(True, compression, directory)
+                    restore_num = flow._oneflow_internal.remat.restore_num()
+                    recomputation_num = flow._oneflow_internal.remat.recomputation_num()
+                    x1 = flow.ones(1024 * 1024, device=device)  # 4MB
+                    x2 = x1 * 0
+                    x3 = x1 + 2
+                    del x1
+                    spill(x2)
+                    spill(x3)
+                    self.assertTrue(is_spilled(x2))
+                    self.assertTrue(is_spilled(x3))
+                    self.assertFalse(is_in_memory(x3))
+                    self.assertEqual(allocated_memory(device), 0)
+                    if directory:
+                        self.assertEqual(len(os.listdir(directory)), 2)
+                    x4 = x2 + x3
+                    if directory:
+                        self.assertEqual(os.listdir(directory), [])
+                    self.assertTrue(is_in_memory(x2))
+                    self.assertFalse(is_spilled(x3))
+                    self.assertEqual(allocated_memory(device), 12 * 1024 * 1024)
+                    self.assertTrue(np.array_equal(x4.numpy(), np.ones(x4.shape) * 3))
+                    self.assertTrue(np.array_equal(x2.numpy(), np.zeros(x2.shape)))
+                    self.assertEqual(
+                        flow._oneflow_internal.remat.restore_num(), restore_num + 2
+                    )
+                    self.assertEqual(
+                        flow._oneflow_internal.remat.recomputation_num(),
+                        recomputation_num,
+                    )
+                    del x2, x3, x4
+            finally:
+                flow.remat.set_spill(False)
+
+    @flow.unittest.skip_unless_1n1d()
+    @memory_budget(12, "cpu")
+    def test_remat_spill_or_recompute_by_bandwidth(self, device):
+        try:
+            flow.remat.set_spill(True)
+            x1 = flow.ones(1024 * 1024, device=device)  # 4MB
+            x2 = x1 * 2
+            # copying back 4MB at 1B/s is slower than recomputing
+            flow.remat.set_spill_bandwidth("1B")
+            evict(x2)
+            self.assertFalse(is_spilled(x2))
+            self.assertTrue(np.array_equal(x2.numpy(), np.ones(x2.shape) * 2))
+            self.assertEqual(flow._oneflow_internal.remat.recomputation_num(), 1)
+            # and at 1024TB/s it is faster
+            flow.remat.set_spill_bandwidth("1024TB")
+            evict(x2)
+            self.assertTrue(is_spilled(x2))
+            self.assertTrue(np.array_equal(x2.numpy(), np.ones(x2.shape) * 2))
+            self.assertEqual(flow._oneflow_internal.remat.recomputation_num(), 1)
+            self.assertEqual(flow._oneflow_internal.remat.restore_num(), 1)
+        finally:
+            flow.remat.set_spill(False)
+            flow.remat.set_spill_bandwidth("4GB")
+
     @flow.unittest.skip_unless_1n1d()
     @memory_budget(12, "cpu")
     def test_remat_full_and_init_constant(self, device):
@@ -0,0 +1,113 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import copy
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.core.common.data_type_pb2 as data_type_pb2
+import oneflow.unittest
+
+
+def _make_mlp():
+    return flow.nn.Sequential(
+        flow.nn.Linear(256, 512),
+        flow.nn.ReLU(),
+        flow.nn.Linear(512, 512),
+        flow.nn.ReLU(),
+        flow.nn.Linear(512, 16),
+    )
+
+
+class MLPTrainGraph(flow.nn.Graph):
+    def __init__(self, model, enable_amp):
+        super().__init__()
+        self.model = model
+        self.add_optimizer(flow.optim.SGD(model.parameters(), lr=0.01))
+        if enable_amp:
+            self.config.enable_amp(True, dtype=flow.bfloat16)
+
+    def build(self, x, label):
+        loss = flow.mean((self.model(x) - label) ** 2)
+        loss.backward()
+        return loss
+
+
+def _train(model, enable_amp, inputs, labels):
+    graph = MLPTrainGraph(model, enable_amp)
+    losses = [graph(x, label).numpy() for x, label in zip(inputs, labels)]
+    return np.array(losses), graph
+
+
+def _bfloat16_op_types(graph):
+    """The types of the ops writing bfloat16 outputs in the compiled graph"""
+    graph_proto = graph._full_graph_proto
+    lbn2blob_desc = graph_proto.helper.lbn2logical_blob_desc
+    op_types = set()
+    for op in graph_proto.net.op:
+        if not op.HasField("user_conf"):
+            continue
+        for output in op.user_conf.output.values():
+            for lbn in output.s:
+                if lbn2blob_desc[lbn].data_type == data_type_pb2.kBFloat16:
+                    op_types.add(op.user_conf.op_type_name)
+    return op_types
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphAmpCpuBFloat16(flow.unittest.TestCase):
+    def test_mlp_train(test_case):
+        np.random.seed(0)
+        inputs = [
+            flow.tensor(np.random.randn(64, 256).astype(np.float32)) for _ in range(10)
+        ]
+        labels = [
+            flow.tensor(np.random.randn(64, 16).astype(np.float32)) for _ in range(10)
+        ]
+        model = _make_mlp()
+        fp32_model = copy.deepcopy(model)
+        fp32_losses, fp32_graph = _train(fp32_model, False, inputs, labels)
+        bf16_losses, bf16_graph = _train(model, True, inputs, labels)
+
+        test_case.assertEqual(len(_bfloat16_op_types(fp32_graph)), 0)
+        bf16_op_types = _bfloat16_op_types(bf16_graph)
+        # The inputs of the white list ops are cast to bfloat16, and the gray and
+        # clear list ops following them stay in bfloat16
+        test_case.assertIn("cast", bf16_op_types)
+        test_case.assertTrue(
+            bf16_op_types & {"matmul", "broadcast_matmul"}, bf16_op_types
+        )
+        test_case.assertTrue(
+            bf16_op_types & {"bias_add", "broadcast_add", "add_n"}, bf16_op_types
+        )
+        test_case.assertIn("relu", bf16_op_types)
+
+        # bfloat16 keeps 8 bits of mantissa
+        test_case.assertTrue(
+            np.allclose(fp32_losses, bf16_losses, rtol=2e-2, atol=2e-2)
+        )
+        for fp32_param, bf16_param in zip(fp32_model.parameters(), model.parameters()):
+            test_case.assertEqual(bf16_param.dtype, flow.float32)
+            test_case.assertTrue(
+                np.allclose(
+                    fp32_param.numpy(), bf16_param.numpy(), rtol=2e-2, atol=2e-2
+                )
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -91,5 +91,19 @@ class TestOFRecordReaderGraph(oneflow.unittest.TestCase):
         image, label = reader_g()
 
 
+class TestOFRecordImageDecoderRandomCrop(oneflow.unittest.TestCase):
+    def test_reject_fused_output_options(test_case):
+        flow.nn.OFRecordImageDecoderRandomCrop("encoded", color_space="RGB")
+        for kwargs in [
+            {"output_dtype": flow.float},
+            {"output_layout": "NCHW"},
+            {"mean": [123.68, 116.779, 103.939]},
+            {"std": [58.393, 57.12, 57.375]},
+            {"mirror_probability": 0.5},
+        ]:
+            with test_case.assertRaises(ValueError):
+                flow.nn.OFRecordImageDecoderRandomCrop("encoded", **kwargs)
+
+
 if __name__ == "__main__":
     unittest.main()
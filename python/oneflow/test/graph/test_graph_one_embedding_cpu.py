@@ -0,0 +1,227 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import tempfile
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.nn as nn
+import oneflow.unittest
+
+
+class TestModule(nn.Module):
+    def __init__(
+        self, name, embedding_dim, persistent_path, table_size_array, size_factor
+    ):
+        super(TestModule, self).__init__()
+        tables = [
+            flow.one_embedding.make_table(
+                flow.one_embedding.make_uniform_initializer(low=-0.1, high=0.1)
+            )
+            for _ in table_size_array
+        ]
+        store_options = flow.one_embedding.make_cpu_store_options(
+            persistent_path=persistent_path,
+            capacity=sum(table_size_array),
+            size_factor=size_factor,
+        )
+        self.embedding = flow.one_embedding.MultiTableEmbedding(
+            name,
+            embedding_dim=embedding_dim,
+            dtype=flow.float,
+            key_type=flow.int64,
+            tables=tables,
+            store_options=store_options,
+        )
+        self.mlp = nn.Linear(embedding_dim, 1)
+
+    def forward(self, ids):
+        return self.mlp(self.embedding(ids)).mean(dim=1)
+
+
+class TrainGraph(flow.nn.Graph):
+    def __init__(self, module, optimizer):
+        super(TrainGraph, self).__init__()
+        self.module = module
+        self.loss = flow.nn.BCEWithLogitsLoss()
+        self.add_optimizer(optimizer)
+
+    def build(self, labels, ids):
+        loss = self.loss(self.module(ids), labels)
+        loss.backward()
+        return loss
+
+
+def _test_one_embedding_cpu(test_case, opt_name):
+    batch_size = 64
+    table_size_array = [32, 1000, 7]
+    with tempfile.TemporaryDirectory() as persistent_path:
+        size_factor = {"sgd": 1, "adam": 3, "adagrad": 2}[opt_name]
+        module = TestModule(
+            "one_embedding_cpu_" + opt_name,
+            16,
+            persistent_path,
+            table_size_array,
+            size_factor,
+        )
+        module.to_global(flow.placement.all("cpu"), flow.sbp.broadcast)
+        if opt_name == "sgd":
+            opt = flow.optim.SGD(module.parameters(), lr=0.1)
+        elif opt_name == "adam":
+            opt = flow.optim.Adam(module.parameters(), lr=0.01)
+        else:
+            opt = flow.optim.Adagrad(module.parameters(), lr=0.1)
+        graph = TrainGraph(module, opt)
+        # Train on a fixed batch, the loss must go down
+        labels = np.random.randint(2, size=(batch_size, 1)).astype(np.float32)
+        ids = np.random.randint(
+            sum(table_size_array), size=(batch_size, len(table_size_array))
+        )
+        placement = flow.placement.all("cpu")
+        labels = flow.tensor(labels).to_global(placement, flow.sbp.split(0))
+        ids = flow.tensor(ids).to_global(placement, flow.sbp.split(0))
+        losses = [graph(labels, ids).numpy() for _ in range(20)]
+        test_case.assertFalse(np.isnan(losses).any())
+        test_case.assertLess(losses[-1], losses[0])
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphOneEmbeddingCpu(flow.unittest.TestCase):
+    def test_sgd(test_case):
+        _test_one_embedding_cpu(test_case, "sgd")
+
+    def test_adam(test_case):
+        _test_one_embedding_cpu(test_case, "adam")
+
+    def test_adagrad(test_case):
+        _test_one_embedding_cpu(test_case, "adagrad")
+
+
+def _test_shuffle_cpu(test_case, num_tables, embedding_size):
+    parallel_num = flow.env.get_world_size()
+    placement = flow.placement.all("cpu")
+    batch_size = 128
+    max_id = 1000
+    local_ids = np.random.randint(0, max_id, (batch_size, num_tables), dtype=np.int64)
+    ids = flow.tensor(local_ids).to_global(placement, flow.sbp.split(0))
+    # The same id always belongs to the same table
+    table_ids = flow.tensor((local_ids % num_tables).astype(np.int32)).to_global(
+        placement, flow.sbp.split(0)
+    )
+    embedding_grad = np.random.rand(batch_size, num_tables, embedding_size)
+    embedding_grad = flow.tensor(embedding_grad.astype(np.float32)).to_global(
+        placement, flow.sbp.split(0)
+    )
+    columns = flow.tensor(np.arange(embedding_size, dtype=np.float32)).to_global(
+        placement, flow.sbp.broadcast
+    )
+
+    class ShuffleGraph(flow.nn.Graph):
+        def build(self, ids, table_ids, embedding_grad, columns):
+            (
+                num_unique_matrix,
+                inverse_unique_partition_indices,
+                cur_rank_num_unique,
+                cur_rank_unique_ids,
+                _,
+                cur_rank_inverse_indices,
+            ) = flow._C.one_embedding_id_shuffle(
+                ids, table_ids, num_tables, "cpu_shuffle"
+            )
+            # The embedding of id looked up by its rank is id * embedding_size + column
+            unique_embeddings = (
+                flow.cast(cur_rank_unique_ids, flow.float32).reshape(-1, 1)
+                * embedding_size
+                + columns
+            )
+            embeddings = flow._C.one_embedding_embedding_shuffle(
+                unique_embeddings,
+                num_unique_matrix,
+                cur_rank_inverse_indices,
+                inverse_unique_partition_indices,
+                "cpu_shuffle",
+            )
+            unique_embedding_grad = flow._C.one_embedding_embedding_gradient_shuffle(
+                embedding_grad,
+                num_unique_matrix,
+                cur_rank_inverse_indices,
+                inverse_unique_partition_indices,
+                "cpu_shuffle",
+            )
+            return (
+                embeddings,
+                unique_embedding_grad,
+                flow.cast(cur_rank_num_unique, flow.int32),
+                cur_rank_unique_ids,
+            )
+
+    (
+        embeddings,
+        unique_embedding_grad,
+        cur_rank_num_unique,
+        cur_rank_unique_ids,
+    ) = ShuffleGraph()(ids, table_ids, embedding_grad, columns)
+    cur_rank_num_unique = cur_rank_num_unique.to_local().to_global(
+        placement, flow.sbp.split(0)
+    )
+    global_ids = ids.numpy()
+    global_embedding_grad = embedding_grad.numpy().reshape(-1, embedding_size)
+
+    # Every id is looked up on the rank holding it and sent back to where it came from
+    np_embeddings = (
+        global_ids[..., np.newaxis] * embedding_size + np.arange(embedding_size)
+    ).astype(np.float32)
+    test_case.assertTrue(np.array_equal(embeddings.numpy(), np_embeddings))
+
+    # Every unique id is held by one rank, with the sum of its gradients
+    cur_rank_num_ids = batch_size * num_tables * parallel_num
+    num_unique = cur_rank_num_unique.numpy()
+    unique_ids = cur_rank_unique_ids.numpy()
+    unique_embedding_grad = unique_embedding_grad.numpy()
+    of_unique_ids = []
+    for i in range(parallel_num):
+        begin = cur_rank_num_ids * i
+        for j in range(begin, begin + num_unique[i]):
+            unique_id = unique_ids[j]
+            of_unique_ids.append(unique_id)
+            np_grad = global_embedding_grad[global_ids.flatten() == unique_id].sum(
+                axis=0
+            )
+            test_case.assertTrue(
+                np.allclose(unique_embedding_grad[j], np_grad, rtol=1e-4, atol=1e-4)
+            )
+    test_case.assertTrue(
+        np.array_equal(np.sort(of_unique_ids), np.unique(global_ids))
+    )
+
+
+@flow.unittest.skip_unless_1n2d()
+class TestGraphOneEmbeddingCpu1n2d(flow.unittest.TestCase):
+    def test_shuffle(test_case):
+        for num_tables in [1, 26]:
+            for embedding_size in [128, 17]:
+                _test_shuffle_cpu(test_case, num_tables, embedding_size)
+
+    def test_sgd(test_case):
+        _test_one_embedding_cpu(test_case, "sgd")
+
+    def test_adam(test_case):
+        _test_one_embedding_cpu(test_case, "adam")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,109 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class QuantizationGraph(flow.nn.Graph):
+    def __init__(self, model, calibration):
+        super().__init__()
+        self.model = model
+        self.config.enable_post_training_quantization(calibration=calibration)
+
+    def build(self, x):
+        return self.model(x)
+
+
+def _quantized_op_types(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+        and op.user_conf.op_type_name in ["quantized_matmul", "quantized_conv2d"]
+    ]
+
+
+def _test_outputs(test_case, graph, model, inputs):
+    for x in inputs:
+        out = graph(x).numpy()
+        expected = model(x).numpy()
+        test_case.assertEqual(out.dtype, np.float32)
+        test_case.assertEqual(out.shape, expected.shape)
+        error = np.abs(out - expected).max() / np.abs(expected).max()
+        test_case.assertLess(error, 0.05)
+
+
+def _test_post_training_quantization(
+    test_case, model, input_shape, quantized_op_type, num_quantized_ops
+):
+    model.eval()
+    calibration_inputs = [flow.randn(*input_shape) for _ in range(4)]
+    calibration_graph = QuantizationGraph(model, calibration=True)
+    for x in calibration_inputs:
+        # The observers do not change the outputs of the calibration graph
+        test_case.assertTrue(
+            np.allclose(calibration_graph(x).numpy(), model(x).numpy(), 1e-05, 1e-05)
+        )
+    test_case.assertEqual(len(_quantized_op_types(calibration_graph)), 0)
+
+    int8_graph = QuantizationGraph(model, calibration=False)
+    int8_graph.load_state_dict(calibration_graph.state_dict())
+    _test_outputs(test_case, int8_graph, model, calibration_inputs)
+    test_case.assertEqual(
+        _quantized_op_types(int8_graph), [quantized_op_type] * num_quantized_ops
+    )
+
+    # load_state_dict after the first run makes the kernels quantize the weights again. Negating
+    # the last layer keeps the ranges of the activations observed by the calibration.
+    state_dict = model.state_dict()
+    last_weight = [key for key in state_dict if key.endswith(".weight")][-1]
+    for key in [last_weight, last_weight[: -len("weight")] + "bias"]:
+        state_dict[key] = -state_dict[key]
+    model.load_state_dict(state_dict)
+    _test_outputs(test_case, int8_graph, model, calibration_inputs)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphPostTrainingQuantization(oneflow.unittest.TestCase):
+    def test_mlp(test_case):
+        model = flow.nn.Sequential(
+            flow.nn.Linear(64, 128),
+            flow.nn.ReLU(),
+            flow.nn.Linear(128, 128),
+            flow.nn.ReLU(),
+            flow.nn.Linear(128, 10),
+        )
+        _test_post_training_quantization(
+            test_case, model, (16, 64), "quantized_matmul", 3
+        )
+
+    def test_conv(test_case):
+        model = flow.nn.Sequential(
+            flow.nn.Conv2d(3, 16, 3, padding=1),
+            flow.nn.ReLU(),
+            flow.nn.Conv2d(16, 8, 3, stride=2),
+            flow.nn.ReLU(),
+        )
+        _test_post_training_quantization(
+            test_case, model, (2, 3, 16, 16), "quantized_conv2d", 2
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -24,6 +24,16 @@ from test_util import GenArgList
 import oneflow as flow
 
 
+def _multi_tensor_update_ops(graph):
+    graph_proto = graph._full_graph_proto
+    return [
+        op.user_conf
+        for op in graph_proto.net.op
+        if op.HasField("user_conf")
+        and op.user_conf.op_type_name.startswith("multi_tensor_")
+    ]
+
+
 def compare_with_numpy_adam(
     test_case,
     device,
@@ -36,6 +46,7 @@ def compare_with_numpy_adam(
     eps,
     do_bias_correction,
     amsgrad,
+    use_grad_scaler,
 ):
     random_weight_seq = []
     init_value_seq = []
@@ -102,12 +113,27 @@ def compare_with_numpy_adam(
             self.config.allow_fuse_model_update_ops(True)
             self.config.enable_multi_tensor_update(True)
             self.config.enable_fused_model_update_cast(True)
+            if use_grad_scaler:
+                # The dynamic loss scale feeds scale_by_tensor and skip_if
+                self.set_grad_scaler(
+                    flow.amp.GradScaler(
+                        init_scale=1024,
+                        growth_factor=2.0,
+                        backoff_factor=0.5,
+                        growth_interval=1000,
+                    )
+                )
 
         def build(self, mask_tensor_list):
             loss = flow.sum(self.m(mask_tensor_list))
             loss.backward()
             return loss
 
+    # The gradients of this iteration are not finite, so the update is skipped
+    skip_iter = train_iters // 2 if use_grad_scaler else -1
+    if use_grad_scaler:
+        random_weight_seq[skip_iter][0][0, 0] = np.inf
+
     of_res_list = []
     adam_graph = CustomAdamGraph()
     for i in range(train_iters):
@@ -126,6 +152,14 @@ def compare_with_numpy_adam(
         for idx in range(tensor_num):
             of_res_list[i].append(copy.copy(simp_module.param(idx).numpy()))
 
+    multi_tensor_ops = _multi_tensor_update_ops(adam_graph)
+    test_case.assertTrue(len(multi_tensor_ops) > 0)
+    for op in multi_tensor_ops:
+        test_case.assertTrue(op.op_type_name.startswith("multi_tensor_adam_update"))
+        test_case.assertEqual(
+            "scale_by_tensor" in op.input and "skip_if" in op.input, use_grad_scaler,
+        )
+
     np_res_list = []
 
     def train_by_numpy():
@@ -161,22 +195,24 @@ def compare_with_numpy_adam(
             return (x, m, v)
 
         for i in range(1, train_iters + 1):
-            x, m, v = train_one_iter(i, random_weight_seq[i - 1])
+            if i - 1 != skip_iter:
+                x, m, v = train_one_iter(i, random_weight_seq[i - 1])
             np_res_list.append(copy.copy(x))
 
     train_by_numpy()
-    for i in range(tensor_num):
+    for i in range(train_iters):
         test_case.assertTrue(
             np.allclose(np_res_list[i], of_res_list[i], rtol=1e-3, atol=1e-3)
         )
 
 
-@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestMultiTensorAdam(flow.unittest.TestCase):
     def test_multi_tensor_adam(test_case):
         arg_dict = OrderedDict()
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cpu", "cuda"]
+        if os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"] = ["cpu"]
         arg_dict["x_shape"] = [(4, 4)]
         arg_dict["tensor_num"] = [4, 6]
         arg_dict["learning_rate"] = [1, 1e-3]
@@ -186,6 +222,7 @@ class TestMultiTensorAdam(flow.unittest.TestCase):
         arg_dict["eps"] = [1e-5]
         arg_dict["do_bias_correction"] = [True, False]
         arg_dict["amsgrad"] = [False]  # Multi tensor update do not support amsgrad
+        arg_dict["use_grad_scaler"] = [False, True]
         for arg in GenArgList(arg_dict):
             compare_with_numpy_adam(test_case, *arg)
 
@@ -24,8 +24,27 @@ from test_util import GenArgList
 import oneflow as flow
 
 
+def _multi_tensor_update_ops(graph):
+    graph_proto = graph._full_graph_proto
+    return [
+        op.user_conf
+        for op in graph_proto.net.op
+        if op.HasField("user_conf")
+        and op.user_conf.op_type_name.startswith("multi_tensor_")
+    ]
+
+
 def compare_with_numpy_sgd(
-    test_case, device, x_shape, tensor_num, learning_rate, train_iters, weight_decay
+    test_case,
+    device,
+    x_shape,
+    tensor_num,
+    learning_rate,
+    train_iters,
+    momentum,
+    nesterov,
+    weight_decay,
+    use_grad_scaler,
 ):
     random_weight_seq = []
     init_value_seq = []
@@ -74,6 +93,8 @@ def compare_with_numpy_sgd(
             {
                 "params": simp_module.parameters(),
                 "lr": learning_rate,
+                "momentum": momentum,
+                "nesterov": nesterov,
                 "weight_decay": weight_decay,
             }
         ],
@@ -88,12 +109,27 @@ def compare_with_numpy_sgd(
             self.config.allow_fuse_model_update_ops(True)
             self.config.enable_multi_tensor_update(True)
             self.config.enable_fused_model_update_cast(True)
+            if use_grad_scaler:
+                # The dynamic loss scale feeds scale_by_tensor and skip_if
+                self.set_grad_scaler(
+                    flow.amp.GradScaler(
+                        init_scale=1024,
+                        growth_factor=2.0,
+                        backoff_factor=0.5,
+                        growth_interval=1000,
+                    )
+                )
 
         def build(self, mask_tensor_list):
             loss = flow.sum(self.m(mask_tensor_list))
             loss.backward()
             return loss
 
+    # The gradients of this iteration are not finite, so the update is skipped
+    skip_iter = train_iters // 2 if use_grad_scaler else -1
+    if use_grad_scaler:
+        random_weight_seq[skip_iter][0][0, 0] = np.inf
+
     of_res_list = []
     sgd_graph = CustomSGDGraph()
     for i in range(train_iters):
@@ -112,10 +148,21 @@ def compare_with_numpy_sgd(
         for idx in range(tensor_num):
             of_res_list[i].append(copy.copy(simp_module.param(idx).numpy()))
 
+    if momentum == 0:
+        multi_tensor_ops = _multi_tensor_update_ops(sgd_graph)
+        test_case.assertTrue(len(multi_tensor_ops) > 0)
+        for op in multi_tensor_ops:
+            test_case.assertTrue(op.op_type_name.startswith("multi_tensor_sgd_update"))
+            test_case.assertEqual(
+                "scale_by_tensor" in op.input and "skip_if" in op.input,
+                use_grad_scaler,
+            )
+
     np_res_list = []
 
     def train_by_numpy():
         x = init_value_seq
+        buf = [np.zeros_like(x[i]) for i in range(tensor_num)]
         ones = np.ones(x_shape).astype(np.float32)
 
         def train_one_iter(weight):
@@ -123,32 +170,43 @@ def compare_with_numpy_sgd(
                 transposed_weight = np.transpose(weight[i], (1, 0))
                 grad = np.matmul(ones, transposed_weight)
                 grad = grad + weight_decay * x[i]
+                if momentum > 0:
+                    buf[i] = momentum * buf[i] + grad
+                    grad = grad + momentum * buf[i] if nesterov else buf[i]
                 x[i] = x[i] - learning_rate * grad
             return x
 
         for i in range(train_iters):
-            x = train_one_iter(random_weight_seq[i])
+            if i != skip_iter:
+                x = train_one_iter(random_weight_seq[i])
             np_res_list.append(copy.copy(x))
 
     train_by_numpy()
-    for i in range(tensor_num):
+    for i in range(train_iters):
         test_case.assertTrue(
             np.allclose(np_res_list[i], of_res_list[i], rtol=1e-3, atol=1e-3)
         )
 
 
-@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestMultiTensorSGD(flow.unittest.TestCase):
     def test_multi_tensor_sgd(test_case):
         arg_dict = OrderedDict()
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cpu", "cuda"]
+        if os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"] = ["cpu"]
         arg_dict["x_shape"] = [(4, 4)]
         arg_dict["tensor_num"] = [4, 6]
         arg_dict["learning_rate"] = [1, 1e-3]
         arg_dict["train_iters"] = [10]
+        arg_dict["momentum"] = [0.0, 0.9]
+        arg_dict["nesterov"] = [False, True]
         arg_dict["weight_decay"] = [0.0, 1e-3]
+        arg_dict["use_grad_scaler"] = [False, True]
         for arg in GenArgList(arg_dict):
+            (momentum, nesterov) = (arg[5], arg[6])
+            if momentum == 0 and nesterov:
+                continue
             compare_with_numpy_sgd(test_case, *arg)
 
 
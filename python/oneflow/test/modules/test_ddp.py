@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import copy
 import unittest
 import oneflow as flow
 
@@ -35,6 +36,10 @@ def np_allclose_with_shape(a, b, *args, **kwargs):
 test_device = ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
 
 
+def bucket_cap_mb(num_bytes):
+    return num_bytes / 1024 / 1024
+
+
 @flow.unittest.skip_unless_1n2d()
 class TestDDP(flow.unittest.TestCase):
     def _test_ddp_basic(test_case, dev_type):
@@ -92,7 +97,8 @@ class TestDDP(flow.unittest.TestCase):
 
         x = x.to(dev_type)
         m = Mul().to(dev_type)
-        m = ddp(m, bucket_size=3, use_bucket=use_bucket)
+        # 3 parameters of 2 floats in a bucket
+        m = ddp(m, bucket_cap_mb=bucket_cap_mb(24), use_bucket=use_bucket)
 
         y = m(x)
         y.sum().backward()
@@ -133,7 +139,7 @@ class TestDDP(flow.unittest.TestCase):
 
         x = x.to(dev_type)
         m = Model().to(dev_type)
-        m = ddp(m, bucket_size=2)
+        m = ddp(m, bucket_cap_mb=bucket_cap_mb(8))
         y = m(x)
         y.backward()
 
@@ -178,7 +184,7 @@ class TestDDP(flow.unittest.TestCase):
 
         x = x.to(dev_type)
         m = Model().to(dev_type)
-        m = ddp(m, bucket_size=1)
+        m = ddp(m, bucket_cap_mb=bucket_cap_mb(4))
         y = m(x)
         y.backward()
 
@@ -219,7 +225,7 @@ class TestDDP(flow.unittest.TestCase):
 
         x = x.to(dev_type)
         m = Model().to(dev_type)
-        m = ddp(m, bucket_size=1)
+        m = ddp(m, bucket_cap_mb=bucket_cap_mb(4))
         y = m(x)
         y.backward()
 
@@ -261,6 +267,102 @@ class TestDDP(flow.unittest.TestCase):
         for dev_type in test_device:
             test_case._test_ddp_two_iters(dev_type)
 
+    def _test_ddp_rebuild_buckets(test_case, dev_type):
+        class Model(flow.nn.Module):
+            def __init__(self):
+                super().__init__()
+                self.w1 = flow.nn.Parameter(flow.Tensor([1, 1]))
+                self.w2 = flow.nn.Parameter(flow.Tensor([2, 2]))
+                self.w3 = flow.nn.Parameter(flow.Tensor([3, 3]))
+
+            def forward(self, x):
+                # The gradient of w2 is ready first
+                return x * self.w1 * self.w3 * self.w2
+
+        rank = flow.env.get_rank()
+        x = flow.Tensor([rank + 1, rank + 1]).to(dev_type)
+        m = Model().to(dev_type)
+        m = ddp(m, bucket_cap_mb=bucket_cap_mb(16))
+        test_case.assertEqual(m._ddp_reducer.bucket_param_indices, [[0, 1], [2]])
+
+        for i in range(3):
+            m.zero_grad(set_to_none=(i == 1))
+            y = m(x)
+            test_case.assertEqual(m._ddp_reducer.has_rebuilt_buckets, i > 0)
+            y.sum().backward()
+            test_case.assertTrue(
+                np_allclose_with_shape(m.w1.grad.numpy(), np.array([9, 9]))
+            )
+            test_case.assertTrue(
+                np_allclose_with_shape(m.w2.grad.numpy(), np.array([4.5, 4.5]))
+            )
+            test_case.assertTrue(
+                np_allclose_with_shape(m.w3.grad.numpy(), np.array([3, 3]))
+            )
+        # The reducer indexes the reversed parameters, so w3, w2 and w1 are 0, 1
+        # and 2. The gradients got ready as w2, w3 and w1, and the buckets are
+        # filled in that order
+        test_case.assertEqual(m._ddp_reducer.bucket_param_indices, [[1, 0], [2]])
+
+    def test_ddp_rebuild_buckets(test_case):
+        for dev_type in test_device:
+            test_case._test_ddp_rebuild_buckets(dev_type)
+
+    def _test_ddp_deepcopy(test_case, dev_type):
+        class Mul(flow.nn.Module):
+            def __init__(self):
+                super().__init__()
+                self.w1 = flow.nn.Parameter(flow.Tensor([1, 1]))
+                self.w2 = flow.nn.Parameter(flow.Tensor([1, 1]))
+
+            def forward(self, x):
+                return x * self.w1 * self.w2
+
+        rank = flow.env.get_rank()
+        x = flow.Tensor([rank + 1, rank + 1]).to(dev_type)
+        m = copy.deepcopy(ddp(Mul().to(dev_type), bucket_cap_mb=bucket_cap_mb(8)))
+        # The copy has a reducer of its own with the same buckets
+        test_case.assertEqual(m._ddp_reducer.bucket_param_indices, [[0], [1]])
+        y = m(x)
+        y.sum().backward()
+        test_case.assertTrue(
+            np_allclose_with_shape(m.w1.grad.numpy(), np.array([1.5, 1.5]))
+        )
+        test_case.assertTrue(
+            np_allclose_with_shape(m.w2.grad.numpy(), np.array([1.5, 1.5]))
+        )
+
+    def test_ddp_deepcopy(test_case):
+        for dev_type in test_device:
+            test_case._test_ddp_deepcopy(dev_type)
+
+    def _test_ddp_grad_compression(test_case, dev_type, dtype):
+        class Mul(flow.nn.Module):
+            def __init__(self):
+                super().__init__()
+                self.w = flow.nn.Parameter(flow.Tensor([1, 1, 1, 1]))
+
+            def forward(self, x):
+                return x * self.w
+
+        rank = flow.env.get_rank()
+        x = flow.Tensor([1, 2, 3, 4]).to(dev_type) * (rank + 1)
+        m = Mul().to(dev_type)
+        m = ddp(m, grad_compression_dtype=dtype)
+        y = m(x)
+        y.sum().backward()
+
+        test_case.assertEqual(m.w.grad.dtype, flow.float32)
+        test_case.assertTrue(
+            np_allclose_with_shape(m.w.grad.numpy(), np.array([1.5, 3, 4.5, 6]))
+        )
+
+    def test_ddp_grad_compression(test_case):
+        for dev_type, dtype in GenCartesianProduct(
+            (test_device, [flow.float16, flow.bfloat16])
+        ):
+            test_case._test_ddp_grad_compression(dev_type, dtype)
+
     def _test_broadcast_buffer(test_case, dev_type):
         rank = flow.env.get_rank()
 
@@ -0,0 +1,55 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerOpTrace(flow.unittest.TestCase):
+    def test_replay_on_updated_input(test_case):
+        devices = ["cpu", "cuda"] if flow.cuda.is_available() else ["cpu"]
+        for device in devices:
+            x = flow.ones(2, 3, device=device)
+            trace = flow._oneflow_internal.EagerOpTrace()
+            trace.begin_capture()
+            y = flow.relu(x * 2 - 3)
+            trace.end_capture()
+            test_case.assertEqual(trace.num_ops, 3)
+            test_case.assertTrue(trace.is_valid)
+            x.copy_(flow.arange(6, dtype=flow.float32).reshape(2, 3))
+            trace.replay()
+            expected = np.maximum(np.arange(6).reshape(2, 3) * 2 - 3, 0)
+            test_case.assertTrue(np.allclose(y.numpy(), expected))
+
+    def test_invalid_after_input_replaced(test_case):
+        x = flow.ones(2, 3)
+        trace = flow._oneflow_internal.EagerOpTrace()
+        trace.begin_capture()
+        y = x + 1
+        trace.end_capture()
+        x.data = flow.ones(4)
+        with test_case.assertRaises(Exception):
+            trace.replay()
+        test_case.assertFalse(trace.is_valid)
+
+
+if __name__ == "__main__":
+    unittest.main()
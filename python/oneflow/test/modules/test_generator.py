@@ -190,5 +190,72 @@ class TestDefaultGenerator(flow.unittest.TestCase):
         test_case.assertTrue(np.allclose(x.numpy(), y.numpy()))
 
 
+def _philox4x32_block(counter, key):
+    mask = 0xFFFFFFFF
+    c0, c1, c2, c3 = counter
+    k0, k1 = key
+    for _ in range(10):
+        p0 = 0xD2511F53 * c0
+        p1 = 0xCD9E8D57 * c2
+        c0, c1, c2, c3 = (
+            (p1 >> 32) ^ c1 ^ k0,
+            p1 & mask,
+            (p0 >> 32) ^ c3 ^ k1,
+            p0 & mask,
+        )
+        k0 = (k0 + 0x9E3779B9) & mask
+        k1 = (k1 + 0xBB67AE85) & mask
+    return [c0, c1, c2, c3]
+
+
+def _philox4x32_reference(n, seed, offset, subsequence):
+    mask = 0xFFFFFFFF
+    key = (seed & mask, seed >> 32)
+    numbers = []
+    for block in range(offset // 4, (offset + n + 3) // 4):
+        counter = (block & mask, block >> 32, subsequence & mask, subsequence >> 32)
+        numbers += _philox4x32_block(counter, key)
+    skip = offset % 4
+    return np.array(numbers[skip : skip + n], dtype=np.uint32)
+
+
+class TestPhilox4x32(flow.unittest.TestCase):
+    def test_known_answer(test_case):
+        numbers = flow.philox4x32(4, seed=0)
+        test_case.assertEqual(numbers.dtype, np.uint32)
+        test_case.assertEqual(
+            numbers.tolist(), [0x6627E8D5, 0xE169C58D, 0xBC57AC4C, 0x9B00DBD8]
+        )
+
+    def test_ranges(test_case):
+        seed = 0x123456789ABCDEF
+        subsequence = 7
+        stream = flow.philox4x32(300, seed, subsequence=subsequence)
+        test_case.assertTrue(
+            np.array_equal(stream, _philox4x32_reference(300, seed, 0, subsequence))
+        )
+        # any range of the stream can be generated on its own
+        for offset, n in [(0, 0), (1, 3), (3, 70), (64, 65), (129, 171)]:
+            numbers = flow.philox4x32(n, seed, offset, subsequence)
+            test_case.assertTrue(np.array_equal(numbers, stream[offset : offset + n]))
+        high_offset = (1 << 34) + 5
+        test_case.assertTrue(
+            np.array_equal(
+                flow.philox4x32(9, seed, high_offset),
+                _philox4x32_reference(9, seed, high_offset, 0),
+            )
+        )
+
+    def test_different_streams(test_case):
+        numbers = flow.philox4x32(16, seed=1)
+        test_case.assertFalse(np.array_equal(numbers, flow.philox4x32(16, seed=2)))
+        test_case.assertFalse(
+            np.array_equal(numbers, flow.philox4x32(16, seed=1, subsequence=1))
+        )
+        with test_case.assertRaises(Exception):
+            flow.philox4x32(-1, seed=0)
+
+
+
 if __name__ == "__main__":
     unittest.main()
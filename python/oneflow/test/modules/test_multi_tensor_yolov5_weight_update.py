@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+import os
 import unittest
 from collections import OrderedDict
 
@@ -84,7 +85,9 @@ class TestMultiTensorWeightUpdateModule(flow.unittest.TestCase):
     def test_multi_tensor_weight_update(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_multi_tensor_weight_update_impl]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cpu", "cuda"]
+        if os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"] = ["cpu"]
         arg_dict["shape"] = [(20, 1), (30, 1), (55, 1)]
         arg_dict["n"] = [5, 10, 292]
         arg_dict["d"] = [0.22, 0.5]
@@ -40,6 +40,7 @@ def compare_with_numpy_adam(
     beta1,
     beta2,
     use_optional_tensor,
+    device="cuda",
 ):
 
     num_rows = 500
@@ -118,15 +119,15 @@ def compare_with_numpy_adam(
 
     def adam_by_oneflow():
         unique_embeddings_tensor = flow.tensor(init_value, requires_grad=False).to(
-            "cuda"
+            device
         )
         if use_optional_tensor:
             lr_tensor = flow.tensor(
                 np.array(learning_rate).reshape(1,).astype(np.float32)
-            ).to("cuda")
+            ).to(device)
             down_scale_by_tensor = flow.tensor(
                 np.array(down_scale_by).reshape(1,).astype(np.float32)
-            ).to("cuda")
+            ).to(device)
         else:
             lr_tensor = None
             down_scale_by_tensor = None
@@ -154,12 +155,12 @@ def compare_with_numpy_adam(
             np_ids = np.zeros(num_rows)
             np_ids[0 : num_valid_seq[i]] = np.arange(num_valid_seq[i])
             # add ids of num_valid unique to use id_shuffle out_put num_unique as grad input
-            ids = flow.tensor(np_ids.astype(np.int32)).to("cuda")
-            grad_tensor = flow.tensor(random_grad_seq[i]).to("cuda")
+            ids = flow.tensor(np_ids.astype(np.int32)).to(device)
+            grad_tensor = flow.tensor(random_grad_seq[i]).to(device)
             if use_optional_tensor:
                 skip_if_tensor = flow.tensor(
                     np.array(skip_if_seq[i]).reshape(1,).astype(np.int64)
-                ).to("cuda")
+                ).to(device)
             else:
                 skip_if_tensor = None
             if do_bias_correction and use_optional_tensor:
@@ -167,10 +168,10 @@ def compare_with_numpy_adam(
                 bias_correction2 = 1.0 - np.power(beta2, i)
                 bias_correction1_tensor = flow.tensor(
                     np.array(bias_correction1).reshape(1,).astype(np.float32)
-                ).to("cuda")
+                ).to(device)
                 bias_correction2_tensor = flow.tensor(
                     np.array(bias_correction2).reshape(1,).astype(np.float32)
-                ).to("cuda")
+                ).to(device)
             else:
                 bias_correction1_tensor = None
                 bias_correction2_tensor = None
@@ -262,5 +263,22 @@ class TestOptimizers(flow.unittest.TestCase):
             compare_with_numpy_adam(test_case, **arg)
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestCpuOptimizers(flow.unittest.TestCase):
+    def test_one_embedding_adam(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["weight_decay"] = [0, 0.1]
+        arg_dict["scale"] = [1, 0.1]
+        arg_dict["learning_rate"] = [1, 1.5]
+        arg_dict["train_iters"] = [10]
+        arg_dict["do_bias_correction"] = [True, False]
+        arg_dict["beta1"] = [0.9, 0.8]
+        arg_dict["beta2"] = [0.9, 0.8]
+        arg_dict["use_optional_tensor"] = [True, False]
+        arg_dict["device"] = ["cpu"]
+        for arg in GenArgDict(arg_dict):
+            compare_with_numpy_adam(test_case, **arg)
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -131,6 +131,30 @@ def _test_unique_sorted(test_case, device, return_inverse, return_counts):
         test_case.assertEqual(list(oneflow_counts.shape), list(torch_counts.shape))
 
 
+def _test_unique_large(test_case, sorted, dtype):
+    # Large enough to be deduplicated by several threads on cpu
+    np_input = np.random.randint(0, 50000, size=(1 << 18,)).astype(dtype)
+    output, inverse, counts = flow.unique(
+        flow.tensor(np_input),
+        sorted=sorted,
+        return_inverse=True,
+        return_counts=True,
+    )
+    np_unique, np_first, np_inverse, np_counts = np.unique(
+        np_input, return_index=True, return_inverse=True, return_counts=True
+    )
+    if sorted:
+        test_case.assertTrue(np.array_equal(output.numpy(), np_unique))
+        test_case.assertTrue(np.array_equal(inverse.numpy(), np_inverse))
+        test_case.assertTrue(np.array_equal(counts.numpy(), np_counts))
+    else:
+        # Unsorted results keep the order of the first occurrences
+        order = np.argsort(np_first)
+        test_case.assertTrue(np.array_equal(output.numpy(), np_unique[order]))
+        test_case.assertTrue(np.array_equal(counts.numpy(), np_counts[order]))
+        test_case.assertTrue(np.array_equal(output.numpy()[inverse.numpy()], np_input))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestUnique(flow.unittest.TestCase):
     @autotest(n=5)
@@ -143,6 +167,11 @@ class TestUnique(flow.unittest.TestCase):
             _test_unique_unsorted(test_case, *arg)
             _test_unique_sorted(test_case, *arg)
 
+    def test_unique_large(test_case):
+        for sorted in [False, True]:
+            for dtype in [np.int64, np.int32, np.float32]:
+                _test_unique_large(test_case, sorted, dtype)
+
     @profile(torch.unique)
     def profile_unique(test_case):
         input = torch.randint(0, 1000, (1000,))